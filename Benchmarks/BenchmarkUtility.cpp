@@ -0,0 +1,151 @@
+#include "BenchmarkUtility.h"
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace CDBTo3DTiles {
+static const CDBGeoCell BENCHMARK_GEOCELL(32, -118);
+
+static std::atomic<bool> isCountingAllocations{false};
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<uint64_t> allocatedBytes{0};
+
+void startCountingAllocations() noexcept
+{
+    allocationCount = 0;
+    allocatedBytes = 0;
+    isCountingAllocations = true;
+}
+
+AllocationCount stopCountingAllocations() noexcept
+{
+    isCountingAllocations = false;
+    return AllocationCount{allocationCount, allocatedBytes};
+}
+
+void recordAllocation(size_t bytes) noexcept
+{
+    if (isCountingAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+void printAllocations(const std::string &name, const AllocationCount &count)
+{
+    std::cout << name << ": " << count.allocations << " allocations, " << count.bytes << " bytes\n";
+}
+
+NullOutputStream::NullOutputStream()
+    : std::ostream(&m_buffer)
+{}
+
+NullOutputStream::NullBuffer::int_type NullOutputStream::NullBuffer::overflow(int_type c)
+{
+    ++byteLength;
+    return traits_type::not_eof(c);
+}
+
+std::streamsize NullOutputStream::NullBuffer::xsputn(const char *, std::streamsize count)
+{
+    byteLength += static_cast<uint64_t>(count);
+    return count;
+}
+
+CDBElevationGrid createSyntheticElevationGrid(size_t gridSize)
+{
+    // CDB elevation rasters are Float32, so the grid keeps float heights like the ones read from them
+    std::vector<float> heights;
+    heights.reserve(gridSize * gridSize);
+    for (size_t y = 0; y < gridSize; ++y) {
+        for (size_t x = 0; x < gridSize; ++x) {
+            double u = static_cast<double>(x) / static_cast<double>(gridSize);
+            double v = static_cast<double>(y) / static_cast<double>(gridSize);
+            double hills = 300.0 * std::sin(u * 17.0) * std::cos(v * 11.0);
+            heights.emplace_back(static_cast<float>(hills + 40.0 * std::sin(u * v * 97.0)));
+        }
+    }
+
+    double pixelSize = 1.0 / static_cast<double>(gridSize);
+    CDBTile tile(BENCHMARK_GEOCELL, CDBDataset::Elevation, 1, 1, 0, 0, 0);
+    return CDBElevationGrid(std::move(heights), gridSize, gridSize, glm::dvec2(pixelSize, -pixelSize), tile);
+}
+
+CDBModelsAttributes createSyntheticModelsAttributes(size_t instanceCount)
+{
+    auto driver = GetGDALDriverManager()->GetDriverByName("Memory");
+    if (!driver) {
+        throw std::runtime_error("GDAL Memory driver is not registered");
+    }
+
+    GDALDatasetUniquePtr dataset(driver->Create("", 0, 0, 0, GDT_Unknown, nullptr));
+    OGRLayer *layer = dataset->CreateLayer("points", nullptr, wkbPoint25D, nullptr);
+    OGRFieldDefn CNAMField("CNAM", OFTString);
+    OGRFieldDefn orientationField("AO1", OFTReal);
+    OGRFieldDefn scaleXField("SCALx", OFTReal);
+    OGRFieldDefn scaleYField("SCALy", OFTReal);
+    OGRFieldDefn scaleZField("SCALz", OFTReal);
+    OGRFieldDefn modelField("MODL", OFTString);
+    OGRFieldDefn typeField("FACC", OFTInteger);
+    for (auto field : {&CNAMField,
+                       &orientationField,
+                       &scaleXField,
+                       &scaleYField,
+                       &scaleZField,
+                       &modelField,
+                       &typeField}) {
+        layer->CreateField(field);
+    }
+
+    // CDB features of a tile share a handful of models
+    const double longitude = static_cast<double>(BENCHMARK_GEOCELL.getLongitude());
+    const double latitude = static_cast<double>(BENCHMARK_GEOCELL.getLatitude());
+    for (size_t i = 0; i < instanceCount; ++i) {
+        OGRFeature *feature = OGRFeature::CreateFeature(layer->GetLayerDefn());
+        auto model = static_cast<int>(i % 16);
+        feature->SetField("CNAM", ("CNAM_" + std::to_string(i)).c_str());
+        feature->SetField("AO1", static_cast<double>(i % 360));
+        feature->SetField("SCALx", 1.0);
+        feature->SetField("SCALy", 1.0);
+        feature->SetField("SCALz", 1.0 + static_cast<double>(model) * 0.1);
+        feature->SetField("MODL", ("Model_" + std::to_string(model)).c_str());
+        feature->SetField("FACC", model);
+
+        double u = static_cast<double>(i % 1000) / 1000.0;
+        double v = static_cast<double>(i / 1000 % 1000) / 1000.0;
+        OGRPoint point(longitude + u, latitude + v, 10.0);
+        feature->SetGeometry(&point);
+        layer->CreateFeature(feature);
+        OGRFeature::DestroyFeature(feature);
+    }
+
+    CDBTile tile(BENCHMARK_GEOCELL,
+                 CDBDataset::GTFeature,
+                 2,
+                 static_cast<int>(CDBVectorCS2::PointFeature),
+                 0,
+                 0,
+                 0);
+    return CDBModelsAttributes(std::move(dataset), tile, std::filesystem::temp_directory_path());
+}
+
+CDBTileset createSyntheticTileset(int maxLevel)
+{
+    CDBTileset tileset;
+    for (int level = -10; level <= maxLevel; ++level) {
+        int tilesPerSide = level <= 0 ? 1 : 1 << level;
+        for (int UREF = 0; UREF < tilesPerSide; ++UREF) {
+            for (int RREF = 0; RREF < tilesPerSide; ++RREF) {
+                CDBTile tile(BENCHMARK_GEOCELL, CDBDataset::Elevation, 1, 1, level, UREF, RREF);
+                tile.setCustomContentURI(tile.getFilename() + ".b3dm");
+                tileset.insertTile(tile);
+            }
+        }
+    }
+
+    return tileset;
+}
+} // namespace CDBTo3DTiles
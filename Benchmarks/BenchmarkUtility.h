@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CDBAttributes.h"
+#include "CDBElevation.h"
+#include "CDBTileset.h"
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+namespace CDBTo3DTiles {
+// the data of the unit tests
+static const std::filesystem::path dataPath = TEST_DATA_DIR;
+
+struct AllocationCount
+{
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// counts the calls to operator new of every thread, which the benchmark executable replaces
+void startCountingAllocations() noexcept;
+
+AllocationCount stopCountingAllocations() noexcept;
+
+void recordAllocation(size_t bytes) noexcept;
+
+void printAllocations(const std::string &name, const AllocationCount &count);
+
+// runs the function once outside of the timed samples and prints the allocations it made
+template<typename Function>
+void reportAllocations(const std::string &name, Function &&function)
+{
+    startCountingAllocations();
+    function();
+    printAllocations(name, stopCountingAllocations());
+}
+
+// discards what is written, so the benchmarks of the writers don't measure the storage
+class NullOutputStream : public std::ostream
+{
+public:
+    NullOutputStream();
+
+    inline uint64_t getByteLength() const noexcept { return m_buffer.byteLength; }
+
+private:
+    struct NullBuffer : public std::streambuf
+    {
+        int_type overflow(int_type c) override;
+
+        std::streamsize xsputn(const char *s, std::streamsize count) override;
+
+        uint64_t byteLength = 0;
+    };
+
+    NullBuffer m_buffer;
+};
+
+// a 1 degree level 0 elevation tile of gridSize x gridSize cells with rolling hills, in the first GeoCell of
+// the San Diego data
+CDBElevationGrid createSyntheticElevationGrid(size_t gridSize);
+
+// point features spread over a GeoCell with the orientation, scale and CNAM of GTModel instances
+CDBModelsAttributes createSyntheticModelsAttributes(size_t instanceCount);
+
+// every tile of the quadtree below the GeoCell, down to the given level
+CDBTileset createSyntheticTileset(int maxLevel);
+} // namespace CDBTo3DTiles
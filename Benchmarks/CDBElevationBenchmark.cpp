@@ -0,0 +1,90 @@
+#include "BenchmarkUtility.h"
+#include "CDBElevation.h"
+#include "catch2/catch.hpp"
+
+using namespace CDBTo3DTiles;
+
+static const float BENCHMARK_DECIMATE_ERROR = 0.01f;
+static const float BENCHMARK_THRESHOLD_INDICES = 0.3f;
+
+static size_t getTargetIndexCount(const CDBElevation &elevation)
+{
+    return static_cast<size_t>(static_cast<float>(elevation.getUniformGridMesh().indices.size())
+                               * BENCHMARK_THRESHOLD_INDICES);
+}
+
+TEST_CASE("Benchmark elevation read from file", "[CDBElevation]")
+{
+    std::filesystem::path elevationFile = dataPath / "Elevation" / "N34W119_D001_S001_T001_LC06_U0_R0.tif";
+
+    BENCHMARK("createFromFile Tests/Data")
+    {
+        return CDBElevation::createFromFile(elevationFile);
+    };
+
+    // simplifying keeps its mesh in the elevation, so each run simplifies an elevation of its own
+    BENCHMARK_ADVANCED("createSimplifiedMesh Tests/Data")(Catch::Benchmark::Chronometer meter)
+    {
+        std::vector<CDBElevation> elevations;
+        for (int i = 0; i < meter.runs(); ++i) {
+            elevations.emplace_back(*CDBElevation::createFromFile(elevationFile));
+        }
+
+        meter.measure([&](int i) {
+            auto &elevation = elevations[static_cast<size_t>(i)];
+            return elevation.createSimplifiedMesh(getTargetIndexCount(elevation), BENCHMARK_DECIMATE_ERROR);
+        });
+    };
+
+    reportAllocations("createFromFile Tests/Data", [&]() { CDBElevation::createFromFile(elevationFile); });
+}
+
+TEST_CASE("Benchmark synthetic elevation meshes and simplification", "[CDBElevation]")
+{
+    for (size_t gridSize : {64, 256, 1024}) {
+        auto grid = createSyntheticElevationGrid(gridSize);
+        std::string gridName = std::to_string(gridSize) + "x" + std::to_string(gridSize);
+
+        BENCHMARK("createFromGrid " + gridName)
+        {
+            return CDBElevation::createFromGrid(grid);
+        };
+
+        BENCHMARK_ADVANCED("createSimplifiedMesh " + gridName)(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<CDBElevation> elevations;
+            for (int i = 0; i < meter.runs(); ++i) {
+                elevations.emplace_back(*CDBElevation::createFromGrid(grid));
+            }
+
+            meter.measure([&](int i) {
+                auto &elevation = elevations[static_cast<size_t>(i)];
+                size_t targetIndexCount = getTargetIndexCount(elevation);
+                return elevation.createSimplifiedMesh(targetIndexCount, BENCHMARK_DECIMATE_ERROR);
+            });
+        };
+
+        // the sub-regions share the error pyramid of the parent, which is computed before the runs
+        BENCHMARK_ADVANCED("createSimplifiedMesh sub-region " + gridName)(Catch::Benchmark::Chronometer meter)
+        {
+            auto elevation = CDBElevation::createFromGrid(grid);
+            elevation->createSimplifiedMesh(getTargetIndexCount(*elevation), BENCHMARK_DECIMATE_ERROR);
+            std::vector<CDBElevation> subRegions;
+            for (int i = 0; i < meter.runs(); ++i) {
+                subRegions.emplace_back(*elevation->createNorthWestSubRegion(true));
+            }
+
+            meter.measure([&](int i) {
+                auto &subRegion = subRegions[static_cast<size_t>(i)];
+                size_t targetIndexCount = getTargetIndexCount(subRegion);
+                return subRegion.createSimplifiedMesh(targetIndexCount, BENCHMARK_DECIMATE_ERROR);
+            });
+        };
+
+        reportAllocations("createFromGrid " + gridName, [&]() { CDBElevation::createFromGrid(grid); });
+        auto elevation = CDBElevation::createFromGrid(grid);
+        reportAllocations("createSimplifiedMesh " + gridName, [&]() {
+            elevation->createSimplifiedMesh(getTargetIndexCount(*elevation), BENCHMARK_DECIMATE_ERROR);
+        });
+    }
+}
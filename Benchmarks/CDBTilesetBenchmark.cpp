@@ -0,0 +1,41 @@
+#include "BenchmarkUtility.h"
+#include "CDBTileset.h"
+#include "catch2/catch.hpp"
+#include <random>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Benchmark tileset insertion and lookup", "[CDBTileset]")
+{
+    for (int maxLevel : {4, 8}) {
+        std::string levelName = "down to level " + std::to_string(maxLevel);
+
+        BENCHMARK("insertTile " + levelName)
+        {
+            return createSyntheticTileset(maxLevel);
+        };
+
+        // the points of the models and vectors are spread over the whole GeoCell
+        CDBTileset tileset = createSyntheticTileset(maxLevel);
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> longitude(glm::radians(-118.0), glm::radians(-117.0));
+        std::uniform_real_distribution<double> latitude(glm::radians(32.0), glm::radians(33.0));
+        std::vector<Core::Cartographic> points;
+        points.reserve(10000);
+        for (size_t i = 0; i < 10000; ++i) {
+            points.emplace_back(longitude(generator), latitude(generator), 0.0);
+        }
+
+        BENCHMARK("getFitTile 10000 points " + levelName)
+        {
+            size_t fitTileCount = 0;
+            for (const auto &point : points) {
+                fitTileCount += tileset.getFitTile(point) != nullptr;
+            }
+
+            return fitTileCount;
+        };
+
+        reportAllocations("insertTile " + levelName, [&]() { createSyntheticTileset(maxLevel); });
+    }
+}
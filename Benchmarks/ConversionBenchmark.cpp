@@ -0,0 +1,189 @@
+#include "CDBTo3DTiles.h"
+#include "Utility.h"
+#include "cxxopts.hpp"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// the datasets combined by default by the CLI, so the benchmark converts the same way
+static const char *COMBINED_DATASETS = "Elevation_1_1,GSModels_1_1,GTModels_2_1,GTModels_1_1";
+
+struct ConversionRun
+{
+    size_t threadCount;
+    double wallSeconds;
+    double CPUSeconds;
+    uint64_t peakResidentBytes;
+    uint64_t tiles;
+    uint64_t bytesOut;
+};
+
+static std::vector<size_t> getThreadCounts(size_t maxThreadCount)
+{
+    std::vector<size_t> threadCounts;
+    for (size_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2) {
+        threadCounts.emplace_back(threadCount);
+    }
+
+    threadCounts.emplace_back(maxThreadCount);
+    return threadCounts;
+}
+
+static std::string quote(const std::string &argument)
+{
+    return "\"" + argument + "\"";
+}
+
+static void convert(const std::filesystem::path &CDBPath,
+                    const std::filesystem::path &outputPath,
+                    size_t threadCount,
+                    const std::filesystem::path &statsPath)
+{
+    CDBTo3DTiles::GlobalInitializer initializer;
+    CDBTo3DTiles::Converter converter(CDBPath, outputPath);
+    converter.setThreadCount(threadCount);
+    converter.setCollectStats(true);
+    converter.combineDataset(CDBTo3DTiles::splitString(COMBINED_DATASETS, ","));
+    converter.convert();
+
+    std::ofstream fs(statsPath);
+    converter.writeStats(fs);
+}
+
+static ConversionRun runConversion(const std::string &executable,
+                                   const std::filesystem::path &CDBPath,
+                                   const std::filesystem::path &workPath,
+                                   size_t threadCount)
+{
+    // each conversion runs in its own process, so the peak memory of a run is not the one of a previous run
+    std::string threads = std::to_string(threadCount);
+    auto outputPath = workPath / ("Threads" + threads);
+    auto statsPath = workPath / ("Threads" + threads + ".json");
+    std::filesystem::remove_all(outputPath);
+    std::string command = quote(executable) + " --run-threads " + threads;
+    command += " -i " + quote(CDBPath.string()) + " -o " + quote(outputPath.string());
+    command += " --stats-output " + quote(statsPath.string());
+#ifdef _WIN32
+    // cmd.exe strips the outer quotes of a command that starts with one
+    command = quote(command);
+#endif
+    if (std::system(command.c_str()) != 0) {
+        throw std::runtime_error("The conversion with " + threads + " threads failed");
+    }
+
+    std::ifstream fs(statsPath);
+    nlohmann::json stats = nlohmann::json::parse(fs);
+    std::filesystem::remove_all(outputPath);
+
+    ConversionRun run;
+    run.threadCount = threadCount;
+    run.wallSeconds = stats["wallSeconds"].get<double>();
+    run.CPUSeconds = stats["CPUSeconds"].get<double>();
+    run.peakResidentBytes = stats["peakResidentBytes"].get<uint64_t>();
+    run.tiles = stats["tiles"].get<uint64_t>();
+    run.bytesOut = stats["bytesOut"].get<uint64_t>();
+    return run;
+}
+
+static void printRuns(const std::vector<ConversionRun> &runs)
+{
+    std::printf("%8s %10s %10s %10s %12s %14s %8s %10s\n",
+                "threads",
+                "wall (s)",
+                "CPU (s)",
+                "tiles/s",
+                "MB/s written",
+                "peak RSS (MB)",
+                "speedup",
+                "efficiency");
+    for (const auto &run : runs) {
+        double megabytes = static_cast<double>(run.bytesOut) / (1024.0 * 1024.0);
+        double speedup = runs.front().wallSeconds / run.wallSeconds;
+        std::printf("%8zu %10.2f %10.2f %10.1f %12.2f %14.1f %8.2f %9.0f%%\n",
+                    run.threadCount,
+                    run.wallSeconds,
+                    run.CPUSeconds,
+                    static_cast<double>(run.tiles) / run.wallSeconds,
+                    megabytes / run.wallSeconds,
+                    static_cast<double>(run.peakResidentBytes) / (1024.0 * 1024.0),
+                    speedup,
+                    100.0 * speedup / static_cast<double>(run.threadCount));
+    }
+}
+
+static void writeRunsToCSV(const std::vector<ConversionRun> &runs, const std::filesystem::path &CSVPath)
+{
+    std::ofstream fs(CSVPath);
+    fs << "threads,wallSeconds,CPUSeconds,tiles,bytesOut,peakResidentBytes\n";
+    for (const auto &run : runs) {
+        fs << run.threadCount << "," << run.wallSeconds << "," << run.CPUSeconds << "," << run.tiles << ","
+           << run.bytesOut << "," << run.peakResidentBytes << "\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    cxxopts::Options options("ConversionBenchmark",
+                             "Convert a CDB with 1 to N threads and report the throughput and peak memory");
+
+    // clang-format off
+    options.add_options()
+        ("i, input",
+            "CDB directory, e.g. written by SyntheticCDB",
+            cxxopts::value<std::string>())
+        ("o, output",
+            "Directory of the conversions, which are removed once measured",
+            cxxopts::value<std::string>())
+        ("threads",
+            "Largest number of threads. The CDB is converted with 1, 2, 4 and so on up to this number of threads",
+            cxxopts::value<size_t>()->default_value(std::to_string(std::thread::hardware_concurrency())))
+        ("csv",
+            "Write the measures of every run to a CSV file",
+            cxxopts::value<std::string>())
+        ("run-threads",
+            "Run a single conversion with this number of threads. Used by the benchmark for each of its runs",
+            cxxopts::value<size_t>())
+        ("stats-output",
+            "Stats file of the single conversion",
+            cxxopts::value<std::string>())
+        ("h, help", "Print usage");
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("input") || !result.count("output")) {
+        std::cout << options.help() << "\n";
+        return 0;
+    }
+
+    try {
+        std::filesystem::path CDBPath = result["input"].as<std::string>();
+        std::filesystem::path outputPath = result["output"].as<std::string>();
+        if (result.count("run-threads")) {
+            size_t threadCount = result["run-threads"].as<size_t>();
+            convert(CDBPath, outputPath, threadCount, result["stats-output"].as<std::string>());
+            return 0;
+        }
+
+        std::filesystem::create_directories(outputPath);
+        std::vector<ConversionRun> runs;
+        for (size_t threadCount : getThreadCounts(std::max<size_t>(result["threads"].as<size_t>(), 1))) {
+            runs.emplace_back(runConversion(argv[0], CDBPath, outputPath, threadCount));
+        }
+
+        printRuns(runs);
+        if (result.count("csv")) {
+            writeRunsToCSV(runs, result["csv"].as<std::string>());
+        }
+    } catch (const std::exception &e) {
+        std::cout << "An error has occured: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
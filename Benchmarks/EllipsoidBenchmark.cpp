@@ -0,0 +1,67 @@
+#include "BenchmarkUtility.h"
+#include "Ellipsoid.h"
+#include "catch2/catch.hpp"
+#include <cmath>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Benchmark cartographic to cartesian conversion", "[Ellipsoid]")
+{
+    const Core::Ellipsoid &ellipsoid = Core::Ellipsoid::WGS84;
+
+    for (size_t pointCount : {100000, 1000000}) {
+        // a square grid over the first GeoCell of the San Diego data, like the vertices of an elevation tile
+        auto gridSize = static_cast<size_t>(std::sqrt(static_cast<double>(pointCount)));
+        std::vector<double> longitudes(gridSize);
+        std::vector<double> latitudes(gridSize);
+        std::vector<double> heights(gridSize * gridSize);
+        for (size_t i = 0; i < gridSize; ++i) {
+            double t = static_cast<double>(i) / static_cast<double>(gridSize);
+            longitudes[i] = glm::radians(-118.0 + t);
+            latitudes[i] = glm::radians(33.0 - t);
+        }
+
+        std::vector<Core::Cartographic> cartographics;
+        cartographics.reserve(gridSize * gridSize);
+        for (size_t y = 0; y < gridSize; ++y) {
+            for (size_t x = 0; x < gridSize; ++x) {
+                heights[y * gridSize + x] = static_cast<double>((x * 7 + y * 13) % 500);
+                cartographics.emplace_back(longitudes[x], latitudes[y], heights[y * gridSize + x]);
+            }
+        }
+
+        std::string pointsName = std::to_string(cartographics.size()) + " points";
+
+        BENCHMARK("cartographicToCartesian one by one " + pointsName)
+        {
+            std::vector<glm::dvec3> cartesians;
+            cartesians.reserve(cartographics.size());
+            for (const auto &cartographic : cartographics) {
+                cartesians.emplace_back(ellipsoid.cartographicToCartesian(cartographic));
+            }
+
+            return cartesians;
+        };
+
+        BENCHMARK("cartographicToCartesian batch " + pointsName)
+        {
+            std::vector<glm::dvec3> cartesians;
+            cartesians.reserve(cartographics.size());
+            ellipsoid.cartographicToCartesian(cartographics, cartesians);
+            return cartesians;
+        };
+
+        BENCHMARK("cartographicGridToCartesian " + pointsName)
+        {
+            std::vector<glm::dvec3> cartesians;
+            cartesians.reserve(cartographics.size());
+            ellipsoid.cartographicGridToCartesian(longitudes, latitudes, heights, cartesians);
+            return cartesians;
+        };
+
+        reportAllocations("cartographicToCartesian batch " + pointsName, [&]() {
+            std::vector<glm::dvec3> cartesians;
+            ellipsoid.cartographicToCartesian(cartographics, cartesians);
+        });
+    }
+}
@@ -0,0 +1,584 @@
+#include "SyntheticCDB.h"
+#include "CDB.h"
+#include "CDBAttributes.h"
+#include "CDBTile.h"
+#include "ThreadPool.h"
+#include "Utility.h"
+#include "cpl_conv.h"
+#include "gdal_priv.h"
+#include "ogr_srs_api.h"
+#include "ogrsf_frmts.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace CDBTo3DTiles {
+static const int GEOCELLS_PER_ROW = 8;
+static const int MIN_LEVEL = -10;
+static const size_t ROAD_CLASS_COUNT = 4;
+static const size_t MAX_ROAD_VERTICES = 8;
+static const double ROAD_STEP_IN_DEGREE = 0.004;
+
+struct TemplateModel
+{
+    std::string FACC;
+    int FSC;
+    std::string MODL;
+    std::filesystem::path path;
+};
+
+struct ModelTemplates
+{
+    std::vector<TemplateModel> models;
+    std::vector<std::filesystem::path> textures;
+};
+
+static std::vector<CDBGeoCell> createGeoCells(size_t geoCellCount);
+
+static ModelTemplates findModelTemplates(const std::filesystem::path &templatePath);
+
+static void generateGeoCell(const CDBGeoCell &geoCell,
+                            const SyntheticCDBOptions &options,
+                            const ModelTemplates &templates,
+                            uint32_t seed,
+                            const std::filesystem::path &outputPath);
+
+static void writeElevationTile(const CDBTile &tile, size_t tileSize, const std::filesystem::path &outputPath);
+
+static void writeImageryTile(const CDBTile &tile, size_t tileSize, const std::filesystem::path &outputPath);
+
+static void writeRoadNetwork(const CDBGeoCell &geoCell,
+                             size_t featureCount,
+                             std::mt19937 &random,
+                             const std::filesystem::path &outputPath);
+
+static void writeModelFeatures(const CDBTile &instancesTile,
+                               size_t instanceCount,
+                               const std::vector<TemplateModel> &models,
+                               std::mt19937 &random,
+                               const std::filesystem::path &outputPath);
+
+static void writeGSModelArchives(const CDBGeoCell &geoCell,
+                                 const ModelTemplates &templates,
+                                 const std::filesystem::path &outputPath);
+
+static void writeZip(const std::filesystem::path &zipPath,
+                     const std::vector<std::pair<std::string, std::filesystem::path>> &entries);
+
+static double getHeight(double longitude, double latitude);
+
+static size_t getLevelTileSize(size_t tileSize, int level);
+
+static std::filesystem::path createTilePath(const CDBTile &tile,
+                                            const std::filesystem::path &outputPath,
+                                            const std::string &extension);
+
+static GDALDriver *getDriver(const char *name);
+
+static GDALDatasetUniquePtr createShapefile(const std::filesystem::path &file);
+
+static OGRLayer *createLayer(GDALDataset &dataset, const CDBTile &tile, OGRwkbGeometryType geometryType);
+
+static void addField(OGRLayer *layer, const char *name, OGRFieldType type, int width);
+
+static unsigned char toByte(double value);
+
+void generateSyntheticCDB(const SyntheticCDBOptions &options, const std::filesystem::path &outputPath)
+{
+    if (options.tileSize == 0 || (options.tileSize & (options.tileSize - 1)) != 0) {
+        throw std::invalid_argument("Tile size must be a power of 2");
+    }
+
+    if (options.maxLevel < MIN_LEVEL) {
+        throw std::invalid_argument("Max level must be at least " + std::to_string(MIN_LEVEL));
+    }
+
+    ModelTemplates templates;
+    if (options.GTModelInstanceCount > 0 || options.GSModelInstanceCount > 0) {
+        templates = findModelTemplates(options.modelTemplatePath);
+        if (templates.models.empty()) {
+            throw std::runtime_error("No GTModel geometry found in " + options.modelTemplatePath.string());
+        }
+
+        // the instances of every GeoCell share the GTModel library at the root of the CDB
+        if (options.GTModelInstanceCount > 0) {
+            std::filesystem::create_directories(outputPath / CDB::GTModel);
+            std::filesystem::copy(options.modelTemplatePath / CDB::GTModel,
+                                  outputPath / CDB::GTModel,
+                                  std::filesystem::copy_options::recursive
+                                      | std::filesystem::copy_options::overwrite_existing);
+        }
+    }
+
+    // each GeoCell draws from its own generator, so the CDB does not depend on the thread count
+    ThreadPool threadPool(std::max<size_t>(options.threadCount, 1));
+    TaskGroup geoCellTasks(threadPool);
+    auto geoCells = createGeoCells(options.geoCellCount);
+    for (size_t i = 0; i < geoCells.size(); ++i) {
+        auto seed = options.seed + static_cast<uint32_t>(i);
+        geoCellTasks.run([&, i, seed]() {
+            generateGeoCell(geoCells[i], options, templates, seed, outputPath);
+        });
+    }
+
+    geoCellTasks.wait();
+}
+
+std::vector<CDBGeoCell> createGeoCells(size_t geoCellCount)
+{
+    std::vector<CDBGeoCell> geoCells;
+    geoCells.reserve(geoCellCount);
+    for (size_t i = 0; i < geoCellCount; ++i) {
+        int row = static_cast<int>(i) / GEOCELLS_PER_ROW;
+        int column = static_cast<int>(i) % GEOCELLS_PER_ROW;
+
+        // GeoCells get wider toward the poles
+        CDBGeoCell firstInRow(32 + row, -118);
+        geoCells.emplace_back(32 + row, -118 + column * firstInRow.getLongitudeExtentInDegree());
+    }
+
+    return geoCells;
+}
+
+ModelTemplates findModelTemplates(const std::filesystem::path &templatePath)
+{
+    ModelTemplates templates;
+    auto GTModelPath = templatePath / CDB::GTModel;
+    if (!std::filesystem::exists(GTModelPath)) {
+        return templates;
+    }
+
+    // the textures are looked up by file name, wherever they are
+    auto geometryDirectory = getCDBDatasetDirectoryName(CDBDataset::GTModelGeometry_500);
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(GTModelPath)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+
+        auto extension = entry.path().extension();
+        if (extension != ".flt") {
+            if (extension == ".rgb" || extension == ".rgba" || extension == ".png" || extension == ".jpg"
+                || extension == ".attr") {
+                templates.textures.emplace_back(entry.path());
+            }
+
+            continue;
+        }
+
+        if (std::filesystem::relative(entry.path(), GTModelPath).begin()->string() != geometryDirectory) {
+            continue;
+        }
+
+        // GTModel geometries are named D500_S001_T001_{FACC}_{FSC}_{MODL}
+        std::string name = entry.path().stem().string();
+        std::vector<std::string> parts = splitString(name, "_");
+        if (parts.size() < 6) {
+            continue;
+        }
+
+        size_t MODLStart = parts[0].size() + parts[1].size() + parts[2].size() + parts[3].size()
+                           + parts[4].size() + 5;
+        templates.models.emplace_back(
+            TemplateModel{parts[3], std::stoi(parts[4]), name.substr(MODLStart), entry.path()});
+    }
+
+    // directory iteration order is unspecified, the generated CDB is not
+    auto byPath = [](const auto &lhs, const auto &rhs) { return lhs.path < rhs.path; };
+    std::sort(templates.models.begin(), templates.models.end(), byPath);
+    std::sort(templates.textures.begin(), templates.textures.end());
+    return templates;
+}
+
+void generateGeoCell(const CDBGeoCell &geoCell,
+                     const SyntheticCDBOptions &options,
+                     const ModelTemplates &templates,
+                     uint32_t seed,
+                     const std::filesystem::path &outputPath)
+{
+    for (int level = MIN_LEVEL; level <= options.maxLevel; ++level) {
+        int tilesPerSide = level < 0 ? 1 : 1 << level;
+        for (int UREF = 0; UREF < tilesPerSide; ++UREF) {
+            for (int RREF = 0; RREF < tilesPerSide; ++RREF) {
+                writeElevationTile(CDBTile(geoCell, CDBDataset::Elevation, 1, 1, level, UREF, RREF),
+                                   options.tileSize,
+                                   outputPath);
+                if (options.imagery) {
+                    writeImageryTile(CDBTile(geoCell, CDBDataset::Imagery, 1, 1, level, UREF, RREF),
+                                     options.tileSize,
+                                     outputPath);
+                }
+            }
+        }
+    }
+
+    std::mt19937 random(seed);
+    if (options.roadFeatureCount > 0) {
+        writeRoadNetwork(geoCell, options.roadFeatureCount, random, outputPath);
+    }
+
+    const int pointFeature = static_cast<int>(CDBVectorCS2::PointFeature);
+    if (options.GTModelInstanceCount > 0) {
+        writeModelFeatures(CDBTile(geoCell, CDBDataset::GTFeature, 1, pointFeature, 0, 0, 0),
+                           options.GTModelInstanceCount,
+                           templates.models,
+                           random,
+                           outputPath);
+    }
+
+    if (options.GSModelInstanceCount > 0) {
+        writeModelFeatures(CDBTile(geoCell, CDBDataset::GSFeature, 1, pointFeature, 0, 0, 0),
+                           options.GSModelInstanceCount,
+                           templates.models,
+                           random,
+                           outputPath);
+        writeGSModelArchives(geoCell, templates, outputPath);
+    }
+}
+
+void writeElevationTile(const CDBTile &tile, size_t tileSize, const std::filesystem::path &outputPath)
+{
+    auto rectangle = tile.getBoundRegion().getRectangle();
+    double west = glm::degrees(rectangle.getWest());
+    double north = glm::degrees(rectangle.getNorth());
+    size_t size = getLevelTileSize(tileSize, tile.getLevel());
+    double pixelWidth = glm::degrees(rectangle.computeWidth()) / static_cast<double>(size);
+    double pixelHeight = glm::degrees(rectangle.computeHeight()) / static_cast<double>(size);
+
+    std::vector<float> heights;
+    heights.reserve(size * size);
+    for (size_t y = 0; y < size; ++y) {
+        for (size_t x = 0; x < size; ++x) {
+            double longitude = west + (static_cast<double>(x) + 0.5) * pixelWidth;
+            double latitude = north - (static_cast<double>(y) + 0.5) * pixelHeight;
+            heights.emplace_back(static_cast<float>(getHeight(longitude, latitude)));
+        }
+    }
+
+    auto path = createTilePath(tile, outputPath, ".tif");
+    int rasterSize = static_cast<int>(size);
+    GDALDatasetUniquePtr dataset(
+        getDriver("GTiff")->Create(path.string().c_str(), rasterSize, rasterSize, 1, GDT_Float32, nullptr));
+    if (!dataset) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+
+    double geoTransform[6] = {west, pixelWidth, 0.0, north, 0.0, -pixelHeight};
+    dataset->SetGeoTransform(geoTransform);
+    dataset->SetProjection(SRS_WKT_WGS84_LAT_LONG);
+    CPLErr error = dataset->GetRasterBand(1)->RasterIO(
+        GF_Write, 0, 0, rasterSize, rasterSize, heights.data(), rasterSize, rasterSize, GDT_Float32, 0, 0);
+    if (error != CE_None) {
+        throw std::runtime_error("Cannot write " + path.string());
+    }
+}
+
+void writeImageryTile(const CDBTile &tile, size_t tileSize, const std::filesystem::path &outputPath)
+{
+    auto rectangle = tile.getBoundRegion().getRectangle();
+    double west = glm::degrees(rectangle.getWest());
+    double north = glm::degrees(rectangle.getNorth());
+    size_t size = getLevelTileSize(tileSize, tile.getLevel());
+    double pixelWidth = glm::degrees(rectangle.computeWidth()) / static_cast<double>(size);
+    double pixelHeight = glm::degrees(rectangle.computeHeight()) / static_cast<double>(size);
+
+    // shaded by height with fields of varying green, so the encoder has texture to work on
+    std::vector<unsigned char> pixels(size * size * 3);
+    for (size_t y = 0; y < size; ++y) {
+        for (size_t x = 0; x < size; ++x) {
+            double longitude = west + (static_cast<double>(x) + 0.5) * pixelWidth;
+            double latitude = north - (static_cast<double>(y) + 0.5) * pixelHeight;
+            double height = getHeight(longitude, latitude);
+            double field = std::sin(longitude * 400.0) * std::cos(latitude * 400.0);
+            size_t pixel = y * size + x;
+            pixels[pixel] = toByte(110.0 + height * 0.2);
+            pixels[size * size + pixel] = toByte(120.0 + field * 50.0);
+            pixels[2 * size * size + pixel] = toByte(70.0 + height * 0.1);
+        }
+    }
+
+    int rasterSize = static_cast<int>(size);
+    GDALDatasetUniquePtr image(getDriver("MEM")->Create("", rasterSize, rasterSize, 3, GDT_Byte, nullptr));
+    double geoTransform[6] = {west, pixelWidth, 0.0, north, 0.0, -pixelHeight};
+    image->SetGeoTransform(geoTransform);
+    image->SetProjection(SRS_WKT_WGS84_LAT_LONG);
+    CPLErr error = image->RasterIO(GF_Write,
+                                   0,
+                                   0,
+                                   rasterSize,
+                                   rasterSize,
+                                   pixels.data(),
+                                   rasterSize,
+                                   rasterSize,
+                                   GDT_Byte,
+                                   3,
+                                   nullptr,
+                                   0,
+                                   0,
+                                   0);
+    if (error != CE_None) {
+        throw std::runtime_error("Cannot fill the imagery of " + tile.getFilename());
+    }
+
+    // the JPEG 2000 driver only writes copies
+    auto path = createTilePath(tile, outputPath, ".jp2");
+    GDALDriver *driver = getDriver("JP2OpenJPEG");
+    GDALDatasetUniquePtr imagery(
+        driver->CreateCopy(path.string().c_str(), image.get(), FALSE, nullptr, nullptr, nullptr));
+    if (!imagery) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+}
+
+void writeRoadNetwork(const CDBGeoCell &geoCell,
+                      size_t featureCount,
+                      std::mt19937 &random,
+                      const std::filesystem::path &outputPath)
+{
+    CDBTile tile(geoCell, CDBDataset::RoadNetwork, 2, static_cast<int>(CDBVectorCS2::LinealFeature), 0, 0, 0);
+    auto rectangle = tile.getBoundRegion().getRectangle();
+    double west = glm::degrees(rectangle.getWest());
+    double south = glm::degrees(rectangle.getSouth());
+    double east = glm::degrees(rectangle.getEast());
+    double north = glm::degrees(rectangle.getNorth());
+    std::uniform_real_distribution<double> longitudes(west, east);
+    std::uniform_real_distribution<double> latitudes(south, north);
+    std::uniform_real_distribution<double> steps(-ROAD_STEP_IN_DEGREE, ROAD_STEP_IN_DEGREE);
+    std::uniform_int_distribution<size_t> vertexCounts(2, MAX_ROAD_VERTICES);
+
+    auto dataset = createShapefile(createTilePath(tile, outputPath, ".shp"));
+    OGRLayer *layer = createLayer(*dataset, tile, wkbLineString25D);
+    addField(layer, "CNAM", OFTString, 32);
+    addField(layer, "RTAI", OFTInteger, 3);
+    for (size_t i = 0; i < featureCount; ++i) {
+        OGRLineString line;
+        double longitude = longitudes(random);
+        double latitude = latitudes(random);
+        size_t vertexCount = vertexCounts(random);
+        for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+            line.addPoint(longitude, latitude, 0.0);
+            longitude = std::clamp(longitude + steps(random), west, east);
+            latitude = std::clamp(latitude + steps(random), south, north);
+        }
+
+        OGRFeature *feature = OGRFeature::CreateFeature(layer->GetLayerDefn());
+        feature->SetField("CNAM", ("AP030000-" + std::to_string(i % ROAD_CLASS_COUNT)).c_str());
+        feature->SetField("RTAI", 100);
+        feature->SetGeometry(&line);
+        layer->CreateFeature(feature);
+        OGRFeature::DestroyFeature(feature);
+    }
+
+    const int linealFeatureClassLevel = static_cast<int>(CDBVectorCS2::LinealFeatureClassLevel);
+    CDBTile classTile(geoCell, CDBDataset::RoadNetwork, 2, linealFeatureClassLevel, 0, 0, 0);
+    auto classDataset = createShapefile(createTilePath(classTile, outputPath, ".dbf"));
+    OGRLayer *classLayer = createLayer(*classDataset, classTile, wkbNone);
+    addField(classLayer, "CNAM", OFTString, 32);
+    addField(classLayer, "FACC", OFTString, 5);
+    addField(classLayer, "FSC", OFTInteger, 3);
+    addField(classLayer, "LTN", OFTInteger, 2);
+    addField(classLayer, "WGP", OFTReal, 9);
+    for (size_t i = 0; i < ROAD_CLASS_COUNT; ++i) {
+        OGRFeature *feature = OGRFeature::CreateFeature(classLayer->GetLayerDefn());
+        feature->SetField("CNAM", ("AP030000-" + std::to_string(i)).c_str());
+        feature->SetField("FACC", "AP030");
+        feature->SetField("FSC", 0);
+        feature->SetField("LTN", static_cast<int>(i % 4) + 1);
+        feature->SetField("WGP", 3.2 * static_cast<double>(i % 4 + 1));
+        classLayer->CreateFeature(feature);
+        OGRFeature::DestroyFeature(feature);
+    }
+}
+
+void writeModelFeatures(const CDBTile &instancesTile,
+                        size_t instanceCount,
+                        const std::vector<TemplateModel> &models,
+                        std::mt19937 &random,
+                        const std::filesystem::path &outputPath)
+{
+    auto rectangle = instancesTile.getBoundRegion().getRectangle();
+    std::uniform_real_distribution<double> longitudes(glm::degrees(rectangle.getWest()),
+                                                      glm::degrees(rectangle.getEast()));
+    std::uniform_real_distribution<double> latitudes(glm::degrees(rectangle.getSouth()),
+                                                     glm::degrees(rectangle.getNorth()));
+    std::uniform_real_distribution<double> orientations(0.0, 360.0);
+
+    // one class per model, which the instances refer to by CNAM
+    auto getCNAM = [&](size_t model) {
+        std::string FSC = toStringWithZeroPadding(3, models[model].FSC);
+        return models[model].FACC + FSC + "-" + std::to_string(model);
+    };
+
+    auto dataset = createShapefile(createTilePath(instancesTile, outputPath, ".shp"));
+    OGRLayer *layer = createLayer(*dataset, instancesTile, wkbPoint25D);
+    addField(layer, "AO1", OFTReal, 7);
+    addField(layer, "CNAM", OFTString, 32);
+    addField(layer, "RTAI", OFTInteger, 3);
+    addField(layer, "SCALx", OFTReal, 9);
+    addField(layer, "SCALy", OFTReal, 9);
+    addField(layer, "SCALz", OFTReal, 9);
+    for (size_t i = 0; i < instanceCount; ++i) {
+        OGRPoint point(longitudes(random), latitudes(random), 0.0);
+        OGRFeature *feature = OGRFeature::CreateFeature(layer->GetLayerDefn());
+        feature->SetField("AO1", orientations(random));
+        feature->SetField("CNAM", getCNAM(i % models.size()).c_str());
+        feature->SetField("RTAI", 100);
+        feature->SetField("SCALx", 1.0);
+        feature->SetField("SCALy", 1.0);
+        feature->SetField("SCALz", 1.0);
+        feature->SetGeometry(&point);
+        layer->CreateFeature(feature);
+        OGRFeature::DestroyFeature(feature);
+    }
+
+    CDBTile classTile(instancesTile.getGeoCell(),
+                      instancesTile.getDataset(),
+                      instancesTile.getCS_1(),
+                      static_cast<int>(CDBVectorCS2::PointFeatureClassLevel),
+                      instancesTile.getLevel(),
+                      instancesTile.getUREF(),
+                      instancesTile.getRREF());
+    auto classDataset = createShapefile(createTilePath(classTile, outputPath, ".dbf"));
+    OGRLayer *classLayer = createLayer(*classDataset, classTile, wkbNone);
+    addField(classLayer, "CNAM", OFTString, 32);
+    addField(classLayer, "FACC", OFTString, 5);
+    addField(classLayer, "FSC", OFTInteger, 3);
+    addField(classLayer, "MODL", OFTString, 32);
+    for (size_t i = 0; i < std::min(instanceCount, models.size()); ++i) {
+        OGRFeature *feature = OGRFeature::CreateFeature(classLayer->GetLayerDefn());
+        feature->SetField("CNAM", getCNAM(i).c_str());
+        feature->SetField("FACC", models[i].FACC.c_str());
+        feature->SetField("FSC", models[i].FSC);
+        feature->SetField("MODL", models[i].MODL.c_str());
+        classLayer->CreateFeature(feature);
+        OGRFeature::DestroyFeature(feature);
+    }
+}
+
+void writeGSModelArchives(const CDBGeoCell &geoCell,
+                          const ModelTemplates &templates,
+                          const std::filesystem::path &outputPath)
+{
+    // GSModel entries are prefixed by the name of their tile, and found by FACC, FSC and MODL like GTModels
+    CDBTile geometryTile(geoCell, CDBDataset::GSModelGeometry, 1, 1, 0, 0, 0);
+    std::vector<std::pair<std::string, std::filesystem::path>> geometryEntries;
+    for (const auto &model : templates.models) {
+        geometryEntries.emplace_back(geometryTile.getFilename() + "_" + model.FACC + "_"
+                                         + toStringWithZeroPadding(3, model.FSC) + "_" + model.MODL + ".flt",
+                                     model.path);
+    }
+
+    writeZip(createTilePath(geometryTile, outputPath, ".zip"), geometryEntries);
+
+    if (!templates.textures.empty()) {
+        CDBTile textureTile(geoCell, CDBDataset::GSModelTexture, 1, 1, 0, 0, 0);
+        std::vector<std::pair<std::string, std::filesystem::path>> textureEntries;
+        for (const auto &texture : templates.textures) {
+            std::string entry = textureTile.getFilename() + "_" + texture.filename().string();
+            textureEntries.emplace_back(entry, texture);
+        }
+
+        writeZip(createTilePath(textureTile, outputPath, ".zip"), textureEntries);
+    }
+}
+
+void writeZip(const std::filesystem::path &zipPath,
+              const std::vector<std::pair<std::string, std::filesystem::path>> &entries)
+{
+    void *zip = CPLCreateZip(zipPath.string().c_str(), nullptr);
+    if (!zip) {
+        throw std::runtime_error("Cannot create " + zipPath.string());
+    }
+
+    bool isWritten = true;
+    for (const auto &entry : entries) {
+        std::ifstream fs(entry.second, std::ios::binary);
+        std::vector<char> content((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+        isWritten = isWritten && CPLCreateFileInZip(zip, entry.first.c_str(), nullptr) == CE_None
+                    && CPLWriteFileInZip(zip, content.data(), static_cast<int>(content.size())) == CE_None
+                    && CPLCloseFileInZip(zip) == CE_None;
+    }
+
+    if (CPLCloseZip(zip) != CE_None || !isWritten) {
+        throw std::runtime_error("Cannot write " + zipPath.string());
+    }
+}
+
+double getHeight(double longitude, double latitude)
+{
+    // hills a few kilometers wide over a slope, in meters
+    double hills = 250.0 * std::sin(longitude * 37.0) * std::cos(latitude * 29.0);
+    double ridges = 60.0 * std::sin(longitude * 311.0 + latitude * 173.0);
+    return 400.0 + hills + ridges + 100.0 * (latitude - std::floor(latitude));
+}
+
+size_t getLevelTileSize(size_t tileSize, int level)
+{
+    if (level >= 0) {
+        return tileSize;
+    }
+
+    return std::max<size_t>(tileSize >> static_cast<size_t>(-level), 1);
+}
+
+std::filesystem::path createTilePath(const CDBTile &tile,
+                                     const std::filesystem::path &outputPath,
+                                     const std::string &extension)
+{
+    auto path = outputPath / (tile.getRelativePath().string() + extension);
+    std::filesystem::create_directories(path.parent_path());
+    return path;
+}
+
+GDALDriver *getDriver(const char *name)
+{
+    GDALDriver *driver = GetGDALDriverManager()->GetDriverByName(name);
+    if (!driver) {
+        throw std::runtime_error(std::string("GDAL ") + name + " driver is not registered");
+    }
+
+    return driver;
+}
+
+GDALDatasetUniquePtr createShapefile(const std::filesystem::path &file)
+{
+    // a .dbf file gets the attribute table only, which is how CDB stores the class attributes
+    GDALDatasetUniquePtr dataset(
+        getDriver("ESRI Shapefile")->Create(file.string().c_str(), 0, 0, 0, GDT_Unknown, nullptr));
+    if (!dataset) {
+        throw std::runtime_error("Cannot create " + file.string());
+    }
+
+    return dataset;
+}
+
+OGRLayer *createLayer(GDALDataset &dataset, const CDBTile &tile, OGRwkbGeometryType geometryType)
+{
+    OGRLayer *layer = dataset.CreateLayer(tile.getFilename().c_str(), nullptr, geometryType, nullptr);
+    if (!layer) {
+        throw std::runtime_error("Cannot create the layer of " + tile.getFilename());
+    }
+
+    return layer;
+}
+
+void addField(OGRLayer *layer, const char *name, OGRFieldType type, int width)
+{
+    OGRFieldDefn field(name, type);
+    field.SetWidth(width);
+    if (type == OFTReal) {
+        field.SetPrecision(3);
+    }
+
+    layer->CreateField(&field);
+}
+
+unsigned char toByte(double value)
+{
+    return static_cast<unsigned char>(std::clamp(value, 0.0, 255.0));
+}
+} // namespace CDBTo3DTiles
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace CDBTo3DTiles {
+struct SyntheticCDBOptions
+{
+    // GeoCells are laid out eastward from N32W118, in rows of 8 GeoCells going north
+    size_t geoCellCount = 1;
+
+    // elevation, and imagery if any, are written for every level from -10 down to this one
+    int maxLevel = 0;
+
+    // width of the elevation and imagery tiles from level 0, halved at each negative level. CDB uses 1024
+    size_t tileSize = 1024;
+
+    bool imagery = true;
+
+    // lineal road features in the level 0 tile of each GeoCell
+    size_t roadFeatureCount = 0;
+
+    // point features in the level 0 tile of each GeoCell
+    size_t GTModelInstanceCount = 0;
+
+    size_t GSModelInstanceCount = 0;
+
+    // CDB whose GTModel geometries and textures are copied for the GTModel instances and packed into the
+    // GSModel archives
+    std::filesystem::path modelTemplatePath;
+
+    uint32_t seed = 1;
+
+    size_t threadCount = 1;
+};
+
+// writes a CDB of the given size with the layout and file formats of a real one: GeoTIFF elevation, JPEG 2000
+// imagery, shapefile features with their class attributes, GTModel geometries and zipped GSModels. Heights
+// are a function of the position, so neighbor tiles and levels agree
+void generateSyntheticCDB(const SyntheticCDBOptions &options, const std::filesystem::path &outputPath);
+} // namespace CDBTo3DTiles
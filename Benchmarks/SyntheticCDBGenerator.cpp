@@ -0,0 +1,76 @@
+#include "CDBTo3DTiles.h"
+#include "SyntheticCDB.h"
+#include "cxxopts.hpp"
+#include <iostream>
+#include <thread>
+
+int main(int argc, char **argv)
+{
+    cxxopts::Options options("SyntheticCDB", "Generate a CDB of any size to benchmark the conversion");
+
+    // clang-format off
+    options.add_options()
+        ("o, output",
+            "CDB directory to write",
+            cxxopts::value<std::string>())
+        ("geocells",
+            "Number of GeoCells, laid out eastward from N32W118 in rows of 8",
+            cxxopts::value<size_t>()->default_value("1"))
+        ("max-level",
+            "Deepest elevation and imagery level, from -10. Level n has 4^n tiles",
+            cxxopts::value<int>()->default_value("0"))
+        ("tile-size",
+            "Width of the elevation and imagery tiles from level 0, as a power of 2",
+            cxxopts::value<size_t>()->default_value("1024"))
+        ("imagery",
+            "Write imagery along the elevation",
+            cxxopts::value<bool>()->default_value("true"))
+        ("road-features",
+            "Road lines per GeoCell",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("gtmodel-instances",
+            "GTModel instances per GeoCell",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("gsmodel-instances",
+            "GSModel instances per GeoCell",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("model-template",
+            "CDB whose GTModel geometries and textures are used by the GTModel and GSModel instances",
+            cxxopts::value<std::string>()->default_value(TEST_DATA_DIR "/GTModels"))
+        ("seed",
+            "Seed of the feature and instance placement",
+            cxxopts::value<uint32_t>()->default_value("1"))
+        ("threads",
+            "Number of GeoCells written at the same time",
+            cxxopts::value<size_t>()->default_value(std::to_string(std::thread::hardware_concurrency())))
+        ("h, help", "Print usage");
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("output")) {
+        std::cout << options.help() << "\n";
+        return 0;
+    }
+
+    try {
+        CDBTo3DTiles::SyntheticCDBOptions CDBOptions;
+        CDBOptions.geoCellCount = result["geocells"].as<size_t>();
+        CDBOptions.maxLevel = result["max-level"].as<int>();
+        CDBOptions.tileSize = result["tile-size"].as<size_t>();
+        CDBOptions.imagery = result["imagery"].as<bool>();
+        CDBOptions.roadFeatureCount = result["road-features"].as<size_t>();
+        CDBOptions.GTModelInstanceCount = result["gtmodel-instances"].as<size_t>();
+        CDBOptions.GSModelInstanceCount = result["gsmodel-instances"].as<size_t>();
+        CDBOptions.modelTemplatePath = result["model-template"].as<std::string>();
+        CDBOptions.seed = result["seed"].as<uint32_t>();
+        CDBOptions.threadCount = result["threads"].as<size_t>();
+
+        CDBTo3DTiles::GlobalInitializer initializer;
+        CDBTo3DTiles::generateSyntheticCDB(CDBOptions, result["output"].as<std::string>());
+    } catch (const std::exception &e) {
+        std::cout << "An error has occured: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "BenchmarkUtility.h"
+#include "CDBElevation.h"
+#include "Gltf.h"
+#include "TileFormatIO.h"
+#include "catch2/catch.hpp"
+#include <numeric>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Benchmark glTF and b3dm of a large mesh", "[TileFormatIO]")
+{
+    auto elevation = CDBElevation::createFromGrid(createSyntheticElevationGrid(1024));
+    const Mesh &mesh = elevation->getUniformGridMesh();
+
+    GltfEncoding quantized;
+    quantized.quantizeAttributes = true;
+
+    BENCHMARK("createGltf 1024x1024 grid")
+    {
+        std::vector<GltfBufferSegment> bufferSegments;
+        return createGltf(mesh, nullptr, nullptr, &bufferSegments);
+    };
+
+    BENCHMARK("createGltf quantized 1024x1024 grid")
+    {
+        std::vector<GltfBufferSegment> bufferSegments;
+        return createGltf(mesh, nullptr, nullptr, &bufferSegments, quantized);
+    };
+
+    BENCHMARK("createB3DM and writeToB3DM 1024x1024 grid")
+    {
+        std::vector<GltfBufferSegment> bufferSegments;
+        tinygltf::Model gltf = createGltf(mesh, nullptr, nullptr, &bufferSegments);
+        B3DM b3dm = createB3DM(&gltf, bufferSegments, nullptr);
+        NullOutputStream stream;
+        return writeToB3DM(b3dm, stream);
+    };
+
+    reportAllocations("createB3DM and writeToB3DM 1024x1024 grid", [&]() {
+        std::vector<GltfBufferSegment> bufferSegments;
+        tinygltf::Model gltf = createGltf(mesh, nullptr, nullptr, &bufferSegments);
+        B3DM b3dm = createB3DM(&gltf, bufferSegments, nullptr);
+        NullOutputStream stream;
+        writeToB3DM(b3dm, stream);
+    });
+}
+
+TEST_CASE("Benchmark i3dm of many instances", "[TileFormatIO]")
+{
+    CDBModelsAttributes modelsAttributes = createSyntheticModelsAttributes(100000);
+    std::vector<int> attribIndices(modelsAttributes.getInstancesAttributes().getInstancesCount());
+    std::iota(attribIndices.begin(), attribIndices.end(), 0);
+
+    BENCHMARK("createI3DM and writeToI3DM 100000 instances")
+    {
+        I3DM i3dm = createI3DM("Gltf/Model_0.glb", modelsAttributes, attribIndices);
+        NullOutputStream stream;
+        return writeToI3DM(i3dm, stream);
+    };
+
+    reportAllocations("createI3DM and writeToI3DM 100000 instances", [&]() {
+        I3DM i3dm = createI3DM("Gltf/Model_0.glb", modelsAttributes, attribIndices);
+        NullOutputStream stream;
+        writeToI3DM(i3dm, stream);
+    });
+}
+
+TEST_CASE("Benchmark tileset.json of a deep tileset", "[TileFormatIO]")
+{
+    CDBTileset tileset = createSyntheticTileset(7);
+    std::filesystem::path tilesetDirectory = std::filesystem::temp_directory_path() / "CDBTo3DTilesBenchmark";
+    std::filesystem::create_directories(tilesetDirectory);
+    std::filesystem::path tilesetPath = tilesetDirectory / "tileset.json";
+
+    BENCHMARK("writeToTilesetJson down to level 7")
+    {
+        std::ofstream fs(tilesetPath);
+        writeToTilesetJson(tileset, true, fs);
+        return fs.tellp();
+    };
+
+    BENCHMARK("writeToTilesetJson down to level 7 in external tilesets of 3 levels")
+    {
+        std::ofstream fs(tilesetPath);
+        writeToTilesetJson(tileset, true, 3, tilesetDirectory, fs);
+        return fs.tellp();
+    };
+
+    reportAllocations("writeToTilesetJson down to level 7", [&]() {
+        std::ofstream fs(tilesetPath);
+        writeToTilesetJson(tileset, true, fs);
+    });
+
+    std::filesystem::remove_all(tilesetDirectory);
+}
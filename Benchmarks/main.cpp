@@ -0,0 +1,39 @@
+#define CATCH_CONFIG_RUNNER
+#include "BenchmarkUtility.h"
+#include "CDBTo3DTiles.h"
+#include "catch2/catch.hpp"
+#include <cstdlib>
+#include <new>
+
+using namespace CDBTo3DTiles;
+
+// every allocation of the executable goes through here, so the benchmarks can report what they allocate
+void *operator new(size_t size)
+{
+    recordAllocation(size);
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+int main(int argc, char *argv[])
+{
+    GlobalInitializer initializer;
+
+    int result = Catch::Session().run(argc, argv);
+
+    return result;
+}
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -14,6 +18,30 @@ public:
     ~GlobalInitializer() noexcept;
 };
 
+// the source tiles converted out of the ones listed in the CDB, reported while a conversion runs. Tiles are
+// the elevation rasters and the vector and model feature files of each GeoCell
+struct ConversionProgress
+{
+    struct Dataset
+    {
+        std::string name;
+        uint64_t tilesDone = 0;
+        uint64_t tilesTotal = 0;
+    };
+
+    std::vector<Dataset> datasets;
+    uint64_t tilesDone = 0;
+    uint64_t tilesTotal = 0;
+    uint64_t geoCellsDone = 0;
+    uint64_t geoCellsTotal = 0;
+    uint64_t bytesWritten = 0;
+    double elapsedSeconds = 0.0;
+    double secondsSinceLastTile = 0.0;
+
+    // extrapolated from the tiles converted so far, so it is unknown until the first one is done
+    std::optional<double> remainingSeconds;
+};
+
 class Converter
 {
 public:
@@ -31,6 +59,114 @@ public:
 
     void setElevationThresholdIndices(float elevationThresholdIndices);
 
+    void setVectorLOD(bool vectorLOD);
+
+    void setImplicitTiling(bool implicitTiling);
+
+    void setExternalTilesetLevels(unsigned levels);
+
+    void setThreadCount(size_t threadCount);
+
+    void setGTModelCacheMemory(size_t bytes);
+
+    void setElevationGridCacheMemory(size_t bytes);
+
+    void setImageryEncodingMemory(size_t bytes);
+
+    // the block cache of GDAL, holding the decoded blocks of the open rasters. 0 keeps the GDAL default, or a
+    // share of the memory budget when there is one
+    void setGDALCacheMemory(size_t bytes);
+
+    // threads decoding each JP2 imagery, on top of the conversion threads. 0 keeps the GDAL default
+    void setGDALThreadCount(size_t threadCount);
+
+    // elevation and imagery rasters kept open once read, so that reading a tile again skips parsing its header.
+    // 0 closes each raster once read
+    void setGDALDatasetPoolSize(size_t datasetCount);
+
+    // vector and model tiles read by the conversion threads ahead of the one being converted, so their files
+    // are read while the previous tiles are converted. 0 reads each tile once the previous one is converted
+    void setReadAheadDepth(size_t tileCount);
+
+    // keeps the resident memory under the budget by converting fewer GeoCells at once when it is reached, and
+    // bounds the caches to a share of it. 0 has no budget
+    void setMaxMemory(size_t bytes);
+
+    // hands the written files over to this many writer threads, which write them in batches through io_uring
+    // when it is available. 0 writes each file on the thread converting it
+    void setOutputThreadCount(size_t threadCount);
+
+    // bounds the files queued for the writer threads, past which the conversion waits for them. 0 has no limit
+    void setOutputQueueMemory(size_t bytes);
+
+    // directory writes every file on its own. 3tz appends the files of each GeoCell to a 3D Tiles archive next
+    // to its directory, e.g. Tiles/N32/W118.3tz for Tiles/N32/W118, while the combined tilesets stay files
+    void setOutputFormat(const std::string &outputFormat);
+
+    // writes the model glTFs and textures once per distinct content to the Content directory of the output,
+    // named after their xxHash, and references them from every tile using them. Not supported by 3tz output
+    void setDeduplicateContent(bool deduplicateContent);
+
+    void setTextureAtlasSize(unsigned size);
+
+    void setGTModelBaking(size_t maxInstances, size_t maxTriangles);
+
+    void setIncremental(bool incremental);
+
+    void setOptimizeMeshes(bool optimizeMeshes);
+
+    void setQuantizeVertexAttributes(bool quantizeVertexAttributes);
+
+    void setMeshoptCompression(bool meshoptCompression);
+
+    void setDracoCompression(bool dracoCompression);
+
+    void setDracoQuantizationBits(int positionBits, int normalBits, int UVBits);
+
+    void setTextureCompression(const std::string &textureCompression);
+
+    void setManifestPath(const std::filesystem::path &manifestPath);
+
+    // records the time spent in each conversion phase, with the tiles and bytes of each GeoCell and dataset
+    void setCollectStats(bool collectStats);
+
+    // records the jobs and phases of every thread in a Chrome trace file for chrome://tracing or Perfetto
+    void setTracePath(const std::filesystem::path &tracePath);
+
+    // calls back with the progress of the conversion every interval from a thread of its own, and once more
+    // when the conversion is done
+    void setProgressCallback(std::function<void(const ConversionProgress &)> callback,
+                             double intervalSeconds = 1.0);
+
+    // only converts the GeoCells and tiles that intersect the box, in degrees. The west may be east of the east
+    // for a box crossing the antimeridian
+    void setBoundingBox(double west, double south, double east, double north);
+
+    // only converts the GeoCells of the list, named like N32W118
+    void setGeoCells(const std::vector<std::string> &geoCells);
+
+    // only converts these datasets, named like their output directories: Elevation, RoadNetwork,
+    // RailRoadNetwork, PowerlineNetwork, HydrographyNetwork, GTModels and GSModels. Empty converts every one
+    void setDatasets(const std::vector<std::string> &datasets);
+
+    // only converts the tiles from the minimum to the maximum level, from -10 to 23. No level deeper than the
+    // maximum one is generated from the elevation and imagery of its parents
+    void setLevelRange(int minLevel, int maxLevel);
+
+    // only converts the GeoCells of the list, named like N32W118. The conversion writes a shard manifest of
+    // the tilesets of its GeoCells instead of the combined tilesets, which merge writes from every shard
+    void setShardGeoCells(const std::vector<std::string> &geoCells);
+
+    // only converts the GeoCells whose name hashes to the index modulo the count, e.g. one index per node of
+    // a cluster. With a GeoCell list, only its GeoCells are spread. A count of 0 converts every GeoCell
+    void setShard(size_t index, size_t count);
+
+    // writes the combined tilesets out of the shard manifests found in the output directory
+    void merge();
+
+    // writes the stats of the last conversion as JSON
+    void writeStats(std::ostream &os) const;
+
     void convert();
 
 private:
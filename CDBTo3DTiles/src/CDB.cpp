@@ -1,5 +1,8 @@
 #include "CDB.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <string.h>
 #include <unordered_set>
 #include <utility>
@@ -11,182 +14,254 @@ const std::filesystem::path CDB::TILES = "Tiles";
 const std::filesystem::path CDB::METADATA = "Metadata";
 const std::filesystem::path CDB::GTModel = "GTModel";
 
-CDB::CDB(const std::filesystem::path &path)
-    : m_path{path}
+// datasets read when a GeoCell is converted, including the GSModel archives and class attributes
+static const CDBDataset GEOCELL_SOURCE_DATASETS[] = {CDBDataset::Elevation,
+                                                     CDBDataset::Imagery,
+                                                     CDBDataset::GSFeature,
+                                                     CDBDataset::GTFeature,
+                                                     CDBDataset::RoadNetwork,
+                                                     CDBDataset::RailRoadNetwork,
+                                                     CDBDataset::PowerlineNetwork,
+                                                     CDBDataset::HydrographyNetwork,
+                                                     CDBDataset::GSModelGeometry,
+                                                     CDBDataset::GSModelTexture};
+
+// FNV-1a, so that fingerprints stay the same between builds and can be stored
+static void fingerprintCombine(uint64_t &fingerprint, const void *data, size_t size)
 {
-    m_GTModelCache = CDBGTModelCache(path);
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        fingerprint ^= bytes[i];
+        fingerprint *= 0x100000001b3ull;
+    }
+}
+
+static FileStatus fingerprintFile(uint64_t &fingerprint,
+                                  const std::filesystem::path &CDBPath,
+                                  const std::filesystem::path &relativePath)
+{
+    // stat the file again instead of trusting the manifest, since a rewritten file keeps its directory mtime
+    auto status = getFileStatus(CDBPath / relativePath);
+    uint64_t size = status ? status->size : 0;
+    int64_t lastWriteTime = status ? status->lastWriteTime : 0;
+
+    std::string relativePathString = relativePath.generic_string();
+    fingerprintCombine(fingerprint, relativePathString.data(), relativePathString.size() + 1);
+    fingerprintCombine(fingerprint, &size, sizeof(size));
+    fingerprintCombine(fingerprint, &lastWriteTime, sizeof(lastWriteTime));
+    return FileStatus{false, size, lastWriteTime};
+}
+
+CDB::CDB(const std::filesystem::path &path,
+         std::shared_ptr<CDBManifest> manifest,
+         std::shared_ptr<CDBGTModelCache> GTModelCache,
+         size_t elevationGridCacheMemory,
+         std::shared_ptr<ConversionStats> stats,
+         std::shared_ptr<ConversionProgressTracker> progress,
+         std::shared_ptr<GDALDatasetPool> datasetPool)
+    : m_manifest{std::move(manifest)}
+    , m_GTModelCache{std::move(GTModelCache)}
+    , m_datasetPool{std::move(datasetPool)}
+    , m_elevationGridCache{elevationGridCacheMemory, m_datasetPool.get()}
+    , m_stats{std::move(stats)}
+    , m_progress{std::move(progress)}
+    , m_minLevel{std::numeric_limits<int>::min()}
+    , m_maxLevel{std::numeric_limits<int>::max()}
+    , m_readAheadDepth{0}
+    , m_path{path}
+{
+    if (!m_manifest) {
+        m_manifest = std::make_shared<CDBManifest>(path);
+    }
+
+    if (!m_GTModelCache) {
+        m_GTModelCache = std::make_shared<CDBGTModelCache>(path, m_manifest);
+    }
+}
+
+void CDB::setAreaOfInterest(const Core::GlobeRectangle &areaOfInterest)
+{
+    m_areaOfInterest = areaOfInterest;
+}
+
+bool CDB::isInAreaOfInterest(const CDBGeoCell &geoCell) const
+{
+    if (!m_areaOfInterest) {
+        return true;
+    }
+
+    return CDBTile::calcBoundRegion(geoCell, -10, 0, 0).getRectangle().intersects(*m_areaOfInterest);
+}
+
+void CDB::setLevelRange(int minLevel, int maxLevel)
+{
+    m_minLevel = minLevel;
+    m_maxLevel = maxLevel;
+}
+
+void CDB::setReadAheadDepth(size_t tileCount)
+{
+    m_readAheadDepth = tileCount;
+}
+
+void CDB::shrinkCaches()
+{
+    m_elevationGridCache.shrink();
+    if (m_GTModelCache) {
+        m_GTModelCache->shrink();
+    }
+}
+
+bool CDB::isTileFileSelected(const std::filesystem::path &tileFile) const
+{
+    // files that are not named after a tile are kept, their tile file decides whether they are read
+    auto tile = CDBTile::createFromFile(tileFile.stem().string());
+    if (!tile) {
+        return true;
+    }
+
+    if (tile->getLevel() < m_minLevel || tile->getLevel() > m_maxLevel) {
+        return false;
+    }
+
+    return !m_areaOfInterest || tile->getBoundRegion().getRectangle().intersects(*m_areaOfInterest);
 }
 
-void CDB::forEachGeoCell(std::function<void(CDBGeoCell)> process)
+std::vector<CDBGeoCell> CDB::getGeoCells() const
 {
     std::filesystem::path tilesPath = m_path / TILES;
 
-    if (!std::filesystem::exists(tilesPath) || !std::filesystem::is_directory(tilesPath)) {
+    auto tilesStatus = getFileStatus(tilesPath);
+    if (!tilesStatus || !tilesStatus->isDirectory) {
         throw std::runtime_error(tilesPath.string() + " directory does not exist");
     }
 
-    for (std::filesystem::directory_entry geoCellLatDir : std::filesystem::directory_iterator(tilesPath)) {
-        auto geoCellLatitude = CDBGeoCell::parseLatFromFilename(geoCellLatDir.path().filename().string());
+    // GeoCells are the longitude directories two levels below Tiles
+    std::vector<CDBGeoCell> geoCells;
+    for (const auto &geoCellLongDir : m_manifest->getIndex(TILES, 2)->getFiles()) {
+        std::filesystem::path geoCellPath = geoCellLongDir.relativePath;
+        auto geoCellLatitude = CDBGeoCell::parseLatFromFilename(
+            geoCellPath.parent_path().filename().string());
         if (!geoCellLatitude) {
             continue;
         }
 
-        for (std::filesystem::directory_entry geoCellLongDir :
-             std::filesystem::directory_iterator(geoCellLatDir)) {
-            auto geoCellLongitude = CDBGeoCell::parseLongFromFilename(
-                geoCellLongDir.path().filename().string());
-            if (!geoCellLongitude) {
-                continue;
-            }
+        auto geoCellLongitude = CDBGeoCell::parseLongFromFilename(geoCellPath.filename().string());
+        if (!geoCellLongitude) {
+            continue;
+        }
 
-            process(CDBGeoCell(*geoCellLatitude, *geoCellLongitude));
+        CDBGeoCell geoCell(*geoCellLatitude, *geoCellLongitude);
+        if (isInAreaOfInterest(geoCell)) {
+            geoCells.emplace_back(geoCell);
         }
     }
-}
 
-void CDB::forEachElevationTile(const CDBGeoCell &geoCell, std::function<void(CDBElevation)> process)
-{
-    forEachDatasetTile(geoCell, CDBDataset::Elevation, [&](const std::filesystem::path &elevationTilePath) {
-        std::optional<CDBElevation> elevation = CDBElevation::createFromFile(elevationTilePath);
-        if (elevation) {
-            process(std::move(*elevation));
-        }
-    });
+    return geoCells;
 }
 
-void CDB::forEachGTModelTile(const CDBGeoCell &geoCell, std::function<void(CDBGTModels)> process)
+std::vector<CDBTileFile> CDB::getTileFiles(const CDBGeoCell &geoCell, CDBDataset dataset) const
 {
+    ScopedPhaseTimer discoveryTimer(m_stats.get(), geoCell, dataset, ConversionPhase::FileDiscovery);
+    auto index = getDatasetIndex(geoCell, dataset);
+    discoveryTimer.stop();
+
+    bool isModelDataset = dataset == CDBDataset::GTFeature || dataset == CDBDataset::GSFeature;
+    std::vector<CDBTileFile> tileFiles;
     std::unordered_map<size_t, CDBTileset> tilesets;
-    forEachDatasetTile(geoCell, CDBDataset::GTFeature, [&](const std::filesystem::path &GTFeaturePath) {
-        if (GTFeaturePath.extension() != ".dbf") {
-            return;
+    for (const auto &file : index->getFiles()) {
+        if (!isTileFileSelected(file.relativePath)) {
+            continue;
         }
 
-        auto tile = CDBTile::createFromFile(GTFeaturePath.stem().string());
-        if (!tile) {
-            return;
+        if (m_stats) {
+            m_stats->addBytesIn(geoCell, dataset, file.size);
         }
 
-        // we only supports point features for now
-        if (tile->getCS_2() == static_cast<int>(CDBVectorCS2::PointFeature)) {
-            tile->setCustomContentURI(GTFeaturePath);
-
-            size_t CSHash = 0;
-            hashCombine(CSHash, tile->getCS_1());
-            hashCombine(CSHash, tile->getCS_2());
-            tilesets[CSHash].insertTile(*tile);
+        auto path = m_path / file.relativePath;
+        if (!isModelDataset) {
+            tileFiles.emplace_back(CDBTileFile{geoCell, dataset, std::move(path), true});
+            continue;
         }
-    });
 
-    for (const auto &tileset : tilesets) {
-        traverseModelsAttributes(tileset.second.getRoot(),
-                                 nullptr,
-                                 nullptr,
-                                 [&](CDBModelsAttributes modelsAttributes) {
-                                     auto models = CDBGTModels::createFromModelsAttributes(modelsAttributes,
-                                                                                           &*m_GTModelCache);
-                                     if (models) {
-                                         process(std::move(*models));
-                                     }
-                                 });
-    }
-}
-
-void CDB::forEachGSModelTile(const CDBGeoCell &geoCell, std::function<void(CDBGSModels)> process)
-{
-    std::unordered_map<size_t, CDBTileset> tilesets;
-    forEachDatasetTile(geoCell, CDBDataset::GSFeature, [&](const std::filesystem::path &GSFeaturePath) {
-        if (GSFeaturePath.extension() != ".dbf") {
-            return;
+        if (path.extension() != ".dbf") {
+            continue;
         }
 
-        auto tile = CDBTile::createFromFile(GSFeaturePath.stem().string());
+        // the feature files that are not listed below are done as soon as they are found
+        auto tile = CDBTile::createFromFile(path.stem().string());
         if (!tile) {
-            return;
+            reportTileDone(dataset, path);
+            continue;
         }
 
         // we only supports point features for now
         if (tile->getCS_2() == static_cast<int>(CDBVectorCS2::PointFeature)) {
-            tile->setCustomContentURI(GSFeaturePath);
+            tile->setCustomContentURI(path);
 
             size_t CSHash = 0;
             hashCombine(CSHash, tile->getCS_1());
             hashCombine(CSHash, tile->getCS_2());
             tilesets[CSHash].insertTile(*tile);
+        } else {
+            reportTileDone(dataset, path);
         }
-    });
+    }
 
     for (const auto &tileset : tilesets) {
-        traverseModelsAttributes(tileset.second.getRoot(),
-                                 nullptr,
-                                 nullptr,
-                                 [&](CDBModelsAttributes modelAttribute) {
-                                     auto models = CDBGSModels::createFromModelsAttributes(modelAttribute,
-                                                                                           m_path);
-                                     if (models) {
-                                         process(std::move(*models));
-                                     }
-                                 });
-    }
-}
-
-void CDB::forEachRoadNetworkTile(const CDBGeoCell &geoCell, std::function<void(CDBGeometryVectors)> process)
-{
-    forEachDatasetTile(geoCell, CDBDataset::RoadNetwork, [&](const std::filesystem::path &roadNetworkTilePath) {
-        std::optional<CDBGeometryVectors> roadNetwork = CDBGeometryVectors::createFromFile(roadNetworkTilePath,
-                                                                                           m_path);
-        if (roadNetwork) {
-            process(std::move(*roadNetwork));
-        }
-    });
+        addModelTileFiles(tileset.second.getRoot(), geoCell, dataset, tileFiles);
+    }
+
+    return tileFiles;
+}
+
+std::optional<CDBElevation> CDB::readElevationTile(const CDBTileFile &tileFile)
+{
+    ScopedPhaseTimer decodeTimer(m_stats.get(), tileFile.geoCell, tileFile.dataset, ConversionPhase::Decode);
+    return CDBElevation::createFromFile(tileFile.path, &m_elevationGridCache);
+}
+
+std::optional<CDBGeometryVectors> CDB::readGeometryVectorsTile(const CDBTileFile &tileFile,
+                                                               ThreadPool *threadPool)
+{
+    ScopedPhaseTimer decodeTimer(m_stats.get(), tileFile.geoCell, tileFile.dataset, ConversionPhase::Decode);
+    return CDBGeometryVectors::createFromFile(tileFile.path, m_path, threadPool, &m_classesAttributesCache);
 }
 
-void CDB::forEachRailRoadNetworkTile(const CDBGeoCell &geoCell,
-                                     std::function<void(CDBGeometryVectors)> process)
+std::optional<CDBGTModels> CDB::readGTModelTile(const CDBTileFile &tileFile)
 {
-    forEachDatasetTile(geoCell,
-                       CDBDataset::RailRoadNetwork,
-                       [&](const std::filesystem::path &railRoadNetworkTilePath) {
-                           std::optional<CDBGeometryVectors> railRoadNetwork
-                               = CDBGeometryVectors::createFromFile(railRoadNetworkTilePath, m_path);
-                           if (railRoadNetwork) {
-                               process(std::move(*railRoadNetwork));
-                           }
-                       });
+    auto modelsAttributes = readModelsAttributes(tileFile);
+    if (!modelsAttributes) {
+        return std::nullopt;
+    }
+
+    ScopedPhaseTimer decodeTimer(m_stats.get(), tileFile.geoCell, tileFile.dataset, ConversionPhase::Decode);
+    return CDBGTModels::createFromModelsAttributes(std::move(*modelsAttributes), m_GTModelCache.get());
 }
 
-void CDB::forEachPowerlineNetworkTile(const CDBGeoCell &geoCell,
-                                      std::function<void(CDBGeometryVectors)> process)
+std::optional<CDBGSModels> CDB::readGSModelTile(const CDBTileFile &tileFile,
+                                                CDBGSModelArchiveCache &archives,
+                                                ThreadPool *threadPool)
 {
-    forEachDatasetTile(geoCell,
-                       CDBDataset::PowerlineNetwork,
-                       [&](const std::filesystem::path &powerlineNetworkTilePath) {
-                           std::optional<CDBGeometryVectors> powerlineNetwork
-                               = CDBGeometryVectors::createFromFile(powerlineNetworkTilePath, m_path);
-                           if (powerlineNetwork) {
-                               process(std::move(*powerlineNetwork));
-                           }
-                       });
+    auto modelsAttributes = readModelsAttributes(tileFile);
+    if (!modelsAttributes) {
+        return std::nullopt;
+    }
+
+    ScopedPhaseTimer decodeTimer(m_stats.get(), tileFile.geoCell, tileFile.dataset, ConversionPhase::Decode);
+    return CDBGSModels::createFromModelsAttributes(
+        std::move(*modelsAttributes), m_path, &archives, threadPool);
 }
 
-void CDB::forEachHydrographyNetworkTile(const CDBGeoCell &geoCell,
-                                        std::function<void(CDBGeometryVectors)> process)
+void CDB::reportTileDone(const CDBTileFile &tileFile) const
 {
-    forEachDatasetTile(geoCell,
-                       CDBDataset::HydrographyNetwork,
-                       [&](const std::filesystem::path &hydrographyNetworkTilePath) {
-                           std::optional<CDBGeometryVectors> hydrographyNetwork
-                               = CDBGeometryVectors::createFromFile(hydrographyNetworkTilePath, m_path);
-                           if (hydrographyNetwork) {
-                               process(std::move(*hydrographyNetwork));
-                           }
-                       });
+    reportTileDone(tileFile.dataset, tileFile.path);
 }
 
-void CDB::traverseModelsAttributes(const CDBTile *root,
-                                   const CDBTile *oldElevationTile,
-                                   GDALDataset *oldElevationDataset,
-                                   std::function<void(CDBModelsAttributes)> process)
+void CDB::addModelTileFiles(const CDBTile *root,
+                            const CDBGeoCell &geoCell,
+                            CDBDataset dataset,
+                            std::vector<CDBTileFile> &tileFiles) const
 {
     if (root == nullptr) {
         return;
@@ -194,86 +269,68 @@ void CDB::traverseModelsAttributes(const CDBTile *root,
 
     const auto &featureFile = root->getCustomContentURI();
     if (featureFile) {
-        GDALDatasetUniquePtr attributesDataset = GDALDatasetUniquePtr(
-            (GDALDataset *) GDALOpenEx(featureFile->c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
-
-        if (attributesDataset) {
-            CDBModelsAttributes model(std::move(attributesDataset), *root, m_path);
-            if (model.getInstancesAttributes().getInstancesCount() > 0) {
-                CDBTile currentElevation = CDBTile(root->getGeoCell(),
-                                                   CDBDataset::Elevation,
-                                                   1,
-                                                   1,
-                                                   root->getLevel(),
-                                                   root->getUREF(),
-                                                   root->getRREF());
-
-                auto currentElevationPath = m_path / (currentElevation.getRelativePath().string() + ".tif");
-                if (!std::filesystem::exists(currentElevationPath)) {
-                    // reuse the previous read parent elevation if there is any
-                    if (oldElevationTile) {
-                        for (auto &point : model.getCartographicPositions()) {
-                            clampPointOnElevation(*oldElevationTile, *oldElevationDataset, point);
-                        }
-
-                        process(std::move(model));
-                        for (auto child : root->getChildren()) {
-                            traverseModelsAttributes(child, oldElevationTile, oldElevationDataset, process);
-                        }
-                    } else {
-                        // find the parent elevation to clamp on if no current elevation is found
-                        auto parentElevation = queryParentElevationTiles(currentElevation);
-                        GDALDatasetUniquePtr elevationData;
-                        if (parentElevation) {
-                            auto elevationFile = m_path
-                                                 / (parentElevation->getRelativePath().string() + ".tif");
-                            elevationData = GDALDatasetUniquePtr(
-                                (GDALDataset *) GDALOpen(elevationFile.c_str(), GDALAccess::GA_ReadOnly));
-
-                            if (elevationData) {
-                                for (auto &point : model.getCartographicPositions()) {
-                                    clampPointOnElevation(*parentElevation, *elevationData, point);
-                                }
-                            }
-                        }
-
-                        process(std::move(model));
-                        for (auto child : root->getChildren()) {
-                            if (parentElevation) {
-                                traverseModelsAttributes(child,
-                                                         &*parentElevation,
-                                                         elevationData.get(),
-                                                         process);
-                            } else {
-                                traverseModelsAttributes(child, nullptr, nullptr, process);
-                            }
-                        }
-                    }
-
-                    return;
-                }
+        tileFiles.emplace_back(CDBTileFile{geoCell, dataset, *featureFile, root->getChildren().empty()});
+    }
 
-                // find the highest possible elevation levels to clamp. Only do this for leaf since elevation
-                // can have higher levels than GTFeature. As GTFeature stops refine, terrain
-                // can continue refining due to higher LOD and completely cover low level GTFeature point, making the GTModel sink inside the terrain mesh.
-                // We don't need to do this for non-leaf since it will be replaced by higher level anyway due to
-                // replace refinement
-                CDBTileset underlyingElevations(root->getLevel(), root->getUREF(), root->getRREF());
-                if (root->getChildren().empty()) {
-                    queryElevationTiles(currentElevation, underlyingElevations);
-                } else {
-                    underlyingElevations.insertTile(currentElevation);
-                }
+    for (auto child : root->getChildren()) {
+        addModelTileFiles(child, geoCell, dataset, tileFiles);
+    }
+}
+
+std::optional<CDBModelsAttributes> CDB::readModelsAttributes(const CDBTileFile &tileFile)
+{
+    auto tile = CDBTile::createFromFile(tileFile.path.stem().string());
+    if (!tile) {
+        return std::nullopt;
+    }
+
+    tile->setCustomContentURI(tileFile.path);
 
-                clampPointsOnElevationTileset(model.getCartographicPositions(), underlyingElevations);
-                process(std::move(model));
+    ScopedPhaseTimer decodeTimer(m_stats.get(), tileFile.geoCell, tileFile.dataset, ConversionPhase::Decode);
+    GDALDatasetUniquePtr attributesDataset = GDALDatasetUniquePtr(
+        (GDALDataset *) GDALOpenEx(tileFile.path.c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
+    if (!attributesDataset) {
+        return std::nullopt;
+    }
+
+    CDBModelsAttributes model(std::move(attributesDataset), *tile, m_path, &m_classesAttributesCache);
+    decodeTimer.stop();
+    if (model.getInstancesAttributes().getInstancesCount() == 0) {
+        return std::nullopt;
+    }
+
+    CDBTile currentElevation = CDBTile(
+        tile->getGeoCell(), CDBDataset::Elevation, 1, 1, tile->getLevel(), tile->getUREF(), tile->getRREF());
+    if (!isElevationExist(currentElevation)) {
+        // find the parent elevation to clamp on if no current elevation is found. The grid of the parent
+        // elevation is kept by the elevation cache for the children of the tile that miss it too
+        auto parentElevation = queryParentElevationTiles(currentElevation);
+        if (parentElevation) {
+            auto elevationGrid = locateElevationGrid(*parentElevation);
+            if (elevationGrid) {
+                for (auto &point : model.getCartographicPositions()) {
+                    point.height = elevationGrid->sampleHeight(point);
+                }
             }
         }
+
+        return model;
     }
 
-    for (auto child : root->getChildren()) {
-        traverseModelsAttributes(child, nullptr, nullptr, process);
+    // find the highest possible elevation levels to clamp. Only do this for leaf since elevation
+    // can have higher levels than GTFeature. As GTFeature stops refine, terrain
+    // can continue refining due to higher LOD and completely cover low level GTFeature point, making the GTModel sink inside the terrain mesh.
+    // We don't need to do this for non-leaf since it will be replaced by higher level anyway due to
+    // replace refinement
+    CDBTileset underlyingElevations(tile->getLevel(), tile->getUREF(), tile->getRREF());
+    if (tileFile.isLeaf) {
+        queryElevationTiles(currentElevation, underlyingElevations);
+    } else {
+        underlyingElevations.insertTile(currentElevation);
     }
+
+    clampPointsOnElevationTileset(model.getCartographicPositions(), underlyingElevations);
+    return model;
 }
 
 void CDB::queryElevationTiles(const CDBTile &elevationTile, CDBTileset &underlyingElevations)
@@ -361,58 +418,85 @@ void CDB::clampPointsOnElevationTileset(std::vector<Core::Cartographic> &points,
             }
         }
 
+        // every elevation tile is decoded once and all of its points are sampled from the grid
         for (const auto &elevation : elevationToClamp) {
-            const auto &elevationTile = elevation.first;
-            auto elevationFile = m_path / (elevationTile.getRelativePath().string() + ".tif");
-            GDALDatasetUniquePtr rasterData = GDALDatasetUniquePtr(
-                (GDALDataset *) GDALOpen(elevationFile.c_str(), GDALAccess::GA_ReadOnly));
-
-            if (rasterData == nullptr) {
-                continue;
+            auto elevationGrid = locateElevationGrid(elevation.first);
+            if (elevationGrid) {
+                elevationGrid->clampPoints(points, elevation.second);
             }
+        }
+    }
+}
 
-            auto heightBand = rasterData->GetRasterBand(1);
-            auto rasterDataType = heightBand->GetRasterDataType();
-            if (rasterDataType != GDT_Float32 && rasterDataType != GDT_Float64) {
-                return;
-            }
+std::shared_ptr<const CDBElevationGrid> CDB::locateElevationGrid(const CDBTile &elevationTile)
+{
+    // grids decoded by the terrain conversion of this GeoCell are reused until they are evicted
+    auto elevationFile = m_path / (elevationTile.getRelativePath().string() + ".tif");
+    return m_elevationGridCache.locateGrid(elevationTile, elevationFile);
+}
 
-            for (auto i : elevation.second) {
-                clampPointOnElevation(elevationTile, *rasterData, points[i]);
-            }
+uint64_t CDB::getGeoCellFingerprint(const CDBGeoCell &geoCell) const
+{
+    uint64_t fingerprint = 0xcbf29ce484222325ull;
+    for (CDBDataset dataset : GEOCELL_SOURCE_DATASETS) {
+        // the files are stated here anyway, so a file rewritten since the manifest was written refreshes
+        // the index of its dataset
+        bool isIndexStale = false;
+        for (const auto &file : getDatasetIndex(geoCell, dataset)->getFiles()) {
+            auto status = fingerprintFile(fingerprint, m_path, file.relativePath);
+            isIndexStale |= status.size != file.size || status.lastWriteTime != file.lastWriteTime;
+        }
+
+        if (isIndexStale) {
+            m_manifest->refreshIndex(getDatasetIndexPath(geoCell, dataset), 3);
         }
     }
+
+    return fingerprint;
 }
 
-void CDB::clampPointOnElevation(const CDBTile &elevationTile,
-                                GDALDataset &elevationDataset,
-                                Core::Cartographic &point)
+uint64_t CDB::getDatasetTileCount(const CDBGeoCell &geoCell, CDBDataset dataset) const
 {
-    const Core::BoundingRegion &region = elevationTile.getBoundRegion();
-    const Core::GlobeRectangle &rectangle = region.getRectangle();
-    auto heightBand = elevationDataset.GetRasterBand(1);
-    double rectangleWidth = rectangle.computeWidth();
-    double rectangleHeight = rectangle.computeHeight();
-    int rasterXSize = heightBand->GetXSize();
-    int rasterYSize = heightBand->GetYSize();
-    double gapX = rectangleWidth / rasterXSize;
-    double gapY = rectangleHeight / rasterYSize;
+    const auto &files = getDatasetIndex(geoCell, dataset)->getFiles();
+    auto isTile = [&](const CDBDatasetIndex::File &file) {
+        return isDatasetTileFile(dataset, file.relativePath) && isTileFileSelected(file.relativePath);
+    };
+
+    return static_cast<uint64_t>(std::count_if(files.begin(), files.end(), isTile));
+}
 
-    int x = static_cast<int>(glm::floor((point.longitude - rectangle.getWest()) / gapX));
-    x = glm::min(x, rasterXSize - 1);
-    int y = static_cast<int>(glm::floor((point.latitude - rectangle.getSouth()) / gapY));
-    y = glm::min(rasterYSize - y - 1, rasterYSize - 1);
-    double height = 0.0;
-    if (GDALRasterIO(heightBand, GDALRWFlag::GF_Read, x, y, 1, 1, &height, 1, 1, GDALDataType::GDT_Float64, 0, 0)
-        != CE_None) {
-        height = 0.0;
+uint64_t CDB::getGTModelFingerprint() const
+{
+    uint64_t fingerprint = 0xcbf29ce484222325ull;
+    // directory order is unspecified, so sort the library to get the same fingerprint on every run
+    std::vector<std::filesystem::path> files;
+    std::vector<std::filesystem::path> directories{GTModel};
+    while (!directories.empty()) {
+        auto directory = std::move(directories.back());
+        directories.pop_back();
+        for (const auto &entry : listDirectory(m_path / directory)) {
+            if (entry.status.isDirectory) {
+                directories.emplace_back(directory / entry.name);
+            } else {
+                files.emplace_back(directory / entry.name);
+            }
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    for (const auto &file : files) {
+        fingerprintFile(fingerprint, m_path, file);
     }
 
-    point.height = height;
+    return fingerprint;
 }
 
 bool CDB::isElevationExist(const CDBTile &tile) const
 {
+    if (tile.getLevel() > m_maxLevel) {
+        return false;
+    }
+
     CDBTile elevationTile = CDBTile(tile.getGeoCell(),
                                     CDBDataset::Elevation,
                                     1,
@@ -421,12 +505,16 @@ bool CDB::isElevationExist(const CDBTile &tile) const
                                     tile.getUREF(),
                                     tile.getRREF());
 
-    auto elevationPath = m_path / (elevationTile.getRelativePath().string() + ".tif");
-    return std::filesystem::exists(elevationPath);
+    return getDatasetIndex(elevationTile.getGeoCell(), CDBDataset::Elevation)
+        ->isFileExist(elevationTile.getRelativePath().string() + ".tif");
 }
 
 bool CDB::isImageryExist(const CDBTile &tile) const
 {
+    if (tile.getLevel() > m_maxLevel) {
+        return false;
+    }
+
     CDBTile imageryTile = CDBTile(tile.getGeoCell(),
                                   CDBDataset::Imagery,
                                   1,
@@ -435,8 +523,8 @@ bool CDB::isImageryExist(const CDBTile &tile) const
                                   tile.getUREF(),
                                   tile.getRREF());
 
-    auto imagery = m_path / (imageryTile.getRelativePath().string() + ".jp2");
-    return std::filesystem::exists(imagery);
+    return getDatasetIndex(imageryTile.getGeoCell(), CDBDataset::Imagery)
+        ->isFileExist(imageryTile.getRelativePath().string() + ".jp2");
 }
 
 std::optional<CDBImagery> CDB::getImagery(const CDBTile &tile) const
@@ -449,13 +537,12 @@ std::optional<CDBImagery> CDB::getImagery(const CDBTile &tile) const
                                   tile.getUREF(),
                                   tile.getRREF());
 
-    auto imageryPath = m_path / (imageryTile.getRelativePath().string() + ".jp2");
-    if (!std::filesystem::exists(imageryPath)) {
+    if (!isImageryExist(imageryTile)) {
         return std::nullopt;
     }
 
-    auto imageryDataset = GDALDatasetUniquePtr(
-        (GDALDataset *) GDALOpen(imageryPath.c_str(), GDALAccess::GA_ReadOnly));
+    auto imageryPath = m_path / (imageryTile.getRelativePath().string() + ".jp2");
+    auto imageryDataset = openRasterDataset(imageryPath, m_datasetPool.get());
 
     if (!imageryDataset) {
         return std::nullopt;
@@ -464,29 +551,31 @@ std::optional<CDBImagery> CDB::getImagery(const CDBTile &tile) const
     return CDBImagery(std::move(imageryDataset), imageryTile);
 }
 
-void CDB::forEachDatasetTile(const CDBGeoCell &geoCell,
-                             CDBDataset dataset,
-                             std::function<void(const std::filesystem::path &)> process)
+void CDB::reportTileDone(CDBDataset dataset, const std::filesystem::path &file) const
 {
-    auto datasetPath = m_path / geoCell.getRelativePath() / getCDBDatasetDirectoryName(dataset);
-    if (!std::filesystem::exists(datasetPath) || !std::filesystem::is_directory(datasetPath)) {
-        return;
+    if (m_progress && isDatasetTileFile(dataset, file)) {
+        m_progress->addTileDone(dataset);
     }
+}
 
-    for (std::filesystem::directory_entry levelDir : std::filesystem::directory_iterator(datasetPath)) {
-        if (!std::filesystem::is_directory(levelDir)) {
-            continue;
-        }
+bool CDB::isDatasetTileFile(CDBDataset dataset, const std::filesystem::path &file)
+{
+    // elevation tiles are rasters, the vector and model tiles are read from their feature attributes
+    if (dataset == CDBDataset::Elevation) {
+        return file.extension() == ".tif";
+    }
 
-        for (std::filesystem::directory_entry UREFDir : std::filesystem::directory_iterator(levelDir)) {
-            if (!std::filesystem::is_directory(UREFDir)) {
-                continue;
-            }
+    return file.extension() == ".dbf";
+}
 
-            for (std::filesystem::directory_entry tilePath : std::filesystem::directory_iterator(UREFDir)) {
-                process(tilePath);
-            }
-        }
-    }
+std::filesystem::path CDB::getDatasetIndexPath(const CDBGeoCell &geoCell, CDBDataset dataset)
+{
+    return geoCell.getRelativePath() / getCDBDatasetDirectoryName(dataset);
+}
+
+std::shared_ptr<const CDBDatasetIndex> CDB::getDatasetIndex(const CDBGeoCell &geoCell,
+                                                            CDBDataset dataset) const
+{
+    return m_manifest->getIndex(getDatasetIndexPath(geoCell, dataset), 3);
 }
 } // namespace CDBTo3DTiles
@@ -1,41 +1,201 @@
 #pragma once
 
+#include "CDBDatasetIndex.h"
 #include "CDBElevation.h"
 #include "CDBGeometryVectors.h"
 #include "CDBImagery.h"
+#include "CDBManifest.h"
 #include "CDBModels.h"
+#include "ConversionProgress.h"
+#include "ConversionStats.h"
 #include "CDBTileset.h"
+#include "GDALDatasetPool.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <deque>
 #include <filesystem>
-#include <functional>
+#include <future>
+#include <memory>
 #include <optional>
-#include <stack>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace CDBTo3DTiles {
 
+// a tile file of a GeoCell dataset selected for conversion
+struct CDBTileFile
+{
+    CDBGeoCell geoCell;
+    CDBDataset dataset;
+    std::filesystem::path path;
+
+    // whether no model tile of the same component selectors refines this one. The instances of a leaf are
+    // clamped on the finest elevation under them, since the terrain can refine past the models
+    bool isLeaf;
+};
+
 class CDB
 {
 public:
-    explicit CDB(const std::filesystem::path &path);
+    explicit CDB(const std::filesystem::path &path,
+                 std::shared_ptr<CDBManifest> manifest = nullptr,
+                 std::shared_ptr<CDBGTModelCache> GTModelCache = nullptr,
+                 size_t elevationGridCacheMemory = 0,
+                 std::shared_ptr<ConversionStats> stats = nullptr,
+                 std::shared_ptr<ConversionProgressTracker> progress = nullptr,
+                 std::shared_ptr<GDALDatasetPool> datasetPool = nullptr);
+
+    // GeoCells and tiles outside of the area are skipped before any of their files is read
+    void setAreaOfInterest(const Core::GlobeRectangle &areaOfInterest);
+
+    // tile files outside of the levels are skipped, and the elevation and imagery deeper than the maximum
+    // level are considered missing so that no level is generated past it
+    void setLevelRange(int minLevel, int maxLevel);
+
+    // the tiles read by the thread pool ahead of the one being processed, for the forEach*Tile methods given
+    // a thread pool. 0 reads each tile once the previous one is processed
+    void setReadAheadDepth(size_t tileCount);
+
+    // drops the least recently used elevation grids and GTModels, to free memory while tiles are converted
+    void shrinkCaches();
+
+    bool isInAreaOfInterest(const CDBGeoCell &geoCell) const;
+
+    // whether the tile of the file is in the area of interest and the level range
+    bool isTileFileSelected(const std::filesystem::path &tileFile) const;
+
+    // the GeoCells in the area of interest. Throws if the CDB has no Tiles directory
+    std::vector<CDBGeoCell> getGeoCells() const;
+
+    // the selected tile files of a GeoCell dataset, in the order they are converted. The model tiles are
+    // listed with their parents before their children. Nothing is read until a file is passed to the read
+    // method of its dataset, so the tiles can be batched, read ahead or split between threads
+    std::vector<CDBTileFile> getTileFiles(const CDBGeoCell &geoCell, CDBDataset dataset) const;
+
+    std::optional<CDBElevation> readElevationTile(const CDBTileFile &tileFile);
+
+    // the polygons of the tile are triangulated with the thread pool, or sequentially without it
+    std::optional<CDBGeometryVectors> readGeometryVectorsTile(const CDBTileFile &tileFile,
+                                                              ThreadPool *threadPool = nullptr);
+
+    std::optional<CDBGTModels> readGTModelTile(const CDBTileFile &tileFile);
+
+    // the models of the tile are read with the thread pool, or sequentially without it
+    std::optional<CDBGSModels> readGSModelTile(const CDBTileFile &tileFile,
+                                               CDBGSModelArchiveCache &archives,
+                                               ThreadPool *threadPool = nullptr);
+
+    // counts the tile file in the progress once its tile is converted
+    void reportTileDone(const CDBTileFile &tileFile) const;
+
+    template<typename Process>
+    void forEachGeoCell(Process &&process)
+    {
+        for (const auto &geoCell : getGeoCells()) {
+            process(geoCell);
+        }
+    }
+
+    template<typename Process>
+    void forEachElevationTile(const CDBGeoCell &geoCell, Process &&process)
+    {
+        auto read = [this](const CDBTileFile &tileFile) { return readElevationTile(tileFile); };
+        processTileFiles(getTileFiles(geoCell, CDBDataset::Elevation), nullptr, read, process);
+    }
+
+    // tiles are read and processed on the task group. The caller waits on it before using the results
+    template<typename Process>
+    void forEachElevationTile(const CDBGeoCell &geoCell, TaskGroup &tasks, const Process &process)
+    {
+        for (auto &tileFile : getTileFiles(geoCell, CDBDataset::Elevation)) {
+            tasks.run([this, tileFile = std::move(tileFile), process]() {
+                auto elevation = readElevationTile(tileFile);
+                if (elevation) {
+                    process(std::move(*elevation));
+                }
+
+                reportTileDone(tileFile);
+            });
+        }
+    }
+
+    template<typename Process>
+    void forEachGTModelTile(const CDBGeoCell &geoCell, Process &&process)
+    {
+        forEachGTModelTile(geoCell, nullptr, process);
+    }
+
+    // the next tiles are read ahead with the thread pool. Tiles are still processed one by one
+    template<typename Process>
+    void forEachGTModelTile(const CDBGeoCell &geoCell, ThreadPool &threadPool, Process &&process)
+    {
+        forEachGTModelTile(geoCell, &threadPool, process);
+    }
+
+    template<typename Process>
+    void forEachGSModelTile(const CDBGeoCell &geoCell, Process &&process)
+    {
+        forEachGSModelTile(geoCell, nullptr, process);
+    }
 
-    void forEachGeoCell(std::function<void(CDBGeoCell geoCell)> process);
+    // the models of each tile and the next tiles are read with the thread pool. Tiles are still processed one
+    // by one
+    template<typename Process>
+    void forEachGSModelTile(const CDBGeoCell &geoCell, ThreadPool &threadPool, Process &&process)
+    {
+        forEachGSModelTile(geoCell, &threadPool, process);
+    }
 
-    void forEachElevationTile(const CDBGeoCell &geoCell, std::function<void(CDBElevation)> process);
+    template<typename Process>
+    void forEachRoadNetworkTile(const CDBGeoCell &geoCell, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::RoadNetwork, nullptr, process);
+    }
 
-    void forEachGTModelTile(const CDBGeoCell &geoCell, std::function<void(CDBGTModels)> process);
+    // the polygons of each vector tile are triangulated and the next tiles are read with the thread pool.
+    // Tiles are still processed one by one
+    template<typename Process>
+    void forEachRoadNetworkTile(const CDBGeoCell &geoCell, ThreadPool &threadPool, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::RoadNetwork, &threadPool, process);
+    }
 
-    void forEachGSModelTile(const CDBGeoCell &geoCell, std::function<void(CDBGSModels)> process);
+    template<typename Process>
+    void forEachRailRoadNetworkTile(const CDBGeoCell &geoCell, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::RailRoadNetwork, nullptr, process);
+    }
 
-    void forEachRoadNetworkTile(const CDBGeoCell &geoCell, std::function<void(CDBGeometryVectors)> process);
+    template<typename Process>
+    void forEachRailRoadNetworkTile(const CDBGeoCell &geoCell, ThreadPool &threadPool, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::RailRoadNetwork, &threadPool, process);
+    }
 
-    void forEachRailRoadNetworkTile(const CDBGeoCell &geoCell,
-                                    std::function<void(CDBGeometryVectors)> process);
+    template<typename Process>
+    void forEachPowerlineNetworkTile(const CDBGeoCell &geoCell, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::PowerlineNetwork, nullptr, process);
+    }
 
-    void forEachPowerlineNetworkTile(const CDBGeoCell &geoCell,
-                                     std::function<void(CDBGeometryVectors)> process);
+    template<typename Process>
+    void forEachPowerlineNetworkTile(const CDBGeoCell &geoCell, ThreadPool &threadPool, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::PowerlineNetwork, &threadPool, process);
+    }
 
-    void forEachHydrographyNetworkTile(const CDBGeoCell &geoCell,
-                                       std::function<void(CDBGeometryVectors)> process);
+    template<typename Process>
+    void forEachHydrographyNetworkTile(const CDBGeoCell &geoCell, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::HydrographyNetwork, nullptr, process);
+    }
+
+    template<typename Process>
+    void forEachHydrographyNetworkTile(const CDBGeoCell &geoCell, ThreadPool &threadPool, Process &&process)
+    {
+        forEachGeometryVectorsTile(geoCell, CDBDataset::HydrographyNetwork, &threadPool, process);
+    }
 
     bool isElevationExist(const CDBTile &elevationTile) const;
 
@@ -43,15 +203,19 @@ public:
 
     std::optional<CDBImagery> getImagery(const CDBTile &tile) const;
 
+    uint64_t getGeoCellFingerprint(const CDBGeoCell &geoCell) const;
+
+    // the files of the dataset that forEach*Tile converts, which the progress counts as its tiles
+    uint64_t getDatasetTileCount(const CDBGeoCell &geoCell, CDBDataset dataset) const;
+
+    uint64_t getGTModelFingerprint() const;
+
     static const std::filesystem::path TILES;
     static const std::filesystem::path METADATA;
     static const std::filesystem::path GTModel;
 
 private:
-    void traverseModelsAttributes(const CDBTile *root,
-                                  const CDBTile *oldElevationTile,
-                                  GDALDataset *oldElevationDataset,
-                                  std::function<void(CDBModelsAttributes)> process);
+    std::optional<CDBModelsAttributes> readModelsAttributes(const CDBTileFile &tileFile);
 
     void queryElevationTiles(const CDBTile &elevationTile, CDBTileset &underlyingElevations);
 
@@ -60,15 +224,133 @@ private:
     void clampPointsOnElevationTileset(std::vector<Core::Cartographic> &points,
                                        const CDBTileset &elevationTileset);
 
-    void clampPointOnElevation(const CDBTile &elevationTile,
-                               GDALDataset &elevationDataset,
-                               Core::Cartographic &point);
+    template<typename Process>
+    void forEachGTModelTile(const CDBGeoCell &geoCell, ThreadPool *threadPool, Process &process)
+    {
+        auto read = [this](const CDBTileFile &tileFile) { return readGTModelTile(tileFile); };
+        processTileFiles(getTileFiles(geoCell, CDBDataset::GTFeature), threadPool, read, process);
+    }
+
+    template<typename Process>
+    void forEachGSModelTile(const CDBGeoCell &geoCell, ThreadPool *threadPool, Process &process)
+    {
+        // the tilesets of every feature class read their models from the same archives
+        CDBGSModelArchiveCache archives;
+        auto read = [this, &archives, threadPool](const CDBTileFile &tileFile) {
+            return readGSModelTile(tileFile, archives, threadPool);
+        };
+
+        processTileFiles(getTileFiles(geoCell, CDBDataset::GSFeature), threadPool, read, process);
+    }
+
+    template<typename Process>
+    void forEachGeometryVectorsTile(const CDBGeoCell &geoCell,
+                                    CDBDataset dataset,
+                                    ThreadPool *threadPool,
+                                    Process &process)
+    {
+        auto read = [this, threadPool](const CDBTileFile &tileFile) {
+            return readGeometryVectorsTile(tileFile, threadPool);
+        };
+
+        processTileFiles(getTileFiles(geoCell, dataset), threadPool, read, process);
+    }
+
+    // processes the tiles in order. With a thread pool, the tiles up to the read ahead depth after the one
+    // being processed are read by the pool in the meantime
+    template<typename Read, typename Process>
+    void processTileFiles(const std::vector<CDBTileFile> &tileFiles,
+                          ThreadPool *threadPool,
+                          const Read &read,
+                          Process &process)
+    {
+        if (!threadPool || threadPool->isSequential() || m_readAheadDepth == 0) {
+            for (const auto &tileFile : tileFiles) {
+                auto tile = read(tileFile);
+                if (tile) {
+                    process(std::move(*tile));
+                }
+
+                reportTileDone(tileFile);
+            }
+
+            return;
+        }
+
+        // a tile is read by whichever of its read ahead task and this thread gets to it first, so this thread
+        // never waits on a read still queued behind the work of the pool
+        using Tile = decltype(read(tileFiles.front()));
+        struct TileRead
+        {
+            std::atomic<bool> isStarted{false};
+            std::promise<Tile> tile;
+        };
+
+        auto readOnce = [&read](TileRead &tileRead, const CDBTileFile &tileFile) {
+            if (tileRead.isStarted.exchange(true)) {
+                return;
+            }
+
+            try {
+                tileRead.tile.set_value(read(tileFile));
+            } catch (...) {
+                tileRead.tile.set_exception(std::current_exception());
+            }
+        };
+
+        TaskGroup readTasks(*threadPool);
+        std::deque<std::pair<std::shared_ptr<TileRead>, std::future<Tile>>> pendingReads;
+        size_t nextRead = 0;
+        for (const auto &tileFile : tileFiles) {
+            while (nextRead < tileFiles.size() && pendingReads.size() <= m_readAheadDepth) {
+                auto tileRead = std::make_shared<TileRead>();
+                auto tile = tileRead->tile.get_future();
+                const auto &readFile = tileFiles[nextRead++];
+                readTasks.run([tileRead, &readFile, &readOnce]() { readOnce(*tileRead, readFile); });
+                pendingReads.emplace_back(std::move(tileRead), std::move(tile));
+            }
+
+            auto pendingRead = std::move(pendingReads.front());
+            pendingReads.pop_front();
+            readOnce(*pendingRead.first, tileFile);
+            auto tile = pendingRead.second.get();
+            if (tile) {
+                process(std::move(*tile));
+            }
+
+            reportTileDone(tileFile);
+        }
+
+        readTasks.wait();
+    }
+
+    void addModelTileFiles(const CDBTile *root,
+                           const CDBGeoCell &geoCell,
+                           CDBDataset dataset,
+                           std::vector<CDBTileFile> &tileFiles) const;
+
+    std::shared_ptr<const CDBDatasetIndex> getDatasetIndex(const CDBGeoCell &geoCell,
+                                                           CDBDataset dataset) const;
+
+    static std::filesystem::path getDatasetIndexPath(const CDBGeoCell &geoCell, CDBDataset dataset);
+
+    std::shared_ptr<const CDBElevationGrid> locateElevationGrid(const CDBTile &elevationTile);
+
+    void reportTileDone(CDBDataset dataset, const std::filesystem::path &file) const;
 
-    void forEachDatasetTile(const CDBGeoCell &geoCell,
-                            CDBDataset dataset,
-                            std::function<void(const std::filesystem::path &)> process);
+    static bool isDatasetTileFile(CDBDataset dataset, const std::filesystem::path &file);
 
-    std::optional<CDBGTModelCache> m_GTModelCache;
+    std::shared_ptr<CDBManifest> m_manifest;
+    std::shared_ptr<CDBGTModelCache> m_GTModelCache;
+    std::shared_ptr<GDALDatasetPool> m_datasetPool;
+    CDBElevationGridCache m_elevationGridCache;
+    CDBClassesAttributesCache m_classesAttributesCache;
+    std::shared_ptr<ConversionStats> m_stats;
+    std::shared_ptr<ConversionProgressTracker> m_progress;
+    std::optional<Core::GlobeRectangle> m_areaOfInterest;
+    int m_minLevel;
+    int m_maxLevel;
+    size_t m_readAheadDepth;
     std::filesystem::path m_path;
 };
 } // namespace CDBTo3DTiles
@@ -1,5 +1,7 @@
 #include "CDBAttributes.h"
+#include "Scene.h"
 #include "Transforms.h"
+#include "VirtualFileSystem.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_access.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -7,6 +9,16 @@
 
 namespace CDBTo3DTiles {
 
+static std::optional<CDBTile> createClassLevelTile(const CDBTile &instancesTile);
+
+static std::filesystem::path getClassLevelPath(const CDBTile &classTile,
+                                               const std::filesystem::path &CDBPath);
+
+static std::shared_ptr<const CDBClassesAttributes> openClassesAttributes(
+    const std::filesystem::path &classLevelPath,
+    CDBTile classTile,
+    std::shared_ptr<CDBStringPool> stringPool);
+
 glm::dmat4 calculateModelOrientation(glm::dvec3 worldPosition, double orientation)
 {
     glm::dmat4 ENU = Core::Transforms::eastNorthUpToFixedFrame(worldPosition);
@@ -15,32 +27,264 @@ glm::dmat4 calculateModelOrientation(glm::dvec3 worldPosition, double orientatio
     return glm::translate(glm::dmat4(1.0), worldPosition) * rotMat;
 }
 
-void CDBInstancesAttributes::addInstanceFeature(const OGRFeature &feature)
+std::vector<OGRFeatureUniquePtr> readLayerFeatures(OGRLayer &layer)
+{
+    // drivers that can't count the features cheaply return a negative count
+    std::vector<OGRFeatureUniquePtr> features;
+    GIntBig featureCount = layer.GetFeatureCount(FALSE);
+    if (featureCount > 0) {
+        features.reserve(static_cast<size_t>(featureCount));
+    }
+
+    layer.ResetReading();
+    while (OGRFeature *feature = layer.GetNextFeature()) {
+        features.emplace_back(feature);
+    }
+
+    return features;
+}
+
+CDBStringPool::Handle CDBStringPool::intern(std::string_view value)
+{
+    auto existing = m_stringToHandle.find(value);
+    if (existing != m_stringToHandle.end()) {
+        return existing->second;
+    }
+
+    // deque keeps its elements in place, so the views used as keys stay valid while the pool grows
+    Handle handle = static_cast<Handle>(m_strings.size());
+    const std::string &stored = m_strings.emplace_back(value);
+    m_stringToHandle.emplace(stored, handle);
+    return handle;
+}
+
+CDBStringColumn::CDBStringColumn(std::shared_ptr<CDBStringPool> stringPool)
+    : m_stringPool{std::move(stringPool)}
+{}
+
+void CDBStringColumn::resize(size_t count)
+{
+    m_handles.resize(count, m_stringPool->intern(""));
+}
+
+void CDBStringColumn::retain(const std::vector<size_t> &indices)
+{
+    retainElements(m_handles, indices);
+}
+
+void CDBStringColumn::reserveForAppend(size_t count)
+{
+    CDBTo3DTiles::reserveForAppend(m_handles, count);
+}
+
+void CDBStringColumn::emplace_back(std::string_view value)
+{
+    m_handles.emplace_back(m_stringPool->intern(value));
+}
+
+void CDBStringColumn::emplaceFrom(const CDBStringColumn &column, size_t idx)
+{
+    m_handles.emplace_back(importHandle(column, idx));
+}
+
+void CDBStringColumn::setFrom(size_t idx, const CDBStringColumn &column, size_t columnIdx)
+{
+    m_handles[idx] = importHandle(column, columnIdx);
+}
+
+CDBStringColumn::Handle CDBStringColumn::importHandle(const CDBStringColumn &column, size_t columnIdx)
 {
-    if (feature.GetFieldCount() == 0) {
+    if (column.m_stringPool == m_stringPool) {
+        return column.m_handles[columnIdx];
+    }
+
+    return m_stringPool->intern(column[columnIdx]);
+}
+
+CDBInstancesAttributes::CDBInstancesAttributes()
+    : CDBInstancesAttributes(std::make_shared<CDBStringPool>())
+{}
+
+CDBInstancesAttributes::CDBInstancesAttributes(std::shared_ptr<CDBStringPool> stringPool)
+    : m_stringPool{std::move(stringPool)}
+    , m_CNAMs{m_stringPool}
+{}
+
+CDBStringColumn &CDBInstancesAttributes::getOrCreateStringAttribs(const std::string &key)
+{
+    return m_stringAttribs.try_emplace(key, m_stringPool).first->second;
+}
+
+CDBInstancesAttributes CDBInstancesAttributes::extractInstances(
+    const std::vector<size_t> &instanceIndices) const
+{
+    CDBInstancesAttributes extracted(m_stringPool);
+    size_t totalExtracted = instanceIndices.size();
+    auto &extractedIntegerAttribs = extracted.getIntegerAttribs();
+    for (const auto &inputPair : getIntegerAttribs()) {
+        const auto &inputValues = inputPair.second;
+        auto &values = extractedIntegerAttribs[inputPair.first];
+        values.reserve(totalExtracted);
+
+        for (auto i : instanceIndices) {
+            values.emplace_back(inputValues[i]);
+        }
+    }
+
+    auto &extractedDoubleAttribs = extracted.getDoubleAttribs();
+    for (const auto &inputPair : getDoubleAttribs()) {
+        const auto &inputValues = inputPair.second;
+        auto &values = extractedDoubleAttribs[inputPair.first];
+        values.reserve(totalExtracted);
+
+        for (auto i : instanceIndices) {
+            values.emplace_back(inputValues[i]);
+        }
+    }
+
+    // strings are extracted as handles into the same pool
+    for (const auto &inputPair : getStringAttribs()) {
+        const auto &inputValues = inputPair.second;
+        auto &values = extracted.getOrCreateStringAttribs(inputPair.first);
+        values.reserve(totalExtracted);
+
+        for (auto i : instanceIndices) {
+            values.emplaceFrom(inputValues, i);
+        }
+    }
+
+    const auto &inputCNAMs = getCNAMs();
+    auto &CNAMs = extracted.getCNAMs();
+    CNAMs.reserve(totalExtracted);
+    for (auto i : instanceIndices) {
+        CNAMs.emplaceFrom(inputCNAMs, i);
+    }
+
+    return extracted;
+}
+
+void CDBInstancesAttributes::retainInstances(const std::vector<size_t> &instanceIndices)
+{
+    // increasing indices of every instance keep the columns as they are
+    if (instanceIndices.size() == getInstancesCount()) {
         return;
     }
 
-    for (int i = 0; i < feature.GetFieldCount(); ++i) {
-        auto fieldDef = feature.GetFieldDefnRef(i);
+    for (auto &integerPair : m_integerAttribs) {
+        retainElements(integerPair.second, instanceIndices);
+    }
+
+    for (auto &doublePair : m_doubleAttribs) {
+        retainElements(doublePair.second, instanceIndices);
+    }
+
+    for (auto &stringPair : m_stringAttribs) {
+        stringPair.second.retain(instanceIndices);
+    }
+
+    m_CNAMs.retain(instanceIndices);
+}
+
+void CDBInstancesAttributes::appendInstances(const CDBInstancesAttributes &instances)
+{
+    size_t instancesCount = getInstancesCount();
+    size_t totalInstances = instancesCount + instances.getInstancesCount();
+    for (const auto &inputPair : instances.getIntegerAttribs()) {
+        auto &values = m_integerAttribs[inputPair.first];
+        values.resize(instancesCount, 0);
+        values.insert(values.end(), inputPair.second.begin(), inputPair.second.end());
+    }
+
+    for (auto &integerPair : m_integerAttribs) {
+        integerPair.second.resize(totalInstances, 0);
+    }
+
+    for (const auto &inputPair : instances.getDoubleAttribs()) {
+        auto &values = m_doubleAttribs[inputPair.first];
+        values.resize(instancesCount, 0.0);
+        values.insert(values.end(), inputPair.second.begin(), inputPair.second.end());
+    }
+
+    for (auto &doublePair : m_doubleAttribs) {
+        doublePair.second.resize(totalInstances, 0.0);
+    }
+
+    for (const auto &inputPair : instances.getStringAttribs()) {
+        const auto &inputValues = inputPair.second;
+        auto &values = getOrCreateStringAttribs(inputPair.first);
+        values.resize(instancesCount);
+        values.reserveForAppend(inputValues.size());
+        for (size_t i = 0; i < inputValues.size(); ++i) {
+            values.emplaceFrom(inputValues, i);
+        }
+    }
+
+    for (auto &stringPair : m_stringAttribs) {
+        stringPair.second.resize(totalInstances);
+    }
+
+    const auto &inputCNAMs = instances.getCNAMs();
+    m_CNAMs.reserveForAppend(inputCNAMs.size());
+    for (size_t i = 0; i < inputCNAMs.size(); ++i) {
+        m_CNAMs.emplaceFrom(inputCNAMs, i);
+    }
+}
+
+CDBInstancesAttributes::LayerColumns::LayerColumns() {}
+
+CDBInstancesAttributes::LayerColumns CDBInstancesAttributes::createLayerColumns(
+    const OGRFeatureDefn &featureDefinition, size_t featureCount)
+{
+    LayerColumns columns;
+    if (featureCount == 0) {
+        return columns;
+    }
+
+    for (int i = 0; i < featureDefinition.GetFieldCount(); ++i) {
+        const OGRFieldDefn *fieldDef = featureDefinition.GetFieldDefn(i);
         if (fieldDef->GetType() == OGRFieldType::OFTInteger) {
             auto &values = m_integerAttribs[fieldDef->GetNameRef()];
-            values.emplace_back(feature.GetFieldAsInteger(i));
+            reserveForAppend(values, featureCount);
+            columns.integerColumns.emplace_back(i, &values);
         } else if (fieldDef->GetType() == OGRFieldType::OFTReal) {
             auto &values = m_doubleAttribs[fieldDef->GetNameRef()];
-            values.emplace_back(feature.GetFieldAsDouble(i));
+            reserveForAppend(values, featureCount);
+            columns.doubleColumns.emplace_back(i, &values);
         } else if (fieldDef->GetType() == OGRFieldType::OFTString) {
-            if (strcmp(fieldDef->GetNameRef(), "CNAM") == 0) {
-                m_CNAMs.emplace_back(feature.GetFieldAsString(i));
-            } else {
-                auto &values = m_stringAttribs[fieldDef->GetNameRef()];
-                values.emplace_back(feature.GetFieldAsString(i));
+            CDBStringColumn *values = &m_CNAMs;
+            if (strcmp(fieldDef->GetNameRef(), "CNAM") != 0) {
+                values = &getOrCreateStringAttribs(fieldDef->GetNameRef());
             }
+
+            values->reserveForAppend(featureCount);
+            columns.stringColumns.emplace_back(i, values);
         }
     }
+
+    return columns;
+}
+
+void CDBInstancesAttributes::addInstanceFeature(const OGRFeature &feature)
+{
+    addInstanceFeature(feature, createLayerColumns(*feature.GetDefnRef(), 1));
+}
+
+void CDBInstancesAttributes::addInstanceFeature(const OGRFeature &feature, const LayerColumns &columns)
+{
+    for (const auto &column : columns.integerColumns) {
+        column.second->emplace_back(feature.GetFieldAsInteger(column.first));
+    }
+
+    for (const auto &column : columns.doubleColumns) {
+        column.second->emplace_back(feature.GetFieldAsDouble(column.first));
+    }
+
+    for (const auto &column : columns.stringColumns) {
+        column.second->emplace_back(feature.GetFieldAsString(column.first));
+    }
 }
 
-void CDBInstancesAttributes::mergeClassesAttributes(const CDBClassesAttributes &classVectors) noexcept
+void CDBInstancesAttributes::mergeClassesAttributes(const CDBClassesAttributes &classVectors)
 {
     const auto &classCNAMs = classVectors.getCNAMs();
     size_t instancesCount = getInstancesCount();
@@ -68,19 +312,22 @@ void CDBInstancesAttributes::mergeClassesAttributes(const CDBClassesAttributes &
             }
 
             for (const auto &keyValue : classVectors.getStringAttribs()) {
-                auto &instanceValues = m_stringAttribs[keyValue.first];
+                auto &instanceValues = getOrCreateStringAttribs(keyValue.first);
                 if (instanceValues.empty()) {
                     instanceValues.resize(instancesCount);
                 }
 
-                instanceValues[i] = keyValue.second[classIndex];
+                instanceValues.setFrom(i, keyValue.second, classIndex);
             }
         }
     }
 }
 
-CDBClassesAttributes::CDBClassesAttributes(GDALDatasetUniquePtr vectorDataset, CDBTile tile)
+CDBClassesAttributes::CDBClassesAttributes(GDALDatasetUniquePtr vectorDataset,
+                                           CDBTile tile,
+                                           std::shared_ptr<CDBStringPool> stringPool)
     : m_tile{std::move(tile)}
+    , m_stringPool{stringPool ? std::move(stringPool) : std::make_shared<CDBStringPool>()}
 {
     for (int i = 0; i < vectorDataset->GetLayerCount(); ++i) {
         OGRLayer *layer = vectorDataset->GetLayer(i);
@@ -106,7 +353,8 @@ void CDBClassesAttributes::addClassFeaturesAttribs(const OGRFeature &feature)
                 auto CNAM = feature.GetFieldAsString(i);
                 m_CNAMs[CNAM] = m_CNAMs.size();
             } else {
-                auto &values = m_stringAttribs[fieldDef->GetNameRef()];
+                auto &values = m_stringAttribs.try_emplace(fieldDef->GetNameRef(), m_stringPool)
+                                   .first->second;
                 values.emplace_back(feature.GetFieldAsString(i));
             }
         }
@@ -115,14 +363,18 @@ void CDBClassesAttributes::addClassFeaturesAttribs(const OGRFeature &feature)
 
 CDBModelsAttributes::CDBModelsAttributes(GDALDatasetUniquePtr featureDataset,
                                          CDBTile tile,
-                                         const std::filesystem::path &CDBPath)
+                                         const std::filesystem::path &CDBPath,
+                                         CDBClassesAttributesCache *classesAttributesCache)
     : m_tile{std::move(tile)}
 {
     // find position
     for (int i = 0; i < featureDataset->GetLayerCount(); ++i) {
         OGRLayer *layer = featureDataset->GetLayer(i);
-        for (const auto &feature : *layer) {
-            m_instancesAttribs.addInstanceFeature(*feature);
+        auto features = readLayerFeatures(*layer);
+        auto columns = m_instancesAttribs.createLayerColumns(*layer->GetLayerDefn(), features.size());
+        reserveForAppend(m_cartographicPositions, features.size());
+        for (const auto &feature : features) {
+            m_instancesAttribs.addInstanceFeature(*feature, columns);
 
             const OGRGeometry *geometry = feature->GetGeometryRef();
             if (geometry != nullptr && wkbFlatten(geometry->getGeometryType()) == wkbPoint) {
@@ -135,7 +387,8 @@ CDBModelsAttributes::CDBModelsAttributes(GDALDatasetUniquePtr featureDataset,
     }
 
     // add class attributes first
-    auto classAttribues = createClassesAttributes(tile, CDBPath);
+    auto classAttribues = readClassesAttributes(
+        *m_tile, CDBPath, m_instancesAttribs.getStringPool(), classesAttributesCache);
     if (classAttribues) {
         m_instancesAttribs.mergeClassesAttributes(*classAttribues);
     }
@@ -165,35 +418,103 @@ CDBModelsAttributes::CDBModelsAttributes(GDALDatasetUniquePtr featureDataset,
     }
 }
 
-std::optional<CDBClassesAttributes> CDBModelsAttributes::createClassesAttributes(
+std::shared_ptr<const CDBClassesAttributes> CDBClassesAttributesCache::get(
     const CDBTile &instancesTile, const std::filesystem::path &CDBPath)
+{
+    auto classTile = createClassLevelTile(instancesTile);
+    if (!classTile) {
+        return nullptr;
+    }
+
+    // the first caller parses the file outside of the lock, the others wait for it
+    auto classLevelPath = getClassLevelPath(*classTile, CDBPath);
+    std::promise<std::shared_ptr<const CDBClassesAttributes>> parsed;
+    std::shared_future<std::shared_ptr<const CDBClassesAttributes>> parsedByOther;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto classesAttributes = m_classesAttributes.find(classLevelPath.string());
+        if (classesAttributes != m_classesAttributes.end()) {
+            parsedByOther = classesAttributes->second;
+        } else {
+            m_classesAttributes.insert({classLevelPath.string(), parsed.get_future().share()});
+        }
+    }
+
+    if (parsedByOther.valid()) {
+        return parsedByOther.get();
+    }
+
+    try {
+        auto classesAttributes = openClassesAttributes(classLevelPath, std::move(*classTile), nullptr);
+        parsed.set_value(classesAttributes);
+        return classesAttributes;
+    } catch (...) {
+        parsed.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+std::shared_ptr<const CDBClassesAttributes> readClassesAttributes(const CDBTile &instancesTile,
+                                                                  const std::filesystem::path &CDBPath,
+                                                                  std::shared_ptr<CDBStringPool> stringPool,
+                                                                  CDBClassesAttributesCache *cache)
+{
+    if (cache) {
+        return cache->get(instancesTile, CDBPath);
+    }
+
+    auto classTile = createClassLevelTile(instancesTile);
+    if (!classTile) {
+        return nullptr;
+    }
+
+    auto classLevelPath = getClassLevelPath(*classTile, CDBPath);
+    return openClassesAttributes(classLevelPath, std::move(*classTile), std::move(stringPool));
+}
+
+std::optional<CDBTile> createClassLevelTile(const CDBTile &instancesTile)
 {
     int CS_2 = instancesTile.getCS_2();
     if (CS_2 == static_cast<int>(CDBVectorCS2::PointFeature)) {
         CS_2 = static_cast<int>(CDBVectorCS2::PointFeatureClassLevel);
+    } else if (CS_2 == static_cast<int>(CDBVectorCS2::LinealFeature)) {
+        CS_2 = static_cast<int>(CDBVectorCS2::LinealFeatureClassLevel);
+    } else if (CS_2 == static_cast<int>(CDBVectorCS2::PolygonFeature)) {
+        CS_2 = static_cast<int>(CDBVectorCS2::PolygonFeatureClassLevel);
     } else {
         return std::nullopt;
     }
 
-    CDBTile classVectorsTile = CDBTile(instancesTile.getGeoCell(),
-                                       instancesTile.getDataset(),
-                                       instancesTile.getCS_1(),
-                                       CS_2,
-                                       instancesTile.getLevel(),
-                                       instancesTile.getUREF(),
-                                       instancesTile.getRREF());
+    return CDBTile(instancesTile.getGeoCell(),
+                   instancesTile.getDataset(),
+                   instancesTile.getCS_1(),
+                   CS_2,
+                   instancesTile.getLevel(),
+                   instancesTile.getUREF(),
+                   instancesTile.getRREF());
+}
 
-    auto classLevelPath = CDBPath / (classVectorsTile.getRelativePath().string() + ".dbf");
-    if (!std::filesystem::exists(classLevelPath)) {
-        return std::nullopt;
+std::filesystem::path getClassLevelPath(const CDBTile &classTile, const std::filesystem::path &CDBPath)
+{
+    return CDBPath / (classTile.getRelativePath().string() + ".dbf");
+}
+
+std::shared_ptr<const CDBClassesAttributes> openClassesAttributes(const std::filesystem::path &classLevelPath,
+                                                                  CDBTile classTile,
+                                                                  std::shared_ptr<CDBStringPool> stringPool)
+{
+    if (!getFileStatus(classLevelPath)) {
+        return nullptr;
     }
 
     GDALDatasetUniquePtr dataset = GDALDatasetUniquePtr(
         (GDALDataset *) GDALOpenEx(classLevelPath.c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
     if (!dataset) {
-        return std::nullopt;
+        return nullptr;
     }
 
-    return CDBClassesAttributes(std::move(dataset), std::move(classVectorsTile));
+    return std::make_shared<const CDBClassesAttributes>(std::move(dataset),
+                                                        std::move(classTile),
+                                                        std::move(stringPool));
 }
 } // namespace CDBTo3DTiles
@@ -4,12 +4,23 @@
 #include "Cartographic.h"
 #include "gdal_priv.h"
 #include <glm/glm.hpp>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
 
 namespace CDBTo3DTiles {
 class CDBClassesAttributes;
 
 glm::dmat4 calculateModelOrientation(glm::dvec3 worldPosition, double orientation);
 
+// reads every feature of the layer at once, so the geometries and attributes can be counted before they are
+// converted
+std::vector<OGRFeatureUniquePtr> readLayerFeatures(OGRLayer &layer);
+
 enum class CDBVectorCS2
 {
     PointFeature = 1,
@@ -31,16 +42,121 @@ enum class CDBVectorCS2
     PolygonFigurePointExtendedLevel = 20
 };
 
+// CNAMs and class level strings repeat across most features of a tile, so every distinct string is stored
+// once and referred to by its handle. A pool is not synchronized and is filled by the thread reading the tile
+class CDBStringPool
+{
+public:
+    using Handle = uint32_t;
+
+    CDBStringPool() = default;
+
+    CDBStringPool(const CDBStringPool &) = delete;
+
+    CDBStringPool &operator=(const CDBStringPool &) = delete;
+
+    Handle intern(std::string_view value);
+
+    inline const std::string &getString(Handle handle) const noexcept { return m_strings[handle]; }
+
+    inline size_t getStringCount() const noexcept { return m_strings.size(); }
+
+private:
+    std::deque<std::string> m_strings;
+    std::unordered_map<std::string_view, Handle> m_stringToHandle;
+};
+
+class CDBStringColumn
+{
+public:
+    using Handle = CDBStringPool::Handle;
+
+    explicit CDBStringColumn(std::shared_ptr<CDBStringPool> stringPool);
+
+    inline size_t size() const noexcept { return m_handles.size(); }
+
+    inline bool empty() const noexcept { return m_handles.empty(); }
+
+    inline const std::string &operator[](size_t idx) const noexcept
+    {
+        return m_stringPool->getString(m_handles[idx]);
+    }
+
+    inline const std::string &front() const noexcept { return (*this)[0]; }
+
+    inline Handle getHandle(size_t idx) const noexcept { return m_handles[idx]; }
+
+    inline const std::vector<Handle> &getHandles() const noexcept { return m_handles; }
+
+    inline const std::shared_ptr<CDBStringPool> &getStringPool() const noexcept { return m_stringPool; }
+
+    inline void reserve(size_t count) { m_handles.reserve(count); }
+
+    void reserveForAppend(size_t count);
+
+    void resize(size_t count);
+
+    // keeps the strings at the given increasing indices
+    void retain(const std::vector<size_t> &indices);
+
+    void emplace_back(std::string_view value);
+
+    // copies the handle when both columns share a pool and interns the string otherwise
+    void emplaceFrom(const CDBStringColumn &column, size_t idx);
+
+    void setFrom(size_t idx, const CDBStringColumn &column, size_t columnIdx);
+
+private:
+    Handle importHandle(const CDBStringColumn &column, size_t columnIdx);
+
+    std::shared_ptr<CDBStringPool> m_stringPool;
+    std::vector<Handle> m_handles;
+};
+
 class CDBInstancesAttributes
 {
 public:
+    // the columns receiving the fields of a layer, so its features are added without looking up their
+    // field names. They point into the attributes and are only valid while the attributes stay in place
+    struct LayerColumns
+    {
+        LayerColumns();
+
+        std::vector<std::pair<int, std::vector<int> *>> integerColumns;
+        std::vector<std::pair<int, std::vector<double> *>> doubleColumns;
+        std::vector<std::pair<int, CDBStringColumn *>> stringColumns;
+    };
+
+    CDBInstancesAttributes();
+
+    explicit CDBInstancesAttributes(std::shared_ptr<CDBStringPool> stringPool);
+
+    // the columns are reserved for featureCount more features. No column is created for a layer without
+    // features
+    LayerColumns createLayerColumns(const OGRFeatureDefn &featureDefinition, size_t featureCount);
+
     void addInstanceFeature(const OGRFeature &feature);
 
-    void mergeClassesAttributes(const CDBClassesAttributes &classVectors) noexcept;
+    void addInstanceFeature(const OGRFeature &feature, const LayerColumns &columns);
+
+    void mergeClassesAttributes(const CDBClassesAttributes &classVectors);
+
+    // keeps the attributes of the given instances, in that order, sharing the string pool
+    CDBInstancesAttributes extractInstances(const std::vector<size_t> &instanceIndices) const;
+
+    // keeps the attributes of the given instances in place. The indices are increasing, so the values kept
+    // are moved to the front of each column instead of being copied into new columns
+    void retainInstances(const std::vector<size_t> &instanceIndices);
+
+    // adds the instances after the current ones. The attributes missing on either side are filled with 0 or
+    // an empty string
+    void appendInstances(const CDBInstancesAttributes &instances);
 
     inline size_t getInstancesCount() const noexcept { return m_CNAMs.size(); }
 
-    inline const std::vector<std::string> &getCNAMs() const noexcept { return m_CNAMs; }
+    inline const std::shared_ptr<CDBStringPool> &getStringPool() const noexcept { return m_stringPool; }
+
+    inline const CDBStringColumn &getCNAMs() const noexcept { return m_CNAMs; }
 
     inline const std::map<std::string, std::vector<int>> &getIntegerAttribs() const noexcept
     {
@@ -52,33 +168,33 @@ public:
         return m_doubleAttribs;
     }
 
-    inline const std::map<std::string, std::vector<std::string>> &getStringAttribs() const noexcept
+    inline const std::map<std::string, CDBStringColumn> &getStringAttribs() const noexcept
     {
         return m_stringAttribs;
     }
 
-    inline std::vector<std::string> &getCNAMs() noexcept { return m_CNAMs; }
+    inline CDBStringColumn &getCNAMs() noexcept { return m_CNAMs; }
 
     inline std::map<std::string, std::vector<int>> &getIntegerAttribs() noexcept { return m_integerAttribs; }
 
     inline std::map<std::string, std::vector<double>> &getDoubleAttribs() noexcept { return m_doubleAttribs; }
 
-    inline std::map<std::string, std::vector<std::string>> &getStringAttribs() noexcept
-    {
-        return m_stringAttribs;
-    }
+    CDBStringColumn &getOrCreateStringAttribs(const std::string &key);
 
 private:
-    std::vector<std::string> m_CNAMs;
+    std::shared_ptr<CDBStringPool> m_stringPool;
+    CDBStringColumn m_CNAMs;
     std::map<std::string, std::vector<int>> m_integerAttribs;
     std::map<std::string, std::vector<double>> m_doubleAttribs;
-    std::map<std::string, std::vector<std::string>> m_stringAttribs;
+    std::map<std::string, CDBStringColumn> m_stringAttribs;
 };
 
 class CDBClassesAttributes
 {
 public:
-    CDBClassesAttributes(GDALDatasetUniquePtr dataset, CDBTile tile);
+    CDBClassesAttributes(GDALDatasetUniquePtr dataset,
+                         CDBTile tile,
+                         std::shared_ptr<CDBStringPool> stringPool = nullptr);
 
     inline const CDBTile &getTile() const noexcept { return *m_tile; }
 
@@ -94,7 +210,7 @@ public:
         return m_doubleAttribs;
     }
 
-    inline const std::map<std::string, std::vector<std::string>> &getStringAttribs() const noexcept
+    inline const std::map<std::string, CDBStringColumn> &getStringAttribs() const noexcept
     {
         return m_stringAttribs;
     }
@@ -103,16 +219,42 @@ private:
     void addClassFeaturesAttribs(const OGRFeature &feature);
 
     std::optional<CDBTile> m_tile;
+    std::shared_ptr<CDBStringPool> m_stringPool;
     std::map<std::string, size_t> m_CNAMs;
     std::map<std::string, std::vector<int>> m_integerAttribs;
     std::map<std::string, std::vector<double>> m_doubleAttribs;
-    std::map<std::string, std::vector<std::string>> m_stringAttribs;
+    std::map<std::string, CDBStringColumn> m_stringAttribs;
 };
 
+// the class-level attributes of a GeoCell, shared by its vector datasets and models from several threads.
+// Each class-level file is opened and parsed once, by the first tile asking for it
+class CDBClassesAttributesCache
+{
+public:
+    // returns nullptr when the instances tile has no class-level file
+    std::shared_ptr<const CDBClassesAttributes> get(const CDBTile &instancesTile,
+                                                    const std::filesystem::path &CDBPath);
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const CDBClassesAttributes>>>
+        m_classesAttributes;
+};
+
+// reads the class-level attributes of the instances tile into the string pool, or through the cache when
+// there is one. Returns nullptr when the tile has no class-level file
+std::shared_ptr<const CDBClassesAttributes> readClassesAttributes(const CDBTile &instancesTile,
+                                                                  const std::filesystem::path &CDBPath,
+                                                                  std::shared_ptr<CDBStringPool> stringPool,
+                                                                  CDBClassesAttributesCache *cache = nullptr);
+
 class CDBModelsAttributes
 {
 public:
-    CDBModelsAttributes(GDALDatasetUniquePtr dataset, CDBTile tile, const std::filesystem::path &CDBPath);
+    CDBModelsAttributes(GDALDatasetUniquePtr dataset,
+                        CDBTile tile,
+                        const std::filesystem::path &CDBPath,
+                        CDBClassesAttributesCache *classesAttributesCache = nullptr);
 
     inline const std::vector<Core::Cartographic> &getCartographicPositions() const noexcept
     {
@@ -135,10 +277,9 @@ public:
         return m_instancesAttribs;
     }
 
-private:
-    std::optional<CDBClassesAttributes> createClassesAttributes(const CDBTile &instancesTile,
-                                                                const std::filesystem::path &CDBPath);
+    inline CDBInstancesAttributes &getInstancesAttributes() noexcept { return m_instancesAttribs; }
 
+private:
     std::vector<glm::vec3> m_scales;
     std::vector<double> m_orientations;
     std::vector<Core::Cartographic> m_cartographicPositions;
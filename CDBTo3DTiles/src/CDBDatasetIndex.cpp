@@ -0,0 +1,82 @@
+#include "CDBDatasetIndex.h"
+#include "VirtualFileSystem.h"
+#include <limits>
+
+namespace CDBTo3DTiles {
+static const int64_t MISSING_DIRECTORY_TIME = std::numeric_limits<int64_t>::min();
+
+static int64_t getLastWriteTime(const std::filesystem::path &path)
+{
+    auto status = getFileStatus(path);
+    if (!status) {
+        return MISSING_DIRECTORY_TIME;
+    }
+
+    return status->lastWriteTime;
+}
+
+static void indexDirectory(const std::filesystem::path &CDBPath,
+                           const std::filesystem::path &relativePath,
+                           size_t depth,
+                           std::vector<CDBDatasetIndex::Directory> &directories,
+                           std::vector<CDBDatasetIndex::File> &files)
+{
+    auto path = CDBPath / relativePath;
+    directories.push_back({relativePath.string(), getLastWriteTime(path)});
+    for (const auto &entry : listDirectory(path)) {
+        auto entryRelativePath = relativePath / entry.name;
+        if (depth > 1) {
+            if (entry.status.isDirectory) {
+                indexDirectory(CDBPath, entryRelativePath, depth - 1, directories, files);
+            }
+
+            continue;
+        }
+
+        files.push_back({entryRelativePath.string(), entry.status.size, entry.status.lastWriteTime});
+    }
+}
+
+CDBDatasetIndex::CDBDatasetIndex(std::vector<Directory> directories, std::vector<File> files)
+    : m_directories{std::move(directories)}
+    , m_files{std::move(files)}
+{
+    m_relativePaths.reserve(m_files.size());
+    for (const auto &file : m_files) {
+        m_relativePaths.emplace(file.relativePath);
+    }
+}
+
+CDBDatasetIndex CDBDatasetIndex::createFromDirectory(const std::filesystem::path &CDBPath,
+                                                     const std::filesystem::path &relativePath,
+                                                     size_t depth)
+{
+    std::vector<Directory> directories;
+    std::vector<File> files;
+    auto status = getFileStatus(CDBPath / relativePath);
+    if (!status || !status->isDirectory) {
+        // remember the directory is missing, so the index becomes stale once it is created
+        directories.push_back({relativePath.string(), MISSING_DIRECTORY_TIME});
+        return CDBDatasetIndex(std::move(directories), std::move(files));
+    }
+
+    indexDirectory(CDBPath, relativePath, depth, directories, files);
+    return CDBDatasetIndex(std::move(directories), std::move(files));
+}
+
+bool CDBDatasetIndex::isUpToDate(const std::filesystem::path &CDBPath) const
+{
+    for (const auto &directory : m_directories) {
+        if (getLastWriteTime(CDBPath / directory.relativePath) != directory.lastWriteTime) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CDBDatasetIndex::isFileExist(const std::filesystem::path &relativePath) const
+{
+    return m_relativePaths.find(relativePath.string()) != m_relativePaths.end();
+}
+} // namespace CDBTo3DTiles
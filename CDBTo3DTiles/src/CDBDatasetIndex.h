@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace CDBTo3DTiles {
+class CDBDatasetIndex
+{
+public:
+    struct Directory
+    {
+        std::string relativePath;
+        int64_t lastWriteTime;
+    };
+
+    struct File
+    {
+        std::string relativePath;
+        uint64_t size;
+        int64_t lastWriteTime;
+    };
+
+    CDBDatasetIndex() = default;
+
+    CDBDatasetIndex(std::vector<Directory> directories, std::vector<File> files);
+
+    // relativePath is relative to the CDB root, e.g Tiles/N32/W118/001_Elevation. Files are the entries found
+    // depth levels below it, which is level/UREF/tile for a dataset
+    static CDBDatasetIndex createFromDirectory(const std::filesystem::path &CDBPath,
+                                               const std::filesystem::path &relativePath,
+                                               size_t depth = 3);
+
+    // entries are only added or removed by touching their parent directory, so only the directories are
+    // compared. A file rewritten in place only changes its own size or time, and is found by the callers that
+    // stat the files anyway, which refresh the index through CDBManifest::refreshIndex
+    bool isUpToDate(const std::filesystem::path &CDBPath) const;
+
+    bool isFileExist(const std::filesystem::path &relativePath) const;
+
+    inline const std::vector<Directory> &getDirectories() const noexcept { return m_directories; }
+
+    inline const std::vector<File> &getFiles() const noexcept { return m_files; }
+
+private:
+    std::vector<Directory> m_directories;
+    std::vector<File> m_files;
+    std::unordered_set<std::string> m_relativePaths;
+};
+} // namespace CDBTo3DTiles
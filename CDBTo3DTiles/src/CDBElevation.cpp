@@ -4,51 +4,505 @@
 #include "MathHelpers.h"
 #include "glm/gtc/type_ptr.hpp"
 #include "meshoptimizer.h"
+#include <algorithm>
+#include <numeric>
 
 namespace CDBTo3DTiles {
 
-static std::vector<double> getRasterElevationHeights(GDALDatasetUniquePtr &rasterData, glm::ivec2 rasterSize);
+// GDAL type of the samples of a raster band read into a vector of T
+template<typename T>
+struct GDALSampleType;
 
-static Mesh generateElevationMesh(const std::vector<double> terrainHeights,
+template<>
+struct GDALSampleType<float>
+{
+    static constexpr GDALDataType value = GDT_Float32;
+};
+
+template<>
+struct GDALSampleType<double>
+{
+    static constexpr GDALDataType value = GDT_Float64;
+};
+
+template<>
+struct GDALSampleType<int16_t>
+{
+    static constexpr GDALDataType value = GDT_Int16;
+};
+
+static std::optional<CDBElevationGrid::Heights> getRasterElevationHeights(PooledGDALDataset &rasterData,
+                                                                          glm::ivec2 rasterSize);
+
+template<typename T>
+static std::optional<CDBElevationGrid::Heights> readRasterHeights(GDALRasterBand *heightBand,
+                                                                  glm::ivec2 rasterSize);
+
+template<typename Height>
+static Mesh generateElevationMesh(const std::vector<Height> &terrainHeights,
                                   Core::Cartographic topLeft,
                                   glm::uvec2 rasterSize,
                                   glm::dvec2 pixelSize);
 
-static void loadElevation(const std::filesystem::path &path,
-                          Core::Cartographic topLeft,
-                          glm::ivec2 &rasterSize,
-                          Mesh &mesh);
-
 static void extractVerticesFromExistingSimplifiedMesh(const Mesh &existingMesh,
                                                       Mesh &simplified,
+                                                      std::vector<unsigned> &usedVertices,
                                                       std::vector<int> &remap,
                                                       unsigned &totalUniqueVertices,
                                                       unsigned idx0,
                                                       unsigned idx1,
                                                       unsigned idx2);
 
+// square region of a grid of (2^k + 1)^2 vertices, aligned on the triangles of the grid error pyramid
+struct RegularGridRegion
+{
+    const std::vector<float> &errors;
+    unsigned gridSize;
+    glm::uvec2 begin;
+    unsigned size;
+
+    // vertices of the region to keep along with every vertex they depend on, in the order of the region
+    const std::vector<bool> *keptVertices;
+};
+
+static bool isPowerOfTwo(size_t value) noexcept;
+
+static std::vector<unsigned> simplifyRegularGrid(const RegularGridRegion &region,
+                                                 size_t targetIndexCount,
+                                                 float maxError);
+
+static std::vector<float> computeRegularGridErrors(const Mesh &gridMesh, unsigned gridSize);
+
+static std::vector<glm::vec3> computeGridMeshNormals(const Mesh &gridMesh, size_t gridVerticesWidth);
+
+static size_t collectRegularGridTriangles(const RegularGridRegion &region,
+                                          float maxError,
+                                          glm::uvec2 a,
+                                          glm::uvec2 b,
+                                          glm::uvec2 c,
+                                          std::vector<unsigned> *indices);
+
+static std::vector<bool> computeKeptRegularGridVertices(
+    const RegularGridRegion &region, const std::array<std::vector<size_t>, 4> &borderOffsets);
+
+// vertex of a finer neighbor inserted on a border segment of a simplified mesh, between two of its vertices
+struct InsertedBorderVertex
+{
+    unsigned previous;
+    unsigned next;
+    float t;
+};
+
+static size_t getBorderCellCount(const CDBElevationEdgeCache::Edge *edge, size_t cellCount) noexcept;
+
+static std::vector<size_t> scaleNeighborEdgeOffsets(const CDBElevationEdgeCache::Edge *edge,
+                                                    size_t cellCount);
+
+static void stitchRegularGridBorders(const CDBElevationEdgeCache::TileEdges &tileEdges,
+                                     size_t cellCount,
+                                     const std::vector<unsigned> &usedVertices,
+                                     std::vector<glm::dvec3> &positions);
+
+static std::vector<InsertedBorderVertex> insertFinerBorderVertices(
+    const CDBElevationEdgeCache::TileEdges &tileEdges,
+    size_t cellCount,
+    const std::vector<unsigned> &usedVertices,
+    std::vector<glm::dvec3> &positions,
+    Mesh &simplified);
+
+static void publishRegularGridBorders(CDBElevationEdgeCache::TileEdges &tileEdges,
+                                      size_t cellCount,
+                                      const std::vector<unsigned> &usedVertices,
+                                      const std::vector<glm::dvec3> &positions);
+
+CDBElevationGrid::CDBElevationGrid(
+    Heights heights, size_t width, size_t height, glm::dvec2 pixelSize, CDBTile tile)
+    : m_heights{std::move(heights)}
+    , m_width{width}
+    , m_height{height}
+    , m_pixelSize{pixelSize}
+    , m_tile{std::move(tile)}
+{}
+
+size_t CDBElevationGrid::getHeightCount() const noexcept
+{
+    return visitHeights([](const auto &heights) { return heights.size(); });
+}
+
+size_t CDBElevationGrid::getHeightsByteLength() const noexcept
+{
+    return visitHeights([](const auto &heights) { return heights.size() * sizeof(heights.front()); });
+}
+
+double CDBElevationGrid::getHeightAt(size_t index) const
+{
+    return visitHeights([index](const auto &heights) { return static_cast<double>(heights[index]); });
+}
+
+double CDBElevationGrid::sampleHeight(const Core::Cartographic &point) const
+{
+    // nearest pixel of the point, with the first row of the raster on the north edge of the tile
+    Core::GlobeRectangle rectangle = m_tile->getBoundRegion().getRectangle();
+    int rasterXSize = static_cast<int>(m_width);
+    int rasterYSize = static_cast<int>(m_height);
+    double gapX = rectangle.computeWidth() / rasterXSize;
+    double gapY = rectangle.computeHeight() / rasterYSize;
+
+    int x = static_cast<int>(glm::floor((point.longitude - rectangle.getWest()) / gapX));
+    x = glm::min(x, rasterXSize - 1);
+    int y = static_cast<int>(glm::floor((point.latitude - rectangle.getSouth()) / gapY));
+    y = glm::min(rasterYSize - y - 1, rasterYSize - 1);
+    if (x < 0 || y < 0) {
+        return 0.0;
+    }
+
+    return getHeightAt(static_cast<size_t>(y) * m_width + static_cast<size_t>(x));
+}
+
+void CDBElevationGrid::clampPoints(std::vector<Core::Cartographic> &points,
+                                   const std::vector<size_t> &pointIndices) const
+{
+    for (auto i : pointIndices) {
+        points[i].height = sampleHeight(points[i]);
+    }
+}
+
+std::optional<CDBElevationGrid> CDBElevationGrid::createFromFile(const std::filesystem::path &file,
+                                                                 const CDBTile &tile,
+                                                                 GDALDatasetPool *datasetPool)
+{
+    PooledGDALDataset rasterData = openRasterDataset(file, datasetPool);
+
+    if (rasterData == nullptr) {
+        return std::nullopt;
+    }
+
+    // retrieve raster basic info
+    double geoTransform[6];
+    rasterData->GetGeoTransform(geoTransform);
+    if (geoTransform[2] != 0.0 || geoTransform[4] != 0.0) {
+        return std::nullopt;
+    }
+
+    glm::ivec2 rasterSize(rasterData->GetRasterXSize(), rasterData->GetRasterYSize());
+    glm::dvec2 pixelSize(geoTransform[1], geoTransform[5]);
+
+    // retrieve heights
+    auto elevationHeights = getRasterElevationHeights(rasterData, rasterSize);
+    if (!elevationHeights) {
+        return std::nullopt;
+    }
+
+    return CDBElevationGrid(std::move(*elevationHeights),
+                            static_cast<size_t>(rasterSize.x),
+                            static_cast<size_t>(rasterSize.y),
+                            pixelSize,
+                            tile);
+}
+
+CDBElevationGridCache::CDBElevationGridCache(size_t memoryBudget, GDALDatasetPool *datasetPool)
+    : m_memoryBudget{memoryBudget}
+    , m_datasetPool{datasetPool}
+    , m_statistics{0, 0, 0, 0}
+{}
+
+std::shared_ptr<const CDBElevationGrid> CDBElevationGridCache::locateGrid(const CDBTile &tile,
+                                                                          const std::filesystem::path &file)
+{
+    std::promise<std::shared_ptr<const CDBElevationGrid>> loadedGrid;
+    std::shared_future<std::shared_ptr<const CDBElevationGrid>> grid;
+    bool isLoader = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto gridIt = m_tileToGrid.find(tile.getKey());
+        if (gridIt != m_tileToGrid.end()) {
+            ++m_statistics.hits;
+            m_LRUTiles.splice(m_LRUTiles.begin(), m_LRUTiles, gridIt->second.LRUPosition);
+            grid = gridIt->second.grid;
+        } else {
+            ++m_statistics.misses;
+            grid = loadedGrid.get_future().share();
+            m_LRUTiles.emplace_front(tile.getKey());
+            m_tileToGrid.insert({tile.getKey(), CachedGrid{grid, m_LRUTiles.begin(), 0, false}});
+            isLoader = true;
+        }
+    }
+
+    // the first caller decodes the grid right away, so the others never wait on a task that hasn't started
+    if (isLoader) {
+        size_t bytes = 0;
+        try {
+            std::shared_ptr<const CDBElevationGrid> decodedGrid;
+            auto elevationGrid = CDBElevationGrid::createFromFile(file, tile, m_datasetPool);
+            if (elevationGrid) {
+                bytes = elevationGrid->getHeightsByteLength();
+                decodedGrid = std::make_shared<const CDBElevationGrid>(std::move(*elevationGrid));
+            }
+
+            loadedGrid.set_value(std::move(decodedGrid));
+        } catch (...) {
+            loadedGrid.set_exception(std::current_exception());
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &cachedGrid = m_tileToGrid.at(tile.getKey());
+        cachedGrid.bytes = bytes;
+        cachedGrid.isLoaded = true;
+        m_statistics.bytes += bytes;
+        if (m_memoryBudget != 0) {
+            evictGrids(m_memoryBudget, &tile.getKey());
+        }
+    }
+
+    return grid.get();
+}
+
+CDBElevationGridCache::Statistics CDBElevationGridCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void CDBElevationGridCache::shrink()
+{
+    // the most recently used grids are kept, since the next tiles are likely to read them again
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t maxBytes = m_memoryBudget == 0 ? m_statistics.bytes : m_memoryBudget;
+    evictGrids(maxBytes / 2, nullptr);
+}
+
+void CDBElevationGridCache::evictGrids(size_t maxBytes, const CDBTileKey *keptTile)
+{
+    // the grids still being decoded are kept, so their loaders find them once done
+    auto LRUTile = m_LRUTiles.end();
+    while (m_statistics.bytes > maxBytes && LRUTile != m_LRUTiles.begin()) {
+        --LRUTile;
+        auto cachedGrid = m_tileToGrid.find(*LRUTile);
+        if ((keptTile && *LRUTile == *keptTile) || !cachedGrid->second.isLoaded) {
+            continue;
+        }
+
+        m_statistics.bytes -= cachedGrid->second.bytes;
+        ++m_statistics.evictions;
+        m_tileToGrid.erase(cachedGrid);
+        LRUTile = m_LRUTiles.erase(LRUTile);
+    }
+}
+
+CDBElevationEdgeCache::TileEdges::~TileEdges() noexcept
+{
+    for (auto &reservedEdge : m_reservedEdges) {
+        if (reservedEdge) {
+            reservedEdge->set_value(nullptr);
+        }
+    }
+}
+
+void CDBElevationEdgeCache::TileEdges::publishEdge(size_t side, Edge edge)
+{
+    m_reservedEdges[side]->set_value(std::make_shared<const Edge>(std::move(edge)));
+    m_reservedEdges[side] = nullptr;
+}
+
+CDBElevationEdgeCache::TileEdges CDBElevationEdgeCache::acquireEdges(const CDBTile &tile,
+                                                                     const std::array<glm::dvec3, 4> &corners)
+{
+    // the north and east borders are the south and west borders of the neighbors, and each corner is the
+    // south west corner of one of the tiles around it
+    auto getNeighborKey = [&tile](int UREFOffset, int RREFOffset) {
+        CDBTileKey key = tile.getKey();
+        key.UREF += UREFOffset;
+        key.RREF += RREFOffset;
+        return key;
+    };
+
+    std::array<SharedEdges *, 4> edgeMaps{&m_southEdges, &m_westEdges, &m_southEdges, &m_westEdges};
+    std::array<CDBTileKey, 4> edgeKeys{
+        getNeighborKey(1, 0), getNeighborKey(0, 1), tile.getKey(), tile.getKey()};
+    std::array<CDBTileKey, 4> cornerKeys{
+        getNeighborKey(1, 0), getNeighborKey(1, 1), getNeighborKey(0, 1), tile.getKey()};
+
+    TileEdges tileEdges;
+    std::array<std::shared_future<std::shared_ptr<const Edge>>, 4> neighborEdges;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t side = 0; side < edgeKeys.size(); ++side) {
+            auto &edges = *edgeMaps[side];
+            auto edgeIt = edges.find(edgeKeys[side]);
+            if (edgeIt == edges.end()) {
+                auto reservedEdge = std::make_shared<std::promise<std::shared_ptr<const Edge>>>();
+                edges.insert({edgeKeys[side], reservedEdge->get_future().share()});
+                tileEdges.m_reservedEdges[side] = std::move(reservedEdge);
+            } else {
+                // a border is shared by two tiles, so it is dropped once the second one has it
+                neighborEdges[side] = std::move(edgeIt->second);
+                edges.erase(edgeIt);
+            }
+        }
+
+        for (size_t corner = 0; corner < cornerKeys.size(); ++corner) {
+            auto cornerIt = m_southWestCorners.find(cornerKeys[corner]);
+            if (cornerIt == m_southWestCorners.end()) {
+                m_southWestCorners.insert({cornerKeys[corner], SharedCorner{corners[corner], 1}});
+                tileEdges.m_corners[corner] = corners[corner];
+            } else {
+                tileEdges.m_corners[corner] = cornerIt->second.position;
+                if (++cornerIt->second.tileCount == 4) {
+                    m_southWestCorners.erase(cornerIt);
+                }
+            }
+        }
+    }
+
+    for (size_t side = 0; side < neighborEdges.size(); ++side) {
+        if (neighborEdges[side].valid()) {
+            tileEdges.m_neighborEdges[side] = neighborEdges[side].get();
+        }
+    }
+
+    return tileEdges;
+}
+
 CDBElevation::CDBElevation(Mesh uniformGridMesh, size_t gridWidth, size_t gridHeight, CDBTile tile)
+    : CDBElevation(std::make_shared<Mesh>(std::move(uniformGridMesh)),
+                   gridWidth,
+                   glm::uvec2(0),
+                   gridWidth,
+                   gridHeight,
+                   std::nullopt,
+                   std::make_shared<ErrorPyramid>(),
+                   std::make_shared<GridNormals>(),
+                   std::move(tile))
+{}
+
+CDBElevation::CDBElevation(std::shared_ptr<Mesh> gridMesh,
+                           size_t gridMeshWidth,
+                           glm::uvec2 regionBegin,
+                           size_t gridWidth,
+                           size_t gridHeight,
+                           std::optional<UVTransform> regionUVTransform,
+                           std::shared_ptr<ErrorPyramid> errorPyramid,
+                           std::shared_ptr<GridNormals> gridNormals,
+                           CDBTile tile)
     : m_gridWidth{gridWidth}
     , m_gridHeight{gridHeight}
-    , m_uniformGridMesh{std::move(uniformGridMesh)}
+    , m_gridMesh{std::move(gridMesh)}
+    , m_gridMeshWidth{gridMeshWidth}
+    , m_regionBegin{regionBegin}
+    , m_UVTransform{regionUVTransform}
+    , m_errorPyramid{std::move(errorPyramid)}
+    , m_gridNormals{std::move(gridNormals)}
     , m_tile{std::move(tile)}
 {}
 
-Mesh CDBElevation::createSimplifiedMesh(size_t targetIndexCount, float targetError) const
+const Mesh &CDBElevation::getUniformGridMesh() const
+{
+    if (isWholeGridMesh() && !m_UVTransform) {
+        return *m_gridMesh;
+    }
+
+    if (!m_regionMesh) {
+        m_regionMesh = createRegionMesh();
+    }
+
+    return *m_regionMesh;
+}
+
+bool CDBElevation::isWholeGridMesh() const noexcept
 {
-    std::vector<unsigned int> lod(m_uniformGridMesh.indices.size());
-    lod.resize(meshopt_simplify(&lod[0],
-                                m_uniformGridMesh.indices.data(),
-                                m_uniformGridMesh.indices.size(),
-                                glm::value_ptr(m_uniformGridMesh.positionRTCs[0]),
-                                m_uniformGridMesh.positionRTCs.size(),
-                                sizeof(glm::vec3),
-                                targetIndexCount,
-                                targetError));
+    return m_regionBegin == glm::uvec2(0)
+           && (m_gridWidth + 1) * (m_gridHeight + 1) == m_gridMesh->getVertexCount();
+}
+
+bool CDBElevation::isRegularGridRegion() const noexcept
+{
+    // sub-regions split their parent in halves, so they stay aligned on the triangles of the error pyramid
+    size_t gridMeshVerticesWidth = m_gridMeshWidth + 1;
+    return isPowerOfTwo(m_gridMeshWidth)
+           && gridMeshVerticesWidth * gridMeshVerticesWidth == m_gridMesh->getVertexCount()
+           && isPowerOfTwo(m_gridWidth) && m_gridWidth == m_gridHeight && m_regionBegin.x % m_gridWidth == 0
+           && m_regionBegin.y % m_gridWidth == 0;
+}
+
+Mesh CDBElevation::createSimplifiedMesh(size_t targetIndexCount,
+                                        float targetError,
+                                        bool generateNormals,
+                                        CDBElevationEdgeCache *edgeCache)
+{
+    if (m_simplifiedMesh && m_simplifiedMesh->targetIndexCount == targetIndexCount
+        && m_simplifiedMesh->targetError == targetError && m_simplifiedMesh->hasNormals == generateNormals) {
+        return m_simplifiedMesh->mesh;
+    }
+
+    const Mesh &uniformGridMesh = getUniformGridMesh();
+    std::vector<unsigned int> lod;
+    std::optional<CDBElevationEdgeCache::TileEdges> tileEdges;
+    std::array<std::vector<size_t>, 4> neighborOffsets;
+    if (isRegularGridRegion()) {
+        unsigned gridSize = static_cast<unsigned>(m_gridMeshWidth + 1);
+        std::call_once(m_errorPyramid->computed, [this, gridSize]() {
+            m_errorPyramid->errors = computeRegularGridErrors(*m_gridMesh, gridSize);
+        });
+
+        // the vertices kept by the neighbors on their borders are kept by this region as well
+        if (edgeCache) {
+            size_t cellCount = m_gridWidth;
+            size_t lastRow = cellCount * (cellCount + 1);
+            std::array<glm::dvec3, 4> corners{uniformGridMesh.getPosition(0),
+                                              uniformGridMesh.getPosition(cellCount),
+                                              uniformGridMesh.getPosition(lastRow + cellCount),
+                                              uniformGridMesh.getPosition(lastRow)};
+            tileEdges.emplace(edgeCache->acquireEdges(*m_tile, corners));
+            for (size_t side = 0; side < neighborOffsets.size(); ++side) {
+                neighborOffsets[side] = scaleNeighborEdgeOffsets(tileEdges->getNeighborEdge(side).get(),
+                                                                 cellCount);
+            }
+        }
+
+        // like meshopt_simplify, the error is relative to the extents of the mesh
+        glm::dvec3 extents = uniformGridMesh.aabb->max - uniformGridMesh.aabb->min;
+        double maxExtent = glm::max(extents.x, glm::max(extents.y, extents.z));
+        RegularGridRegion region{
+            m_errorPyramid->errors, gridSize, m_regionBegin, static_cast<unsigned>(m_gridWidth), nullptr};
+        std::vector<bool> keptVertices;
+        if (tileEdges) {
+            keptVertices = computeKeptRegularGridVertices(region, neighborOffsets);
+            region.keptVertices = &keptVertices;
+        }
+
+        lod = simplifyRegularGrid(region, targetIndexCount, targetError * static_cast<float>(maxExtent));
+    } else {
+        lod.resize(uniformGridMesh.indices.size());
+        lod.resize(meshopt_simplify(&lod[0],
+                                    uniformGridMesh.indices.data(),
+                                    uniformGridMesh.indices.size(),
+                                    glm::value_ptr(uniformGridMesh.positionRTCs[0]),
+                                    uniformGridMesh.positionRTCs.size(),
+                                    sizeof(glm::vec3),
+                                    targetIndexCount,
+                                    targetError));
+    }
+
+    // count the vertices kept by the simplification so the new mesh is allocated once
+    size_t totalVertices = uniformGridMesh.getVertexCount();
+    std::vector<bool> isVertexUsed(totalVertices, false);
+    size_t totalUsedVertices = 0;
+    for (auto idx : lod) {
+        if (!isVertexUsed[idx]) {
+            isVertexUsed[idx] = true;
+            ++totalUsedVertices;
+        }
+    }
 
     Mesh simplified;
     simplified.aabb = AABB();
-    simplified.material = m_uniformGridMesh.material;
+    simplified.material = uniformGridMesh.material;
+    simplified.indices.reserve(lod.size());
+    simplified.positionRTCs.reserve(totalUsedVertices);
+    simplified.UVs.reserve(totalUsedVertices);
+
+    std::vector<unsigned> usedVertices;
+    usedVertices.reserve(totalUsedVertices);
 
     const auto &ellipsoid = Core::Ellipsoid::WGS84;
     const auto &boundRegion = m_tile->getBoundRegion();
@@ -56,28 +510,30 @@ Mesh CDBElevation::createSimplifiedMesh(size_t targetIndexCount, float targetErr
     auto tileCenter = rectangle.computeCenter();
     auto geodeticNormal = ellipsoid.geodeticSurfaceNormal(tileCenter);
     unsigned count = 0;
-    std::vector<int> visible(m_uniformGridMesh.indices.size(), -1);
+    std::vector<int> visible(totalVertices, -1);
     for (size_t i = 0; i < lod.size(); i += 3) {
         auto idx0 = lod[i];
         auto idx1 = lod[i + 1];
         auto idx2 = lod[i + 2];
 
-        glm::dvec3 p0 = m_uniformGridMesh.positions[idx0];
-        glm::dvec3 p1 = m_uniformGridMesh.positions[idx1];
-        glm::dvec3 p2 = m_uniformGridMesh.positions[idx2];
+        glm::dvec3 p0 = uniformGridMesh.getPosition(idx0);
+        glm::dvec3 p1 = uniformGridMesh.getPosition(idx1);
+        glm::dvec3 p2 = uniformGridMesh.getPosition(idx2);
 
         glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
         if (glm::dot(normal, geodeticNormal) < 0.0) {
-            extractVerticesFromExistingSimplifiedMesh(m_uniformGridMesh,
+            extractVerticesFromExistingSimplifiedMesh(uniformGridMesh,
                                                       simplified,
+                                                      usedVertices,
                                                       visible,
                                                       count,
                                                       idx2,
                                                       idx1,
                                                       idx0);
         } else {
-            extractVerticesFromExistingSimplifiedMesh(m_uniformGridMesh,
+            extractVerticesFromExistingSimplifiedMesh(uniformGridMesh,
                                                       simplified,
+                                                      usedVertices,
                                                       visible,
                                                       count,
                                                       idx0,
@@ -86,17 +542,71 @@ Mesh CDBElevation::createSimplifiedMesh(size_t targetIndexCount, float targetErr
         }
     }
 
+    std::vector<glm::dvec3> positions;
+    positions.reserve(usedVertices.size());
+    for (auto idx : usedVertices) {
+        positions.emplace_back(uniformGridMesh.getPosition(idx));
+    }
+
+    // the borders decimated by the neighbors are moved on the borders of the neighbors, the vertices of finer
+    // neighbors are inserted between them, and the borders reserved for this region are published once its
+    // vertices are known
+    std::vector<InsertedBorderVertex> insertedVertices;
+    if (tileEdges) {
+        stitchRegularGridBorders(*tileEdges, m_gridWidth, usedVertices, positions);
+        insertedVertices = insertFinerBorderVertices(
+            *tileEdges, m_gridWidth, usedVertices, positions, simplified);
+        publishRegularGridBorders(*tileEdges, m_gridWidth, usedVertices, positions);
+        simplified.aabb = AABB();
+        for (const auto &position : positions) {
+            simplified.aabb->merge(position);
+        }
+    }
+
     // calculate position rtc
-    simplified.positionRTCs.reserve(simplified.positions.size());
     glm::dvec3 center = simplified.aabb->center();
-    for (size_t i = 0; i < simplified.positions.size(); ++i) {
-        glm::vec3 positionRTC = simplified.positions[i] - center;
+    for (const auto &position : positions) {
+        glm::vec3 positionRTC = position - center;
         simplified.positionRTCs.emplace_back(positionRTC);
     }
 
+    if (generateNormals) {
+        computeGridNormals();
+        simplified.normals.reserve(positions.size());
+        for (auto idx : usedVertices) {
+            simplified.normals.emplace_back(m_gridNormals->normals[getGridMeshIndex(idx)]);
+        }
+
+        for (const auto &vertex : insertedVertices) {
+            simplified.normals.emplace_back(glm::normalize(
+                glm::mix(simplified.normals[vertex.previous], simplified.normals[vertex.next], vertex.t)));
+        }
+    }
+
+    m_simplifiedMesh = SimplifiedMesh{targetIndexCount, targetError, generateNormals, simplified};
     return simplified;
 }
 
+void CDBElevation::computeGridNormals() const
+{
+    std::call_once(m_gridNormals->computed, [this]() {
+        m_gridNormals->normals = computeGridMeshNormals(*m_gridMesh, m_gridMeshWidth + 1);
+    });
+}
+
+std::vector<glm::vec3> CDBElevation::createUniformGridNormals() const
+{
+    computeGridNormals();
+    size_t totalVertices = (m_gridWidth + 1) * (m_gridHeight + 1);
+    std::vector<glm::vec3> normals;
+    normals.reserve(totalVertices);
+    for (size_t i = 0; i < totalVertices; ++i) {
+        normals.emplace_back(m_gridNormals->normals[getGridMeshIndex(i)]);
+    }
+
+    return normals;
+}
+
 void CDBElevation::indexUVRelativeToParent(const CDBTile &parentTile)
 {
     auto parentLevel = parentTile.getLevel();
@@ -113,13 +623,24 @@ void CDBElevation::indexUVRelativeToParent(const CDBTile &parentTile)
     double beginU = static_cast<double>(m_tile->getRREF()) / relativeWidth;
     double beginV = (relativeWidth - static_cast<double>(m_tile->getUREF()) - 1) / relativeWidth;
     glm::vec2 beginUV = glm::vec2(static_cast<float>(beginU), static_cast<float>(beginV));
-    m_uniformGridMesh.UVs.clear();
-    m_uniformGridMesh.UVs.reserve(verticesHeight * verticesWidth);
+    UVTransform transform{glm::dvec2(beginUV), glm::dvec2(invWidth)};
+
+    // a grid mesh that no sub-region refers to is updated in place. Otherwise the UVs are computed when the
+    // region mesh is created
+    m_regionMesh = std::nullopt;
+    m_simplifiedMesh = std::nullopt;
+    if (!isWholeGridMesh() || m_gridMesh.use_count() > 1) {
+        m_UVTransform = transform;
+        return;
+    }
+
+    m_UVTransform = std::nullopt;
+    m_gridMesh->UVs.clear();
+    m_gridMesh->UVs.reserve(verticesHeight * verticesWidth);
     for (size_t y = 0; y < verticesHeight; ++y) {
         for (size_t x = 0; x < verticesWidth; ++x) {
-            double u = static_cast<double>(x) * invWidth + beginUV.x;
-            double v = static_cast<double>(y) * invWidth + beginUV.y;
-            m_uniformGridMesh.UVs.emplace_back(static_cast<float>(u), static_cast<float>(v));
+            glm::dvec2 UV = transform.offset + transform.scale * glm::dvec2(x, y);
+            m_gridMesh->UVs.emplace_back(UV);
         }
     }
 }
@@ -182,7 +703,8 @@ std::optional<CDBElevation> CDBElevation::createSouthEastSubRegion(bool reindexU
     return createSubRegion(regionBegin, CDBTile::createSouthEastForPositiveLOD(*m_tile), reindexUV);
 }
 
-std::optional<CDBElevation> CDBElevation::createFromFile(const std::filesystem::path &file)
+std::optional<CDBElevation> CDBElevation::createFromFile(const std::filesystem::path &file,
+                                                         CDBElevationGridCache *gridCache)
 {
     if (file.extension() != ".tif") {
         return std::nullopt;
@@ -195,26 +717,36 @@ std::optional<CDBElevation> CDBElevation::createFromFile(const std::filesystem::
 
     // CS_1 == 1 && CS_2 == 1: A grid of data representing the Elevation at the surface of the Earth.
     if (tile->getCS_1() == 1 && tile->getCS_2() == 1) {
-        // triangulate raster mesh
-        const Core::BoundingRegion &region = tile->getBoundRegion();
-        const Core::GlobeRectangle &rectangle = region.getRectangle();
-        Core::Cartographic topLeft(rectangle.getWest(), rectangle.getNorth());
-        glm::ivec2 rasterSize(0);
-        Mesh uniformGridMesh;
-        loadElevation(file, topLeft, rasterSize, uniformGridMesh);
+        if (gridCache) {
+            auto grid = gridCache->locateGrid(*tile, file);
+            return grid ? createFromGrid(*grid) : std::nullopt;
+        }
 
-        if (uniformGridMesh.positions.empty()) {
-            return std::nullopt;
+        auto grid = CDBElevationGrid::createFromFile(file, *tile);
+        if (grid) {
+            return createFromGrid(*grid);
         }
+    }
 
-        // initialize grid size
-        size_t gridWidth = static_cast<size_t>(rasterSize.x);
-        size_t gridHeight = static_cast<size_t>(rasterSize.y);
+    return std::nullopt;
+}
 
-        return CDBElevation(std::move(uniformGridMesh), gridWidth, gridHeight, *tile);
+std::optional<CDBElevation> CDBElevation::createFromGrid(const CDBElevationGrid &grid)
+{
+    // triangulate raster mesh
+    const CDBTile &tile = grid.getTile();
+    const Core::BoundingRegion &region = tile.getBoundRegion();
+    const Core::GlobeRectangle &rectangle = region.getRectangle();
+    Core::Cartographic topLeft(rectangle.getWest(), rectangle.getNorth());
+    glm::uvec2 rasterSize(static_cast<unsigned>(grid.getWidth()), static_cast<unsigned>(grid.getHeight()));
+    Mesh uniformGridMesh = grid.visitHeights([&](const auto &heights) {
+        return generateElevationMesh(heights, topLeft, rasterSize, grid.getPixelSize());
+    });
+    if (uniformGridMesh.positionRTCs.empty()) {
+        return std::nullopt;
     }
 
-    return std::nullopt;
+    return CDBElevation(std::move(uniformGridMesh), grid.getWidth(), grid.getHeight(), tile);
 }
 
 CDBElevation CDBElevation::createSubRegion(glm::uvec2 regionBegin,
@@ -223,118 +755,635 @@ CDBElevation CDBElevation::createSubRegion(glm::uvec2 regionBegin,
 {
     size_t regionGridWidth = m_gridWidth / 2;
     size_t regionGridHeight = m_gridHeight / 2;
-    Mesh elevation = createSubRegionMesh(regionBegin,
-                                         regionBegin + glm::uvec2(regionGridWidth, regionGridHeight),
-                                         reindexUV);
 
-    return CDBElevation(elevation, regionGridWidth, regionGridHeight, subRegionTile);
+    // a region either maps the whole texture of its tile or keeps the UVs of this elevation
+    std::optional<UVTransform> regionUVTransform;
+    if (reindexUV) {
+        regionUVTransform = UVTransform{glm::dvec2(0.0),
+                                        glm::dvec2(1.0 / static_cast<double>(regionGridWidth),
+                                                   1.0 / static_cast<double>(regionGridHeight))};
+    } else if (m_UVTransform) {
+        regionUVTransform = UVTransform{m_UVTransform->offset
+                                            + m_UVTransform->scale * glm::dvec2(regionBegin),
+                                        m_UVTransform->scale};
+    }
+
+    return CDBElevation(m_gridMesh,
+                        m_gridMeshWidth,
+                        m_regionBegin + regionBegin,
+                        regionGridWidth,
+                        regionGridHeight,
+                        regionUVTransform,
+                        m_errorPyramid,
+                        m_gridNormals,
+                        subRegionTile);
 }
 
-Mesh CDBElevation::createSubRegionMesh(glm::uvec2 gridFrom, glm::uvec2 gridTo, bool reindexUV) const
+Mesh CDBElevation::createRegionMesh() const
 {
     // create elevation mesh
     Mesh elevation;
     elevation.aabb = AABB();
 
-    size_t verticesWidth = m_gridWidth + 1;
-    size_t regionVerticesWidth = gridTo.x - gridFrom.x + 1;
-    size_t regionVerticesHeight = gridTo.y - gridFrom.y + 1;
-    size_t totalRegionIndices = (regionVerticesWidth - 1) * (regionVerticesHeight - 1) * 6;
-    size_t totalRegionVertices = regionVerticesWidth * regionVerticesHeight;
+    size_t gridMeshVerticesWidth = m_gridMeshWidth + 1;
+    uint32_t regionVerticesWidth = static_cast<uint32_t>(m_gridWidth + 1);
+    uint32_t regionVerticesHeight = static_cast<uint32_t>(m_gridHeight + 1);
+    size_t totalRegionIndices = m_gridWidth * m_gridHeight * 6;
+    size_t totalRegionVertices = static_cast<size_t>(regionVerticesWidth) * regionVerticesHeight;
 
-    elevation.positions.reserve(totalRegionVertices);
     elevation.positionRTCs.reserve(totalRegionVertices);
     elevation.UVs.reserve(totalRegionVertices);
     elevation.indices.reserve(totalRegionIndices);
-    for (uint32_t y = gridFrom.y; y < gridTo.y + 1; ++y) {
-        for (uint32_t x = gridFrom.x; x < gridTo.x + 1; ++x) {
-            size_t currIndex = y * verticesWidth + x;
-            glm::dvec3 position = m_uniformGridMesh.positions[currIndex];
-            elevation.aabb->merge(position);
-            elevation.positions.emplace_back(position);
-            if (reindexUV) {
-                elevation.UVs.emplace_back(glm::vec2(static_cast<float>(x - gridFrom.x)
-                                                         / static_cast<float>(regionVerticesWidth - 1),
-                                                     static_cast<float>(y - gridFrom.y)
-                                                         / static_cast<float>(regionVerticesHeight - 1)));
+    for (uint32_t y = 0; y < regionVerticesHeight; ++y) {
+        for (uint32_t x = 0; x < regionVerticesWidth; ++x) {
+            size_t gridMeshIndex = (m_regionBegin.y + y) * gridMeshVerticesWidth + m_regionBegin.x + x;
+            elevation.aabb->merge(m_gridMesh->getPosition(gridMeshIndex));
+            if (m_UVTransform) {
+                glm::dvec2 UV = m_UVTransform->offset + m_UVTransform->scale * glm::dvec2(x, y);
+                elevation.UVs.emplace_back(UV);
             } else {
-                elevation.UVs.emplace_back(m_uniformGridMesh.UVs[currIndex]);
+                elevation.UVs.emplace_back(m_gridMesh->UVs[gridMeshIndex]);
             }
 
-            if (x < gridTo.x && y < gridTo.y) {
-                uint32_t subX = x - gridFrom.x;
-                uint32_t subY = y - gridFrom.y;
-                elevation.indices.emplace_back(subY * regionVerticesWidth + subX + 1);
-                elevation.indices.emplace_back(subY * regionVerticesWidth + subX);
-                elevation.indices.emplace_back((subY + 1) * regionVerticesWidth + subX);
+            if (x < regionVerticesWidth - 1 && y < regionVerticesHeight - 1) {
+                elevation.indices.emplace_back(y * regionVerticesWidth + x + 1);
+                elevation.indices.emplace_back(y * regionVerticesWidth + x);
+                elevation.indices.emplace_back((y + 1) * regionVerticesWidth + x);
 
-                elevation.indices.emplace_back((subY + 1) * regionVerticesWidth + subX);
-                elevation.indices.emplace_back((subY + 1) * regionVerticesWidth + subX + 1);
-                elevation.indices.emplace_back(subY * regionVerticesWidth + subX + 1);
+                elevation.indices.emplace_back((y + 1) * regionVerticesWidth + x);
+                elevation.indices.emplace_back((y + 1) * regionVerticesWidth + x + 1);
+                elevation.indices.emplace_back(y * regionVerticesWidth + x + 1);
             }
         }
     }
 
     glm::dvec3 center = elevation.aabb->center();
-    for (size_t i = 0; i < totalRegionVertices; ++i) {
-        glm::vec3 positionRTC = elevation.positions[i] - center;
-        elevation.positionRTCs.emplace_back(positionRTC);
+    for (uint32_t y = 0; y < regionVerticesHeight; ++y) {
+        for (uint32_t x = 0; x < regionVerticesWidth; ++x) {
+            size_t gridMeshIndex = (m_regionBegin.y + y) * gridMeshVerticesWidth + m_regionBegin.x + x;
+            glm::vec3 positionRTC = m_gridMesh->getPosition(gridMeshIndex) - center;
+            elevation.positionRTCs.emplace_back(positionRTC);
+        }
     }
 
     return elevation;
 }
 
+size_t CDBElevation::getGridMeshIndex(size_t uniformGridIndex) const noexcept
+{
+    size_t regionVerticesWidth = m_gridWidth + 1;
+    size_t x = uniformGridIndex % regionVerticesWidth;
+    size_t y = uniformGridIndex / regionVerticesWidth;
+    return (m_regionBegin.y + y) * (m_gridMeshWidth + 1) + m_regionBegin.x + x;
+}
+
 void extractVerticesFromExistingSimplifiedMesh(const Mesh &existingSimplifiedMesh,
                                                Mesh &newSimplifiedMesh,
+                                               std::vector<unsigned> &usedVertices,
                                                std::vector<int> &remap,
                                                unsigned &totalUniqueVertices,
                                                unsigned idx0,
                                                unsigned idx1,
                                                unsigned idx2)
 {
-    if (remap[idx0] == -1) {
-        newSimplifiedMesh.aabb->merge(existingSimplifiedMesh.positions[idx0]);
-        newSimplifiedMesh.positions.emplace_back(existingSimplifiedMesh.positions[idx0]);
-        newSimplifiedMesh.UVs.emplace_back(existingSimplifiedMesh.UVs[idx0]);
+    // the RTC positions are only computed once the bounding box of the kept vertices is known
+    for (auto idx : {idx0, idx1, idx2}) {
+        if (remap[idx] == -1) {
+            newSimplifiedMesh.aabb->merge(existingSimplifiedMesh.getPosition(idx));
+            newSimplifiedMesh.UVs.emplace_back(existingSimplifiedMesh.UVs[idx]);
+            usedVertices.emplace_back(idx);
+
+            remap[idx] = static_cast<int>(totalUniqueVertices);
+            ++totalUniqueVertices;
+        }
+    }
+
+    newSimplifiedMesh.indices.emplace_back(remap[idx0]);
+    newSimplifiedMesh.indices.emplace_back(remap[idx1]);
+    newSimplifiedMesh.indices.emplace_back(remap[idx2]);
+}
+
+bool isPowerOfTwo(size_t value) noexcept
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+std::vector<unsigned> simplifyRegularGrid(const RegularGridRegion &region,
+                                          size_t targetIndexCount,
+                                          float maxError)
+{
+    // the grid has two root triangles split along its diagonal. The ones outside of the region are skipped
+    unsigned tileSize = region.gridSize - 1;
+    auto collectTriangles = [&](float error, std::vector<unsigned> *indices) {
+        return collectRegularGridTriangles(region,
+                                           error,
+                                           glm::uvec2(0, 0),
+                                           glm::uvec2(tileSize, tileSize),
+                                           glm::uvec2(tileSize, 0),
+                                           indices)
+               + collectRegularGridTriangles(region,
+                                             error,
+                                             glm::uvec2(tileSize, tileSize),
+                                             glm::uvec2(0, 0),
+                                             glm::uvec2(0, tileSize),
+                                             indices);
+    };
+
+    // the error pyramid is reused to search for the largest error that still keeps the target index count
+    if (collectTriangles(maxError, nullptr) < targetIndexCount) {
+        float lowError = 0.0f;
+        float highError = maxError;
+        for (int i = 0; i < 16; ++i) {
+            float error = 0.5f * (lowError + highError);
+            if (collectTriangles(error, nullptr) >= targetIndexCount) {
+                lowError = error;
+            } else {
+                highError = error;
+            }
+        }
+
+        maxError = lowError;
+    }
+
+    std::vector<unsigned> indices;
+    indices.reserve(collectTriangles(maxError, nullptr));
+    collectTriangles(maxError, &indices);
+    return indices;
+}
+
+std::vector<float> computeRegularGridErrors(const Mesh &gridMesh, unsigned gridSize)
+{
+    // Martini error pyramid of the right-angled triangles splitting the grid. The error at the middle of a
+    // hypotenuse is the largest error of its triangle and of every triangle below it
+    size_t tileSize = gridSize - 1;
+    std::vector<float> errors(static_cast<size_t>(gridSize) * gridSize, 0.0f);
+    if (tileSize < 2) {
+        return errors;
+    }
 
-        remap[idx0] = static_cast<int>(totalUniqueVertices);
-        ++totalUniqueVertices;
+    auto vertexIndex = [gridSize](glm::uvec2 point) {
+        return static_cast<size_t>(point.y) * gridSize + point.x;
+    };
+
+    size_t numTriangles = tileSize * tileSize * 2 - 2;
+    size_t numParentTriangles = numTriangles - tileSize * tileSize;
+    unsigned corner = static_cast<unsigned>(tileSize);
+    for (size_t i = numTriangles; i-- > 0;) {
+        // walk down from one of the two root triangles following the bits of the triangle id
+        size_t id = i + 2;
+        glm::uvec2 a(0, 0);
+        glm::uvec2 b(0, 0);
+        glm::uvec2 c(0, 0);
+        if (id & 1) {
+            b = glm::uvec2(corner, corner);
+            c = glm::uvec2(corner, 0);
+        } else {
+            a = glm::uvec2(corner, corner);
+            c = glm::uvec2(0, corner);
+        }
+
+        while ((id >>= 1) > 1) {
+            glm::uvec2 middle = (a + b) / 2u;
+            if (id & 1) {
+                b = a;
+                a = c;
+            } else {
+                a = b;
+                b = c;
+            }
+
+            c = middle;
+        }
+
+        size_t middleIndex = vertexIndex((a + b) / 2u);
+        glm::dvec3 first = gridMesh.getPosition(vertexIndex(a));
+        glm::dvec3 second = gridMesh.getPosition(vertexIndex(b));
+        glm::dvec3 interpolated = 0.5 * (first + second);
+        float error = static_cast<float>(glm::distance(interpolated, gridMesh.getPosition(middleIndex)));
+        errors[middleIndex] = glm::max(errors[middleIndex], error);
+        if (i < numParentTriangles) {
+            errors[middleIndex] = glm::max(errors[middleIndex], errors[vertexIndex((a + c) / 2u)]);
+            errors[middleIndex] = glm::max(errors[middleIndex], errors[vertexIndex((b + c) / 2u)]);
+        }
     }
 
-    if (remap[idx1] == -1) {
-        newSimplifiedMesh.aabb->merge(existingSimplifiedMesh.positions[idx1]);
-        newSimplifiedMesh.positions.emplace_back(existingSimplifiedMesh.positions[idx1]);
-        newSimplifiedMesh.UVs.emplace_back(existingSimplifiedMesh.UVs[idx1]);
+    return errors;
+}
 
-        remap[idx1] = static_cast<int>(totalUniqueVertices);
-        ++totalUniqueVertices;
+std::vector<glm::vec3> computeGridMeshNormals(const Mesh &gridMesh, size_t gridVerticesWidth)
+{
+    // the neighbors of a vertex are the ones next to it in the grid, so the normal is the cross product of
+    // the central differences along the rows and the columns, and the borders use one-sided differences. The
+    // positions are read as flat float rows and the inner loop has no branch, so the compiler vectorizes it
+    const auto &ellipsoid = Core::Ellipsoid::WGS84;
+    size_t totalVertices = gridMesh.getVertexCount();
+    size_t gridVerticesHeight = totalVertices / gridVerticesWidth;
+    std::vector<glm::vec3> normals(totalVertices, glm::vec3(0.0f));
+    if (gridVerticesWidth < 2 || gridVerticesHeight < 2) {
+        return normals;
     }
 
-    if (remap[idx2] == -1) {
-        newSimplifiedMesh.aabb->merge(existingSimplifiedMesh.positions[idx2]);
-        newSimplifiedMesh.positions.emplace_back(existingSimplifiedMesh.positions[idx2]);
-        newSimplifiedMesh.UVs.emplace_back(existingSimplifiedMesh.UVs[idx2]);
+    const float *positions = glm::value_ptr(gridMesh.positionRTCs[0]);
+    float *gridNormals = glm::value_ptr(normals[0]);
+    for (size_t y = 0; y < gridVerticesHeight; ++y) {
+        const float *north = positions + 3 * gridVerticesWidth * (y > 0 ? y - 1 : y);
+        const float *south = positions + 3 * gridVerticesWidth * (y + 1 < gridVerticesHeight ? y + 1 : y);
+        const float *row = positions + 3 * gridVerticesWidth * y;
+        float *rowNormals = gridNormals + 3 * gridVerticesWidth * y;
+        auto computeNormal = [=](size_t x, size_t west, size_t east) {
+            size_t i = 3 * x;
+            float eastX = row[3 * east] - row[3 * west];
+            float eastY = row[3 * east + 1] - row[3 * west + 1];
+            float eastZ = row[3 * east + 2] - row[3 * west + 2];
+            float southX = south[i] - north[i];
+            float southY = south[i + 1] - north[i + 1];
+            float southZ = south[i + 2] - north[i + 2];
+            rowNormals[i] = southY * eastZ - southZ * eastY;
+            rowNormals[i + 1] = southZ * eastX - southX * eastZ;
+            rowNormals[i + 2] = southX * eastY - southY * eastX;
+        };
+
+        computeNormal(0, 0, 1);
+        for (size_t x = 1; x + 1 < gridVerticesWidth; ++x) {
+            computeNormal(x, x - 1, x + 1);
+        }
 
-        remap[idx2] = static_cast<int>(totalUniqueVertices);
-        ++totalUniqueVertices;
+        computeNormal(gridVerticesWidth - 1, gridVerticesWidth - 2, gridVerticesWidth - 1);
     }
 
-    newSimplifiedMesh.indices.emplace_back(remap[idx0]);
-    newSimplifiedMesh.indices.emplace_back(remap[idx1]);
-    newSimplifiedMesh.indices.emplace_back(remap[idx2]);
+    // the rows of the grid go south, so the cross product of the south and east differences points up unless
+    // the raster is flipped, which is checked against the ellipsoid normal at the center of the grid
+    glm::dvec3 up = ellipsoid.geodeticSurfaceNormal(gridMesh.aabb->center());
+    size_t centerIndex = (gridVerticesHeight / 2) * gridVerticesWidth + gridVerticesWidth / 2;
+    float orientation = glm::dot(glm::dvec3(normals[centerIndex]), up) < 0.0 ? -1.0f : 1.0f;
+    for (size_t i = 0; i < totalVertices; ++i) {
+        auto &normal = normals[i];
+        float lengthSquared = glm::dot(normal, normal);
+        if (lengthSquared > static_cast<float>(Core::Math::EPSILON10)) {
+            normal *= orientation * glm::inversesqrt(lengthSquared);
+        } else {
+            normal = glm::vec3(ellipsoid.geodeticSurfaceNormal(gridMesh.getPosition(i)));
+        }
+    }
+
+    return normals;
 }
 
-std::vector<double> getRasterElevationHeights(GDALDatasetUniquePtr &rasterData, glm::ivec2 rasterSize)
+size_t collectRegularGridTriangles(const RegularGridRegion &region,
+                                   float maxError,
+                                   glm::uvec2 a,
+                                   glm::uvec2 b,
+                                   glm::uvec2 c,
+                                   std::vector<unsigned> *indices)
 {
-    auto heightBand = rasterData->GetRasterBand(1);
-    auto rasterDataType = heightBand->GetRasterDataType();
-    if (rasterDataType != GDT_Float32 && rasterDataType != GDT_Float64) {
+    glm::uvec2 minimum = glm::min(a, glm::min(b, c));
+    glm::uvec2 maximum = glm::max(a, glm::max(b, c));
+    glm::uvec2 regionEnd = region.begin + glm::uvec2(region.size);
+    if (glm::any(glm::lessThanEqual(maximum, region.begin))
+        || glm::any(glm::greaterThanEqual(minimum, regionEnd))) {
+        return 0;
+    }
+
+    // split the triangle at the middle of its hypotenuse until it is inside the region and either a single
+    // grid cell or good enough
+    bool isInsideRegion = glm::all(glm::greaterThanEqual(minimum, region.begin))
+                          && glm::all(glm::lessThanEqual(maximum, regionEnd));
+    glm::uvec2 middle = (a + b) / 2u;
+    unsigned legLength = (a.x > c.x ? a.x - c.x : c.x - a.x) + (a.y > c.y ? a.y - c.y : c.y - a.y);
+    if (legLength > 1
+        && (!isInsideRegion
+            || region.errors[static_cast<size_t>(middle.y) * region.gridSize + middle.x] > maxError
+            || (region.keptVertices
+                && (*region.keptVertices)[static_cast<size_t>(middle.y - region.begin.y) * (region.size + 1)
+                                          + middle.x - region.begin.x]))) {
+        return collectRegularGridTriangles(region, maxError, c, a, middle, indices)
+               + collectRegularGridTriangles(region, maxError, b, c, middle, indices);
+    }
+
+    if (!isInsideRegion) {
+        return 0;
+    }
+
+    if (indices) {
+        for (auto point : {a, b, c}) {
+            glm::uvec2 regionPoint = point - region.begin;
+            indices->emplace_back(regionPoint.y * (region.size + 1) + regionPoint.x);
+        }
+    }
+
+    return 3;
+}
+
+std::vector<bool> computeKeptRegularGridVertices(const RegularGridRegion &region,
+                                                 const std::array<std::vector<size_t>, 4> &borderOffsets)
+{
+    // a vertex is only in the mesh when the triangles whose hypotenuse it splits are, so the right-angle
+    // vertices of those triangles are kept as well, up to the corners. Like the propagation of the error
+    // pyramid, this keeps the mesh without T-junctions
+    unsigned size = region.size;
+    glm::uvec2 regionEnd = region.begin + glm::uvec2(size);
+    std::vector<bool> keptVertices(static_cast<size_t>(size + 1) * (size + 1), false);
+    std::vector<glm::uvec2> vertices;
+    for (size_t side = 0; side < borderOffsets.size(); ++side) {
+        for (auto offset : borderOffsets[side]) {
+            if (offset == 0 || offset >= size) {
+                continue;
+            }
+
+            unsigned regionOffset = static_cast<unsigned>(offset);
+            glm::uvec2 sideVertices[] = {glm::uvec2(regionOffset, 0),
+                                         glm::uvec2(size, regionOffset),
+                                         glm::uvec2(regionOffset, size),
+                                         glm::uvec2(0, regionOffset)};
+            vertices.emplace_back(region.begin + sideVertices[side]);
+        }
+    }
+
+    while (!vertices.empty()) {
+        glm::uvec2 vertex = vertices.back();
+        vertices.pop_back();
+        glm::uvec2 regionVertex = vertex - region.begin;
+        size_t index = static_cast<size_t>(regionVertex.y) * (size + 1) + regionVertex.x;
+        unsigned bits = vertex.x | vertex.y;
+        if (keptVertices[index] || bits == 0) {
+            continue;
+        }
+
+        keptVertices[index] = true;
+
+        // the vertex splits a hypotenuse of half length h, the lowest bit of its coordinates. Hypotenuses
+        // are horizontal or vertical when one coordinate is a multiple of 2h, and diagonals in a
+        // checkerboard of squares of 2h otherwise
+        int h = static_cast<int>(bits & (~bits + 1));
+        glm::ivec2 cell = glm::ivec2(vertex) / h;
+        glm::ivec2 offset;
+        if (cell.x % 2 == 1 && cell.y % 2 == 1) {
+            offset = ((cell.x + cell.y) / 2) % 2 == 1 ? glm::ivec2(h, -h) : glm::ivec2(h, h);
+        } else if (cell.x % 2 == 1) {
+            offset = glm::ivec2(0, h);
+        } else {
+            offset = glm::ivec2(h, 0);
+        }
+
+        for (glm::ivec2 parent : {glm::ivec2(vertex) + offset, glm::ivec2(vertex) - offset}) {
+            if (glm::all(glm::greaterThanEqual(parent, glm::ivec2(region.begin)))
+                && glm::all(glm::lessThanEqual(parent, glm::ivec2(regionEnd)))) {
+                vertices.emplace_back(parent);
+            }
+        }
+    }
+
+    return keptVertices;
+}
+
+size_t getBorderCellCount(const CDBElevationEdgeCache::Edge *edge, size_t cellCount) noexcept
+{
+    // the two sides of a border are matched at the resolution of the finer one, which only works when the
+    // cells of the coarser one are made of whole cells of the finer one
+    if (edge == nullptr || edge->cellCount == 0 || edge->offsets.empty() || cellCount == 0) {
+        return 0;
+    }
+
+    size_t finer = std::max(edge->cellCount, cellCount);
+    size_t coarser = std::min(edge->cellCount, cellCount);
+    return finer % coarser == 0 ? finer : 0;
+}
+
+std::vector<size_t> scaleNeighborEdgeOffsets(const CDBElevationEdgeCache::Edge *edge, size_t cellCount)
+{
+    // only the vertices of a finer border that this grid has are kept by the simplification. The others are
+    // inserted in the simplified mesh afterwards
+    size_t borderCellCount = getBorderCellCount(edge, cellCount);
+    if (borderCellCount == 0) {
         return {};
     }
 
+    size_t edgeScale = borderCellCount / edge->cellCount;
+    size_t scale = borderCellCount / cellCount;
+    std::vector<size_t> offsets;
+    offsets.reserve(edge->offsets.size());
+    for (auto offset : edge->offsets) {
+        size_t borderOffset = offset * edgeScale;
+        if (borderOffset % scale == 0) {
+            offsets.emplace_back(borderOffset / scale);
+        }
+    }
+
+    return offsets;
+}
+
+void stitchRegularGridBorders(const CDBElevationEdgeCache::TileEdges &tileEdges,
+                              size_t cellCount,
+                              const std::vector<unsigned> &usedVertices,
+                              std::vector<glm::dvec3> &positions)
+{
+    // the vertices kept by the neighbor take its positions, and the other vertices of the border are moved
+    // on the segment of the neighbor they are on, so the two sides of a border match without any crack
+    for (size_t i = 0; i < usedVertices.size(); ++i) {
+        size_t x = usedVertices[i] % (cellCount + 1);
+        size_t y = usedVertices[i] / (cellCount + 1);
+        bool isWest = x == 0;
+        bool isEast = x == cellCount;
+        bool isNorth = y == 0;
+        bool isSouth = y == cellCount;
+        if ((isWest || isEast) && (isNorth || isSouth)) {
+            positions[i] = tileEdges.getCorner(isNorth ? (isWest ? 0 : 1) : (isWest ? 3 : 2));
+            continue;
+        }
+
+        size_t side;
+        if (isNorth || isSouth) {
+            side = isNorth ? 0 : 2;
+        } else if (isWest || isEast) {
+            side = isEast ? 1 : 3;
+        } else {
+            continue;
+        }
+
+        const auto *edge = tileEdges.getNeighborEdge(side).get();
+        size_t borderCellCount = getBorderCellCount(edge, cellCount);
+        if (borderCellCount == 0) {
+            continue;
+        }
+
+        // the offsets of both sides are compared at the resolution of the finer one
+        const auto &offsets = edge->offsets;
+        size_t edgeScale = borderCellCount / edge->cellCount;
+        size_t offset = (side % 2 == 0 ? x : y) * (borderCellCount / cellCount);
+        auto nextIt = std::lower_bound(offsets.begin(),
+                                       offsets.end(),
+                                       offset,
+                                       [edgeScale](size_t edgeOffset, size_t value) {
+                                           return edgeOffset * edgeScale < value;
+                                       });
+        size_t next = static_cast<size_t>(nextIt - offsets.begin());
+        if (offsets[next] * edgeScale == offset) {
+            positions[i] = edge->positions[next];
+        } else {
+            size_t previous = next - 1;
+            double t = static_cast<double>(offset - offsets[previous] * edgeScale)
+                       / static_cast<double>((offsets[next] - offsets[previous]) * edgeScale);
+            positions[i] = glm::mix(edge->positions[previous], edge->positions[next], t);
+        }
+    }
+}
+
+std::vector<InsertedBorderVertex> insertFinerBorderVertices(const CDBElevationEdgeCache::TileEdges &tileEdges,
+                                                            size_t cellCount,
+                                                            const std::vector<unsigned> &usedVertices,
+                                                            std::vector<glm::dvec3> &positions,
+                                                            Mesh &simplified)
+{
+    // the vertices of a finer neighbor between two vertices of a border are inserted in the triangle on that
+    // segment, which is split in a fan around its opposite vertex, so the border has every vertex of the
+    // neighbor whichever side was simplified first
+    std::vector<InsertedBorderVertex> insertedVertices;
+    for (size_t side = 0; side < 4; ++side) {
+        const auto *edge = tileEdges.getNeighborEdge(side).get();
+        size_t borderCellCount = getBorderCellCount(edge, cellCount);
+        if (borderCellCount == 0 || borderCellCount == cellCount) {
+            continue;
+        }
+
+        size_t scale = borderCellCount / cellCount;
+        std::vector<std::pair<size_t, unsigned>> borderVertices;
+        std::vector<bool> isBorderVertex(positions.size(), false);
+        for (size_t i = 0; i < usedVertices.size(); ++i) {
+            size_t x = usedVertices[i] % (cellCount + 1);
+            size_t y = usedVertices[i] / (cellCount + 1);
+            bool isOnSide[] = {y == 0, x == cellCount, y == cellCount, x == 0};
+            if (isOnSide[side]) {
+                borderVertices.emplace_back((side % 2 == 0 ? x : y) * scale, static_cast<unsigned>(i));
+                isBorderVertex[i] = true;
+            }
+        }
+
+        std::sort(borderVertices.begin(), borderVertices.end());
+
+        // the corner in the indices where each border segment of the triangles begins
+        std::unordered_map<uint64_t, size_t> segmentCorners;
+        for (size_t i = 0; i < simplified.indices.size(); ++i) {
+            uint32_t a = simplified.indices[i];
+            uint32_t b = simplified.indices[i - i % 3 + (i + 1) % 3];
+            if (a < isBorderVertex.size() && b < isBorderVertex.size() && isBorderVertex[a]
+                && isBorderVertex[b]) {
+                segmentCorners[static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b)] = i;
+            }
+        }
+
+        const auto &offsets = edge->offsets;
+        for (size_t i = 1; i < borderVertices.size(); ++i) {
+            auto [previousOffset, previous] = borderVertices[i - 1];
+            auto [nextOffset, next] = borderVertices[i];
+            auto begin = std::upper_bound(offsets.begin(), offsets.end(), previousOffset);
+            auto end = std::lower_bound(begin, offsets.end(), nextOffset);
+            auto segmentCorner = segmentCorners.find(static_cast<uint64_t>(std::min(previous, next)) << 32
+                                                     | std::max(previous, next));
+            if (begin == end || segmentCorner == segmentCorners.end()) {
+                continue;
+            }
+
+            size_t corner = segmentCorner->second;
+            size_t triangle = corner - corner % 3;
+            uint32_t start = simplified.indices[corner];
+            uint32_t opposite = simplified.indices[triangle + (corner + 2) % 3];
+
+            // the inserted vertices follow the winding of the triangle from the start of its segment
+            std::vector<uint32_t> fan{start};
+            for (auto it = begin; it != end; ++it) {
+                auto offset = start == previous ? it : begin + (end - it - 1);
+                float t = static_cast<float>(*offset - previousOffset)
+                          / static_cast<float>(nextOffset - previousOffset);
+                fan.emplace_back(static_cast<uint32_t>(positions.size()));
+                positions.emplace_back(edge->positions[static_cast<size_t>(offset - offsets.begin())]);
+                simplified.UVs.emplace_back(glm::mix(simplified.UVs[previous], simplified.UVs[next], t));
+                insertedVertices.push_back({previous, next, t});
+            }
+
+            fan.emplace_back(start == previous ? next : previous);
+            simplified.indices[triangle] = fan[0];
+            simplified.indices[triangle + 1] = fan[1];
+            simplified.indices[triangle + 2] = opposite;
+            for (size_t j = 1; j + 1 < fan.size(); ++j) {
+                simplified.indices.insert(simplified.indices.end(), {fan[j], fan[j + 1], opposite});
+            }
+        }
+    }
+
+    return insertedVertices;
+}
+
+void publishRegularGridBorders(CDBElevationEdgeCache::TileEdges &tileEdges,
+                               size_t cellCount,
+                               const std::vector<unsigned> &usedVertices,
+                               const std::vector<glm::dvec3> &positions)
+{
+    std::array<std::vector<std::pair<size_t, glm::dvec3>>, 4> borderVertices;
+    for (size_t i = 0; i < usedVertices.size(); ++i) {
+        size_t x = usedVertices[i] % (cellCount + 1);
+        size_t y = usedVertices[i] / (cellCount + 1);
+        if (y == 0) {
+            borderVertices[0].emplace_back(x, positions[i]);
+        }
+
+        if (x == cellCount) {
+            borderVertices[1].emplace_back(y, positions[i]);
+        }
+
+        if (y == cellCount) {
+            borderVertices[2].emplace_back(x, positions[i]);
+        }
+
+        if (x == 0) {
+            borderVertices[3].emplace_back(y, positions[i]);
+        }
+    }
+
+    for (size_t side = 0; side < borderVertices.size(); ++side) {
+        if (!tileEdges.isReserved(side)) {
+            continue;
+        }
+
+        auto &vertices = borderVertices[side];
+        std::sort(vertices.begin(), vertices.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.first < rhs.first;
+        });
+
+        CDBElevationEdgeCache::Edge edge{cellCount, {}, {}};
+        edge.offsets.reserve(vertices.size());
+        edge.positions.reserve(vertices.size());
+        for (const auto &vertex : vertices) {
+            edge.offsets.emplace_back(vertex.first);
+            edge.positions.emplace_back(vertex.second);
+        }
+
+        tileEdges.publishEdge(side, std::move(edge));
+    }
+}
+
+std::optional<CDBElevationGrid::Heights> getRasterElevationHeights(PooledGDALDataset &rasterData,
+                                                                   glm::ivec2 rasterSize)
+{
+    // the samples are read in the type of the band, so GDAL copies them without converting each one
+    auto heightBand = rasterData->GetRasterBand(1);
+    switch (heightBand->GetRasterDataType()) {
+    case GDT_Float32:
+        return readRasterHeights<float>(heightBand, rasterSize);
+    case GDT_Float64:
+        return readRasterHeights<double>(heightBand, rasterSize);
+    case GDT_Int16:
+        return readRasterHeights<int16_t>(heightBand, rasterSize);
+    default:
+        return std::nullopt;
+    }
+}
+
+template<typename T>
+std::optional<CDBElevationGrid::Heights> readRasterHeights(GDALRasterBand *heightBand, glm::ivec2 rasterSize)
+{
     int rasterWidth = rasterSize.x;
     int rasterHeight = rasterSize.y;
-    std::vector<double> elevationHeights(static_cast<size_t>(rasterWidth * rasterHeight), 0.0);
+    std::vector<T> elevationHeights(static_cast<size_t>(rasterWidth) * static_cast<size_t>(rasterHeight));
     if (GDALRasterIO(heightBand,
                      GDALRWFlag::GF_Read,
                      0,
@@ -344,17 +1393,18 @@ std::vector<double> getRasterElevationHeights(GDALDatasetUniquePtr &rasterData,
                      elevationHeights.data(),
                      rasterWidth,
                      rasterHeight,
-                     GDALDataType::GDT_Float64,
+                     GDALSampleType<T>::value,
                      0,
                      0)
         != CE_None) {
-        return {};
+        return std::nullopt;
     }
 
-    return elevationHeights;
+    return CDBElevationGrid::Heights(std::move(elevationHeights));
 }
 
-Mesh generateElevationMesh(const std::vector<double> elevationHeights,
+template<typename Height>
+Mesh generateElevationMesh(const std::vector<Height> &elevationHeights,
                            Core::Cartographic topLeft,
                            glm::uvec2 rasterSize,
                            glm::dvec2 pixelSize)
@@ -376,22 +1426,40 @@ Mesh generateElevationMesh(const std::vector<double> elevationHeights,
 
     size_t totalVertices = verticesWidth * verticesHeight;
     size_t totalIndices = (verticesWidth - 1) * (verticesHeight - 1) * 6;
-    elevation.positions.reserve(totalVertices);
+    // the double positions are only needed until the RTC center is known, so they are not kept in the mesh
+    std::vector<glm::dvec3> positions;
+    positions.reserve(totalVertices);
     elevation.positionRTCs.reserve(totalVertices);
     elevation.UVs.reserve(totalVertices);
     elevation.indices.reserve(totalIndices);
 
+    // the vertices of a row share their latitude and the vertices of a column share their longitude
+    std::vector<double> longitudes;
+    longitudes.reserve(verticesWidth);
+    for (size_t x = 0; x < verticesWidth; ++x) {
+        longitudes.emplace_back(topLeft.longitude + glm::radians(static_cast<double>(x) * pixelSize.x));
+    }
+
+    std::vector<double> latitudes;
+    latitudes.reserve(verticesHeight);
+    for (size_t y = 0; y < verticesHeight; ++y) {
+        latitudes.emplace_back(topLeft.latitude + glm::radians(static_cast<double>(y) * pixelSize.y));
+    }
+
+    std::vector<double> heights;
+    heights.reserve(totalVertices);
     for (size_t y = 0; y < verticesHeight; ++y) {
         for (size_t x = 0; x < verticesWidth; ++x) {
-            double longitude = topLeft.longitude + glm::radians(static_cast<double>(x) * pixelSize.x);
-            double latitude = topLeft.latitude + glm::radians(static_cast<double>(y) * pixelSize.y);
-            double height = static_cast<double>(
-                elevationHeights[glm::min(y, rasterHeight - 1) * rasterWidth + glm::min(x, rasterWidth - 1)]);
-            Core::Cartographic cartographic(longitude, latitude, height);
-            glm::dvec3 position = ellipsoid.cartographicToCartesian(cartographic);
-
-            elevation.positions.emplace_back(position);
-            elevation.aabb->merge(position);
+            size_t index = glm::min(y, rasterHeight - 1) * rasterWidth + glm::min(x, rasterWidth - 1);
+            heights.emplace_back(static_cast<double>(elevationHeights[index]));
+        }
+    }
+
+    ellipsoid.cartographicGridToCartesian(longitudes, latitudes, heights, positions);
+
+    for (size_t y = 0; y < verticesHeight; ++y) {
+        for (size_t x = 0; x < verticesWidth; ++x) {
+            elevation.aabb->merge(positions[y * verticesWidth + x]);
             elevation.UVs.emplace_back(static_cast<float>(x) * inverseWidth,
                                        static_cast<float>(y) * inverseHeight);
             if (x < verticesWidth - 1 && y < verticesHeight - 1) {
@@ -408,46 +1476,12 @@ Mesh generateElevationMesh(const std::vector<double> elevationHeights,
 
     // calculate position rtc
     glm::dvec3 center = elevation.aabb->center();
-    for (size_t i = 0; i < totalVertices; ++i) {
-        glm::vec3 positionRTC = elevation.positions[i] - center;
+    for (const auto &position : positions) {
+        glm::vec3 positionRTC = position - center;
         elevation.positionRTCs.emplace_back(positionRTC);
     }
 
     return elevation;
 }
 
-void loadElevation(const std::filesystem::path &path,
-                   Core::Cartographic topLeft,
-                   glm::ivec2 &rasterSize,
-                   Mesh &mesh)
-{
-    std::string file = path.string();
-    GDALDatasetUniquePtr rasterData = GDALDatasetUniquePtr(
-        (GDALDataset *) GDALOpen(file.c_str(), GDALAccess::GA_ReadOnly));
-
-    if (rasterData == nullptr) {
-        return;
-    }
-
-    // retrieve raster basic info
-    double geoTransform[6];
-    rasterData->GetGeoTransform(geoTransform);
-    if (geoTransform[2] != 0.0 || geoTransform[4] != 0.0) {
-        return;
-    }
-
-    rasterSize = glm::uvec2(static_cast<unsigned>(rasterData->GetRasterXSize()),
-                            static_cast<unsigned>(rasterData->GetRasterYSize()));
-    glm::dvec2 pixelSize(geoTransform[1], geoTransform[5]);
-
-    // retrieve heights
-    auto elevationHeights = getRasterElevationHeights(rasterData, rasterSize);
-    if (elevationHeights.empty()) {
-        return;
-    }
-
-    // generate elevation mesh
-    mesh = generateElevationMesh(elevationHeights, topLeft, rasterSize, pixelSize);
-}
-
 } // namespace CDBTo3DTiles
@@ -2,20 +2,222 @@
 
 #include "CDBTile.h"
 #include "Cartographic.h"
+#include "GDALDatasetPool.h"
 #include "Scene.h"
 #include "gdal_priv.h"
+#include <array>
+#include <cstdint>
 #include <filesystem>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <variant>
+#include <vector>
 
 namespace CDBTo3DTiles {
 
+// heights of an elevation tile decoded once, so points can be sampled without going back to GDAL
+class CDBElevationGrid
+{
+public:
+    // the heights keep the sample type of the raster band, and are only converted to double when read
+    using Heights = std::variant<std::vector<float>, std::vector<double>, std::vector<int16_t>>;
+
+    CDBElevationGrid(Heights heights, size_t width, size_t height, glm::dvec2 pixelSize, CDBTile tile);
+
+    inline const Heights &getHeights() const noexcept { return m_heights; }
+
+    // calls the visitor with the vector of heights in its own type, so a loop over them is compiled per type
+    template<typename Visitor>
+    inline decltype(auto) visitHeights(Visitor &&visitor) const
+    {
+        return std::visit(std::forward<Visitor>(visitor), m_heights);
+    }
+
+    size_t getHeightCount() const noexcept;
+
+    size_t getHeightsByteLength() const noexcept;
+
+    // the height of the sample at the index, row by row from the north edge of the tile
+    double getHeightAt(size_t index) const;
+
+    inline size_t getWidth() const noexcept { return m_width; }
+
+    inline size_t getHeight() const noexcept { return m_height; }
+
+    inline glm::dvec2 getPixelSize() const noexcept { return m_pixelSize; }
+
+    inline const CDBTile &getTile() const noexcept { return *m_tile; }
+
+    double sampleHeight(const Core::Cartographic &point) const;
+
+    void clampPoints(std::vector<Core::Cartographic> &points, const std::vector<size_t> &pointIndices) const;
+
+    static std::optional<CDBElevationGrid> createFromFile(const std::filesystem::path &file,
+                                                          const CDBTile &tile,
+                                                          GDALDatasetPool *datasetPool = nullptr);
+
+private:
+    Heights m_heights;
+    size_t m_width;
+    size_t m_height;
+    glm::dvec2 m_pixelSize;
+    std::optional<CDBTile> m_tile;
+};
+
+// decoded grids of one GeoCell, shared by the terrain conversion and the model clamping. Each grid is decoded
+// by the first caller and the least recently used grids are dropped once they exceed the memory budget
+class CDBElevationGridCache
+{
+public:
+    struct Statistics
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t bytes;
+    };
+
+    // a memory budget of 0 keeps every grid. The files are opened from the pool when there is one
+    explicit CDBElevationGridCache(size_t memoryBudget = 0, GDALDatasetPool *datasetPool = nullptr);
+
+    CDBElevationGridCache(const CDBElevationGridCache &) = delete;
+
+    CDBElevationGridCache &operator=(const CDBElevationGridCache &) = delete;
+
+    std::shared_ptr<const CDBElevationGrid> locateGrid(const CDBTile &tile,
+                                                       const std::filesystem::path &file);
+
+    Statistics getStatistics() const;
+
+    // drops the least recently used grids down to half of the memory budget, or half of the decoded grids
+    // without one, to free memory while tiles are converted. The grids handed out stay valid for their owners
+    void shrink();
+
+private:
+    struct CachedGrid
+    {
+        std::shared_future<std::shared_ptr<const CDBElevationGrid>> grid;
+        std::list<CDBTileKey>::iterator LRUPosition;
+        size_t bytes;
+        bool isLoaded;
+    };
+
+    void evictGrids(size_t maxBytes, const CDBTileKey *keptTile);
+
+    size_t m_memoryBudget;
+    GDALDatasetPool *m_datasetPool;
+    mutable std::mutex m_mutex;
+    Statistics m_statistics;
+    std::list<CDBTileKey> m_LRUTiles;
+    std::unordered_map<CDBTileKey, CachedGrid> m_tileToGrid;
+};
+
+// borders of the elevation tiles of one GeoCell, so tiles of the same level next to each other keep the same
+// vertices on the border they share. The first tile simplified publishes the vertices it keeps on a border
+// and its neighbor keeps those at the same positions, so the terrain has no crack at any decimation error.
+// Grids of different sizes match at the resolution of the finer one, and the vertices of a finer border are
+// inserted in its coarser neighbor, so the result doesn't depend on which tile is simplified first. Corners
+// are taken from the first tile that reaches them
+class CDBElevationEdgeCache
+{
+public:
+    // vertices kept on a border, at offsets from its west or north end
+    struct Edge
+    {
+        size_t cellCount;
+        std::vector<size_t> offsets;
+        std::vector<glm::dvec3> positions;
+    };
+
+    // the borders of a tile in the order north, east, south, west and its corners in the order north west,
+    // north east, south east, south west. A border is either decimated by a neighbor or reserved for the
+    // tile. Reserved borders that are not published are released without vertices, so no neighbor waits
+    // for them forever
+    class TileEdges
+    {
+    public:
+        TileEdges() = default;
+
+        TileEdges(TileEdges &&) noexcept = default;
+
+        TileEdges &operator=(TileEdges &&) = delete;
+
+        ~TileEdges() noexcept;
+
+        inline const std::shared_ptr<const Edge> &getNeighborEdge(size_t side) const noexcept
+        {
+            return m_neighborEdges[side];
+        }
+
+        inline bool isReserved(size_t side) const noexcept { return m_reservedEdges[side] != nullptr; }
+
+        inline const glm::dvec3 &getCorner(size_t corner) const noexcept { return m_corners[corner]; }
+
+        void publishEdge(size_t side, Edge edge);
+
+    private:
+        friend class CDBElevationEdgeCache;
+
+        std::array<std::shared_ptr<const Edge>, 4> m_neighborEdges;
+        std::array<std::shared_ptr<std::promise<std::shared_ptr<const Edge>>>, 4> m_reservedEdges;
+        std::array<glm::dvec3, 4> m_corners;
+    };
+
+    CDBElevationEdgeCache() = default;
+
+    CDBElevationEdgeCache(const CDBElevationEdgeCache &) = delete;
+
+    CDBElevationEdgeCache &operator=(const CDBElevationEdgeCache &) = delete;
+
+    // waits for the borders a neighbor is decimating. Tiles never wait on a tile that reserved its borders
+    // after them, so they cannot wait on each other
+    TileEdges acquireEdges(const CDBTile &tile, const std::array<glm::dvec3, 4> &corners);
+
+private:
+    using SharedEdges = std::unordered_map<CDBTileKey, std::shared_future<std::shared_ptr<const Edge>>>;
+
+    struct SharedCorner
+    {
+        glm::dvec3 position;
+        size_t tileCount;
+    };
+
+    std::mutex m_mutex;
+    SharedEdges m_southEdges;
+    SharedEdges m_westEdges;
+    std::unordered_map<CDBTileKey, SharedCorner> m_southWestCorners;
+};
+
+// sub-regions are views over the grid mesh of the elevation they come from. Their vertices are only
+// created when the mesh of the region is requested, and they are simplified with the error pyramid of the
+// whole grid
 class CDBElevation
 {
 public:
     CDBElevation(Mesh uniformGridMesh, size_t gridWidth, size_t gridHeight, CDBTile tile);
 
-    Mesh createSimplifiedMesh(size_t targetIndexCount, float targetError) const;
+    // square grids of 2^k cells are decimated on the grid itself, other grids go through meshopt_simplify.
+    // The mesh of the last targets is kept, since the elevation of a negative LOD may be written again.
+    // Normals are gathered from the grid normals, so they keep the detail of the full resolution grid. With
+    // an edge cache, square grids keep the border vertices of the neighbors simplified before them. Keeping the
+    // mesh modifies the elevation, so one elevation is simplified by one thread at a time. Its sub-regions are
+    // elevations of their own and can be simplified by other threads
+    Mesh createSimplifiedMesh(size_t targetIndexCount,
+                              float targetError,
+                              bool generateNormals = false,
+                              CDBElevationEdgeCache *edgeCache = nullptr);
+
+    // normals of the grid mesh from the positions of the neighbors of each vertex, computed once for the grid
+    // and shared by its sub-regions
+    void computeGridNormals() const;
 
-    inline const Mesh &getUniformGridMesh() const noexcept { return m_uniformGridMesh; }
+    // the normals of the vertices of the uniform grid mesh
+    std::vector<glm::vec3> createUniformGridNormals() const;
+
+    const Mesh &getUniformGridMesh() const;
 
     inline size_t getGridWidth() const noexcept { return m_gridWidth; }
 
@@ -35,16 +237,70 @@ public:
 
     std::optional<CDBElevation> createSouthEastSubRegion(bool reindexUVs) const;
 
-    static std::optional<CDBElevation> createFromFile(const std::filesystem::path &file);
+    static std::optional<CDBElevation> createFromFile(const std::filesystem::path &file,
+                                                      CDBElevationGridCache *gridCache = nullptr);
+
+    static std::optional<CDBElevation> createFromGrid(const CDBElevationGrid &grid);
 
 private:
+    // UVs of a region computed from its grid coordinates instead of read from the grid mesh
+    struct UVTransform
+    {
+        glm::dvec2 offset;
+        glm::dvec2 scale;
+    };
+
+    // computed by the first region simplified and shared by every region of the grid mesh
+    struct ErrorPyramid
+    {
+        std::once_flag computed;
+        std::vector<float> errors;
+    };
+
+    struct GridNormals
+    {
+        std::once_flag computed;
+        std::vector<glm::vec3> normals;
+    };
+
+    struct SimplifiedMesh
+    {
+        size_t targetIndexCount;
+        float targetError;
+        bool hasNormals;
+        Mesh mesh;
+    };
+
+    CDBElevation(std::shared_ptr<Mesh> gridMesh,
+                 size_t gridMeshWidth,
+                 glm::uvec2 regionBegin,
+                 size_t gridWidth,
+                 size_t gridHeight,
+                 std::optional<UVTransform> regionUVTransform,
+                 std::shared_ptr<ErrorPyramid> errorPyramid,
+                 std::shared_ptr<GridNormals> gridNormals,
+                 CDBTile tile);
+
+    bool isWholeGridMesh() const noexcept;
+
+    bool isRegularGridRegion() const noexcept;
+
     CDBElevation createSubRegion(glm::uvec2 begin, const CDBTile &subRegionTile, bool reindexUV) const;
 
-    Mesh createSubRegionMesh(glm::uvec2 gridFrom, glm::uvec2 gridTo, bool reindexUV) const;
+    Mesh createRegionMesh() const;
+
+    size_t getGridMeshIndex(size_t uniformGridIndex) const noexcept;
 
     size_t m_gridWidth;
     size_t m_gridHeight;
-    Mesh m_uniformGridMesh;
+    std::shared_ptr<Mesh> m_gridMesh;
+    size_t m_gridMeshWidth;
+    glm::uvec2 m_regionBegin;
+    std::optional<UVTransform> m_UVTransform;
+    mutable std::optional<Mesh> m_regionMesh;
+    std::shared_ptr<ErrorPyramid> m_errorPyramid;
+    std::shared_ptr<GridNormals> m_gridNormals;
+    std::optional<SimplifiedMesh> m_simplifiedMesh;
     std::optional<CDBTile> m_tile;
 };
 
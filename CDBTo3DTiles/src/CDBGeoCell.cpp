@@ -18,7 +18,6 @@ CDBGeoCell::CDBGeoCell(int latitude, int longitude)
     m_latitude = latitude;
     m_longitude = longitude;
     m_zone = getZoneFromLatitude(latitude);
-    m_path = CDB::TILES / getLatitudeDirectoryName() / getLongitudeDirectoryName();
 }
 
 int CDBGeoCell::getLongitudeExtentInDegree() const
@@ -98,9 +97,9 @@ std::string CDBGeoCell::getLongitudeDirectoryName() const noexcept
     return "E" + toStringWithZeroPadding(3, m_longitude);
 }
 
-const std::filesystem::path &CDBGeoCell::getRelativePath() const noexcept
+std::filesystem::path CDBGeoCell::getRelativePath() const noexcept
 {
-    return m_path;
+    return CDB::TILES / getLatitudeDirectoryName() / getLongitudeDirectoryName();
 }
 
 std::optional<int> CDBGeoCell::parseLatFromFilename(const std::string &filename)
@@ -2,6 +2,7 @@
 
 #include "Utility.h"
 #include <filesystem>
+#include <optional>
 #include <string>
 
 namespace CDBTo3DTiles {
@@ -25,7 +26,7 @@ public:
 
     std::string getLongitudeDirectoryName() const noexcept;
 
-    const std::filesystem::path &getRelativePath() const noexcept;
+    std::filesystem::path getRelativePath() const noexcept;
 
     static std::optional<int> parseLatFromFilename(const std::string &filename);
 
@@ -34,7 +35,6 @@ public:
 private:
     friend bool operator==(const CDBGeoCell &lhs, const CDBGeoCell &rhs) noexcept;
 
-    std::filesystem::path m_path;
     int m_latitude;
     int m_longitude;
     int m_zone;
@@ -1,15 +1,15 @@
 #include "CDBGeometryVectors.h"
 #include "mapbox/earcut.hpp"
 #include "ogrsf_frmts.h"
+#include <algorithm>
 
 namespace CDBTo3DTiles {
 
-static std::optional<CDBClassesAttributes> createClassesAttributes(const CDBTile &instancesTile,
-                                                                   const std::filesystem::path &CDBPath);
-
 CDBGeometryVectors::CDBGeometryVectors(GDALDatasetUniquePtr dataset,
                                        CDBTile tile,
-                                       const std::filesystem::path &CDBPath)
+                                       const std::filesystem::path &CDBPath,
+                                       ThreadPool *threadPool,
+                                       CDBClassesAttributesCache *classesAttributesCache)
     : m_tile{std::move(tile)}
 {
     int CS_2 = tile.getCS_2();
@@ -21,21 +21,25 @@ CDBGeometryVectors::CDBGeometryVectors(GDALDatasetUniquePtr dataset,
         createPolyline(dataset.get());
         break;
     case static_cast<int>(CDBVectorCS2::PolygonFeature):
-        createPolygonOrMultiPolygon(dataset.get());
+        createPolygonOrMultiPolygon(dataset.get(), threadPool);
         break;
     default:
         break;
     }
 
     // merge instance attributes with class attributes
-    auto classesAttributes = createClassesAttributes(tile, CDBPath);
+    auto classesAttributes = readClassesAttributes(
+        *m_tile, CDBPath, m_instancesAttribs.getStringPool(), classesAttributesCache);
     if (classesAttributes) {
         m_instancesAttribs.mergeClassesAttributes(*classesAttributes);
     }
 }
 
-std::optional<CDBGeometryVectors> CDBGeometryVectors::createFromFile(const std::filesystem::path &file,
-                                                                     const std::filesystem::path &CDBPath)
+std::optional<CDBGeometryVectors> CDBGeometryVectors::createFromFile(
+    const std::filesystem::path &file,
+    const std::filesystem::path &CDBPath,
+    ThreadPool *threadPool,
+    CDBClassesAttributesCache *classesAttributesCache)
 {
     if (file.extension() != ".dbf") {
         return std::nullopt;
@@ -53,7 +57,8 @@ std::optional<CDBGeometryVectors> CDBGeometryVectors::createFromFile(const std::
         GDALDatasetUniquePtr dataset = GDALDatasetUniquePtr(
             (GDALDataset *) GDALOpenEx(file.c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
         if (dataset) {
-            auto geometryVector = CDBGeometryVectors(std::move(dataset), *tile, CDBPath);
+            auto geometryVector = CDBGeometryVectors(
+                std::move(dataset), *tile, CDBPath, threadPool, classesAttributesCache);
 
             return geometryVector;
         }
@@ -71,8 +76,14 @@ void CDBGeometryVectors::createPoint(GDALDataset *vectorDataset)
     int featureID = 0;
     for (int i = 0; i < vectorDataset->GetLayerCount(); ++i) {
         OGRLayer *layer = vectorDataset->GetLayer(i);
-        for (const auto &feature : *layer) {
-            m_instancesAttribs.addInstanceFeature(*feature);
+        auto features = readLayerFeatures(*layer);
+        auto columns = m_instancesAttribs.createLayerColumns(*layer->GetLayerDefn(), features.size());
+
+        // every feature has at most one point
+        reserveForAppend(m_mesh.positions, features.size());
+        reserveForAppend(m_mesh.batchIDs, features.size());
+        for (const auto &feature : features) {
+            m_instancesAttribs.addInstanceFeature(*feature, columns);
 
             const OGRGeometry *geometry = feature->GetGeometryRef();
             if (geometry != nullptr && wkbFlatten(geometry->getGeometryType()) == wkbPoint) {
@@ -104,29 +115,50 @@ void CDBGeometryVectors::createPolyline(GDALDataset *vectorDataset)
     m_mesh.primitiveType = PrimitiveType::Lines;
 
     const auto &ellipsoid = Core::Ellipsoid::WGS84;
+    std::vector<Core::Cartographic> cartographics;
     int featureID = 0;
     for (int i = 0; i < vectorDataset->GetLayerCount(); ++i) {
         OGRLayer *layer = vectorDataset->GetLayer(i);
-        for (const auto &feature : *layer) {
-            m_instancesAttribs.addInstanceFeature(*feature);
+        auto features = readLayerFeatures(*layer);
+        auto columns = m_instancesAttribs.createLayerColumns(*layer->GetLayerDefn(), features.size());
+
+        // the lines are counted first to allocate the mesh once
+        size_t totalPoints = 0;
+        size_t totalIndices = 0;
+        for (const auto &feature : features) {
+            const OGRGeometry *geometry = feature->GetGeometryRef();
+            if (geometry != nullptr && wkbFlatten(geometry->getGeometryType()) == wkbLineString) {
+                size_t linePoints = static_cast<size_t>(geometry->toLineString()->getNumPoints());
+                totalPoints += linePoints;
+                totalIndices += linePoints > 1 ? 2 * (linePoints - 1) : 0;
+            }
+        }
+
+        reserveForAppend(m_mesh.positions, totalPoints);
+        reserveForAppend(m_mesh.batchIDs, totalPoints);
+        reserveForAppend(m_mesh.indices, totalIndices);
+        for (const auto &feature : features) {
+            m_instancesAttribs.addInstanceFeature(*feature, columns);
 
             const OGRGeometry *geometry = feature->GetGeometryRef();
             if (geometry != nullptr && wkbFlatten(geometry->getGeometryType()) == wkbLineString) {
                 const OGRLineString *lineString = geometry->toLineString();
+
+                // the points of the line are converted in one batch
+                cartographics.clear();
                 for (int j = 0; j < lineString->getNumPoints(); ++j) {
                     OGRPoint p;
                     lineString->getPoint(j, &p);
+                    cartographics.emplace_back(glm::radians(p.getX()), glm::radians(p.getY()), p.getZ());
+                }
 
-                    Core::Cartographic cartographic(glm::radians(p.getX()), glm::radians(p.getY()), p.getZ());
-
-                    auto position = ellipsoid.cartographicToCartesian(cartographic);
-
-                    m_mesh.aabb->merge(position);
-                    m_mesh.positions.emplace_back(position);
+                size_t firstIndex = m_mesh.positions.size();
+                ellipsoid.cartographicToCartesian(cartographics, m_mesh.positions);
+                for (size_t index = firstIndex; index < m_mesh.positions.size(); ++index) {
+                    m_mesh.aabb->merge(m_mesh.positions[index]);
                     m_mesh.batchIDs.emplace_back(featureID);
 
-                    if (j > 0) {
-                        auto index = m_mesh.positions.size() - 1;
+                    if (index > firstIndex) {
                         m_mesh.indices.emplace_back(index - 1);
                         m_mesh.indices.emplace_back(index);
                     }
@@ -144,7 +176,7 @@ void CDBGeometryVectors::createPolyline(GDALDataset *vectorDataset)
     }
 }
 
-void CDBGeometryVectors::createPolygonOrMultiPolygon(GDALDataset *vectorDataset)
+void CDBGeometryVectors::createPolygonOrMultiPolygon(GDALDataset *vectorDataset, ThreadPool *threadPool)
 {
     m_mesh.aabb = AABB();
 
@@ -156,23 +188,85 @@ void CDBGeometryVectors::createPolygonOrMultiPolygon(GDALDataset *vectorDataset)
         Core::Cartographic tileCenter = rectangle.computeCenter();
         Core::EllipsoidTangentPlane tangentPlane(ellipsoid.cartographicToCartesian(tileCenter));
 
-        for (const auto &feature : *layer) {
-            m_instancesAttribs.addInstanceFeature(*feature);
+        auto features = readLayerFeatures(*layer);
+        auto columns = m_instancesAttribs.createLayerColumns(*layer->GetLayerDefn(), features.size());
+
+        // the polygons are listed in feature order with the position of their first point, so the mesh is
+        // allocated once and every polygon writes its own points
+        std::vector<std::pair<int, const OGRPolygon *>> polygons;
+        std::vector<size_t> firstPoints;
+        size_t totalPoints = m_mesh.positions.size();
+        auto addPolygon = [&](const OGRPolygon *polygon) {
+            polygons.emplace_back(featureID, polygon);
+            firstPoints.emplace_back(totalPoints);
+            for (auto lineRing : *polygon) {
+                totalPoints += static_cast<size_t>(lineRing->getNumPoints());
+            }
+        };
+
+        for (const auto &feature : features) {
+            m_instancesAttribs.addInstanceFeature(*feature, columns);
 
             const OGRGeometry *geometry = feature->GetGeometryRef();
             if (geometry != nullptr && wkbFlatten(geometry->getGeometryType()) == wkbMultiPolygon) {
-                const OGRMultiPolygon *multiPolygon = geometry->toMultiPolygon();
-                for (auto polygon : *multiPolygon) {
-                    createPolygon(featureID, polygon, ellipsoid, tangentPlane);
+                for (auto polygon : *geometry->toMultiPolygon()) {
+                    addPolygon(polygon);
                 }
 
                 ++featureID;
             } else if (geometry != nullptr && wkbFlatten(geometry->getGeometryType()) == wkbPolygon) {
-                const OGRPolygon *polygon = geometry->toPolygon();
-                createPolygon(featureID, polygon, ellipsoid, tangentPlane);
+                addPolygon(geometry->toPolygon());
                 ++featureID;
             }
         }
+
+        m_mesh.positions.resize(totalPoints);
+        m_mesh.batchIDs.resize(totalPoints);
+
+        // the polygons are projected and triangulated in parallel, in chunks of consecutive polygons
+        std::vector<std::vector<uint32_t>> polygonIndices(polygons.size());
+        auto triangulate = [&](size_t begin, size_t end) {
+            for (size_t j = begin; j < end; ++j) {
+                createPolygon(polygons[j].first,
+                              polygons[j].second,
+                              firstPoints[j],
+                              ellipsoid,
+                              tangentPlane,
+                              polygonIndices[j]);
+            }
+        };
+
+        if (threadPool && !threadPool->isSequential() && polygons.size() > 1) {
+            size_t chunkCount = std::min(polygons.size(), 4 * threadPool->getThreadCount());
+            size_t chunkSize = (polygons.size() + chunkCount - 1) / chunkCount;
+            TaskGroup triangulationTasks(*threadPool);
+            for (size_t begin = 0; begin < polygons.size(); begin += chunkSize) {
+                size_t end = std::min(begin + chunkSize, polygons.size());
+                triangulationTasks.run([&triangulate, begin, end]() { triangulate(begin, end); });
+            }
+
+            triangulationTasks.wait();
+        } else {
+            triangulate(0, polygons.size());
+        }
+
+        // the triangles are concatenated in feature order whichever thread made them
+        size_t totalIndices = 0;
+        for (const auto &indices : polygonIndices) {
+            totalIndices += indices.size();
+        }
+
+        reserveForAppend(m_mesh.indices, totalIndices);
+        for (size_t j = 0; j < polygons.size(); ++j) {
+            uint32_t firstPoint = static_cast<uint32_t>(firstPoints[j]);
+            for (auto index : polygonIndices[j]) {
+                m_mesh.indices.emplace_back(index + firstPoint);
+            }
+        }
+    }
+
+    for (const auto &position : m_mesh.positions) {
+        m_mesh.aabb->merge(position);
     }
 
     auto center = m_mesh.aabb->center();
@@ -184,13 +278,17 @@ void CDBGeometryVectors::createPolygonOrMultiPolygon(GDALDataset *vectorDataset)
 
 void CDBGeometryVectors::createPolygon(int featureID,
                                        const OGRPolygon *polygon,
+                                       size_t firstPoint,
                                        const Core::Ellipsoid &ellipsoid,
-                                       Core::EllipsoidTangentPlane &tangentPlane)
+                                       const Core::EllipsoidTangentPlane &tangentPlane,
+                                       std::vector<uint32_t> &indices)
 {
-    uint32_t currPositionSize = static_cast<uint32_t>(m_mesh.positions.size());
+    size_t pointIndex = firstPoint;
     std::vector<std::vector<std::pair<double, double>>> mapboxRings;
+    mapboxRings.reserve(static_cast<size_t>(polygon->getNumInteriorRings()) + 1);
     for (auto lineRing : *polygon) {
         std::vector<std::pair<double, double>> mapboxRing;
+        mapboxRing.reserve(static_cast<size_t>(lineRing->getNumPoints()));
         for (auto point : *lineRing) {
             Core::Cartographic cartographic(glm::radians(point.getX()),
                                             glm::radians(point.getY()),
@@ -199,55 +297,14 @@ void CDBGeometryVectors::createPolygon(int featureID,
             glm::dvec2 projectPosition = tangentPlane.projectPointToNearestOnPlane(position);
             mapboxRing.emplace_back(projectPosition.x, projectPosition.y);
 
-            m_mesh.positions.emplace_back(position);
-            m_mesh.batchIDs.emplace_back(featureID);
-            m_mesh.aabb->merge(position);
+            m_mesh.positions[pointIndex] = position;
+            m_mesh.batchIDs[pointIndex] = static_cast<float>(featureID);
+            ++pointIndex;
         }
 
-        mapboxRings.emplace_back(mapboxRing);
-    }
-
-    auto indices = mapbox::earcut<uint32_t>(mapboxRings);
-    for (auto index : indices) {
-        index += currPositionSize;
-        m_mesh.indices.emplace_back(index);
-    }
-}
-
-std::optional<CDBClassesAttributes> createClassesAttributes(const CDBTile &instancesTile,
-                                                            const std::filesystem::path &CDBPath)
-{
-    int CS_2 = instancesTile.getCS_2();
-    if (CS_2 == static_cast<int>(CDBVectorCS2::PointFeature)) {
-        CS_2 = static_cast<int>(CDBVectorCS2::PointFeatureClassLevel);
-    } else if (CS_2 == static_cast<int>(CDBVectorCS2::LinealFeature)) {
-        CS_2 = static_cast<int>(CDBVectorCS2::LinealFeatureClassLevel);
-    } else if (CS_2 == static_cast<int>(CDBVectorCS2::PolygonFeature)) {
-        CS_2 = static_cast<int>(CDBVectorCS2::PolygonFeatureClassLevel);
-    } else {
-        return std::nullopt;
-    }
-
-    CDBTile classVectorsTile = CDBTile(instancesTile.getGeoCell(),
-                                       instancesTile.getDataset(),
-                                       instancesTile.getCS_1(),
-                                       CS_2,
-                                       instancesTile.getLevel(),
-                                       instancesTile.getUREF(),
-                                       instancesTile.getRREF());
-
-    auto classLevelPath = CDBPath / (classVectorsTile.getRelativePath().string() + ".dbf");
-    if (!std::filesystem::exists(classLevelPath)) {
-        return std::nullopt;
+        mapboxRings.emplace_back(std::move(mapboxRing));
     }
 
-    GDALDatasetUniquePtr dataset = GDALDatasetUniquePtr(
-        (GDALDataset *) GDALOpenEx(classLevelPath.c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
-    if (!dataset) {
-        return std::nullopt;
-    }
-
-    return CDBClassesAttributes(std::move(dataset), std::move(classVectorsTile));
+    indices = mapbox::earcut<uint32_t>(mapboxRings);
 }
-
 } // namespace CDBTo3DTiles
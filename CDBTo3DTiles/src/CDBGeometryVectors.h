@@ -5,13 +5,20 @@
 #include "Ellipsoid.h"
 #include "EllipsoidTangentPlane.h"
 #include "Scene.h"
+#include "ThreadPool.h"
 #include "gdal_priv.h"
 
 namespace CDBTo3DTiles {
 class CDBGeometryVectors
 {
 public:
-    CDBGeometryVectors(GDALDatasetUniquePtr dataset, CDBTile tile, const std::filesystem::path &CDBPath);
+    // polygons are triangulated in parallel with the thread pool, or sequentially without it. The
+    // class-level attributes are read through the cache when there is one
+    CDBGeometryVectors(GDALDatasetUniquePtr dataset,
+                       CDBTile tile,
+                       const std::filesystem::path &CDBPath,
+                       ThreadPool *threadPool = nullptr,
+                       CDBClassesAttributesCache *classesAttributesCache = nullptr);
 
     inline const Mesh &getMesh() const noexcept { return m_mesh; }
 
@@ -23,19 +30,25 @@ public:
     }
 
     static std::optional<CDBGeometryVectors> createFromFile(const std::filesystem::path &file,
-                                                            const std::filesystem::path &CDBPath);
+                                                            const std::filesystem::path &CDBPath,
+                                                            ThreadPool *threadPool = nullptr,
+                                                            CDBClassesAttributesCache *classesAttributesCache
+                                                            = nullptr);
 
 private:
     void createPoint(GDALDataset *vectorDataset);
 
     void createPolyline(GDALDataset *vectorDataset);
 
-    void createPolygonOrMultiPolygon(GDALDataset *vectorDataset);
+    void createPolygonOrMultiPolygon(GDALDataset *vectorDataset, ThreadPool *threadPool);
 
+    // writes the points of the polygon from firstPoint in the mesh, which is already sized for them
     void createPolygon(int featureID,
                        const OGRPolygon *polygon,
+                       size_t firstPoint,
                        const Core::Ellipsoid &ellipsoid,
-                       Core::EllipsoidTangentPlane &tangentPlane);
+                       const Core::EllipsoidTangentPlane &tangentPlane,
+                       std::vector<uint32_t> &indices);
 
     Mesh m_mesh;
     CDBInstancesAttributes m_instancesAttribs;
@@ -2,7 +2,7 @@
 
 namespace CDBTo3DTiles {
 
-CDBImagery::CDBImagery(GDALDatasetUniquePtr imageryDataset, const CDBTile &tile)
+CDBImagery::CDBImagery(PooledGDALDataset imageryDataset, const CDBTile &tile)
     : _data{std::move(imageryDataset)}
     , _tile{tile}
 {}
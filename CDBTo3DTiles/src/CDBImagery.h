@@ -1,13 +1,13 @@
 #pragma once
 
 #include "CDBTileset.h"
-#include "gdal_priv.h"
+#include "GDALDatasetPool.h"
 
 namespace CDBTo3DTiles {
 class CDBImagery
 {
 public:
-    CDBImagery(GDALDatasetUniquePtr imageryDataset, const CDBTile &tile);
+    CDBImagery(PooledGDALDataset imageryDataset, const CDBTile &tile);
 
     inline const GDALDataset &getData() const noexcept { return *_data; }
 
@@ -16,7 +16,7 @@ public:
     inline const CDBTile &getTile() const noexcept { return *_tile; }
 
 private:
-    GDALDatasetUniquePtr _data;
+    PooledGDALDataset _data;
     std::optional<CDBTile> _tile;
 };
 } // namespace CDBTo3DTiles
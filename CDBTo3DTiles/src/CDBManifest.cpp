@@ -0,0 +1,234 @@
+#include "CDBManifest.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace CDBTo3DTiles {
+static const char MANIFEST_MAGIC[8] = {'C', 'D', 'B', 'M', 'N', 'F', 'S', 'T'};
+static const uint32_t MANIFEST_VERSION = 1;
+
+// values are stored in the byte order of the machine. A manifest is a local cache, not an exchange format
+class ManifestWriter
+{
+public:
+    template<typename T>
+    void write(T value)
+    {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void write(const std::string &value)
+    {
+        write(static_cast<uint32_t>(value.size()));
+        m_buffer.insert(m_buffer.end(), value.begin(), value.end());
+    }
+
+    inline const std::vector<char> &getBuffer() const noexcept { return m_buffer; }
+
+private:
+    std::vector<char> m_buffer;
+};
+
+class ManifestReader
+{
+public:
+    explicit ManifestReader(const std::vector<char> &buffer)
+        : m_buffer{buffer}
+        , m_offset{0}
+    {}
+
+    template<typename T>
+    T read()
+    {
+        T value;
+        std::memcpy(&value, consume(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::string readString()
+    {
+        uint32_t size = read<uint32_t>();
+        return std::string(consume(size), size);
+    }
+
+    const char *consume(size_t size)
+    {
+        if (m_buffer.size() - m_offset < size) {
+            throw std::runtime_error("Manifest is truncated");
+        }
+
+        const char *data = m_buffer.data() + m_offset;
+        m_offset += size;
+        return data;
+    }
+
+private:
+    const std::vector<char> &m_buffer;
+    size_t m_offset;
+};
+
+CDBManifest::CDBManifest(const std::filesystem::path &CDBPath)
+    : m_CDBPath{CDBPath}
+    , m_modified{false}
+{}
+
+bool CDBManifest::read(const std::filesystem::path &manifestPath)
+{
+    std::ifstream fs(manifestPath, std::ios::binary | std::ios::ate);
+    if (!fs) {
+        return false;
+    }
+
+    // the manifest is read in one go and decoded from memory
+    std::vector<char> buffer(static_cast<size_t>(fs.tellg()));
+    fs.seekg(0);
+    if (!fs.read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+        return false;
+    }
+
+    std::unordered_map<std::string, Entry> entries;
+    try {
+        ManifestReader reader(buffer);
+        if (std::memcmp(reader.consume(sizeof(MANIFEST_MAGIC)), MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC)) != 0
+            || reader.read<uint32_t>() != MANIFEST_VERSION) {
+            return false;
+        }
+
+        uint64_t entryCount = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < entryCount; ++i) {
+            std::string relativePath = reader.readString();
+
+            uint64_t directoryCount = reader.read<uint64_t>();
+            std::vector<CDBDatasetIndex::Directory> directories;
+            for (uint64_t j = 0; j < directoryCount; ++j) {
+                std::string directoryPath = reader.readString();
+                int64_t lastWriteTime = reader.read<int64_t>();
+                directories.push_back({std::move(directoryPath), lastWriteTime});
+            }
+
+            uint64_t fileCount = reader.read<uint64_t>();
+            std::vector<CDBDatasetIndex::File> files;
+            for (uint64_t j = 0; j < fileCount; ++j) {
+                std::string filePath = reader.readString();
+                uint64_t size = reader.read<uint64_t>();
+                int64_t lastWriteTime = reader.read<int64_t>();
+                files.push_back({std::move(filePath), size, lastWriteTime});
+            }
+
+            auto index = std::make_shared<const CDBDatasetIndex>(std::move(directories), std::move(files));
+            entries[relativePath] = Entry{std::move(index), false};
+        }
+    } catch (const std::runtime_error &) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries = std::move(entries);
+    m_modified = false;
+    return true;
+}
+
+void CDBManifest::write(const std::filesystem::path &manifestPath) const
+{
+    ManifestWriter writer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (char c : MANIFEST_MAGIC) {
+            writer.write(c);
+        }
+
+        writer.write(MANIFEST_VERSION);
+        writer.write(static_cast<uint64_t>(m_entries.size()));
+        for (const auto &entry : m_entries) {
+            const auto &index = *entry.second.index;
+            writer.write(entry.first);
+
+            writer.write(static_cast<uint64_t>(index.getDirectories().size()));
+            for (const auto &directory : index.getDirectories()) {
+                writer.write(directory.relativePath);
+                writer.write(directory.lastWriteTime);
+            }
+
+            writer.write(static_cast<uint64_t>(index.getFiles().size()));
+            for (const auto &file : index.getFiles()) {
+                writer.write(file.relativePath);
+                writer.write(file.size);
+                writer.write(file.lastWriteTime);
+            }
+        }
+    }
+
+    // write to a temporary file first so that an interrupted run never leaves a truncated manifest behind
+    auto temporaryPath = manifestPath;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream fs(temporaryPath, std::ios::binary);
+        const auto &buffer = writer.getBuffer();
+        fs.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!fs) {
+            throw std::runtime_error("Cannot write CDB manifest " + temporaryPath.string());
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, manifestPath);
+}
+
+bool CDBManifest::isModified() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_modified;
+}
+
+std::shared_ptr<const CDBDatasetIndex> CDBManifest::getIndex(const std::filesystem::path &relativePath,
+                                                             size_t depth)
+{
+    std::string key = relativePath.string();
+    std::shared_ptr<const CDBDatasetIndex> unvalidatedIndex;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto entry = m_entries.find(key);
+        if (entry != m_entries.end()) {
+            if (entry->second.isValidated) {
+                return entry->second.index;
+            }
+
+            unvalidatedIndex = entry->second.index;
+        }
+    }
+
+    // directories are checked and listed without holding the lock. If another thread wins the race, its
+    // index is kept
+    if (unvalidatedIndex && unvalidatedIndex->isUpToDate(m_CDBPath)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &entry = m_entries[key];
+        entry.isValidated = true;
+        return entry.index;
+    }
+
+    auto index = std::make_shared<const CDBDatasetIndex>(
+        CDBDatasetIndex::createFromDirectory(m_CDBPath, relativePath, depth));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &entry = m_entries[key];
+    if (!entry.isValidated) {
+        entry = Entry{std::move(index), true};
+        m_modified = true;
+    }
+
+    return entry.index;
+}
+
+std::shared_ptr<const CDBDatasetIndex> CDBManifest::refreshIndex(const std::filesystem::path &relativePath,
+                                                                 size_t depth)
+{
+    auto index = std::make_shared<const CDBDatasetIndex>(
+        CDBDatasetIndex::createFromDirectory(m_CDBPath, relativePath, depth));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[relativePath.string()] = Entry{index, true};
+    m_modified = true;
+    return index;
+}
+} // namespace CDBTo3DTiles
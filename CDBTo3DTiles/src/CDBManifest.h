@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CDBDatasetIndex.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace CDBTo3DTiles {
+class CDBManifest
+{
+public:
+    explicit CDBManifest(const std::filesystem::path &CDBPath);
+
+    CDBManifest(const CDBManifest &) = delete;
+
+    CDBManifest &operator=(const CDBManifest &) = delete;
+
+    // a missing or unreadable manifest is not an error. Every directory is listed again instead
+    bool read(const std::filesystem::path &manifestPath);
+
+    void write(const std::filesystem::path &manifestPath) const;
+
+    bool isModified() const;
+
+    std::shared_ptr<const CDBDatasetIndex> getIndex(const std::filesystem::path &relativePath, size_t depth);
+
+    // lists the directory again, for a caller that found one of its files rewritten since it was indexed
+    std::shared_ptr<const CDBDatasetIndex> refreshIndex(const std::filesystem::path &relativePath,
+                                                        size_t depth);
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const CDBDatasetIndex> index;
+        bool isValidated;
+    };
+
+    std::filesystem::path m_CDBPath;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    bool m_modified;
+};
+} // namespace CDBTo3DTiles
@@ -2,16 +2,56 @@
 #include "CDB.h"
 #include "Ellipsoid.h"
 #include "MathHelpers.h"
+#include "VirtualFileSystem.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/epsilon.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "osg/Material"
+#include "osgDB/FileNameUtils"
 #include "osgDB/ReadFile"
-#include <unordered_set>
+#include "osgDB/Registry"
+#include <functional>
+#include <istream>
+#include <set>
+#include <tuple>
 
 namespace CDBTo3DTiles {
 static TextureFilter convertOsgTexFilter(osg::Texture::FilterMode);
 
+using ReadStream = std::function<osgDB::ReaderWriter::ReadResult(osgDB::ReaderWriter &,
+                                                                  std::istream &,
+                                                                  const osgDB::Options *)>;
+
+static osgDB::ReaderWriter::ReadResult readArchiveEntry(const MappedZipArchive &archive,
+                                                        const std::string &entry,
+                                                        const osgDB::Options *options,
+                                                        const ReadStream &read);
+
+static osgDB::ReaderWriter::ReadResult readVirtualFile(const std::string &filename,
+                                                       const osgDB::Options *options,
+                                                       const ReadStream &read);
+
+static osgDB::ReaderWriter::ReadResult readMemory(const std::string &filename,
+                                                  std::string_view data,
+                                                  const osgDB::Options *options,
+                                                  const ReadStream &read);
+
+// OSG plugins only read local files, so models, their external references and their textures are found and
+// read through GDAL when the CDB is in object storage or in an archive
+class FindVirtualFile : public osgDB::FindFileCallback, public osgDB::ReadFileCallback
+{
+public:
+    std::string findDataFile(const std::string &filename,
+                             const osgDB::Options *options,
+                             osgDB::CaseSensitivity caseSensitivity) override;
+
+    osgDB::ReaderWriter::ReadResult readNode(const std::string &filename,
+                                             const osgDB::Options *options) override;
+
+    osgDB::ReaderWriter::ReadResult readImage(const std::string &filename,
+                                              const osgDB::Options *options) override;
+};
+
 GeometryPrimitiveFunctor::GeometryPrimitiveFunctor(Mesh &mesh)
     : osg::PrimitiveIndexFunctor()
     , m_mesh{mesh}
@@ -28,6 +68,7 @@ void GeometryPrimitiveFunctor::writeTriangle(unsigned int i0, unsigned int i1, u
 
 void GeometryPrimitiveFunctor::drawArrays(GLenum mode, GLint first, GLsizei count)
 {
+    reserveTriangleIndices(mode, count);
     switch (mode) {
     case (GL_TRIANGLES): {
         unsigned int pos = static_cast<unsigned int>(first);
@@ -93,6 +134,37 @@ void GeometryPrimitiveFunctor::drawElements(GLenum mode, GLsizei count, const GL
     drawElementsImplementation<GLuint>(mode, count, indices);
 }
 
+void GeometryPrimitiveFunctor::reserveTriangleIndices(GLenum mode, GLsizei count)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    // the number of triangles each primitive mode produces in writeTriangle
+    size_t vertexCount = static_cast<size_t>(count);
+    size_t triangleCount = 0;
+    switch (mode) {
+    case (GL_TRIANGLES):
+        triangleCount = vertexCount / 3;
+        break;
+    case (GL_TRIANGLE_STRIP):
+    case (GL_POLYGON):
+    case (GL_TRIANGLE_FAN):
+        triangleCount = vertexCount > 2 ? vertexCount - 2 : 0;
+        break;
+    case (GL_QUADS):
+        triangleCount = vertexCount / 4 * 2;
+        break;
+    case (GL_QUAD_STRIP):
+        triangleCount = vertexCount > 3 ? (vertexCount - 2) / 2 * 2 : 0;
+        break;
+    default:
+        break;
+    }
+
+    reserveForAppend(m_mesh.indices, 3 * triangleCount);
+}
+
 GeometryPrimitiveFunctor &GeometryPrimitiveFunctor::operator=(const GeometryPrimitiveFunctor &)
 {
     return *this;
@@ -153,6 +225,19 @@ void CDBModel3DResult::finalize()
     }
 }
 
+size_t CDBModel3DResult::getTriangleCount() const noexcept
+{
+    size_t triangleCount = 0;
+    for (const auto &mesh : m_meshes) {
+        if (mesh.primitiveType == PrimitiveType::Triangles) {
+            size_t vertexCount = mesh.indices.empty() ? mesh.getVertexCount() : mesh.indices.size();
+            triangleCount += vertexCount / 3;
+        }
+    }
+
+    return triangleCount;
+}
+
 void CDBModel3DResult::pushStateSet(osg::StateSet *ss)
 {
     if (ss != nullptr) {
@@ -296,14 +381,17 @@ void CDBModel3DResult::processGeometry(osg::Geometry &geometry, osg::Matrix matr
     transform = m_transform * glm::transpose(transform);
 
     // parse positions
+    auto &mesh = m_meshes[meshIdx];
     if (vertexArray->getType() == osg::Array::Type::Vec3ArrayType) {
+        reserveForAppend(mesh.positions, vertexArray->getNumElements());
+        reserveForAppend(mesh.batchIDs, vertexArray->getNumElements());
         for (unsigned i = 0; i < vertexArray->getNumElements(); ++i) {
             vertexArray->accept(i, valueVisitor);
             osg::Vec3 pos = valueVisitor.vec3;
             glm::dvec3 glmWorldPos = transform * glm::dvec4(pos[0], pos[1], pos[2], 1.0);
-            m_meshes[meshIdx].aabb->merge(glmWorldPos);
-            m_meshes[meshIdx].positions.emplace_back(glmWorldPos);
-            m_meshes[meshIdx].batchIDs.emplace_back(m_featureID);
+            mesh.aabb->merge(glmWorldPos);
+            mesh.positions.emplace_back(glmWorldPos);
+            mesh.batchIDs.emplace_back(m_featureID);
         }
     }
 
@@ -311,6 +399,7 @@ void CDBModel3DResult::processGeometry(osg::Geometry &geometry, osg::Matrix matr
     auto normalArray = geometry.getNormalArray();
     if (normalArray && normalArray->getType() == osg::Array::Type::Vec3ArrayType) {
         glm::dmat4 normalMatrix = glm::inverse(glm::transpose(transform));
+        reserveForAppend(mesh.normals, normalArray->getNumElements());
         for (unsigned i = 0; i < normalArray->getNumElements(); ++i) {
             normalArray->accept(i, valueVisitor);
             osg::Vec3 normal = valueVisitor.vec3;
@@ -319,7 +408,7 @@ void CDBModel3DResult::processGeometry(osg::Geometry &geometry, osg::Matrix matr
                 glmNormal = glm::normalize(glmNormal);
             }
 
-            m_meshes[meshIdx].normals.emplace_back(glmNormal);
+            mesh.normals.emplace_back(glmNormal);
         }
     }
 
@@ -328,59 +417,240 @@ void CDBModel3DResult::processGeometry(osg::Geometry &geometry, osg::Matrix matr
     // It will lead to size mismatch with positions and normals array since we are grouping those meshes that has UV
     // and the ones that don't together. A check for texture in material is used to prevent such case
     auto textureCoordArray = geometry.getTexCoordArray(0);
-    const auto &meshMaterial = m_materials[static_cast<size_t>(m_meshes[meshIdx].material)];
+    const auto &meshMaterial = m_materials[static_cast<size_t>(mesh.material)];
     if (textureCoordArray && meshMaterial.texture != -1) {
+        reserveForAppend(mesh.UVs, textureCoordArray->getNumElements());
         for (unsigned i = 0; i < textureCoordArray->getNumElements(); ++i) {
             textureCoordArray->accept(i, valueVisitor);
             valueVisitor.vec2.y() = 1.0f - valueVisitor.vec2.y();
-            m_meshes[meshIdx].UVs.emplace_back(valueVisitor.vec2[0], valueVisitor.vec2[1]);
+            mesh.UVs.emplace_back(valueVisitor.vec2[0], valueVisitor.vec2[1]);
         }
     }
 }
 
-CDBGTModelCache::CDBGTModelCache(const std::filesystem::path &CDBPath)
-    : m_CDBPath{CDBPath}
+static size_t computeModel3DBytes(const CDBModel3DResult &model3D)
+{
+    size_t bytes = sizeof(CDBModel3DResult);
+    for (const auto &mesh : model3D.getMeshes()) {
+        bytes += sizeof(Mesh);
+        bytes += mesh.indices.capacity() * sizeof(uint32_t);
+        bytes += mesh.positions.capacity() * sizeof(glm::dvec3);
+        bytes += mesh.positionRTCs.capacity() * sizeof(glm::vec3);
+        bytes += mesh.UVs.capacity() * sizeof(glm::vec2);
+        bytes += mesh.normals.capacity() * sizeof(glm::vec3);
+        bytes += mesh.batchIDs.capacity() * sizeof(float);
+    }
+
+    bytes += model3D.getMaterials().size() * sizeof(Material);
+    bytes += model3D.getTextures().size() * sizeof(Texture);
+    for (const auto &image : model3D.getImages()) {
+        if (image) {
+            bytes += image->getTotalSizeInBytesIncludingMipmaps();
+        }
+    }
+
+    return bytes;
+}
+
+CDBGTModelBaking::CDBGTModelBaking()
+    : maxInstances{0}
+    , maxTriangles{65536}
 {}
 
-const CDBModel3DResult *CDBGTModelCache::locateModel3D(const std::string &FACC,
-                                                       const std::string &MODL,
-                                                       int FSC,
-                                                       std::string &modelKey) const
-{
-    std::string key = getModelKey(FACC, MODL, FSC);
-    auto model = m_keyToModel.find(key);
-    if (model != m_keyToModel.end()) {
-        modelKey = key;
-        return &model->second;
-    }
-
-    for (std::filesystem::directory_entry A_Cartegory : std::filesystem::directory_iterator(
-             m_CDBPath / CDB::GTModel / getCDBDatasetDirectoryName(CDBDataset::GTModelGeometry_500))) {
-        if (A_Cartegory.path().filename().string().front() == FACC[0]) {
-            for (std::filesystem::directory_entry B_Subcartegory :
-                 std::filesystem::directory_iterator(A_Cartegory)) {
-                if (B_Subcartegory.path().filename().string().front() == FACC[1]) {
-                    for (std::filesystem::directory_entry featureCodeDir :
-                         std::filesystem::directory_iterator(B_Subcartegory)) {
-                        if (featureCodeDir.path().filename().string().substr(0, 3) == FACC.substr(2, 3)) {
-                            osg::ref_ptr<osg::Node> geometry = osgDB::readRefNodeFile(featureCodeDir.path()
-                                                                                      / (key + ".flt"));
-                            if (geometry) {
-                                CDBModel3DResult model3D;
-                                geometry->accept(model3D);
-                                model3D.finalize();
-                                m_keyToModel.insert({key, std::move(model3D)});
-                                modelKey = key;
-                                return &m_keyToModel[key];
-                            }
-                        }
-                    }
-                }
-            }
+bool CDBGTModelBaking::shouldBake(size_t instanceCount, size_t modelTriangleCount) const noexcept
+{
+    if (instanceCount == 0 || instanceCount > maxInstances) {
+        return false;
+    }
+
+    return maxTriangles == 0 || instanceCount * modelTriangleCount <= maxTriangles;
+}
+
+bool operator==(const CDBGTModelKey &lhs, const CDBGTModelKey &rhs) noexcept
+{
+    return lhs.FSC == rhs.FSC && lhs.FACC == rhs.FACC && lhs.MODL == rhs.MODL;
+}
+
+CDBGTModelCache::CDBGTModelCache(const std::filesystem::path &CDBPath,
+                                 std::shared_ptr<CDBManifest> manifest,
+                                 size_t memoryBudget)
+    : m_CDBPath{CDBPath}
+    , m_manifest{std::move(manifest)}
+    , m_memoryBudget{memoryBudget}
+    , m_statistics{0, 0, 0, 0}
+{
+    if (!m_manifest) {
+        m_manifest = std::make_shared<CDBManifest>(CDBPath);
+    }
+}
+
+std::shared_ptr<const CDBModel3DResult> CDBGTModelCache::locateModel3D(const std::string &FACC,
+                                                                       const std::string &MODL,
+                                                                       int FSC,
+                                                                       std::string &modelKey) const
+{
+    // the key views the strings of the caller, so a lookup copies nothing. The name of the model is built
+    // once when it is first asked for and copied from the cache afterwards
+    CDBGTModelKey key{FACC, MODL, FSC};
+    std::promise<std::shared_ptr<const CDBModel3DResult>> loadedModel;
+    std::shared_future<std::shared_ptr<const CDBModel3DResult>> model;
+    std::string name;
+    bool isLoader = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto modelIt = m_keyToModel.find(key);
+        if (modelIt != m_keyToModel.end()) {
+            ++m_statistics.hits;
+            m_LRUModels.splice(m_LRUModels.begin(), m_LRUModels, modelIt->second.LRUPosition);
+            model = modelIt->second.model;
+            name = modelIt->second.LRUPosition->name;
+        } else {
+            ++m_statistics.misses;
+            model = loadedModel.get_future().share();
+            name = getModelKey(FACC, MODL, FSC);
+            const auto &modelName = m_LRUModels.emplace_front(ModelName{FACC, MODL, FSC, name});
+            m_keyToModel.insert({CDBGTModelKey{modelName.FACC, modelName.MODL, modelName.FSC},
+                                 CachedModel{model, m_LRUModels.begin(), 0, false}});
+            isLoader = true;
         }
     }
 
-    return nullptr;
+    // the first thread asking for the model loads it. The others wait on the same result, which never waits
+    // on anything else, so a prefetch task cannot deadlock the thread that needs the model
+    if (isLoader) {
+        size_t bytes = 0;
+        try {
+            auto model3D = loadModel3D(FACC, name);
+            bytes = model3D ? computeModel3DBytes(*model3D) : 0;
+            loadedModel.set_value(std::move(model3D));
+        } catch (...) {
+            loadedModel.set_exception(std::current_exception());
+        }
+
+        // models that are still loading are never evicted, so the entry is the one inserted above
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &cachedModel = m_keyToModel.at(key);
+        cachedModel.bytes = bytes;
+        cachedModel.isLoaded = true;
+        m_statistics.bytes += bytes;
+        if (m_memoryBudget != 0) {
+            evictModels(m_memoryBudget, &key);
+        }
+    }
+
+    auto result = model.get();
+    if (result) {
+        modelKey = std::move(name);
+    }
+
+    return result;
+}
+
+void CDBGTModelCache::prefetchModel3D(const std::string &FACC,
+                                      const std::string &MODL,
+                                      int FSC,
+                                      TaskGroup &tasks) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_keyToModel.find(CDBGTModelKey{FACC, MODL, FSC}) != m_keyToModel.end()) {
+            return;
+        }
+    }
+
+    tasks.run([this, FACC, MODL, FSC]() {
+        std::string modelKey;
+        locateModel3D(FACC, MODL, FSC, modelKey);
+    });
+}
+
+CDBGTModelCache::Statistics CDBGTModelCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void CDBGTModelCache::shrink() const
+{
+    // the most recently used models are kept, since the next tiles are likely to instance them again
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t maxBytes = m_memoryBudget == 0 ? m_statistics.bytes : m_memoryBudget;
+    evictModels(maxBytes / 2, nullptr);
+}
+
+void CDBGTModelCache::evictModels(size_t maxBytes, const CDBGTModelKey *keptKey) const
+{
+    // models handed out stay alive through their shared_ptr, eviction only drops the cache reference. The
+    // models still being loaded are kept, so their loaders find them once done
+    // the key of an entry views its strings in the LRU list, so the entry is erased first
+    auto LRUModel = m_LRUModels.end();
+    while (m_statistics.bytes > maxBytes && LRUModel != m_LRUModels.begin()) {
+        --LRUModel;
+        CDBGTModelKey key{LRUModel->FACC, LRUModel->MODL, LRUModel->FSC};
+        auto cachedModel = m_keyToModel.find(key);
+        if ((keptKey && key == *keptKey) || !cachedModel->second.isLoaded) {
+            continue;
+        }
+
+        m_statistics.bytes -= cachedModel->second.bytes;
+        ++m_statistics.evictions;
+        m_keyToModel.erase(cachedModel);
+        LRUModel = m_LRUModels.erase(LRUModel);
+    }
+}
+
+void CDBGTModelCache::indexModelGeometries() const
+{
+    // GTModel geometries are laid out as category/subcategory/feature code/model. The FACC of a model is
+    // the first letter of its category and subcategory directories followed by the feature code
+    auto geometryPath = CDB::GTModel / getCDBDatasetDirectoryName(CDBDataset::GTModelGeometry_500);
+    for (const auto &file : m_manifest->getIndex(geometryPath, 4)->getFiles()) {
+        std::filesystem::path modelPath = file.relativePath;
+        auto featureCodeDir = modelPath.parent_path();
+        auto subcategoryDir = featureCodeDir.parent_path();
+        auto categoryDir = subcategoryDir.parent_path();
+
+        std::string featureCode = featureCodeDir.filename().string().substr(0, 3);
+        std::string subcategory = subcategoryDir.filename().string().substr(0, 1);
+        std::string category = categoryDir.filename().string().substr(0, 1);
+        std::string FACCModel = category + subcategory + featureCode + "/" + modelPath.filename().string();
+        m_FACCModelToPath.insert({FACCModel, m_CDBPath / modelPath});
+    }
+}
+
+std::shared_ptr<const CDBModel3DResult> CDBGTModelCache::loadModel3D(const std::string &FACC,
+                                                                     const std::string &key) const
+{
+    std::call_once(m_indexFlag, [this]() { indexModelGeometries(); });
+
+    if (FACC.size() < 5) {
+        return nullptr;
+    }
+
+    auto modelPath = m_FACCModelToPath.find(FACC.substr(0, 5) + "/" + key + ".flt");
+    if (modelPath == m_FACCModelToPath.end()) {
+        return nullptr;
+    }
+
+    osg::ref_ptr<osgDB::Options> options;
+    if (isVirtualFileSystemPath(modelPath->second)) {
+        osg::ref_ptr<FindVirtualFile> findVirtualFile = new FindVirtualFile();
+        options = new osgDB::Options();
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+        options->getDatabasePathList().push_front(modelPath->second.parent_path().generic_string());
+        options->setFindFileCallback(findVirtualFile);
+        options->setReadFileCallback(findVirtualFile);
+    }
+
+    osg::ref_ptr<osg::Node> geometry = osgDB::readRefNodeFile(modelPath->second.generic_string(), options);
+    if (!geometry) {
+        return nullptr;
+    }
+
+    auto model3D = std::make_shared<CDBModel3DResult>();
+    geometry->accept(*model3D);
+    model3D->finalize();
+    return model3D;
 }
 
 std::string CDBGTModelCache::getModelKey(const std::string &FACC, const std::string &MODL, int FCC) const
@@ -393,7 +663,8 @@ CDBGTModels::CDBGTModels(CDBModelsAttributes attributes, CDBGTModelCache *cache)
     , m_attributes{std::move(attributes)}
 {}
 
-const CDBModel3DResult *CDBGTModels::locateModel3D(size_t instanceIdx, std::string &modelKey) const
+std::shared_ptr<const CDBModel3DResult> CDBGTModels::locateModel3D(size_t instanceIdx,
+                                                                    std::string &modelKey) const
 {
     const auto &instancesAttribs = m_attributes->getInstancesAttributes();
     const auto &stringAttribs = instancesAttribs.getStringAttribs();
@@ -416,6 +687,55 @@ const CDBModel3DResult *CDBGTModels::locateModel3D(size_t instanceIdx, std::stri
     return nullptr;
 }
 
+std::optional<std::string> CDBGTModels::getModelKey(size_t instanceIdx) const
+{
+    const auto &instancesAttribs = m_attributes->getInstancesAttributes();
+    const auto &stringAttribs = instancesAttribs.getStringAttribs();
+    const auto &integerAttribs = instancesAttribs.getIntegerAttribs();
+    auto FACCs = stringAttribs.find("FACC");
+    auto MODLs = stringAttribs.find("MODL");
+    auto FSCs = integerAttribs.find("FSC");
+
+    if (FACCs != stringAttribs.end() && MODLs != stringAttribs.end() && FSCs != integerAttribs.end()) {
+        size_t instanceCount = instancesAttribs.getInstancesCount();
+        if (FACCs->second.size() == instanceCount && MODLs->second.size() == instanceCount
+            && FSCs->second.size() == instanceCount) {
+            return m_cache->getModelKey(FACCs->second[instanceIdx],
+                                        MODLs->second[instanceIdx],
+                                        FSCs->second[instanceIdx]);
+        }
+    }
+
+    return std::nullopt;
+}
+
+void CDBGTModels::prefetchModels3D(TaskGroup &tasks) const
+{
+    const auto &instancesAttribs = m_attributes->getInstancesAttributes();
+    const auto &stringAttribs = instancesAttribs.getStringAttribs();
+    const auto &integerAttribs = instancesAttribs.getIntegerAttribs();
+    auto FACCs = stringAttribs.find("FACC");
+    auto MODLs = stringAttribs.find("MODL");
+    auto FSCs = integerAttribs.find("FSC");
+    if (FACCs == stringAttribs.end() || MODLs == stringAttribs.end() || FSCs == integerAttribs.end()) {
+        return;
+    }
+
+    size_t instanceCount = instancesAttribs.getInstancesCount();
+    if (FACCs->second.size() != instanceCount || MODLs->second.size() != instanceCount
+        || FSCs->second.size() != instanceCount) {
+        return;
+    }
+
+    // instances mostly share a few models, so only queue each model once
+    std::set<std::tuple<std::string, std::string, int>> models;
+    for (size_t i = 0; i < instanceCount; ++i) {
+        if (models.emplace(FACCs->second[i], MODLs->second[i], FSCs->second[i]).second) {
+            m_cache->prefetchModel3D(FACCs->second[i], MODLs->second[i], FSCs->second[i], tasks);
+        }
+    }
+}
+
 std::optional<CDBGTModels> CDBGTModels::createFromModelsAttributes(CDBModelsAttributes attributes,
                                                                    CDBGTModelCache *cache)
 {
@@ -432,94 +752,184 @@ std::optional<CDBGTModels> CDBGTModels::createFromModelsAttributes(CDBModelsAttr
     return CDBGTModels(std::move(attributes), cache);
 }
 
-CDBGSModels::CDBGSModels(CDBModelsAttributes modelsAttributes,
-                         const CDBTile &GSModelTile,
-                         const osg::ref_ptr<osgDB::Archive> &GSModelArchive,
-                         const osg::ref_ptr<osgDB::Options> &options)
-    : m_GSModelArchive{GSModelArchive}
-    , m_tile{GSModelTile}
+CDBGSModelArchive::CDBGSModelArchive() {}
+
+std::shared_ptr<const CDBGSModelArchive> CDBGSModelArchive::open(const std::filesystem::path &zipPath)
+{
+    std::unique_ptr<MappedZipArchive> archive;
+    if (isVirtualFileSystemPath(zipPath)) {
+        auto buffer = readFile(zipPath);
+        if (buffer) {
+            archive = MappedZipArchive::open(std::move(*buffer));
+        }
+    } else {
+        archive = MappedZipArchive::open(zipPath);
+    }
+
+    if (!archive) {
+        return nullptr;
+    }
+
+    auto zip = std::make_shared<CDBGSModelArchive>();
+    zip->archive = std::move(archive);
+
+    // +1 is because there is a separator "_" after the tile name
+    std::string tileName = zipPath.stem().string();
+    for (const auto &entry : zip->archive->getEntryNames()) {
+        if (entry.size() > tileName.size() + 1) {
+            zip->tileEntries.insert({entry.substr(tileName.size() + 1), entry});
+        }
+    }
+
+    return zip;
+}
+
+osgDB::ReaderWriter::ReadResult CDBGSModelArchive::readNode(const std::string &entry,
+                                                            const osgDB::Options *options) const
+{
+    auto read = [](osgDB::ReaderWriter &rw, std::istream &stream, const osgDB::Options *entryOptions) {
+        return rw.readNode(stream, entryOptions);
+    };
+
+    return readArchiveEntry(*archive, entry, options, read);
+}
+
+osgDB::ReaderWriter::ReadResult CDBGSModelArchive::readImage(const std::string &entry,
+                                                             const osgDB::Options *options) const
 {
-    m_tileFilename = GSModelTile.getRelativePath().filename().string();
+    auto read = [](osgDB::ReaderWriter &rw, std::istream &stream, const osgDB::Options *entryOptions) {
+        return rw.readImage(stream, entryOptions);
+    };
+
+    return readArchiveEntry(*archive, entry, options, read);
+}
 
-    std::unordered_set<std::string> geometryFilenames;
-    osgDB::Archive::FileNameList fileNameList;
-    if (m_GSModelArchive->getFileNames(fileNameList)) {
-        for (osgDB::Archive::FileNameList::iterator itr = fileNameList.begin(); itr != fileNameList.end();
-             ++itr) {
-            geometryFilenames.insert(*itr);
+std::shared_ptr<const CDBGSModelArchive> CDBGSModelArchiveCache::open(const std::filesystem::path &zipPath)
+{
+    // the first caller opens the archive outside of the lock, the others wait for it
+    std::promise<std::shared_ptr<const CDBGSModelArchive>> opened;
+    std::shared_future<std::shared_ptr<const CDBGSModelArchive>> openedByOther;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto archive = m_archives.find(zipPath.string());
+        if (archive != m_archives.end()) {
+            openedByOther = archive->second;
+        } else {
+            m_archives.insert({zipPath.string(), opened.get_future().share()});
         }
     }
 
+    if (openedByOther.valid()) {
+        return openedByOther.get();
+    }
+
+    try {
+        auto archive = CDBGSModelArchive::open(zipPath);
+        opened.set_value(archive);
+        return archive;
+    } catch (...) {
+        opened.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+CDBGSModels::CDBGSModels(CDBModelsAttributes modelsAttributes,
+                         const CDBTile &GSModelTile,
+                         std::shared_ptr<const CDBGSModelArchive> GSModelArchive,
+                         const osg::ref_ptr<osgDB::Options> &options,
+                         ThreadPool *threadPool)
+    : m_GSModelArchive{std::move(GSModelArchive)}
+    , m_tile{GSModelTile}
+    , m_attributes{std::move(modelsAttributes.getInstancesAttributes())}
+{
+    m_tileFilename = GSModelTile.getFilename();
+
     Core::Ellipsoid ellipsoid = Core::Ellipsoid::WGS84;
     const auto &cartographicPositions = modelsAttributes.getCartographicPositions();
     const auto &orientations = modelsAttributes.getOrientations();
     const auto &scales = modelsAttributes.getScales();
-    const auto &instancesAttribs = modelsAttributes.getInstancesAttributes();
+    const auto &instancesAttribs = m_attributes;
     const auto &stringAttribs = instancesAttribs.getStringAttribs();
     const auto &integerAttribs = instancesAttribs.getIntegerAttribs();
     auto FACCs = stringAttribs.find("FACC");
     auto MODLs = stringAttribs.find("MODL");
     auto FSCs = integerAttribs.find("FSC");
 
-    // extract attributes for this tile only
+    // the models are read from the archive in parallel, then combined in the order of the instances
     size_t totalInputInstanceCount = instancesAttribs.getInstancesCount();
+    std::vector<osg::ref_ptr<osg::Node>> nodes(totalInputInstanceCount);
+    auto readModel = [&](size_t i) {
+        std::string modelFilename = getModelFilename(FACCs->second[i], MODLs->second[i], FSCs->second[i]);
+        if (m_GSModelArchive->archive->hasEntry(modelFilename)) {
+            auto result = m_GSModelArchive->readNode(modelFilename, options.get());
+            if (result.validNode()) {
+                nodes[i] = result.takeNode();
+            }
+        }
+    };
+
+    if (threadPool && !threadPool->isSequential() && totalInputInstanceCount > 1) {
+        TaskGroup readTasks(*threadPool);
+        for (size_t i = 0; i < totalInputInstanceCount; ++i) {
+            readTasks.run([&readModel, i]() { readModel(i); });
+        }
+
+        readTasks.wait();
+    } else {
+        for (size_t i = 0; i < totalInputInstanceCount; ++i) {
+            readModel(i);
+        }
+    }
+
+    // extract attributes for this tile only
     std::vector<size_t> extractedInstances;
     extractedInstances.reserve(totalInputInstanceCount);
     int featureID = 0;
     for (size_t i = 0; i < totalInputInstanceCount; ++i) {
-        const auto &FACC = FACCs->second[i];
-        const auto &MODL = MODLs->second[i];
-        int FSC = FSCs->second[i];
-        std::string modelFilename = getModelFilename(FACC, MODL, FSC);
-        if (geometryFilenames.find(modelFilename) != geometryFilenames.end()) {
-            auto result = m_GSModelArchive->readNode(modelFilename, options.get());
-            if (result.validNode()) {
-                // combine mesh
-                osg::ref_ptr<osg::Node> node = result.takeNode();
-                glm::dvec3 worldPosition = ellipsoid.cartographicToCartesian(cartographicPositions[i]);
+        const auto &node = nodes[i];
+        if (!node) {
+            continue;
+        }
 
-                double orientation = 0.0;
-                if (i < orientations.size()) {
-                    orientation = orientations[i];
-                }
+        // combine mesh
+        glm::dvec3 worldPosition = ellipsoid.cartographicToCartesian(cartographicPositions[i]);
 
-                glm::dvec3 scale(1.0f);
-                if (i < scales.size()) {
-                    scale = scales[i];
-                }
+        double orientation = 0.0;
+        if (i < orientations.size()) {
+            orientation = orientations[i];
+        }
 
-                glm::dmat4 transform = glm::scale(calculateModelOrientation(worldPosition, orientation),
-                                                  scale);
+        glm::dvec3 scale(1.0f);
+        if (i < scales.size()) {
+            scale = scales[i];
+        }
 
-                m_model3DResult.setTransformationMatrix(transform);
-                m_model3DResult.setFeatureID(featureID);
-                node->accept(m_model3DResult);
+        glm::dmat4 transform = glm::scale(calculateModelOrientation(worldPosition, orientation), scale);
 
-                // extract input instance index
-                extractedInstances.emplace_back(i);
-                ++featureID;
-            }
-        }
+        m_model3DResult.setTransformationMatrix(transform);
+        m_model3DResult.setFeatureID(featureID);
+        node->accept(m_model3DResult);
+
+        // extract input instance index
+        extractedInstances.emplace_back(i);
+        ++featureID;
     }
 
-    extractInputInstancesAttribs(extractedInstances, instancesAttribs);
+    // the attributes of the instances without a model are dropped in place
+    m_attributes.retainInstances(extractedInstances);
 
     m_model3DResult.finalize();
 }
 
-CDBGSModels::~CDBGSModels() noexcept
-{
-    // OSG doesn't close the archive after ref_ptr is released, so we do it ourselves
-    m_GSModelArchive->close();
-}
-
 std::string CDBGSModels::getModelFilename(const std::string &FACC, const std::string &MODL, int FSC) const
 {
-    return "/" + m_tileFilename + "_" + FACC + "_" + toStringWithZeroPadding(3, FSC) + "_" + MODL + ".flt";
+    return m_tileFilename + "_" + FACC + "_" + toStringWithZeroPadding(3, FSC) + "_" + MODL + ".flt";
 }
 
 std::optional<CDBGSModels> CDBGSModels::createFromModelsAttributes(CDBModelsAttributes attributes,
-                                                                   const std::filesystem::path &CDBPath)
+                                                                   const std::filesystem::path &CDBPath,
+                                                                   CDBGSModelArchiveCache *archives,
+                                                                   ThreadPool *threadPool)
 {
     const auto &instancesAttribs = attributes.getInstancesAttributes();
     const auto &stringAttribs = instancesAttribs.getStringAttribs();
@@ -531,6 +941,10 @@ std::optional<CDBGSModels> CDBGSModels::createFromModelsAttributes(CDBModelsAttr
         return std::nullopt;
     }
 
+    auto openArchive = [archives](const std::filesystem::path &zipPath) {
+        return archives ? archives->open(zipPath) : CDBGSModelArchive::open(zipPath);
+    };
+
     // find GSModel archive
     const CDBTile &attributeTile = attributes.getTile();
     CDBTile modelTile(attributeTile.getGeoCell(),
@@ -542,107 +956,41 @@ std::optional<CDBGSModels> CDBGSModels::createFromModelsAttributes(CDBModelsAttr
                       attributeTile.getRREF());
 
     std::filesystem::path GSModelZip = CDBPath / (modelTile.getRelativePath().string() + ".zip");
-    if (!std::filesystem::exists(GSModelZip)) {
+    auto GSModelArchive = openArchive(GSModelZip);
+    if (!GSModelArchive) {
         return std::nullopt;
     }
 
-    osgDB::ReaderWriter *rw = osgDB::Registry::instance()->getReaderWriterForExtension("zip");
-    if (rw) {
-        // set relative path for GSModel
-        osg::ref_ptr<osgDB::Options> options = new osgDB::Options();
-        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
-        options->getDatabasePathList().push_front(GSModelZip.parent_path());
-
-        // find GSModelTexture zip file to search for texture
-        CDBTile GSModelTextureTile = CDBTile(attributeTile.getGeoCell(),
-                                             CDBDataset::GSModelTexture,
-                                             1,
-                                             1,
-                                             attributeTile.getLevel(),
-                                             attributeTile.getUREF(),
-                                             attributeTile.getRREF());
-
-        std::filesystem::path GSModelTextureRelPath = GSModelTextureTile.getRelativePath();
-        std::string GSModelTextureTileName = GSModelTextureRelPath.stem().string();
-        std::filesystem::path GSModelTextureZip = CDBPath / (GSModelTextureRelPath.string() + ".zip");
-        osgDB::ReaderWriter::ReadResult GSModelTextureRead = rw->openArchive(GSModelTextureZip,
-                                                                             osgDB::Archive::READ);
-        if (GSModelTextureRead.validArchive()) {
-            osg::ref_ptr<osgDB::Archive> GSModelTextureArchive = GSModelTextureRead.takeArchive();
-            osg::ref_ptr<FindGSModelTexture> findMissingFile = new FindGSModelTexture(GSModelTextureTileName,
-                                                                                      GSModelTextureArchive);
-            options->setFindFileCallback(findMissingFile);
-            options->setReadFileCallback(findMissingFile);
-        }
-
-        // read GSModel geometry
-        osgDB::ReaderWriter::ReadResult GSModelRead = rw->openArchive(GSModelZip, osgDB::Archive::READ);
-        if (GSModelRead.validArchive()) {
-            osg::ref_ptr<osgDB::Archive> archive = GSModelRead.takeArchive();
-            return CDBGSModels(std::move(attributes), modelTile, archive, options);
-        }
-    }
-
-    return std::nullopt;
-}
-
-void CDBGSModels::extractInputInstancesAttribs(const std::vector<size_t> &extractedInstancesIdx,
-                                               const CDBInstancesAttributes &inputInstancesAttribs)
-{
-    size_t totalExtracted = extractedInstancesIdx.size();
-    auto &modelIntegerAttribs = m_attributes.getIntegerAttribs();
-    for (auto inputPair : inputInstancesAttribs.getIntegerAttribs()) {
-        const auto &inputValues = inputPair.second;
-        auto &modelValues = modelIntegerAttribs[inputPair.first];
-        modelValues.reserve(totalExtracted);
-
-        for (auto i : extractedInstancesIdx) {
-            modelValues.emplace_back(inputValues[i]);
-        }
-    }
-
-    auto &modelDoubleAttribs = m_attributes.getDoubleAttribs();
-    for (auto inputPair : inputInstancesAttribs.getDoubleAttribs()) {
-        const auto &inputValues = inputPair.second;
-        auto &modelValues = modelDoubleAttribs[inputPair.first];
-        modelValues.reserve(totalExtracted);
-
-        for (auto i : extractedInstancesIdx) {
-            modelValues.emplace_back(inputValues[i]);
-        }
-    }
-
-    auto &modelStringAttribs = m_attributes.getStringAttribs();
-    for (auto inputPair : inputInstancesAttribs.getStringAttribs()) {
-        const auto &inputValues = inputPair.second;
-        auto &modelValues = modelStringAttribs[inputPair.first];
-        modelValues.reserve(totalExtracted);
-
-        for (auto i : extractedInstancesIdx) {
-            modelValues.emplace_back(inputValues[i]);
-        }
+    // set relative path for GSModel
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options();
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+    options->getDatabasePathList().push_front(GSModelZip.parent_path().string());
+
+    // find GSModelTexture zip file to search for texture
+    CDBTile GSModelTextureTile = CDBTile(attributeTile.getGeoCell(),
+                                         CDBDataset::GSModelTexture,
+                                         1,
+                                         1,
+                                         attributeTile.getLevel(),
+                                         attributeTile.getUREF(),
+                                         attributeTile.getRREF());
+
+    std::filesystem::path GSModelTextureZip = CDBPath
+                                              / (GSModelTextureTile.getRelativePath().string() + ".zip");
+    auto GSModelTextureArchive = openArchive(GSModelTextureZip);
+    if (GSModelTextureArchive) {
+        osg::ref_ptr<FindGSModelTexture> findMissingFile = new FindGSModelTexture(GSModelTextureArchive);
+        options->setFindFileCallback(findMissingFile);
+        options->setReadFileCallback(findMissingFile);
     }
 
-    const auto &inputCNAMs = inputInstancesAttribs.getCNAMs();
-    auto &CNAMs = m_attributes.getCNAMs();
-    CNAMs.reserve(totalExtracted);
-    for (auto i : extractedInstancesIdx) {
-        CNAMs.emplace_back(inputCNAMs[i]);
-    }
+    return CDBGSModels(std::move(attributes), modelTile, std::move(GSModelArchive), options, threadPool);
 }
 
-CDBGSModels::FindGSModelTexture::FindGSModelTexture(const std::string &GSModelTextureTileName,
-                                                    osg::ref_ptr<osgDB::Archive> archive)
-    : m_archive{archive}
-    , m_GSModelTextureTileName{GSModelTextureTileName}
+CDBGSModels::FindGSModelTexture::FindGSModelTexture(std::shared_ptr<const CDBGSModelArchive> archive)
+    : m_archive{std::move(archive)}
 {}
 
-CDBGSModels::FindGSModelTexture::~FindGSModelTexture() noexcept
-{
-    // OSG doesn't close the archive after ref_ptr is released, so we do it ourselves
-    m_archive->close();
-}
-
 std::string CDBGSModels::FindGSModelTexture::findDataFile(const std::string &filename,
                                                           const osgDB::Options *options,
                                                           osgDB::CaseSensitivity caseSensitivity)
@@ -663,8 +1011,8 @@ osgDB::ReaderWriter::ReadResult CDBGSModels::FindGSModelTexture::readImage(const
                                                                            const osgDB::Options *options)
 {
     // look into archive first
-    auto textureFile = m_archiveEntries.find(filename);
-    if (textureFile != m_archiveEntries.end()) {
+    auto textureFile = m_archive->tileEntries.find(filename);
+    if (textureFile != m_archive->tileEntries.end()) {
         auto imageRead = m_archive->readImage(textureFile->second, options);
         if (imageRead.validImage()) {
             osg::ref_ptr<osg::Image> image = imageRead.takeImage();
@@ -678,41 +1026,122 @@ osgDB::ReaderWriter::ReadResult CDBGSModels::FindGSModelTexture::readImage(const
     return ReadFileCallback::readImage(filename, options);
 }
 
-std::string CDBGSModels::FindGSModelTexture::searchArchiveTextureName(const std::string &filename)
+std::string CDBGSModels::FindGSModelTexture::searchArchiveTextureName(const std::string &filename) const
 {
     if (!m_archive) {
         return "";
     }
 
-    if (!m_archiveEntries.empty()) {
-        for (const auto &entry : m_archiveEntries) {
-            if (filename.find(entry.first) != std::string::npos) {
-                return entry.first;
+    for (const auto &entry : m_archive->tileEntries) {
+        if (filename.find(entry.first) != std::string::npos) {
+            return entry.first;
+        }
+    }
+
+    return "";
+}
+
+std::string FindVirtualFile::findDataFile(const std::string &filename,
+                                          const osgDB::Options *options,
+                                          osgDB::CaseSensitivity caseSensitivity)
+{
+    if (!isVirtualFileSystemPath(filename)) {
+        // external references and textures are relative to the directory of the model
+        if (options) {
+            for (const auto &directory : options->getDatabasePathList()) {
+                std::string path = osgDB::concatPaths(directory, filename);
+                auto status = getFileStatus(path);
+                if (status && !status->isDirectory) {
+                    return path;
+                }
             }
         }
 
-        return "";
+        return FindFileCallback::findDataFile(filename, options, caseSensitivity);
     }
 
-    std::string fileFound = "";
-    std::vector<std::string> entryList;
-    if (m_archive->getFileNames(entryList)) {
-        for (const auto &entry : entryList) {
-            std::string textureName;
+    auto status = getFileStatus(filename);
+    return status && !status->isDirectory ? filename : "";
+}
 
-            // +2 is because osg adds separator "/" at the beginning for each entry and there is a separator "_" near the end
-            if (entry.size() > m_GSModelTextureTileName.size() + 2) {
-                textureName = entry.substr(m_GSModelTextureTileName.size() + 2);
-                m_archiveEntries.insert({textureName, entry});
-            }
+osgDB::ReaderWriter::ReadResult FindVirtualFile::readNode(const std::string &filename,
+                                                          const osgDB::Options *options)
+{
+    auto read = [](osgDB::ReaderWriter &rw, std::istream &stream, const osgDB::Options *fileOptions) {
+        return rw.readNode(stream, fileOptions);
+    };
 
-            if (filename.find(textureName) != std::string::npos) {
-                fileFound = textureName;
-            }
-        }
+    std::string path = findDataFile(filename, options, osgDB::CASE_SENSITIVE);
+    if (!isVirtualFileSystemPath(path)) {
+        return ReadFileCallback::readNode(filename, options);
     }
 
-    return fileFound;
+    return readVirtualFile(path, options, read);
+}
+
+osgDB::ReaderWriter::ReadResult FindVirtualFile::readImage(const std::string &filename,
+                                                           const osgDB::Options *options)
+{
+    auto read = [](osgDB::ReaderWriter &rw, std::istream &stream, const osgDB::Options *fileOptions) {
+        return rw.readImage(stream, fileOptions);
+    };
+
+    std::string path = findDataFile(filename, options, osgDB::CASE_SENSITIVE);
+    if (!isVirtualFileSystemPath(path)) {
+        return ReadFileCallback::readImage(filename, options);
+    }
+
+    return readVirtualFile(path, options, read);
+}
+
+osgDB::ReaderWriter::ReadResult readArchiveEntry(const MappedZipArchive &archive,
+                                                 const std::string &entry,
+                                                 const osgDB::Options *options,
+                                                 const ReadStream &read)
+{
+    std::vector<char> inflated;
+    auto data = archive.readEntry(entry, inflated);
+    if (!data) {
+        return osgDB::ReaderWriter::ReadResult::ERROR_IN_READING_FILE;
+    }
+
+    return readMemory(entry, *data, options, read);
+}
+
+osgDB::ReaderWriter::ReadResult readVirtualFile(const std::string &filename,
+                                                const osgDB::Options *options,
+                                                const ReadStream &read)
+{
+    auto data = readFile(filename);
+    if (!data) {
+        return osgDB::ReaderWriter::ReadResult::FILE_NOT_FOUND;
+    }
+
+    return readMemory(filename, std::string_view(data->data(), data->size()), options, read);
+}
+
+osgDB::ReaderWriter::ReadResult readMemory(const std::string &filename,
+                                           std::string_view data,
+                                           const osgDB::Options *options,
+                                           const ReadStream &read)
+{
+    osgDB::ReaderWriter *rw = osgDB::Registry::instance()->getReaderWriterForExtension(
+        osgDB::getLowerCaseFileExtension(filename));
+    if (!rw) {
+        return osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED;
+    }
+
+    // same options as the OSG zip plugin gives to the reader of an entry
+    osg::ref_ptr<osgDB::Options> fileOptions = options ? options->cloneOptions() : new osgDB::Options();
+    fileOptions->setPluginStringData("STREAM_FILENAME", osgDB::getSimpleFileName(filename));
+    std::string fileDirectory = osgDB::getFilePath(filename);
+    if (!fileDirectory.empty()) {
+        fileOptions->getDatabasePathList().push_front(fileDirectory);
+    }
+
+    MemoryStreamBuffer buffer(data);
+    std::istream stream(&buffer);
+    return read(*rw, stream, fileOptions.get());
 }
 
 } // namespace CDBTo3DTiles
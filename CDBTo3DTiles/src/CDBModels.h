@@ -1,12 +1,22 @@
 #pragma once
 
 #include "CDBAttributes.h"
+#include "CDBManifest.h"
+#include "MappedZipArchive.h"
 #include "Scene.h"
+#include "ThreadPool.h"
+#include "Utility.h"
 #include "osg/NodeVisitor"
 #include "osg/StateSet"
-#include "osgDB/Archive"
+#include "osgDB/ReaderWriter"
+#include <future>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <stack>
+#include <string_view>
+#include <unordered_map>
 
 namespace CDBTo3DTiles {
 class GeometryValueVisitor : public osg::ValueVisitor
@@ -57,6 +67,8 @@ protected:
         if (indices == 0 || count == 0)
             return;
 
+        reserveTriangleIndices(mode, count);
+
         typedef const T *IndexPointer;
 
         switch (mode) {
@@ -112,6 +124,8 @@ protected:
     }
 
 private:
+    void reserveTriangleIndices(GLenum mode, GLsizei count);
+
     GeometryPrimitiveFunctor &operator=(const GeometryPrimitiveFunctor &);
     size_t m_indexOffset;
     Mesh &m_mesh;
@@ -136,12 +150,16 @@ public:
 
     inline const std::vector<Mesh> &getMeshes() const noexcept { return m_meshes; }
 
+    inline std::vector<Mesh> &getMeshes() noexcept { return m_meshes; }
+
     inline const std::vector<Material> &getMaterials() const noexcept { return m_materials; }
 
     inline const std::vector<Texture> &getTextures() const noexcept { return m_textures; }
 
     inline const std::vector<osg::ref_ptr<osg::Image>> &getImages() const noexcept { return m_images; }
 
+    size_t getTriangleCount() const noexcept;
+
 private:
     struct CompareStateSet
     {
@@ -170,21 +188,116 @@ private:
     std::vector<osg::ref_ptr<osg::Image>> m_images;
 };
 
+// a model with few instances in a tile draws faster baked into the tile geometry than instanced on the
+// client, as long as its copies stay small. Nothing is baked when maxInstances is 0. maxTriangles of 0 has
+// no limit
+struct CDBGTModelBaking
+{
+    CDBGTModelBaking();
+
+    bool shouldBake(size_t instanceCount, size_t modelTriangleCount) const noexcept;
+
+    size_t maxInstances;
+    size_t maxTriangles;
+};
+
+// a GTModel of the cache, hashed from its fields so a lookup doesn't build the name of the model file. The
+// fields are views on the strings of the caller for a lookup, and on the strings of the cache for its keys
+struct CDBGTModelKey
+{
+    std::string_view FACC;
+    std::string_view MODL;
+    int FSC;
+};
+
+bool operator==(const CDBGTModelKey &lhs, const CDBGTModelKey &rhs) noexcept;
+} // namespace CDBTo3DTiles
+
+namespace std {
+template<>
+struct hash<CDBTo3DTiles::CDBGTModelKey>
+{
+    size_t operator()(CDBTo3DTiles::CDBGTModelKey const &key) const noexcept
+    {
+        size_t seed = 0;
+        CDBTo3DTiles::hashCombine(seed, key.FACC);
+        CDBTo3DTiles::hashCombine(seed, key.MODL);
+        CDBTo3DTiles::hashCombine(seed, key.FSC);
+        return seed;
+    }
+};
+} // namespace std
+
+namespace CDBTo3DTiles {
+
+// shared by every GeoCell. Each model is loaded once even when several threads ask for it at the same time.
+// Once the loaded models exceed the memory budget, the least recently used ones are dropped
 class CDBGTModelCache
 {
 public:
-    CDBGTModelCache(const std::filesystem::path &CDBPath);
+    struct Statistics
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t bytes;
+    };
 
-    const CDBModel3DResult *locateModel3D(const std::string &FACC,
-                                          const std::string &MODL,
-                                          int FSC,
-                                          std::string &modelKey) const;
+    // a memory budget of 0 keeps every model
+    CDBGTModelCache(const std::filesystem::path &CDBPath,
+                    std::shared_ptr<CDBManifest> manifest = nullptr,
+                    size_t memoryBudget = 0);
+
+    std::shared_ptr<const CDBModel3DResult> locateModel3D(const std::string &FACC,
+                                                          const std::string &MODL,
+                                                          int FSC,
+                                                          std::string &modelKey) const;
+
+    void prefetchModel3D(const std::string &FACC, const std::string &MODL, int FSC, TaskGroup &tasks) const;
 
-private:
     std::string getModelKey(const std::string &FACC, const std::string &MODL, int FCC) const;
 
+    Statistics getStatistics() const;
+
+    // drops the least recently used models down to half of the memory budget, or half of the loaded models
+    // without one, to free memory while tiles are converted. The models handed out stay valid for their
+    // owners
+    void shrink() const;
+
+private:
+    // the fields the keys of a model point to, along with the name of its file, built once
+    struct ModelName
+    {
+        std::string FACC;
+        std::string MODL;
+        int FSC;
+        std::string name;
+    };
+
+    struct CachedModel
+    {
+        std::shared_future<std::shared_ptr<const CDBModel3DResult>> model;
+        std::list<ModelName>::iterator LRUPosition;
+        size_t bytes;
+        bool isLoaded;
+    };
+
+    void evictModels(size_t maxBytes, const CDBGTModelKey *keptKey) const;
+
+    void indexModelGeometries() const;
+
+    std::shared_ptr<const CDBModel3DResult> loadModel3D(const std::string &FACC,
+                                                        const std::string &key) const;
+
     std::filesystem::path m_CDBPath;
-    mutable std::map<std::string, CDBModel3DResult> m_keyToModel;
+    std::shared_ptr<CDBManifest> m_manifest;
+    mutable std::once_flag m_indexFlag;
+    mutable std::unordered_map<std::string, std::filesystem::path> m_FACCModelToPath;
+    size_t m_memoryBudget;
+    mutable std::mutex m_mutex;
+    mutable Statistics m_statistics;
+    mutable std::list<ModelName> m_LRUModels;
+    mutable std::unordered_map<CDBGTModelKey, CachedModel> m_keyToModel;
 };
 
 class CDBGTModels
@@ -194,7 +307,11 @@ public:
 
     inline const CDBModelsAttributes &getModelsAttributes() const noexcept { return *m_attributes; }
 
-    const CDBModel3DResult *locateModel3D(size_t instanceIdx, std::string &modelKey) const;
+    std::shared_ptr<const CDBModel3DResult> locateModel3D(size_t instanceIdx, std::string &modelKey) const;
+
+    std::optional<std::string> getModelKey(size_t instanceIdx) const;
+
+    void prefetchModels3D(TaskGroup &tasks) const;
 
     static std::optional<CDBGTModels> createFromModelsAttributes(CDBModelsAttributes attributes,
                                                                  CDBGTModelCache *cache);
@@ -204,15 +321,46 @@ private:
     std::optional<CDBModelsAttributes> m_attributes;
 };
 
+// a zip archive mapped in memory with its entries listed once. Its entries are read from several threads, so
+// the archive is shared by the tiles and models read from it. It is unmapped with its last owner
+struct CDBGSModelArchive
+{
+    CDBGSModelArchive();
+
+    static std::shared_ptr<const CDBGSModelArchive> open(const std::filesystem::path &zipPath);
+
+    // the entries are given to the OSG plugin of their extension through a memory stream
+    osgDB::ReaderWriter::ReadResult readNode(const std::string &entry, const osgDB::Options *options) const;
+
+    osgDB::ReaderWriter::ReadResult readImage(const std::string &entry, const osgDB::Options *options) const;
+
+    std::unique_ptr<MappedZipArchive> archive;
+
+    // entries named {tile name}_{name} in a GSModel texture archive, by name
+    std::map<std::string, std::string> tileEntries;
+};
+
+// the GSModel archives of a GeoCell. A geometry or texture archive is used by the tiles of every component
+// selector at its level and position, so each one is opened and listed once
+class CDBGSModelArchiveCache
+{
+public:
+    std::shared_ptr<const CDBGSModelArchive> open(const std::filesystem::path &zipPath);
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const CDBGSModelArchive>>> m_archives;
+};
+
 class CDBGSModels
 {
 public:
+    // the models of the tile are read in parallel with the thread pool, or sequentially without it
     explicit CDBGSModels(CDBModelsAttributes modelsAttributes,
                          const CDBTile &tile,
-                         const osg::ref_ptr<osgDB::Archive> &GSModelArchive,
-                         const osg::ref_ptr<osgDB::Options> &options);
-
-    ~CDBGSModels() noexcept;
+                         std::shared_ptr<const CDBGSModelArchive> GSModelArchive,
+                         const osg::ref_ptr<osgDB::Options> &options,
+                         ThreadPool *threadPool = nullptr);
 
     inline const CDBInstancesAttributes &getInstancesAttributes() const noexcept { return m_attributes; }
 
@@ -220,16 +368,18 @@ public:
 
     inline const CDBModel3DResult &getModel3D() const noexcept { return m_model3DResult; }
 
+    inline CDBModel3DResult &getModel3D() noexcept { return m_model3DResult; }
+
     static std::optional<CDBGSModels> createFromModelsAttributes(CDBModelsAttributes attributes,
-                                                                 const std::filesystem::path &CDBPath);
+                                                                 const std::filesystem::path &CDBPath,
+                                                                 CDBGSModelArchiveCache *archives = nullptr,
+                                                                 ThreadPool *threadPool = nullptr);
 
 private:
     class FindGSModelTexture : public osgDB::FindFileCallback, public osgDB::ReadFileCallback
     {
     public:
-        FindGSModelTexture(const std::string &GSModelTextureTileName, osg::ref_ptr<osgDB::Archive> archive);
-
-        ~FindGSModelTexture() noexcept;
+        explicit FindGSModelTexture(std::shared_ptr<const CDBGSModelArchive> archive);
 
         std::string findDataFile(const std::string &filename,
                                  const osgDB::Options *options,
@@ -239,21 +389,16 @@ private:
                                                   const osgDB::Options *options) override;
 
     private:
-        std::string searchArchiveTextureName(const std::string &filename);
+        std::string searchArchiveTextureName(const std::string &filename) const;
 
-        osg::ref_ptr<osgDB::Archive> m_archive;
-        std::map<std::string, std::string> m_archiveEntries;
-        std::string m_GSModelTextureTileName;
+        std::shared_ptr<const CDBGSModelArchive> m_archive;
     };
 
-    void extractInputInstancesAttribs(const std::vector<size_t> &extractedInstancesIdx,
-                                      const CDBInstancesAttributes &instancesAttribs);
-
     std::string getModelFilename(const std::string &FACC, const std::string &MODL, int FSC) const;
 
     std::string m_tileFilename;
     CDBModel3DResult m_model3DResult;
-    osg::ref_ptr<osgDB::Archive> m_GSModelArchive;
+    std::shared_ptr<const CDBGSModelArchive> m_GSModelArchive;
     std::optional<CDBTile> m_tile;
     CDBInstancesAttributes m_attributes;
 };
@@ -1,5 +1,6 @@
 #include "CDBTile.h"
 #include "CDB.h"
+#include <cmath>
 
 namespace CDBTo3DTiles {
 
@@ -10,7 +11,15 @@ constexpr int MAX_POSITIVE_LOD_WIDTH[] = {
     1 << 16, 1 << 17, 1 << 18, 1 << 19, 1 << 20, 1 << 21, 1 << 22, 1 << 23,
 };
 
+bool operator==(const CDBTileKey &lhs, const CDBTileKey &rhs) noexcept
+{
+    return lhs.geoCell == rhs.geoCell && lhs.level == rhs.level && lhs.UREF == rhs.UREF
+           && lhs.RREF == rhs.RREF && lhs.CS_1 == rhs.CS_1 && lhs.CS_2 == rhs.CS_2
+           && lhs.dataset == rhs.dataset;
+}
+
 CDBTile::CDBTile(CDBGeoCell geoCell, CDBDataset dataset, int CS_1, int CS_2, int level, int UREF, int RREF)
+    : m_key{geoCell, dataset, CS_1, CS_2, level, UREF, RREF}
 {
     if (level < -10 || level > MAX_LEVEL) {
         throw std::invalid_argument("Level is out of range. Minimum is -10 and maximum is 23");
@@ -30,44 +39,22 @@ CDBTile::CDBTile(CDBGeoCell geoCell, CDBDataset dataset, int CS_1, int CS_2, int
             throw std::invalid_argument("Positive level tile has RREF out of range");
         }
     }
-
-    m_geoCell = geoCell;
-    m_dataset = dataset;
-    m_CS_1 = CS_1;
-    m_CS_2 = CS_2;
-    m_level = level;
-    m_UREF = UREF;
-    m_RREF = RREF;
-    m_region = calcBoundRegion(*m_geoCell, m_level, m_UREF, m_RREF);
-    m_path = convertToPath();
 }
 
+CDBTile::CDBTile(const CDBTileKey &key)
+    : CDBTile(key.geoCell, key.dataset, key.CS_1, key.CS_2, key.level, key.UREF, key.RREF)
+{}
+
 CDBTile::CDBTile(const CDBTile &other)
     : m_customContentURI{other.m_customContentURI}
-    , m_region{other.m_region}
-    , m_path{other.m_path}
-    , m_geoCell{other.m_geoCell}
-    , m_dataset{other.m_dataset}
-    , m_CS_1{other.m_CS_1}
-    , m_CS_2{other.m_CS_2}
-    , m_level{other.m_level}
-    , m_UREF{other.m_UREF}
-    , m_RREF{other.m_RREF}
+    , m_key{other.m_key}
 {}
 
 CDBTile &CDBTile::operator=(const CDBTile &other)
 {
     if (&other != this) {
         m_customContentURI = other.m_customContentURI;
-        m_region = other.m_region;
-        m_path = other.m_path;
-        m_geoCell = other.m_geoCell;
-        m_dataset = other.m_dataset;
-        m_CS_1 = other.m_CS_1;
-        m_CS_2 = other.m_CS_2;
-        m_level = other.m_level;
-        m_UREF = other.m_UREF;
-        m_RREF = other.m_RREF;
+        m_key = other.m_key;
     }
 
     return *this;
@@ -298,70 +285,69 @@ std::optional<CDBTile> CDBTile::createFromFile(const std::string &filename)
 
 std::string CDBTile::getUREFDirectoryName() const noexcept
 {
-    return "U" + std::to_string(m_UREF);
+    return "U" + std::to_string(m_key.UREF);
 }
 
 std::string CDBTile::getRREFName() const noexcept
 {
-    return "R" + std::to_string(m_RREF);
+    return "R" + std::to_string(m_key.RREF);
 }
 
 std::string CDBTile::getCS_1Name() const noexcept
 {
-    return "S" + toStringWithZeroPadding(3, m_CS_1);
+    return "S" + toStringWithZeroPadding(3, m_key.CS_1);
 }
 
 std::string CDBTile::getCS_2Name() const noexcept
 {
-    return "T" + toStringWithZeroPadding(3, m_CS_2);
+    return "T" + toStringWithZeroPadding(3, m_key.CS_2);
 }
 
 std::string CDBTile::getLevelInFilename() const noexcept
 {
-    if (m_level < 0) {
-        return "LC" + toStringWithZeroPadding(2, glm::abs(m_level));
+    if (m_key.level < 0) {
+        return "LC" + toStringWithZeroPadding(2, glm::abs(m_key.level));
     }
 
-    return "L" + toStringWithZeroPadding(2, m_level);
+    return "L" + toStringWithZeroPadding(2, m_key.level);
 }
 
 std::string CDBTile::getLevelDirectoryName() const noexcept
 {
-    if (m_level < 0) {
+    if (m_key.level < 0) {
         return "LC";
     }
 
-    return "L" + toStringWithZeroPadding(2, m_level);
+    return "L" + toStringWithZeroPadding(2, m_key.level);
 }
 
-std::filesystem::path CDBTile::convertToPath() const noexcept
+std::filesystem::path CDBTile::getRelativePath() const noexcept
 {
-    std::string latitudeDir = m_geoCell->getLatitudeDirectoryName();
-    std::string longitudeDir = m_geoCell->getLongitudeDirectoryName();
-
-    std::string datasetDir = getCDBDatasetDirectoryName(m_dataset);
-    std::string datasetInTileFilename = "D" + toStringWithZeroPadding(3, static_cast<unsigned>(m_dataset));
-
+    std::string latitudeDir = m_key.geoCell.getLatitudeDirectoryName();
+    std::string longitudeDir = m_key.geoCell.getLongitudeDirectoryName();
+    std::string datasetDir = getCDBDatasetDirectoryName(m_key.dataset);
     std::string levelDir = getLevelDirectoryName();
-    std::string levelInTileFilename = getLevelInFilename();
-
     std::string UREFDir = getUREFDirectoryName();
-    std::string RREFName = getRREFName();
-
-    std::string CS_1 = getCS_1Name();
-    std::string CS_2 = getCS_2Name();
-
-    std::string tileFilename = latitudeDir + longitudeDir + "_" + datasetInTileFilename + "_" + CS_1 + "_"
-                               + CS_2 + "_" + levelInTileFilename + "_" + UREFDir + "_" + RREFName;
+    return CDB::TILES / latitudeDir / longitudeDir / datasetDir / levelDir / UREFDir / getFilename();
+}
 
-    return CDB::TILES / latitudeDir / longitudeDir / datasetDir / levelDir / UREFDir / tileFilename;
+std::string CDBTile::getFilename() const noexcept
+{
+    unsigned dataset = static_cast<unsigned>(m_key.dataset);
+    std::string datasetInTileFilename = "D" + toStringWithZeroPadding(3, dataset);
+    return m_key.geoCell.getLatitudeDirectoryName() + m_key.geoCell.getLongitudeDirectoryName() + "_"
+           + datasetInTileFilename + "_" + getCS_1Name() + "_" + getCS_2Name() + "_" + getLevelInFilename()
+           + "_" + getUREFDirectoryName() + "_" + getRREFName();
 }
 
 Core::BoundingRegion CDBTile::calcBoundRegion(const CDBGeoCell &geoCell, int level, int UREF, int RREF) noexcept
 {
+    // negative levels cover the whole GeoCell, positive levels split it into a grid of their width
     double distLOD = 1.0;
-    if (level > 0) {
-        distLOD = glm::pow(2.0, -level);
+    if (level > 0 && level <= MAX_LEVEL) {
+        distLOD = 1.0 / MAX_POSITIVE_LOD_WIDTH[level];
+    } else if (level > MAX_LEVEL) {
+        distLOD = std::ldexp(1.0, -level);
     }
     double longUnitLOD = distLOD * geoCell.getLongitudeExtentInDegree();
     double latUnitLOD = distLOD * geoCell.getLatitudeExtentInDegree();
@@ -379,9 +365,7 @@ Core::BoundingRegion CDBTile::calcBoundRegion(const CDBGeoCell &geoCell, int lev
 
 bool operator==(const CDBTile &lhs, const CDBTile &rhs) noexcept
 {
-    return lhs.m_geoCell == rhs.m_geoCell && lhs.m_level == rhs.m_level && lhs.m_UREF == rhs.m_UREF
-           && lhs.m_RREF == rhs.m_RREF && lhs.m_CS_1 == rhs.m_CS_1 && lhs.m_CS_2 == rhs.m_CS_2
-           && lhs.m_dataset == rhs.m_dataset;
+    return lhs.m_key == rhs.m_key;
 }
 
 } // namespace CDBTo3DTiles
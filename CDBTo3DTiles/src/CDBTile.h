@@ -3,13 +3,31 @@
 #include "BoundingRegion.h"
 #include "CDBDataset.h"
 #include "CDBGeoCell.h"
+#include <cstdint>
 
 namespace CDBTo3DTiles {
+// the identity of a tile. It is trivially copyable, so caches keyed by tiles never copy paths or regions
+struct CDBTileKey
+{
+    CDBGeoCell geoCell;
+    CDBDataset dataset;
+    int CS_1;
+    int CS_2;
+    int level;
+    int UREF;
+    int RREF;
+};
+
+bool operator==(const CDBTileKey &lhs, const CDBTileKey &rhs) noexcept;
+
+// paths and bound regions are computed from the key when they are requested
 class CDBTile
 {
 public:
     CDBTile(CDBGeoCell geoCell, CDBDataset dataset, int CS_1, int CS_2, int level, int UREF, int RREF);
 
+    explicit CDBTile(const CDBTileKey &key);
+
     CDBTile(const CDBTile &);
 
     CDBTile(CDBTile &&) noexcept = default;
@@ -18,23 +36,31 @@ public:
 
     CDBTile &operator=(CDBTile &&) noexcept = default;
 
-    inline const std::filesystem::path &getRelativePath() const noexcept { return m_path; }
+    std::filesystem::path getRelativePath() const noexcept;
 
-    inline const Core::BoundingRegion &getBoundRegion() const noexcept { return *m_region; }
+    // the last component of the relative path, without the directories
+    std::string getFilename() const noexcept;
 
-    inline const CDBGeoCell &getGeoCell() const noexcept { return *m_geoCell; }
+    inline Core::BoundingRegion getBoundRegion() const noexcept
+    {
+        return calcBoundRegion(m_key.geoCell, m_key.level, m_key.UREF, m_key.RREF);
+    }
+
+    inline const CDBTileKey &getKey() const noexcept { return m_key; }
+
+    inline const CDBGeoCell &getGeoCell() const noexcept { return m_key.geoCell; }
 
-    inline CDBDataset getDataset() const noexcept { return m_dataset; }
+    inline CDBDataset getDataset() const noexcept { return m_key.dataset; }
 
-    inline int getCS_1() const noexcept { return m_CS_1; }
+    inline int getCS_1() const noexcept { return m_key.CS_1; }
 
-    inline int getCS_2() const noexcept { return m_CS_2; }
+    inline int getCS_2() const noexcept { return m_key.CS_2; }
 
-    inline int getLevel() const noexcept { return m_level; }
+    inline int getLevel() const noexcept { return m_key.level; }
 
-    inline int getUREF() const noexcept { return m_UREF; }
+    inline int getUREF() const noexcept { return m_key.UREF; }
 
-    inline int getRREF() const noexcept { return m_RREF; }
+    inline int getRREF() const noexcept { return m_key.RREF; }
 
     inline const std::vector<CDBTile *> &getChildren() const noexcept { return m_children; }
 
@@ -82,38 +108,40 @@ private:
 
     std::string getLevelDirectoryName() const noexcept;
 
-    std::filesystem::path convertToPath() const noexcept;
-
     std::vector<CDBTile *> m_children;
     std::optional<std::filesystem::path> m_customContentURI;
-    std::optional<Core::BoundingRegion> m_region;
-    std::filesystem::path m_path;
-    std::optional<CDBGeoCell> m_geoCell;
-    CDBDataset m_dataset;
-    int m_CS_1;
-    int m_CS_2;
-    int m_level;
-    int m_UREF;
-    int m_RREF;
+    CDBTileKey m_key;
 };
 } // namespace CDBTo3DTiles
 
 namespace std {
 template<>
-struct hash<CDBTo3DTiles::CDBTile>
+struct hash<CDBTo3DTiles::CDBTileKey>
 {
-    size_t operator()(CDBTo3DTiles::CDBTile const &tile) const noexcept
+    // every field fits in a few bits, so the key is packed into two words before hashing them
+    size_t operator()(CDBTo3DTiles::CDBTileKey const &key) const noexcept
     {
-        size_t seed = 0;
-        CDBTo3DTiles::hashCombine(seed, tile.getGeoCell());
-        CDBTo3DTiles::hashCombine(seed, tile.getLevel());
-        CDBTo3DTiles::hashCombine(seed, tile.getUREF());
-        CDBTo3DTiles::hashCombine(seed, tile.getRREF());
-        CDBTo3DTiles::hashCombine(seed, tile.getDataset());
-        CDBTo3DTiles::hashCombine(seed, tile.getCS_1());
-        CDBTo3DTiles::hashCombine(seed, tile.getCS_2());
+        uint64_t position = static_cast<uint64_t>(key.level + 10) | (static_cast<uint64_t>(key.UREF) << 6)
+                            | (static_cast<uint64_t>(key.RREF) << 30);
+        uint64_t dataset = static_cast<uint64_t>(key.geoCell.getLatitude() + 90)
+                           | (static_cast<uint64_t>(key.geoCell.getLongitude() + 180) << 8)
+                           | (static_cast<uint64_t>(key.dataset) << 17)
+                           | (static_cast<uint64_t>(key.CS_1) << 33)
+                           | (static_cast<uint64_t>(key.CS_2) << 48);
 
+        size_t seed = 0;
+        CDBTo3DTiles::hashCombine(seed, position);
+        CDBTo3DTiles::hashCombine(seed, dataset);
         return seed;
     }
 };
+
+template<>
+struct hash<CDBTo3DTiles::CDBTile>
+{
+    size_t operator()(CDBTo3DTiles::CDBTile const &tile) const noexcept
+    {
+        return hash<CDBTo3DTiles::CDBTileKey>()(tile.getKey());
+    }
+};
 } // namespace std
@@ -1,11 +1,29 @@
 #include "CDBTileset.h"
 #include "CDB.h"
+#include "MathHelpers.h"
 #include "glm/glm.hpp"
 
 namespace CDBTo3DTiles {
 
 static glm::ivec2 getQuadtreeRelativeChild(const CDBTile &tile, const CDBTile &root);
 
+static const CDBTile *getFitChild(const CDBTile &tile, Core::Cartographic cartographic);
+
+// CDB levels range from -10 to 23, so RREF and UREF take 23 bits at most
+static constexpr int TILE_KEY_LEVEL_OFFSET = 32;
+static constexpr unsigned TILE_KEY_LEVEL_SHIFT = 48;
+
+uint64_t computeMortonCode(uint32_t x, uint32_t y) noexcept
+{
+    uint64_t code = 0;
+    for (unsigned i = 0; i < 32; ++i) {
+        code |= static_cast<uint64_t>((x >> i) & 1) << (2 * i);
+        code |= static_cast<uint64_t>((y >> i) & 1) << (2 * i + 1);
+    }
+
+    return code;
+}
+
 CDBTileset::CDBTileset()
     : m_rootLevel{-10}
     , m_rootUREF{0}
@@ -24,7 +42,17 @@ const CDBTile *CDBTileset::getRoot() const
         return nullptr;
     }
 
-    return m_tiles.front().get();
+    return &m_tiles.front();
+}
+
+const CDBTile *CDBTileset::getTile(int level, int UREF, int RREF) const
+{
+    auto tile = m_tileIndex.find(computeTileKey(level, UREF, RREF));
+    if (tile == m_tileIndex.end()) {
+        return nullptr;
+    }
+
+    return tile->second;
 }
 
 CDBTile *CDBTileset::insertTile(const CDBTile &tile)
@@ -47,18 +75,17 @@ CDBTile *CDBTileset::insertTile(const CDBTile &tile)
     }
 
     if (m_tiles.empty()) {
-        auto cdbRoot = std::make_unique<CDBTile>(tile.getGeoCell(),
-                                                 tile.getDataset(),
-                                                 tile.getCS_1(),
-                                                 tile.getCS_2(),
-                                                 m_rootLevel,
-                                                 m_rootUREF,
-                                                 m_rootRREF);
-
-        m_tiles.emplace_back(std::move(cdbRoot));
+        addTile(CDBTile(tile.getGeoCell(),
+                        tile.getDataset(),
+                        tile.getCS_1(),
+                        tile.getCS_2(),
+                        m_rootLevel,
+                        m_rootUREF,
+                        m_rootRREF));
     }
 
-    return insertTileRecursively(tile, m_tiles.front().get());
+    // the missing tiles are only created below the deepest one already in the tileset
+    return insertTileRecursively(tile, findDeepestAncestor(tile));
 }
 
 const CDBTile *CDBTileset::getFitTile(Core::Cartographic cartographic) const
@@ -68,12 +95,74 @@ const CDBTile *CDBTileset::getFitTile(Core::Cartographic cartographic) const
         return nullptr;
     }
 
-    const auto &rectangle = root->getBoundRegion().getRectangle();
+    auto rectangle = root->getBoundRegion().getRectangle();
     if (!rectangle.contains(cartographic)) {
         return nullptr;
     }
 
-    return getFitTile(root, cartographic);
+    // the child holding the point is found from the center of its parent. The regions of the children are
+    // only searched when the point lies on an edge between them, where the first child holding it wins
+    const CDBTile *tile = root;
+    while (!tile->getChildren().empty()) {
+        const auto &children = tile->getChildren();
+        if (tile->getLevel() < 0) {
+            tile = children.back();
+            continue;
+        }
+
+        auto center = tile->getBoundRegion().getRectangle().computeCenter();
+        double longitudeOffset = cartographic.longitude - center.longitude;
+        double latitudeOffset = cartographic.latitude - center.latitude;
+        const CDBTile *child = nullptr;
+        if (glm::abs(longitudeOffset) > Core::Math::EPSILON12
+            && glm::abs(latitudeOffset) > Core::Math::EPSILON12) {
+            child = children[(latitudeOffset > 0.0 ? 2 : 0) + (longitudeOffset > 0.0 ? 1 : 0)];
+        } else {
+            child = getFitChild(*tile, cartographic);
+        }
+
+        if (!child) {
+            break;
+        }
+
+        tile = child;
+    }
+
+    return tile;
+}
+
+uint64_t CDBTileset::computeTileKey(int level, int UREF, int RREF) noexcept
+{
+    uint64_t levelKey = static_cast<uint64_t>(level + TILE_KEY_LEVEL_OFFSET) << TILE_KEY_LEVEL_SHIFT;
+    return levelKey | computeMortonCode(static_cast<uint32_t>(RREF), static_cast<uint32_t>(UREF));
+}
+
+CDBTile *CDBTileset::findDeepestAncestor(const CDBTile &tile) const
+{
+    // negative levels and the root have the coordinates of the root
+    for (int level = tile.getLevel(); level > m_rootLevel; --level) {
+        int UREF = m_rootUREF;
+        int RREF = m_rootRREF;
+        if (level >= 0) {
+            UREF = tile.getUREF() >> (tile.getLevel() - level);
+            RREF = tile.getRREF() >> (tile.getLevel() - level);
+        }
+
+        auto ancestor = m_tileIndex.find(computeTileKey(level, UREF, RREF));
+        if (ancestor != m_tileIndex.end()) {
+            return ancestor->second;
+        }
+    }
+
+    return m_tileIndex.at(computeTileKey(m_rootLevel, m_rootUREF, m_rootRREF));
+}
+
+CDBTile *CDBTileset::addTile(CDBTile tile)
+{
+    uint64_t key = computeTileKey(tile.getLevel(), tile.getUREF(), tile.getRREF());
+    CDBTile *added = &m_tiles.emplace_back(std::move(tile));
+    m_tileIndex.emplace(key, added);
+    return added;
 }
 
 glm::ivec2 getQuadtreeRelativeChild(const CDBTile &tile, const CDBTile &root)
@@ -84,18 +173,15 @@ glm::ivec2 getQuadtreeRelativeChild(const CDBTile &tile, const CDBTile &root)
     return {RREF, UREF};
 }
 
-const CDBTile *CDBTileset::getFitTile(const CDBTile *root, Core::Cartographic cartographic) const
+const CDBTile *getFitChild(const CDBTile &tile, Core::Cartographic cartographic)
 {
-    for (auto child : root->getChildren()) {
-        if (child) {
-            const auto &childRectangle = child->getBoundRegion().getRectangle();
-            if (childRectangle.contains(cartographic)) {
-                return getFitTile(child, cartographic);
-            }
+    for (auto child : tile.getChildren()) {
+        if (child && child->getBoundRegion().getRectangle().contains(cartographic)) {
+            return child;
         }
     }
 
-    return root;
+    return nullptr;
 }
 
 CDBTile *CDBTileset::insertTileRecursively(const CDBTile &insert, CDBTile *subTree)
@@ -119,15 +205,13 @@ CDBTile *CDBTileset::insertTileRecursively(const CDBTile &insert, CDBTile *subTr
             int childLevel = subTree->getLevel() + 1;
             auto &children = subTree->getChildren();
             const CDBGeoCell &geoCell = insert.getGeoCell();
-            auto child = std::make_unique<CDBTile>(geoCell,
-                                                   insert.getDataset(),
-                                                   insert.getCS_1(),
-                                                   insert.getCS_2(),
-                                                   childLevel,
-                                                   childUREF,
-                                                   childRREF);
-            children.emplace_back(child.get());
-            m_tiles.emplace_back(std::move(child));
+            children.emplace_back(addTile(CDBTile(geoCell,
+                                                  insert.getDataset(),
+                                                  insert.getCS_1(),
+                                                  insert.getCS_2(),
+                                                  childLevel,
+                                                  childUREF,
+                                                  childRREF)));
         }
 
         return insertTileRecursively(insert, subTree->getChildren().back());
@@ -147,16 +231,13 @@ CDBTile *CDBTileset::insertTileRecursively(const CDBTile &insert, CDBTile *subTr
         int childUREF = relativeChild.y + 2 * subTree->getUREF();
         int childLevel = subTree->getLevel() + 1;
         const CDBGeoCell &geoCell = insert.getGeoCell();
-        auto child = std::make_unique<CDBTile>(geoCell,
-                                               insert.getDataset(),
-                                               insert.getCS_1(),
-                                               insert.getCS_2(),
-                                               childLevel,
-                                               childUREF,
-                                               childRREF);
-
-        children[childIdx] = child.get();
-        m_tiles.emplace_back(std::move(child));
+        children[childIdx] = addTile(CDBTile(geoCell,
+                                             insert.getDataset(),
+                                             insert.getCS_1(),
+                                             insert.getCS_2(),
+                                             childLevel,
+                                             childUREF,
+                                             childRREF));
     }
 
     return insertTileRecursively(insert, children[childIdx]);
@@ -2,12 +2,20 @@
 
 #include "CDBTile.h"
 #include "Cartographic.h"
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace CDBTo3DTiles {
 class CDBTile;
 
+// interleaves the bits of x and y, with x at the even bits
+uint64_t computeMortonCode(uint32_t x, uint32_t y) noexcept;
+
+// tiles are stored by block and are never moved, their children point to each other. Every tile is also
+// indexed by its level and the Morton code of its RREF and UREF
 class CDBTileset
 {
 public:
@@ -15,21 +23,38 @@ public:
 
     CDBTileset(int rootLevel, int rootUREF, int rootRREF);
 
+    CDBTileset(const CDBTileset &) = delete;
+
+    CDBTileset(CDBTileset &&) = default;
+
+    CDBTileset &operator=(const CDBTileset &) = delete;
+
+    CDBTileset &operator=(CDBTileset &&) = default;
+
     const CDBTile *getRoot() const;
 
+    inline int getRootLevel() const noexcept { return m_rootLevel; }
+
+    const CDBTile *getTile(int level, int UREF, int RREF) const;
+
     CDBTile *insertTile(const CDBTile &tile);
 
     const CDBTile *getFitTile(Core::Cartographic cartographic) const;
 
 private:
-    const CDBTile *getFitTile(const CDBTile *root, Core::Cartographic cartographic) const;
+    static uint64_t computeTileKey(int level, int UREF, int RREF) noexcept;
+
+    CDBTile *findDeepestAncestor(const CDBTile &tile) const;
 
     CDBTile *insertTileRecursively(const CDBTile &insert, CDBTile *subTree);
 
+    CDBTile *addTile(CDBTile tile);
+
     int m_rootLevel;
     int m_rootUREF;
     int m_rootRREF;
-    std::vector<std::unique_ptr<CDBTile>> m_tiles;
+    std::deque<CDBTile> m_tiles;
+    std::unordered_map<uint64_t, CDBTile *> m_tileIndex;
 };
 
 } // namespace CDBTo3DTiles
@@ -1,90 +1,305 @@
 #include "CDBTo3DTiles.h"
 #include "CDB.h"
+#include "ContentStore.h"
+#include "ConversionProgress.h"
+#include "ConversionStats.h"
+#include "GDALDatasetPool.h"
 #include "Gltf.h"
 #include "MathHelpers.h"
+#include "MemoryBudget.h"
+#include "ObjectStorageOutputSink.h"
+#include "OutputSink.h"
+#include "TextureAtlas.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
 #include "TileFormatIO.h"
 #include "cpl_conv.h"
+#include "cpl_vsi.h"
 #include "gdal.h"
-#include "osgDB/WriteFile"
+#include "glm/gtc/matrix_transform.hpp"
+#include "nlohmann/json.hpp"
+#include "osgDB/Registry"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace CDBTo3DTiles {
+// the CDB datasets read by the conversions of a GeoCell, in the order their tilesets are combined
+static const CDBDataset CONVERTED_DATASETS[] = {CDBDataset::Elevation,
+                                                CDBDataset::RoadNetwork,
+                                                CDBDataset::RailRoadNetwork,
+                                                CDBDataset::PowerlineNetwork,
+                                                CDBDataset::HydrographyNetwork,
+                                                CDBDataset::GTFeature,
+                                                CDBDataset::GSFeature};
+
+static std::string getGeoCellName(const CDBGeoCell &geoCell);
+
+static uint64_t hashGeoCellName(const std::string &name);
+
+static void setDefaultConfigOption(const char *key, const char *value);
+
 struct Converter::TilesetCollection
 {
+    // the vector tiles of a level merged and simplified for their parent, written when CDB doesn't have the
+    // parent
+    struct VectorLOD
+    {
+        bool hasContent = false;
+        Mesh mesh;
+        CDBInstancesAttributes instancesAttribs;
+    };
+
     std::unordered_map<size_t, std::filesystem::path> CSToPaths;
     std::unordered_map<size_t, CDBTileset> CSToTilesets;
+    std::unordered_map<size_t, std::unordered_map<CDBTile, VectorLOD>> CSToVectorLODs;
 };
 
 struct Converter::Impl
 {
+    // state that only lives while a GeoCell is converted, so that GeoCells can be converted in parallel.
+    // Each dataset only touches its own members, except the model textures shared by GTModels and GSModels
+    struct GeoCellContext
+    {
+        std::mutex processedModelTexturesMutex;
+        std::unordered_set<std::string> processedModelTextures;
+        std::unordered_map<std::string, std::filesystem::path> storedModelTextures;
+        std::mutex imageryTexturesMutex;
+        std::unordered_map<CDBTileKey, std::shared_future<std::optional<Texture>>> imageryTextures;
+        size_t encodingImageryBytes = 0;
+        std::mutex elevationTilesetsMutex;
+        CDBElevationEdgeCache elevationEdges;
+        std::unordered_map<std::string, std::filesystem::path> GTModelsToGltf;
+        std::unordered_map<CDBGeoCell, TilesetCollection> elevationTilesets;
+        std::unordered_map<CDBGeoCell, TilesetCollection> roadNetworkTilesets;
+        std::unordered_map<CDBGeoCell, TilesetCollection> railRoadNetworkTilesets;
+        std::unordered_map<CDBGeoCell, TilesetCollection> powerlineNetworkTilesets;
+        std::unordered_map<CDBGeoCell, TilesetCollection> hydrographyNetworkTilesets;
+        std::unordered_map<CDBGeoCell, TilesetCollection> GTModelTilesets;
+        std::unordered_map<CDBGeoCell, TilesetCollection> GSModelTilesets;
+    };
+
+    // the tilesets written for a GeoCell, combined once every GeoCell is converted. The index is the position
+    // of the GeoCell in the CDB traversal, so the tilesets of shards are combined in the same order
+    struct GeoCellTilesets
+    {
+        std::string name;
+        size_t index;
+        Core::BoundingRegion region;
+        std::vector<std::filesystem::path> tilesetJsonPaths;
+    };
+
+    // GTModel instances copied into the geometry of their tile instead of being instanced
+    struct BakedGTModels
+    {
+        std::vector<size_t> instances;
+        std::vector<Mesh> meshes;
+        std::vector<Material> materials;
+        std::vector<Texture> textures;
+    };
+
     Impl(const std::filesystem::path &cdbInputPath, const std::filesystem::path &output)
         : elevationNormal{false}
         , elevationLOD{false}
         , elevationDecimateError{0.01f}
         , elevationThresholdIndices{0.3f}
+        , vectorLOD{false}
+        , implicitTiling{false}
+        , externalTilesetLevels{0}
+        , threadCount{1}
+        , GTModelCacheMemory{0}
+        , elevationGridCacheMemory{0}
+        , imageryEncodingMemory{0}
+        , GDALCacheMemory{0}
+        , GDALThreadCount{0}
+        , GDALDatasetPoolSize{0}
+        , readAheadDepth{0}
+        , maxMemory{0}
+        , outputThreadCount{0}
+        , outputQueueMemory{0}
+        , archiveOutput{false}
+        , deduplicateContent{false}
+        , minLevel{-10}
+        , maxLevel{23}
+        , shardIndex{0}
+        , shardCount{0}
+        , textureAtlasSize{0}
+        , incremental{false}
+        , optimizeMeshes{false}
+        , textureCompression{TextureCompression::None}
+        , collectStats{false}
+        , progressInterval{1.0}
         , cdbPath{cdbInputPath}
         , outputPath{output}
-    {
-        if (std::filesystem::exists(output)) {
-            std::filesystem::remove_all(output);
-        }
-    }
+    {}
+
+    bool isDatasetConverted(CDBDataset dataset) const;
+
+    bool isGeoCellSelected(const CDBGeoCell &geoCell) const;
+
+    void selectTiles(CDB &cdb) const;
+
+    bool isSharded() const noexcept;
+
+    bool isInShard(const CDBGeoCell &geoCell) const;
+
+    std::string getShardName() const;
+
+    std::filesystem::path getLedgerPath() const;
+
+    void writeShardManifest(const std::vector<GeoCellTilesets> &geoCells) const;
+
+    std::vector<std::string> combineTilesets(const std::vector<GeoCellTilesets> &geoCells) const;
+
+    nlohmann::json readLedger() const;
+
+    void writeLedger(const nlohmann::json &ledger) const;
+
+    nlohmann::json getConversionOptions(const CDB &cdb) const;
+
+    size_t getCacheMemory(size_t cacheMemory, size_t maxMemoryDivisor) const;
+
+    void keepMemoryBudget(CDB &cdb);
+
+    std::unique_ptr<OutputSink> createOutputSink() const;
+
+    std::filesystem::path getGeoCellArchivePath(const std::string &geoCellRelativePath) const;
+
+    std::vector<std::filesystem::path> convertGeoCell(const CDBGeoCell &geoCell, ThreadPool &threadPool);
 
     void flushTilesetCollection(const CDBGeoCell &geoCell,
                                 std::unordered_map<CDBGeoCell, TilesetCollection> &tilesetCollections,
+                                std::vector<std::filesystem::path> &datasetToCombine,
                                 bool replace = true);
 
-    void addElevationToTilesetCollection(CDBElevation &elevation,
+    void addElevationToTilesetCollection(GeoCellContext &context,
+                                         CDBElevation &elevation,
                                          const CDB &cdb,
-                                         const std::filesystem::path &outputDirectory);
+                                         const std::filesystem::path &outputDirectory,
+                                         TaskGroup &elevationTasks);
 
-    void addElevationToTileset(CDBElevation &elevation,
-                               const Texture *imagery,
+    void addElevationToTileset(GeoCellContext &context,
+                               CDBElevation &elevation,
+                               const std::optional<Texture> &imagery,
                                const CDB &cdb,
                                const std::filesystem::path &outputDirectory,
-                               CDBTileset &tileset);
+                               CDBTileset &tileset,
+                               TaskGroup &elevationTasks);
 
-    void fillMissingPositiveLODElevation(const CDBElevation &elevation,
-                                         const Texture *currentImagery,
+    void fillMissingPositiveLODElevation(GeoCellContext &context,
+                                         const CDBElevation &elevation,
+                                         const std::optional<Texture> &currentImagery,
                                          const CDB &cdb,
                                          const std::filesystem::path &outputDirectory,
-                                         CDBTileset &tileset);
+                                         CDBTileset &tileset,
+                                         TaskGroup &elevationTasks);
 
-    void fillMissingNegativeLODElevation(CDBElevation &elevation,
+    void fillMissingNegativeLODElevation(GeoCellContext &context,
+                                         CDBElevation &elevation,
                                          const CDB &cdb,
                                          const std::filesystem::path &outputDirectory,
-                                         CDBTileset &tileset);
+                                         CDBTileset &tileset,
+                                         TaskGroup &elevationTasks);
 
-    void addSubRegionElevationToTileset(CDBElevation &subRegion,
+    void addSubRegionElevationToTileset(GeoCellContext &context,
+                                        CDBElevation &subRegion,
                                         const CDB &cdb,
-                                        std::optional<CDBImagery> &subRegionImagery,
-                                        const Texture *parentTexture,
+                                        const std::optional<Texture> &parentTexture,
                                         const std::filesystem::path &outputDirectory,
-                                        CDBTileset &tileset);
+                                        CDBTileset &tileset,
+                                        TaskGroup &elevationTasks);
+
+    std::optional<Texture> getImageryTexture(GeoCellContext &context,
+                                             const CDBTile &tile,
+                                             const CDB &cdb,
+                                             const std::filesystem::path &tilesetDirectory,
+                                             TaskGroup &imageryTasks);
 
-    void generateElevationNormal(Mesh &simplifed);
+    Texture createImageryTexture(const CDBTile &tile, const std::filesystem::path &tilesetDirectory) const;
 
-    Texture createImageryTexture(CDBImagery &imagery, const std::filesystem::path &tilesetDirectory) const;
+    void encodeImageryTexture(GeoCellContext &context,
+                              std::shared_ptr<CDBImagery> imagery,
+                              const std::filesystem::path &textureAbsolutePath,
+                              TaskGroup &imageryTasks);
+
+    void writeImageryTexture(CDBImagery &imagery, const std::filesystem::path &textureAbsolutePath) const;
+
+    void writeKTX2Texture(const std::vector<unsigned char> &RGBAPixels,
+                          unsigned width,
+                          unsigned height,
+                          const std::filesystem::path &path) const;
+
+    void writeImageTexture(const osg::Image &image, const std::filesystem::path &path) const;
+
+    std::vector<unsigned char> encodeImageTexture(const osg::Image &image,
+                                                  const std::string &extension) const;
+
+    std::filesystem::path storeModelTexture(GeoCellContext &context,
+                                            const osg::Image &image,
+                                            bool isKTX2,
+                                            const std::filesystem::path &textureAbsolutePath);
 
     void addVectorToTilesetCollection(const CDBGeometryVectors &vectors,
                                       const std::filesystem::path &collectionOutputDirectory,
                                       std::unordered_map<CDBGeoCell, TilesetCollection> &tilesetCollections);
 
-    std::vector<Texture> writeModeTextures(const std::vector<Texture> &modelTextures,
+    void addVectorToTileset(const CDBTile &cdbTile,
+                            const Mesh &mesh,
+                            const CDBInstancesAttributes &instancesAttribs,
+                            const std::filesystem::path &tilesetDirectory,
+                            CDBTileset &tileset);
+
+    void addVectorToParentLOD(const CDBTile &cdbTile,
+                              const Mesh &mesh,
+                              const CDBInstancesAttributes &instancesAttribs,
+                              const CDBTileset &tileset,
+                              std::unordered_map<CDBTile, TilesetCollection::VectorLOD> &vectorLODs);
+
+    void addVectorLODsToTilesetCollection(
+        const CDBGeoCell &geoCell, std::unordered_map<CDBGeoCell, TilesetCollection> &tilesetCollections);
+
+    std::vector<Texture> writeModeTextures(GeoCellContext &context,
+                                           const std::vector<Texture> &modelTextures,
                                            const std::vector<osg::ref_ptr<osg::Image>> &images,
                                            const std::filesystem::path &textureSubDir,
                                            const std::filesystem::path &gltfPath);
 
-    void addGTModelToTilesetCollection(const CDBGTModels &model, const std::filesystem::path &outputDirectory);
+    const std::vector<Mesh> &getMeshesForGltf(const std::vector<Mesh> &meshes,
+                                              std::vector<Mesh> &optimizedMeshes) const;
 
-    void addGSModelToTilesetCollection(const CDBGSModels &model, const std::filesystem::path &outputDirectory);
+    void addGTModelToTilesetCollection(GeoCellContext &context,
+                                       const CDBGTModels &model,
+                                       const std::filesystem::path &outputDirectory);
+
+    void bakeGTModelInstances(GeoCellContext &context,
+                              const CDBModel3DResult &model3D,
+                              const CDBModelsAttributes &modelsAttribs,
+                              const std::vector<int> &instanceIndices,
+                              const std::filesystem::path &textureSubDir,
+                              const std::filesystem::path &tilesetDirectory,
+                              BakedGTModels &baked);
+
+    void addGSModelToTilesetCollection(GeoCellContext &context,
+                                       CDBGSModels &model,
+                                       const std::filesystem::path &outputDirectory);
 
     void createB3DMForTileset(tinygltf::Model &model,
+                              const std::vector<GltfBufferSegment> &bufferSegments,
                               CDBTile cdbTile,
                               const CDBInstancesAttributes *instancesAttribs,
                               const std::filesystem::path &outputDirectory,
-                              CDBTileset &tilesetCollections);
+                              CDBTileset &tilesetCollections,
+                              std::mutex *tilesetMutex = nullptr);
 
     size_t hashComponentSelectors(int CS_1, int CS_2);
 
@@ -98,6 +313,12 @@ struct Converter::Impl
                     CDBTileset *&tileset,
                     std::filesystem::path &path);
 
+    ConversionTrace *getTrace() const noexcept;
+
+    void addTileWritten(const CDBTile &tile, uint64_t bytes);
+
+    void addBytesWritten(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes);
+
     static const std::string ELEVATIONS_PATH;
     static const std::string ROAD_NETWORK_PATH;
     static const std::string RAILROAD_NETWORK_PATH;
@@ -106,25 +327,63 @@ struct Converter::Impl
     static const std::string GTMODEL_PATH;
     static const std::string GSMODEL_PATH;
     static const std::unordered_set<std::string> DATASET_PATHS;
+    static const std::string LEDGER_FILE;
+    static const uint32_t LEDGER_VERSION;
+    static const std::string SHARDS_PATH;
+    static const std::string CONTENT_STORE_PATH;
+    static const uint32_t SHARD_MANIFEST_VERSION;
+    static const std::string ARCHIVE_EXTENSION;
 
     bool elevationNormal;
     bool elevationLOD;
     float elevationDecimateError;
     float elevationThresholdIndices;
+    bool vectorLOD;
+    bool implicitTiling;
+    unsigned externalTilesetLevels;
+    size_t threadCount;
+    size_t GTModelCacheMemory;
+    size_t elevationGridCacheMemory;
+    size_t imageryEncodingMemory;
+    size_t GDALCacheMemory;
+    size_t GDALThreadCount;
+    size_t GDALDatasetPoolSize;
+    size_t readAheadDepth;
+    size_t maxMemory;
+    size_t outputThreadCount;
+    size_t outputQueueMemory;
+    bool archiveOutput;
+    bool deduplicateContent;
+    std::unique_ptr<OutputSink> outputSink;
+    std::unique_ptr<ContentStore> contentStore;
+    std::unique_ptr<MemoryBudget> memoryBudget;
+    std::optional<Core::GlobeRectangle> areaOfInterest;
+    std::vector<std::string> selectedGeoCells;
+    std::unordered_set<std::string> selectedDatasets;
+    int minLevel;
+    int maxLevel;
+    std::vector<std::string> shardGeoCells;
+    size_t shardIndex;
+    size_t shardCount;
+    unsigned textureAtlasSize;
+    CDBGTModelBaking GTModelBaking;
+    bool incremental;
+    bool optimizeMeshes;
+    GltfEncoding gltfEncoding;
+    TextureCompression textureCompression;
+    std::filesystem::path manifestPath;
+    std::shared_ptr<CDBManifest> manifest;
+    std::shared_ptr<CDBGTModelCache> GTModelCache;
+    std::shared_ptr<GDALDatasetPool> datasetPool;
+    bool collectStats;
+    std::filesystem::path tracePath;
+    std::shared_ptr<ConversionStats> stats;
+    std::function<void(const ConversionProgress &)> progressCallback;
+    double progressInterval;
+    std::shared_ptr<ConversionProgressTracker> progress;
     std::filesystem::path cdbPath;
     std::filesystem::path outputPath;
-    std::vector<std::filesystem::path> defaultDatasetToCombine;
     std::vector<std::vector<std::string>> requestedDatasetToCombine;
-    std::unordered_set<std::string> processedModelTextures;
-    std::unordered_map<CDBTile, Texture> processedParentImagery;
-    std::unordered_map<std::string, std::filesystem::path> GTModelsToGltf;
-    std::unordered_map<CDBGeoCell, TilesetCollection> elevationTilesets;
-    std::unordered_map<CDBGeoCell, TilesetCollection> roadNetworkTilesets;
-    std::unordered_map<CDBGeoCell, TilesetCollection> railRoadNetworkTilesets;
-    std::unordered_map<CDBGeoCell, TilesetCollection> powerlineNetworkTilesets;
-    std::unordered_map<CDBGeoCell, TilesetCollection> hydrographyNetworkTilesets;
-    std::unordered_map<CDBGeoCell, TilesetCollection> GTModelTilesets;
-    std::unordered_map<CDBGeoCell, TilesetCollection> GSModelTilesets;
 };
 
 const std::string Converter::Impl::ELEVATIONS_PATH = "Elevation";
@@ -142,9 +401,322 @@ const std::unordered_set<std::string> Converter::Impl::DATASET_PATHS = {ELEVATIO
                                                                         GTMODEL_PATH,
                                                                         GSMODEL_PATH};
 
+const std::string Converter::Impl::LEDGER_FILE = "ConversionLedger.json";
+const uint32_t Converter::Impl::LEDGER_VERSION = 1;
+const std::string Converter::Impl::SHARDS_PATH = "Shards";
+const std::string Converter::Impl::CONTENT_STORE_PATH = "Content";
+const std::string Converter::Impl::ARCHIVE_EXTENSION = ".3tz";
+const uint32_t Converter::Impl::SHARD_MANIFEST_VERSION = 1;
+
+bool Converter::Impl::isDatasetConverted(CDBDataset dataset) const
+{
+    if (selectedDatasets.empty()) {
+        return true;
+    }
+
+    switch (dataset) {
+    case CDBDataset::Elevation:
+        return selectedDatasets.count(ELEVATIONS_PATH) > 0;
+    case CDBDataset::RoadNetwork:
+        return selectedDatasets.count(ROAD_NETWORK_PATH) > 0;
+    case CDBDataset::RailRoadNetwork:
+        return selectedDatasets.count(RAILROAD_NETWORK_PATH) > 0;
+    case CDBDataset::PowerlineNetwork:
+        return selectedDatasets.count(POWERLINE_NETWORK_PATH) > 0;
+    case CDBDataset::HydrographyNetwork:
+        return selectedDatasets.count(HYDROGRAPHY_NETWORK_PATH) > 0;
+    case CDBDataset::GTFeature:
+        return selectedDatasets.count(GTMODEL_PATH) > 0;
+    case CDBDataset::GSFeature:
+        return selectedDatasets.count(GSMODEL_PATH) > 0;
+    default:
+        return false;
+    }
+}
+
+bool Converter::Impl::isGeoCellSelected(const CDBGeoCell &geoCell) const
+{
+    return selectedGeoCells.empty()
+           || std::find(selectedGeoCells.begin(), selectedGeoCells.end(), getGeoCellName(geoCell))
+                  != selectedGeoCells.end();
+}
+
+void Converter::Impl::selectTiles(CDB &cdb) const
+{
+    if (areaOfInterest) {
+        cdb.setAreaOfInterest(*areaOfInterest);
+    }
+
+    cdb.setLevelRange(minLevel, maxLevel);
+}
+
+bool Converter::Impl::isSharded() const noexcept
+{
+    return !shardGeoCells.empty() || shardCount > 0;
+}
+
+bool Converter::Impl::isInShard(const CDBGeoCell &geoCell) const
+{
+    std::string name = getGeoCellName(geoCell);
+    if (!shardGeoCells.empty()
+        && std::find(shardGeoCells.begin(), shardGeoCells.end(), name) == shardGeoCells.end()) {
+        return false;
+    }
+
+    return shardCount == 0 || hashGeoCellName(name) % shardCount == shardIndex;
+}
+
+std::string Converter::Impl::getShardName() const
+{
+    // shards of a GeoCell list are told apart by the list, so several lists can share the output directory
+    std::string name;
+    if (!shardGeoCells.empty()) {
+        std::vector<std::string> sortedGeoCells = shardGeoCells;
+        std::sort(sortedGeoCells.begin(), sortedGeoCells.end());
+        uint64_t listHash = 0xcbf29ce484222325ull;
+        for (const auto &geoCell : sortedGeoCells) {
+            listHash = (listHash * 0x100000001b3ull) ^ hashGeoCellName(geoCell);
+        }
+
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(listHash));
+        name = "GeoCells_" + std::string(hex);
+    }
+
+    if (shardCount > 0) {
+        name += name.empty() ? "" : "_";
+        name += "Shard_" + std::to_string(shardIndex) + "_of_" + std::to_string(shardCount);
+    }
+
+    return name;
+}
+
+std::filesystem::path Converter::Impl::getLedgerPath() const
+{
+    // each shard keeps its own ledger, since the shards may be converted at the same time
+    if (isSharded()) {
+        return outputPath / SHARDS_PATH / (getShardName() + "_" + LEDGER_FILE);
+    }
+
+    return outputPath / LEDGER_FILE;
+}
+
+void Converter::Impl::writeShardManifest(const std::vector<GeoCellTilesets> &geoCells) const
+{
+    nlohmann::json convertedGeoCells = nlohmann::json::array();
+    for (const auto &geoCell : geoCells) {
+        const auto &rectangle = geoCell.region.getRectangle();
+        nlohmann::json tilesets = nlohmann::json::array();
+        for (const auto &tilesetJsonPath : geoCell.tilesetJsonPaths) {
+            tilesets.emplace_back(tilesetJsonPath.generic_string());
+        }
+
+        nlohmann::json convertedGeoCell;
+        convertedGeoCell["name"] = geoCell.name;
+        convertedGeoCell["index"] = geoCell.index;
+        convertedGeoCell["region"] = {rectangle.getWest(),
+                                      rectangle.getSouth(),
+                                      rectangle.getEast(),
+                                      rectangle.getNorth(),
+                                      geoCell.region.getMinimumHeight(),
+                                      geoCell.region.getMaximumHeight()};
+        convertedGeoCell["tilesets"] = tilesets;
+        convertedGeoCells.emplace_back(convertedGeoCell);
+    }
+
+    nlohmann::json shardManifest;
+    shardManifest["version"] = SHARD_MANIFEST_VERSION;
+    if (shardCount > 0) {
+        shardManifest["shard"] = {{"index", shardIndex}, {"count", shardCount}};
+    }
+
+    shardManifest["geoCells"] = convertedGeoCells;
+    std::filesystem::create_directories(outputPath / SHARDS_PATH);
+    std::ofstream fs(outputPath / SHARDS_PATH / (getShardName() + ".json"));
+    fs << shardManifest;
+}
+
+std::vector<std::string> Converter::Impl::combineTilesets(const std::vector<GeoCellTilesets> &geoCells) const
+{
+    // get the converted dataset in each geocell to be combine at the end. Merge them in traversal order
+    // so that the output doesn't depend on which worker finishes first
+    std::map<std::string, std::vector<std::filesystem::path>> combinedTilesets;
+    std::map<std::string, std::vector<Core::BoundingRegion>> combinedTilesetsRegions;
+    std::map<std::string, Core::BoundingRegion> aggregateTilesetsRegion;
+    for (const auto &geoCell : geoCells) {
+        const Core::BoundingRegion &geoCellRegion = geoCell.region;
+        for (const auto &tilesetJsonPath : geoCell.tilesetJsonPaths) {
+            auto componentSelectors = tilesetJsonPath.parent_path().filename().string();
+            auto dataset = tilesetJsonPath.parent_path().parent_path().filename().string();
+            auto combinedTilesetName = dataset + "_" + componentSelectors;
+
+            combinedTilesets[combinedTilesetName].emplace_back(tilesetJsonPath);
+            combinedTilesetsRegions[combinedTilesetName].emplace_back(geoCellRegion);
+            auto tilesetAggregateRegion = aggregateTilesetsRegion.find(combinedTilesetName);
+            if (tilesetAggregateRegion == aggregateTilesetsRegion.end()) {
+                aggregateTilesetsRegion.insert({combinedTilesetName, geoCellRegion});
+            } else {
+                tilesetAggregateRegion->second = tilesetAggregateRegion->second.computeUnion(geoCellRegion);
+            }
+        }
+    }
+
+    // combine all the default tileset in each geocell into a global one
+    std::vector<std::string> combinedTilesetNames;
+    for (auto tileset : combinedTilesets) {
+        combinedTilesetNames.emplace_back(tileset.first + ".json");
+        OutputBuffer combinedTileset;
+        combineTilesetJson(tileset.second, combinedTilesetsRegions[tileset.first], combinedTileset);
+        outputSink->write(outputPath / combinedTilesetNames.back(), combinedTileset.release());
+    }
+
+    // combine the requested tilesets
+    for (const auto &tilesets : requestedDatasetToCombine) {
+        std::string combinedTilesetName;
+        if (requestedDatasetToCombine.size() > 1) {
+            for (const auto &tileset : tilesets) {
+                combinedTilesetName += tileset;
+            }
+            combinedTilesetName += ".json";
+        } else {
+            combinedTilesetName = "tileset.json";
+        }
+
+        std::vector<std::filesystem::path> existTilesets;
+        std::vector<Core::BoundingRegion> regions;
+        regions.reserve(tilesets.size());
+        for (const auto &tileset : tilesets) {
+            auto tilesetRegion = aggregateTilesetsRegion.find(tileset);
+            if (tilesetRegion != aggregateTilesetsRegion.end()) {
+                existTilesets.emplace_back(tilesetRegion->first + ".json");
+                regions.emplace_back(tilesetRegion->second);
+            }
+        }
+
+        combinedTilesetNames.emplace_back(combinedTilesetName);
+        OutputBuffer combinedTileset;
+        combineTilesetJson(existTilesets, regions, combinedTileset);
+        outputSink->write(outputPath / combinedTilesetName, combinedTileset.release());
+    }
+
+    return combinedTilesetNames;
+}
+
+nlohmann::json Converter::Impl::readLedger() const
+{
+    std::ifstream fs(getLedgerPath());
+    if (!fs) {
+        return nlohmann::json::object();
+    }
+
+    // a damaged ledger only means that everything is converted again
+    nlohmann::json ledger = nlohmann::json::parse(fs, nullptr, false);
+    if (ledger.is_discarded() || !ledger.is_object()) {
+        return nlohmann::json::object();
+    }
+
+    auto version = ledger.find("version");
+    if (version == ledger.end() || *version != LEDGER_VERSION) {
+        return nlohmann::json::object();
+    }
+
+    return ledger;
+}
+
+void Converter::Impl::writeLedger(const nlohmann::json &ledger) const
+{
+    std::filesystem::create_directories(getLedgerPath().parent_path());
+    std::ofstream fs(getLedgerPath());
+    fs << ledger;
+}
+
+nlohmann::json Converter::Impl::getConversionOptions(const CDB &cdb) const
+{
+    // every GeoCell is converted again when one of these changes. GTModels are shared by all GeoCells
+    nlohmann::json options;
+    options["elevationNormal"] = elevationNormal;
+    options["elevationLOD"] = elevationLOD;
+    options["elevationDecimateError"] = elevationDecimateError;
+    options["elevationThresholdIndices"] = elevationThresholdIndices;
+    options["vectorLOD"] = vectorLOD;
+    options["implicitTiling"] = implicitTiling;
+    options["externalTilesetLevels"] = externalTilesetLevels;
+    options["archiveOutput"] = archiveOutput;
+    options["deduplicateContent"] = deduplicateContent;
+    options["optimizeMeshes"] = optimizeMeshes;
+    options["quantizeVertexAttributes"] = gltfEncoding.quantizeAttributes;
+    options["meshoptCompression"] = gltfEncoding.meshoptCompression;
+    options["dracoCompression"] = gltfEncoding.dracoCompression;
+    options["textureCompression"] = textureCompressionToString(textureCompression);
+    options["textureAtlasSize"] = textureAtlasSize;
+    options["GTModelBaking"] = {GTModelBaking.maxInstances, GTModelBaking.maxTriangles};
+    options["dracoQuantizationBits"] = {
+        gltfEncoding.dracoPositionBits, gltfEncoding.dracoNormalBits, gltfEncoding.dracoUVBits};
+    options["GTModel"] = cdb.getGTModelFingerprint();
+    options["datasets"] = std::set<std::string>(selectedDatasets.begin(), selectedDatasets.end());
+    options["levelRange"] = {minLevel, maxLevel};
+    if (areaOfInterest) {
+        options["areaOfInterest"] = {areaOfInterest->getWest(),
+                                     areaOfInterest->getSouth(),
+                                     areaOfInterest->getEast(),
+                                     areaOfInterest->getNorth()};
+    }
+
+    return options;
+}
+
+void Converter::Impl::keepMemoryBudget(CDB &cdb)
+{
+    // a single GeoCell can outgrow the budget, so it frees what it can rebuild before its next tile. The
+    // queued files are already bounded by the output sink, which is never flushed from a dataset task
+    if (memoryBudget && memoryBudget->shouldShrinkCaches()) {
+        cdb.shrinkCaches();
+    }
+}
+
+size_t Converter::Impl::getCacheMemory(size_t cacheMemory, size_t maxMemoryDivisor) const
+{
+    // under a memory budget, each cache gets a share of it unless its own budget is already smaller
+    if (maxMemory == 0) {
+        return cacheMemory;
+    }
+
+    size_t share = std::max<size_t>(maxMemory / maxMemoryDivisor, 1);
+    return cacheMemory == 0 ? share : std::min(cacheMemory, share);
+}
+
+std::unique_ptr<OutputSink> Converter::Impl::createOutputSink() const
+{
+    // the uploads wait on the network rather than on the disk, so there are as many as conversion threads
+    if (isVirtualFileSystemPath(outputPath)) {
+        size_t uploaderThreadCount = outputThreadCount > 0 ? outputThreadCount : threadCount;
+        return std::make_unique<ObjectStorageOutputSink>(uploaderThreadCount,
+                                                         getCacheMemory(outputQueueMemory, 8));
+    }
+
+    // the entries of an archive are appended one after the other, so there is nothing to batch
+    if (archiveOutput) {
+        return std::make_unique<ArchiveOutputSink>();
+    }
+
+    if (outputThreadCount == 0) {
+        return std::make_unique<DirectoryOutputSink>();
+    }
+
+    // the queued files are held in memory like the caches, so the queue gets a share of the budget too
+    return std::make_unique<BatchedDirectoryOutputSink>(outputThreadCount,
+                                                        getCacheMemory(outputQueueMemory, 8));
+}
+
+std::filesystem::path Converter::Impl::getGeoCellArchivePath(const std::string &geoCellRelativePath) const
+{
+    return outputPath / (geoCellRelativePath + ARCHIVE_EXTENSION);
+}
+
 void Converter::Impl::flushTilesetCollection(
     const CDBGeoCell &geoCell,
     std::unordered_map<CDBGeoCell, TilesetCollection> &tilesetCollections,
+    std::vector<std::filesystem::path> &datasetToCombine,
     bool replace)
 {
     auto geoCellCollectionIt = tilesetCollections.find(geoCell);
@@ -163,54 +735,57 @@ void Converter::Impl::flushTilesetCollection(
                                    / (CDBTile::retrieveGeoCellDatasetFromTileName(*root) + ".json");
 
             // write to tileset.json file
-            std::ofstream fs(tilesetJsonPath);
-            writeToTilesetJson(tileset, replace, fs);
+            ScopedPhaseTimer tilesetTimer(stats.get(), *root, ConversionPhase::TilesetWrite);
+            OutputBuffer tilesetJson;
+            if (implicitTiling) {
+                // the tiles are renamed after their implicit coordinates, so they are written first
+                outputSink->flush();
+                writeToImplicitTilesetJson(tileset, replace, tilesetDirectory, tilesetJson);
+            } else {
+                writeToTilesetJson(tileset, replace, externalTilesetLevels, tilesetDirectory, tilesetJson);
+            }
+
+            tilesetTimer.stop();
+            addBytesWritten(geoCell, root->getDataset(), tilesetJson.getByteLength());
+            outputSink->write(tilesetJsonPath, tilesetJson.release());
 
             // add tileset json path to be combined later for multiple geocell
             // remove the output root path to become relative path
             tilesetJsonPath = std::filesystem::relative(tilesetJsonPath, outputPath);
-            defaultDatasetToCombine.emplace_back(tilesetJsonPath);
+            datasetToCombine.emplace_back(tilesetJsonPath);
         }
 
         tilesetCollections.erase(geoCell);
     }
 }
 
-void Converter::Impl::addElevationToTilesetCollection(CDBElevation &elevation,
+void Converter::Impl::addElevationToTilesetCollection(GeoCellContext &context,
+                                                      CDBElevation &elevation,
                                                       const CDB &cdb,
-                                                      const std::filesystem::path &collectionOutputDirectory)
+                                                      const std::filesystem::path &collectionOutputDirectory,
+                                                      TaskGroup &elevationTasks)
 {
     const auto &cdbTile = elevation.getTile();
-    auto currentImagery = cdb.getImagery(cdbTile);
+    ScopedTraceEvent jobEvent(getTrace(), "elevationTile", cdbTile);
 
     std::filesystem::path tilesetDirectory;
     CDBTileset *tileset;
-    getTileset(cdbTile, collectionOutputDirectory, elevationTilesets, tileset, tilesetDirectory);
+    {
+        std::lock_guard<std::mutex> lock(context.elevationTilesetsMutex);
+        getTileset(cdbTile, collectionOutputDirectory, context.elevationTilesets, tileset, tilesetDirectory);
+    }
 
+    auto currentImagery = getImageryTexture(context, cdbTile, cdb, tilesetDirectory, elevationTasks);
     if (currentImagery) {
-        Texture imageryTexture = createImageryTexture(*currentImagery, tilesetDirectory);
-        addElevationToTileset(elevation, &imageryTexture, cdb, tilesetDirectory, *tileset);
+        addElevationToTileset(
+            context, elevation, currentImagery, cdb, tilesetDirectory, *tileset, elevationTasks);
     } else {
         // find parent imagery if the current one doesn't exist
-        Texture *parentTexture = nullptr;
+        std::optional<Texture> parentTexture;
         auto current = CDBTile::createParentTile(cdbTile);
         while (current) {
-            // if not in the cache, then write the image and save its name in the cache
-            auto it = processedParentImagery.find(*current);
-            if (it == processedParentImagery.end()) {
-                auto parentImagery = cdb.getImagery(*current);
-                if (parentImagery) {
-                    auto newTexture = createImageryTexture(*parentImagery, tilesetDirectory);
-                    auto cacheImageryTexture = processedParentImagery.insert(
-                        {*current, std::move(newTexture)});
-
-                    parentTexture = &(cacheImageryTexture.first->second);
-
-                    break;
-                }
-            } else {
-                // found it, we don't need to read the image again. Just use saved name of the saved image
-                parentTexture = &it->second;
+            parentTexture = getImageryTexture(context, *current, cdb, tilesetDirectory, elevationTasks);
+            if (parentTexture) {
                 break;
             }
 
@@ -223,19 +798,18 @@ void Converter::Impl::addElevationToTilesetCollection(CDBElevation &elevation,
             elevation.indexUVRelativeToParent(*current);
         }
 
-        if (parentTexture) {
-            addElevationToTileset(elevation, parentTexture, cdb, tilesetDirectory, *tileset);
-        } else {
-            addElevationToTileset(elevation, nullptr, cdb, tilesetDirectory, *tileset);
-        }
+        addElevationToTileset(
+            context, elevation, parentTexture, cdb, tilesetDirectory, *tileset, elevationTasks);
     }
 }
 
-void Converter::Impl::addElevationToTileset(CDBElevation &elevation,
-                                            const Texture *imagery,
+void Converter::Impl::addElevationToTileset(GeoCellContext &context,
+                                            CDBElevation &elevation,
+                                            const std::optional<Texture> &imagery,
                                             const CDB &cdb,
                                             const std::filesystem::path &tilesetDirectory,
-                                            CDBTileset &tileset)
+                                            CDBTileset &tileset,
+                                            TaskGroup &elevationTasks)
 {
     const auto &cdbTile = elevation.getTile();
     const auto &mesh = elevation.getUniformGridMesh();
@@ -246,16 +820,30 @@ void Converter::Impl::addElevationToTileset(CDBElevation &elevation,
     size_t targetIndexCount = static_cast<size_t>(static_cast<float>(mesh.indices.size())
                                                   * elevationThresholdIndices);
     float targetError = elevationDecimateError;
-    Mesh simplifed = elevation.createSimplifiedMesh(targetIndexCount, targetError);
+    if (elevationNormal) {
+        // the normals of the whole grid are computed once and gathered by the simplified mesh of each region
+        ScopedPhaseTimer normalTimer(stats.get(), cdbTile, ConversionPhase::NormalGeneration);
+        elevation.computeGridNormals();
+    }
+
+    ScopedPhaseTimer simplificationTimer(stats.get(), cdbTile, ConversionPhase::MeshSimplification);
+    Mesh simplifed = elevation.createSimplifiedMesh(
+        targetIndexCount, targetError, elevationNormal, &context.elevationEdges);
     if (simplifed.positionRTCs.empty()) {
         simplifed = mesh;
+        if (elevationNormal) {
+            simplifed.normals = elevation.createUniformGridNormals();
+        }
     }
 
-    if (elevationNormal) {
-        generateElevationNormal(simplifed);
+    simplificationTimer.stop();
+
+    if (optimizeMeshes) {
+        optimizeMeshForRendering(simplifed);
     }
 
     // create material for mesh if there are imagery
+    std::mutex *tilesetMutex = &context.elevationTilesetsMutex;
     if (imagery) {
         Material material;
         material.doubleSided = true;
@@ -263,25 +851,34 @@ void Converter::Impl::addElevationToTileset(CDBElevation &elevation,
         material.texture = 0;
         simplifed.material = 0;
 
-        tinygltf::Model gltf = createGltf(simplifed, &material, imagery);
-        createB3DMForTileset(gltf, cdbTile, nullptr, tilesetDirectory, tileset);
+        std::vector<GltfBufferSegment> bufferSegments;
+        ScopedPhaseTimer gltfTimer(stats.get(), cdbTile, ConversionPhase::GltfBuild);
+        tinygltf::Model gltf = createGltf(simplifed, &material, &*imagery, &bufferSegments, gltfEncoding);
+        gltfTimer.stop();
+        createB3DMForTileset(gltf, bufferSegments, cdbTile, nullptr, tilesetDirectory, tileset, tilesetMutex);
     } else {
-        tinygltf::Model gltf = createGltf(simplifed, nullptr, nullptr);
-        createB3DMForTileset(gltf, cdbTile, nullptr, tilesetDirectory, tileset);
+        std::vector<GltfBufferSegment> bufferSegments;
+        ScopedPhaseTimer gltfTimer(stats.get(), cdbTile, ConversionPhase::GltfBuild);
+        tinygltf::Model gltf = createGltf(simplifed, nullptr, nullptr, &bufferSegments, gltfEncoding);
+        gltfTimer.stop();
+        createB3DMForTileset(gltf, bufferSegments, cdbTile, nullptr, tilesetDirectory, tileset, tilesetMutex);
     }
 
     if (cdbTile.getLevel() < 0) {
-        fillMissingNegativeLODElevation(elevation, cdb, tilesetDirectory, tileset);
+        fillMissingNegativeLODElevation(context, elevation, cdb, tilesetDirectory, tileset, elevationTasks);
     } else {
-        fillMissingPositiveLODElevation(elevation, imagery, cdb, tilesetDirectory, tileset);
+        fillMissingPositiveLODElevation(
+            context, elevation, imagery, cdb, tilesetDirectory, tileset, elevationTasks);
     }
 }
 
-void Converter::Impl::fillMissingPositiveLODElevation(const CDBElevation &elevation,
-                                                      const Texture *currentImagery,
+void Converter::Impl::fillMissingPositiveLODElevation(GeoCellContext &context,
+                                                      const CDBElevation &elevation,
+                                                      const std::optional<Texture> &currentImagery,
                                                       const CDB &cdb,
                                                       const std::filesystem::path &tilesetDirectory,
-                                                      CDBTileset &tileset)
+                                                      CDBTileset &tileset,
+                                                      TaskGroup &elevationTasks)
 {
     const auto &cdbTile = elevation.getTile();
     auto nw = CDBTile::createNorthWestForPositiveLOD(cdbTile);
@@ -296,83 +893,63 @@ void Converter::Impl::fillMissingPositiveLODElevation(const CDBElevation &elevat
     bool isSouthEastExist = cdb.isElevationExist(se);
     bool shouldFillHole = isNorthEastExist || isNorthWestExist || isSouthWestExist || isSouthEastExist;
 
+    // check if imagery exist even the elevation has no child
+    bool isNorthWestImageryExist = cdb.isImageryExist(nw);
+    bool isNorthEastImageryExist = cdb.isImageryExist(ne);
+    bool isSouthWestImageryExist = cdb.isImageryExist(sw);
+    bool isSouthEastImageryExist = cdb.isImageryExist(se);
+
     // If we don't need to make elevation and imagery have the same LOD, then hasMoreImagery is false.
-    // Otherwise, check if imagery exist even the elevation has no child
     bool hasMoreImagery;
     if (elevationLOD) {
         hasMoreImagery = false;
     } else {
-        bool isNorthWestImageryExist = cdb.isImageryExist(nw);
-        bool isNorthEastImageryExist = cdb.isImageryExist(ne);
-        bool isSouthWestImageryExist = cdb.isImageryExist(sw);
-        bool isSouthEastImageryExist = cdb.isImageryExist(se);
         hasMoreImagery = isNorthEastImageryExist || isNorthWestImageryExist || isSouthEastImageryExist
                          || isSouthWestImageryExist;
     }
 
+    // each missing child is filled by its own task
     if (shouldFillHole || hasMoreImagery) {
         if (!isNorthWestExist) {
-            auto subRegionImagery = cdb.getImagery(nw);
-            bool reindexUV = subRegionImagery != std::nullopt;
-            auto subRegion = elevation.createNorthWestSubRegion(reindexUV);
+            auto subRegion = elevation.createNorthWestSubRegion(isNorthWestImageryExist);
             if (subRegion) {
-                addSubRegionElevationToTileset(*subRegion,
-                                               cdb,
-                                               subRegionImagery,
-                                               currentImagery,
-                                               tilesetDirectory,
-                                               tileset);
+                addSubRegionElevationToTileset(
+                    context, *subRegion, cdb, currentImagery, tilesetDirectory, tileset, elevationTasks);
             }
         }
 
         if (!isNorthEastExist) {
-            auto subRegionImagery = cdb.getImagery(ne);
-            bool reindexUV = subRegionImagery != std::nullopt;
-            auto subRegion = elevation.createNorthEastSubRegion(reindexUV);
+            auto subRegion = elevation.createNorthEastSubRegion(isNorthEastImageryExist);
             if (subRegion) {
-                addSubRegionElevationToTileset(*subRegion,
-                                               cdb,
-                                               subRegionImagery,
-                                               currentImagery,
-                                               tilesetDirectory,
-                                               tileset);
+                addSubRegionElevationToTileset(
+                    context, *subRegion, cdb, currentImagery, tilesetDirectory, tileset, elevationTasks);
             }
         }
 
         if (!isSouthEastExist) {
-            auto subRegionImagery = cdb.getImagery(se);
-            bool reindexUV = subRegionImagery != std::nullopt;
-            auto subRegion = elevation.createSouthEastSubRegion(reindexUV);
+            auto subRegion = elevation.createSouthEastSubRegion(isSouthEastImageryExist);
             if (subRegion) {
-                addSubRegionElevationToTileset(*subRegion,
-                                               cdb,
-                                               subRegionImagery,
-                                               currentImagery,
-                                               tilesetDirectory,
-                                               tileset);
+                addSubRegionElevationToTileset(
+                    context, *subRegion, cdb, currentImagery, tilesetDirectory, tileset, elevationTasks);
             }
         }
 
         if (!isSouthWestExist) {
-            auto subRegionImagery = cdb.getImagery(sw);
-            bool reindexUV = subRegionImagery != std::nullopt;
-            auto subRegion = elevation.createSouthWestSubRegion(reindexUV);
+            auto subRegion = elevation.createSouthWestSubRegion(isSouthWestImageryExist);
             if (subRegion) {
-                addSubRegionElevationToTileset(*subRegion,
-                                               cdb,
-                                               subRegionImagery,
-                                               currentImagery,
-                                               tilesetDirectory,
-                                               tileset);
+                addSubRegionElevationToTileset(
+                    context, *subRegion, cdb, currentImagery, tilesetDirectory, tileset, elevationTasks);
             }
         }
     }
 }
 
-void Converter::Impl::fillMissingNegativeLODElevation(CDBElevation &elevation,
+void Converter::Impl::fillMissingNegativeLODElevation(GeoCellContext &context,
+                                                      CDBElevation &elevation,
                                                       const CDB &cdb,
                                                       const std::filesystem::path &outputDirectory,
-                                                      CDBTileset &tileset)
+                                                      CDBTileset &tileset,
+                                                      TaskGroup &elevationTasks)
 {
     const auto &cdbTile = elevation.getTile();
     auto child = CDBTile::createChildForNegativeLOD(cdbTile);
@@ -381,88 +958,113 @@ void Converter::Impl::fillMissingNegativeLODElevation(CDBElevation &elevation,
     // when we only care about elevation LOD, don't duplicate it
     if (!cdb.isElevationExist(child)) {
         if (!elevationLOD) {
-            auto childImagery = cdb.getImagery(child);
+            auto childImagery = getImageryTexture(context, child, cdb, outputDirectory, elevationTasks);
             if (childImagery) {
-                Texture imageryTexture = createImageryTexture(*childImagery, outputDirectory);
+                // the elevation is not used anymore once it is written, so the child task takes it over
                 elevation.setTile(child);
-                addElevationToTileset(elevation, &imageryTexture, cdb, outputDirectory, tileset);
+                elevationTasks.run([this,
+                                    &context,
+                                    &cdb,
+                                    &tileset,
+                                    &elevationTasks,
+                                    outputDirectory,
+                                    childImagery,
+                                    childElevation = std::move(elevation)]() mutable {
+                    addElevationToTileset(
+                        context, childElevation, childImagery, cdb, outputDirectory, tileset, elevationTasks);
+                });
             }
         }
     }
 }
 
-void Converter::Impl::generateElevationNormal(Mesh &simplifed)
+void Converter::Impl::addSubRegionElevationToTileset(GeoCellContext &context,
+                                                     CDBElevation &subRegion,
+                                                     const CDB &cdb,
+                                                     const std::optional<Texture> &parentTexture,
+                                                     const std::filesystem::path &outputDirectory,
+                                                     CDBTileset &tileset,
+                                                     TaskGroup &elevationTasks)
 {
-    size_t totalVertices = simplifed.positions.size();
+    elevationTasks.run([this,
+                        &context,
+                        &cdb,
+                        &tileset,
+                        &elevationTasks,
+                        outputDirectory,
+                        parentTexture,
+                        subRegion = std::move(subRegion)]() mutable {
+        // Use the sub region imagery. If sub region doesn't have imagery,
+        // reuse parent imagery if we don't have any higher LOD imagery
+        auto subRegionTexture = getImageryTexture(
+            context, subRegion.getTile(), cdb, outputDirectory, elevationTasks);
+        const auto &texture = subRegionTexture ? subRegionTexture : parentTexture;
+        addElevationToTileset(context, subRegion, texture, cdb, outputDirectory, tileset, elevationTasks);
+    });
+}
 
-    // calculate normals
-    const auto &ellipsoid = Core::Ellipsoid::WGS84;
-    simplifed.normals.resize(totalVertices, glm::vec3(0.0));
-    for (size_t i = 0; i < simplifed.indices.size(); i += 3) {
-        uint32_t idx0 = simplifed.indices[i];
-        uint32_t idx1 = simplifed.indices[i + 1];
-        uint32_t idx2 = simplifed.indices[i + 2];
-
-        glm::dvec3 p0 = simplifed.positionRTCs[idx0];
-        glm::dvec3 p1 = simplifed.positionRTCs[idx1];
-        glm::dvec3 p2 = simplifed.positionRTCs[idx2];
-
-        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
-        simplifed.normals[idx0] += normal;
-        simplifed.normals[idx1] += normal;
-        simplifed.normals[idx2] += normal;
-    }
-
-    // normalize normal and calculate position rtc
-    for (size_t i = 0; i < totalVertices; ++i) {
-        auto &normal = simplifed.normals[i];
-        if (glm::abs(glm::dot(normal, normal)) > Core::Math::EPSILON10) {
-            normal = glm::normalize(normal);
+std::optional<Texture> Converter::Impl::getImageryTexture(GeoCellContext &context,
+                                                          const CDBTile &tile,
+                                                          const CDB &cdb,
+                                                          const std::filesystem::path &tilesetDirectory,
+                                                          TaskGroup &imageryTasks)
+{
+    // each imagery is only decoded and encoded once per GeoCell. Other tiles using it wait for the task that
+    // encodes it, and tiles without imagery reference the texture of their ancestor with re-indexed UVs, so
+    // no crop or reduced copy of a JP2 is ever decoded again. Missing imagery is cached as well, which keeps
+    // the walk over the ancestors from probing the same tiles repeatedly
+    std::promise<std::optional<Texture>> texturePromise;
+    std::shared_future<std::optional<Texture>> texture;
+    bool isTextureOwner = false;
+    {
+        std::lock_guard<std::mutex> lock(context.imageryTexturesMutex);
+        auto it = context.imageryTextures.find(tile.getKey());
+        if (it == context.imageryTextures.end()) {
+            texture = texturePromise.get_future().share();
+            context.imageryTextures.insert({tile.getKey(), texture});
+            isTextureOwner = true;
         } else {
-            auto cartographic = ellipsoid.cartesianToCartographic(simplifed.positions[i]);
-            if (cartographic) {
-                normal = ellipsoid.geodeticSurfaceNormal(*cartographic);
+            texture = it->second;
+        }
+    }
+
+    // the texture is known as soon as the imagery is opened, so the tiles only wait for that. The imagery is
+    // decoded and encoded afterward, while the tiles referencing the texture are written
+    std::shared_ptr<CDBImagery> encodedImagery;
+    std::filesystem::path textureAbsolutePath;
+    if (isTextureOwner) {
+        try {
+            auto imagery = cdb.getImagery(tile);
+            if (imagery) {
+                auto imageryTexture = createImageryTexture(imagery->getTile(), tilesetDirectory);
+                encodedImagery = std::make_shared<CDBImagery>(std::move(*imagery));
+                textureAbsolutePath = tilesetDirectory / imageryTexture.uri;
+                texturePromise.set_value(imageryTexture);
+            } else {
+                texturePromise.set_value(std::nullopt);
             }
+        } catch (...) {
+            texturePromise.set_exception(std::current_exception());
         }
     }
-}
 
-void Converter::Impl::addSubRegionElevationToTileset(CDBElevation &subRegion,
-                                                     const CDB &cdb,
-                                                     std::optional<CDBImagery> &subRegionImagery,
-                                                     const Texture *parentTexture,
-                                                     const std::filesystem::path &outputDirectory,
-                                                     CDBTileset &tileset)
-{
-    // Use the sub region imagery. If sub region doesn't have imagery, reuse parent imagery if we don't have any higher LOD imagery
-    if (subRegionImagery) {
-        Texture subRegionTexture = createImageryTexture(*subRegionImagery, outputDirectory);
-        addElevationToTileset(subRegion, &subRegionTexture, cdb, outputDirectory, tileset);
-    } else if (parentTexture) {
-        addElevationToTileset(subRegion, parentTexture, cdb, outputDirectory, tileset);
-    } else {
-        addElevationToTileset(subRegion, nullptr, cdb, outputDirectory, tileset);
+    if (encodedImagery) {
+        encodeImageryTexture(context, encodedImagery, textureAbsolutePath, imageryTasks);
     }
+
+    return texture.get();
 }
 
-Texture Converter::Impl::createImageryTexture(CDBImagery &imagery,
+Texture Converter::Impl::createImageryTexture(const CDBTile &tile,
                                               const std::filesystem::path &tilesetOutputDirectory) const
 {
     static const std::filesystem::path MODEL_TEXTURE_SUB_DIR = "Textures";
 
-    const auto &tile = imagery.getTile();
-    auto textureRelativePath = MODEL_TEXTURE_SUB_DIR / (tile.getRelativePath().filename().string() + ".jpeg");
-    auto textureAbsolutePath = tilesetOutputDirectory / textureRelativePath;
+    bool isKTX2 = textureCompression != TextureCompression::None;
+    auto textureFilename = tile.getFilename() + (isKTX2 ? ".ktx2" : ".jpeg");
+    auto textureRelativePath = MODEL_TEXTURE_SUB_DIR / textureFilename;
     auto textureDirectory = tilesetOutputDirectory / MODEL_TEXTURE_SUB_DIR;
-    if (!std::filesystem::exists(textureDirectory)) {
-        std::filesystem::create_directories(textureDirectory);
-    }
-
-    auto driver = (GDALDriver *) GDALGetDriverByName("jpeg");
-    if (driver) {
-        GDALDatasetUniquePtr jpegDataset = GDALDatasetUniquePtr(driver->CreateCopy(
-            textureAbsolutePath.string().c_str(), &imagery.getData(), false, nullptr, nullptr, nullptr));
-    }
+    outputSink->createDirectories(textureDirectory);
 
     Texture texture;
     texture.uri = textureRelativePath;
@@ -472,127 +1074,586 @@ Texture Converter::Impl::createImageryTexture(CDBImagery &imagery,
     return texture;
 }
 
+void Converter::Impl::encodeImageryTexture(GeoCellContext &context,
+                                           std::shared_ptr<CDBImagery> imagery,
+                                           const std::filesystem::path &textureAbsolutePath,
+                                           TaskGroup &imageryTasks)
+{
+    // the queued imagery may all be decoded at the same time, so together they stay under the memory budget.
+    // Past it, the tile encodes its imagery itself, which holds back the elevation tasks until the queue drains
+    auto &dataset = imagery->getData();
+    size_t decodedBytes = static_cast<size_t>(dataset.GetRasterXSize())
+                          * static_cast<size_t>(dataset.GetRasterYSize()) * 4;
+    size_t encodingMemory = getCacheMemory(imageryEncodingMemory, 8);
+    bool isQueued;
+    {
+        std::lock_guard<std::mutex> lock(context.imageryTexturesMutex);
+        isQueued = encodingMemory == 0 || context.encodingImageryBytes == 0
+                   || context.encodingImageryBytes + decodedBytes <= encodingMemory;
+        if (isQueued) {
+            context.encodingImageryBytes += decodedBytes;
+        }
+    }
+
+    if (!isQueued) {
+        writeImageryTexture(*imagery, textureAbsolutePath);
+        return;
+    }
+
+    imageryTasks.run([this, &context, imagery, textureAbsolutePath, decodedBytes]() {
+        auto releaseMemory = [&]() {
+            std::lock_guard<std::mutex> lock(context.imageryTexturesMutex);
+            context.encodingImageryBytes -= decodedBytes;
+        };
+
+        try {
+            writeImageryTexture(*imagery, textureAbsolutePath);
+        } catch (...) {
+            releaseMemory();
+            throw;
+        }
+
+        releaseMemory();
+    });
+}
+
+void Converter::Impl::writeImageryTexture(CDBImagery &imagery,
+                                          const std::filesystem::path &textureAbsolutePath) const
+{
+    const auto &tile = imagery.getTile();
+    ScopedPhaseTimer encodingTimer(stats.get(), tile, ConversionPhase::ImageryEncoding);
+    if (textureCompression != TextureCompression::None) {
+        // the grey or color bands are read as opaque RGBA pixels, top row first
+        auto &dataset = imagery.getData();
+        int width = dataset.GetRasterXSize();
+        int height = dataset.GetRasterYSize();
+        int bandCount = dataset.GetRasterCount();
+        int bandMap[3] = {1, std::min(2, bandCount), std::min(3, bandCount)};
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * static_cast<size_t>(height) * 4, 255);
+        CPLErr error = dataset.RasterIO(GF_Read,
+                                        0,
+                                        0,
+                                        width,
+                                        height,
+                                        pixels.data(),
+                                        width,
+                                        height,
+                                        GDT_Byte,
+                                        3,
+                                        bandMap,
+                                        4,
+                                        4 * static_cast<GSpacing>(width),
+                                        1,
+                                        nullptr);
+        if (error != CE_None) {
+            throw std::runtime_error("Cannot read imagery " + tile.getRelativePath().string());
+        }
+
+        auto textureWidth = static_cast<unsigned>(width);
+        auto textureHeight = static_cast<unsigned>(height);
+        writeKTX2Texture(pixels, textureWidth, textureHeight, textureAbsolutePath);
+    } else {
+        // the JPEG is encoded in memory, so it is handed over to the sink like the tiles
+        auto driver = (GDALDriver *) GDALGetDriverByName("jpeg");
+        if (driver) {
+            std::string memoryPath = "/vsimem/" + textureAbsolutePath.string();
+            GDALDatasetUniquePtr jpegDataset = GDALDatasetUniquePtr(driver->CreateCopy(
+                memoryPath.c_str(), &imagery.getData(), false, nullptr, nullptr, nullptr));
+            jpegDataset.reset();
+
+            vsi_l_offset byteLength = 0;
+            GByte *bytes = VSIGetMemFileBuffer(memoryPath.c_str(), &byteLength, true);
+            VSIUnlink((memoryPath + ".aux.xml").c_str());
+            if (bytes) {
+                std::vector<unsigned char> JPEG(bytes, bytes + byteLength);
+                VSIFree(bytes);
+                outputSink->write(textureAbsolutePath, std::move(JPEG));
+            }
+        }
+    }
+}
+
 void Converter::Impl::addVectorToTilesetCollection(
     const CDBGeometryVectors &vectors,
     const std::filesystem::path &collectionOutputDirectory,
     std::unordered_map<CDBGeoCell, TilesetCollection> &tilesetCollections)
 {
     const auto &cdbTile = vectors.getTile();
-    const auto &mesh = vectors.getMesh();
-    if (mesh.positionRTCs.empty()) {
+    const Mesh *mesh = &vectors.getMesh();
+    if (mesh->positionRTCs.empty()) {
         return;
     }
 
+    ScopedTraceEvent jobEvent(getTrace(), "vectorTile", cdbTile);
+
     std::filesystem::path tilesetDirectory;
     CDBTileset *tileset;
     getTileset(cdbTile, collectionOutputDirectory, tilesetCollections, tileset, tilesetDirectory);
-
-    tinygltf::Model gltf = createGltf(mesh, nullptr, nullptr);
-    createB3DMForTileset(gltf, cdbTile, &vectors.getInstancesAttributes(), tilesetDirectory, *tileset);
+    addVectorToTileset(cdbTile, *mesh, vectors.getInstancesAttributes(), tilesetDirectory, *tileset);
+
+    // points are kept at their level, lines and polygons are simplified for the levels missing in CDB
+    if (vectorLOD && mesh->primitiveType != PrimitiveType::Points) {
+        size_t CSHash = hashComponentSelectors(cdbTile.getCS_1(), cdbTile.getCS_2());
+        auto &vectorLODs = tilesetCollections[cdbTile.getGeoCell()].CSToVectorLODs[CSHash];
+
+        // the tile has content in CDB, so what its children already simplified into it is dropped
+        auto &tileLOD = vectorLODs[cdbTile];
+        tileLOD.hasContent = true;
+        tileLOD.mesh = Mesh();
+        tileLOD.instancesAttribs = CDBInstancesAttributes();
+        addVectorToParentLOD(cdbTile, *mesh, vectors.getInstancesAttributes(), *tileset, vectorLODs);
+    }
 }
 
-void Converter::Impl::addGTModelToTilesetCollection(const CDBGTModels &model,
-                                                    const std::filesystem::path &collectionOutputDirectory)
+void Converter::Impl::addVectorToTileset(const CDBTile &cdbTile,
+                                         const Mesh &mesh,
+                                         const CDBInstancesAttributes &instancesAttribs,
+                                         const std::filesystem::path &tilesetDirectory,
+                                         CDBTileset &tileset)
 {
-    static const std::filesystem::path MODEL_GLTF_SUB_DIR = "Gltf";
-    static const std::filesystem::path MODEL_TEXTURE_SUB_DIR = "Textures";
+    const Mesh *gltfMesh = &mesh;
+    std::optional<Mesh> optimizedMesh;
+    if (optimizeMeshes) {
+        optimizedMesh = mesh;
+        optimizeMeshForRendering(*optimizedMesh);
+        gltfMesh = &*optimizedMesh;
+    }
 
-    auto cdbTile = model.getModelsAttributes().getTile();
+    std::vector<GltfBufferSegment> bufferSegments;
+    ScopedPhaseTimer gltfTimer(stats.get(), cdbTile, ConversionPhase::GltfBuild);
+    tinygltf::Model gltf = createGltf(*gltfMesh, nullptr, nullptr, &bufferSegments, gltfEncoding);
+    gltfTimer.stop();
+    createB3DMForTileset(gltf, bufferSegments, cdbTile, &instancesAttribs, tilesetDirectory, tileset);
+}
 
-    std::filesystem::path tilesetDirectory;
-    CDBTileset *tileset;
-    getTileset(cdbTile, collectionOutputDirectory, GTModelTilesets, tileset, tilesetDirectory);
+void Converter::Impl::addVectorToParentLOD(
+    const CDBTile &cdbTile,
+    const Mesh &mesh,
+    const CDBInstancesAttributes &instancesAttribs,
+    const CDBTileset &tileset,
+    std::unordered_map<CDBTile, TilesetCollection::VectorLOD> &vectorLODs)
+{
+    // no level coarser than the minimum one is generated either
+    auto parentTile = CDBTile::createParentTile(cdbTile);
+    if (!parentTile || parentTile->getLevel() < minLevel) {
+        return;
+    }
 
-    // create gltf file
-    auto gltfOutputDIr = tilesetDirectory / MODEL_GLTF_SUB_DIR;
-    std::filesystem::create_directories(gltfOutputDIr);
+    // a parent with content in CDB is written from it, so its children are not simplified into it as well
+    auto existingParentLOD = vectorLODs.find(*parentTile);
+    if (existingParentLOD != vectorLODs.end() && existingParentLOD->second.hasContent) {
+        return;
+    }
 
-    std::map<std::string, std::vector<int>> instances;
+    // the parent replaces its children, so its content may move by as much as its geometric error
+    ScopedPhaseTimer simplificationTimer(stats.get(), cdbTile, ConversionPhase::MeshSimplification);
+    Mesh simplified = simplifyMesh(mesh, computeGeometricError(tileset, parentTile->getLevel()));
+    simplificationTimer.stop();
+    if (simplified.indices.empty()) {
+        return;
+    }
+
+    // the features whose geometry was simplified away are dropped from the attributes as well, so the
+    // coarser levels only carry the attributes of the features they still show
+    auto &parentLOD = vectorLODs[*parentTile];
+    const size_t droppedInstance = std::numeric_limits<size_t>::max();
+    std::vector<size_t> parentBatchIDs(instancesAttribs.getInstancesCount(), droppedInstance);
+    for (float batchID : simplified.batchIDs) {
+        parentBatchIDs[static_cast<size_t>(batchID)] = 0;
+    }
+
+    std::vector<size_t> keptInstances;
+    size_t batchIDOffset = parentLOD.instancesAttribs.getInstancesCount();
+    for (size_t i = 0; i < parentBatchIDs.size(); ++i) {
+        if (parentBatchIDs[i] != droppedInstance) {
+            parentBatchIDs[i] = batchIDOffset + keptInstances.size();
+            keptInstances.emplace_back(i);
+        }
+    }
+
+    for (auto &batchID : simplified.batchIDs) {
+        batchID = static_cast<float>(parentBatchIDs[static_cast<size_t>(batchID)]);
+    }
+
+    parentLOD.instancesAttribs.appendInstances(instancesAttribs.extractInstances(keptInstances));
+    if (parentLOD.mesh.indices.empty()) {
+        parentLOD.mesh = std::move(simplified);
+    } else {
+        std::vector<Mesh> meshes;
+        meshes.emplace_back(std::move(parentLOD.mesh));
+        meshes.emplace_back(std::move(simplified));
+        mergeMeshes(meshes);
+        parentLOD.mesh = std::move(meshes.front());
+    }
+}
+
+void Converter::Impl::addVectorLODsToTilesetCollection(
+    const CDBGeoCell &geoCell, std::unordered_map<CDBGeoCell, TilesetCollection> &tilesetCollections)
+{
+    auto geoCellCollectionIt = tilesetCollections.find(geoCell);
+    if (geoCellCollectionIt == tilesetCollections.end()) {
+        return;
+    }
+
+    auto &tilesetCollection = geoCellCollectionIt->second;
+    for (auto &CSToVectorLOD : tilesetCollection.CSToVectorLODs) {
+        auto &tileset = tilesetCollection.CSToTilesets.at(CSToVectorLOD.first);
+        const auto &tilesetDirectory = tilesetCollection.CSToPaths.at(CSToVectorLOD.first);
+        auto &vectorLODs = CSToVectorLOD.second;
+
+        // the deepest levels are written first, so that their content is simplified again for their parent
+        while (true) {
+            std::vector<CDBTile> levelTiles;
+            for (const auto &tileLOD : vectorLODs) {
+                if (tileLOD.second.hasContent) {
+                    continue;
+                }
+
+                if (!levelTiles.empty() && tileLOD.first.getLevel() > levelTiles.front().getLevel()) {
+                    levelTiles.clear();
+                }
+
+                if (levelTiles.empty() || tileLOD.first.getLevel() == levelTiles.front().getLevel()) {
+                    levelTiles.emplace_back(tileLOD.first);
+                }
+            }
+
+            if (levelTiles.empty()) {
+                break;
+            }
+
+            // the map isn't ordered, the tiles are so the parents are merged the same way on every run
+            std::sort(levelTiles.begin(), levelTiles.end(), [](const CDBTile &lhs, const CDBTile &rhs) {
+                return std::make_pair(lhs.getUREF(), lhs.getRREF())
+                       < std::make_pair(rhs.getUREF(), rhs.getRREF());
+            });
+
+            for (const auto &tile : levelTiles) {
+                auto tileLOD = std::move(vectorLODs.at(tile));
+                vectorLODs.erase(tile);
+                addVectorToTileset(tile, tileLOD.mesh, tileLOD.instancesAttribs, tilesetDirectory, tileset);
+                addVectorToParentLOD(tile, tileLOD.mesh, tileLOD.instancesAttribs, tileset, vectorLODs);
+            }
+        }
+    }
+
+    tilesetCollection.CSToVectorLODs.clear();
+}
+
+void Converter::Impl::addGTModelToTilesetCollection(GeoCellContext &context,
+                                                    const CDBGTModels &model,
+                                                    const std::filesystem::path &collectionOutputDirectory)
+{
+    static const std::filesystem::path MODEL_GLTF_SUB_DIR = "Gltf";
+    static const std::filesystem::path MODEL_TEXTURE_SUB_DIR = "Textures";
+
+    auto cdbTile = model.getModelsAttributes().getTile();
+    ScopedTraceEvent jobEvent(getTrace(), "GTModelTile", cdbTile);
+
+    std::filesystem::path tilesetDirectory;
+    CDBTileset *tileset;
+    getTileset(cdbTile, collectionOutputDirectory, context.GTModelTilesets, tileset, tilesetDirectory);
+
+    // create gltf file
+    auto gltfOutputDIr = tilesetDirectory / MODEL_GLTF_SUB_DIR;
+    outputSink->createDirectories(gltfOutputDIr);
+
+    // the instances are grouped by model first, so the instance count decides how each model is written
     const auto &modelsAttribs = model.getModelsAttributes();
     const auto &instancesAttribs = modelsAttribs.getInstancesAttributes();
+    std::map<std::string, std::vector<int>> modelInstances;
     for (size_t i = 0; i < instancesAttribs.getInstancesCount(); ++i) {
+        auto modelKey = model.getModelKey(i);
+        if (modelKey) {
+            modelInstances[*modelKey].emplace_back(static_cast<int>(i));
+        }
+    }
+
+    std::map<std::string, std::vector<int>> instances;
+    BakedGTModels baked;
+    for (const auto &modelInstance : modelInstances) {
+        // a model already written to glTF only needs its URI, so the geometry is not requested again
+        const auto &instanceIndices = modelInstance.second;
+        bool isGltfWritten = context.GTModelsToGltf.find(modelInstance.first) != context.GTModelsToGltf.end();
+        if (isGltfWritten && instanceIndices.size() > GTModelBaking.maxInstances) {
+            instances.insert(modelInstance);
+            continue;
+        }
+
         std::string modelKey;
-        auto model3D = model.locateModel3D(i, modelKey);
-        if (model3D) {
-            if (GTModelsToGltf.find(modelKey) == GTModelsToGltf.end()) {
-                // write textures to files
-                auto textures = writeModeTextures(model3D->getTextures(),
-                                                  model3D->getImages(),
-                                                  MODEL_TEXTURE_SUB_DIR,
-                                                  gltfOutputDIr);
-
-                // create gltf for the instance
-                tinygltf::Model gltf = createGltf(model3D->getMeshes(), model3D->getMaterials(), textures);
-
-                // write to glb
-                tinygltf::TinyGLTF loader;
-                std::filesystem::path modelGltfURI = MODEL_GLTF_SUB_DIR / (modelKey + ".glb");
-                loader.WriteGltfSceneToFile(&gltf, tilesetDirectory / modelGltfURI, false, false, false, true);
-                GTModelsToGltf.insert({modelKey, modelGltfURI});
+        ScopedPhaseTimer decodeTimer(stats.get(), cdbTile, ConversionPhase::Decode);
+        auto model3D = model.locateModel3D(static_cast<size_t>(instanceIndices.front()), modelKey);
+        decodeTimer.stop();
+        if (!model3D) {
+            continue;
+        }
+
+        if (GTModelBaking.shouldBake(instanceIndices.size(), model3D->getTriangleCount())) {
+            bakeGTModelInstances(context,
+                                 *model3D,
+                                 modelsAttribs,
+                                 instanceIndices,
+                                 MODEL_GLTF_SUB_DIR / MODEL_TEXTURE_SUB_DIR,
+                                 tilesetDirectory,
+                                 baked);
+            continue;
+        }
+
+        if (!isGltfWritten) {
+            // write textures to files. A glTF written to the content store references the textures in it
+            auto gltfDirectory = contentStore ? contentStore->getDirectory() : gltfOutputDIr;
+            auto textures = writeModeTextures(context,
+                                              model3D->getTextures(),
+                                              model3D->getImages(),
+                                              MODEL_TEXTURE_SUB_DIR,
+                                              gltfDirectory);
+
+            // create gltf for the instance
+            std::vector<Mesh> optimizedMeshes;
+            const auto &meshes = getMeshesForGltf(model3D->getMeshes(), optimizedMeshes);
+            std::vector<GltfBufferSegment> bufferSegments;
+            ScopedPhaseTimer gltfTimer(stats.get(), cdbTile, ConversionPhase::GltfBuild);
+            tinygltf::Model gltf = createGltf(
+                meshes, model3D->getMaterials(), textures, &bufferSegments, gltfEncoding);
+            gltfTimer.stop();
+
+            // write to glb
+            ScopedPhaseTimer writeTimer(stats.get(), cdbTile, ConversionPhase::TileWrite);
+            OutputBuffer glb;
+            writeToGlb(createGlbJson(&gltf, bufferSegments), bufferSegments, glb);
+            writeTimer.stop();
+            auto glbByteLength = glb.getByteLength();
+            std::filesystem::path modelGltfPath;
+            bool isWritten = true;
+            if (contentStore) {
+                modelGltfPath = contentStore->store(glb.release(), ".glb", isWritten);
+            } else {
+                modelGltfPath = tilesetDirectory / MODEL_GLTF_SUB_DIR / (modelKey + ".glb");
+                outputSink->write(modelGltfPath, glb.release());
             }
 
-            auto &instance = instances[modelKey];
-            instance.emplace_back(i);
+            if (isWritten) {
+                addBytesWritten(cdbTile.getGeoCell(), cdbTile.getDataset(), glbByteLength);
+            }
+
+            context.GTModelsToGltf.insert({modelKey, modelGltfPath});
+        }
+
+        instances.insert(modelInstance);
+    }
+
+    // the baked models are written as one B3DM, alone or after the I3DMs of the instanced models
+    std::optional<CDBInstancesAttributes> bakedInstancesAttribs;
+    std::vector<GltfBufferSegment> bakedBufferSegments;
+    tinygltf::Model bakedGltf;
+    if (!baked.instances.empty()) {
+        bakedInstancesAttribs = instancesAttribs.extractInstances(baked.instances);
+        mergeMeshes(baked.meshes);
+        std::vector<Mesh> optimizedMeshes;
+        const auto &meshes = getMeshesForGltf(baked.meshes, optimizedMeshes);
+        ScopedPhaseTimer gltfTimer(stats.get(), cdbTile, ConversionPhase::GltfBuild);
+        bakedGltf = createGltf(meshes, baked.materials, baked.textures, &bakedBufferSegments, gltfEncoding);
+        gltfTimer.stop();
+        if (instances.empty()) {
+            createB3DMForTileset(
+                bakedGltf, bakedBufferSegments, cdbTile, &*bakedInstancesAttribs, tilesetDirectory, *tileset);
+            return;
         }
     }
 
     // write i3dm to cmpt
-    std::string cdbTileFilename = cdbTile.getRelativePath().filename().string();
+    std::string cdbTileFilename = cdbTile.getFilename();
     std::filesystem::path cmpt = cdbTileFilename + std::string(".cmpt");
     std::filesystem::path cmptFullPath = tilesetDirectory / cmpt;
-    std::ofstream fs(cmptFullPath, std::ios::binary);
-    auto instance = instances.begin();
-    writeToCMPT(static_cast<uint32_t>(instances.size()), fs, [&](std::ofstream &os, size_t) {
-        const auto &GltfURI = GTModelsToGltf[instance->first];
-        const auto &instanceIndices = instance->second;
-        size_t totalWrite = writeToI3DM(GltfURI, modelsAttribs, instanceIndices, os);
-        instance = std::next(instance);
-        return totalWrite;
+    std::vector<I3DM> i3dms;
+    std::vector<size_t> tileByteLengths;
+    i3dms.reserve(instances.size());
+    tileByteLengths.reserve(instances.size() + 1);
+    for (const auto &instance : instances) {
+        auto GltfURI = context.GTModelsToGltf[instance.first].lexically_relative(tilesetDirectory);
+        i3dms.emplace_back(createI3DM(GltfURI.generic_string(), modelsAttribs, instance.second));
+        tileByteLengths.emplace_back(i3dms.back().getByteLength());
+    }
+
+    std::optional<B3DM> bakedB3DM;
+    if (bakedInstancesAttribs) {
+        bakedB3DM = createB3DM(&bakedGltf, bakedBufferSegments, &*bakedInstancesAttribs);
+        tileByteLengths.emplace_back(bakedB3DM->getByteLength());
+    }
+
+    ScopedPhaseTimer writeTimer(stats.get(), cdbTile, ConversionPhase::TileWrite);
+    OutputBuffer cmptFile;
+    writeToCMPT(tileByteLengths, cmptFile, [&](std::ostream &os, size_t tileIdx) {
+        if (tileIdx < i3dms.size()) {
+            writeToI3DM(i3dms[tileIdx], os);
+        } else {
+            writeToB3DM(*bakedB3DM, os);
+        }
     });
 
+    writeTimer.stop();
+    addTileWritten(cdbTile, cmptFile.getByteLength());
+    outputSink->write(cmptFullPath, cmptFile.release());
+
     // add it to tileset
     cdbTile.setCustomContentURI(cmpt);
     tileset->insertTile(cdbTile);
 }
 
-void Converter::Impl::addGSModelToTilesetCollection(const CDBGSModels &model,
+void Converter::Impl::bakeGTModelInstances(GeoCellContext &context,
+                                           const CDBModel3DResult &model3D,
+                                           const CDBModelsAttributes &modelsAttribs,
+                                           const std::vector<int> &instanceIndices,
+                                           const std::filesystem::path &textureSubDir,
+                                           const std::filesystem::path &tilesetDirectory,
+                                           BakedGTModels &baked)
+{
+    // the textures are the files of the instanced glTFs, so they are written once however the model is used
+    auto textures = writeModeTextures(
+        context, model3D.getTextures(), model3D.getImages(), textureSubDir, tilesetDirectory);
+    int textureOffset = static_cast<int>(baked.textures.size());
+    baked.textures.insert(baked.textures.end(), textures.begin(), textures.end());
+
+    int materialOffset = static_cast<int>(baked.materials.size());
+    for (auto material : model3D.getMaterials()) {
+        if (material.texture >= 0) {
+            material.texture += textureOffset;
+        }
+
+        baked.materials.emplace_back(material);
+    }
+
+    // the same transform as GSModels, which places the model where its I3DM instance would be
+    const auto &ellipsoid = Core::Ellipsoid::WGS84;
+    const auto &cartographicPositions = modelsAttribs.getCartographicPositions();
+    const auto &orientations = modelsAttribs.getOrientations();
+    const auto &scales = modelsAttribs.getScales();
+    for (int instanceIndex : instanceIndices) {
+        auto instanceIdx = static_cast<size_t>(instanceIndex);
+        glm::dvec3 worldPosition = ellipsoid.cartographicToCartesian(cartographicPositions[instanceIdx]);
+        glm::dmat4 transform = glm::scale(calculateModelOrientation(worldPosition, orientations[instanceIdx]),
+                                          glm::dvec3(scales[instanceIdx]));
+
+        auto batchID = static_cast<float>(baked.instances.size());
+        baked.instances.emplace_back(instanceIdx);
+        for (const auto &mesh : model3D.getMeshes()) {
+            auto &bakedMesh = baked.meshes.emplace_back(transformMesh(mesh, transform));
+            if (bakedMesh.material >= 0) {
+                bakedMesh.material += materialOffset;
+            }
+
+            bakedMesh.batchIDs.assign(bakedMesh.getVertexCount(), batchID);
+        }
+    }
+}
+
+void Converter::Impl::addGSModelToTilesetCollection(GeoCellContext &context,
+                                                    CDBGSModels &model,
                                                     const std::filesystem::path &collectionOutputDirectory)
 {
     static const std::filesystem::path MODEL_TEXTURE_SUB_DIR = "Textures";
 
     const auto &cdbTile = model.getTile();
-    const auto &model3D = model.getModel3D();
+    auto &model3D = model.getModel3D();
+    ScopedTraceEvent jobEvent(getTrace(), "GSModelTile", cdbTile);
 
     std::filesystem::path tilesetDirectory;
     CDBTileset *tileset;
-    getTileset(cdbTile, collectionOutputDirectory, GSModelTilesets, tileset, tilesetDirectory);
+    getTileset(cdbTile, collectionOutputDirectory, context.GSModelTilesets, tileset, tilesetDirectory);
+
+    // GSModel textures only belong to their tile, unlike the GTModel textures shared by every instance
+    std::optional<TextureAtlasResult> atlas;
+    if (textureAtlasSize > 0) {
+        std::string atlasName = cdbTile.getFilename() + "_atlas";
+        atlas = createTextureAtlases(model3D.getMeshes(),
+                                     model3D.getMaterials(),
+                                     model3D.getTextures(),
+                                     model3D.getImages(),
+                                     atlasName,
+                                     textureAtlasSize);
+    }
 
-    auto textures = writeModeTextures(model3D.getTextures(),
-                                      model3D.getImages(),
+    auto &meshes = atlas ? atlas->meshes : model3D.getMeshes();
+    const auto &materials = atlas ? atlas->materials : model3D.getMaterials();
+    auto textures = writeModeTextures(context,
+                                      atlas ? atlas->textures : model3D.getTextures(),
+                                      atlas ? atlas->images : model3D.getImages(),
                                       MODEL_TEXTURE_SUB_DIR,
                                       tilesetDirectory);
 
-    auto gltf = createGltf(model3D.getMeshes(), model3D.getMaterials(), textures);
-    createB3DMForTileset(gltf, cdbTile, &model.getInstancesAttributes(), tilesetDirectory, *tileset);
+    // the meshes of a GSModel tile are owned by it alone, so they are optimized in place
+    if (optimizeMeshes) {
+        for (auto &mesh : meshes) {
+            optimizeMeshForRendering(mesh);
+        }
+    }
+
+    std::vector<GltfBufferSegment> bufferSegments;
+    ScopedPhaseTimer gltfTimer(stats.get(), cdbTile, ConversionPhase::GltfBuild);
+    auto gltf = createGltf(meshes, materials, textures, &bufferSegments, gltfEncoding);
+    gltfTimer.stop();
+    createB3DMForTileset(
+        gltf, bufferSegments, cdbTile, &model.getInstancesAttributes(), tilesetDirectory, *tileset);
+}
+
+const std::vector<Mesh> &Converter::Impl::getMeshesForGltf(const std::vector<Mesh> &meshes,
+                                                           std::vector<Mesh> &optimizedMeshes) const
+{
+    if (!optimizeMeshes) {
+        return meshes;
+    }
+
+    // loaded models may be shared by other tiles, so their meshes are optimized on a copy
+    optimizedMeshes = meshes;
+    for (auto &mesh : optimizedMeshes) {
+        optimizeMeshForRendering(mesh);
+    }
+
+    return optimizedMeshes;
 }
 
-std::vector<Texture> Converter::Impl::writeModeTextures(const std::vector<Texture> &modelTextures,
+std::vector<Texture> Converter::Impl::writeModeTextures(GeoCellContext &context,
+                                                        const std::vector<Texture> &modelTextures,
                                                         const std::vector<osg::ref_ptr<osg::Image>> &images,
                                                         const std::filesystem::path &textureSubDir,
                                                         const std::filesystem::path &gltfPath)
 {
-    auto textureDirectory = gltfPath / textureSubDir;
-    if (!std::filesystem::exists(textureDirectory)) {
-        std::filesystem::create_directories(textureDirectory);
+    // the textures of the content store are written to its own directory
+    if (!contentStore) {
+        outputSink->createDirectories(gltfPath / textureSubDir);
     }
 
     auto textures = modelTextures;
     for (size_t i = 0; i < modelTextures.size(); ++i) {
-        auto textureRelativePath = textureSubDir / modelTextures[i].uri;
-        auto textureAbsolutePath = gltfPath / textureSubDir / modelTextures[i].uri;
+        // images whose pixels cannot be read as RGBA stay PNG
+        std::filesystem::path textureFilename = modelTextures[i].uri;
+        bool isKTX2 = textureCompression != TextureCompression::None && isRGBAConvertible(*images[i]);
+        if (isKTX2) {
+            textureFilename.replace_extension(".ktx2");
+        }
+
+        auto textureRelativePath = textureSubDir / textureFilename;
+        auto textureAbsolutePath = gltfPath / textureSubDir / textureFilename;
 
-        if (processedModelTextures.find(textureAbsolutePath) == processedModelTextures.end()) {
-            osgDB::writeImageFile(*images[i], textureAbsolutePath.string(), nullptr);
+        if (contentStore) {
+            auto texturePath = storeModelTexture(context, *images[i], isKTX2, textureAbsolutePath);
+            textures[i].uri = texturePath.lexically_relative(gltfPath).generic_string();
+            continue;
+        }
+
+        bool isTextureProcessed;
+        {
+            std::lock_guard<std::mutex> lock(context.processedModelTexturesMutex);
+            isTextureProcessed = !context.processedModelTextures.insert(textureAbsolutePath.string()).second;
+        }
+
+        if (!isTextureProcessed && isKTX2) {
+            const auto &image = *images[i];
+            auto width = static_cast<unsigned>(image.s());
+            auto height = static_cast<unsigned>(image.t());
+            writeKTX2Texture(convertToRGBA(image), width, height, textureAbsolutePath);
+        } else if (!isTextureProcessed) {
+            writeImageTexture(*images[i], textureAbsolutePath);
         }
 
         textures[i].uri = textureRelativePath.string();
@@ -601,23 +1662,106 @@ std::vector<Texture> Converter::Impl::writeModeTextures(const std::vector<Textur
     return textures;
 }
 
+void Converter::Impl::writeKTX2Texture(const std::vector<unsigned char> &RGBAPixels,
+                                       unsigned width,
+                                       unsigned height,
+                                       const std::filesystem::path &path) const
+{
+    outputSink->write(path, encodeKTX2(RGBAPixels, width, height, textureCompression));
+}
+
+void Converter::Impl::writeImageTexture(const osg::Image &image, const std::filesystem::path &path) const
+{
+    // the image is encoded in memory by the plugin of its extension, so it is handed over to the sink
+    auto encoded = encodeImageTexture(image, path.extension().string());
+    if (!encoded.empty()) {
+        outputSink->write(path, std::move(encoded));
+    }
+}
+
+std::vector<unsigned char> Converter::Impl::encodeImageTexture(const osg::Image &image,
+                                                               const std::string &extension) const
+{
+    auto readerWriter = osgDB::Registry::instance()->getReaderWriterForExtension(
+        extension.empty() ? extension : extension.substr(1));
+    if (!readerWriter) {
+        return {};
+    }
+
+    OutputBuffer buffer;
+    if (!readerWriter->writeImage(image, buffer).success()) {
+        return {};
+    }
+
+    return buffer.release();
+}
+
+std::filesystem::path Converter::Impl::storeModelTexture(GeoCellContext &context,
+                                                         const osg::Image &image,
+                                                         bool isKTX2,
+                                                         const std::filesystem::path &textureAbsolutePath)
+{
+    // a texture is encoded once per GeoCell under the path it would have without the store, then its bytes
+    // decide where it is stored
+    {
+        std::lock_guard<std::mutex> lock(context.processedModelTexturesMutex);
+        auto storedTexture = context.storedModelTextures.find(textureAbsolutePath.string());
+        if (storedTexture != context.storedModelTextures.end()) {
+            return storedTexture->second;
+        }
+    }
+
+    std::vector<unsigned char> encoded;
+    if (isKTX2) {
+        auto width = static_cast<unsigned>(image.s());
+        auto height = static_cast<unsigned>(image.t());
+        encoded = encodeKTX2(convertToRGBA(image), width, height, textureCompression);
+    } else {
+        encoded = encodeImageTexture(image, textureAbsolutePath.extension().string());
+    }
+
+    // an image that cannot be encoded keeps its path, like the textures written without the store
+    auto texturePath = textureAbsolutePath;
+    if (!encoded.empty()) {
+        bool isWritten;
+        auto extension = textureAbsolutePath.extension().string();
+        texturePath = contentStore->store(std::move(encoded), extension, isWritten);
+    }
+
+    std::lock_guard<std::mutex> lock(context.processedModelTexturesMutex);
+    context.storedModelTextures.insert({textureAbsolutePath.string(), texturePath});
+    return texturePath;
+}
+
 void Converter::Impl::createB3DMForTileset(tinygltf::Model &gltf,
+                                           const std::vector<GltfBufferSegment> &bufferSegments,
                                            CDBTile cdbTile,
                                            const CDBInstancesAttributes *instancesAttribs,
                                            const std::filesystem::path &outputDirectory,
-                                           CDBTileset &tileset)
+                                           CDBTileset &tileset,
+                                           std::mutex *tilesetMutex)
 {
     // create b3dm file
-    std::string cdbTileFilename = cdbTile.getRelativePath().filename().string();
+    std::string cdbTileFilename = cdbTile.getFilename();
     std::filesystem::path b3dm = cdbTileFilename + std::string(".b3dm");
     std::filesystem::path b3dmFullPath = outputDirectory / b3dm;
 
     // write to b3dm
-    std::ofstream fs(b3dmFullPath, std::ios::binary);
-    writeToB3DM(&gltf, instancesAttribs, fs);
+    ScopedPhaseTimer writeTimer(stats.get(), cdbTile, ConversionPhase::TileWrite);
+    OutputBuffer b3dmFile;
+    writeToB3DM(&gltf, bufferSegments, instancesAttribs, b3dmFile);
+    writeTimer.stop();
+    addTileWritten(cdbTile, b3dmFile.getByteLength());
+    outputSink->write(b3dmFullPath, b3dmFile.release());
+
     cdbTile.setCustomContentURI(b3dm);
 
-    tileset.insertTile(cdbTile);
+    if (tilesetMutex) {
+        std::lock_guard<std::mutex> lock(*tilesetMutex);
+        tileset.insertTile(cdbTile);
+    } else {
+        tileset.insertTile(cdbTile);
+    }
 }
 
 size_t Converter::Impl::hashComponentSelectors(int CS_1, int CS_2)
@@ -650,7 +1794,7 @@ void Converter::Impl::getTileset(const CDBTile &cdbTile,
     auto CSPathIt = CSToPaths.find(CSHash);
     if (CSPathIt == CSToPaths.end()) {
         path = getTilesetDirectory(cdbTile.getCS_1(), cdbTile.getCS_2(), collectionOutputDirectory);
-        std::filesystem::create_directories(path);
+        outputSink->createDirectories(path);
         CSToPaths.insert({CSHash, path});
     } else {
         path = CSPathIt->second;
@@ -659,6 +1803,206 @@ void Converter::Impl::getTileset(const CDBTile &cdbTile,
     tileset = &tilesetCollection.CSToTilesets[CSHash];
 }
 
+ConversionTrace *Converter::Impl::getTrace() const noexcept
+{
+    return stats ? stats->getTrace() : nullptr;
+}
+
+void Converter::Impl::addTileWritten(const CDBTile &tile, uint64_t bytes)
+{
+    if (stats) {
+        stats->addTile(tile.getGeoCell(), tile.getDataset(), bytes);
+    }
+
+    if (progress) {
+        progress->addBytesWritten(bytes);
+    }
+}
+
+void Converter::Impl::addBytesWritten(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes)
+{
+    if (stats) {
+        stats->addBytesOut(geoCell, dataset, bytes);
+    }
+
+    if (progress) {
+        progress->addBytesWritten(bytes);
+    }
+}
+
+std::vector<std::filesystem::path> Converter::Impl::convertGeoCell(const CDBGeoCell &geoCell,
+                                                                   ThreadPool &threadPool)
+{
+    // the directory listings and GTModels are shared by every GeoCell, the rest of the state is not
+    auto geoCellStart = std::chrono::steady_clock::now();
+    CDB cdb(cdbPath,
+            manifest,
+            GTModelCache,
+            getCacheMemory(elevationGridCacheMemory, 8),
+            stats,
+            progress,
+            datasetPool);
+    selectTiles(cdb);
+    cdb.setReadAheadDepth(readAheadDepth);
+
+    GeoCellContext context;
+
+    // create directories for converted GeoCell
+    std::filesystem::path geoCellRelativePath = geoCell.getRelativePath();
+    std::filesystem::path geoCellAbsolutePath = outputPath / geoCellRelativePath;
+    std::filesystem::path elevationDir = geoCellAbsolutePath / ELEVATIONS_PATH;
+    std::filesystem::path GTModelDir = geoCellAbsolutePath / GTMODEL_PATH;
+    std::filesystem::path GSModelDir = geoCellAbsolutePath / GSMODEL_PATH;
+    std::filesystem::path roadNetworkDir = geoCellAbsolutePath / ROAD_NETWORK_PATH;
+    std::filesystem::path railRoadNetworkDir = geoCellAbsolutePath / RAILROAD_NETWORK_PATH;
+    std::filesystem::path powerlineNetworkDir = geoCellAbsolutePath / POWERLINE_NETWORK_PATH;
+    std::filesystem::path hydrographyNetworkDir = geoCellAbsolutePath / HYDROGRAPHY_NETWORK_PATH;
+
+    // every file of the GeoCell goes to its archive, next to where its directory would be
+    auto archiveSink = dynamic_cast<ArchiveOutputSink *>(outputSink.get());
+    if (archiveSink) {
+        archiveSink->openArchive(geoCellAbsolutePath, getGeoCellArchivePath(geoCellRelativePath.string()));
+    }
+
+    // each dataset has its own tileset collection and output directory, so they are converted as tasks
+    using DatasetConversion = std::function<void(std::vector<std::filesystem::path> &)>;
+    std::vector<DatasetConversion> datasetConversions = {
+        // process elevation
+        [&](std::vector<std::filesystem::path> &datasetToCombine) {
+            // every elevation tile and the holes filled from it are converted as separate tasks
+            TaskGroup elevationTasks(threadPool);
+            cdb.forEachElevationTile(geoCell, elevationTasks, [&](CDBElevation elevation) {
+                keepMemoryBudget(cdb);
+                addElevationToTilesetCollection(context, elevation, cdb, elevationDir, elevationTasks);
+            });
+            elevationTasks.wait();
+
+            flushTilesetCollection(geoCell, context.elevationTilesets, datasetToCombine);
+            std::unordered_map<CDBTileKey, std::shared_future<std::optional<Texture>>>().swap(
+                context.imageryTextures);
+        },
+
+        // process road network
+        [&](std::vector<std::filesystem::path> &datasetToCombine) {
+            cdb.forEachRoadNetworkTile(geoCell, threadPool, [&](const CDBGeometryVectors &roadNetwork) {
+                keepMemoryBudget(cdb);
+                addVectorToTilesetCollection(roadNetwork, roadNetworkDir, context.roadNetworkTilesets);
+            });
+            addVectorLODsToTilesetCollection(geoCell, context.roadNetworkTilesets);
+            flushTilesetCollection(geoCell, context.roadNetworkTilesets, datasetToCombine);
+        },
+
+        // process railroad network
+        [&](std::vector<std::filesystem::path> &datasetToCombine) {
+            cdb.forEachRailRoadNetworkTile(geoCell,
+                                           threadPool,
+                                           [&](const CDBGeometryVectors &railRoadNetwork) {
+                keepMemoryBudget(cdb);
+                addVectorToTilesetCollection(railRoadNetwork,
+                                             railRoadNetworkDir,
+                                             context.railRoadNetworkTilesets);
+            });
+            addVectorLODsToTilesetCollection(geoCell, context.railRoadNetworkTilesets);
+            flushTilesetCollection(geoCell, context.railRoadNetworkTilesets, datasetToCombine);
+        },
+
+        // process powerline network
+        [&](std::vector<std::filesystem::path> &datasetToCombine) {
+            cdb.forEachPowerlineNetworkTile(geoCell,
+                                            threadPool,
+                                            [&](const CDBGeometryVectors &powerlineNetwork) {
+                keepMemoryBudget(cdb);
+                addVectorToTilesetCollection(powerlineNetwork,
+                                             powerlineNetworkDir,
+                                             context.powerlineNetworkTilesets);
+            });
+            addVectorLODsToTilesetCollection(geoCell, context.powerlineNetworkTilesets);
+            flushTilesetCollection(geoCell, context.powerlineNetworkTilesets, datasetToCombine);
+        },
+
+        // process hydrography network
+        [&](std::vector<std::filesystem::path> &datasetToCombine) {
+            cdb.forEachHydrographyNetworkTile(geoCell,
+                                              threadPool,
+                                              [&](const CDBGeometryVectors &hydrographyNetwork) {
+                keepMemoryBudget(cdb);
+                addVectorToTilesetCollection(hydrographyNetwork,
+                                             hydrographyNetworkDir,
+                                             context.hydrographyNetworkTilesets);
+            });
+            addVectorLODsToTilesetCollection(geoCell, context.hydrographyNetworkTilesets);
+            flushTilesetCollection(geoCell, context.hydrographyNetworkTilesets, datasetToCombine);
+        },
+
+        // process GTModel
+        [&](std::vector<std::filesystem::path> &datasetToCombine) {
+            // the models of a tile are loaded by the pool while the tile waits for the first one
+            TaskGroup prefetchTasks(threadPool);
+            cdb.forEachGTModelTile(geoCell, threadPool, [&](CDBGTModels GTModel) {
+                keepMemoryBudget(cdb);
+                if (!threadPool.isSequential()) {
+                    GTModel.prefetchModels3D(prefetchTasks);
+                }
+
+                addGTModelToTilesetCollection(context, GTModel, GTModelDir);
+            });
+            prefetchTasks.wait();
+            flushTilesetCollection(geoCell, context.GTModelTilesets, datasetToCombine);
+        },
+
+        // process GSModel
+        [&](std::vector<std::filesystem::path> &datasetToCombine) {
+            cdb.forEachGSModelTile(geoCell, threadPool, [&](CDBGSModels GSModel) {
+                keepMemoryBudget(cdb);
+                addGSModelToTilesetCollection(context, GSModel, GSModelDir);
+            });
+            flushTilesetCollection(geoCell, context.GSModelTilesets, datasetToCombine, false);
+        },
+    };
+
+    std::vector<std::vector<std::filesystem::path>> datasetsToCombine(datasetConversions.size());
+    TaskGroup datasetTasks(threadPool);
+    for (size_t i = 0; i < datasetConversions.size(); ++i) {
+        if (!isDatasetConverted(CONVERTED_DATASETS[i])) {
+            continue;
+        }
+
+        datasetTasks.run([this, &geoCell, &datasetConversions, &datasetsToCombine, i]() {
+            ScopedTraceEvent jobEvent(getTrace(), "dataset", geoCell, CONVERTED_DATASETS[i]);
+            auto datasetStart = std::chrono::steady_clock::now();
+            datasetConversions[i](datasetsToCombine[i]);
+            if (stats) {
+                std::chrono::duration<double> datasetTime = std::chrono::steady_clock::now() - datasetStart;
+                stats->addDatasetTime(geoCell, CONVERTED_DATASETS[i], datasetTime.count());
+            }
+        });
+    }
+
+    datasetTasks.wait();
+    if (archiveSink) {
+        archiveSink->closeArchive(geoCellAbsolutePath);
+    }
+
+    if (stats) {
+        std::chrono::duration<double> geoCellTime = std::chrono::steady_clock::now() - geoCellStart;
+        stats->addGeoCellTime(geoCell, geoCellTime.count());
+    }
+
+    if (progress) {
+        progress->addGeoCellDone();
+    }
+
+    // keep the tilesets in the same order as the datasets are listed above
+    std::vector<std::filesystem::path> defaultDatasetToCombine;
+    for (auto &datasetToCombine : datasetsToCombine) {
+        defaultDatasetToCombine.insert(defaultDatasetToCombine.end(),
+                                       std::make_move_iterator(datasetToCombine.begin()),
+                                       std::make_move_iterator(datasetToCombine.end()));
+    }
+
+    return defaultDatasetToCombine;
+}
+
 Converter::Converter(const std::filesystem::path &CDBPath, const std::filesystem::path &outputPath)
 {
     m_impl = std::make_unique<Impl>(CDBPath, outputPath);
@@ -732,125 +2076,632 @@ void Converter::setElevationDecimateError(float elevationDecimateError)
     m_impl->elevationDecimateError = elevationDecimateError;
 }
 
+void Converter::setVectorLOD(bool vectorLOD)
+{
+    m_impl->vectorLOD = vectorLOD;
+}
+
+void Converter::setImplicitTiling(bool implicitTiling)
+{
+    m_impl->implicitTiling = implicitTiling;
+}
+
+void Converter::setExternalTilesetLevels(unsigned levels)
+{
+    m_impl->externalTilesetLevels = levels;
+}
+
+void Converter::setThreadCount(size_t threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    m_impl->threadCount = threadCount;
+}
+
+void Converter::setGTModelCacheMemory(size_t bytes)
+{
+    m_impl->GTModelCacheMemory = bytes;
+}
+
+void Converter::setElevationGridCacheMemory(size_t bytes)
+{
+    m_impl->elevationGridCacheMemory = bytes;
+}
+
+void Converter::setImageryEncodingMemory(size_t bytes)
+{
+    m_impl->imageryEncodingMemory = bytes;
+}
+
+void Converter::setGDALCacheMemory(size_t bytes)
+{
+    m_impl->GDALCacheMemory = bytes;
+}
+
+void Converter::setGDALThreadCount(size_t threadCount)
+{
+    m_impl->GDALThreadCount = threadCount;
+}
+
+void Converter::setGDALDatasetPoolSize(size_t datasetCount)
+{
+    m_impl->GDALDatasetPoolSize = datasetCount;
+}
+
+void Converter::setReadAheadDepth(size_t tileCount)
+{
+    m_impl->readAheadDepth = tileCount;
+}
+
+void Converter::setMaxMemory(size_t bytes)
+{
+    m_impl->maxMemory = bytes;
+}
+
+void Converter::setOutputThreadCount(size_t threadCount)
+{
+    m_impl->outputThreadCount = threadCount;
+}
+
+void Converter::setOutputQueueMemory(size_t bytes)
+{
+    m_impl->outputQueueMemory = bytes;
+}
+
+void Converter::setOutputFormat(const std::string &outputFormat)
+{
+    if (outputFormat == "directory") {
+        m_impl->archiveOutput = false;
+    } else if (outputFormat == "3tz") {
+        m_impl->archiveOutput = true;
+    } else {
+        throw std::invalid_argument("Output format must be directory or 3tz");
+    }
+}
+
+void Converter::setDeduplicateContent(bool deduplicateContent)
+{
+    m_impl->deduplicateContent = deduplicateContent;
+}
+
+void Converter::setTextureAtlasSize(unsigned size)
+{
+    if (size > 0 && size < 64) {
+        throw std::invalid_argument("Texture atlas size must be 0 or at least 64 pixels");
+    }
+
+    m_impl->textureAtlasSize = size;
+}
+
+void Converter::setGTModelBaking(size_t maxInstances, size_t maxTriangles)
+{
+    m_impl->GTModelBaking.maxInstances = maxInstances;
+    m_impl->GTModelBaking.maxTriangles = maxTriangles;
+}
+
+void Converter::setIncremental(bool incremental)
+{
+    m_impl->incremental = incremental;
+}
+
+void Converter::setOptimizeMeshes(bool optimizeMeshes)
+{
+    m_impl->optimizeMeshes = optimizeMeshes;
+}
+
+void Converter::setQuantizeVertexAttributes(bool quantizeVertexAttributes)
+{
+    m_impl->gltfEncoding.quantizeAttributes = quantizeVertexAttributes;
+}
+
+void Converter::setMeshoptCompression(bool meshoptCompression)
+{
+    m_impl->gltfEncoding.meshoptCompression = meshoptCompression;
+}
+
+void Converter::setDracoCompression(bool dracoCompression)
+{
+    m_impl->gltfEncoding.dracoCompression = dracoCompression;
+}
+
+void Converter::setDracoQuantizationBits(int positionBits, int normalBits, int UVBits)
+{
+    for (int bits : {positionBits, normalBits, UVBits}) {
+        if (bits < 1 || bits > 30) {
+            throw std::invalid_argument("Draco quantization bits must be between 1 and 30");
+        }
+    }
+
+    m_impl->gltfEncoding.dracoPositionBits = positionBits;
+    m_impl->gltfEncoding.dracoNormalBits = normalBits;
+    m_impl->gltfEncoding.dracoUVBits = UVBits;
+}
+
+void Converter::setTextureCompression(const std::string &textureCompression)
+{
+    auto compression = parseTextureCompression(textureCompression);
+    if (!compression) {
+        throw std::invalid_argument("Texture compression must be none, etc1s or uastc");
+    }
+
+    m_impl->textureCompression = *compression;
+}
+
+void Converter::setManifestPath(const std::filesystem::path &manifestPath)
+{
+    m_impl->manifestPath = manifestPath;
+}
+
+void Converter::setCollectStats(bool collectStats)
+{
+    m_impl->collectStats = collectStats;
+}
+
+void Converter::setTracePath(const std::filesystem::path &tracePath)
+{
+    m_impl->tracePath = tracePath;
+}
+
+void Converter::setProgressCallback(std::function<void(const ConversionProgress &)> callback,
+                                    double intervalSeconds)
+{
+    if (callback && intervalSeconds <= 0.0) {
+        throw std::invalid_argument("Progress interval must be positive");
+    }
+
+    m_impl->progressCallback = std::move(callback);
+    m_impl->progressInterval = intervalSeconds;
+}
+
+void Converter::setBoundingBox(double west, double south, double east, double north)
+{
+    if (south < -90.0 || north > 90.0 || south >= north) {
+        throw std::invalid_argument("Bounding box latitudes must be between -90 and 90 degrees, south first");
+    }
+
+    if (west < -180.0 || west > 180.0 || east < -180.0 || east > 180.0 || west == east) {
+        throw std::invalid_argument("Bounding box longitudes must differ, between -180 and 180 degrees");
+    }
+
+    m_impl->areaOfInterest = Core::GlobeRectangle(glm::radians(west),
+                                                  glm::radians(south),
+                                                  glm::radians(east),
+                                                  glm::radians(north));
+}
+
+void Converter::setGeoCells(const std::vector<std::string> &geoCells)
+{
+    m_impl->selectedGeoCells = geoCells;
+}
+
+void Converter::setDatasets(const std::vector<std::string> &datasets)
+{
+    for (const auto &dataset : datasets) {
+        if (m_impl->DATASET_PATHS.find(dataset) == m_impl->DATASET_PATHS.end()) {
+            throw std::invalid_argument("Unrecognized dataset: " + dataset);
+        }
+    }
+
+    m_impl->selectedDatasets = std::unordered_set<std::string>(datasets.begin(), datasets.end());
+}
+
+void Converter::setLevelRange(int minLevel, int maxLevel)
+{
+    if (minLevel < -10 || maxLevel > 23 || minLevel > maxLevel) {
+        throw std::invalid_argument("Levels must be between -10 and 23, the minimum one first");
+    }
+
+    m_impl->minLevel = minLevel;
+    m_impl->maxLevel = maxLevel;
+}
+
+void Converter::setShardGeoCells(const std::vector<std::string> &geoCells)
+{
+    m_impl->shardGeoCells = geoCells;
+}
+
+void Converter::setShard(size_t index, size_t count)
+{
+    if (count > 0 && index >= count) {
+        throw std::invalid_argument("Shard index must be less than the shard count");
+    }
+
+    m_impl->shardIndex = index;
+    m_impl->shardCount = count;
+}
+
+void Converter::writeStats(std::ostream &os) const
+{
+    if (!m_impl->stats) {
+        throw std::runtime_error("No stats were collected. Enable them before converting");
+    }
+
+    m_impl->stats->writeJson(os);
+}
+
 void Converter::convert()
 {
-    CDB cdb(m_impl->cdbPath);
-    std::map<std::string, std::vector<std::filesystem::path>> combinedTilesets;
-    std::map<std::string, std::vector<Core::BoundingRegion>> combinedTilesetsRegions;
-    std::map<std::string, Core::BoundingRegion> aggregateTilesetsRegion;
+    // phases are timed for the trace as well, so the stats are collected when tracing
+    m_impl->stats = nullptr;
+    if (!m_impl->tracePath.empty()) {
+        m_impl->stats = std::make_shared<ConversionStats>(std::make_shared<ConversionTrace>());
+    } else if (m_impl->collectStats) {
+        m_impl->stats = std::make_shared<ConversionStats>();
+    }
 
-    cdb.forEachGeoCell([&](CDBGeoCell geoCell) {
-        // create directories for converted GeoCell
-        std::filesystem::path geoCellRelativePath = geoCell.getRelativePath();
-        std::filesystem::path geoCellAbsolutePath = m_impl->outputPath / geoCellRelativePath;
-        std::filesystem::path elevationDir = geoCellAbsolutePath / Impl::ELEVATIONS_PATH;
-        std::filesystem::path GTModelDir = geoCellAbsolutePath / Impl::GTMODEL_PATH;
-        std::filesystem::path GSModelDir = geoCellAbsolutePath / Impl::GSMODEL_PATH;
-        std::filesystem::path roadNetworkDir = geoCellAbsolutePath / Impl::ROAD_NETWORK_PATH;
-        std::filesystem::path railRoadNetworkDir = geoCellAbsolutePath / Impl::RAILROAD_NETWORK_PATH;
-        std::filesystem::path powerlineNetworkDir = geoCellAbsolutePath / Impl::POWERLINE_NETWORK_PATH;
-        std::filesystem::path hydrographyNetworkDir = geoCellAbsolutePath / Impl::HYDROGRAPHY_NETWORK_PATH;
+    m_impl->progress = nullptr;
+    if (m_impl->progressCallback) {
+        auto interval = std::max(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::duration<double>(m_impl->progressInterval)),
+                                 std::chrono::milliseconds(1));
+        m_impl->progress = std::make_shared<ConversionProgressTracker>(m_impl->progressCallback, interval);
+    }
 
-        // process elevation
-        cdb.forEachElevationTile(geoCell, [&](CDBElevation elevation) {
-            m_impl->addElevationToTilesetCollection(elevation, cdb, elevationDir);
-        });
-        m_impl->flushTilesetCollection(geoCell, m_impl->elevationTilesets);
-        std::unordered_map<CDBTile, Texture>().swap(m_impl->processedParentImagery);
+    // the content of the tiles is renamed and the external tilesets are written once their tiles are, which
+    // an archive can't do after appending them
+    if (m_impl->archiveOutput && (m_impl->implicitTiling || m_impl->externalTilesetLevels > 0)) {
+        throw std::invalid_argument("3tz output does not support implicit tiling or external tilesets");
+    }
 
-        // process road network
-        cdb.forEachRoadNetworkTile(geoCell, [&](const CDBGeometryVectors &roadNetwork) {
-            m_impl->addVectorToTilesetCollection(roadNetwork, roadNetworkDir, m_impl->roadNetworkTilesets);
-        });
-        m_impl->flushTilesetCollection(geoCell, m_impl->roadNetworkTilesets);
+    // the content store is shared by every GeoCell, outside of the archive of each one
+    if (m_impl->archiveOutput && m_impl->deduplicateContent) {
+        throw std::invalid_argument("3tz output does not support deduplicated content");
+    }
 
-        // process railroad network
-        cdb.forEachRailRoadNetworkTile(geoCell, [&](const CDBGeometryVectors &railRoadNetwork) {
-            m_impl->addVectorToTilesetCollection(railRoadNetwork,
-                                                 railRoadNetworkDir,
-                                                 m_impl->railRoadNetworkTilesets);
-        });
-        m_impl->flushTilesetCollection(geoCell, m_impl->railRoadNetworkTilesets);
+    // the ledger, the shard manifests and the files written outside of the sink need a local directory
+    if (isVirtualFileSystemPath(m_impl->outputPath)
+        && (m_impl->archiveOutput || m_impl->implicitTiling || m_impl->externalTilesetLevels > 0
+            || m_impl->incremental || m_impl->isSharded())) {
+        throw std::invalid_argument("Object storage output does not support 3tz output, implicit tiling, "
+                                    "external tilesets, incremental or sharded conversions");
+    }
 
-        // process powerline network
-        cdb.forEachPowerlineNetworkTile(geoCell, [&](const CDBGeometryVectors &powerlineNetwork) {
-            m_impl->addVectorToTilesetCollection(powerlineNetwork,
-                                                 powerlineNetworkDir,
-                                                 m_impl->powerlineNetworkTilesets);
-        });
-        m_impl->flushTilesetCollection(geoCell, m_impl->powerlineNetworkTilesets);
+    nlohmann::json ledger = nlohmann::json::object();
+    if (m_impl->incremental) {
+        ledger = m_impl->readLedger();
+    }
 
-        // process hydrography network
-        cdb.forEachHydrographyNetworkTile(geoCell, [&](const CDBGeometryVectors &hydrographyNetwork) {
-            m_impl->addVectorToTilesetCollection(hydrographyNetwork,
-                                                 hydrographyNetworkDir,
-                                                 m_impl->hydrographyNetworkTilesets);
-        });
-        m_impl->flushTilesetCollection(geoCell, m_impl->hydrographyNetworkTilesets);
+    // directory listings are shared by every GeoCell and reused from the manifest of the previous run
+    m_impl->manifest = std::make_shared<CDBManifest>(m_impl->cdbPath);
+    if (!m_impl->manifestPath.empty()) {
+        m_impl->manifest->read(m_impl->manifestPath);
+    }
 
-        // process GTModel
-        cdb.forEachGTModelTile(geoCell, [&](CDBGTModels GTModel) {
-            m_impl->addGTModelToTilesetCollection(GTModel, GTModelDir);
-        });
-        m_impl->flushTilesetCollection(geoCell, m_impl->GTModelTilesets);
+    size_t GTModelCacheMemory = m_impl->getCacheMemory(m_impl->GTModelCacheMemory, 4);
+    m_impl->GTModelCache = std::make_shared<CDBGTModelCache>(m_impl->cdbPath,
+                                                             m_impl->manifest,
+                                                             GTModelCacheMemory);
+
+    // the rasters are opened from the pool by every GeoCell, and their decoded blocks go to the GDAL cache
+    m_impl->datasetPool = std::make_shared<GDALDatasetPool>(m_impl->GDALDatasetPoolSize);
+    size_t GDALCacheMemory = m_impl->getCacheMemory(m_impl->GDALCacheMemory, 8);
+    ScopedGDALSettings GDALSettings(GDALCacheMemory, m_impl->GDALThreadCount);
+
+    // a shard only converts its GeoCells, but keeps their position among all of them for the merge
+    std::vector<CDBGeoCell> geoCells;
+    std::vector<size_t> geoCellIndices;
+    std::unordered_set<std::string> geoCellNames;
+    CDB cdb(m_impl->cdbPath, m_impl->manifest, m_impl->GTModelCache);
+    m_impl->selectTiles(cdb);
+
+    size_t selectedGeoCellCount = 0;
+    for (const auto &geoCell : cdb.getGeoCells()) {
+        geoCellNames.insert(getGeoCellName(geoCell));
+        if (!m_impl->isGeoCellSelected(geoCell)) {
+            continue;
+        }
 
-        // process GSModel
-        cdb.forEachGSModelTile(geoCell, [&](CDBGSModels GSModel) {
-            m_impl->addGSModelToTilesetCollection(GSModel, GSModelDir);
+        if (m_impl->isInShard(geoCell)) {
+            geoCells.emplace_back(geoCell);
+            geoCellIndices.emplace_back(selectedGeoCellCount);
+        }
+
+        ++selectedGeoCellCount;
+    }
+
+    std::vector<std::string> requestedGeoCells = m_impl->selectedGeoCells;
+    requestedGeoCells.insert(
+        requestedGeoCells.end(), m_impl->shardGeoCells.begin(), m_impl->shardGeoCells.end());
+    for (const auto &requestedGeoCell : requestedGeoCells) {
+        if (geoCellNames.find(requestedGeoCell) == geoCellNames.end()) {
+            throw std::invalid_argument("GeoCell " + requestedGeoCell
+                                        + " is not in the CDB or outside of the bounding box");
+        }
+    }
+
+    // the previous output can only be kept if it was converted with the same options
+    nlohmann::json conversionOptions;
+    if (m_impl->incremental) {
+        conversionOptions = m_impl->getConversionOptions(cdb);
+        if (ledger.value("options", nlohmann::json()) != conversionOptions) {
+            ledger = nlohmann::json::object();
+        }
+    }
+
+    // the other shards write to the same output directory, so a shard only removes its own GeoCells
+    if (ledger.empty() && !m_impl->isSharded() && std::filesystem::exists(m_impl->outputPath)) {
+        std::filesystem::remove_all(m_impl->outputPath);
+    }
+
+    // each GeoCell is written to its own output subtree, so they can be converted independently
+    const nlohmann::json previousGeoCells = ledger.value("geoCells", nlohmann::json::object());
+    std::vector<std::vector<std::filesystem::path>> geoCellTilesetJsonPaths(geoCells.size());
+    std::vector<uint64_t> geoCellFingerprints(geoCells.size(), 0);
+    m_impl->outputSink = m_impl->createOutputSink();
+    if (m_impl->deduplicateContent) {
+        m_impl->contentStore = std::make_unique<ContentStore>(*m_impl->outputSink,
+                                                              m_impl->outputPath / Impl::CONTENT_STORE_PATH);
+    }
+
+    // the reports started below stop when the conversion throws, instead of going on until the converter is
+    // destroyed. The thread pool is joined first, so no worker counts a tile afterwards
+    ScopedProgressCancel progressCancel(m_impl->progress.get());
+    {
+        ThreadPool threadPool(m_impl->threadCount);
+
+        // the tiles of every GeoCell are counted before any is converted, so the progress has its totals from
+        // the start. The listings are kept by the manifest and reused by the conversion
+        std::vector<std::vector<uint64_t>> geoCellTileCounts;
+        if (m_impl->progress) {
+            geoCellTileCounts.resize(geoCells.size());
+            TaskGroup countTasks(threadPool);
+            for (size_t i = 0; i < geoCells.size(); ++i) {
+                countTasks.run([&, i]() {
+                    for (CDBDataset dataset : CONVERTED_DATASETS) {
+                        geoCellTileCounts[i].emplace_back(m_impl->isDatasetConverted(dataset)
+                                                              ? cdb.getDatasetTileCount(geoCells[i], dataset)
+                                                              : 0);
+                    }
+                });
+            }
+
+            countTasks.wait();
+            for (const auto &tileCounts : geoCellTileCounts) {
+                for (size_t i = 0; i < tileCounts.size(); ++i) {
+                    m_impl->progress->addTotalTiles(CONVERTED_DATASETS[i], tileCounts[i]);
+                }
+            }
+
+            m_impl->progress->setTotalGeoCells(geoCells.size());
+            m_impl->progress->start();
+        }
+
+        // under a memory budget, the next GeoCell waits for the ones in flight to free their memory, and the
+        // GeoCells in flight drop their caches and write their queued files out while it is exceeded
+        auto &memoryBudget = m_impl->memoryBudget;
+        memoryBudget = nullptr;
+        if (m_impl->maxMemory > 0) {
+            memoryBudget = std::make_unique<MemoryBudget>(m_impl->maxMemory);
+        }
+
+        TaskGroup geoCellTasks(threadPool);
+        for (size_t i = 0; i < geoCells.size(); ++i) {
+            if (memoryBudget) {
+                memoryBudget->acquireGeoCell(threadPool);
+            }
+
+            geoCellTasks.run([&, i]() {
+                ScopedGeoCellRelease geoCellRelease(memoryBudget.get());
+                const auto &geoCell = geoCells[i];
+                if (m_impl->incremental) {
+                    // skip the GeoCell if none of its sources changed since the previous run
+                    geoCellFingerprints[i] = cdb.getGeoCellFingerprint(geoCell);
+                    auto previous = previousGeoCells.find(geoCell.getRelativePath().string());
+                    if (previous != previousGeoCells.end() && previous->contains("tilesets")
+                        && previous->value("fingerprint", nlohmann::json()) == geoCellFingerprints[i]) {
+                        for (const auto &tilesetJsonPath : previous->at("tilesets")) {
+                            geoCellTilesetJsonPaths[i].emplace_back(tilesetJsonPath.get<std::string>());
+                        }
+
+                        // the kept GeoCell is not part of the work left, so it doesn't skew the estimate
+                        if (m_impl->progress) {
+                            const auto &tileCounts = geoCellTileCounts[i];
+                            for (size_t j = 0; j < tileCounts.size(); ++j) {
+                                m_impl->progress->removeTotalTiles(CONVERTED_DATASETS[j], tileCounts[j]);
+                            }
+
+                            m_impl->progress->addGeoCellDone();
+                        }
+
+                        return;
+                    }
+                }
+
+                if (m_impl->incremental || m_impl->isSharded()) {
+                    auto geoCellRelativePath = geoCell.getRelativePath();
+                    std::filesystem::remove_all(m_impl->outputPath / geoCellRelativePath);
+                    std::filesystem::remove(m_impl->getGeoCellArchivePath(geoCellRelativePath.string()));
+                }
+
+                geoCellTilesetJsonPaths[i] = m_impl->convertGeoCell(geoCell, threadPool);
+            });
+        }
+
+        geoCellTasks.wait();
+        memoryBudget = nullptr;
+    }
+
+    // the GeoCells are done, so an error in their files is reported before they are combined
+    m_impl->outputSink->flush();
+
+    // the workers are joined, so every event is recorded
+    if (!m_impl->tracePath.empty()) {
+        std::ofstream fs(m_impl->tracePath);
+        m_impl->stats->getTrace()->writeJson(fs);
+    }
+
+    // remove what the previous run wrote for GeoCells that are gone and the combined tilesets that are
+    // written again below
+    for (auto previous = previousGeoCells.begin(); previous != previousGeoCells.end(); ++previous) {
+        bool isRemoved = std::none_of(geoCells.begin(), geoCells.end(), [&](const CDBGeoCell &geoCell) {
+            return geoCell.getRelativePath().string() == previous.key();
         });
-        m_impl->flushTilesetCollection(geoCell, m_impl->GSModelTilesets, false);
 
-        // get the converted dataset in each geocell to be combine at the end
-        Core::BoundingRegion geoCellRegion = CDBTile::calcBoundRegion(geoCell, -10, 0, 0);
-        for (auto tilesetJsonPath : m_impl->defaultDatasetToCombine) {
-            auto componentSelectors = tilesetJsonPath.parent_path().filename().string();
-            auto dataset = tilesetJsonPath.parent_path().parent_path().filename().string();
-            auto combinedTilesetName = dataset + "_" + componentSelectors;
+        if (isRemoved) {
+            std::filesystem::remove_all(m_impl->outputPath / previous.key());
+            std::filesystem::remove(m_impl->getGeoCellArchivePath(previous.key()));
+        }
+    }
 
-            combinedTilesets[combinedTilesetName].emplace_back(tilesetJsonPath);
-            combinedTilesetsRegions[combinedTilesetName].emplace_back(geoCellRegion);
-            auto tilesetAggregateRegion = aggregateTilesetsRegion.find(combinedTilesetName);
-            if (tilesetAggregateRegion == aggregateTilesetsRegion.end()) {
-                aggregateTilesetsRegion.insert({combinedTilesetName, geoCellRegion});
-            } else {
-                tilesetAggregateRegion->second = tilesetAggregateRegion->second.computeUnion(geoCellRegion);
+    for (const auto &combinedTileset : ledger.value("combinedTilesets", nlohmann::json::array())) {
+        std::filesystem::remove(m_impl->outputPath / combinedTileset.get<std::string>());
+    }
+
+    if (!m_impl->manifestPath.empty() && m_impl->manifest->isModified()) {
+        m_impl->manifest->write(m_impl->manifestPath);
+    }
+
+    std::vector<Impl::GeoCellTilesets> geoCellTilesets;
+    for (size_t i = 0; i < geoCells.size(); ++i) {
+        geoCellTilesets.push_back(Impl::GeoCellTilesets{getGeoCellName(geoCells[i]),
+                                                        geoCellIndices[i],
+                                                        CDBTile::calcBoundRegion(geoCells[i], -10, 0, 0),
+                                                        geoCellTilesetJsonPaths[i]});
+    }
+
+    // a shard leaves the combined tilesets to the merge of every shard
+    std::vector<std::string> combinedTilesetNames;
+    if (m_impl->isSharded()) {
+        m_impl->writeShardManifest(geoCellTilesets);
+    } else {
+        combinedTilesetNames = m_impl->combineTilesets(geoCellTilesets);
+    }
+
+    if (m_impl->incremental) {
+        nlohmann::json convertedGeoCells = nlohmann::json::object();
+        for (size_t i = 0; i < geoCells.size(); ++i) {
+            nlohmann::json tilesets = nlohmann::json::array();
+            for (const auto &tilesetJsonPath : geoCellTilesetJsonPaths[i]) {
+                tilesets.emplace_back(tilesetJsonPath.string());
             }
+
+            auto &convertedGeoCell = convertedGeoCells[geoCells[i].getRelativePath().string()];
+            convertedGeoCell["fingerprint"] = geoCellFingerprints[i];
+            convertedGeoCell["tilesets"] = tilesets;
         }
-        std::vector<std::filesystem::path>().swap(m_impl->defaultDatasetToCombine);
-    });
 
-    // combine all the default tileset in each geocell into a global one
-    for (auto tileset : combinedTilesets) {
-        std::ofstream fs(m_impl->outputPath / (tileset.first + ".json"));
-        combineTilesetJson(tileset.second, combinedTilesetsRegions[tileset.first], fs);
+        nlohmann::json newLedger;
+        newLedger["version"] = Impl::LEDGER_VERSION;
+        newLedger["options"] = conversionOptions;
+        newLedger["geoCells"] = convertedGeoCells;
+        newLedger["combinedTilesets"] = combinedTilesetNames;
+        m_impl->writeLedger(newLedger);
     }
 
-    // combine the requested tilesets
-    for (const auto &tilesets : m_impl->requestedDatasetToCombine) {
-        std::string combinedTilesetName;
-        if (m_impl->requestedDatasetToCombine.size() > 1) {
-            for (const auto &tileset : tilesets) {
-                combinedTilesetName += tileset;
+    m_impl->outputSink->flush();
+    m_impl->contentStore = nullptr;
+    m_impl->outputSink = nullptr;
+
+    if (m_impl->progress) {
+        m_impl->progress->stop();
+    }
+}
+
+void Converter::merge()
+{
+    // shard manifests are read in name order, so that a conflict is reported the same way on every run
+    auto shardsDirectory = m_impl->outputPath / Impl::SHARDS_PATH;
+    std::vector<std::filesystem::path> shardManifestPaths;
+    if (std::filesystem::is_directory(shardsDirectory)) {
+        for (const auto &entry : std::filesystem::directory_iterator(shardsDirectory)) {
+            auto filename = entry.path().filename().string();
+            bool isLedger = filename.size() > Impl::LEDGER_FILE.size()
+                            && filename.compare(filename.size() - Impl::LEDGER_FILE.size(),
+                                                Impl::LEDGER_FILE.size(),
+                                                Impl::LEDGER_FILE)
+                                   == 0;
+            if (entry.path().extension() == ".json" && !isLedger) {
+                shardManifestPaths.emplace_back(entry.path());
             }
-            combinedTilesetName += ".json";
-        } else {
-            combinedTilesetName = "tileset.json";
         }
+    }
 
-        std::vector<std::filesystem::path> existTilesets;
-        std::vector<Core::BoundingRegion> regions;
-        regions.reserve(tilesets.size());
-        for (const auto &tileset : tilesets) {
-            auto tilesetRegion = aggregateTilesetsRegion.find(tileset);
-            if (tilesetRegion != aggregateTilesetsRegion.end()) {
-                existTilesets.emplace_back(tilesetRegion->first + ".json");
-                regions.emplace_back(tilesetRegion->second);
+    if (shardManifestPaths.empty()) {
+        throw std::runtime_error("No shard manifest in " + shardsDirectory.string());
+    }
+
+    std::sort(shardManifestPaths.begin(), shardManifestPaths.end());
+    std::vector<Impl::GeoCellTilesets> geoCellTilesets;
+    std::unordered_set<size_t> geoCellIndices;
+    std::map<size_t, std::set<size_t>> shardCountToIndices;
+    for (const auto &shardManifestPath : shardManifestPaths) {
+        std::ifstream fs(shardManifestPath);
+        nlohmann::json shardManifest = nlohmann::json::parse(fs, nullptr, false);
+        if (shardManifest.is_discarded() || !shardManifest.is_object()
+            || shardManifest.value("version", 0u) != Impl::SHARD_MANIFEST_VERSION) {
+            throw std::runtime_error("Shard manifest " + shardManifestPath.string() + " can't be read");
+        }
+
+        if (shardManifest.contains("shard")) {
+            const auto &shard = shardManifest["shard"];
+            shardCountToIndices[shard["count"].get<size_t>()].insert(shard["index"].get<size_t>());
+        }
+
+        for (const auto &geoCell : shardManifest["geoCells"]) {
+            std::string name = geoCell["name"].get<std::string>();
+            size_t index = geoCell["index"].get<size_t>();
+            if (!geoCellIndices.insert(index).second) {
+                throw std::runtime_error("GeoCell " + name + " is converted by more than one shard");
+            }
+
+            const auto &region = geoCell["region"];
+            Core::GlobeRectangle rectangle(region[0].get<double>(),
+                                           region[1].get<double>(),
+                                           region[2].get<double>(),
+                                           region[3].get<double>());
+            std::vector<std::filesystem::path> tilesetJsonPaths;
+            for (const auto &tilesetJsonPath : geoCell["tilesets"]) {
+                tilesetJsonPaths.emplace_back(tilesetJsonPath.get<std::string>());
+            }
+
+            geoCellTilesets.push_back(
+                Impl::GeoCellTilesets{name,
+                                      index,
+                                      Core::BoundingRegion(rectangle,
+                                                           region[4].get<double>(),
+                                                           region[5].get<double>()),
+                                      std::move(tilesetJsonPaths)});
+        }
+    }
+
+    // a missing hash shard would silently leave its GeoCells out of the combined tilesets
+    for (const auto &shardIndices : shardCountToIndices) {
+        for (size_t i = 0; i < shardIndices.first; ++i) {
+            if (shardIndices.second.find(i) == shardIndices.second.end()) {
+                throw std::runtime_error("Shard " + std::to_string(i) + " of "
+                                         + std::to_string(shardIndices.first) + " is missing");
             }
         }
+    }
+
+    std::sort(geoCellTilesets.begin(),
+              geoCellTilesets.end(),
+              [](const Impl::GeoCellTilesets &lhs, const Impl::GeoCellTilesets &rhs) {
+                  return lhs.index < rhs.index;
+              });
+    m_impl->outputSink = m_impl->createOutputSink();
+    m_impl->combineTilesets(geoCellTilesets);
+    m_impl->outputSink->flush();
+    m_impl->outputSink = nullptr;
+}
+
+static std::string getGeoCellName(const CDBGeoCell &geoCell)
+{
+    return geoCell.getLatitudeDirectoryName() + geoCell.getLongitudeDirectoryName();
+}
 
-        std::ofstream fs(m_impl->outputPath / combinedTilesetName);
-        combineTilesetJson(existTilesets, regions, fs);
+static uint64_t hashGeoCellName(const std::string &name)
+{
+    // FNV-1a, so that every node of a cluster assigns a GeoCell to the same shard
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
     }
+
+    return hash;
 }
 
 USE_OSGPLUGIN(png)
@@ -859,10 +2710,22 @@ USE_OSGPLUGIN(zip)
 USE_OSGPLUGIN(rgb)
 USE_OSGPLUGIN(OpenFlight)
 
+static void setDefaultConfigOption(const char *key, const char *value)
+{
+    if (!CPLGetConfigOption(key, nullptr)) {
+        CPLSetConfigOption(key, value);
+    }
+}
+
 GlobalInitializer::GlobalInitializer()
 {
     GDALAllRegister();
     CPLSetConfigOption("GDAL_PAM_ENABLED", "NO");
+
+    // a CDB in object storage is read in many small reads per tile, so fetch 1 MB blocks and keep the last
+    // 256 MB of them instead of sending a request for each read. The environment can still override both
+    setDefaultConfigOption("CPL_VSIL_CURL_CHUNK_SIZE", "1048576");
+    setDefaultConfigOption("CPL_VSIL_CURL_CACHE_SIZE", "268435456");
 }
 
 GlobalInitializer::~GlobalInitializer() noexcept
@@ -0,0 +1,128 @@
+#include "ContentStore.h"
+#include <cstdio>
+
+namespace CDBTo3DTiles {
+static constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+static constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+static constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+static uint64_t rotateLeft(uint64_t value, int bits) noexcept;
+
+static uint64_t readUint64(const unsigned char *data) noexcept;
+
+static uint32_t readUint32(const unsigned char *data) noexcept;
+
+static uint64_t XXH64Round(uint64_t accumulator, uint64_t input) noexcept;
+
+static uint64_t XXH64MergeRound(uint64_t hash, uint64_t accumulator) noexcept;
+
+uint64_t computeXXH64(const unsigned char *data, size_t size, uint64_t seed) noexcept
+{
+    const unsigned char *end = data + size;
+    uint64_t hash;
+    if (size >= 32) {
+        // four lanes consume the stripes of 32 bytes independently, then are folded together
+        uint64_t accumulators[4] = {seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1};
+        for (; data + 32 <= end; data += 32) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                accumulators[lane] = XXH64Round(accumulators[lane], readUint64(data + 8 * lane));
+            }
+        }
+
+        hash = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7)
+               + rotateLeft(accumulators[2], 12) + rotateLeft(accumulators[3], 18);
+        for (uint64_t accumulator : accumulators) {
+            hash = XXH64MergeRound(hash, accumulator);
+        }
+    } else {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+    for (; data + 8 <= end; data += 8) {
+        hash ^= XXH64Round(0, readUint64(data));
+        hash = rotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+
+    if (data + 4 <= end) {
+        hash ^= static_cast<uint64_t>(readUint32(data)) * PRIME64_1;
+        hash = rotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+        data += 4;
+    }
+
+    for (; data < end; ++data) {
+        hash ^= static_cast<uint64_t>(*data) * PRIME64_5;
+        hash = rotateLeft(hash, 11) * PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+ContentStore::ContentStore(OutputSink &sink, const std::filesystem::path &directory)
+    : m_sink{sink}
+    , m_directory{directory}
+{
+    m_sink.createDirectories(m_directory);
+}
+
+std::filesystem::path ContentStore::store(std::vector<unsigned char> data,
+                                          const std::string &extension,
+                                          bool &isWritten)
+{
+    // the length is part of the name, so two contents only share a file if their hashes collide at the same
+    // length as well
+    char hash[17];
+    std::snprintf(hash,
+                  sizeof(hash),
+                  "%016llx",
+                  static_cast<unsigned long long>(computeXXH64(data.data(), data.size())));
+    std::string filename = std::string(hash) + "_" + std::to_string(data.size()) + extension;
+    auto path = m_directory / filename;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        isWritten = m_filenames.insert(filename).second;
+    }
+
+    if (isWritten) {
+        m_sink.write(path, std::move(data));
+    }
+
+    return path;
+}
+
+uint64_t rotateLeft(uint64_t value, int bits) noexcept
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t readUint64(const unsigned char *data) noexcept
+{
+    return static_cast<uint64_t>(readUint32(data)) | static_cast<uint64_t>(readUint32(data + 4)) << 32;
+}
+
+uint32_t readUint32(const unsigned char *data) noexcept
+{
+    return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8
+           | static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+uint64_t XXH64Round(uint64_t accumulator, uint64_t input) noexcept
+{
+    accumulator += input * PRIME64_2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+uint64_t XXH64MergeRound(uint64_t hash, uint64_t accumulator) noexcept
+{
+    hash ^= XXH64Round(0, accumulator);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+} // namespace CDBTo3DTiles
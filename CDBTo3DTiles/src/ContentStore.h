@@ -0,0 +1,40 @@
+#pragma once
+
+#include "OutputSink.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace CDBTo3DTiles {
+// the 64-bit xxHash of the bytes
+uint64_t computeXXH64(const unsigned char *data, size_t size, uint64_t seed = 0) noexcept;
+
+// writes each distinct content once to the directory of the store, named after the xxHash and the length of
+// its bytes, so every tile whose content has the same bytes references the same file
+class ContentStore
+{
+public:
+    // the directory is created through the sink
+    ContentStore(OutputSink &sink, const std::filesystem::path &directory);
+
+    ContentStore(const ContentStore &) = delete;
+
+    ContentStore &operator=(const ContentStore &) = delete;
+
+    inline const std::filesystem::path &getDirectory() const noexcept { return m_directory; }
+
+    // the path of the content in the store. The content is only handed over to the sink the first time it is
+    // stored, which isWritten tells
+    std::filesystem::path store(std::vector<unsigned char> data, const std::string &extension, bool &isWritten);
+
+private:
+    OutputSink &m_sink;
+    std::filesystem::path m_directory;
+    std::mutex m_mutex;
+    std::unordered_set<std::string> m_filenames;
+};
+} // namespace CDBTo3DTiles
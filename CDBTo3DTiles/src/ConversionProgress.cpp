@@ -0,0 +1,154 @@
+#include "ConversionProgress.h"
+#include <algorithm>
+
+namespace CDBTo3DTiles {
+static double toSeconds(std::chrono::steady_clock::duration duration);
+
+ConversionProgressTracker::ConversionProgressTracker(Callback callback, std::chrono::milliseconds interval)
+    : m_callback{std::move(callback)}
+    , m_interval{interval}
+    , m_geoCellsDone{0}
+    , m_geoCellsTotal{0}
+    , m_bytesWritten{0}
+    , m_start{std::chrono::steady_clock::now()}
+    , m_lastTileDone{m_start}
+    , m_isStopped{false}
+{}
+
+ConversionProgressTracker::~ConversionProgressTracker() noexcept
+{
+    joinReporter();
+}
+
+void ConversionProgressTracker::addTotalTiles(CDBDataset dataset, uint64_t tiles)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_datasets[dataset].total += tiles;
+}
+
+void ConversionProgressTracker::removeTotalTiles(CDBDataset dataset, uint64_t tiles)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &datasetTiles = m_datasets[dataset];
+    datasetTiles.total -= std::min(tiles, datasetTiles.total);
+}
+
+void ConversionProgressTracker::setTotalGeoCells(uint64_t geoCells)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_geoCellsTotal = geoCells;
+}
+
+void ConversionProgressTracker::addTileDone(CDBDataset dataset)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_datasets[dataset].done;
+    m_lastTileDone = std::chrono::steady_clock::now();
+}
+
+void ConversionProgressTracker::addGeoCellDone()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_geoCellsDone;
+}
+
+void ConversionProgressTracker::addBytesWritten(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bytesWritten += bytes;
+}
+
+ConversionProgress ConversionProgressTracker::getProgress() const
+{
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ConversionProgress progress;
+    progress.datasets.reserve(m_datasets.size());
+    for (const auto &datasetTiles : m_datasets) {
+        ConversionProgress::Dataset dataset;
+        dataset.name = getCDBDatasetDirectoryName(datasetTiles.first);
+        dataset.tilesDone = datasetTiles.second.done;
+        dataset.tilesTotal = datasetTiles.second.total;
+        progress.datasets.emplace_back(dataset);
+        progress.tilesDone += dataset.tilesDone;
+        progress.tilesTotal += dataset.tilesTotal;
+    }
+
+    progress.geoCellsDone = m_geoCellsDone;
+    progress.geoCellsTotal = m_geoCellsTotal;
+    progress.bytesWritten = m_bytesWritten;
+    progress.elapsedSeconds = toSeconds(now - m_start);
+    progress.secondsSinceLastTile = toSeconds(now - m_lastTileDone);
+
+    // tiles of every dataset are assumed to take the same time, which holds well enough over a whole CDB
+    if (progress.tilesDone > 0) {
+        uint64_t tilesLeft = progress.tilesTotal - std::min(progress.tilesDone, progress.tilesTotal);
+        progress.remainingSeconds = progress.elapsedSeconds * static_cast<double>(tilesLeft)
+                                    / static_cast<double>(progress.tilesDone);
+    }
+
+    return progress;
+}
+
+void ConversionProgressTracker::start()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_start = std::chrono::steady_clock::now();
+        m_lastTileDone = m_start;
+    }
+
+    m_isStopped = false;
+    m_reporter = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(m_reporterMutex);
+        while (!m_reporterCondition.wait_for(lock, m_interval, [this]() { return m_isStopped; })) {
+            lock.unlock();
+            m_callback(getProgress());
+            lock.lock();
+        }
+    });
+}
+
+void ConversionProgressTracker::stop()
+{
+    joinReporter();
+    m_callback(getProgress());
+}
+
+void ConversionProgressTracker::cancel() noexcept
+{
+    joinReporter();
+}
+
+void ConversionProgressTracker::joinReporter() noexcept
+{
+    if (!m_reporter.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_reporterMutex);
+        m_isStopped = true;
+    }
+
+    m_reporterCondition.notify_all();
+    m_reporter.join();
+}
+
+ScopedProgressCancel::ScopedProgressCancel(ConversionProgressTracker *tracker) noexcept
+    : m_tracker{tracker}
+{}
+
+ScopedProgressCancel::~ScopedProgressCancel() noexcept
+{
+    if (m_tracker) {
+        m_tracker->cancel();
+    }
+}
+
+double toSeconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+} // namespace CDBTo3DTiles
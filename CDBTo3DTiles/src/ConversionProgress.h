@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CDBDataset.h"
+#include "CDBTo3DTiles.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace CDBTo3DTiles {
+// counts the tiles converted out of the tiles listed for each dataset, and reports them from its own thread
+// every interval. Reports keep coming while the workers are stuck, so the time since the last tile tells how
+// long nothing finished. The callback is only called by one thread at a time
+class ConversionProgressTracker
+{
+public:
+    using Callback = std::function<void(const ConversionProgress &)>;
+
+    ConversionProgressTracker(Callback callback, std::chrono::milliseconds interval);
+
+    ConversionProgressTracker(const ConversionProgressTracker &) = delete;
+
+    ConversionProgressTracker &operator=(const ConversionProgressTracker &) = delete;
+
+    ~ConversionProgressTracker() noexcept;
+
+    void addTotalTiles(CDBDataset dataset, uint64_t tiles);
+
+    // tiles of GeoCells that are not converted, e.g. kept from an incremental conversion
+    void removeTotalTiles(CDBDataset dataset, uint64_t tiles);
+
+    void setTotalGeoCells(uint64_t geoCells);
+
+    void addTileDone(CDBDataset dataset);
+
+    void addGeoCellDone();
+
+    void addBytesWritten(uint64_t bytes);
+
+    ConversionProgress getProgress() const;
+
+    // starts the clock and the reports
+    void start();
+
+    // reports one last time once the reports are stopped
+    void stop();
+
+    // stops the reports without the last one, e.g. when the conversion failed
+    void cancel() noexcept;
+
+private:
+    struct DatasetTiles
+    {
+        uint64_t done = 0;
+        uint64_t total = 0;
+    };
+
+    void joinReporter() noexcept;
+
+    Callback m_callback;
+    std::chrono::milliseconds m_interval;
+    mutable std::mutex m_mutex;
+    std::map<CDBDataset, DatasetTiles> m_datasets;
+    uint64_t m_geoCellsDone;
+    uint64_t m_geoCellsTotal;
+    uint64_t m_bytesWritten;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_lastTileDone;
+    std::mutex m_reporterMutex;
+    std::condition_variable m_reporterCondition;
+    bool m_isStopped;
+    std::thread m_reporter;
+};
+
+// cancels the reports of the tracker when the conversion leaves its scope, even when it throws. Does nothing
+// once the tracker is stopped, or without a tracker
+class ScopedProgressCancel
+{
+public:
+    explicit ScopedProgressCancel(ConversionProgressTracker *tracker) noexcept;
+
+    ScopedProgressCancel(const ScopedProgressCancel &) = delete;
+
+    ScopedProgressCancel &operator=(const ScopedProgressCancel &) = delete;
+
+    ~ScopedProgressCancel() noexcept;
+
+private:
+    ConversionProgressTracker *m_tracker;
+};
+} // namespace CDBTo3DTiles
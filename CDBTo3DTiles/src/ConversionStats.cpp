@@ -0,0 +1,383 @@
+#include "ConversionStats.h"
+#include "nlohmann/json.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <fstream>
+#include <unistd.h>
+#endif
+
+namespace CDBTo3DTiles {
+static const uint32_t STATS_VERSION = 1;
+
+static const char *PHASE_CATEGORY = "phase";
+
+static double toSeconds(std::chrono::steady_clock::duration duration);
+
+#ifdef _WIN32
+static double fileTimeToSeconds(const FILETIME &fileTime);
+#endif
+
+static std::string getGeoCellName(int latitude, int longitude);
+
+static nlohmann::json convertPhasesToJson(const ConversionStats::Phases &phases);
+
+static void addDatasetToTotal(const ConversionStats::Dataset &dataset, ConversionStats::Dataset &total);
+
+static void writeDatasetTotalToJson(const ConversionStats::Dataset &total, nlohmann::json &json);
+
+const char *conversionPhaseToString(ConversionPhase phase)
+{
+    switch (phase) {
+    case ConversionPhase::FileDiscovery:
+        return "fileDiscovery";
+    case ConversionPhase::Decode:
+        return "decode";
+    case ConversionPhase::MeshSimplification:
+        return "meshSimplification";
+    case ConversionPhase::NormalGeneration:
+        return "normalGeneration";
+    case ConversionPhase::ImageryEncoding:
+        return "imageryEncoding";
+    case ConversionPhase::GltfBuild:
+        return "gltfBuild";
+    case ConversionPhase::TileWrite:
+        return "tileWrite";
+    case ConversionPhase::TilesetWrite:
+        return "tilesetWrite";
+    default:
+        return "";
+    }
+}
+
+ConversionStats::ConversionStats(std::shared_ptr<ConversionTrace> trace)
+    : m_trace{std::move(trace)}
+    , m_start{std::chrono::steady_clock::now()}
+    , m_startCPUSeconds{getProcessCPUSeconds()}
+{}
+
+void ConversionStats::addPhase(const CDBGeoCell &geoCell,
+                               CDBDataset dataset,
+                               ConversionPhase phase,
+                               double wallSeconds,
+                               double CPUSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &datasetPhase = getDatasetLocked(geoCell, dataset).phases[static_cast<size_t>(phase)];
+    ++datasetPhase.count;
+    datasetPhase.wallSeconds += wallSeconds;
+    datasetPhase.CPUSeconds += CPUSeconds;
+}
+
+void ConversionStats::addDatasetTime(const CDBGeoCell &geoCell, CDBDataset dataset, double wallSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    getDatasetLocked(geoCell, dataset).wallSeconds += wallSeconds;
+}
+
+void ConversionStats::addGeoCellTime(const CDBGeoCell &geoCell, double wallSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_geoCellWallSeconds[{geoCell.getLatitude(), geoCell.getLongitude()}] += wallSeconds;
+}
+
+void ConversionStats::addTile(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &datasetStats = getDatasetLocked(geoCell, dataset);
+    ++datasetStats.tiles;
+    datasetStats.bytesOut += bytes;
+}
+
+void ConversionStats::addBytesIn(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    getDatasetLocked(geoCell, dataset).bytesIn += bytes;
+}
+
+void ConversionStats::addBytesOut(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    getDatasetLocked(geoCell, dataset).bytesOut += bytes;
+}
+
+ConversionStats::Dataset ConversionStats::getDataset(const CDBGeoCell &geoCell, CDBDataset dataset) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto datasetStats = m_datasets.find({geoCell.getLatitude(), geoCell.getLongitude(), dataset});
+    if (datasetStats == m_datasets.end()) {
+        return Dataset();
+    }
+
+    return datasetStats->second;
+}
+
+void ConversionStats::writeJson(std::ostream &os) const
+{
+    double wallSeconds = toSeconds(std::chrono::steady_clock::now() - m_start);
+    double CPUSeconds = getProcessCPUSeconds() - m_startCPUSeconds;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Dataset total;
+    std::map<std::tuple<int, int>, Dataset> geoCellTotals;
+    nlohmann::json geoCells = nlohmann::json::object();
+    for (const auto &datasetStats : m_datasets) {
+        int latitude = std::get<0>(datasetStats.first);
+        int longitude = std::get<1>(datasetStats.first);
+        auto datasetName = getCDBDatasetDirectoryName(std::get<2>(datasetStats.first));
+        auto &datasetJson = geoCells[getGeoCellName(latitude, longitude)]["datasets"][datasetName];
+
+        const auto &dataset = datasetStats.second;
+        datasetJson["wallSeconds"] = dataset.wallSeconds;
+        datasetJson["tiles"] = dataset.tiles;
+        datasetJson["tilesPerSecond"] = dataset.wallSeconds > 0.0
+                                            ? static_cast<double>(dataset.tiles) / dataset.wallSeconds
+                                            : 0.0;
+        datasetJson["bytesIn"] = dataset.bytesIn;
+        datasetJson["bytesOut"] = dataset.bytesOut;
+        datasetJson["phases"] = convertPhasesToJson(dataset.phases);
+
+        addDatasetToTotal(dataset, geoCellTotals[{latitude, longitude}]);
+        addDatasetToTotal(dataset, total);
+    }
+
+    for (const auto &geoCellTotal : geoCellTotals) {
+        auto geoCellName = getGeoCellName(std::get<0>(geoCellTotal.first), std::get<1>(geoCellTotal.first));
+        auto &geoCellJson = geoCells[geoCellName];
+        auto geoCellWallSeconds = m_geoCellWallSeconds.find(geoCellTotal.first);
+        geoCellJson["wallSeconds"] = geoCellWallSeconds != m_geoCellWallSeconds.end()
+                                         ? geoCellWallSeconds->second
+                                         : 0.0;
+        writeDatasetTotalToJson(geoCellTotal.second, geoCellJson);
+    }
+
+    nlohmann::json stats;
+    stats["version"] = STATS_VERSION;
+    stats["wallSeconds"] = wallSeconds;
+    stats["CPUSeconds"] = CPUSeconds;
+    stats["peakResidentBytes"] = getPeakResidentBytes();
+    stats["tilesPerSecond"] = wallSeconds > 0.0 ? static_cast<double>(total.tiles) / wallSeconds : 0.0;
+    writeDatasetTotalToJson(total, stats);
+    stats["geoCells"] = geoCells;
+    os << stats.dump(2) << "\n";
+}
+
+double ConversionStats::getThreadCPUSeconds() noexcept
+{
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        return 0.0;
+    }
+
+    return fileTimeToSeconds(kernelTime) + fileTimeToSeconds(userTime);
+#else
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+#endif
+}
+
+double ConversionStats::getProcessCPUSeconds() noexcept
+{
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        return 0.0;
+    }
+
+    return fileTimeToSeconds(kernelTime) + fileTimeToSeconds(userTime);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+           + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+uint64_t ConversionStats::getPeakResidentBytes() noexcept
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+    // macOS reports bytes, Linux kilobytes
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+uint64_t ConversionStats::getResidentBytes() noexcept
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(counters.WorkingSetSize);
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count)
+        != KERN_SUCCESS) {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(info.resident_size);
+#elif defined(__linux__)
+    // statm lists the total and resident pages of the process
+    std::ifstream fs("/proc/self/statm");
+    uint64_t totalPages = 0;
+    uint64_t residentPages = 0;
+    if (!(fs >> totalPages >> residentPages)) {
+        return getPeakResidentBytes();
+    }
+
+    return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+    return getPeakResidentBytes();
+#endif
+}
+
+ConversionStats::Dataset &ConversionStats::getDatasetLocked(const CDBGeoCell &geoCell, CDBDataset dataset)
+{
+    return m_datasets[{geoCell.getLatitude(), geoCell.getLongitude(), dataset}];
+}
+
+ScopedPhaseTimer::ScopedPhaseTimer(ConversionStats *stats,
+                                   const CDBGeoCell &geoCell,
+                                   CDBDataset dataset,
+                                   ConversionPhase phase) noexcept
+    : m_stats{stats}
+    , m_tile{geoCell, dataset, 0, 0, 0, 0, 0}
+    , m_hasTile{false}
+    , m_phase{phase}
+    , m_startCPUSeconds{0.0}
+{
+    if (m_stats) {
+        m_start = std::chrono::steady_clock::now();
+        m_startCPUSeconds = ConversionStats::getThreadCPUSeconds();
+    }
+}
+
+ScopedPhaseTimer::ScopedPhaseTimer(ConversionStats *stats,
+                                   const CDBTile &tile,
+                                   ConversionPhase phase) noexcept
+    : ScopedPhaseTimer(stats, tile.getGeoCell(), tile.getDataset(), phase)
+{
+    m_tile = tile.getKey();
+    m_hasTile = true;
+}
+
+ScopedPhaseTimer::~ScopedPhaseTimer() noexcept
+{
+    stop();
+}
+
+void ScopedPhaseTimer::stop() noexcept
+{
+    if (m_stats) {
+        auto end = std::chrono::steady_clock::now();
+        double CPUSeconds = ConversionStats::getThreadCPUSeconds() - m_startCPUSeconds;
+        m_stats->addPhase(m_tile.geoCell, m_tile.dataset, m_phase, toSeconds(end - m_start), CPUSeconds);
+        if (auto trace = m_stats->getTrace()) {
+            const char *name = conversionPhaseToString(m_phase);
+            if (m_hasTile) {
+                trace->addEvent(name, PHASE_CATEGORY, m_tile, m_start, end);
+            } else {
+                trace->addEvent(name, PHASE_CATEGORY, m_tile.geoCell, m_tile.dataset, m_start, end);
+            }
+        }
+
+        m_stats = nullptr;
+    }
+}
+
+double toSeconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+#ifdef _WIN32
+double fileTimeToSeconds(const FILETIME &fileTime)
+{
+    // file times count 100 nanoseconds
+    uint64_t ticks = (static_cast<uint64_t>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+    return static_cast<double>(ticks) * 1e-7;
+}
+#endif
+
+std::string getGeoCellName(int latitude, int longitude)
+{
+    CDBGeoCell geoCell(latitude, longitude);
+    return geoCell.getLatitudeDirectoryName() + geoCell.getLongitudeDirectoryName();
+}
+
+nlohmann::json convertPhasesToJson(const ConversionStats::Phases &phases)
+{
+    nlohmann::json json = nlohmann::json::object();
+    for (size_t i = 0; i < phases.size(); ++i) {
+        if (phases[i].count == 0) {
+            continue;
+        }
+
+        auto &phaseJson = json[conversionPhaseToString(static_cast<ConversionPhase>(i))];
+        phaseJson["count"] = phases[i].count;
+        phaseJson["wallSeconds"] = phases[i].wallSeconds;
+        phaseJson["CPUSeconds"] = phases[i].CPUSeconds;
+    }
+
+    return json;
+}
+
+void addDatasetToTotal(const ConversionStats::Dataset &dataset, ConversionStats::Dataset &total)
+{
+    total.tiles += dataset.tiles;
+    total.bytesIn += dataset.bytesIn;
+    total.bytesOut += dataset.bytesOut;
+    for (size_t i = 0; i < dataset.phases.size(); ++i) {
+        total.phases[i].count += dataset.phases[i].count;
+        total.phases[i].wallSeconds += dataset.phases[i].wallSeconds;
+        total.phases[i].CPUSeconds += dataset.phases[i].CPUSeconds;
+    }
+}
+
+void writeDatasetTotalToJson(const ConversionStats::Dataset &total, nlohmann::json &json)
+{
+    json["tiles"] = total.tiles;
+    json["bytesIn"] = total.bytesIn;
+    json["bytesOut"] = total.bytesOut;
+    json["phases"] = convertPhasesToJson(total.phases);
+}
+} // namespace CDBTo3DTiles
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "CDBTile.h"
+#include "ConversionTrace.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+
+namespace CDBTo3DTiles {
+enum class ConversionPhase
+{
+    FileDiscovery,
+    Decode,
+    MeshSimplification,
+    NormalGeneration,
+    ImageryEncoding,
+    GltfBuild,
+    TileWrite,
+    TilesetWrite
+};
+
+constexpr size_t CONVERSION_PHASE_COUNT = 8;
+
+const char *conversionPhaseToString(ConversionPhase phase);
+
+// the time spent in each phase of the conversion and the tiles and bytes of each GeoCell and dataset. Phases
+// are recorded from any thread. The CPU time of a phase is the one of the thread running it, so phases
+// waiting on the thread pool include the tasks they run meanwhile. Phases are also recorded as events of the
+// trace, if there is one
+class ConversionStats
+{
+public:
+    struct Phase
+    {
+        uint64_t count = 0;
+        double wallSeconds = 0.0;
+        double CPUSeconds = 0.0;
+    };
+
+    using Phases = std::array<Phase, CONVERSION_PHASE_COUNT>;
+
+    struct Dataset
+    {
+        double wallSeconds = 0.0;
+        uint64_t tiles = 0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        Phases phases;
+    };
+
+    explicit ConversionStats(std::shared_ptr<ConversionTrace> trace = nullptr);
+
+    ConversionStats(const ConversionStats &) = delete;
+
+    ConversionStats &operator=(const ConversionStats &) = delete;
+
+    void addPhase(const CDBGeoCell &geoCell,
+                  CDBDataset dataset,
+                  ConversionPhase phase,
+                  double wallSeconds,
+                  double CPUSeconds);
+
+    void addDatasetTime(const CDBGeoCell &geoCell, CDBDataset dataset, double wallSeconds);
+
+    void addGeoCellTime(const CDBGeoCell &geoCell, double wallSeconds);
+
+    void addTile(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes);
+
+    void addBytesIn(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes);
+
+    void addBytesOut(const CDBGeoCell &geoCell, CDBDataset dataset, uint64_t bytes);
+
+    Dataset getDataset(const CDBGeoCell &geoCell, CDBDataset dataset) const;
+
+    inline ConversionTrace *getTrace() const noexcept { return m_trace.get(); }
+
+    // the wall and CPU time of the whole process are measured from the construction of the stats
+    void writeJson(std::ostream &os) const;
+
+    static double getThreadCPUSeconds() noexcept;
+
+    static double getProcessCPUSeconds() noexcept;
+
+    static uint64_t getPeakResidentBytes() noexcept;
+
+    // the memory resident now, which falls when freed pages are returned to the system. The peak where it
+    // can't be read
+    static uint64_t getResidentBytes() noexcept;
+
+private:
+    using DatasetKey = std::tuple<int, int, CDBDataset>;
+
+    Dataset &getDatasetLocked(const CDBGeoCell &geoCell, CDBDataset dataset);
+
+    std::shared_ptr<ConversionTrace> m_trace;
+    std::chrono::steady_clock::time_point m_start;
+    double m_startCPUSeconds;
+    mutable std::mutex m_mutex;
+    std::map<DatasetKey, Dataset> m_datasets;
+    std::map<std::tuple<int, int>, double> m_geoCellWallSeconds;
+};
+
+// records the wall and CPU time of a scope as a phase of a dataset, or until it is stopped. It does nothing
+// without stats
+class ScopedPhaseTimer
+{
+public:
+    ScopedPhaseTimer(ConversionStats *stats,
+                     const CDBGeoCell &geoCell,
+                     CDBDataset dataset,
+                     ConversionPhase phase) noexcept;
+
+    ScopedPhaseTimer(ConversionStats *stats, const CDBTile &tile, ConversionPhase phase) noexcept;
+
+    ScopedPhaseTimer(const ScopedPhaseTimer &) = delete;
+
+    ScopedPhaseTimer &operator=(const ScopedPhaseTimer &) = delete;
+
+    ~ScopedPhaseTimer() noexcept;
+
+    void stop() noexcept;
+
+private:
+    ConversionStats *m_stats;
+    CDBTileKey m_tile;
+    bool m_hasTile;
+    ConversionPhase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+    double m_startCPUSeconds;
+};
+} // namespace CDBTo3DTiles
@@ -0,0 +1,209 @@
+#include "ConversionTrace.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <iomanip>
+
+namespace CDBTo3DTiles {
+static const char *JOB_CATEGORY = "job";
+
+static std::atomic<uint64_t> nextTraceID{1};
+
+static void writeJsonString(std::ostream &os, const std::string &value);
+
+static void writeMicroseconds(std::ostream &os, int64_t nanoseconds);
+
+ConversionTrace::ThreadBuffer::ThreadBuffer(size_t capacity, size_t ID)
+    : recordedCount{0}
+    , threadID{ID}
+{
+    events.reserve(capacity);
+}
+
+ConversionTrace::ConversionTrace(size_t eventsPerThread)
+    : m_ID{nextTraceID.fetch_add(1)}
+    , m_eventsPerThread{std::max<size_t>(eventsPerThread, 1)}
+    , m_start{std::chrono::steady_clock::now()}
+{}
+
+void ConversionTrace::addEvent(const char *name,
+                               const char *category,
+                               const CDBGeoCell &geoCell,
+                               CDBDataset dataset,
+                               std::chrono::steady_clock::time_point begin,
+                               std::chrono::steady_clock::time_point end) noexcept
+{
+    CDBTileKey tile{geoCell, dataset, 0, 0, 0, 0, 0};
+    addEvent({name,
+              category,
+              tile,
+              false,
+              std::chrono::duration_cast<std::chrono::nanoseconds>(begin - m_start).count(),
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()});
+}
+
+void ConversionTrace::addEvent(const char *name,
+                               const char *category,
+                               const CDBTileKey &tile,
+                               std::chrono::steady_clock::time_point begin,
+                               std::chrono::steady_clock::time_point end) noexcept
+{
+    addEvent({name,
+              category,
+              tile,
+              true,
+              std::chrono::duration_cast<std::chrono::nanoseconds>(begin - m_start).count(),
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()});
+}
+
+size_t ConversionTrace::getEventCount() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t eventCount = 0;
+    for (const auto &threadBuffer : m_threadBuffers) {
+        size_t recordedCount = threadBuffer->recordedCount.load(std::memory_order_acquire);
+        eventCount += std::min(recordedCount, m_eventsPerThread);
+    }
+
+    return eventCount;
+}
+
+void ConversionTrace::writeJson(std::ostream &os) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"CDBConverter\"}}";
+    for (const auto &threadBuffer : m_threadBuffers) {
+        os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadBuffer->threadID
+           << ",\"args\":{\"name\":\"thread " << threadBuffer->threadID << "\"}}";
+
+        // the oldest events are first in the ring once it has wrapped around
+        size_t recordedCount = threadBuffer->recordedCount.load(std::memory_order_acquire);
+        size_t first = recordedCount > m_eventsPerThread ? recordedCount - m_eventsPerThread : 0;
+        for (size_t i = first; i < recordedCount; ++i) {
+            const Event &event = threadBuffer->events[i % m_eventsPerThread];
+            os << ",\n{\"name\":";
+            writeJsonString(os, event.name);
+            os << ",\"cat\":";
+            writeJsonString(os, event.category);
+            os << ",\"ph\":\"X\",\"ts\":";
+            writeMicroseconds(os, event.beginNanoseconds);
+            os << ",\"dur\":";
+            writeMicroseconds(os, event.durationNanoseconds);
+            os << ",\"pid\":1,\"tid\":" << threadBuffer->threadID << ",\"args\":{\"geoCell\":";
+            writeJsonString(os,
+                            event.tile.geoCell.getLatitudeDirectoryName()
+                                + event.tile.geoCell.getLongitudeDirectoryName());
+            os << ",\"dataset\":";
+            writeJsonString(os, getCDBDatasetDirectoryName(event.tile.dataset));
+            if (event.hasTile) {
+                os << ",\"tile\":";
+                writeJsonString(os, CDBTile(event.tile).getFilename());
+            }
+
+            os << "}}";
+        }
+    }
+
+    os << "\n]}\n";
+}
+
+void ConversionTrace::addEvent(const Event &event) noexcept
+{
+    ThreadBuffer *threadBuffer = getThreadBuffer();
+    if (!threadBuffer) {
+        return;
+    }
+
+    // only this thread writes to its buffer, the count publishes the event to the final write
+    size_t recordedCount = threadBuffer->recordedCount.load(std::memory_order_relaxed);
+    if (recordedCount < m_eventsPerThread) {
+        threadBuffer->events.emplace_back(event);
+    } else {
+        threadBuffer->events[recordedCount % m_eventsPerThread] = event;
+    }
+
+    threadBuffer->recordedCount.store(recordedCount + 1, std::memory_order_release);
+}
+
+ConversionTrace::ThreadBuffer *ConversionTrace::getThreadBuffer() noexcept
+{
+    // traces are told apart by an ID rather than their address, which a later trace may reuse
+    thread_local uint64_t cachedTraceID = 0;
+    thread_local ThreadBuffer *cachedThreadBuffer = nullptr;
+    if (cachedTraceID == m_ID) {
+        return cachedThreadBuffer;
+    }
+
+    try {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t threadID = m_threadBuffers.size() + 1;
+        m_threadBuffers.emplace_back(std::make_unique<ThreadBuffer>(m_eventsPerThread, threadID));
+        cachedTraceID = m_ID;
+        cachedThreadBuffer = m_threadBuffers.back().get();
+        return cachedThreadBuffer;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+ScopedTraceEvent::ScopedTraceEvent(ConversionTrace *trace, const char *name, const CDBTile &tile) noexcept
+    : m_trace{trace}
+    , m_name{name}
+    , m_tile{tile.getKey()}
+    , m_hasTile{true}
+{
+    if (m_trace) {
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedTraceEvent::ScopedTraceEvent(ConversionTrace *trace,
+                                   const char *name,
+                                   const CDBGeoCell &geoCell,
+                                   CDBDataset dataset) noexcept
+    : m_trace{trace}
+    , m_name{name}
+    , m_tile{geoCell, dataset, 0, 0, 0, 0, 0}
+    , m_hasTile{false}
+{
+    if (m_trace) {
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedTraceEvent::~ScopedTraceEvent() noexcept
+{
+    stop();
+}
+
+void ScopedTraceEvent::stop() noexcept
+{
+    if (m_trace) {
+        auto end = std::chrono::steady_clock::now();
+        if (m_hasTile) {
+            m_trace->addEvent(m_name, JOB_CATEGORY, m_tile, m_start, end);
+        } else {
+            m_trace->addEvent(m_name, JOB_CATEGORY, m_tile.geoCell, m_tile.dataset, m_start, end);
+        }
+
+        m_trace = nullptr;
+    }
+}
+
+void writeJsonString(std::ostream &os, const std::string &value)
+{
+    os << nlohmann::json(value).dump();
+}
+
+void writeMicroseconds(std::ostream &os, int64_t nanoseconds)
+{
+    if (nanoseconds < 0) {
+        os << '-';
+        nanoseconds = -nanoseconds;
+    }
+
+    char fill = os.fill('0');
+    os << nanoseconds / 1000 << '.' << std::setw(3) << nanoseconds % 1000;
+    os.fill(fill);
+}
+} // namespace CDBTo3DTiles
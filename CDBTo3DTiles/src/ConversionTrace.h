@@ -0,0 +1,103 @@
+#pragma once
+
+#include "CDBTile.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace CDBTo3DTiles {
+// begin and end events of jobs and phases, written in the Chrome trace event format read by chrome://tracing
+// and Perfetto. Every thread records into its own ring buffer without locking, so the oldest events of a
+// thread are overwritten once its buffer is full. Names and categories must outlive the trace
+class ConversionTrace
+{
+public:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+    explicit ConversionTrace(size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+
+    ConversionTrace(const ConversionTrace &) = delete;
+
+    ConversionTrace &operator=(const ConversionTrace &) = delete;
+
+    void addEvent(const char *name,
+                  const char *category,
+                  const CDBGeoCell &geoCell,
+                  CDBDataset dataset,
+                  std::chrono::steady_clock::time_point begin,
+                  std::chrono::steady_clock::time_point end) noexcept;
+
+    void addEvent(const char *name,
+                  const char *category,
+                  const CDBTileKey &tile,
+                  std::chrono::steady_clock::time_point begin,
+                  std::chrono::steady_clock::time_point end) noexcept;
+
+    size_t getEventCount() const noexcept;
+
+    // only call once the threads that recorded events are done
+    void writeJson(std::ostream &os) const;
+
+private:
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        CDBTileKey tile;
+        bool hasTile;
+        int64_t beginNanoseconds;
+        int64_t durationNanoseconds;
+    };
+
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(size_t capacity, size_t threadID);
+
+        std::vector<Event> events;
+        std::atomic<size_t> recordedCount;
+        size_t threadID;
+    };
+
+    void addEvent(const Event &event) noexcept;
+
+    ThreadBuffer *getThreadBuffer() noexcept;
+
+    uint64_t m_ID;
+    size_t m_eventsPerThread;
+    std::chrono::steady_clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers;
+};
+
+// records a scope as an event of the trace, or until it is stopped. It does nothing without trace
+class ScopedTraceEvent
+{
+public:
+    ScopedTraceEvent(ConversionTrace *trace, const char *name, const CDBTile &tile) noexcept;
+
+    ScopedTraceEvent(ConversionTrace *trace,
+                     const char *name,
+                     const CDBGeoCell &geoCell,
+                     CDBDataset dataset) noexcept;
+
+    ScopedTraceEvent(const ScopedTraceEvent &) = delete;
+
+    ScopedTraceEvent &operator=(const ScopedTraceEvent &) = delete;
+
+    ~ScopedTraceEvent() noexcept;
+
+    void stop() noexcept;
+
+private:
+    ConversionTrace *m_trace;
+    const char *m_name;
+    CDBTileKey m_tile;
+    bool m_hasTile;
+    std::chrono::steady_clock::time_point m_start;
+};
+} // namespace CDBTo3DTiles
@@ -0,0 +1,139 @@
+#include "GDALDatasetPool.h"
+#include "cpl_conv.h"
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace CDBTo3DTiles {
+GDALDatasetPoolReleaser::GDALDatasetPoolReleaser() noexcept
+    : m_pool{nullptr}
+{}
+
+GDALDatasetPoolReleaser::GDALDatasetPoolReleaser(GDALDatasetPool *pool, std::string path) noexcept
+    : m_pool{pool}
+    , m_path{std::move(path)}
+{}
+
+void GDALDatasetPoolReleaser::operator()(GDALDataset *dataset) const noexcept
+{
+    if (m_pool) {
+        m_pool->release(m_path, dataset);
+    } else {
+        GDALClose(dataset);
+    }
+}
+
+GDALDatasetPool::GDALDatasetPool(size_t capacity)
+    : m_capacity{capacity}
+    , m_statistics{0, 0, 0}
+{}
+
+GDALDatasetPool::~GDALDatasetPool() noexcept
+{
+    for (const auto &idleDataset : m_LRUDatasets) {
+        GDALClose(idleDataset.dataset);
+    }
+}
+
+PooledGDALDataset GDALDatasetPool::openRaster(const std::filesystem::path &path)
+{
+    std::string pathString = path.string();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto idleDataset = m_pathToDatasets.find(pathString);
+        if (idleDataset != m_pathToDatasets.end()) {
+            ++m_statistics.hits;
+            GDALDataset *dataset = idleDataset->second->dataset;
+            m_LRUDatasets.erase(idleDataset->second);
+            m_pathToDatasets.erase(idleDataset);
+            return PooledGDALDataset(dataset, GDALDatasetPoolReleaser(this, std::move(pathString)));
+        }
+
+        ++m_statistics.misses;
+    }
+
+    // the file is opened outside of the lock, since opening a JP2 parses its whole header
+    auto dataset = static_cast<GDALDataset *>(GDALOpen(pathString.c_str(), GDALAccess::GA_ReadOnly));
+    if (!dataset) {
+        return nullptr;
+    }
+
+    return PooledGDALDataset(dataset, GDALDatasetPoolReleaser(this, std::move(pathString)));
+}
+
+GDALDatasetPool::Statistics GDALDatasetPool::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void GDALDatasetPool::release(const std::string &path, GDALDataset *dataset) noexcept
+{
+    if (m_capacity == 0) {
+        GDALClose(dataset);
+        return;
+    }
+
+    std::vector<GDALDataset *> evictedDatasets;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_LRUDatasets.push_front({path, dataset});
+        m_pathToDatasets.insert({path, m_LRUDatasets.begin()});
+        while (m_LRUDatasets.size() > m_capacity) {
+            auto LRUDataset = std::prev(m_LRUDatasets.end());
+            auto range = m_pathToDatasets.equal_range(LRUDataset->path);
+            for (auto idleDataset = range.first; idleDataset != range.second; ++idleDataset) {
+                if (idleDataset->second == LRUDataset) {
+                    m_pathToDatasets.erase(idleDataset);
+                    break;
+                }
+            }
+
+            ++m_statistics.evictions;
+            evictedDatasets.emplace_back(LRUDataset->dataset);
+            m_LRUDatasets.erase(LRUDataset);
+        }
+    }
+
+    for (auto evictedDataset : evictedDatasets) {
+        GDALClose(evictedDataset);
+    }
+}
+
+PooledGDALDataset openRasterDataset(const std::filesystem::path &path, GDALDatasetPool *datasetPool)
+{
+    if (datasetPool) {
+        return datasetPool->openRaster(path);
+    }
+
+    return PooledGDALDataset(static_cast<GDALDataset *>(GDALOpen(path.c_str(), GDALAccess::GA_ReadOnly)));
+}
+
+ScopedGDALSettings::ScopedGDALSettings(size_t cacheMemory, size_t threadCount)
+{
+    if (cacheMemory > 0) {
+        m_previousCacheMemory = GDALGetCacheMax64();
+        GDALSetCacheMax64(static_cast<GIntBig>(cacheMemory));
+    }
+
+    // the option is copied, since setting it again frees the string GDAL returns
+    if (threadCount > 0) {
+        const char *previousThreadCount = CPLGetConfigOption("GDAL_NUM_THREADS", nullptr);
+        m_previousThreadCount.emplace(previousThreadCount ? std::optional<std::string>(previousThreadCount)
+                                                          : std::nullopt);
+        CPLSetConfigOption("GDAL_NUM_THREADS", std::to_string(threadCount).c_str());
+    }
+}
+
+ScopedGDALSettings::~ScopedGDALSettings() noexcept
+{
+    if (m_previousCacheMemory) {
+        GDALSetCacheMax64(*m_previousCacheMemory);
+    }
+
+    if (m_previousThreadCount) {
+        CPLSetConfigOption("GDAL_NUM_THREADS",
+                           *m_previousThreadCount ? (*m_previousThreadCount)->c_str() : nullptr);
+    }
+}
+} // namespace CDBTo3DTiles
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "gdal_priv.h"
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace CDBTo3DTiles {
+class GDALDatasetPool;
+
+// hands the dataset back to its pool instead of closing it. Datasets opened without a pool are closed
+class GDALDatasetPoolReleaser
+{
+public:
+    GDALDatasetPoolReleaser() noexcept;
+
+    GDALDatasetPoolReleaser(GDALDatasetPool *pool, std::string path) noexcept;
+
+    void operator()(GDALDataset *dataset) const noexcept;
+
+private:
+    GDALDatasetPool *m_pool;
+    std::string m_path;
+};
+
+using PooledGDALDataset = std::unique_ptr<GDALDataset, GDALDatasetPoolReleaser>;
+
+// raster datasets stay open once released, so a tile read again, e.g. an elevation grid evicted from its
+// cache, skips opening the file and parsing its header. A dataset can't be read from several threads at once,
+// so a handle belongs to one thread until it is released, and a file read by several threads at the same
+// time gets a handle per thread. The least recently released handles are closed past the capacity
+class GDALDatasetPool
+{
+public:
+    struct Statistics
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+    };
+
+    // a capacity of 0 closes every dataset once it is released
+    explicit GDALDatasetPool(size_t capacity = 0);
+
+    GDALDatasetPool(const GDALDatasetPool &) = delete;
+
+    GDALDatasetPool &operator=(const GDALDatasetPool &) = delete;
+
+    ~GDALDatasetPool() noexcept;
+
+    // returns nullptr if the raster can't be opened. The pool must outlive the datasets it opens
+    PooledGDALDataset openRaster(const std::filesystem::path &path);
+
+    Statistics getStatistics() const;
+
+private:
+    friend class GDALDatasetPoolReleaser;
+
+    struct IdleDataset
+    {
+        std::string path;
+        GDALDataset *dataset;
+    };
+
+    void release(const std::string &path, GDALDataset *dataset) noexcept;
+
+    size_t m_capacity;
+    mutable std::mutex m_mutex;
+    Statistics m_statistics;
+    std::list<IdleDataset> m_LRUDatasets;
+    std::unordered_multimap<std::string, std::list<IdleDataset>::iterator> m_pathToDatasets;
+};
+
+// opens the raster from the pool when there is one
+PooledGDALDataset openRasterDataset(const std::filesystem::path &path, GDALDatasetPool *datasetPool);
+
+// sizes the GDAL block cache and sets the threads decoding each raster while a conversion runs, and restores
+// the previous settings of the process when it leaves its scope, even when it throws. A value of 0 keeps the
+// current setting. The rasters are decoded by the conversion threads, so the thread count can't be local to
+// the thread that starts the conversion
+class ScopedGDALSettings
+{
+public:
+    ScopedGDALSettings(size_t cacheMemory, size_t threadCount);
+
+    ScopedGDALSettings(const ScopedGDALSettings &) = delete;
+
+    ScopedGDALSettings &operator=(const ScopedGDALSettings &) = delete;
+
+    ~ScopedGDALSettings() noexcept;
+
+private:
+    std::optional<GIntBig> m_previousCacheMemory;
+    std::optional<std::optional<std::string>> m_previousThreadCount;
+};
+} // namespace CDBTo3DTiles
@@ -4,6 +4,13 @@
 
 #include "Gltf.h"
 #include "Utility.h"
+#include "draco/compression/encode.h"
+#include "glm/gtc/type_ptr.hpp"
+#include "meshoptimizer.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace std {
 template<>
@@ -25,34 +32,161 @@ struct hash<tinygltf::Sampler>
 
 namespace CDBTo3DTiles {
 
+template<typename T>
+static void remapVertexAttribute(std::vector<T> &attribute,
+                                 const std::vector<unsigned> &remap,
+                                 size_t uniqueVertexCount);
+
 static void createGltfTexture(const Texture &texture,
                               tinygltf::Model &gltf,
                               std::unordered_map<tinygltf::Sampler, unsigned> *samplerCache);
 
 static void createGltfMaterial(const Material &material, tinygltf::Model &gltf);
 
+// data of one buffer view, either referenced in the mesh or owned by the storage once encoded.
+// The byte stride is only written when it is not 0, and the element size is the one used to compress the data
+struct GltfBufferView
+{
+    const void *data;
+    size_t byteLength;
+    size_t paddedByteLength;
+    size_t elementSize;
+    size_t byteStride;
+    std::shared_ptr<const std::vector<unsigned char>> storage;
+    std::optional<GltfMeshoptCompression> meshoptCompression;
+};
+
 static size_t createGltfMesh(const Mesh &mesh,
                              size_t rootIndex,
                              tinygltf::Model &gltf,
                              std::vector<unsigned char> &bufferData,
-                             size_t bufferOffset);
+                             std::vector<GltfBufferSegment> *bufferSegments,
+                             size_t bufferOffset,
+                             const GltfEncoding &encoding);
+
+static size_t createDracoGltfMesh(const Mesh &mesh,
+                                  size_t rootIndex,
+                                  tinygltf::Model &gltf,
+                                  std::vector<unsigned char> &bufferData,
+                                  std::vector<GltfBufferSegment> *bufferSegments,
+                                  size_t bufferOffset,
+                                  const GltfEncoding &encoding);
+
+static void createGltfMeshNode(const tinygltf::Primitive &primitiveGltf,
+                               const glm::dvec3 &translation,
+                               const std::vector<double> &scale,
+                               size_t rootIndex,
+                               tinygltf::Model &gltf);
+
+static size_t computeBufferSize(const Mesh &mesh);
+
+static size_t computeBinaryByteLength(const std::vector<GltfBufferSegment> &bufferSegments);
 
 static int primitiveTypeToGltfMode(PrimitiveType type);
 
-static void createBufferAndAccessor(tinygltf::Model &modelGltf,
-                                    void *destBuffer,
-                                    const void *sourceBuffer,
-                                    size_t bufferIndex,
-                                    size_t bufferViewOffset,
-                                    size_t bufferViewLength,
-                                    int bufferViewTarget,
-                                    size_t accessorComponentCount,
-                                    int accessorComponentType,
-                                    int accessorType);
+static void addRequiredExtension(tinygltf::Model &gltf, const std::string &extension);
+
+static GltfBufferView referenceBufferView(const void *data, size_t count, size_t elementSize);
+
+static GltfBufferView storeBufferView(std::vector<unsigned char> data, size_t elementSize, size_t byteStride);
+
+static GltfBufferView quantizeIndices(const std::vector<uint32_t> &indices);
+
+static GltfBufferView quantizePositions(const std::vector<glm::vec3> &positions,
+                                        const glm::dvec3 &scale,
+                                        glm::dvec3 &quantizedMin,
+                                        glm::dvec3 &quantizedMax);
+
+static GltfBufferView quantizeNormals(const std::vector<glm::vec3> &normals);
+
+static GltfBufferView quantizeUVs(const std::vector<glm::vec2> &UVs);
+
+static void compressVertexBufferView(GltfBufferView &bufferView, size_t count);
+
+static void compressIndexBufferView(GltfBufferView &bufferView,
+                                    const std::vector<uint32_t> &indices,
+                                    size_t vertexCount);
+
+static size_t createBufferView(tinygltf::Model &modelGltf,
+                               std::vector<unsigned char> &bufferData,
+                               std::vector<GltfBufferSegment> *bufferSegments,
+                               const GltfBufferView &bufferView,
+                               size_t bufferIndex,
+                               size_t bufferViewOffset,
+                               int bufferViewTarget);
+
+static size_t createBufferAndAccessor(tinygltf::Model &modelGltf,
+                                      std::vector<unsigned char> &bufferData,
+                                      std::vector<GltfBufferSegment> *bufferSegments,
+                                      const GltfBufferView &bufferView,
+                                      size_t bufferIndex,
+                                      size_t bufferViewOffset,
+                                      int bufferViewTarget,
+                                      size_t accessorComponentCount,
+                                      int accessorComponentType,
+                                      int accessorType,
+                                      bool accessorNormalized);
 
 static int convertToGltfFilterMode(TextureFilter mode);
 
-tinygltf::Model createGltf(const Mesh &mesh, const Material *material, const Texture *texture)
+void optimizeMeshForRendering(Mesh &mesh)
+{
+    if (mesh.primitiveType != PrimitiveType::Triangles || mesh.indices.empty() || mesh.positionRTCs.empty()) {
+        return;
+    }
+
+    // every vertex attribute is either missing or complete, otherwise they cannot be reordered together
+    size_t indexCount = mesh.indices.size();
+    size_t vertexCount = mesh.getVertexCount();
+    size_t attributeSizes[] = {mesh.positions.size(),
+                               mesh.positionRTCs.size(),
+                               mesh.UVs.size(),
+                               mesh.normals.size(),
+                               mesh.batchIDs.size()};
+    for (size_t attributeSize : attributeSizes) {
+        if (attributeSize != 0 && attributeSize != vertexCount) {
+            return;
+        }
+    }
+
+    meshopt_optimizeVertexCache(mesh.indices.data(), mesh.indices.data(), indexCount, vertexCount);
+
+    // the vertex cache efficiency may get 5% worse in exchange for less overdraw
+    meshopt_optimizeOverdraw(mesh.indices.data(),
+                             mesh.indices.data(),
+                             indexCount,
+                             glm::value_ptr(mesh.positionRTCs[0]),
+                             vertexCount,
+                             sizeof(glm::vec3),
+                             1.05f);
+
+    std::vector<unsigned> remap(vertexCount);
+    size_t uniqueVertexCount = meshopt_optimizeVertexFetchRemap(remap.data(),
+                                                                mesh.indices.data(),
+                                                                indexCount,
+                                                                vertexCount);
+    meshopt_remapIndexBuffer(mesh.indices.data(), mesh.indices.data(), indexCount, remap.data());
+    remapVertexAttribute(mesh.positions, remap, uniqueVertexCount);
+    remapVertexAttribute(mesh.positionRTCs, remap, uniqueVertexCount);
+    remapVertexAttribute(mesh.UVs, remap, uniqueVertexCount);
+    remapVertexAttribute(mesh.normals, remap, uniqueVertexCount);
+    remapVertexAttribute(mesh.batchIDs, remap, uniqueVertexCount);
+}
+
+GltfEncoding::GltfEncoding()
+    : quantizeAttributes{false}
+    , meshoptCompression{false}
+    , dracoCompression{false}
+    , dracoPositionBits{14}
+    , dracoNormalBits{10}
+    , dracoUVBits{12}
+{}
+
+tinygltf::Model createGltf(const Mesh &mesh,
+                           const Material *material,
+                           const Texture *texture,
+                           std::vector<GltfBufferSegment> *bufferSegments,
+                           const GltfEncoding &encoding)
 {
     static const std::filesystem::path TEXTURE_SUB_DIR = "Textures";
 
@@ -68,17 +202,15 @@ tinygltf::Model createGltf(const Mesh &mesh, const Material *material, const Tex
     gltf.nodes.emplace_back(rootNodeGltf);
 
     // create buffer
-    size_t totalBufferSize = mesh.indices.size() * sizeof(uint32_t) + mesh.batchIDs.size() * sizeof(float)
-                             + mesh.positionRTCs.size() * sizeof(glm::vec3)
-                             + mesh.normals.size() * sizeof(glm::vec3) + mesh.UVs.size() * sizeof(glm::vec2);
-
     tinygltf::Buffer bufferGltf;
     auto &bufferData = bufferGltf.data;
-    bufferData.resize(totalBufferSize);
+    if (!bufferSegments) {
+        bufferData.reserve(computeBufferSize(mesh));
+    }
 
     // add mesh
     size_t bufferOffset = 0;
-    createGltfMesh(mesh, 0, gltf, bufferData, bufferOffset);
+    createGltfMesh(mesh, 0, gltf, bufferData, bufferSegments, bufferOffset, encoding);
 
     // add material
     if (material) {
@@ -110,7 +242,9 @@ tinygltf::Model createGltf(const Mesh &mesh, const Material *material, const Tex
 
 tinygltf::Model createGltf(const std::vector<Mesh> &meshes,
                            const std::vector<Material> &materials,
-                           const std::vector<Texture> &textures)
+                           const std::vector<Texture> &textures,
+                           std::vector<GltfBufferSegment> *bufferSegments,
+                           const GltfEncoding &encoding)
 {
     static const std::filesystem::path TEXTURE_SUB_DIR = "Textures";
 
@@ -148,18 +282,19 @@ tinygltf::Model createGltf(const std::vector<Mesh> &meshes,
 
     // create mesh node
     tinygltf::Buffer bufferGltf;
-    size_t totalBufferSize = 0;
-    for (const auto &mesh : meshes) {
-        totalBufferSize += mesh.indices.size() * sizeof(uint32_t) + mesh.batchIDs.size() * sizeof(float)
-                           + mesh.positionRTCs.size() * sizeof(glm::vec3)
-                           + mesh.normals.size() * sizeof(glm::vec3) + mesh.UVs.size() * sizeof(glm::vec2);
+    auto &bufferData = bufferGltf.data;
+    if (!bufferSegments) {
+        size_t totalBufferSize = 0;
+        for (const auto &mesh : meshes) {
+            totalBufferSize += computeBufferSize(mesh);
+        }
+
+        bufferData.reserve(totalBufferSize);
     }
 
-    auto &bufferData = bufferGltf.data;
-    bufferData.resize(totalBufferSize);
     size_t bufferOffset = 0;
     for (const auto &mesh : meshes) {
-        bufferOffset += createGltfMesh(mesh, 0, gltf, bufferData, bufferOffset);
+        bufferOffset += createGltfMesh(mesh, 0, gltf, bufferData, bufferSegments, bufferOffset, encoding);
     }
 
     // add buffer to the model
@@ -173,6 +308,124 @@ tinygltf::Model createGltf(const std::vector<Mesh> &meshes,
     return gltf;
 }
 
+std::string createGlbJson(tinygltf::Model *gltf, const std::vector<GltfBufferSegment> &bufferSegments)
+{
+    // the buffer of the model is empty, so tinygltf only serializes the JSON and the buffer is described here
+    std::stringstream ss;
+    tinygltf::TinyGLTF gltfIO;
+    gltfIO.WriteGltfSceneToStream(gltf, ss, false, false);
+
+    size_t binaryByteLength = computeBinaryByteLength(bufferSegments);
+    nlohmann::json gltfJson = nlohmann::json::parse(ss.str());
+    if (binaryByteLength > 0) {
+        gltfJson["buffers"] = nlohmann::json::array();
+        gltfJson["buffers"].push_back({{"byteLength", binaryByteLength}});
+    } else {
+        gltfJson.erase("buffers");
+    }
+
+    // compressed buffer views read the binary buffer through the extension and describe their decoded data
+    // in a fallback buffer that has no data
+    size_t fallbackByteLength = 0;
+    for (size_t i = 0; i < bufferSegments.size(); ++i) {
+        const auto &compression = bufferSegments[i].meshoptCompression;
+        if (!compression) {
+            continue;
+        }
+
+        auto &bufferView = gltfJson["bufferViews"][i];
+        nlohmann::json extension = {{"buffer", 0},
+                                    {"byteOffset", bufferView.value("byteOffset", size_t(0))},
+                                    {"byteLength", bufferView.value("byteLength", size_t(0))},
+                                    {"byteStride", compression->byteStride},
+                                    {"mode", compression->mode},
+                                    {"count", compression->count}};
+        bufferView["buffer"] = 1;
+        bufferView["byteOffset"] = fallbackByteLength;
+        bufferView["byteLength"] = compression->byteLength;
+        if (compression->mode == "ATTRIBUTES") {
+            bufferView["byteStride"] = compression->byteStride;
+        }
+
+        bufferView["extensions"]["EXT_meshopt_compression"] = extension;
+        fallbackByteLength += roundUp(compression->byteLength, 4);
+    }
+
+    if (fallbackByteLength > 0) {
+        nlohmann::json fallbackExtension = {{"EXT_meshopt_compression", {{"fallback", true}}}};
+        nlohmann::json fallbackBuffer = {{"byteLength", fallbackByteLength},
+                                         {"extensions", fallbackExtension}};
+        gltfJson["buffers"].push_back(fallbackBuffer);
+        gltfJson["extensionsUsed"].push_back("EXT_meshopt_compression");
+        gltfJson["extensionsRequired"].push_back("EXT_meshopt_compression");
+    }
+
+    std::string glbJson = gltfJson.dump();
+    glbJson += std::string(roundUp(glbJson.size(), 4) - glbJson.size(), ' ');
+    return glbJson;
+}
+
+size_t computeGlbByteLength(const std::string &glbJson, const std::vector<GltfBufferSegment> &bufferSegments)
+{
+    static const size_t GLB_HEADER_SIZE = 12;
+    static const size_t GLB_CHUNK_HEADER_SIZE = 8;
+
+    size_t binaryByteLength = computeBinaryByteLength(bufferSegments);
+    size_t byteLength = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE + glbJson.size();
+    if (binaryByteLength > 0) {
+        byteLength += GLB_CHUNK_HEADER_SIZE + roundUp(binaryByteLength, 4);
+    }
+
+    return byteLength;
+}
+
+void writeToGlb(const std::string &glbJson,
+                const std::vector<GltfBufferSegment> &bufferSegments,
+                std::ostream &os)
+{
+    static const uint32_t GLB_MAGIC = 0x46546C67;
+    static const uint32_t GLB_VERSION = 2;
+    static const uint32_t GLB_JSON_CHUNK = 0x4E4F534A;
+    static const uint32_t GLB_BINARY_CHUNK = 0x004E4942;
+    static const char GLB_PADDING[4] = {0, 0, 0, 0};
+
+    uint32_t header[3] = {GLB_MAGIC,
+                          GLB_VERSION,
+                          static_cast<uint32_t>(computeGlbByteLength(glbJson, bufferSegments))};
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+    uint32_t JSONChunkHeader[2] = {static_cast<uint32_t>(glbJson.size()), GLB_JSON_CHUNK};
+    os.write(reinterpret_cast<const char *>(JSONChunkHeader), sizeof(JSONChunkHeader));
+    os.write(glbJson.data(), static_cast<std::streamsize>(glbJson.size()));
+
+    // the mesh data are written straight from their own storage
+    size_t binaryByteLength = computeBinaryByteLength(bufferSegments);
+    if (binaryByteLength > 0) {
+        size_t paddedByteLength = roundUp(binaryByteLength, 4);
+        uint32_t binaryChunkHeader[2] = {static_cast<uint32_t>(paddedByteLength), GLB_BINARY_CHUNK};
+        os.write(reinterpret_cast<const char *>(binaryChunkHeader), sizeof(binaryChunkHeader));
+        for (const auto &segment : bufferSegments) {
+            os.write(reinterpret_cast<const char *>(segment.data),
+                     static_cast<std::streamsize>(segment.byteLength));
+        }
+
+        os.write(GLB_PADDING, static_cast<std::streamsize>(paddedByteLength - binaryByteLength));
+    }
+}
+
+template<typename T>
+void remapVertexAttribute(std::vector<T> &attribute,
+                          const std::vector<unsigned> &remap,
+                          size_t uniqueVertexCount)
+{
+    if (attribute.empty()) {
+        return;
+    }
+
+    meshopt_remapVertexBuffer(attribute.data(), attribute.data(), attribute.size(), sizeof(T), remap.data());
+    attribute.resize(uniqueVertexCount);
+}
+
 void createGltfTexture(const Texture &texture,
                        tinygltf::Model &gltf,
                        std::unordered_map<tinygltf::Sampler, unsigned> *samplerCache)
@@ -199,11 +452,26 @@ void createGltfTexture(const Texture &texture,
 
     tinygltf::Image imageGltf;
     imageGltf.uri = texture.uri;
+    bool isKTX2 = std::filesystem::path(texture.uri).extension() == ".ktx2";
+    if (isKTX2) {
+        imageGltf.mimeType = "image/ktx2";
+    }
+
     gltf.images.emplace_back(imageGltf);
 
+    // KTX2 images have no fallback, so clients must support the extension
     tinygltf::Texture textureGltf;
     textureGltf.sampler = samplerIndex;
-    textureGltf.source = static_cast<int>(gltf.images.size() - 1);
+    int imageIndex = static_cast<int>(gltf.images.size() - 1);
+    if (isKTX2) {
+        tinygltf::Value::Object basisu;
+        basisu["source"] = tinygltf::Value(imageIndex);
+        textureGltf.extensions["KHR_texture_basisu"] = tinygltf::Value(basisu);
+        addRequiredExtension(gltf, "KHR_texture_basisu");
+    } else {
+        textureGltf.source = imageIndex;
+    }
+
     gltf.textures.emplace_back(textureGltf);
 }
 
@@ -249,12 +517,22 @@ size_t createGltfMesh(const Mesh &mesh,
                       size_t rootIndex,
                       tinygltf::Model &gltf,
                       std::vector<unsigned char> &bufferData,
-                      size_t offset)
+                      std::vector<GltfBufferSegment> *bufferSegments,
+                      size_t offset,
+                      const GltfEncoding &encoding)
 {
+    // Draco only encodes triangles, other primitives are written as they are
+    if (encoding.dracoCompression && mesh.primitiveType == PrimitiveType::Triangles && !mesh.indices.empty()
+        && mesh.indices.size() % 3 == 0) {
+        return createDracoGltfMesh(mesh, rootIndex, gltf, bufferData, bufferSegments, offset, encoding);
+    }
+
     std::optional<AABB> aabb = mesh.aabb;
     glm::dvec3 center = aabb ? aabb->center() : glm::dvec3(0.0);
     glm::dvec3 positionMin = aabb ? aabb->min - center : glm::dvec3(0.0);
     glm::dvec3 positionMax = aabb ? aabb->max - center : glm::dvec3(0.0);
+    bool isQuantized = encoding.quantizeAttributes;
+    bool isCompressed = encoding.meshoptCompression && bufferSegments;
 
     tinygltf::Primitive primitiveGltf;
     primitiveGltf.mode = primitiveTypeToGltfMode(mesh.primitiveType);
@@ -264,108 +542,287 @@ size_t createGltfMesh(const Mesh &mesh,
 
     auto bufferIndex = gltf.buffers.size();
 
-    size_t nextSize = 0;
     size_t totalMeshSize = 0;
-
-    // copy indices
-    if (!mesh.indices.empty()) {
-        nextSize = mesh.indices.size() * sizeof(uint32_t);
-        createBufferAndAccessor(gltf,
-                                bufferData.data() + offset,
-                                mesh.indices.data(),
-                                bufferIndex,
-                                offset,
-                                nextSize,
-                                TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER,
-                                mesh.indices.size(),
-                                TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT,
-                                TINYGLTF_TYPE_SCALAR);
-
-        primitiveGltf.indices = static_cast<int>(gltf.accessors.size() - 1);
+    auto addAccessor = [&](const GltfBufferView &bufferView,
+                           int target,
+                           size_t count,
+                           int componentType,
+                           int type,
+                           bool normalized) {
+        size_t nextSize = createBufferAndAccessor(gltf,
+                                                  bufferData,
+                                                  bufferSegments,
+                                                  bufferView,
+                                                  bufferIndex,
+                                                  offset,
+                                                  target,
+                                                  count,
+                                                  componentType,
+                                                  type,
+                                                  normalized);
         offset += nextSize;
         totalMeshSize += nextSize;
+        return static_cast<int>(gltf.accessors.size() - 1);
+    };
+
+    // copy indices. The largest index of a component type is reserved for primitive restart
+    if (!mesh.indices.empty()) {
+        size_t vertexCount = mesh.getVertexCount();
+        bool isShortIndices = isQuantized && vertexCount < 65535;
+        auto bufferView = referenceBufferView(mesh.indices.data(), mesh.indices.size(), sizeof(uint32_t));
+        if (isShortIndices) {
+            bufferView = quantizeIndices(mesh.indices);
+        }
+
+        if (isCompressed && mesh.primitiveType == PrimitiveType::Triangles && mesh.indices.size() % 3 == 0) {
+            compressIndexBufferView(bufferView, mesh.indices, vertexCount);
+        }
+
+        primitiveGltf.indices = addAccessor(bufferView,
+                                            TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER,
+                                            mesh.indices.size(),
+                                            isShortIndices ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                                                           : TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT,
+                                            TINYGLTF_TYPE_SCALAR,
+                                            false);
     }
 
     // copy batchIDs
     if (!mesh.batchIDs.empty()) {
-        nextSize = mesh.batchIDs.size() * sizeof(float);
-        createBufferAndAccessor(gltf,
-                                bufferData.data() + offset,
-                                mesh.batchIDs.data(),
-                                bufferIndex,
-                                offset,
-                                nextSize,
-                                TINYGLTF_TARGET_ARRAY_BUFFER,
-                                mesh.batchIDs.size(),
-                                TINYGLTF_COMPONENT_TYPE_FLOAT,
-                                TINYGLTF_TYPE_SCALAR);
-
-        primitiveGltf.attributes["_BATCHID"] = static_cast<int>(gltf.accessors.size() - 1);
-        offset += nextSize;
-        totalMeshSize += nextSize;
+        auto bufferView = referenceBufferView(mesh.batchIDs.data(), mesh.batchIDs.size(), sizeof(float));
+        if (isCompressed) {
+            compressVertexBufferView(bufferView, mesh.batchIDs.size());
+        }
+
+        primitiveGltf.attributes["_BATCHID"] = addAccessor(bufferView,
+                                                           TINYGLTF_TARGET_ARRAY_BUFFER,
+                                                           mesh.batchIDs.size(),
+                                                           TINYGLTF_COMPONENT_TYPE_FLOAT,
+                                                           TINYGLTF_TYPE_SCALAR,
+                                                           false);
     }
 
-    // copy positions
+    // copy positions. Quantized positions are scaled back by the mesh node
+    glm::dvec3 positionScale(1.0);
+    bool isPositionQuantized = isQuantized && !mesh.positionRTCs.empty();
     if (!mesh.positionRTCs.empty()) {
-        nextSize = mesh.positionRTCs.size() * sizeof(glm::vec3);
-        createBufferAndAccessor(gltf,
-                                bufferData.data() + offset,
-                                mesh.positionRTCs.data(),
-                                bufferIndex,
-                                offset,
-                                nextSize,
-                                TINYGLTF_TARGET_ARRAY_BUFFER,
-                                mesh.positionRTCs.size(),
-                                TINYGLTF_COMPONENT_TYPE_FLOAT,
-                                TINYGLTF_TYPE_VEC3);
+        const auto &positions = mesh.positionRTCs;
+        auto bufferView = referenceBufferView(positions.data(), positions.size(), sizeof(glm::vec3));
+        if (isPositionQuantized) {
+            // the scale is uniform, otherwise the node would also skew the normals
+            double halfExtent = 0.0;
+            for (const auto &position : positions) {
+                glm::vec3 extent = glm::abs(position);
+                halfExtent = std::max({halfExtent, double(extent.x), double(extent.y), double(extent.z)});
+            }
+
+            positionScale = glm::dvec3(halfExtent > 0.0 ? halfExtent / 32767.0 : 1.0);
+            bufferView = quantizePositions(mesh.positionRTCs, positionScale, positionMin, positionMax);
+        }
+
+        if (isCompressed) {
+            compressVertexBufferView(bufferView, mesh.positionRTCs.size());
+        }
+
+        int componentType = isPositionQuantized ? TINYGLTF_COMPONENT_TYPE_SHORT
+                                                : TINYGLTF_COMPONENT_TYPE_FLOAT;
+        primitiveGltf.attributes["POSITION"] = addAccessor(bufferView,
+                                                           TINYGLTF_TARGET_ARRAY_BUFFER,
+                                                           mesh.positionRTCs.size(),
+                                                           componentType,
+                                                           TINYGLTF_TYPE_VEC3,
+                                                           false);
 
         auto &positionsAccessor = gltf.accessors.back();
         positionsAccessor.minValues = {positionMin.x, positionMin.y, positionMin.z};
         positionsAccessor.maxValues = {positionMax.x, positionMax.y, positionMax.z};
-
-        primitiveGltf.attributes["POSITION"] = static_cast<int>(gltf.accessors.size() - 1);
-        offset += nextSize;
-        totalMeshSize += nextSize;
     }
 
     // copy normals
     if (!mesh.normals.empty()) {
-        nextSize = mesh.normals.size() * sizeof(glm::vec3);
-        createBufferAndAccessor(gltf,
-                                bufferData.data() + offset,
-                                mesh.normals.data(),
-                                bufferIndex,
-                                offset,
-                                nextSize,
-                                TINYGLTF_TARGET_ARRAY_BUFFER,
-                                mesh.normals.size(),
-                                TINYGLTF_COMPONENT_TYPE_FLOAT,
-                                TINYGLTF_TYPE_VEC3);
-
-        primitiveGltf.attributes["NORMAL"] = static_cast<int>(gltf.accessors.size() - 1);
-        offset += nextSize;
-        totalMeshSize += nextSize;
+        auto bufferView = referenceBufferView(mesh.normals.data(), mesh.normals.size(), sizeof(glm::vec3));
+        if (isQuantized) {
+            bufferView = quantizeNormals(mesh.normals);
+        }
+
+        if (isCompressed) {
+            compressVertexBufferView(bufferView, mesh.normals.size());
+        }
+
+        int componentType = isQuantized ? TINYGLTF_COMPONENT_TYPE_BYTE : TINYGLTF_COMPONENT_TYPE_FLOAT;
+        primitiveGltf.attributes["NORMAL"] = addAccessor(bufferView,
+                                                         TINYGLTF_TARGET_ARRAY_BUFFER,
+                                                         mesh.normals.size(),
+                                                         componentType,
+                                                         TINYGLTF_TYPE_VEC3,
+                                                         isQuantized);
     }
 
-    // copy uv
+    // copy uv. Repeated textures have UVs outside of 0..1, which normalized shorts cannot represent
     if (!mesh.UVs.empty()) {
-        nextSize = mesh.UVs.size() * sizeof(glm::vec2);
-        createBufferAndAccessor(gltf,
-                                bufferData.data() + offset,
-                                mesh.UVs.data(),
-                                bufferIndex,
-                                offset,
-                                nextSize,
-                                TINYGLTF_TARGET_ARRAY_BUFFER,
-                                mesh.UVs.size(),
-                                TINYGLTF_COMPONENT_TYPE_FLOAT,
-                                TINYGLTF_TYPE_VEC2);
-
-        primitiveGltf.attributes["TEXCOORD_0"] = static_cast<int>(gltf.accessors.size() - 1);
-        offset += nextSize;
-        totalMeshSize += nextSize;
+        auto isNormalizedUV = [](const glm::vec2 &UV) {
+            return glm::all(glm::greaterThanEqual(UV, glm::vec2(0.0f)))
+                   && glm::all(glm::lessThanEqual(UV, glm::vec2(1.0f)));
+        };
+
+        bool isUVQuantized = isQuantized && std::all_of(mesh.UVs.begin(), mesh.UVs.end(), isNormalizedUV);
+        auto bufferView = referenceBufferView(mesh.UVs.data(), mesh.UVs.size(), sizeof(glm::vec2));
+        if (isUVQuantized) {
+            bufferView = quantizeUVs(mesh.UVs);
+        }
+
+        if (isCompressed) {
+            compressVertexBufferView(bufferView, mesh.UVs.size());
+        }
+
+        int componentType = isUVQuantized ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                                          : TINYGLTF_COMPONENT_TYPE_FLOAT;
+        primitiveGltf.attributes["TEXCOORD_0"] = addAccessor(bufferView,
+                                                             TINYGLTF_TARGET_ARRAY_BUFFER,
+                                                             mesh.UVs.size(),
+                                                             componentType,
+                                                             TINYGLTF_TYPE_VEC2,
+                                                             isUVQuantized);
     }
 
+    if (isQuantized) {
+        addRequiredExtension(gltf, "KHR_mesh_quantization");
+    }
+
+    std::vector<double> scale;
+    if (isPositionQuantized) {
+        scale = {positionScale.x, positionScale.y, positionScale.z};
+    }
+
+    createGltfMeshNode(primitiveGltf, center, scale, rootIndex, gltf);
+
+    return totalMeshSize;
+}
+
+size_t createDracoGltfMesh(const Mesh &mesh,
+                           size_t rootIndex,
+                           tinygltf::Model &gltf,
+                           std::vector<unsigned char> &bufferData,
+                           std::vector<GltfBufferSegment> *bufferSegments,
+                           size_t offset,
+                           const GltfEncoding &encoding)
+{
+    std::optional<AABB> aabb = mesh.aabb;
+    glm::dvec3 center = aabb ? aabb->center() : glm::dvec3(0.0);
+    glm::dvec3 positionMin = aabb ? aabb->min - center : glm::dvec3(0.0);
+    glm::dvec3 positionMax = aabb ? aabb->max - center : glm::dvec3(0.0);
+    size_t vertexCount = mesh.getVertexCount();
+
+    tinygltf::Primitive primitiveGltf;
+    primitiveGltf.mode = primitiveTypeToGltfMode(mesh.primitiveType);
+    if (mesh.material != -1) {
+        primitiveGltf.material = mesh.material;
+    }
+
+    // the accessors describe the decoded data, so they have no buffer view
+    auto addAccessor = [&](size_t count, int componentType, int type) {
+        tinygltf::Accessor accessorGltf;
+        accessorGltf.count = count;
+        accessorGltf.componentType = componentType;
+        accessorGltf.type = type;
+        gltf.accessors.emplace_back(accessorGltf);
+        return static_cast<int>(gltf.accessors.size() - 1);
+    };
+
+    draco::Mesh dracoMesh;
+    dracoMesh.set_num_points(static_cast<uint32_t>(vertexCount));
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        dracoMesh.AddFace({draco::PointIndex(mesh.indices[i]),
+                           draco::PointIndex(mesh.indices[i + 1]),
+                           draco::PointIndex(mesh.indices[i + 2])});
+    }
+
+    tinygltf::Value::Object dracoAttributes;
+    auto addDracoAttribute = [&](const std::string &name,
+                                 draco::GeometryAttribute::Type attributeType,
+                                 const void *data,
+                                 int8_t componentCount,
+                                 int accessorType) {
+        draco::GeometryAttribute attribute;
+        size_t byteStride = sizeof(float) * static_cast<size_t>(componentCount);
+        auto dracoByteStride = static_cast<int64_t>(byteStride);
+        attribute.Init(attributeType, nullptr, componentCount, draco::DT_FLOAT32, false, dracoByteStride, 0);
+        int attributeId = dracoMesh.AddAttribute(attribute, true, static_cast<uint32_t>(vertexCount));
+        auto pointAttribute = dracoMesh.attribute(attributeId);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            const auto *value = static_cast<const unsigned char *>(data) + i * byteStride;
+            pointAttribute->SetAttributeValue(draco::AttributeValueIndex(static_cast<uint32_t>(i)), value);
+        }
+
+        int accessor = addAccessor(vertexCount, TINYGLTF_COMPONENT_TYPE_FLOAT, accessorType);
+        primitiveGltf.attributes[name] = accessor;
+        dracoAttributes[name] = tinygltf::Value(static_cast<int>(pointAttribute->unique_id()));
+    };
+
+    // batch IDs are generic attributes, which Draco does not quantize
+    if (mesh.batchIDs.size() == vertexCount) {
+        addDracoAttribute(
+            "_BATCHID", draco::GeometryAttribute::GENERIC, mesh.batchIDs.data(), 1, TINYGLTF_TYPE_SCALAR);
+    }
+
+    if (mesh.positionRTCs.size() == vertexCount) {
+        addDracoAttribute(
+            "POSITION", draco::GeometryAttribute::POSITION, mesh.positionRTCs.data(), 3, TINYGLTF_TYPE_VEC3);
+
+        auto &positionsAccessor = gltf.accessors.back();
+        positionsAccessor.minValues = {positionMin.x, positionMin.y, positionMin.z};
+        positionsAccessor.maxValues = {positionMax.x, positionMax.y, positionMax.z};
+    }
+
+    if (mesh.normals.size() == vertexCount) {
+        addDracoAttribute(
+            "NORMAL", draco::GeometryAttribute::NORMAL, mesh.normals.data(), 3, TINYGLTF_TYPE_VEC3);
+    }
+
+    if (mesh.UVs.size() == vertexCount) {
+        addDracoAttribute(
+            "TEXCOORD_0", draco::GeometryAttribute::TEX_COORD, mesh.UVs.data(), 2, TINYGLTF_TYPE_VEC2);
+    }
+
+    draco::Encoder encoder;
+    encoder.SetAttributeQuantization(draco::GeometryAttribute::POSITION, encoding.dracoPositionBits);
+    encoder.SetAttributeQuantization(draco::GeometryAttribute::NORMAL, encoding.dracoNormalBits);
+    encoder.SetAttributeQuantization(draco::GeometryAttribute::TEX_COORD, encoding.dracoUVBits);
+
+    draco::EncoderBuffer encoded;
+    draco::Status status = encoder.EncodeMeshToBuffer(dracoMesh, &encoded);
+    if (!status.ok()) {
+        throw std::runtime_error("Draco cannot compress mesh: " + status.error_msg_string());
+    }
+
+    primitiveGltf.indices = addAccessor(mesh.indices.size(),
+                                        vertexCount < 65535 ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                                                            : TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT,
+                                        TINYGLTF_TYPE_SCALAR);
+
+    const auto *encodedData = reinterpret_cast<const unsigned char *>(encoded.data());
+    auto bufferView = storeBufferView(
+        std::vector<unsigned char>(encodedData, encodedData + encoded.size()), sizeof(unsigned char), 0);
+    size_t totalMeshSize = createBufferView(
+        gltf, bufferData, bufferSegments, bufferView, gltf.buffers.size(), offset, 0);
+
+    tinygltf::Value::Object dracoExtension;
+    dracoExtension["bufferView"] = tinygltf::Value(static_cast<int>(gltf.bufferViews.size() - 1));
+    dracoExtension["attributes"] = tinygltf::Value(dracoAttributes);
+    primitiveGltf.extensions["KHR_draco_mesh_compression"] = tinygltf::Value(dracoExtension);
+    addRequiredExtension(gltf, "KHR_draco_mesh_compression");
+
+    createGltfMeshNode(primitiveGltf, center, {}, rootIndex, gltf);
+
+    return totalMeshSize;
+}
+
+void createGltfMeshNode(const tinygltf::Primitive &primitiveGltf,
+                        const glm::dvec3 &translation,
+                        const std::vector<double> &scale,
+                        size_t rootIndex,
+                        tinygltf::Model &gltf)
+{
     // add mesh
     tinygltf::Mesh meshGltf;
     meshGltf.primitives.emplace_back(primitiveGltf);
@@ -374,13 +831,29 @@ size_t createGltfMesh(const Mesh &mesh,
     // create node
     tinygltf::Node meshNode;
     meshNode.mesh = static_cast<int>(gltf.meshes.size() - 1);
-    meshNode.translation = {center.x, center.y, center.z};
+    meshNode.translation = {translation.x, translation.y, translation.z};
+    meshNode.scale = scale;
     gltf.nodes.emplace_back(meshNode);
 
     // add node to the root
     gltf.nodes[rootIndex].children.emplace_back(gltf.nodes.size() - 1);
+}
 
-    return totalMeshSize;
+size_t computeBufferSize(const Mesh &mesh)
+{
+    return mesh.indices.size() * sizeof(uint32_t) + mesh.batchIDs.size() * sizeof(float)
+           + mesh.positionRTCs.size() * sizeof(glm::vec3) + mesh.normals.size() * sizeof(glm::vec3)
+           + mesh.UVs.size() * sizeof(glm::vec2);
+}
+
+size_t computeBinaryByteLength(const std::vector<GltfBufferSegment> &bufferSegments)
+{
+    size_t binaryByteLength = 0;
+    for (const auto &segment : bufferSegments) {
+        binaryByteLength += segment.byteLength;
+    }
+
+    return binaryByteLength;
 }
 
 int primitiveTypeToGltfMode(PrimitiveType type)
@@ -427,33 +900,167 @@ int convertToGltfFilterMode(TextureFilter mode)
     }
 }
 
-void createBufferAndAccessor(tinygltf::Model &modelGltf,
-                             void *destBuffer,
-                             const void *sourceBuffer,
-                             size_t bufferIndex,
-                             size_t bufferViewOffset,
-                             size_t bufferViewLength,
-                             int bufferViewTarget,
-                             size_t accessorComponentCount,
-                             int accessorComponentType,
-                             int accessorType)
+void addRequiredExtension(tinygltf::Model &gltf, const std::string &extension)
 {
-    std::memcpy(destBuffer, sourceBuffer, bufferViewLength);
+    if (std::find(gltf.extensionsRequired.begin(), gltf.extensionsRequired.end(), extension)
+        == gltf.extensionsRequired.end()) {
+        gltf.extensionsUsed.emplace_back(extension);
+        gltf.extensionsRequired.emplace_back(extension);
+    }
+}
 
-    tinygltf::BufferView bufferViewGltf;
-    bufferViewGltf.buffer = static_cast<int>(bufferIndex);
-    bufferViewGltf.byteOffset = bufferViewOffset;
-    bufferViewGltf.byteLength = bufferViewLength;
-    bufferViewGltf.target = bufferViewTarget;
+GltfBufferView referenceBufferView(const void *data, size_t count, size_t elementSize)
+{
+    return {data, count * elementSize, count * elementSize, elementSize, 0, nullptr, std::nullopt};
+}
+
+GltfBufferView storeBufferView(std::vector<unsigned char> data, size_t elementSize, size_t byteStride)
+{
+    // buffer views that follow stay aligned on 4 bytes
+    size_t byteLength = data.size();
+    data.resize(roundUp(byteLength, 4), 0);
+    auto storage = std::make_shared<const std::vector<unsigned char>>(std::move(data));
+    return {storage->data(), byteLength, storage->size(), elementSize, byteStride, storage, std::nullopt};
+}
+
+GltfBufferView quantizeIndices(const std::vector<uint32_t> &indices)
+{
+    std::vector<unsigned char> data(indices.size() * sizeof(uint16_t));
+    for (size_t i = 0; i < indices.size(); ++i) {
+        uint16_t index = static_cast<uint16_t>(indices[i]);
+        std::memcpy(data.data() + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+    }
+
+    return storeBufferView(std::move(data), sizeof(uint16_t), 0);
+}
+
+GltfBufferView quantizePositions(const std::vector<glm::vec3> &positions,
+                                 const glm::dvec3 &scale,
+                                 glm::dvec3 &quantizedMin,
+                                 glm::dvec3 &quantizedMax)
+{
+    // vertex attributes are aligned on 4 bytes, so every position is padded with a fourth short
+    std::vector<unsigned char> data(positions.size() * 4 * sizeof(int16_t));
+    quantizedMin = glm::dvec3(std::numeric_limits<double>::max());
+    quantizedMax = glm::dvec3(std::numeric_limits<double>::lowest());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        glm::dvec3 quantized = glm::clamp(glm::round(glm::dvec3(positions[i]) / scale), -32767.0, 32767.0);
+        quantizedMin = glm::min(quantizedMin, quantized);
+        quantizedMax = glm::max(quantizedMax, quantized);
+
+        int16_t position[4] = {static_cast<int16_t>(quantized.x),
+                               static_cast<int16_t>(quantized.y),
+                               static_cast<int16_t>(quantized.z),
+                               0};
+        std::memcpy(data.data() + i * sizeof(position), position, sizeof(position));
+    }
+
+    return storeBufferView(std::move(data), 4 * sizeof(int16_t), 4 * sizeof(int16_t));
+}
+
+GltfBufferView quantizeNormals(const std::vector<glm::vec3> &normals)
+{
+    std::vector<unsigned char> data(normals.size() * 4);
+    for (size_t i = 0; i < normals.size(); ++i) {
+        int8_t normal[4] = {static_cast<int8_t>(meshopt_quantizeSnorm(normals[i].x, 8)),
+                            static_cast<int8_t>(meshopt_quantizeSnorm(normals[i].y, 8)),
+                            static_cast<int8_t>(meshopt_quantizeSnorm(normals[i].z, 8)),
+                            0};
+        std::memcpy(data.data() + i * sizeof(normal), normal, sizeof(normal));
+    }
+
+    return storeBufferView(std::move(data), 4, 4);
+}
+
+GltfBufferView quantizeUVs(const std::vector<glm::vec2> &UVs)
+{
+    std::vector<unsigned char> data(UVs.size() * 2 * sizeof(uint16_t));
+    for (size_t i = 0; i < UVs.size(); ++i) {
+        uint16_t UV[2] = {static_cast<uint16_t>(meshopt_quantizeUnorm(UVs[i].x, 16)),
+                          static_cast<uint16_t>(meshopt_quantizeUnorm(UVs[i].y, 16))};
+        std::memcpy(data.data() + i * sizeof(UV), UV, sizeof(UV));
+    }
+
+    return storeBufferView(std::move(data), 2 * sizeof(uint16_t), 0);
+}
+
+void compressVertexBufferView(GltfBufferView &bufferView, size_t count)
+{
+    std::vector<unsigned char> encoded(meshopt_encodeVertexBufferBound(count, bufferView.elementSize));
+    encoded.resize(meshopt_encodeVertexBuffer(
+        encoded.data(), encoded.size(), bufferView.data, count, bufferView.elementSize));
+
+    GltfMeshoptCompression compression{"ATTRIBUTES", count, bufferView.elementSize, bufferView.byteLength};
+    bufferView = storeBufferView(std::move(encoded), bufferView.elementSize, bufferView.byteStride);
+    bufferView.meshoptCompression = compression;
+}
+
+void compressIndexBufferView(GltfBufferView &bufferView,
+                             const std::vector<uint32_t> &indices,
+                             size_t vertexCount)
+{
+    std::vector<unsigned char> encoded(meshopt_encodeIndexBufferBound(indices.size(), vertexCount));
+    encoded.resize(meshopt_encodeIndexBuffer(encoded.data(), encoded.size(), indices.data(), indices.size()));
+
+    GltfMeshoptCompression compression{
+        "TRIANGLES", indices.size(), bufferView.elementSize, bufferView.byteLength};
+    bufferView = storeBufferView(std::move(encoded), bufferView.elementSize, 0);
+    bufferView.meshoptCompression = compression;
+}
+
+size_t createBufferAndAccessor(tinygltf::Model &modelGltf,
+                               std::vector<unsigned char> &bufferData,
+                               std::vector<GltfBufferSegment> *bufferSegments,
+                               const GltfBufferView &bufferView,
+                               size_t bufferIndex,
+                               size_t bufferViewOffset,
+                               int bufferViewTarget,
+                               size_t accessorComponentCount,
+                               int accessorComponentType,
+                               int accessorType,
+                               bool accessorNormalized)
+{
+    createBufferView(
+        modelGltf, bufferData, bufferSegments, bufferView, bufferIndex, bufferViewOffset, bufferViewTarget);
 
     tinygltf::Accessor accessorGltf;
-    accessorGltf.bufferView = static_cast<int>(modelGltf.bufferViews.size());
+    accessorGltf.bufferView = static_cast<int>(modelGltf.bufferViews.size() - 1);
     accessorGltf.byteOffset = 0;
     accessorGltf.count = accessorComponentCount;
     accessorGltf.componentType = accessorComponentType;
     accessorGltf.type = accessorType;
+    accessorGltf.normalized = accessorNormalized;
+    modelGltf.accessors.emplace_back(accessorGltf);
+
+    return bufferView.paddedByteLength;
+}
+
+size_t createBufferView(tinygltf::Model &modelGltf,
+                        std::vector<unsigned char> &bufferData,
+                        std::vector<GltfBufferSegment> *bufferSegments,
+                        const GltfBufferView &bufferView,
+                        size_t bufferIndex,
+                        size_t bufferViewOffset,
+                        int bufferViewTarget)
+{
+    if (bufferSegments) {
+        bufferSegments->push_back({bufferView.data,
+                                   bufferView.paddedByteLength,
+                                   bufferView.storage,
+                                   bufferView.meshoptCompression});
+    } else {
+        bufferData.resize(bufferViewOffset + bufferView.paddedByteLength, 0);
+        std::memcpy(bufferData.data() + bufferViewOffset, bufferView.data, bufferView.byteLength);
+    }
 
+    tinygltf::BufferView bufferViewGltf;
+    bufferViewGltf.buffer = static_cast<int>(bufferIndex);
+    bufferViewGltf.byteOffset = bufferViewOffset;
+    bufferViewGltf.byteLength = bufferView.byteLength;
+    bufferViewGltf.byteStride = bufferView.byteStride;
+    bufferViewGltf.target = bufferViewTarget;
     modelGltf.bufferViews.emplace_back(bufferViewGltf);
-    modelGltf.accessors.emplace_back(accessorGltf);
+
+    return bufferView.paddedByteLength;
 }
 } // namespace CDBTo3DTiles
@@ -4,15 +4,76 @@
 #include "tiny_gltf.h"
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
 namespace CDBTo3DTiles {
 
-tinygltf::Model createGltf(const Mesh &mesh, const Material *material, const Texture *texture);
+// buffer view data compressed with EXT_meshopt_compression. The mode, count and byte stride are the ones of
+// the extension, and the byte length is the one of the decoded data
+struct GltfMeshoptCompression
+{
+    std::string mode;
+    size_t count;
+    size_t byteStride;
+    size_t byteLength;
+};
+
+// mesh data referenced in place by the glTF buffer. The meshes must outlive the segments, except for the
+// quantized or compressed data, which are owned by the segment storage
+struct GltfBufferSegment
+{
+    const void *data;
+    size_t byteLength;
+    std::shared_ptr<const std::vector<unsigned char>> storage;
+    std::optional<GltfMeshoptCompression> meshoptCompression;
+};
+
+// quantized attributes use KHR_mesh_quantization: positions become shorts scaled by the mesh node, normals
+// normalized bytes and UVs within 0..1 normalized unsigned shorts. Indices become unsigned shorts when the
+// vertices allow it. The buffer views are only compressed with EXT_meshopt_compression when they are written
+// as segments. Draco compresses the triangle meshes with KHR_draco_mesh_compression instead, quantizing the
+// attributes to the given number of bits
+struct GltfEncoding
+{
+    GltfEncoding();
+
+    bool quantizeAttributes;
+    bool meshoptCompression;
+    bool dracoCompression;
+    int dracoPositionBits;
+    int dracoNormalBits;
+    int dracoUVBits;
+};
+
+// reorders the triangles and vertices of a triangle mesh for the vertex cache, overdraw and vertex fetch of
+// the GPU. Vertices that no triangle refers to are dropped
+void optimizeMeshForRendering(Mesh &mesh);
+
+// when buffer segments are requested, the buffer of the model is left empty and the segments reference
+// the mesh data instead of copying them
+tinygltf::Model createGltf(const Mesh &mesh,
+                           const Material *material,
+                           const Texture *texture,
+                           std::vector<GltfBufferSegment> *bufferSegments = nullptr,
+                           const GltfEncoding &encoding = GltfEncoding());
 
 tinygltf::Model createGltf(const std::vector<Mesh> &meshes,
                            const std::vector<Material> &materials,
-                           const std::vector<Texture> &textures);
+                           const std::vector<Texture> &textures,
+                           std::vector<GltfBufferSegment> *bufferSegments = nullptr,
+                           const GltfEncoding &encoding = GltfEncoding());
+
+std::string createGlbJson(tinygltf::Model *gltf, const std::vector<GltfBufferSegment> &bufferSegments);
+
+size_t computeGlbByteLength(const std::string &glbJson, const std::vector<GltfBufferSegment> &bufferSegments);
+
+void writeToGlb(const std::string &glbJson,
+                const std::vector<GltfBufferSegment> &bufferSegments,
+                std::ostream &os);
 
 } // namespace CDBTo3DTiles
@@ -0,0 +1,337 @@
+#include "MappedZipArchive.h"
+#include "zlib.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CDBTo3DTiles {
+static constexpr uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+static constexpr uint32_t CENTRAL_DIRECTORY_HEADER_SIGNATURE = 0x02014b50;
+static constexpr uint32_t LOCAL_FILE_HEADER_SIGNATURE = 0x04034b50;
+static constexpr size_t END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+static constexpr size_t CENTRAL_DIRECTORY_HEADER_SIZE = 46;
+static constexpr size_t LOCAL_FILE_HEADER_SIZE = 30;
+static constexpr size_t MAX_ZIP_COMMENT_SIZE = 65535;
+static constexpr uint16_t STORED_METHOD = 0;
+static constexpr uint16_t DEFLATE_METHOD = 8;
+static constexpr uint16_t ENCRYPTED_FLAG = 1;
+
+static uint16_t readUint16(const unsigned char *data);
+
+static uint32_t readUint32(const unsigned char *data);
+
+MappedZipArchive::Entry::Entry()
+    : method{0}
+    , compressedSize{0}
+    , uncompressedSize{0}
+    , localHeaderOffset{0}
+{}
+
+MappedZipArchive::MappedZipArchive()
+    : m_data{nullptr}
+    , m_size{0}
+#ifdef _WIN32
+    , m_file{INVALID_HANDLE_VALUE}
+    , m_mapping{nullptr}
+#endif
+{}
+
+MappedZipArchive::~MappedZipArchive() noexcept
+{
+    // the data of an archive opened from memory belongs to the buffer
+    if (!m_buffer.empty()) {
+        return;
+    }
+
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_data) {
+        munmap(const_cast<unsigned char *>(m_data), m_size);
+    }
+#endif
+}
+
+std::unique_ptr<MappedZipArchive> MappedZipArchive::open(const std::filesystem::path &zipPath)
+{
+    std::unique_ptr<MappedZipArchive> zip(new MappedZipArchive());
+#ifdef _WIN32
+    zip->m_file = CreateFileW(zipPath.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (zip->m_file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(zip->m_file, &fileSize) || fileSize.QuadPart == 0) {
+        return nullptr;
+    }
+
+    zip->m_mapping = CreateFileMappingW(zip->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!zip->m_mapping) {
+        return nullptr;
+    }
+
+    zip->m_data = static_cast<const unsigned char *>(MapViewOfFile(zip->m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!zip->m_data) {
+        return nullptr;
+    }
+
+    zip->m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int file = ::open(zipPath.c_str(), O_RDONLY);
+    if (file < 0) {
+        return nullptr;
+    }
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(file);
+        return nullptr;
+    }
+
+    // the mapping stays valid once the file is closed
+    size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    void *data = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    zip->m_data = static_cast<const unsigned char *>(data);
+    zip->m_size = fileSize;
+#endif
+
+    if (!zip->readCentralDirectory()) {
+        return nullptr;
+    }
+
+    return zip;
+}
+
+std::unique_ptr<MappedZipArchive> MappedZipArchive::open(std::vector<char> buffer)
+{
+    if (buffer.empty()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedZipArchive> zip(new MappedZipArchive());
+    zip->m_buffer = std::move(buffer);
+    zip->m_data = reinterpret_cast<const unsigned char *>(zip->m_buffer.data());
+    zip->m_size = zip->m_buffer.size();
+    if (!zip->readCentralDirectory()) {
+        return nullptr;
+    }
+
+    return zip;
+}
+
+bool MappedZipArchive::hasEntry(const std::string &name) const
+{
+    return m_entries.find(name) != m_entries.end();
+}
+
+std::optional<std::string_view> MappedZipArchive::readEntry(const std::string &name,
+                                                            std::vector<char> &buffer) const
+{
+    auto found = m_entries.find(name);
+    if (found == m_entries.end()) {
+        return std::nullopt;
+    }
+
+    // the local header repeats the name and may have a different extra field than the central directory
+    const Entry &entry = found->second;
+    if (entry.localHeaderOffset + LOCAL_FILE_HEADER_SIZE > m_size) {
+        return std::nullopt;
+    }
+
+    const unsigned char *localHeader = m_data + entry.localHeaderOffset;
+    if (readUint32(localHeader) != LOCAL_FILE_HEADER_SIGNATURE) {
+        return std::nullopt;
+    }
+
+    uint64_t dataOffset = entry.localHeaderOffset + LOCAL_FILE_HEADER_SIZE + readUint16(localHeader + 26)
+                          + readUint16(localHeader + 28);
+    if (dataOffset + entry.compressedSize > m_size) {
+        return std::nullopt;
+    }
+
+    const char *data = reinterpret_cast<const char *>(m_data + dataOffset);
+    if (entry.method == STORED_METHOD) {
+        if (entry.compressedSize != entry.uncompressedSize) {
+            return std::nullopt;
+        }
+
+        return std::string_view(data, static_cast<size_t>(entry.compressedSize));
+    }
+
+    if (entry.method != DEFLATE_METHOD) {
+        return std::nullopt;
+    }
+
+    if (entry.uncompressedSize == 0) {
+        return std::string_view();
+    }
+
+    // zip entries are raw deflate streams without the zlib header, and their size is known beforehand
+    buffer.resize(static_cast<size_t>(entry.uncompressedSize));
+    z_stream stream{};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return std::nullopt;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(entry.compressedSize);
+    stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+    stream.avail_out = static_cast<uInt>(buffer.size());
+    int result = inflate(&stream, Z_FINISH);
+    uLong inflatedSize = stream.total_out;
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END || inflatedSize != entry.uncompressedSize) {
+        return std::nullopt;
+    }
+
+    return std::string_view(buffer.data(), buffer.size());
+}
+
+bool MappedZipArchive::readCentralDirectory()
+{
+    // the end of central directory record is followed by the comment of the archive. Zip64 archives are not
+    // supported
+    if (m_size < END_OF_CENTRAL_DIRECTORY_SIZE) {
+        return false;
+    }
+
+    size_t lastRecord = m_size - END_OF_CENTRAL_DIRECTORY_SIZE;
+    size_t firstRecord = lastRecord > MAX_ZIP_COMMENT_SIZE ? lastRecord - MAX_ZIP_COMMENT_SIZE : 0;
+    const unsigned char *endOfCentralDirectory = nullptr;
+    for (size_t i = lastRecord + 1; i > firstRecord; --i) {
+        if (readUint32(m_data + i - 1) == END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+            endOfCentralDirectory = m_data + i - 1;
+            break;
+        }
+    }
+
+    if (!endOfCentralDirectory) {
+        return false;
+    }
+
+    size_t entryCount = readUint16(endOfCentralDirectory + 10);
+    size_t centralDirectorySize = readUint32(endOfCentralDirectory + 12);
+    size_t centralDirectoryOffset = readUint32(endOfCentralDirectory + 16);
+    if (centralDirectoryOffset + centralDirectorySize > static_cast<size_t>(endOfCentralDirectory - m_data)) {
+        return false;
+    }
+
+    const unsigned char *header = m_data + centralDirectoryOffset;
+    const unsigned char *centralDirectoryEnd = header + centralDirectorySize;
+    m_entryNames.reserve(entryCount);
+    m_entries.reserve(entryCount);
+    for (size_t i = 0; i < entryCount; ++i) {
+        if (header + CENTRAL_DIRECTORY_HEADER_SIZE > centralDirectoryEnd
+            || readUint32(header) != CENTRAL_DIRECTORY_HEADER_SIGNATURE) {
+            return false;
+        }
+
+        uint16_t flags = readUint16(header + 8);
+        size_t nameSize = readUint16(header + 28);
+        size_t extraSize = readUint16(header + 30);
+        size_t commentSize = readUint16(header + 32);
+        size_t headerSize = CENTRAL_DIRECTORY_HEADER_SIZE + nameSize + extraSize + commentSize;
+        const unsigned char *next = header + headerSize;
+        if (next > centralDirectoryEnd) {
+            return false;
+        }
+
+        std::string name(reinterpret_cast<const char *>(header + CENTRAL_DIRECTORY_HEADER_SIZE), nameSize);
+        std::replace(name.begin(), name.end(), '\\', '/');
+
+        // directories and encrypted entries can't be read
+        if (!name.empty() && name.back() != '/' && (flags & ENCRYPTED_FLAG) == 0) {
+            Entry entry;
+            entry.method = readUint16(header + 10);
+            entry.compressedSize = readUint32(header + 20);
+            entry.uncompressedSize = readUint32(header + 24);
+            entry.localHeaderOffset = readUint32(header + 42);
+            if (m_entries.insert({name, entry}).second) {
+                m_entryNames.emplace_back(std::move(name));
+            }
+        }
+
+        header = next;
+    }
+
+    return true;
+}
+
+MemoryStreamBuffer::MemoryStreamBuffer(std::string_view data)
+{
+    // the buffer is only read, std::streambuf just doesn't have a const get area
+    char *begin = const_cast<char *>(data.data());
+    setg(begin, begin, begin + data.size());
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type offset,
+                                                         std::ios_base::seekdir direction,
+                                                         std::ios_base::openmode which)
+{
+    if (which & std::ios_base::out) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type position = offset;
+    if (direction == std::ios_base::cur) {
+        position += gptr() - eback();
+    } else if (direction == std::ios_base::end) {
+        position += egptr() - eback();
+    }
+
+    if (position < 0 || position > egptr() - eback()) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), eback() + position, egptr());
+    return pos_type(position);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type position, std::ios_base::openmode which)
+{
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+uint16_t readUint16(const unsigned char *data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t readUint32(const unsigned char *data)
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8)
+           | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+} // namespace CDBTo3DTiles
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace CDBTo3DTiles {
+// a read-only zip archive mapped in memory. Entries are read from several threads at once: stored entries are
+// returned from the mapping without a copy, deflated ones are inflated straight from it
+class MappedZipArchive
+{
+public:
+    MappedZipArchive(const MappedZipArchive &) = delete;
+
+    MappedZipArchive &operator=(const MappedZipArchive &) = delete;
+
+    ~MappedZipArchive() noexcept;
+
+    // returns nullptr if the file can't be mapped or isn't a zip archive
+    static std::unique_ptr<MappedZipArchive> open(const std::filesystem::path &zipPath);
+
+    // reads the archive from memory instead, for archives that can't be mapped like the ones in object storage.
+    // Returns nullptr if the buffer isn't a zip archive
+    static std::unique_ptr<MappedZipArchive> open(std::vector<char> buffer);
+
+    inline const std::vector<std::string> &getEntryNames() const noexcept { return m_entryNames; }
+
+    bool hasEntry(const std::string &name) const;
+
+    // the data lives in the mapping, or in buffer for deflated entries. Encrypted entries and compression
+    // methods other than deflate are not supported
+    std::optional<std::string_view> readEntry(const std::string &name, std::vector<char> &buffer) const;
+
+private:
+    struct Entry
+    {
+        Entry();
+
+        uint16_t method;
+        uint64_t compressedSize;
+        uint64_t uncompressedSize;
+        uint64_t localHeaderOffset;
+    };
+
+    MappedZipArchive();
+
+    bool readCentralDirectory();
+
+    const unsigned char *m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void *m_file;
+    void *m_mapping;
+#endif
+    std::vector<char> m_buffer;
+    std::vector<std::string> m_entryNames;
+    std::unordered_map<std::string, Entry> m_entries;
+};
+
+// reads a memory block through std::istream without copying it
+class MemoryStreamBuffer : public std::streambuf
+{
+public:
+    explicit MemoryStreamBuffer(std::string_view data);
+
+protected:
+    pos_type seekoff(off_type offset,
+                     std::ios_base::seekdir direction,
+                     std::ios_base::openmode which) override;
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+};
+} // namespace CDBTo3DTiles
@@ -0,0 +1,100 @@
+#include "MemoryBudget.h"
+#include "ConversionStats.h"
+#include <chrono>
+
+namespace CDBTo3DTiles {
+MemoryBudget::MemoryBudget(uint64_t maxBytes,
+                           ResidentBytesFunction getResidentBytes,
+                           std::chrono::steady_clock::duration checkInterval)
+    : m_maxBytes{maxBytes}
+    , m_getResidentBytes{std::move(getResidentBytes)}
+    , m_checkInterval{checkInterval}
+    , m_geoCellsInFlight{0}
+    , m_nextCheck{}
+    , m_shrunkResidentBytes{0}
+{
+    if (!m_getResidentBytes) {
+        m_getResidentBytes = &ConversionStats::getResidentBytes;
+    }
+}
+
+bool MemoryBudget::isExceeded() const
+{
+    return m_getResidentBytes() > m_maxBytes;
+}
+
+bool MemoryBudget::shouldShrinkCaches()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (now < m_nextCheck) {
+        return false;
+    }
+
+    m_nextCheck = now + m_checkInterval;
+    uint64_t residentBytes = m_getResidentBytes();
+    if (residentBytes <= m_maxBytes) {
+        m_shrunkResidentBytes = 0;
+        return false;
+    }
+
+    if (m_shrunkResidentBytes != 0 && residentBytes < m_shrunkResidentBytes + m_maxBytes / 10) {
+        return false;
+    }
+
+    m_shrunkResidentBytes = residentBytes;
+    return true;
+}
+
+size_t MemoryBudget::getGeoCellsInFlight() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_geoCellsInFlight;
+}
+
+bool MemoryBudget::tryAcquireGeoCell()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_geoCellsInFlight > 0 && isExceeded()) {
+        return false;
+    }
+
+    ++m_geoCellsInFlight;
+    return true;
+}
+
+void MemoryBudget::acquireGeoCell(ThreadPool &threadPool)
+{
+    while (!tryAcquireGeoCell()) {
+        if (threadPool.runPendingTask()) {
+            continue;
+        }
+
+        // the resident memory also falls while a GeoCell is converted, so it is read again every few
+        // milliseconds and not only when a GeoCell is released
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait_for(lock, std::chrono::milliseconds(10));
+    }
+}
+
+void MemoryBudget::releaseGeoCell()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_geoCellsInFlight;
+    }
+
+    m_condition.notify_all();
+}
+
+ScopedGeoCellRelease::ScopedGeoCellRelease(MemoryBudget *budget) noexcept
+    : m_budget{budget}
+{}
+
+ScopedGeoCellRelease::~ScopedGeoCellRelease() noexcept
+{
+    if (m_budget) {
+        m_budget->releaseGeoCell();
+    }
+}
+} // namespace CDBTo3DTiles
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace CDBTo3DTiles {
+// admits GeoCells into the conversion while the resident memory of the process is under the budget, so the
+// GeoCells in flight finish and free their tilesets and caches before the next ones start. A GeoCell is
+// always admitted when none is in flight, and the converter asks shouldShrinkCaches between its tiles, so one
+// GeoCell larger than the budget doesn't keep growing
+class MemoryBudget
+{
+public:
+    using ResidentBytesFunction = std::function<uint64_t()>;
+
+    explicit MemoryBudget(uint64_t maxBytes,
+                          ResidentBytesFunction getResidentBytes = nullptr,
+                          std::chrono::steady_clock::duration checkInterval = std::chrono::milliseconds(100));
+
+    MemoryBudget(const MemoryBudget &) = delete;
+
+    MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+    inline uint64_t getMaxBytes() const noexcept { return m_maxBytes; }
+
+    bool isExceeded() const;
+
+    // reads the resident memory at most once per check interval. The memory freed by the caches is rarely
+    // given back to the system, so once they are shrunk over the budget, they are only shrunk again after
+    // the resident memory grows by another tenth of the budget, or falls under the budget first
+    bool shouldShrinkCaches();
+
+    size_t getGeoCellsInFlight() const;
+
+    // returns whether the GeoCell is admitted, without waiting
+    bool tryAcquireGeoCell();
+
+    // waits for the GeoCell to be admitted, running the pending tasks of the pool meanwhile so that the
+    // GeoCells in flight progress on this thread too
+    void acquireGeoCell(ThreadPool &threadPool);
+
+    void releaseGeoCell();
+
+private:
+    uint64_t m_maxBytes;
+    ResidentBytesFunction m_getResidentBytes;
+    std::chrono::steady_clock::duration m_checkInterval;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    size_t m_geoCellsInFlight;
+    std::chrono::steady_clock::time_point m_nextCheck;
+    uint64_t m_shrunkResidentBytes;
+};
+
+// releases the GeoCell admitted before its task was submitted, even when its conversion throws. Does nothing
+// without a budget
+class ScopedGeoCellRelease
+{
+public:
+    explicit ScopedGeoCellRelease(MemoryBudget *budget) noexcept;
+
+    ScopedGeoCellRelease(const ScopedGeoCellRelease &) = delete;
+
+    ScopedGeoCellRelease &operator=(const ScopedGeoCellRelease &) = delete;
+
+    ~ScopedGeoCellRelease() noexcept;
+
+private:
+    MemoryBudget *m_budget;
+};
+} // namespace CDBTo3DTiles
@@ -0,0 +1,67 @@
+#include "ObjectStorageOutputSink.h"
+#include "cpl_error.h"
+#include "cpl_vsi.h"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace CDBTo3DTiles {
+// the requests of an upload are already retried by GDAL on throttling, so this covers the failures past them
+static const unsigned UPLOAD_ATTEMPT_COUNT = 4;
+static const std::chrono::milliseconds FIRST_RETRY_DELAY{500};
+
+static bool uploadObject(const OutputFile &file);
+
+// uploads the files of a batch one after the other on the thread of the sink, which keeps its connections
+class ObjectStorageBatchWriter : public BatchedOutputSink::BatchWriter
+{
+public:
+    void write(const std::vector<OutputFile> &files) override;
+};
+
+ObjectStorageOutputSink::ObjectStorageOutputSink(size_t uploaderThreadCount, uint64_t maxQueuedBytes)
+    : BatchedOutputSink(uploaderThreadCount, maxQueuedBytes, []() {
+        return std::make_unique<ObjectStorageBatchWriter>();
+    })
+{}
+
+void ObjectStorageOutputSink::createDirectories(const std::filesystem::path &) {}
+
+void ObjectStorageBatchWriter::write(const std::vector<OutputFile> &files)
+{
+    // the other files of the batch are still uploaded after a failure
+    std::exception_ptr error;
+    for (const auto &file : files) {
+        auto retryDelay = FIRST_RETRY_DELAY;
+        bool isUploaded = uploadObject(file);
+        for (unsigned attempt = 1; attempt < UPLOAD_ATTEMPT_COUNT && !isUploaded; ++attempt) {
+            std::this_thread::sleep_for(retryDelay);
+            retryDelay *= 2;
+            isUploaded = uploadObject(file);
+        }
+
+        if (!isUploaded && !error) {
+            error = std::make_exception_ptr(
+                std::runtime_error("Cannot upload " + file.path.string() + ": " + CPLGetLastErrorMsg()));
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool uploadObject(const OutputFile &file)
+{
+    VSILFILE *object = VSIFOpenExL(file.path.generic_string().c_str(), "wb", TRUE);
+    if (!object) {
+        return false;
+    }
+
+    size_t byteLength = VSIFWriteL(file.data.data(), 1, file.data.size(), object);
+
+    // the last part is sent and the multipart upload completed when the object is closed
+    bool isClosed = VSIFCloseL(object) == 0;
+    return byteLength == file.data.size() && isClosed;
+}
+} // namespace CDBTo3DTiles
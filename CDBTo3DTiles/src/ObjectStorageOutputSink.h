@@ -0,0 +1,20 @@
+#pragma once
+
+#include "OutputSink.h"
+#include "VirtualFileSystem.h"
+
+namespace CDBTo3DTiles {
+// uploads the files to object storage through the GDAL virtual file systems: /vsis3/ for S3-compatible
+// storage, /vsigs/ or /vsiaz/. Each uploader thread reuses its connections from one file to the next, files
+// larger than the chunk size of GDAL (VSIS3_CHUNK_SIZE) are sent as multipart uploads, and a failed upload is
+// tried again a few times before the conversion stops. The credentials and endpoint are read by GDAL, e.g.
+// from AWS_S3_ENDPOINT
+class ObjectStorageOutputSink : public BatchedOutputSink
+{
+public:
+    ObjectStorageOutputSink(size_t uploaderThreadCount, uint64_t maxQueuedBytes);
+
+    // the keys of the objects hold their directories, so there is nothing to create
+    void createDirectories(const std::filesystem::path &directory) override;
+};
+} // namespace CDBTo3DTiles
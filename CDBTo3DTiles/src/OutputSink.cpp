@@ -0,0 +1,444 @@
+#include "OutputSink.h"
+#include "TilesArchive.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+#ifdef CDBTO3DTILES_HAS_LIBURING
+#include <fcntl.h>
+#include <liburing.h>
+#endif
+
+namespace CDBTo3DTiles {
+// the files taken from the queue at once by a writer, which are as many as the file slots of its ring
+static const size_t BATCH_FILE_COUNT = 64;
+
+static void writeFile(const OutputFile &file);
+
+#ifdef CDBTO3DTILES_HAS_LIBURING
+// submits the open, write and close of every file of a batch at once. The files are opened into slots
+// registered with the ring, so the write and close are linked to the open without knowing its descriptor
+class IOUringBatchWriter
+{
+public:
+    IOUringBatchWriter();
+
+    IOUringBatchWriter(const IOUringBatchWriter &) = delete;
+
+    IOUringBatchWriter &operator=(const IOUringBatchWriter &) = delete;
+
+    ~IOUringBatchWriter() noexcept;
+
+    inline bool isReady() const noexcept { return m_isReady; }
+
+    // returns the files of the batch that are not fully written, which are written again without the ring
+    std::vector<size_t> write(const std::vector<OutputFile> &files);
+
+private:
+    io_uring m_ring;
+    bool m_isReady;
+};
+
+IOUringBatchWriter::IOUringBatchWriter()
+    : m_isReady{false}
+{
+    // the kernel may not support io_uring or its file slots, in which case the files are written one by one
+    if (io_uring_queue_init(static_cast<unsigned>(3 * BATCH_FILE_COUNT), &m_ring, 0) < 0) {
+        return;
+    }
+
+    if (io_uring_register_files_sparse(&m_ring, static_cast<unsigned>(BATCH_FILE_COUNT)) < 0) {
+        io_uring_queue_exit(&m_ring);
+        return;
+    }
+
+    m_isReady = true;
+}
+
+IOUringBatchWriter::~IOUringBatchWriter() noexcept
+{
+    if (m_isReady) {
+        io_uring_queue_exit(&m_ring);
+    }
+}
+
+std::vector<size_t> IOUringBatchWriter::write(const std::vector<OutputFile> &files)
+{
+    // each operation is tagged with its file and its position in the chain of the file
+    std::vector<size_t> unwrittenFiles;
+    std::vector<bool> isFailed(files.size(), false);
+    unsigned operationCount = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const auto &file = files[i];
+        if (file.data.size() > static_cast<size_t>(INT_MAX)) {
+            unwrittenFiles.emplace_back(i);
+            continue;
+        }
+
+        unsigned slot = static_cast<unsigned>(i);
+        io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+        io_uring_prep_openat_direct(
+            sqe, AT_FDCWD, file.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644, slot);
+        io_uring_sqe_set_data64(sqe, 3 * i);
+        sqe->flags |= IOSQE_IO_LINK;
+
+        // the close is hard linked, so the slot is released even when the write comes short
+        sqe = io_uring_get_sqe(&m_ring);
+        io_uring_prep_write(
+            sqe, static_cast<int>(slot), file.data.data(), static_cast<unsigned>(file.data.size()), 0);
+        io_uring_sqe_set_data64(sqe, 3 * i + 1);
+        sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+        sqe = io_uring_get_sqe(&m_ring);
+        io_uring_prep_close_direct(sqe, slot);
+        io_uring_sqe_set_data64(sqe, 3 * i + 2);
+        operationCount += 3;
+    }
+
+    if (operationCount == 0) {
+        return unwrittenFiles;
+    }
+
+    // the ring is not used anymore once it fails, as its state is unknown
+    if (io_uring_submit_and_wait(&m_ring, operationCount) < 0) {
+        m_isReady = false;
+        std::vector<size_t> allFiles(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            allFiles[i] = i;
+        }
+
+        return allFiles;
+    }
+
+    for (unsigned completed = 0; completed < operationCount; ++completed) {
+        io_uring_cqe *cqe;
+        if (io_uring_wait_cqe(&m_ring, &cqe) < 0) {
+            m_isReady = false;
+            std::fill(isFailed.begin(), isFailed.end(), true);
+            break;
+        }
+
+        uint64_t operation = io_uring_cqe_get_data64(cqe);
+        size_t fileIndex = static_cast<size_t>(operation / 3);
+        bool isWrite = operation % 3 == 1;
+        if (cqe->res < 0 || (isWrite && static_cast<size_t>(cqe->res) != files[fileIndex].data.size())) {
+            isFailed[fileIndex] = true;
+        }
+
+        io_uring_cqe_seen(&m_ring, cqe);
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (isFailed[i]) {
+            unwrittenFiles.emplace_back(i);
+        }
+    }
+
+    return unwrittenFiles;
+}
+#endif
+
+// writes the files of a batch one by one, or through io_uring when it is available
+class DirectoryBatchWriter : public BatchedOutputSink::BatchWriter
+{
+public:
+    void write(const std::vector<OutputFile> &files) override;
+
+#ifdef CDBTO3DTILES_HAS_LIBURING
+private:
+    IOUringBatchWriter m_ring;
+#endif
+};
+
+OutputBuffer::OutputBuffer()
+    : std::ostream(&m_buffer)
+{}
+
+std::vector<unsigned char> OutputBuffer::release() noexcept
+{
+    return std::move(m_buffer.data);
+}
+
+OutputBuffer::Buffer::int_type OutputBuffer::Buffer::overflow(int_type c)
+{
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        data.emplace_back(static_cast<unsigned char>(traits_type::to_char_type(c)));
+    }
+
+    return traits_type::not_eof(c);
+}
+
+std::streamsize OutputBuffer::Buffer::xsputn(const char *s, std::streamsize count)
+{
+    data.insert(data.end(),
+                reinterpret_cast<const unsigned char *>(s),
+                reinterpret_cast<const unsigned char *>(s) + count);
+    return count;
+}
+
+void OutputSink::createDirectories(const std::filesystem::path &directory)
+{
+    std::filesystem::create_directories(directory);
+}
+
+void DirectoryOutputSink::write(const std::filesystem::path &path, std::vector<unsigned char> data)
+{
+    writeFile(OutputFile{path, std::move(data)});
+}
+
+void DirectoryOutputSink::flush() {}
+
+BatchedOutputSink::BatchedOutputSink(size_t writerThreadCount,
+                                     uint64_t maxQueuedBytes,
+                                     BatchWriterFactory createBatchWriter)
+    : m_createBatchWriter{std::move(createBatchWriter)}
+    , m_nextTicket{0}
+    , m_queuedBytes{0}
+    , m_maxQueuedBytes{maxQueuedBytes}
+    , m_isStopping{false}
+{
+    writerThreadCount = std::max<size_t>(writerThreadCount, 1);
+    m_writers.reserve(writerThreadCount);
+    for (size_t i = 0; i < writerThreadCount; ++i) {
+        m_writers.emplace_back([this]() { runWriter(); });
+    }
+}
+
+BatchedOutputSink::~BatchedOutputSink() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+
+    m_filesQueued.notify_all();
+    for (auto &writer : m_writers) {
+        writer.join();
+    }
+}
+
+void BatchedOutputSink::write(const std::filesystem::path &path, std::vector<unsigned char> data)
+{
+    uint64_t byteLength = data.size();
+    {
+        // a file larger than the whole queue is still queued once the queue is empty
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_filesWritten.wait(lock, [&]() {
+            return m_error || m_maxQueuedBytes == 0 || m_queuedBytes == 0
+                   || m_queuedBytes + byteLength <= m_maxQueuedBytes;
+        });
+
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+
+        m_pendingTickets.insert(m_nextTicket);
+        m_queue.emplace_back(m_nextTicket, OutputFile{path, std::move(data)});
+        m_queuedBytes += byteLength;
+        ++m_nextTicket;
+    }
+
+    m_filesQueued.notify_one();
+}
+
+void BatchedOutputSink::flush()
+{
+    // the files handed over meanwhile by other threads are not waited for
+    std::unique_lock<std::mutex> lock(m_mutex);
+    uint64_t ticket = m_nextTicket;
+    m_filesWritten.wait(lock, [&]() {
+        return m_pendingTickets.empty() || *m_pendingTickets.begin() >= ticket;
+    });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void BatchedOutputSink::runWriter()
+{
+    auto batchWriter = m_createBatchWriter();
+    std::vector<OutputFile> batch;
+    std::vector<uint64_t> tickets;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_filesQueued.wait(lock, [&]() { return !m_queue.empty() || m_isStopping; });
+            if (m_queue.empty()) {
+                return;
+            }
+
+            // the files queued while the writers were busy are written together
+            while (!m_queue.empty() && batch.size() < BATCH_FILE_COUNT) {
+                tickets.emplace_back(m_queue.front().first);
+                batch.emplace_back(std::move(m_queue.front().second));
+                m_queue.pop_front();
+            }
+        }
+
+        std::exception_ptr error;
+        try {
+            batchWriter->write(batch);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                m_pendingTickets.erase(tickets[i]);
+                m_queuedBytes -= batch[i].data.size();
+            }
+
+            if (error && !m_error) {
+                m_error = error;
+            }
+        }
+
+        m_filesWritten.notify_all();
+        batch.clear();
+        tickets.clear();
+    }
+}
+
+BatchedDirectoryOutputSink::BatchedDirectoryOutputSink(size_t writerThreadCount, uint64_t maxQueuedBytes)
+    : BatchedOutputSink(writerThreadCount, maxQueuedBytes, []() {
+        return std::make_unique<DirectoryBatchWriter>();
+    })
+{}
+
+void DirectoryBatchWriter::write(const std::vector<OutputFile> &files)
+{
+    std::vector<size_t> unwrittenFiles;
+#ifdef CDBTO3DTILES_HAS_LIBURING
+    if (m_ring.isReady()) {
+        unwrittenFiles = m_ring.write(files);
+    } else {
+        unwrittenFiles.resize(files.size());
+        std::iota(unwrittenFiles.begin(), unwrittenFiles.end(), size_t(0));
+    }
+#else
+    unwrittenFiles.resize(files.size());
+    std::iota(unwrittenFiles.begin(), unwrittenFiles.end(), size_t(0));
+#endif
+
+    // the other files of the batch are still written after a failure
+    std::exception_ptr error;
+    for (size_t unwritten : unwrittenFiles) {
+        try {
+            writeFile(files[unwritten]);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+struct ArchiveOutputSink::Archive
+{
+    explicit Archive(const std::filesystem::path &archivePath)
+        : writer{archivePath}
+    {}
+
+    std::mutex mutex;
+    TilesArchiveWriter writer;
+};
+
+ArchiveOutputSink::ArchiveOutputSink() {}
+
+ArchiveOutputSink::~ArchiveOutputSink() noexcept
+{
+    // an archive left open by a failed conversion still gets its index
+    for (auto &archive : m_archives) {
+        try {
+            archive.second->writer.close();
+        } catch (...) {
+        }
+    }
+}
+
+void ArchiveOutputSink::openArchive(const std::filesystem::path &directory,
+                                    const std::filesystem::path &archivePath)
+{
+    std::filesystem::create_directories(archivePath.parent_path());
+    auto archive = std::make_shared<Archive>(archivePath);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_archives[directory.lexically_normal()] = std::move(archive);
+}
+
+void ArchiveOutputSink::closeArchive(const std::filesystem::path &directory)
+{
+    std::shared_ptr<Archive> archive;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_archives.find(directory.lexically_normal());
+        if (found == m_archives.end()) {
+            return;
+        }
+
+        archive = std::move(found->second);
+        m_archives.erase(found);
+    }
+
+    // the files being appended by other threads are waited for
+    std::lock_guard<std::mutex> lock(archive->mutex);
+    archive->writer.close();
+}
+
+void ArchiveOutputSink::createDirectories(const std::filesystem::path &directory)
+{
+    std::string entryName;
+    if (!findArchive(directory, entryName)) {
+        std::filesystem::create_directories(directory);
+    }
+}
+
+void ArchiveOutputSink::write(const std::filesystem::path &path, std::vector<unsigned char> data)
+{
+    std::string entryName;
+    auto archive = findArchive(path, entryName);
+    if (!archive) {
+        writeFile(OutputFile{path, std::move(data)});
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(archive->mutex);
+    archive->writer.addEntry(entryName, data);
+}
+
+void ArchiveOutputSink::flush() {}
+
+std::shared_ptr<ArchiveOutputSink::Archive> ArchiveOutputSink::findArchive(const std::filesystem::path &path,
+                                                                           std::string &entryName)
+{
+    // only the GeoCells in flight have an archive open, so they are looked up one by one
+    auto normalPath = path.lexically_normal();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &archive : m_archives) {
+        auto relativePath = normalPath.lexically_relative(archive.first);
+        if (!relativePath.empty() && *relativePath.begin() != "..") {
+            entryName = relativePath.generic_string();
+            return archive.second;
+        }
+    }
+
+    return nullptr;
+}
+
+void writeFile(const OutputFile &file)
+{
+    std::ofstream fs(file.path, std::ios::binary);
+    auto byteLength = static_cast<std::streamsize>(file.data.size());
+    fs.write(reinterpret_cast<const char *>(file.data.data()), byteLength);
+    fs.close();
+    if (!fs) {
+        throw std::runtime_error("Cannot write " + file.path.string());
+    }
+}
+} // namespace CDBTo3DTiles
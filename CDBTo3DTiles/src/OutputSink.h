@@ -0,0 +1,175 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace CDBTo3DTiles {
+// a file serialized in memory, so that it is handed over to an output sink in one piece once complete
+class OutputBuffer : public std::ostream
+{
+public:
+    OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    inline uint64_t getByteLength() const noexcept { return m_buffer.data.size(); }
+
+    std::vector<unsigned char> release() noexcept;
+
+private:
+    struct Buffer : public std::streambuf
+    {
+        int_type overflow(int_type c) override;
+
+        std::streamsize xsputn(const char *s, std::streamsize count) override;
+
+        std::vector<unsigned char> data;
+    };
+
+    Buffer m_buffer;
+};
+
+struct OutputFile
+{
+    std::filesystem::path path;
+    std::vector<unsigned char> data;
+};
+
+// where the converted files go. The converter hands over each file once it is serialized, and the sink
+// decides when it reaches the storage
+class OutputSink
+{
+public:
+    virtual ~OutputSink() noexcept = default;
+
+    // creates the directory of the files written in it, if the sink stores them in directories
+    virtual void createDirectories(const std::filesystem::path &directory);
+
+    // the directory of the file is created through the sink beforehand
+    virtual void write(const std::filesystem::path &path, std::vector<unsigned char> data) = 0;
+
+    // returns once every file handed over before the call is written, and throws the first error met while
+    // writing any of them
+    virtual void flush() = 0;
+};
+
+// writes each file on the thread handing it over
+class DirectoryOutputSink : public OutputSink
+{
+public:
+    void write(const std::filesystem::path &path, std::vector<unsigned char> data) override;
+
+    void flush() override;
+};
+
+// queues the files handed over and writes them in batches from writer threads, so the workers go on
+// converting meanwhile. Each writer thread writes its batches through a batch writer of its own. Workers wait
+// while maxQueuedBytes are queued, 0 queues every file
+class BatchedOutputSink : public OutputSink
+{
+public:
+    class BatchWriter
+    {
+    public:
+        virtual ~BatchWriter() noexcept = default;
+
+        // throws the first error met, once every file of the batch is tried
+        virtual void write(const std::vector<OutputFile> &files) = 0;
+    };
+
+    using BatchWriterFactory = std::function<std::unique_ptr<BatchWriter>()>;
+
+    BatchedOutputSink(size_t writerThreadCount,
+                      uint64_t maxQueuedBytes,
+                      BatchWriterFactory createBatchWriter);
+
+    BatchedOutputSink(const BatchedOutputSink &) = delete;
+
+    BatchedOutputSink &operator=(const BatchedOutputSink &) = delete;
+
+    // the files still queued are written before the writer threads stop
+    ~BatchedOutputSink() noexcept override;
+
+    void write(const std::filesystem::path &path, std::vector<unsigned char> data) override;
+
+    void flush() override;
+
+private:
+    void runWriter();
+
+    BatchWriterFactory m_createBatchWriter;
+    std::mutex m_mutex;
+    std::condition_variable m_filesQueued;
+    std::condition_variable m_filesWritten;
+    std::deque<std::pair<uint64_t, OutputFile>> m_queue;
+    std::set<uint64_t> m_pendingTickets;
+    uint64_t m_nextTicket;
+    uint64_t m_queuedBytes;
+    uint64_t m_maxQueuedBytes;
+    std::exception_ptr m_error;
+    bool m_isStopping;
+    std::vector<std::thread> m_writers;
+};
+
+// writes the files of a batch to their directories. When the library is built with liburing, the opens,
+// writes and closes of a batch are submitted to io_uring at once, otherwise they are written one by one
+class BatchedDirectoryOutputSink : public BatchedOutputSink
+{
+public:
+    BatchedDirectoryOutputSink(size_t writerThreadCount, uint64_t maxQueuedBytes);
+};
+
+class TilesArchiveWriter;
+
+// appends the files written below a directory to the 3D Tiles archive opened for it, so the directory is
+// stored as one file. Files outside of the open archives are written on the calling thread
+class ArchiveOutputSink : public OutputSink
+{
+public:
+    ArchiveOutputSink();
+
+    ArchiveOutputSink(const ArchiveOutputSink &) = delete;
+
+    ArchiveOutputSink &operator=(const ArchiveOutputSink &) = delete;
+
+    // the archives still open are closed
+    ~ArchiveOutputSink() noexcept override;
+
+    // the entries are named relative to the directory, which is never created
+    void openArchive(const std::filesystem::path &directory, const std::filesystem::path &archivePath);
+
+    // writes the index of the archive. The files written below the directory afterwards are not archived
+    void closeArchive(const std::filesystem::path &directory);
+
+    void createDirectories(const std::filesystem::path &directory) override;
+
+    void write(const std::filesystem::path &path, std::vector<unsigned char> data) override;
+
+    void flush() override;
+
+private:
+    struct Archive;
+
+    std::shared_ptr<Archive> findArchive(const std::filesystem::path &path, std::string &entryName);
+
+    std::mutex m_mutex;
+    std::map<std::filesystem::path, std::shared_ptr<Archive>> m_archives;
+};
+} // namespace CDBTo3DTiles
@@ -1,11 +1,167 @@
 #include "Scene.h"
+#include "glm/gtc/type_ptr.hpp"
+#include "meshoptimizer.h"
+#include <limits>
+#include <utility>
 
 namespace CDBTo3DTiles {
+static std::vector<uint32_t> simplifyLines(const Mesh &mesh, double error);
+
+static std::vector<uint32_t> simplifyTriangles(const Mesh &mesh, double error);
+
+static void simplifyPolyline(const std::vector<glm::dvec3> &points, double error, std::vector<bool> &keep);
+
+static double computeDistanceToSegment(const glm::dvec3 &point,
+                                       const glm::dvec3 &begin,
+                                       const glm::dvec3 &end);
+
+static Mesh extractIndexedVertices(const Mesh &mesh, const std::vector<uint32_t> &indices);
+
 Mesh::Mesh()
     : material{-1}
     , primitiveType{PrimitiveType::Triangles}
 {}
 
+size_t Mesh::getVertexCount() const noexcept
+{
+    return std::max(positions.size(), positionRTCs.size());
+}
+
+glm::dvec3 Mesh::getPosition(size_t idx) const
+{
+    if (idx < positions.size()) {
+        return positions[idx];
+    }
+
+    return aabb->center() + glm::dvec3(positionRTCs[idx]);
+}
+
+bool isMeshMergeable(const Mesh &lhs, const Mesh &rhs)
+{
+    // strips, fans and loops would connect the last vertex of one mesh to the first vertex of the other
+    bool isListPrimitive = lhs.primitiveType == PrimitiveType::Triangles
+                           || lhs.primitiveType == PrimitiveType::Lines
+                           || lhs.primitiveType == PrimitiveType::Points;
+    return isListPrimitive && lhs.material == rhs.material && lhs.primitiveType == rhs.primitiveType
+           && lhs.aabb && rhs.aabb && lhs.indices.empty() == rhs.indices.empty()
+           && lhs.positions.empty() == rhs.positions.empty() && lhs.UVs.empty() == rhs.UVs.empty()
+           && lhs.normals.empty() == rhs.normals.empty() && lhs.batchIDs.empty() == rhs.batchIDs.empty();
+}
+
+void mergeMeshes(std::vector<Mesh> &meshes)
+{
+    std::vector<std::vector<size_t>> groups;
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const std::vector<size_t> &other) {
+            return isMeshMergeable(meshes[other.front()], meshes[i]);
+        });
+        if (group != groups.end()) {
+            group->emplace_back(i);
+        } else {
+            groups.push_back({i});
+        }
+    }
+
+    std::vector<Mesh> mergedMeshes;
+    mergedMeshes.reserve(groups.size());
+    for (const auto &group : groups) {
+        auto &merged = mergedMeshes.emplace_back(std::move(meshes[group.front()]));
+        if (group.size() == 1) {
+            continue;
+        }
+
+        std::vector<glm::dvec3> positions;
+        for (size_t i = 0; i < merged.getVertexCount(); ++i) {
+            positions.emplace_back(merged.getPosition(i));
+        }
+
+        for (size_t i = 1; i < group.size(); ++i) {
+            const auto &mesh = meshes[group[i]];
+            auto vertexOffset = static_cast<uint32_t>(positions.size());
+            reserveForAppend(merged.indices, mesh.indices.size());
+            for (uint32_t index : mesh.indices) {
+                merged.indices.emplace_back(index + vertexOffset);
+            }
+
+            for (size_t j = 0; j < mesh.getVertexCount(); ++j) {
+                positions.emplace_back(mesh.getPosition(j));
+            }
+
+            merged.aabb->merge(mesh.aabb->min);
+            merged.aabb->merge(mesh.aabb->max);
+            merged.UVs.insert(merged.UVs.end(), mesh.UVs.begin(), mesh.UVs.end());
+            merged.normals.insert(merged.normals.end(), mesh.normals.begin(), mesh.normals.end());
+            merged.batchIDs.insert(merged.batchIDs.end(), mesh.batchIDs.begin(), mesh.batchIDs.end());
+        }
+
+        // the RTC positions are relative to the center of the bounding box, which moves with the merge
+        auto center = merged.aabb->center();
+        merged.positionRTCs.clear();
+        merged.positionRTCs.reserve(positions.size());
+        for (const auto &position : positions) {
+            merged.positionRTCs.emplace_back(position - center);
+        }
+
+        if (!merged.positions.empty()) {
+            merged.positions = std::move(positions);
+        }
+    }
+
+    meshes = std::move(mergedMeshes);
+}
+
+Mesh transformMesh(const Mesh &mesh, const glm::dmat4 &transform)
+{
+    Mesh transformed;
+    transformed.material = mesh.material;
+    transformed.primitiveType = mesh.primitiveType;
+    transformed.indices = mesh.indices;
+    transformed.UVs = mesh.UVs;
+    transformed.batchIDs = mesh.batchIDs;
+    transformed.aabb = AABB();
+    transformed.positions.reserve(mesh.getVertexCount());
+    for (size_t i = 0; i < mesh.getVertexCount(); ++i) {
+        auto &position = transformed.positions.emplace_back(transform * glm::dvec4(mesh.getPosition(i), 1.0));
+        transformed.aabb->merge(position);
+    }
+
+    auto center = transformed.aabb->center();
+    transformed.positionRTCs.reserve(transformed.positions.size());
+    for (const auto &position : transformed.positions) {
+        transformed.positionRTCs.emplace_back(position - center);
+    }
+
+    glm::dmat3 normalMatrix = glm::transpose(glm::inverse(glm::dmat3(transform)));
+    transformed.normals.reserve(mesh.normals.size());
+    for (const auto &normal : mesh.normals) {
+        transformed.normals.emplace_back(glm::normalize(normalMatrix * glm::dvec3(normal)));
+    }
+
+    // a mirroring transform turns the triangles inside out
+    if (glm::determinant(glm::dmat3(transform)) < 0.0 && mesh.primitiveType == PrimitiveType::Triangles
+        && !transformed.indices.empty()) {
+        for (size_t i = 0; i + 2 < transformed.indices.size(); i += 3) {
+            std::swap(transformed.indices[i + 1], transformed.indices[i + 2]);
+        }
+    }
+
+    return transformed;
+}
+
+Mesh simplifyMesh(const Mesh &mesh, double error)
+{
+    if (mesh.indices.empty()
+        || (mesh.primitiveType != PrimitiveType::Lines && mesh.primitiveType != PrimitiveType::Triangles)) {
+        return mesh;
+    }
+
+    if (mesh.primitiveType == PrimitiveType::Lines) {
+        return extractIndexedVertices(mesh, simplifyLines(mesh, error));
+    }
+
+    return extractIndexedVertices(mesh, simplifyTriangles(mesh, error));
+}
+
 Material::Material()
     : texture{-1}
     , ambient{glm::vec3(1.0f)}
@@ -44,4 +200,189 @@ Texture::Texture()
     , magFilter{TextureFilter::LINEAR}
 {}
 
+
+std::vector<uint32_t> simplifyLines(const Mesh &mesh, double error)
+{
+    std::vector<uint32_t> simplified;
+    std::vector<uint32_t> strip;
+    std::vector<glm::dvec3> points;
+    std::vector<bool> keep;
+    size_t begin = 0;
+    while (begin + 1 < mesh.indices.size()) {
+        // consecutive segments sharing their end and start points form a strip
+        strip.clear();
+        strip.emplace_back(mesh.indices[begin]);
+        strip.emplace_back(mesh.indices[begin + 1]);
+        size_t end = begin + 2;
+        while (end + 1 < mesh.indices.size() && mesh.indices[end] == strip.back()) {
+            strip.emplace_back(mesh.indices[end + 1]);
+            end += 2;
+        }
+
+        begin = end;
+
+        AABB stripBox;
+        points.clear();
+        for (auto index : strip) {
+            stripBox.merge(points.emplace_back(mesh.getPosition(index)));
+        }
+
+        if (glm::distance(stripBox.min, stripBox.max) < error) {
+            continue;
+        }
+
+        simplifyPolyline(points, error, keep);
+        uint32_t previous = strip.front();
+        for (size_t i = 1; i < strip.size(); ++i) {
+            if (keep[i]) {
+                simplified.emplace_back(previous);
+                simplified.emplace_back(strip[i]);
+                previous = strip[i];
+            }
+        }
+    }
+
+    return simplified;
+}
+
+std::vector<uint32_t> simplifyTriangles(const Mesh &mesh, double error)
+{
+    // the triangles of the features smaller than the error are dropped
+    std::vector<uint32_t> indices;
+    if (mesh.batchIDs.empty()) {
+        indices = mesh.indices;
+    } else {
+        std::vector<AABB> featureBoxes;
+        for (size_t i = 0; i < mesh.batchIDs.size(); ++i) {
+            size_t featureID = static_cast<size_t>(mesh.batchIDs[i]);
+            if (featureID >= featureBoxes.size()) {
+                featureBoxes.resize(featureID + 1);
+            }
+
+            featureBoxes[featureID].merge(mesh.getPosition(i));
+        }
+
+        indices.reserve(mesh.indices.size());
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const auto &featureBox = featureBoxes[static_cast<size_t>(mesh.batchIDs[mesh.indices[i]])];
+            if (glm::distance(featureBox.min, featureBox.max) >= error) {
+                indices.emplace_back(mesh.indices[i]);
+                indices.emplace_back(mesh.indices[i + 1]);
+                indices.emplace_back(mesh.indices[i + 2]);
+            }
+        }
+    }
+
+    // like meshopt_simplify, the error is relative to the extents of the mesh
+    glm::dvec3 extents = mesh.aabb ? mesh.aabb->max - mesh.aabb->min : glm::dvec3(0.0);
+    double maxExtent = glm::max(extents.x, glm::max(extents.y, extents.z));
+    if (indices.empty() || maxExtent <= 0.0 || mesh.positionRTCs.size() != mesh.getVertexCount()) {
+        return indices;
+    }
+
+    std::vector<uint32_t> simplified(indices.size());
+    simplified.resize(meshopt_simplify(simplified.data(),
+                                       indices.data(),
+                                       indices.size(),
+                                       glm::value_ptr(mesh.positionRTCs[0]),
+                                       mesh.positionRTCs.size(),
+                                       sizeof(glm::vec3),
+                                       0,
+                                       static_cast<float>(error / maxExtent)));
+    return simplified;
+}
+
+void simplifyPolyline(const std::vector<glm::dvec3> &points, double error, std::vector<bool> &keep)
+{
+    // Douglas-Peucker keeps the farthest point from the segment between the kept points while it is farther
+    // than the error
+    keep.assign(points.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+
+    std::vector<std::pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+    while (!ranges.empty()) {
+        auto [first, last] = ranges.back();
+        ranges.pop_back();
+
+        double maxDistance = 0.0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            double distance = computeDistanceToSegment(points[i], points[first], points[last]);
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+
+        if (maxDistance > error) {
+            keep[farthest] = true;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
+        }
+    }
+}
+
+double computeDistanceToSegment(const glm::dvec3 &point, const glm::dvec3 &begin, const glm::dvec3 &end)
+{
+    glm::dvec3 segment = end - begin;
+    double lengthSquared = glm::dot(segment, segment);
+    double t = 0.0;
+    if (lengthSquared > 0.0) {
+        t = glm::clamp(glm::dot(point - begin, segment) / lengthSquared, 0.0, 1.0);
+    }
+
+    return glm::distance(point, begin + t * segment);
+}
+
+Mesh extractIndexedVertices(const Mesh &mesh, const std::vector<uint32_t> &indices)
+{
+    Mesh extracted;
+    extracted.material = mesh.material;
+    extracted.primitiveType = mesh.primitiveType;
+    extracted.aabb = AABB();
+
+    // the kept vertices stay in their order, so the features keep theirs
+    size_t vertexCount = mesh.getVertexCount();
+    std::vector<uint32_t> remap(vertexCount, std::numeric_limits<uint32_t>::max());
+    for (auto index : indices) {
+        remap[index] = 0;
+    }
+
+    std::vector<glm::dvec3> positions;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        if (remap[i] == 0) {
+            remap[i] = static_cast<uint32_t>(positions.size());
+            extracted.aabb->merge(positions.emplace_back(mesh.getPosition(i)));
+            if (!mesh.UVs.empty()) {
+                extracted.UVs.emplace_back(mesh.UVs[i]);
+            }
+
+            if (!mesh.normals.empty()) {
+                extracted.normals.emplace_back(mesh.normals[i]);
+            }
+
+            if (!mesh.batchIDs.empty()) {
+                extracted.batchIDs.emplace_back(mesh.batchIDs[i]);
+            }
+        }
+    }
+
+    extracted.indices.reserve(indices.size());
+    for (auto index : indices) {
+        extracted.indices.emplace_back(remap[index]);
+    }
+
+    auto center = extracted.aabb->center();
+    extracted.positionRTCs.reserve(positions.size());
+    for (const auto &position : positions) {
+        extracted.positionRTCs.emplace_back(position - center);
+    }
+
+    if (!mesh.positions.empty()) {
+        extracted.positions = std::move(positions);
+    }
+
+    return extracted;
+}
 } // namespace CDBTo3DTiles
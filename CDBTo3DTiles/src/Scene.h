@@ -2,6 +2,7 @@
 
 #include "glm/glm.hpp"
 #include "osg/Image"
+#include <algorithm>
 #include <filesystem>
 #include <optional>
 #include <vector>
@@ -43,10 +44,41 @@ enum class TextureFilter
 
 };
 
+// makes room for count more elements while keeping the geometric growth of the vector, so meshes assembled
+// from many small pieces neither reallocate per element nor copy their whole content for every piece
+template<typename T>
+inline void reserveForAppend(std::vector<T> &values, size_t count)
+{
+    size_t required = values.size() + count;
+    if (required > values.capacity()) {
+        values.reserve(std::max(required, 2 * values.capacity()));
+    }
+}
+
+// keeps the elements at the given increasing indices by moving them to the front of the vector, so a
+// selection of the elements is kept in place instead of being copied
+template<typename T>
+inline void retainElements(std::vector<T> &values, const std::vector<size_t> &indices)
+{
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (indices[i] != i) {
+            values[i] = std::move(values[indices[i]]);
+        }
+    }
+
+    values.erase(values.begin() + static_cast<std::ptrdiff_t>(indices.size()), values.end());
+}
+
 struct Mesh
 {
     Mesh();
 
+    size_t getVertexCount() const noexcept;
+
+    // elevation meshes drop their double positions once positionRTCs, which are relative to the center of the
+    // bounding box, are computed. Their positions are then rebuilt from the RTC offsets
+    glm::dvec3 getPosition(size_t idx) const;
+
     int material;
     PrimitiveType primitiveType;
     std::optional<AABB> aabb;
@@ -58,6 +90,21 @@ struct Mesh
     std::vector<float> batchIDs;
 };
 
+// meshes can be merged when they are drawn the same way and carry the same vertex attributes
+bool isMeshMergeable(const Mesh &lhs, const Mesh &rhs);
+
+// concatenates the mergeable meshes, keeping the order of their first mesh. RTC positions are computed once
+// per merged mesh, so merging many small meshes stays linear
+void mergeMeshes(std::vector<Mesh> &meshes);
+
+// returns the mesh with its positions and normals moved by the transform
+Mesh transformMesh(const Mesh &mesh, const glm::dmat4 &transform);
+
+// simplifies lines and triangles so that they don't move by more than error, in meters. Line strips go
+// through Douglas-Peucker and triangles through meshopt_simplify, and the line strips and features smaller
+// than the error are dropped. Other primitives are returned as they are
+Mesh simplifyMesh(const Mesh &mesh, double error);
+
 struct Texture
 {
     Texture();
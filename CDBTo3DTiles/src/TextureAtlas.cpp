@@ -0,0 +1,330 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace CDBTo3DTiles {
+static const unsigned ATLAS_PADDING = 2;
+static const float ATLAS_UV_EPSILON = 1e-4f;
+
+struct AtlasPlacement
+{
+    AtlasPlacement();
+
+    size_t atlas;
+    unsigned x;
+    unsigned y;
+};
+
+struct AtlasLayout
+{
+    AtlasLayout();
+
+    unsigned width;
+    unsigned height;
+    std::vector<size_t> textures;
+};
+
+static std::vector<bool> findAtlasTextures(const std::vector<Mesh> &meshes,
+                                           const std::vector<Material> &materials,
+                                           const std::vector<osg::ref_ptr<osg::Image>> &images,
+                                           unsigned maxAtlasSize);
+
+static void packTextures(std::vector<size_t> textures,
+                         const std::vector<osg::ref_ptr<osg::Image>> &images,
+                         unsigned maxAtlasSize,
+                         std::vector<AtlasLayout> &layouts,
+                         std::vector<AtlasPlacement> &placements);
+
+static osg::ref_ptr<osg::Image> createAtlasImage(const AtlasLayout &layout,
+                                                 const std::vector<osg::ref_ptr<osg::Image>> &images,
+                                                 const std::vector<AtlasPlacement> &placements);
+
+static bool isSameMaterial(const Material &lhs, const Material &rhs);
+
+AtlasPlacement::AtlasPlacement()
+    : atlas{0}
+    , x{0}
+    , y{0}
+{}
+
+AtlasLayout::AtlasLayout()
+    : width{0}
+    , height{0}
+{}
+
+TextureAtlasResult::TextureAtlasResult() {}
+
+TextureAtlasResult createTextureAtlases(const std::vector<Mesh> &meshes,
+                                        const std::vector<Material> &materials,
+                                        const std::vector<Texture> &textures,
+                                        const std::vector<osg::ref_ptr<osg::Image>> &images,
+                                        const std::string &atlasName,
+                                        unsigned maxAtlasSize)
+{
+    // textures only share an atlas with textures sampled the same way
+    auto isAtlasTexture = findAtlasTextures(meshes, materials, images, maxAtlasSize);
+    std::map<std::pair<TextureFilter, TextureFilter>, std::vector<size_t>> filtersToTextures;
+    for (size_t i = 0; i < textures.size(); ++i) {
+        if (isAtlasTexture[i]) {
+            filtersToTextures[{textures[i].minFilter, textures[i].magFilter}].emplace_back(i);
+        }
+    }
+
+    std::vector<AtlasLayout> layouts;
+    std::vector<AtlasPlacement> placements(textures.size());
+    std::vector<Texture> atlasTextures;
+    for (const auto &filterToTextures : filtersToTextures) {
+        size_t firstLayout = layouts.size();
+        packTextures(filterToTextures.second, images, maxAtlasSize, layouts, placements);
+        for (size_t i = firstLayout; i < layouts.size(); ++i) {
+            Texture atlasTexture;
+            atlasTexture.minFilter = filterToTextures.first.first;
+            atlasTexture.magFilter = filterToTextures.first.second;
+            atlasTextures.emplace_back(atlasTexture);
+        }
+    }
+
+    // an atlas holding a single texture would only rename it
+    for (const auto &layout : layouts) {
+        if (layout.textures.size() == 1) {
+            isAtlasTexture[layout.textures.front()] = false;
+        }
+    }
+
+    TextureAtlasResult result;
+    std::vector<int> textureToResult(textures.size(), -1);
+    for (size_t i = 0; i < textures.size(); ++i) {
+        if (!isAtlasTexture[i]) {
+            textureToResult[i] = static_cast<int>(result.textures.size());
+            result.textures.emplace_back(textures[i]);
+            result.images.emplace_back(images[i]);
+        }
+    }
+
+    std::vector<int> layoutToResult(layouts.size(), -1);
+    for (size_t i = 0; i < layouts.size(); ++i) {
+        if (layouts[i].textures.size() < 2) {
+            continue;
+        }
+
+        layoutToResult[i] = static_cast<int>(result.textures.size());
+        atlasTextures[i].uri = atlasName + "_" + std::to_string(result.textures.size()) + ".png";
+        result.textures.emplace_back(atlasTextures[i]);
+        result.images.emplace_back(createAtlasImage(layouts[i], images, placements));
+        for (size_t texture : layouts[i].textures) {
+            textureToResult[texture] = layoutToResult[i];
+        }
+    }
+
+    // materials only differing by their textures become the same once the textures share an atlas
+    std::vector<int> materialToResult(materials.size(), -1);
+    for (size_t i = 0; i < materials.size(); ++i) {
+        Material material = materials[i];
+        if (material.texture >= 0 && static_cast<size_t>(material.texture) < textures.size()) {
+            material.texture = textureToResult[static_cast<size_t>(material.texture)];
+        }
+
+        auto sameMaterial = std::find_if(result.materials.begin(),
+                                         result.materials.end(),
+                                         [&material](const Material &other) {
+                                             return isSameMaterial(material, other);
+                                         });
+        materialToResult[i] = static_cast<int>(sameMaterial - result.materials.begin());
+        if (sameMaterial == result.materials.end()) {
+            result.materials.emplace_back(material);
+        }
+    }
+
+    for (const auto &mesh : meshes) {
+        Mesh atlasMesh = mesh;
+        if (mesh.material >= 0 && static_cast<size_t>(mesh.material) < materials.size()) {
+            int texture = materials[static_cast<size_t>(mesh.material)].texture;
+            if (texture >= 0 && static_cast<size_t>(texture) < textures.size()
+                && isAtlasTexture[static_cast<size_t>(texture)]) {
+                const auto &placement = placements[static_cast<size_t>(texture)];
+                const auto &layout = layouts[placement.atlas];
+                const auto &image = *images[static_cast<size_t>(texture)];
+                glm::vec2 offset(static_cast<float>(placement.x), static_cast<float>(placement.y));
+                glm::vec2 size(static_cast<float>(image.s()), static_cast<float>(image.t()));
+                glm::vec2 atlasSize(static_cast<float>(layout.width), static_cast<float>(layout.height));
+                for (auto &UV : atlasMesh.UVs) {
+                    UV = (offset + glm::clamp(UV, 0.0f, 1.0f) * size) / atlasSize;
+                }
+            }
+
+            atlasMesh.material = materialToResult[static_cast<size_t>(mesh.material)];
+        }
+
+        result.meshes.emplace_back(std::move(atlasMesh));
+    }
+
+    mergeMeshes(result.meshes);
+    return result;
+}
+
+std::vector<bool> findAtlasTextures(const std::vector<Mesh> &meshes,
+                                    const std::vector<Material> &materials,
+                                    const std::vector<osg::ref_ptr<osg::Image>> &images,
+                                    unsigned maxAtlasSize)
+{
+    std::vector<bool> isAtlasTexture(images.size(), false);
+    for (size_t i = 0; i < images.size(); ++i) {
+        const auto &image = images[i];
+        isAtlasTexture[i] = image && isRGBAConvertible(*image)
+                            && static_cast<unsigned>(image->s()) + 2 * ATLAS_PADDING <= maxAtlasSize
+                            && static_cast<unsigned>(image->t()) + 2 * ATLAS_PADDING <= maxAtlasSize;
+    }
+
+    // a texture repeated over its mesh cannot be cut out of an atlas
+    for (const auto &mesh : meshes) {
+        if (mesh.material < 0 || static_cast<size_t>(mesh.material) >= materials.size()) {
+            continue;
+        }
+
+        int texture = materials[static_cast<size_t>(mesh.material)].texture;
+        if (texture < 0 || static_cast<size_t>(texture) >= images.size()) {
+            continue;
+        }
+
+        bool isInsideTexture = std::all_of(mesh.UVs.begin(), mesh.UVs.end(), [](const glm::vec2 &UV) {
+            return UV.x >= -ATLAS_UV_EPSILON && UV.x <= 1.0f + ATLAS_UV_EPSILON && UV.y >= -ATLAS_UV_EPSILON
+                   && UV.y <= 1.0f + ATLAS_UV_EPSILON;
+        });
+        if (!isInsideTexture) {
+            isAtlasTexture[static_cast<size_t>(texture)] = false;
+        }
+    }
+
+    return isAtlasTexture;
+}
+
+void packTextures(std::vector<size_t> textures,
+                  const std::vector<osg::ref_ptr<osg::Image>> &images,
+                  unsigned maxAtlasSize,
+                  std::vector<AtlasLayout> &layouts,
+                  std::vector<AtlasPlacement> &placements)
+{
+    // shelves filled from the tallest texture waste little space when the heights are close
+    std::stable_sort(textures.begin(), textures.end(), [&images](size_t lhs, size_t rhs) {
+        return images[lhs]->t() > images[rhs]->t();
+    });
+
+    unsigned cursorX = 0;
+    unsigned shelfY = 0;
+    unsigned shelfHeight = 0;
+    layouts.emplace_back();
+    for (size_t texture : textures) {
+        unsigned width = static_cast<unsigned>(images[texture]->s()) + 2 * ATLAS_PADDING;
+        unsigned height = static_cast<unsigned>(images[texture]->t()) + 2 * ATLAS_PADDING;
+        if (cursorX + width > maxAtlasSize) {
+            cursorX = 0;
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+        }
+
+        if (shelfY + height > maxAtlasSize) {
+            cursorX = 0;
+            shelfY = 0;
+            shelfHeight = 0;
+            layouts.emplace_back();
+        }
+
+        auto &layout = layouts.back();
+        auto &placement = placements[texture];
+        placement.atlas = layouts.size() - 1;
+        placement.x = cursorX + ATLAS_PADDING;
+        placement.y = shelfY + ATLAS_PADDING;
+        layout.textures.emplace_back(texture);
+
+        cursorX += width;
+        shelfHeight = std::max(shelfHeight, height);
+        layout.width = std::max(layout.width, cursorX);
+        layout.height = std::max(layout.height, shelfY + height);
+    }
+}
+
+osg::ref_ptr<osg::Image> createAtlasImage(const AtlasLayout &layout,
+                                          const std::vector<osg::ref_ptr<osg::Image>> &images,
+                                          const std::vector<AtlasPlacement> &placements)
+{
+    // the padding repeats the border texels so that filtering does not bleed the neighbor textures
+    size_t atlasWidth = layout.width;
+    std::vector<unsigned char> pixels(atlasWidth * layout.height * 4, 0);
+    for (size_t texture : layout.textures) {
+        const auto &image = *images[texture];
+        const auto &placement = placements[texture];
+        auto RGBAPixels = convertToRGBA(image);
+        int width = image.s();
+        int height = image.t();
+        int padding = static_cast<int>(ATLAS_PADDING);
+        for (int y = -padding; y < height + padding; ++y) {
+            size_t sourceY = static_cast<size_t>(std::clamp(y, 0, height - 1));
+            size_t atlasY = static_cast<size_t>(static_cast<int>(placement.y) + y);
+            for (int x = -padding; x < width + padding; ++x) {
+                size_t sourceX = static_cast<size_t>(std::clamp(x, 0, width - 1));
+                size_t atlasX = static_cast<size_t>(static_cast<int>(placement.x) + x);
+                const unsigned char *texel = RGBAPixels.data()
+                                             + (sourceY * static_cast<size_t>(width) + sourceX) * 4;
+                std::copy(texel, texel + 4, pixels.data() + (atlasY * atlasWidth + atlasX) * 4);
+            }
+        }
+    }
+
+    // OSG keeps the bottom row first
+    osg::ref_ptr<osg::Image> atlas = new osg::Image();
+    int width = static_cast<int>(layout.width);
+    int height = static_cast<int>(layout.height);
+    atlas->allocateImage(width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    atlas->setOrigin(osg::Image::BOTTOM_LEFT);
+    for (size_t y = 0; y < layout.height; ++y) {
+        const unsigned char *row = pixels.data() + (layout.height - 1 - y) * atlasWidth * 4;
+        std::copy(row, row + atlasWidth * 4, atlas->data(0, static_cast<unsigned>(y)));
+    }
+
+    return atlas;
+}
+
+bool isSameMaterial(const Material &lhs, const Material &rhs)
+{
+    return lhs.texture == rhs.texture && lhs.ambient == rhs.ambient && lhs.diffuse == rhs.diffuse
+           && lhs.specular == rhs.specular && lhs.emission == rhs.emission && lhs.shininess == rhs.shininess
+           && lhs.alpha == rhs.alpha && lhs.unlit == rhs.unlit && lhs.doubleSided == rhs.doubleSided;
+}
+
+bool isRGBAConvertible(const osg::Image &image)
+{
+    GLenum pixelFormat = image.getPixelFormat();
+    return image.getDataType() == GL_UNSIGNED_BYTE && image.r() == 1
+           && (pixelFormat == GL_RGB || pixelFormat == GL_RGBA || pixelFormat == GL_LUMINANCE
+               || pixelFormat == GL_LUMINANCE_ALPHA);
+}
+
+std::vector<unsigned char> convertToRGBA(const osg::Image &image)
+{
+    // OSG keeps the bottom row first for OpenGL, while KTX2 and glTF expect the top row first
+    size_t width = static_cast<size_t>(image.s());
+    size_t height = static_cast<size_t>(image.t());
+    size_t componentCount = osg::Image::computeNumComponents(image.getPixelFormat());
+    std::vector<unsigned char> pixels(width * height * 4, 255);
+    for (size_t y = 0; y < height; ++y) {
+        size_t row = image.getOrigin() == osg::Image::BOTTOM_LEFT ? height - 1 - y : y;
+        const unsigned char *source = image.data(0, static_cast<unsigned>(row));
+        for (size_t x = 0; x < width; ++x) {
+            const unsigned char *texel = source + x * componentCount;
+            unsigned char *pixel = pixels.data() + (y * width + x) * 4;
+            if (componentCount >= 3) {
+                std::copy(texel, texel + componentCount, pixel);
+            } else {
+                std::fill(pixel, pixel + 3, texel[0]);
+                if (componentCount == 2) {
+                    pixel[3] = texel[1];
+                }
+            }
+        }
+    }
+
+    return pixels;
+}
+
+} // namespace CDBTo3DTiles
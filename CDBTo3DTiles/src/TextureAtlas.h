@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Scene.h"
+#include "osg/Image"
+#include <string>
+#include <vector>
+
+namespace CDBTo3DTiles {
+
+bool isRGBAConvertible(const osg::Image &image);
+
+// returns 8 bits RGBA pixels, stored row by row from the top row
+std::vector<unsigned char> convertToRGBA(const osg::Image &image);
+
+struct TextureAtlasResult
+{
+    TextureAtlasResult();
+
+    std::vector<Mesh> meshes;
+    std::vector<Material> materials;
+    std::vector<Texture> textures;
+    std::vector<osg::ref_ptr<osg::Image>> images;
+};
+
+// packs the textures of a model into atlases of at most maxAtlasSize pixels per side, named
+// {atlasName}_{index}.png. Textures that repeat, that do not fit or whose pixels cannot be read as RGBA keep
+// their own file. Identical materials are merged afterward, then the meshes sharing a material
+TextureAtlasResult createTextureAtlases(const std::vector<Mesh> &meshes,
+                                        const std::vector<Material> &materials,
+                                        const std::vector<Texture> &textures,
+                                        const std::vector<osg::ref_ptr<osg::Image>> &images,
+                                        const std::string &atlasName,
+                                        unsigned maxAtlasSize);
+
+} // namespace CDBTo3DTiles
@@ -0,0 +1,86 @@
+#include "TextureCompression.h"
+#include "encoder/basisu_comp.h"
+#include <mutex>
+#include <stdexcept>
+
+namespace CDBTo3DTiles {
+
+std::optional<TextureCompression> parseTextureCompression(const std::string &compression)
+{
+    if (compression == "none") {
+        return TextureCompression::None;
+    } else if (compression == "etc1s") {
+        return TextureCompression::ETC1S;
+    } else if (compression == "uastc") {
+        return TextureCompression::UASTC;
+    }
+
+    return std::nullopt;
+}
+
+std::string textureCompressionToString(TextureCompression compression)
+{
+    switch (compression) {
+    case TextureCompression::None:
+        return "none";
+    case TextureCompression::ETC1S:
+        return "etc1s";
+    case TextureCompression::UASTC:
+        return "uastc";
+    default:
+        return "none";
+    }
+}
+
+std::vector<unsigned char> encodeKTX2(const std::vector<unsigned char> &RGBAPixels,
+                                      unsigned width,
+                                      unsigned height,
+                                      TextureCompression compression)
+{
+    if (compression == TextureCompression::None) {
+        throw std::invalid_argument("KTX2 textures need a Basis Universal compression");
+    }
+
+    if (RGBAPixels.size() != static_cast<size_t>(width) * height * 4) {
+        throw std::invalid_argument("KTX2 texture pixels do not match its size");
+    }
+
+    static std::once_flag encoderInitialized;
+    std::call_once(encoderInitialized, []() { basisu::basisu_encoder_init(); });
+
+    basisu::image image(RGBAPixels.data(), width, height, 4);
+
+    // textures are already encoded in parallel by the tile tasks, so each one uses a single thread
+    basisu::job_pool jobPool(1);
+    basisu::basis_compressor_params params;
+    params.m_source_images.push_back(image);
+    params.m_read_source_images = false;
+    params.m_write_output_basis_files = false;
+    params.m_create_ktx2_file = true;
+    params.m_mip_gen = true;
+    params.m_multithreading = false;
+    params.m_status_output = false;
+    params.m_pJob_pool = &jobPool;
+    if (compression == TextureCompression::UASTC) {
+        params.m_uastc = true;
+        params.m_ktx2_uastc_supercompression = basist::KTX2_SS_ZSTANDARD;
+    } else {
+        params.m_quality_level = 128;
+    }
+
+    basisu::basis_compressor compressor;
+    if (!compressor.init(params)) {
+        throw std::runtime_error("Basis Universal compressor cannot be initialized");
+    }
+
+    auto errorCode = compressor.process();
+    if (errorCode != basisu::basis_compressor::cECSuccess) {
+        throw std::runtime_error("Basis Universal compressor fails with error "
+                                 + std::to_string(static_cast<int>(errorCode)));
+    }
+
+    const auto &KTX2File = compressor.get_output_ktx2_file();
+    return std::vector<unsigned char>(KTX2File.begin(), KTX2File.end());
+}
+
+} // namespace CDBTo3DTiles
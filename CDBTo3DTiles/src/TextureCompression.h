@@ -0,0 +1,27 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace CDBTo3DTiles {
+
+enum class TextureCompression
+{
+    None,
+    ETC1S,
+    UASTC
+};
+
+std::optional<TextureCompression> parseTextureCompression(const std::string &compression);
+
+std::string textureCompressionToString(TextureCompression compression);
+
+// encodes 8 bits RGBA pixels, stored row by row from the top row, into a Basis Universal KTX2 file with the
+// whole mipmap chain
+std::vector<unsigned char> encodeKTX2(const std::vector<unsigned char> &RGBAPixels,
+                                      unsigned width,
+                                      unsigned height,
+                                      TextureCompression compression);
+
+} // namespace CDBTo3DTiles
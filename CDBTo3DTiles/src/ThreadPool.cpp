@@ -0,0 +1,194 @@
+#include "ThreadPool.h"
+#include <chrono>
+
+namespace CDBTo3DTiles {
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local size_t currentQueueIndex = 0;
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : m_stop{false}
+    , m_queuedTasks{0}
+{
+    // the first queue is shared by threads outside of the pool. Every worker owns one of the others
+    size_t workerCount = threadCount > 1 ? threadCount - 1 : 0;
+    for (size_t i = 0; i < workerCount + 1; ++i) {
+        m_queues.emplace_back(std::make_unique<TaskQueue>());
+    }
+
+    for (size_t i = 1; i < workerCount + 1; ++i) {
+        m_workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_condition.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_queuedTasks;
+    }
+
+    auto &queue = *m_queues[getCurrentQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+    }
+
+    m_condition.notify_one();
+}
+
+bool ThreadPool::runPendingTask()
+{
+    std::function<void()> task;
+    if (!takeTask(getCurrentQueueIndex(), task)) {
+        return false;
+    }
+
+    task();
+    return true;
+}
+
+size_t ThreadPool::getCurrentQueueIndex() const noexcept
+{
+    return currentPool == this ? currentQueueIndex : 0;
+}
+
+bool ThreadPool::takeTask(size_t queueIndex, std::function<void()> &task)
+{
+    // workers take the newest task of their own queue first, which keeps the work they spawn hot in cache
+    if (queueIndex != 0) {
+        auto &queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            --m_queuedTasks;
+            return true;
+        }
+    }
+
+    // then steal the oldest task of the shared queue and the other workers
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+        size_t victimIndex = (queueIndex + i) % m_queues.size();
+        if (victimIndex == queueIndex && queueIndex != 0) {
+            continue;
+        }
+
+        auto &queue = *m_queues[victimIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --m_queuedTasks;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t queueIndex)
+{
+    currentPool = this;
+    currentQueueIndex = queueIndex;
+
+    while (true) {
+        std::function<void()> task;
+        if (takeTask(queueIndex, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_stop || m_queuedTasks > 0; });
+        if (m_stop && m_queuedTasks == 0) {
+            return;
+        }
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool)
+    : m_pool{pool}
+    , m_pendingTasks{0}
+{}
+
+TaskGroup::~TaskGroup() noexcept
+{
+    waitForPendingTasks();
+}
+
+void TaskGroup::run(std::function<void()> task)
+{
+    // no worker to hand the task to, so run it now and keep the original sequential order
+    if (m_pool.isSequential()) {
+        try {
+            task();
+        } catch (...) {
+            if (!m_exception) {
+                m_exception = std::current_exception();
+            }
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_pendingTasks;
+    }
+
+    m_pool.submit([this, task = std::move(task)]() {
+        std::exception_ptr exception;
+        try {
+            task();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (exception && !m_exception) {
+            m_exception = exception;
+        }
+
+        --m_pendingTasks;
+        m_condition.notify_all();
+    });
+}
+
+void TaskGroup::wait()
+{
+    waitForPendingTasks();
+
+    std::exception_ptr exception;
+    std::swap(exception, m_exception);
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void TaskGroup::waitForPendingTasks()
+{
+    // help the pool while waiting so that nested task groups cannot starve the workers
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_pendingTasks > 0) {
+        lock.unlock();
+        bool ranTask = m_pool.runPendingTask();
+        lock.lock();
+        if (!ranTask && m_pendingTasks > 0) {
+            m_condition.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+}
+} // namespace CDBTo3DTiles
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CDBTo3DTiles {
+class ThreadPool
+{
+public:
+    // threadCount includes the thread that waits on the tasks, so a pool of 1 runs everything inline
+    explicit ThreadPool(size_t threadCount);
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() noexcept;
+
+    inline size_t getThreadCount() const noexcept { return m_workers.size() + 1; }
+
+    inline bool isSequential() const noexcept { return m_workers.empty(); }
+
+    void submit(std::function<void()> task);
+
+    bool runPendingTask();
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    size_t getCurrentQueueIndex() const noexcept;
+
+    bool takeTask(size_t queueIndex, std::function<void()> &task);
+
+    void workerLoop(size_t queueIndex);
+
+    bool m_stop;
+    std::atomic<size_t> m_queuedTasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+};
+
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &pool);
+
+    TaskGroup(const TaskGroup &) = delete;
+
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    ~TaskGroup() noexcept;
+
+    void run(std::function<void()> task);
+
+    void wait();
+
+private:
+    void waitForPendingTasks();
+
+    ThreadPool &m_pool;
+    size_t m_pendingTasks;
+    std::exception_ptr m_exception;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+} // namespace CDBTo3DTiles
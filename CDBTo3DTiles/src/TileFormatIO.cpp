@@ -2,96 +2,466 @@
 #include "Ellipsoid.h"
 #include "glm/gtc/matrix_access.hpp"
 #include "nlohmann/json.hpp"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <tuple>
 
 namespace CDBTo3DTiles {
 
 static float MAX_GEOMETRIC_ERROR = 300000.0f;
 
+// a tileset rooted at level -10 reaches level 23 after 33 halvings
+static const size_t GEOMETRIC_ERROR_LEVELS = 34;
+
+static const unsigned IMPLICIT_SUBTREE_LEVELS = 6;
+
+static const std::string IMPLICIT_SUBTREE_URI = "subtrees/{level}.{x}.{y}.subtree";
+
+static const size_t JSON_STREAM_BUFFER_SIZE = 65536;
+
+static const size_t COLUMN_CHUNK_SIZE = 4096;
+
+static std::array<float, GEOMETRIC_ERROR_LEVELS> createGeometricErrors();
+
+// the geometric error of each level, indexed by its depth under the root of the tileset
+static const std::array<float, GEOMETRIC_ERROR_LEVELS> GEOMETRIC_ERRORS = createGeometricErrors();
+
 static void createBatchTable(const CDBInstancesAttributes *instancesAttribs,
                              std::string &batchTableJson,
-                             std::vector<uint8_t> &batchTableBuffer);
+                             size_t &batchTableBinByteLength);
+
+// the batch table JSON is assembled as text, one entry per column, so no JSON node is allocated per feature.
+// Numeric columns always go to the binary body and strings stay JSON arrays as 3D Tiles requires
+static std::string createBatchTableJson(const CDBInstancesAttributes &instancesAttribs,
+                                        const std::vector<int> *attribIndices,
+                                        size_t &batchTableBinByteLength);
+
+static std::string createStringColumnJson(const CDBStringColumn &values,
+                                          const std::vector<int> *attribIndices);
+
+static std::string createBinaryColumnJson(size_t byteOffset, const std::string &componentType);
+
+static void appendJsonString(std::string &json, const std::string &value);
+
+static void writeBatchTableBinary(const CDBInstancesAttributes &instancesAttribs,
+                                  size_t batchTableBinByteLength,
+                                  std::ostream &fs);
+
+static void writePadding(std::ostream &fs, size_t byteLength, char value);
+
+// writes the values of the selected instances in chunks, so a tile never stages its whole column
+template<typename T, typename Value>
+static size_t writeColumn(std::ostream &fs, const std::vector<int> &attribIndices, Value value)
+{
+    std::vector<T> chunk;
+    chunk.reserve(glm::min(attribIndices.size(), COLUMN_CHUNK_SIZE));
+    for (size_t i = 0; i < attribIndices.size(); ++i) {
+        chunk.emplace_back(value(static_cast<size_t>(attribIndices[i])));
+        if (chunk.size() == COLUMN_CHUNK_SIZE || i == attribIndices.size() - 1) {
+            fs.write(reinterpret_cast<const char *>(chunk.data()),
+                     static_cast<std::streamsize>(chunk.size() * sizeof(T)));
+            chunk.clear();
+        }
+    }
+
+    return attribIndices.size() * sizeof(T);
+}
+
+static B3DM createB3DMTables(const CDBInstancesAttributes *instancesAttribs, size_t paddedGlbByteLength);
 
-static void convertTilesetToJson(const CDBTile &tile, float geometricError, nlohmann::json &json);
+static void writeB3DMHeaderAndTables(const B3DM &b3dm, std::ostream &fs);
+
+// writes JSON straight to the stream as it is walked, so a tileset never exists in memory as a document.
+// Keys are written in the sorted order nlohmann::json dumps them and numbers are formatted the same way
+class JsonStreamWriter
+{
+public:
+    explicit JsonStreamWriter(std::ostream &fs);
+
+    void beginObject();
+
+    void endObject();
+
+    void beginArray();
+
+    void endArray();
+
+    void key(const std::string &name);
+
+    void value(const std::string &text);
+
+    void value(double number);
+
+    void value(unsigned number);
+
+    void flush();
+
+private:
+    void beginValue();
+
+    std::ostream &m_fs;
+    std::string m_buffer;
+    std::vector<bool> m_hasValues;
+    bool m_afterKey;
+};
+
+// the tiles whose depth below the root of their tileset is a multiple of levels are cut into external
+// tilesets written in directory
+struct ExternalTilesetSplit
+{
+    unsigned levels;
+    const std::filesystem::path *directory;
+    const char *refine;
+};
+
+static void writeTilesetDocumentToJson(const CDBTile &root,
+                                       float geometricError,
+                                       const char *refine,
+                                       const ExternalTilesetSplit *split,
+                                       std::ostream &fs);
+
+static void writeTilesetToJson(const CDBTile &tile,
+                               float geometricError,
+                               const char *refine,
+                               const ExternalTilesetSplit *split,
+                               unsigned depth,
+                               JsonStreamWriter &writer);
+
+static std::string writeToExternalTilesetJson(const CDBTile &tile,
+                                              float geometricError,
+                                              const ExternalTilesetSplit &split);
+
+static void writeBoundRegionToJson(const Core::BoundingRegion &boundRegion, JsonStreamWriter &writer);
+
+// a tile of the implicit quadtree, with its coordinates relative to the implicit root
+struct ImplicitTile
+{
+    unsigned level;
+    uint32_t x;
+    uint32_t y;
+    const CDBTile *tile;
+};
+
+struct ImplicitSubtree
+{
+    std::vector<uint8_t> tileAvailability;
+    std::vector<uint8_t> contentAvailability;
+    std::vector<uint8_t> childSubtreeAvailability;
+};
+
+static void collectImplicitTiles(
+    const CDBTile &tile, unsigned level, uint32_t x, uint32_t y, std::vector<ImplicitTile> &implicitTiles);
+
+static void setAvailableBit(std::vector<uint8_t> &bitstream, uint64_t bit);
+
+static void writeToSubtree(const ImplicitSubtree &subtree,
+                           size_t tileBitCount,
+                           size_t childSubtreeBitCount,
+                           std::ostream &fs);
 
 void combineTilesetJson(const std::vector<std::filesystem::path> &tilesetJsonPaths,
                         const std::vector<Core::BoundingRegion> &regions,
-                        std::ofstream &fs)
+                        std::ostream &fs)
 {
-    nlohmann::json tilesetJson;
-    tilesetJson["asset"] = {{"version", "1.0"}};
-    tilesetJson["geometricError"] = MAX_GEOMETRIC_ERROR;
-    tilesetJson["root"] = nlohmann::json::object();
-    tilesetJson["root"]["refine"] = "ADD";
-    tilesetJson["root"]["geometricError"] = MAX_GEOMETRIC_ERROR;
-
-    auto rootChildren = nlohmann::json::array();
+    // the root region is written before its children, so it is merged first
     auto rootRegion = regions.front();
     for (size_t i = 0; i < tilesetJsonPaths.size(); ++i) {
-        const auto &path = tilesetJsonPaths[i];
-        const auto &childBoundRegion = regions[i];
-        const auto &childRectangle = childBoundRegion.getRectangle();
-        nlohmann::json childJson;
-        childJson["geometricError"] = MAX_GEOMETRIC_ERROR;
-        childJson["content"] = nlohmann::json::object();
-        childJson["content"]["uri"] = path;
-        childJson["boundingVolume"] = {{"region",
-                                        {
-                                            childRectangle.getWest(),
-                                            childRectangle.getSouth(),
-                                            childRectangle.getEast(),
-                                            childRectangle.getNorth(),
-                                            childBoundRegion.getMinimumHeight(),
-                                            childBoundRegion.getMaximumHeight(),
-                                        }}};
-
-        rootChildren.emplace_back(childJson);
-        rootRegion = rootRegion.computeUnion(childBoundRegion);
-    }
-
-    const auto &rootRectangle = rootRegion.getRectangle();
-    tilesetJson["root"]["children"] = rootChildren;
-    tilesetJson["root"]["boundingVolume"] = {{"region",
-                                              {
-                                                  rootRectangle.getWest(),
-                                                  rootRectangle.getSouth(),
-                                                  rootRectangle.getEast(),
-                                                  rootRectangle.getNorth(),
-                                                  rootRegion.getMinimumHeight(),
-                                                  rootRegion.getMaximumHeight(),
-                                              }}};
-
-    fs << tilesetJson << std::endl;
-}
-
-void writeToTilesetJson(const CDBTileset &tileset, bool replace, std::ofstream &fs)
-{
-    nlohmann::json tilesetJson;
-    tilesetJson["asset"] = {{"version", "1.0"}};
-    tilesetJson["root"] = nlohmann::json::object();
-    if (replace) {
-        tilesetJson["root"]["refine"] = "REPLACE";
-    } else {
-        tilesetJson["root"]["refine"] = "ADD";
+        rootRegion = rootRegion.computeUnion(regions[i]);
+    }
+
+    JsonStreamWriter writer(fs);
+    writer.beginObject();
+    writer.key("asset");
+    writer.beginObject();
+    writer.key("version");
+    writer.value("1.0");
+    writer.endObject();
+    writer.key("geometricError");
+    writer.value(MAX_GEOMETRIC_ERROR);
+    writer.key("root");
+    writer.beginObject();
+    writer.key("boundingVolume");
+    writeBoundRegionToJson(rootRegion, writer);
+    writer.key("children");
+    writer.beginArray();
+    for (size_t i = 0; i < tilesetJsonPaths.size(); ++i) {
+        writer.beginObject();
+        writer.key("boundingVolume");
+        writeBoundRegionToJson(regions[i], writer);
+        writer.key("content");
+        writer.beginObject();
+        writer.key("uri");
+        writer.value(tilesetJsonPaths[i].u8string());
+        writer.endObject();
+        writer.key("geometricError");
+        writer.value(MAX_GEOMETRIC_ERROR);
+        writer.endObject();
     }
 
+    writer.endArray();
+    writer.key("geometricError");
+    writer.value(MAX_GEOMETRIC_ERROR);
+    writer.key("refine");
+    writer.value("ADD");
+    writer.endObject();
+    writer.endObject();
+    writer.flush();
+    fs << std::endl;
+}
+
+void writeToTilesetJson(const CDBTileset &tileset, bool replace, std::ostream &fs)
+{
     auto root = tileset.getRoot();
     if (root) {
-        convertTilesetToJson(*root, MAX_GEOMETRIC_ERROR, tilesetJson["root"]);
-        tilesetJson["geometricError"] = tilesetJson["root"]["geometricError"];
-        fs << tilesetJson << std::endl;
+        writeTilesetDocumentToJson(*root, MAX_GEOMETRIC_ERROR, replace ? "REPLACE" : "ADD", nullptr, fs);
     }
 }
 
-size_t writeToI3DM(std::string GltfURI,
-                   const CDBModelsAttributes &modelsAttribs,
-                   const std::vector<int> &attribIndices,
-                   std::ofstream &fs)
+void writeToTilesetJson(const CDBTileset &tileset,
+                        bool replace,
+                        unsigned externalTilesetLevels,
+                        const std::filesystem::path &tilesetDirectory,
+                        std::ostream &fs)
+{
+    if (externalTilesetLevels == 0) {
+        writeToTilesetJson(tileset, replace, fs);
+        return;
+    }
+
+    auto root = tileset.getRoot();
+    if (root) {
+        const char *refine = replace ? "REPLACE" : "ADD";
+        ExternalTilesetSplit split{externalTilesetLevels, &tilesetDirectory, refine};
+        writeTilesetDocumentToJson(*root, MAX_GEOMETRIC_ERROR, refine, &split, fs);
+    }
+}
+
+void writeToImplicitTilesetJson(const CDBTileset &tileset,
+                                bool replace,
+                                const std::filesystem::path &tilesetDirectory,
+                                std::ostream &fs)
+{
+    auto root = tileset.getRoot();
+    if (!root) {
+        return;
+    }
+
+    // each negative level is a single tile covering the GeoCell, so the quadtree starts at level 0
+    std::vector<const CDBTile *> explicitTiles;
+    const CDBTile *implicitRoot = root;
+    while (implicitRoot && implicitRoot->getLevel() < 0) {
+        explicitTiles.emplace_back(implicitRoot);
+        const auto &children = implicitRoot->getChildren();
+        implicitRoot = children.empty() ? nullptr : children.back();
+    }
+
+    std::vector<ImplicitTile> implicitTiles;
+    std::set<std::string> contentExtensions;
+    if (implicitRoot) {
+        collectImplicitTiles(*implicitRoot, 0, 0, 0, implicitTiles);
+        for (const auto &implicitTile : implicitTiles) {
+            auto contentURI = implicitTile.tile->getCustomContentURI();
+            if (contentURI) {
+                contentExtensions.insert(contentURI->extension().string());
+            }
+        }
+    }
+
+    // the content template has a single extension
+    if (!implicitRoot || contentExtensions.size() > 1) {
+        writeToTilesetJson(tileset, replace, fs);
+        return;
+    }
+
+    unsigned availableLevels = 0;
+    for (const auto &implicitTile : implicitTiles) {
+        availableLevels = std::max(availableLevels, implicitTile.level + 1);
+    }
+
+    // the bitstreams of a subtree hold its levels one after the other, each level in Morton order
+    std::string contentExtension = contentExtensions.empty() ? "" : *contentExtensions.begin();
+    unsigned subtreeLevels = std::min(availableLevels, IMPLICIT_SUBTREE_LEVELS);
+    size_t childSubtreeBitCount = size_t(1) << (2 * subtreeLevels);
+    size_t tileBitCount = (childSubtreeBitCount - 1) / 3;
+    std::map<std::tuple<unsigned, uint32_t, uint32_t>, ImplicitSubtree> subtrees;
+    auto getSubtree = [&](unsigned level, uint32_t x, uint32_t y) -> ImplicitSubtree & {
+        auto subtree = subtrees.try_emplace({level, x, y});
+        if (subtree.second) {
+            subtree.first->second.tileAvailability.resize((tileBitCount + 7) / 8, 0);
+            subtree.first->second.contentAvailability.resize((tileBitCount + 7) / 8, 0);
+            subtree.first->second.childSubtreeAvailability.resize((childSubtreeBitCount + 7) / 8, 0);
+        }
+
+        return subtree.first->second;
+    };
+
+    for (const auto &implicitTile : implicitTiles) {
+        unsigned depth = implicitTile.level % subtreeLevels;
+        unsigned subtreeLevel = implicitTile.level - depth;
+        uint32_t subtreeX = implicitTile.x >> depth;
+        uint32_t subtreeY = implicitTile.y >> depth;
+        auto &subtree = getSubtree(subtreeLevel, subtreeX, subtreeY);
+        uint64_t bit = ((uint64_t(1) << (2 * depth)) - 1) / 3
+                       + computeMortonCode(implicitTile.x - (subtreeX << depth),
+                                           implicitTile.y - (subtreeY << depth));
+        setAvailableBit(subtree.tileAvailability, bit);
+
+        auto contentURI = implicitTile.tile->getCustomContentURI();
+        if (contentURI) {
+            setAvailableBit(subtree.contentAvailability, bit);
+
+            std::string implicitContentURI = std::to_string(implicitTile.level) + "_"
+                                             + std::to_string(implicitTile.x) + "_"
+                                             + std::to_string(implicitTile.y) + contentExtension;
+            auto contentPath = tilesetDirectory / *contentURI;
+            if (*contentURI != implicitContentURI && std::filesystem::exists(contentPath)) {
+                std::filesystem::rename(contentPath, tilesetDirectory / implicitContentURI);
+            }
+        }
+
+        // the roots of the subtrees below the first one are also children of the subtree above them
+        if (depth == 0 && implicitTile.level > 0) {
+            uint32_t parentX = implicitTile.x >> subtreeLevels;
+            uint32_t parentY = implicitTile.y >> subtreeLevels;
+            auto &parentSubtree = getSubtree(subtreeLevel - subtreeLevels, parentX, parentY);
+            setAvailableBit(parentSubtree.childSubtreeAvailability,
+                            computeMortonCode(implicitTile.x - (parentX << subtreeLevels),
+                                              implicitTile.y - (parentY << subtreeLevels)));
+        }
+    }
+
+    std::filesystem::path subtreeDirectory = tilesetDirectory / "subtrees";
+    std::filesystem::create_directories(subtreeDirectory);
+    for (const auto &subtree : subtrees) {
+        auto [level, x, y] = subtree.first;
+        std::string subtreeFilename = std::to_string(level) + "." + std::to_string(x) + "."
+                                      + std::to_string(y) + ".subtree";
+        std::ofstream subtreeFile(subtreeDirectory / subtreeFilename, std::ios::binary);
+        writeToSubtree(subtree.second, tileBitCount, childSubtreeBitCount, subtreeFile);
+    }
+
+    // the explicit tiles are opened down to the implicit root, then closed back up
+    std::string refine = replace ? "REPLACE" : "ADD";
+    float rootGeometricError = computeGeometricError(tileset, root->getLevel());
+    JsonStreamWriter writer(fs);
+    writer.beginObject();
+    writer.key("asset");
+    writer.beginObject();
+    writer.key("version");
+    writer.value("1.1");
+    writer.endObject();
+    writer.key("geometricError");
+    writer.value(rootGeometricError);
+    writer.key("root");
+    for (auto explicitTile : explicitTiles) {
+        writer.beginObject();
+        writer.key("boundingVolume");
+        writeBoundRegionToJson(explicitTile->getBoundRegion(), writer);
+        writer.key("children");
+        writer.beginArray();
+    }
+
+    writer.beginObject();
+    writer.key("boundingVolume");
+    writeBoundRegionToJson(implicitRoot->getBoundRegion(), writer);
+    if (!contentExtensions.empty()) {
+        writer.key("content");
+        writer.beginObject();
+        writer.key("uri");
+        writer.value("{level}_{x}_{y}" + contentExtension);
+        writer.endObject();
+    }
+
+    writer.key("geometricError");
+    writer.value(computeGeometricError(tileset, implicitRoot->getLevel()));
+    writer.key("implicitTiling");
+    writer.beginObject();
+    writer.key("availableLevels");
+    writer.value(availableLevels);
+    writer.key("subdivisionScheme");
+    writer.value("QUADTREE");
+    writer.key("subtreeLevels");
+    writer.value(subtreeLevels);
+    writer.key("subtrees");
+    writer.beginObject();
+    writer.key("uri");
+    writer.value(IMPLICIT_SUBTREE_URI);
+    writer.endObject();
+    writer.endObject();
+    if (explicitTiles.empty()) {
+        writer.key("refine");
+        writer.value(refine);
+    }
+
+    writer.endObject();
+    for (size_t i = explicitTiles.size(); i > 0; --i) {
+        const CDBTile *explicitTile = explicitTiles[i - 1];
+        writer.endArray();
+        auto contentURI = explicitTile->getCustomContentURI();
+        if (contentURI) {
+            writer.key("content");
+            writer.beginObject();
+            writer.key("uri");
+            writer.value(contentURI->u8string());
+            writer.endObject();
+        }
+
+        writer.key("geometricError");
+        writer.value(computeGeometricError(tileset, explicitTile->getLevel()));
+        if (i == 1) {
+            writer.key("refine");
+            writer.value(refine);
+        }
+
+        writer.endObject();
+    }
+
+    writer.endObject();
+    writer.flush();
+    fs << std::endl;
+}
+
+float computeGeometricError(const CDBTileset &tileset, int level)
+{
+    // the error of the root is halved at every level
+    int depth = level - tileset.getRootLevel();
+    if (depth >= 0 && static_cast<size_t>(depth) < GEOMETRIC_ERROR_LEVELS) {
+        return GEOMETRIC_ERRORS[static_cast<size_t>(depth)];
+    }
+
+    return std::ldexp(MAX_GEOMETRIC_ERROR, -depth);
+}
+
+TileOutputFile::TileOutputFile(const std::filesystem::path &path)
+    : m_buffer(TILE_OUTPUT_BUFFER_SIZE)
+{
+    // the buffer has to be set before the file is opened to be used
+    m_stream.rdbuf()->pubsetbuf(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_stream.open(path, std::ios::binary);
+}
+
+size_t I3DM::getByteLength() const noexcept
+{
+    return sizeof(I3dmHeader) + featureTableJson.size() + featureTableBinByteLength + batchTableJson.size()
+           + batchTableBinByteLength + GltfURI.size();
+}
+
+size_t B3DM::getByteLength() const noexcept
+{
+    return sizeof(B3dmHeader) + featureTableJson.size() + batchTableJson.size() + batchTableBinByteLength
+           + paddedGlbByteLength;
+}
+
+I3DM createI3DM(std::string GltfURI,
+                const CDBModelsAttributes &modelsAttribs,
+                const std::vector<int> &attribIndices)
 {
     const auto &cdbTile = modelsAttribs.getTile();
     const auto &instancesAttribs = modelsAttribs.getInstancesAttributes();
-    const auto &cartographicPositions = modelsAttribs.getCartographicPositions();
-    const auto &scales = modelsAttribs.getScales();
-    const auto &orientation = modelsAttribs.getOrientations();
 
     size_t totalInstances = attribIndices.size();
     size_t totalPositionSize = totalInstances * sizeof(glm::vec3);
@@ -115,126 +485,123 @@ size_t writeToI3DM(std::string GltfURI,
     featureTableJson["NORMAL_UP"] = {{"byteOffset", normalUpOffset}};
     featureTableJson["NORMAL_RIGHT"] = {{"byteOffset", normalRightOffset}};
 
-    // create feature table binary
-    std::vector<unsigned char> featureTableBuffer;
-    featureTableBuffer.resize(
-        roundUp(totalPositionSize + totalScaleSize + totalNormalUpSize + totalNormalRightSize, 8));
-    for (size_t i = 0; i < attribIndices.size(); ++i) {
-        size_t instanceIdx = static_cast<size_t>(attribIndices[i]);
-        glm::dvec3 worldPosition = ellipsoid.cartographicToCartesian(cartographicPositions[instanceIdx]);
-        glm::vec3 positionRTC = worldPosition - center;
-
-        glm::dmat4 rotation = calculateModelOrientation(worldPosition, orientation[instanceIdx]);
-        glm::vec3 normalUp = glm::normalize(glm::column(rotation, 1));
-        glm::vec3 normalRight = glm::normalize(glm::column(rotation, 0));
-
-        std::memcpy(featureTableBuffer.data() + positionOffset + i * sizeof(glm::vec3),
-                    &positionRTC[0],
-                    sizeof(glm::vec3));
-
-        std::memcpy(featureTableBuffer.data() + scaleOffset + i * sizeof(glm::vec3),
-                    &scales[instanceIdx][0],
-                    sizeof(glm::vec3));
-
-        std::memcpy(featureTableBuffer.data() + normalUpOffset + i * sizeof(glm::vec3),
-                    &normalUp,
-                    sizeof(glm::vec3));
-
-        std::memcpy(featureTableBuffer.data() + normalRightOffset + i * sizeof(glm::vec3),
-                    &normalRight,
-                    sizeof(glm::vec3));
-    }
+    // create batch table json. The binary part is only generated when the tile is written
+    size_t batchTableBinByteLength = 0;
+    std::string batchTableJson = createBatchTableJson(instancesAttribs,
+                                                      &attribIndices,
+                                                      batchTableBinByteLength);
 
-    // create batch table
-    const auto &CNAMs = instancesAttribs.getCNAMs();
-    const auto &integerAttribs = instancesAttribs.getIntegerAttribs();
-    const auto &doubleAttribs = instancesAttribs.getDoubleAttribs();
-    const auto &stringAttribs = instancesAttribs.getStringAttribs();
-    size_t totalIntSize = roundUp(totalInstances * integerAttribs.size() * sizeof(int32_t), 8);
-    size_t totalDoubleSize = totalInstances * doubleAttribs.size() * sizeof(double);
-    std::vector<unsigned char> batchTableBuffer(totalIntSize + totalDoubleSize);
-
-    nlohmann::json batchTableJson;
-    batchTableJson["CNAM"] = nlohmann::json::array();
-    for (auto idx : attribIndices) {
-        batchTableJson["CNAM"].emplace_back(CNAMs[static_cast<size_t>(idx)]);
-    }
-
-    for (auto pair : stringAttribs) {
-        if (batchTableJson.find(pair.first) == batchTableJson.end()) {
-            batchTableJson[pair.first] = nlohmann::json::array();
-        }
+    I3DM i3dm;
+    i3dm.featureTableJson = featureTableJson.dump();
+    size_t headerToRoundUp = sizeof(I3dmHeader) + i3dm.featureTableJson.size();
+    i3dm.featureTableJson.append(roundUp(headerToRoundUp, 8) - headerToRoundUp, ' ');
+    i3dm.featureTableBinByteLength = roundUp(totalPositionSize + totalScaleSize + totalNormalUpSize
+                                                 + totalNormalRightSize,
+                                             8);
 
-        for (auto idx : attribIndices) {
-            batchTableJson[pair.first].emplace_back(pair.second[static_cast<size_t>(idx)]);
-        }
-    }
+    i3dm.batchTableJson = std::move(batchTableJson);
+    i3dm.batchTableJson.append(roundUp(i3dm.batchTableJson.size(), 8) - i3dm.batchTableJson.size(), ' ');
+    i3dm.batchTableBinByteLength = batchTableBinByteLength;
 
-    size_t batchTableOffset = 0;
-    for (auto pair : integerAttribs) {
-        batchTableJson[pair.first]["byteOffset"] = batchTableOffset;
-        batchTableJson[pair.first]["type"] = "SCALAR";
-        batchTableJson[pair.first]["componentType"] = "INT";
-        for (auto idx : attribIndices) {
-            int value = pair.second[static_cast<size_t>(idx)];
-            std::memcpy(batchTableBuffer.data() + batchTableOffset, &value, sizeof(int32_t));
-            batchTableOffset += sizeof(int32_t);
-        }
-    }
+    i3dm.GltfURI = std::move(GltfURI);
+    i3dm.GltfURI.append(roundUp(i3dm.GltfURI.size(), 8) - i3dm.GltfURI.size(), ' ');
+    i3dm.modelsAttribs = &modelsAttribs;
+    i3dm.attribIndices = &attribIndices;
+    return i3dm;
+}
 
-    batchTableOffset = roundUp(batchTableOffset, 8);
-    for (auto pair : doubleAttribs) {
-        batchTableJson[pair.first]["byteOffset"] = batchTableOffset;
-        batchTableJson[pair.first]["type"] = "SCALAR";
-        batchTableJson[pair.first]["componentType"] = "DOUBLE";
-        for (auto idx : attribIndices) {
-            double value = pair.second[static_cast<size_t>(idx)];
-            std::memcpy(batchTableBuffer.data() + batchTableOffset, &value, sizeof(double));
-            batchTableOffset += sizeof(double);
-        }
-    }
+size_t writeToI3DM(const I3DM &i3dm, std::ostream &fs)
+{
+    const auto &modelsAttribs = *i3dm.modelsAttribs;
+    const auto &attribIndices = *i3dm.attribIndices;
+    const auto &cdbTile = modelsAttribs.getTile();
+    const auto &instancesAttribs = modelsAttribs.getInstancesAttributes();
+    const auto &cartographicPositions = modelsAttribs.getCartographicPositions();
+    const auto &scales = modelsAttribs.getScales();
+    const auto &orientation = modelsAttribs.getOrientations();
 
     // create header
-    std::string featureTableString = featureTableJson.dump();
-    size_t headerToRoundUp = sizeof(I3dmHeader) + featureTableString.size();
-    featureTableString += std::string(roundUp(headerToRoundUp, 8) - headerToRoundUp, ' ');
-
-    std::string batchTableString = batchTableJson.dump();
-    batchTableString += std::string(roundUp(batchTableString.size(), 8) - batchTableString.size(), ' ');
-
-    GltfURI += std::string(roundUp(GltfURI.size(), 8) - GltfURI.size(), ' ');
-
     I3dmHeader header;
     header.magic[0] = 'i';
     header.magic[1] = '3';
     header.magic[2] = 'd';
     header.magic[3] = 'm';
     header.version = 1;
-    header.byteLength = static_cast<uint32_t>(sizeof(header))
-                        + static_cast<uint32_t>(featureTableString.size())
-                        + static_cast<uint32_t>(featureTableBuffer.size())
-                        + static_cast<uint32_t>(batchTableString.size())
-                        + static_cast<uint32_t>(batchTableBuffer.size())
-                        + static_cast<uint32_t>(GltfURI.size());
-    header.featureTableJsonByteLength = static_cast<uint32_t>(featureTableString.size());
-    header.featureTableBinByteLength = static_cast<uint32_t>(featureTableBuffer.size());
-    header.batchTableJsonByteLength = static_cast<uint32_t>(batchTableString.size());
-    header.batchTableBinByteLength = static_cast<uint32_t>(batchTableBuffer.size());
+    header.byteLength = static_cast<uint32_t>(i3dm.getByteLength());
+    header.featureTableJsonByteLength = static_cast<uint32_t>(i3dm.featureTableJson.size());
+    header.featureTableBinByteLength = static_cast<uint32_t>(i3dm.featureTableBinByteLength);
+    header.batchTableJsonByteLength = static_cast<uint32_t>(i3dm.batchTableJson.size());
+    header.batchTableBinByteLength = static_cast<uint32_t>(i3dm.batchTableBinByteLength);
     header.gltfFormat = 0;
 
     fs.write(reinterpret_cast<const char *>(&header), sizeof(I3dmHeader));
-    fs.write(featureTableString.data(), static_cast<std::streamsize>(featureTableString.size()));
-    fs.write(reinterpret_cast<const char *>(featureTableBuffer.data()), static_cast<std::streamsize>(featureTableBuffer.size()));
+    fs.write(i3dm.featureTableJson.data(), static_cast<std::streamsize>(i3dm.featureTableJson.size()));
+
+    // write feature table binary one column at a time
+    const auto &ellipsoid = Core::Ellipsoid::WGS84;
+    auto centerCartographic = cdbTile.getBoundRegion().getRectangle().computeCenter();
+    auto center = ellipsoid.cartographicToCartesian(centerCartographic);
+    auto computeRotation = [&](size_t instanceIdx) {
+        glm::dvec3 worldPosition = ellipsoid.cartographicToCartesian(cartographicPositions[instanceIdx]);
+        return calculateModelOrientation(worldPosition, orientation[instanceIdx]);
+    };
+
+    size_t featureTableBinWritten = 0;
+    featureTableBinWritten += writeColumn<glm::vec3>(fs, attribIndices, [&](size_t instanceIdx) {
+        glm::dvec3 worldPosition = ellipsoid.cartographicToCartesian(cartographicPositions[instanceIdx]);
+        return glm::vec3(worldPosition - center);
+    });
+
+    featureTableBinWritten += writeColumn<glm::vec3>(fs, attribIndices, [&](size_t instanceIdx) {
+        return scales[instanceIdx];
+    });
+
+    featureTableBinWritten += writeColumn<glm::vec3>(fs, attribIndices, [&](size_t instanceIdx) {
+        return glm::vec3(glm::normalize(glm::column(computeRotation(instanceIdx), 1)));
+    });
+
+    featureTableBinWritten += writeColumn<glm::vec3>(fs, attribIndices, [&](size_t instanceIdx) {
+        return glm::vec3(glm::normalize(glm::column(computeRotation(instanceIdx), 0)));
+    });
 
-    fs.write(batchTableString.data(), static_cast<std::streamsize>(batchTableString.size()));
-    fs.write(reinterpret_cast<const char *>(batchTableBuffer.data()), static_cast<std::streamsize>(batchTableBuffer.size()));
+    writePadding(fs, i3dm.featureTableBinByteLength - featureTableBinWritten, 0);
 
-    fs.write(GltfURI.data(), static_cast<std::streamsize>(GltfURI.size()));
+    // write batch table
+    fs.write(i3dm.batchTableJson.data(), static_cast<std::streamsize>(i3dm.batchTableJson.size()));
+
+    size_t batchTableBinWritten = 0;
+    for (const auto &pair : instancesAttribs.getIntegerAttribs()) {
+        const auto &values = pair.second;
+        batchTableBinWritten += writeColumn<int32_t>(fs, attribIndices, [&](size_t instanceIdx) {
+            return values[instanceIdx];
+        });
+    }
+
+    writePadding(fs, roundUp(batchTableBinWritten, 8) - batchTableBinWritten, 0);
+    batchTableBinWritten = roundUp(batchTableBinWritten, 8);
+    for (const auto &pair : instancesAttribs.getDoubleAttribs()) {
+        const auto &values = pair.second;
+        batchTableBinWritten += writeColumn<double>(fs, attribIndices, [&](size_t instanceIdx) {
+            return values[instanceIdx];
+        });
+    }
+
+    writePadding(fs, i3dm.batchTableBinByteLength - batchTableBinWritten, 0);
+
+    fs.write(i3dm.GltfURI.data(), static_cast<std::streamsize>(i3dm.GltfURI.size()));
 
     return header.byteLength;
 }
 
-void writeToB3DM(tinygltf::Model *gltf, const CDBInstancesAttributes *instancesAttribs, std::ofstream &fs)
+size_t writeToI3DM(std::string GltfURI,
+                   const CDBModelsAttributes &modelsAttribs,
+                   const std::vector<int> &attribIndices,
+                   std::ostream &fs)
+{
+    return writeToI3DM(createI3DM(std::move(GltfURI), modelsAttribs, attribIndices), fs);
+}
+
+void writeToB3DM(tinygltf::Model *gltf, const CDBInstancesAttributes *instancesAttribs, std::ostream &fs)
 {
     // create glb
     std::stringstream ss;
@@ -247,20 +614,66 @@ void writeToB3DM(tinygltf::Model *gltf, const CDBInstancesAttributes *instancesA
     std::vector<uint8_t> glbBuffer(roundUp(static_cast<size_t>(offset), 8), 0);
     ss.read(reinterpret_cast<char *>(glbBuffer.data()), static_cast<std::streamsize>(glbBuffer.size()));
 
+    writeB3DMHeaderAndTables(createB3DMTables(instancesAttribs, glbBuffer.size()), fs);
+    fs.write(reinterpret_cast<const char *>(glbBuffer.data()), static_cast<std::streamsize>(glbBuffer.size()));
+}
+
+void writeToB3DM(tinygltf::Model *gltf,
+                 const std::vector<GltfBufferSegment> &bufferSegments,
+                 const CDBInstancesAttributes *instancesAttribs,
+                 std::ostream &fs)
+{
+    writeToB3DM(createB3DM(gltf, bufferSegments, instancesAttribs), fs);
+}
+
+B3DM createB3DM(tinygltf::Model *gltf,
+                const std::vector<GltfBufferSegment> &bufferSegments,
+                const CDBInstancesAttributes *instancesAttribs)
+{
+    std::string glbJson = createGlbJson(gltf, bufferSegments);
+    size_t glbByteLength = computeGlbByteLength(glbJson, bufferSegments);
+    B3DM b3dm = createB3DMTables(instancesAttribs, roundUp(glbByteLength, 8));
+    b3dm.glbJson = std::move(glbJson);
+    b3dm.glbByteLength = glbByteLength;
+    b3dm.bufferSegments = &bufferSegments;
+    return b3dm;
+}
+
+size_t writeToB3DM(const B3DM &b3dm, std::ostream &fs)
+{
+    // the glb is written right after the tables, so the mesh data are never copied into a glTF buffer
+    writeB3DMHeaderAndTables(b3dm, fs);
+    writeToGlb(b3dm.glbJson, *b3dm.bufferSegments, fs);
+    writePadding(fs, b3dm.paddedGlbByteLength - b3dm.glbByteLength, 0);
+    return b3dm.getByteLength();
+}
+
+B3DM createB3DMTables(const CDBInstancesAttributes *instancesAttribs, size_t paddedGlbByteLength)
+{
     // create feature table
     size_t numOfBatchID = 0;
     if (instancesAttribs) {
         numOfBatchID = instancesAttribs->getInstancesCount();
     }
-    std::string featureTableString = "{\"BATCH_LENGTH\":" + std::to_string(numOfBatchID) + "}";
-    size_t headerToRoundUp = sizeof(B3dmHeader) + featureTableString.size();
-    featureTableString += std::string(roundUp(headerToRoundUp, 8) - headerToRoundUp, ' ');
+
+    B3DM b3dm;
+    b3dm.featureTableJson = "{\"BATCH_LENGTH\":" + std::to_string(numOfBatchID) + "}";
+    size_t headerToRoundUp = sizeof(B3dmHeader) + b3dm.featureTableJson.size();
+    b3dm.featureTableJson.append(roundUp(headerToRoundUp, 8) - headerToRoundUp, ' ');
 
     // create batch table
-    std::string batchTableHeader;
-    std::vector<uint8_t> batchTableBuffer;
-    createBatchTable(instancesAttribs, batchTableHeader, batchTableBuffer);
+    b3dm.batchTableBinByteLength = 0;
+    createBatchTable(instancesAttribs, b3dm.batchTableJson, b3dm.batchTableBinByteLength);
 
+    b3dm.glbByteLength = paddedGlbByteLength;
+    b3dm.paddedGlbByteLength = paddedGlbByteLength;
+    b3dm.bufferSegments = nullptr;
+    b3dm.instancesAttribs = instancesAttribs;
+    return b3dm;
+}
+
+void writeB3DMHeaderAndTables(const B3DM &b3dm, std::ostream &fs)
+{
     // create header
     B3dmHeader header;
     header.magic[0] = 'b';
@@ -268,135 +681,490 @@ void writeToB3DM(tinygltf::Model *gltf, const CDBInstancesAttributes *instancesA
     header.magic[2] = 'd';
     header.magic[3] = 'm';
     header.version = 1;
-    header.byteLength = static_cast<uint32_t>(sizeof(header))
-                        + static_cast<uint32_t>(featureTableString.size())
-                        + static_cast<uint32_t>(batchTableHeader.size())
-                        + static_cast<uint32_t>(batchTableBuffer.size())
-                        + static_cast<uint32_t>(glbBuffer.size());
-    header.featureTableJsonByteLength = static_cast<uint32_t>(featureTableString.size());
+    header.byteLength = static_cast<uint32_t>(b3dm.getByteLength());
+    header.featureTableJsonByteLength = static_cast<uint32_t>(b3dm.featureTableJson.size());
     header.featureTableBinByteLength = 0;
-    header.batchTableJsonByteLength = static_cast<uint32_t>(batchTableHeader.size());
-    header.batchTableBinByteLength = static_cast<uint32_t>(batchTableBuffer.size());
+    header.batchTableJsonByteLength = static_cast<uint32_t>(b3dm.batchTableJson.size());
+    header.batchTableBinByteLength = static_cast<uint32_t>(b3dm.batchTableBinByteLength);
 
     fs.write(reinterpret_cast<const char *>(&header), sizeof(B3dmHeader));
-    fs.write(featureTableString.data(), static_cast<std::streamsize>(featureTableString.size()));
+    fs.write(b3dm.featureTableJson.data(), static_cast<std::streamsize>(b3dm.featureTableJson.size()));
 
-    fs.write(batchTableHeader.data(), static_cast<std::streamsize>(batchTableHeader.size()));
-    fs.write(reinterpret_cast<const char *>(batchTableBuffer.data()), static_cast<std::streamsize>(batchTableBuffer.size()));
-
-    fs.write(reinterpret_cast<const char *>(glbBuffer.data()), static_cast<std::streamsize>(glbBuffer.size()));
+    fs.write(b3dm.batchTableJson.data(), static_cast<std::streamsize>(b3dm.batchTableJson.size()));
+    if (b3dm.instancesAttribs) {
+        writeBatchTableBinary(*b3dm.instancesAttribs, b3dm.batchTableBinByteLength, fs);
+    }
 }
 
-void writeToCMPT(uint32_t numOfTiles,
-                 std::ofstream &fs,
-                 std::function<uint32_t(std::ofstream &, size_t tileIdx)> writeToTileFormat)
+void writeToCMPT(const std::vector<size_t> &tileByteLengths,
+                 std::ostream &fs,
+                 std::function<void(std::ostream &fs, size_t tileIdx)> writeToTileFormat)
 {
+    // the inner tiles are measured by the caller, so the header is written once without seeking back
     CmptHeader header;
     header.magic[0] = 'c';
     header.magic[1] = 'm';
     header.magic[2] = 'p';
     header.magic[3] = 't';
     header.version = 1;
-    header.titleLength = numOfTiles;
+    header.titleLength = static_cast<uint32_t>(tileByteLengths.size());
     header.byteLength = sizeof(header);
-
-    fs.write(reinterpret_cast<char *>(&header), sizeof(header));
-    for (size_t i = 0; i < numOfTiles; ++i) {
-        header.byteLength += writeToTileFormat(fs, i);
+    for (auto tileByteLength : tileByteLengths) {
+        header.byteLength += static_cast<uint32_t>(tileByteLength);
     }
 
-    fs.seekp(0, std::ios::beg);
     fs.write(reinterpret_cast<char *>(&header), sizeof(header));
+    for (size_t i = 0; i < tileByteLengths.size(); ++i) {
+        writeToTileFormat(fs, i);
+    }
 }
 
 void createBatchTable(const CDBInstancesAttributes *instancesAttribs,
                       std::string &batchTableJsonStr,
-                      std::vector<uint8_t> &batchTableBuffer)
+                      size_t &batchTableBinByteLength)
 {
     if (instancesAttribs) {
-        nlohmann::json batchTableJson;
-        size_t instancesCount = instancesAttribs->getInstancesCount();
-        const auto &CNAMs = instancesAttribs->getCNAMs();
-        const auto &integerAttribs = instancesAttribs->getIntegerAttribs();
-        const auto &doubleAttribs = instancesAttribs->getDoubleAttribs();
-        const auto &stringAttribs = instancesAttribs->getStringAttribs();
-        size_t totalIntegerSize = roundUp(integerAttribs.size() * sizeof(int32_t) * instancesCount, 8);
-        size_t totalDoubleSize = doubleAttribs.size() * sizeof(double) * instancesCount;
-
-        batchTableBuffer.resize(totalIntegerSize + totalDoubleSize);
-
-        // Special keys of CDB attributes that map to class attribute
-        batchTableJson["CNAM"] = CNAMs;
-
-        // Per instance attributes
-        for (const auto &keyValue : stringAttribs) {
-            batchTableJson[keyValue.first] = keyValue.second;
+        batchTableJsonStr = createBatchTableJson(*instancesAttribs, nullptr, batchTableBinByteLength);
+        batchTableJsonStr.append(roundUp(batchTableJsonStr.size(), 8) - batchTableJsonStr.size(), ' ');
+    }
+}
+
+std::string createBatchTableJson(const CDBInstancesAttributes &instancesAttribs,
+                                 const std::vector<int> *attribIndices,
+                                 size_t &batchTableBinByteLength)
+{
+    // Special keys of CDB attributes that map to class attribute
+    std::map<std::string, std::string> columns;
+    columns["CNAM"] = createStringColumnJson(instancesAttribs.getCNAMs(), attribIndices);
+
+    // Per instance attributes
+    for (const auto &keyValue : instancesAttribs.getStringAttribs()) {
+        columns[keyValue.first] = createStringColumnJson(keyValue.second, attribIndices);
+    }
+
+    size_t batchTableOffset = 0;
+    for (const auto &keyValue : instancesAttribs.getIntegerAttribs()) {
+        columns[keyValue.first] = createBinaryColumnJson(batchTableOffset, "INT");
+        size_t columnLength = attribIndices ? attribIndices->size() : keyValue.second.size();
+        batchTableOffset += columnLength * sizeof(int32_t);
+    }
+
+    batchTableOffset = roundUp(batchTableOffset, 8);
+    for (const auto &keyValue : instancesAttribs.getDoubleAttribs()) {
+        columns[keyValue.first] = createBinaryColumnJson(batchTableOffset, "DOUBLE");
+        size_t columnLength = attribIndices ? attribIndices->size() : keyValue.second.size();
+        batchTableOffset += columnLength * sizeof(double);
+    }
+
+    batchTableBinByteLength = batchTableOffset;
+
+    std::string batchTableJson = "{";
+    for (const auto &column : columns) {
+        if (batchTableJson.size() > 1) {
+            batchTableJson += ',';
         }
 
-        size_t batchTableOffset = 0;
-        size_t batchTableSize = 0;
-        for (const auto &keyValue : integerAttribs) {
-            batchTableSize = keyValue.second.size() * sizeof(int32_t);
-            std::memcpy(batchTableBuffer.data() + batchTableOffset, keyValue.second.data(), batchTableSize);
-            batchTableJson[keyValue.first]["byteOffset"] = batchTableOffset;
-            batchTableJson[keyValue.first]["type"] = "SCALAR";
-            batchTableJson[keyValue.first]["componentType"] = "INT";
+        appendJsonString(batchTableJson, column.first);
+        batchTableJson += ':';
+        batchTableJson += column.second;
+    }
+
+    batchTableJson += '}';
+    return batchTableJson;
+}
 
-            batchTableOffset += batchTableSize;
+std::string createStringColumnJson(const CDBStringColumn &values, const std::vector<int> *attribIndices)
+{
+    // a column refers to few distinct strings, so each one is escaped once. Escaped strings are never empty
+    std::vector<std::string> escapedStrings(values.getStringPool()->getStringCount());
+    std::string columnJson = "[";
+    size_t valueCount = attribIndices ? attribIndices->size() : values.size();
+    for (size_t i = 0; i < valueCount; ++i) {
+        if (i > 0) {
+            columnJson += ',';
         }
 
-        batchTableOffset = roundUp(batchTableOffset, 8);
-        for (const auto &keyValue : doubleAttribs) {
-            batchTableSize = keyValue.second.size() * sizeof(double);
-            std::memcpy(batchTableBuffer.data() + batchTableOffset, keyValue.second.data(), batchTableSize);
-            batchTableJson[keyValue.first]["byteOffset"] = batchTableOffset;
-            batchTableJson[keyValue.first]["type"] = "SCALAR";
-            batchTableJson[keyValue.first]["componentType"] = "DOUBLE";
+        size_t valueIdx = attribIndices ? static_cast<size_t>((*attribIndices)[i]) : i;
+        auto &escapedString = escapedStrings[values.getHandle(valueIdx)];
+        if (escapedString.empty()) {
+            appendJsonString(escapedString, values[valueIdx]);
+        }
+
+        columnJson += escapedString;
+    }
+
+    columnJson += ']';
+    return columnJson;
+}
+
+std::string createBinaryColumnJson(size_t byteOffset, const std::string &componentType)
+{
+    return "{\"byteOffset\":" + std::to_string(byteOffset) + ",\"componentType\":\"" + componentType
+           + "\",\"type\":\"SCALAR\"}";
+}
 
-            batchTableOffset += batchTableSize;
+void appendJsonString(std::string &json, const std::string &value)
+{
+    json += '"';
+    for (char c : value) {
+        switch (c) {
+        case '"':
+            json += "\\\"";
+            break;
+        case '\\':
+            json += "\\\\";
+            break;
+        case '\b':
+            json += "\\b";
+            break;
+        case '\f':
+            json += "\\f";
+            break;
+        case '\n':
+            json += "\\n";
+            break;
+        case '\r':
+            json += "\\r";
+            break;
+        case '\t':
+            json += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                json += escaped;
+            } else {
+                json += c;
+            }
+            break;
         }
+    }
+
+    json += '"';
+}
+
+void writeBatchTableBinary(const CDBInstancesAttributes &instancesAttribs,
+                           size_t batchTableBinByteLength,
+                           std::ostream &fs)
+{
+    // the attribute columns are already contiguous, so they are written without staging them
+    size_t batchTableOffset = 0;
+    for (const auto &keyValue : instancesAttribs.getIntegerAttribs()) {
+        size_t columnSize = keyValue.second.size() * sizeof(int32_t);
+        fs.write(reinterpret_cast<const char *>(keyValue.second.data()),
+                 static_cast<std::streamsize>(columnSize));
+        batchTableOffset += columnSize;
+    }
+
+    writePadding(fs, roundUp(batchTableOffset, 8) - batchTableOffset, 0);
+    batchTableOffset = roundUp(batchTableOffset, 8);
+    for (const auto &keyValue : instancesAttribs.getDoubleAttribs()) {
+        size_t columnSize = keyValue.second.size() * sizeof(double);
+        fs.write(reinterpret_cast<const char *>(keyValue.second.data()),
+                 static_cast<std::streamsize>(columnSize));
+        batchTableOffset += columnSize;
+    }
 
-        batchTableJsonStr = batchTableJson.dump();
-        batchTableJsonStr += std::string(roundUp(batchTableJsonStr.size(), 8) - batchTableJsonStr.size(), ' ');
+    writePadding(fs, batchTableBinByteLength - batchTableOffset, 0);
+}
+
+void writePadding(std::ostream &fs, size_t byteLength, char value)
+{
+    for (size_t i = 0; i < byteLength; ++i) {
+        fs.put(value);
     }
 }
 
-void convertTilesetToJson(const CDBTile &tile, float geometricError, nlohmann::json &json)
+JsonStreamWriter::JsonStreamWriter(std::ostream &fs)
+    : m_fs{fs}
+    , m_afterKey{false}
 {
-    const auto &boundRegion = tile.getBoundRegion();
-    const auto &rectangle = boundRegion.getRectangle();
-    json["boundingVolume"] = {{"region",
-                               {
-                                   rectangle.getWest(),
-                                   rectangle.getSouth(),
-                                   rectangle.getEast(),
-                                   rectangle.getNorth(),
-                                   boundRegion.getMinimumHeight(),
-                                   boundRegion.getMaximumHeight(),
-                               }}};
+    m_buffer.reserve(JSON_STREAM_BUFFER_SIZE);
+}
+
+void JsonStreamWriter::beginObject()
+{
+    beginValue();
+    m_buffer += '{';
+    m_hasValues.emplace_back(false);
+}
+
+void JsonStreamWriter::endObject()
+{
+    m_buffer += '}';
+    m_hasValues.pop_back();
+}
+
+void JsonStreamWriter::beginArray()
+{
+    beginValue();
+    m_buffer += '[';
+    m_hasValues.emplace_back(false);
+}
+
+void JsonStreamWriter::endArray()
+{
+    m_buffer += ']';
+    m_hasValues.pop_back();
+}
+
+void JsonStreamWriter::key(const std::string &name)
+{
+    beginValue();
+    appendJsonString(m_buffer, name);
+    m_buffer += ':';
+    m_afterKey = true;
+}
+
+void JsonStreamWriter::value(const std::string &text)
+{
+    beginValue();
+    appendJsonString(m_buffer, text);
+}
+
+void JsonStreamWriter::value(double number)
+{
+    beginValue();
+    if (!std::isfinite(number)) {
+        m_buffer += "null";
+        return;
+    }
+
+    // the shortest representation that reads back the same number, as nlohmann::json dumps it
+    char digits[64];
+    char *end = nlohmann::detail::to_chars(digits, digits + sizeof(digits), number);
+    m_buffer.append(digits, end);
+}
+
+void JsonStreamWriter::value(unsigned number)
+{
+    beginValue();
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    m_buffer.append(digits, result.ptr);
+}
+
+void JsonStreamWriter::flush()
+{
+    m_fs.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+}
+
+void JsonStreamWriter::beginValue()
+{
+    if (m_afterKey) {
+        m_afterKey = false;
+    } else if (!m_hasValues.empty()) {
+        if (m_hasValues.back()) {
+            m_buffer += ',';
+        }
+
+        m_hasValues.back() = true;
+    }
+
+    if (m_buffer.size() >= JSON_STREAM_BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void writeTilesetDocumentToJson(const CDBTile &root,
+                                float geometricError,
+                                const char *refine,
+                                const ExternalTilesetSplit *split,
+                                std::ostream &fs)
+{
+    JsonStreamWriter writer(fs);
+    writer.beginObject();
+    writer.key("asset");
+    writer.beginObject();
+    writer.key("version");
+    writer.value("1.0");
+    writer.endObject();
+    writer.key("geometricError");
+    writer.value(root.getChildren().empty() ? 0.0f : geometricError);
+    writer.key("root");
+    writeTilesetToJson(root, geometricError, refine, split, 0, writer);
+    writer.endObject();
+    writer.flush();
+    fs << std::endl;
+}
+
+void writeTilesetToJson(const CDBTile &tile,
+                        float geometricError,
+                        const char *refine,
+                        const ExternalTilesetSplit *split,
+                        unsigned depth,
+                        JsonStreamWriter &writer)
+{
+    writer.beginObject();
+    writer.key("boundingVolume");
+    writeBoundRegionToJson(tile.getBoundRegion(), writer);
+
+    const std::vector<CDBTile *> &children = tile.getChildren();
+    bool hasChildren = false;
+    for (auto child : children) {
+        if (child == nullptr) {
+            continue;
+        }
+
+        if (!hasChildren) {
+            writer.key("children");
+            writer.beginArray();
+            hasChildren = true;
+        }
+
+        // a cut child is only referenced here, with the error of the root of its external tileset
+        float childGeometricError = geometricError / 2.0f;
+        if (split && (depth + 1) % split->levels == 0) {
+            std::string externalTilesetURI = writeToExternalTilesetJson(*child, childGeometricError, *split);
+            writer.beginObject();
+            writer.key("boundingVolume");
+            writeBoundRegionToJson(child->getBoundRegion(), writer);
+            writer.key("content");
+            writer.beginObject();
+            writer.key("uri");
+            writer.value(externalTilesetURI);
+            writer.endObject();
+            writer.key("geometricError");
+            writer.value(child->getChildren().empty() ? 0.0f : childGeometricError);
+            writer.endObject();
+        } else {
+            writeTilesetToJson(*child, childGeometricError, nullptr, split, depth + 1, writer);
+        }
+    }
+
+    if (hasChildren) {
+        writer.endArray();
+    }
 
     auto contentURI = tile.getCustomContentURI();
     if (contentURI) {
-        json["content"] = nlohmann::json::object();
-        json["content"]["uri"] = *contentURI;
+        writer.key("content");
+        writer.beginObject();
+        writer.key("uri");
+        writer.value(contentURI->u8string());
+        writer.endObject();
+    }
+
+    writer.key("geometricError");
+    writer.value(children.empty() ? 0.0f : geometricError);
+    if (refine) {
+        writer.key("refine");
+        writer.value(refine);
     }
 
-   const std::vector<CDBTile *> &children = tile.getChildren();
+    writer.endObject();
+}
 
-    if (children.empty()) {
-        json["geometricError"] = 0.0f;
-    } else {
-        json["geometricError"] = geometricError;
+std::string writeToExternalTilesetJson(const CDBTile &tile,
+                                       float geometricError,
+                                       const ExternalTilesetSplit &split)
+{
+    std::string externalTilesetURI = tile.getFilename() + ".json";
+    std::ofstream fs(*split.directory / externalTilesetURI);
+    writeTilesetDocumentToJson(tile, geometricError, split.refine, &split, fs);
+    return externalTilesetURI;
+}
 
-        for (auto child : children) {
-            if (child == nullptr) {
-                continue;
-            }
+void writeBoundRegionToJson(const Core::BoundingRegion &boundRegion, JsonStreamWriter &writer)
+{
+    const auto &rectangle = boundRegion.getRectangle();
+    writer.beginObject();
+    writer.key("region");
+    writer.beginArray();
+    writer.value(rectangle.getWest());
+    writer.value(rectangle.getSouth());
+    writer.value(rectangle.getEast());
+    writer.value(rectangle.getNorth());
+    writer.value(boundRegion.getMinimumHeight());
+    writer.value(boundRegion.getMaximumHeight());
+    writer.endArray();
+    writer.endObject();
+}
+
+void collectImplicitTiles(
+    const CDBTile &tile, unsigned level, uint32_t x, uint32_t y, std::vector<ImplicitTile> &implicitTiles)
+{
+    implicitTiles.push_back({level, x, y, &tile});
+
+    // the children of a quadtree tile are ordered by row from the south west one
+    const auto &children = tile.getChildren();
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (children[i]) {
+            uint32_t childX = 2 * x + static_cast<uint32_t>(i % 2);
+            uint32_t childY = 2 * y + static_cast<uint32_t>(i / 2);
+            collectImplicitTiles(*children[i], level + 1, childX, childY, implicitTiles);
+        }
+    }
+}
+
+void setAvailableBit(std::vector<uint8_t> &bitstream, uint64_t bit)
+{
+    bitstream[static_cast<size_t>(bit / 8)] |= static_cast<uint8_t>(1 << (bit % 8));
+}
 
-            nlohmann::json childJson = nlohmann::json::object();
-            convertTilesetToJson(*child, geometricError / 2.0f, childJson);
-            json["children"].emplace_back(childJson);
+void writeToSubtree(const ImplicitSubtree &subtree,
+                    size_t tileBitCount,
+                    size_t childSubtreeBitCount,
+                    std::ostream &fs)
+{
+    // availabilities that are all set or all unset are constants, the others are bitstreams in the binary
+    // chunk, each aligned to 8 bytes
+    std::string binary;
+    nlohmann::json bufferViews = nlohmann::json::array();
+    auto convertAvailabilityToJson = [&](const std::vector<uint8_t> &bitstream, size_t bitCount) {
+        size_t availableCount = 0;
+        for (size_t i = 0; i < bitCount; ++i) {
+            availableCount += static_cast<size_t>((bitstream[i / 8] >> (i % 8)) & 1);
         }
+
+        if (availableCount == 0 || availableCount == bitCount) {
+            return nlohmann::json{{"constant", availableCount == 0 ? 0 : 1}};
+        }
+
+        binary.resize((binary.size() + 7) / 8 * 8, '\0');
+        bufferViews.push_back(
+            {{"buffer", 0}, {"byteOffset", binary.size()}, {"byteLength", bitstream.size()}});
+        binary.append(bitstream.begin(), bitstream.end());
+        return nlohmann::json{{"bitstream", bufferViews.size() - 1}, {"availableCount", availableCount}};
+    };
+
+    nlohmann::json subtreeJson;
+    subtreeJson["tileAvailability"] = convertAvailabilityToJson(subtree.tileAvailability, tileBitCount);
+    subtreeJson["contentAvailability"] = nlohmann::json::array(
+        {convertAvailabilityToJson(subtree.contentAvailability, tileBitCount)});
+    subtreeJson["childSubtreeAvailability"] = convertAvailabilityToJson(subtree.childSubtreeAvailability,
+                                                                        childSubtreeBitCount);
+    binary.resize((binary.size() + 7) / 8 * 8, '\0');
+    if (!binary.empty()) {
+        subtreeJson["buffers"] = {{{"byteLength", binary.size()}}};
+        subtreeJson["bufferViews"] = bufferViews;
+    }
+
+    std::string json = subtreeJson.dump();
+    json.resize((json.size() + 7) / 8 * 8, ' ');
+
+    SubtreeHeader header;
+    header.magic[0] = 's';
+    header.magic[1] = 'u';
+    header.magic[2] = 'b';
+    header.magic[3] = 't';
+    header.version = 1;
+    header.jsonByteLength = json.size();
+    header.binaryByteLength = binary.size();
+    fs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    fs.write(json.data(), static_cast<std::streamsize>(json.size()));
+    fs.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+}
+
+std::array<float, GEOMETRIC_ERROR_LEVELS> createGeometricErrors()
+{
+    std::array<float, GEOMETRIC_ERROR_LEVELS> geometricErrors;
+    for (size_t i = 0; i < GEOMETRIC_ERROR_LEVELS; ++i) {
+        geometricErrors[i] = std::ldexp(MAX_GEOMETRIC_ERROR, -static_cast<int>(i));
     }
+
+    return geometricErrors;
 }
 } // namespace CDBTo3DTiles
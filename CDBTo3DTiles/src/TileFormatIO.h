@@ -2,11 +2,14 @@
 
 #include "CDBAttributes.h"
 #include "CDBTileset.h"
+#include "Gltf.h"
 #include "tiny_gltf.h"
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <ostream>
 #include <sstream>
+#include <vector>
 
 namespace CDBTo3DTiles {
 
@@ -41,21 +44,115 @@ struct CmptHeader
     uint32_t titleLength;
 };
 
+struct SubtreeHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t jsonByteLength;
+    uint64_t binaryByteLength;
+};
+
+// file with a large stream buffer, so a tile reaches the storage in a few large writes
+class TileOutputFile
+{
+public:
+    explicit TileOutputFile(const std::filesystem::path &path);
+
+    TileOutputFile(const TileOutputFile &) = delete;
+
+    TileOutputFile &operator=(const TileOutputFile &) = delete;
+
+    inline std::ofstream &getStream() noexcept { return m_stream; }
+
+private:
+    static constexpr size_t TILE_OUTPUT_BUFFER_SIZE = 1 << 20;
+
+    std::vector<char> m_buffer;
+    std::ofstream m_stream;
+};
+
+// the tables of an I3DM are serialized before anything is written, so its byte length is known up front.
+// The binary parts are generated from the attributes while the tile is written
+struct I3DM
+{
+    size_t getByteLength() const noexcept;
+
+    std::string GltfURI;
+    std::string featureTableJson;
+    std::string batchTableJson;
+    size_t featureTableBinByteLength;
+    size_t batchTableBinByteLength;
+    const CDBModelsAttributes *modelsAttribs;
+    const std::vector<int> *attribIndices;
+};
+
+// the glb JSON and the tables of a B3DM are serialized before anything is written, so it can be measured
+// before it goes into a CMPT
+struct B3DM
+{
+    size_t getByteLength() const noexcept;
+
+    std::string featureTableJson;
+    std::string batchTableJson;
+    size_t batchTableBinByteLength;
+    std::string glbJson;
+    size_t glbByteLength;
+    size_t paddedGlbByteLength;
+    const std::vector<GltfBufferSegment> *bufferSegments;
+    const CDBInstancesAttributes *instancesAttribs;
+};
+
 void combineTilesetJson(const std::vector<std::filesystem::path> &tilesetJsonPaths,
                         const std::vector<Core::BoundingRegion> &regions,
-                        std::ofstream &fs);
+                        std::ostream &fs);
+
+void writeToTilesetJson(const CDBTileset &tileset, bool replace, std::ostream &fs);
 
-void writeToTilesetJson(const CDBTileset &tileset, bool replace, std::ofstream &fs);
+// cuts the tileset every externalTilesetLevels levels below its root into external tilesets, written in
+// tilesetDirectory and named after the tile at their root. 0 writes a single tileset
+void writeToTilesetJson(const CDBTileset &tileset,
+                        bool replace,
+                        unsigned externalTilesetLevels,
+                        const std::filesystem::path &tilesetDirectory,
+                        std::ostream &fs);
+
+// writes the quadtree below level 0 as a 3D Tiles 1.1 implicit tileset, with its subtree files in the
+// subtrees directory and the content of its tiles renamed to {level}_{x}_{y}. The negative levels stay
+// explicit above it. Tilesets whose content mix tile formats are written explicitly
+void writeToImplicitTilesetJson(const CDBTileset &tileset,
+                                bool replace,
+                                const std::filesystem::path &tilesetDirectory,
+                                std::ostream &fs);
+
+// the geometric error written for the tiles of the level that have children
+float computeGeometricError(const CDBTileset &tileset, int level);
+
+I3DM createI3DM(std::string GltfURI,
+                const CDBModelsAttributes &modelsAttribs,
+                const std::vector<int> &attribIndices);
+
+size_t writeToI3DM(const I3DM &i3dm, std::ostream &fs);
 
 size_t writeToI3DM(std::string GltfURI,
                    const CDBModelsAttributes &modelsAttribs,
                    const std::vector<int> &attribIndices,
-                   std::ofstream &fs);
+                   std::ostream &fs);
+
+B3DM createB3DM(tinygltf::Model *gltf,
+                const std::vector<GltfBufferSegment> &bufferSegments,
+                const CDBInstancesAttributes *instancesAttribs);
+
+size_t writeToB3DM(const B3DM &b3dm, std::ostream &fs);
+
+void writeToB3DM(tinygltf::Model *gltf, const CDBInstancesAttributes *instancesAttribs, std::ostream &fs);
 
-void writeToB3DM(tinygltf::Model *gltf, const CDBInstancesAttributes *instancesAttribs, std::ofstream &fs);
+void writeToB3DM(tinygltf::Model *gltf,
+                 const std::vector<GltfBufferSegment> &bufferSegments,
+                 const CDBInstancesAttributes *instancesAttribs,
+                 std::ostream &fs);
 
-void writeToCMPT(uint32_t numOfTiles,
-                 std::ofstream &fs,
-                 std::function<uint32_t(std::ofstream &fs, size_t tileIdx)> writeToTileFormat);
+void writeToCMPT(const std::vector<size_t> &tileByteLengths,
+                 std::ostream &fs,
+                 std::function<void(std::ostream &fs, size_t tileIdx)> writeToTileFormat);
 
 } // namespace CDBTo3DTiles
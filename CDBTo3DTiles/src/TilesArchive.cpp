@@ -0,0 +1,319 @@
+#include "TilesArchive.h"
+#include "zlib.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace CDBTo3DTiles {
+static constexpr uint32_t LOCAL_FILE_HEADER_SIGNATURE = 0x04034b50;
+static constexpr uint32_t CENTRAL_DIRECTORY_HEADER_SIGNATURE = 0x02014b50;
+static constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50;
+static constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE = 0x07064b50;
+static constexpr uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+static constexpr uint16_t ZIP64_EXTRA_FIELD_ID = 0x0001;
+static constexpr uint16_t ZIP_VERSION = 20;
+static constexpr uint16_t ZIP64_VERSION = 45;
+static constexpr uint16_t STORED_METHOD = 0;
+static constexpr uint16_t UTF8_NAME_FLAG = 1 << 11;
+
+// 1980-01-01 00:00, so that converting the same CDB twice writes the same archive
+static constexpr uint16_t DOS_TIME = 0;
+static constexpr uint16_t DOS_DATE = (1 << 5) | 1;
+
+static void appendUint16(std::vector<unsigned char> &bytes, uint16_t value);
+
+static void appendUint32(std::vector<unsigned char> &bytes, uint32_t value);
+
+static void appendUint64(std::vector<unsigned char> &bytes, uint64_t value);
+
+static uint64_t readUint64(const unsigned char *data);
+
+std::array<unsigned char, 16> computeMD5(const std::string &text)
+{
+    static const uint32_t SHIFTS[64] = {7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                                        5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+                                        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                                        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+    static const uint32_t SINES[64]
+        = {0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+           0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+           0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+           0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+           0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+           0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+           0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+           0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+    // the message is padded with a 1 bit, then zeros up to 8 bytes before a block end, then its bit length
+    std::vector<unsigned char> message(text.begin(), text.end());
+    message.emplace_back(0x80);
+    while (message.size() % 64 != 56) {
+        message.emplace_back(0);
+    }
+
+    appendUint64(message, static_cast<uint64_t>(text.size()) * 8);
+
+    uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    for (size_t block = 0; block < message.size(); block += 64) {
+        uint32_t words[16];
+        for (size_t i = 0; i < 16; ++i) {
+            const unsigned char *word = message.data() + block + 4 * i;
+            words[i] = static_cast<uint32_t>(word[0]) | static_cast<uint32_t>(word[1]) << 8
+                       | static_cast<uint32_t>(word[2]) << 16 | static_cast<uint32_t>(word[3]) << 24;
+        }
+
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        for (uint32_t i = 0; i < 64; ++i) {
+            uint32_t f;
+            uint32_t g;
+            if (i < 16) {
+                f = (b & c) | (~b & d);
+                g = i;
+            } else if (i < 32) {
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+            } else if (i < 48) {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+            } else {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+
+            uint32_t rotated = a + f + SINES[i] + words[g];
+            a = d;
+            d = c;
+            c = b;
+            b += (rotated << SHIFTS[i]) | (rotated >> (32 - SHIFTS[i]));
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+    std::array<unsigned char, 16> hash;
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            hash[4 * i + j] = static_cast<unsigned char>(state[i] >> (8 * j));
+        }
+    }
+
+    return hash;
+}
+
+TilesArchiveWriter::TilesArchiveWriter(const std::filesystem::path &archivePath)
+    : m_archivePath{archivePath}
+    , m_stream{archivePath, std::ios::binary | std::ios::trunc}
+    , m_byteLength{0}
+    , m_isClosed{false}
+{
+    if (!m_stream) {
+        throw std::runtime_error("Cannot create archive " + archivePath.string());
+    }
+}
+
+void TilesArchiveWriter::addEntry(const std::string &name, const std::vector<unsigned char> &data)
+{
+    if (m_isClosed) {
+        throw std::logic_error("Archive " + m_archivePath.string() + " is already closed");
+    }
+
+    // an entry holds a single tile or texture, so only the offsets of the archive need ZIP64
+    if (data.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Cannot archive " + name + " larger than 4 GB");
+    }
+
+    Entry entry;
+    entry.name = name;
+    entry.crc = static_cast<uint32_t>(crc32(0L, Z_NULL, 0));
+    entry.byteLength = data.size();
+    entry.localHeaderOffset = m_byteLength;
+
+    // crc32 takes the length as an unsigned int, which may be smaller than the entry
+    const unsigned char *bytes = data.data();
+    for (size_t remaining = data.size(); remaining > 0;) {
+        auto chunk = static_cast<uInt>(std::min<size_t>(remaining, std::numeric_limits<uInt>::max()));
+        entry.crc = static_cast<uint32_t>(crc32(entry.crc, bytes, chunk));
+        bytes += chunk;
+        remaining -= chunk;
+    }
+
+    std::vector<unsigned char> header;
+    header.reserve(30 + name.size());
+    appendUint32(header, LOCAL_FILE_HEADER_SIGNATURE);
+    appendUint16(header, ZIP_VERSION);
+    appendUint16(header, UTF8_NAME_FLAG);
+    appendUint16(header, STORED_METHOD);
+    appendUint16(header, DOS_TIME);
+    appendUint16(header, DOS_DATE);
+    appendUint32(header, entry.crc);
+    appendUint32(header, static_cast<uint32_t>(entry.byteLength));
+    appendUint32(header, static_cast<uint32_t>(entry.byteLength));
+    appendUint16(header, static_cast<uint16_t>(name.size()));
+    appendUint16(header, 0);
+    header.insert(header.end(), name.begin(), name.end());
+    writeBytes(header);
+    writeBytes(data);
+
+    m_entries.emplace_back(std::move(entry));
+}
+
+void TilesArchiveWriter::close()
+{
+    if (m_isClosed) {
+        return;
+    }
+
+    // the index is sorted by hash, compared as two little endian 64 bits integers with the first one ahead
+    std::vector<std::pair<std::array<unsigned char, 16>, uint64_t>> hashes;
+    hashes.reserve(m_entries.size());
+    for (const auto &entry : m_entries) {
+        hashes.emplace_back(computeMD5(entry.name), entry.localHeaderOffset);
+    }
+
+    std::sort(hashes.begin(), hashes.end(), [](const auto &lhs, const auto &rhs) {
+        uint64_t lhsLow = readUint64(lhs.first.data());
+        uint64_t rhsLow = readUint64(rhs.first.data());
+        if (lhsLow != rhsLow) {
+            return lhsLow < rhsLow;
+        }
+
+        return readUint64(lhs.first.data() + 8) < readUint64(rhs.first.data() + 8);
+    });
+
+    std::vector<unsigned char> index;
+    index.reserve(24 * hashes.size());
+    for (const auto &hash : hashes) {
+        index.insert(index.end(), hash.first.begin(), hash.first.end());
+        appendUint64(index, hash.second);
+    }
+
+    addEntry(TILES_ARCHIVE_INDEX_NAME, index);
+
+    uint64_t centralDirectoryOffset = m_byteLength;
+    std::vector<unsigned char> centralDirectory;
+    for (const auto &entry : m_entries) {
+        bool isZip64 = entry.localHeaderOffset >= std::numeric_limits<uint32_t>::max();
+        appendUint32(centralDirectory, CENTRAL_DIRECTORY_HEADER_SIGNATURE);
+        appendUint16(centralDirectory, isZip64 ? ZIP64_VERSION : ZIP_VERSION);
+        appendUint16(centralDirectory, isZip64 ? ZIP64_VERSION : ZIP_VERSION);
+        appendUint16(centralDirectory, UTF8_NAME_FLAG);
+        appendUint16(centralDirectory, STORED_METHOD);
+        appendUint16(centralDirectory, DOS_TIME);
+        appendUint16(centralDirectory, DOS_DATE);
+        appendUint32(centralDirectory, entry.crc);
+        appendUint32(centralDirectory, static_cast<uint32_t>(entry.byteLength));
+        appendUint32(centralDirectory, static_cast<uint32_t>(entry.byteLength));
+        appendUint16(centralDirectory, static_cast<uint16_t>(entry.name.size()));
+        appendUint16(centralDirectory, isZip64 ? 12 : 0);
+        appendUint16(centralDirectory, 0);
+        appendUint16(centralDirectory, 0);
+        appendUint16(centralDirectory, 0);
+        appendUint32(centralDirectory, 0);
+        appendUint32(centralDirectory,
+                     isZip64 ? std::numeric_limits<uint32_t>::max()
+                             : static_cast<uint32_t>(entry.localHeaderOffset));
+        centralDirectory.insert(centralDirectory.end(), entry.name.begin(), entry.name.end());
+        if (isZip64) {
+            appendUint16(centralDirectory, ZIP64_EXTRA_FIELD_ID);
+            appendUint16(centralDirectory, 8);
+            appendUint64(centralDirectory, entry.localHeaderOffset);
+        }
+    }
+
+    writeBytes(centralDirectory);
+
+    // the end record keeps its 16 and 32 bits fields, which point to the ZIP64 records when they overflow
+    uint64_t entryCount = m_entries.size();
+    uint64_t centralDirectoryByteLength = centralDirectory.size();
+    bool isZip64 = entryCount >= std::numeric_limits<uint16_t>::max()
+                   || centralDirectoryOffset >= std::numeric_limits<uint32_t>::max()
+                   || centralDirectoryByteLength >= std::numeric_limits<uint32_t>::max();
+    std::vector<unsigned char> end;
+    if (isZip64) {
+        uint64_t zip64EndOffset = m_byteLength;
+        appendUint32(end, ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+        appendUint64(end, 44);
+        appendUint16(end, ZIP64_VERSION);
+        appendUint16(end, ZIP64_VERSION);
+        appendUint32(end, 0);
+        appendUint32(end, 0);
+        appendUint64(end, entryCount);
+        appendUint64(end, entryCount);
+        appendUint64(end, centralDirectoryByteLength);
+        appendUint64(end, centralDirectoryOffset);
+
+        appendUint32(end, ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE);
+        appendUint32(end, 0);
+        appendUint64(end, zip64EndOffset);
+        appendUint32(end, 1);
+    }
+
+    appendUint32(end, END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+    appendUint16(end, 0);
+    appendUint16(end, 0);
+    auto endEntryCount = static_cast<uint16_t>(
+        std::min<uint64_t>(entryCount, std::numeric_limits<uint16_t>::max()));
+    appendUint16(end, endEntryCount);
+    appendUint16(end, endEntryCount);
+    appendUint32(end,
+                 static_cast<uint32_t>(
+                     std::min<uint64_t>(centralDirectoryByteLength, std::numeric_limits<uint32_t>::max())));
+    appendUint32(end,
+                 static_cast<uint32_t>(
+                     std::min<uint64_t>(centralDirectoryOffset, std::numeric_limits<uint32_t>::max())));
+    appendUint16(end, 0);
+    writeBytes(end);
+
+    m_isClosed = true;
+    m_stream.close();
+    if (!m_stream) {
+        throw std::runtime_error("Cannot write archive " + m_archivePath.string());
+    }
+}
+
+void TilesArchiveWriter::writeBytes(const std::vector<unsigned char> &bytes)
+{
+    m_stream.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!m_stream) {
+        throw std::runtime_error("Cannot write archive " + m_archivePath.string());
+    }
+
+    m_byteLength += bytes.size();
+}
+
+void appendUint16(std::vector<unsigned char> &bytes, uint16_t value)
+{
+    bytes.emplace_back(static_cast<unsigned char>(value));
+    bytes.emplace_back(static_cast<unsigned char>(value >> 8));
+}
+
+void appendUint32(std::vector<unsigned char> &bytes, uint32_t value)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        bytes.emplace_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+void appendUint64(std::vector<unsigned char> &bytes, uint64_t value)
+{
+    for (size_t i = 0; i < 8; ++i) {
+        bytes.emplace_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+uint64_t readUint64(const unsigned char *data)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+
+    return value;
+}
+} // namespace CDBTo3DTiles
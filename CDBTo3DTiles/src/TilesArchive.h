@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace CDBTo3DTiles {
+// the entry holding the index of a 3D Tiles archive, written after every other entry
+constexpr const char *TILES_ARCHIVE_INDEX_NAME = "@3dtilesIndex1@";
+
+std::array<unsigned char, 16> computeMD5(const std::string &text);
+
+// appends files to a 3D Tiles archive (3TZ): a zip of stored entries, whose last entry indexes the local
+// header of every other one by the MD5 hash of its name. A server finds an entry from the index with a few
+// range reads instead of listing the central directory. ZIP64 records are written when the archive grows
+// past 4 GB or 65535 entries
+class TilesArchiveWriter
+{
+public:
+    // truncates the archive if it exists. Throws if it cannot be created
+    explicit TilesArchiveWriter(const std::filesystem::path &archivePath);
+
+    TilesArchiveWriter(const TilesArchiveWriter &) = delete;
+
+    TilesArchiveWriter &operator=(const TilesArchiveWriter &) = delete;
+
+    // the name is relative to the root of the archive, with / separators
+    void addEntry(const std::string &name, const std::vector<unsigned char> &data);
+
+    // writes the index and the central directory. No entry can be added afterwards
+    void close();
+
+private:
+    struct Entry
+    {
+        std::string name;
+        uint32_t crc;
+        uint64_t byteLength;
+        uint64_t localHeaderOffset;
+    };
+
+    void writeBytes(const std::vector<unsigned char> &bytes);
+
+    std::filesystem::path m_archivePath;
+    std::ofstream m_stream;
+    uint64_t m_byteLength;
+    std::vector<Entry> m_entries;
+    bool m_isClosed;
+};
+} // namespace CDBTo3DTiles
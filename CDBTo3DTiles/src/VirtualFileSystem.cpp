@@ -0,0 +1,112 @@
+#include "VirtualFileSystem.h"
+#include "cpl_vsi.h"
+
+namespace CDBTo3DTiles {
+bool isVirtualFileSystemPath(const std::filesystem::path &path)
+{
+    auto pathString = path.generic_string();
+    return pathString.compare(0, 4, "/vsi") == 0;
+}
+
+std::optional<FileStatus> getFileStatus(const std::filesystem::path &path)
+{
+    if (isVirtualFileSystemPath(path)) {
+        VSIStatBufL stat;
+        if (VSIStatL(path.generic_string().c_str(), &stat) != 0) {
+            return std::nullopt;
+        }
+
+        return FileStatus{VSI_ISDIR(stat.st_mode) != 0,
+                          static_cast<uint64_t>(stat.st_size),
+                          static_cast<int64_t>(stat.st_mtime)};
+    }
+
+    std::error_code error;
+    auto status = std::filesystem::status(path, error);
+    if (error || !std::filesystem::exists(status)) {
+        return std::nullopt;
+    }
+
+    FileStatus fileStatus{std::filesystem::is_directory(status), 0, 0};
+    if (std::filesystem::is_regular_file(status)) {
+        fileStatus.size = static_cast<uint64_t>(std::filesystem::file_size(path, error));
+        if (error) {
+            fileStatus.size = 0;
+        }
+    }
+
+    auto lastWriteTime = std::filesystem::last_write_time(path, error);
+    if (!error) {
+        fileStatus.lastWriteTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+    }
+
+    return fileStatus;
+}
+
+std::vector<DirectoryEntry> listDirectory(const std::filesystem::path &path)
+{
+    std::vector<DirectoryEntry> entries;
+    if (isVirtualFileSystemPath(path)) {
+        VSIDIR *directory = VSIOpenDir(path.generic_string().c_str(), 0, nullptr);
+        if (!directory) {
+            return entries;
+        }
+
+        while (const VSIDIREntry *entry = VSIGetNextDirEntry(directory)) {
+            FileStatus status{entry->bModeKnown && VSI_ISDIR(entry->nMode),
+                              entry->bSizeKnown ? static_cast<uint64_t>(entry->nSize) : 0,
+                              entry->bMTimeKnown ? static_cast<int64_t>(entry->nMTime) : 0};
+            entries.push_back({entry->pszName, status});
+        }
+
+        VSICloseDir(directory);
+        return entries;
+    }
+
+    std::error_code error;
+    std::filesystem::directory_iterator directory(path, error);
+    if (error) {
+        return entries;
+    }
+
+    for (const std::filesystem::directory_entry &entry : directory) {
+        FileStatus status{entry.is_directory(error), 0, 0};
+        if (entry.is_regular_file(error)) {
+            status.size = static_cast<uint64_t>(entry.file_size(error));
+            if (error) {
+                status.size = 0;
+            }
+        }
+
+        auto lastWriteTime = entry.last_write_time(error);
+        if (!error) {
+            status.lastWriteTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+        }
+
+        entries.push_back({entry.path().filename().string(), status});
+    }
+
+    return entries;
+}
+
+std::optional<std::vector<char>> readFile(const std::filesystem::path &path)
+{
+    VSILFILE *file = VSIFOpenL(path.generic_string().c_str(), "rb");
+    if (!file) {
+        return std::nullopt;
+    }
+
+    // the size is known from the listing of object storage, so seeking to the end sends no request
+    std::optional<std::vector<char>> data;
+    if (VSIFSeekL(file, 0, SEEK_END) == 0) {
+        auto size = static_cast<size_t>(VSIFTellL(file));
+        data.emplace(size);
+        if (VSIFSeekL(file, 0, SEEK_SET) != 0 || VSIFReadL(data->data(), 1, size, file) != size) {
+            data = std::nullopt;
+        }
+    }
+
+    VSIFCloseL(file);
+    return data;
+}
+} // namespace CDBTo3DTiles
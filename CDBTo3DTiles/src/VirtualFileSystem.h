@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace CDBTo3DTiles {
+// whether the path is in a GDAL virtual file system, like /vsis3/bucket/prefix, /vsicurl/ or /vsizip/
+bool isVirtualFileSystemPath(const std::filesystem::path &path);
+
+struct FileStatus
+{
+    bool isDirectory;
+    uint64_t size;
+
+    // the time points of local files are counted by std::filesystem, the ones of virtual files in seconds
+    int64_t lastWriteTime;
+};
+
+struct DirectoryEntry
+{
+    std::string name;
+    FileStatus status;
+};
+
+// local paths are read through std::filesystem and virtual ones through GDAL. Missing paths have no status
+std::optional<FileStatus> getFileStatus(const std::filesystem::path &path);
+
+// object storage returns the status of the entries with the listing, so listing a prefix costs no request per
+// entry. A missing directory has no entry
+std::vector<DirectoryEntry> listDirectory(const std::filesystem::path &path);
+
+// reads a file in one piece, e.g. an archive that is read entry by entry afterwards
+std::optional<std::vector<char>> readFile(const std::filesystem::path &path);
+} // namespace CDBTo3DTiles
@@ -2,19 +2,104 @@
 #include "CDBTo3DTiles.h"
 #include "Utility.h"
 #include "cxxopts.hpp"
+#include <cstdio>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+
+static std::string formatDuration(double seconds)
+{
+    auto totalSeconds = static_cast<long long>(seconds);
+    char duration[32];
+    std::snprintf(duration,
+                  sizeof(duration),
+                  "%02lld:%02lld:%02lld",
+                  totalSeconds / 3600,
+                  (totalSeconds / 60) % 60,
+                  totalSeconds % 60);
+    return duration;
+}
+
+static void printProgress(const CDBTo3DTiles::ConversionProgress &progress)
+{
+    double percent = progress.tilesTotal > 0 ? 100.0 * static_cast<double>(progress.tilesDone)
+                                                   / static_cast<double>(progress.tilesTotal)
+                                             : 100.0;
+    double megabytesWritten = static_cast<double>(progress.bytesWritten) / (1024.0 * 1024.0);
+    char line[256];
+    std::snprintf(line,
+                  sizeof(line),
+                  "%llu/%llu GeoCells, %llu/%llu tiles (%.1f%%), %.1f MB written",
+                  static_cast<unsigned long long>(progress.geoCellsDone),
+                  static_cast<unsigned long long>(progress.geoCellsTotal),
+                  static_cast<unsigned long long>(progress.tilesDone),
+                  static_cast<unsigned long long>(progress.tilesTotal),
+                  percent,
+                  megabytesWritten);
+
+    // the progress goes to stderr, so it is kept apart from the stats printed to stdout
+    std::cerr << "Progress: " << line << ", " << formatDuration(progress.elapsedSeconds) << " elapsed, ";
+    if (progress.remainingSeconds) {
+        std::cerr << formatDuration(*progress.remainingSeconds) << " left";
+    } else {
+        std::cerr << "time left unknown";
+    }
+
+    std::cerr << ", last tile " << formatDuration(progress.secondsSinceLastTile) << " ago\n";
+}
+
+static int mergeShards(int argc, char **argv)
+{
+    cxxopts::Options options("CDBConverter merge",
+                             "Combine the tilesets of the shards converted with --shard-count or --shard-geocells");
+
+    // clang-format off
+    options.add_options()
+        ("o, output",
+            "3D Tiles output directory shared by the shards",
+            cxxopts::value<std::string>())
+        ("combine",
+            "Combine converted datasets into one tileset, as when converting",
+            cxxopts::value<std::vector<std::string>>()->default_value("Elevation_1_1,GSModels_1_1,GTModels_2_1,GTModels_1_1"))
+        ("h, help", "Print usage");
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("output")) {
+        std::cout << options.help();
+        return 0;
+    }
+
+    try {
+        CDBTo3DTiles::Converter converter("", result["output"].as<std::string>());
+        for (const auto &combined : result["combine"].as<std::vector<std::string>>()) {
+            converter.combineDataset(CDBTo3DTiles::splitString(combined, ","));
+        }
+
+        converter.merge();
+    } catch (const std::exception &e) {
+        std::cout << "An error has occured: " << e.what() << "\n";
+    }
+
+    return 0;
+}
 
 int main(int argc, char **argv)
 {
+    // the merge subcommand takes the arguments that follow it
+    if (argc > 1 && std::string(argv[1]) == "merge") {
+        return mergeShards(argc - 1, argv + 1);
+    }
+
     cxxopts::Options options("CDBConverter", "Convert CDB to 3D Tiles");
 
     // clang-format off
     options.add_options()
         ("i, input",
-            "CDB directory",
+            "CDB directory, or a GDAL virtual path like /vsis3/bucket/CDB or /vsizip/CDB.zip/CDB",
             cxxopts::value<std::string>())
         ("o, output",
-            "3D Tiles output directory",
+            "3D Tiles output directory, or an object storage prefix like /vsis3/bucket/prefix that the files are uploaded to as they are converted",
             cxxopts::value<std::string>())
         ("combine",
             "Combine converted datasets into one tileset. Each dataset format is {DatasetName}_{ComponentSelector1}_{ComponentSelector2}. "
@@ -33,6 +118,126 @@ int main(int argc, char **argv)
         ("elevation-threshold-indices",
             "Set target percent of indices when decimating elevation mesh",
             cxxopts::value<float>()->default_value("0.3"))
+        ("vector-lod",
+            "Generate the road, railroad, powerline and hydrography levels missing in CDB by simplifying the lines and polygons of their children to the geometric error of the level",
+            cxxopts::value<bool>()->default_value("false"))
+        ("implicit-tiling",
+            "Write the tilesets as 3D Tiles 1.1 implicit quadtrees with subtree availability files",
+            cxxopts::value<bool>()->default_value("false"))
+        ("external-tileset-levels",
+            "Cut the tilesets every given number of levels into external tilesets, so clients only load the parts they traverse. 0 writes one tileset per GeoCell and dataset. Ignored with --implicit-tiling",
+            cxxopts::value<unsigned>()->default_value("0"))
+        ("threads",
+            "Number of threads used to convert GeoCells and their datasets in parallel. 0 uses all hardware threads",
+            cxxopts::value<size_t>()->default_value("1"))
+        ("gtmodel-cache-memory",
+            "Memory budget in megabytes for the GTModels kept loaded between tiles. 0 keeps every GTModel",
+            cxxopts::value<size_t>()->default_value("2048"))
+        ("elevation-cache-memory",
+            "Memory budget in megabytes for the elevation grids of a GeoCell kept decoded for model clamping. 0 keeps every grid",
+            cxxopts::value<size_t>()->default_value("512"))
+        ("imagery-encoding-memory",
+            "Memory budget in megabytes for the imagery decoded by the textures encoded in the background. Past it, elevation tiles wait for the encoding. 0 has no limit",
+            cxxopts::value<size_t>()->default_value("256"))
+        ("gdal-cache-memory",
+            "Memory budget in megabytes for the raster blocks decoded by GDAL. 0 keeps the GDAL default, or a share of --max-memory",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("gdal-threads",
+            "Number of threads decoding each JP2 imagery, on top of --threads. 0 keeps the GDAL default",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("gdal-dataset-pool-size",
+            "Number of elevation and imagery rasters kept open once read, so that a tile read again skips parsing its header. 0 closes each raster once read",
+            cxxopts::value<size_t>()->default_value("64"))
+        ("read-ahead",
+            "Number of vector and model tiles read ahead of the one being converted, so their files are read while the previous tiles are converted. 0 reads each tile once the previous one is converted",
+            cxxopts::value<size_t>()->default_value("2"))
+        ("max-memory",
+            "Memory budget in megabytes for the whole conversion. Past it, GeoCells start only once the ones in flight finish, and the GeoCells in flight drop their least recently used grids and models as the memory grows. The caches get a share of it. 0 has no limit",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("output-threads",
+            "Number of threads writing the output files in batches, through io_uring when available, while the conversion goes on. 0 writes each file on the thread converting it, or uploads with as many threads as --threads to object storage",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("output-queue-memory",
+            "Memory budget in megabytes for the output files queued for the output threads. Past it, the conversion waits for the writes. 0 has no limit",
+            cxxopts::value<size_t>()->default_value("256"))
+        ("output-format",
+            "Write every output file on its own, or the files of each GeoCell into a 3D Tiles archive next to its directory. Accept directory or 3tz. 3tz does not support --implicit-tiling or --external-tileset-levels and ignores --output-threads",
+            cxxopts::value<std::string>()->default_value("directory"))
+        ("gtmodel-bake-instances",
+            "Bake the GTModels with at most this many instances in a tile into the tile geometry instead of instancing them. 0 always instances the GTModels",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("gtmodel-bake-triangles",
+            "Most triangles that the baked copies of one GTModel may add to a tile. 0 has no limit",
+            cxxopts::value<size_t>()->default_value("65536"))
+        ("texture-atlas-size",
+            "Pack the textures of each GSModel tile into atlases of at most this many pixels per side and merge the meshes sharing a material. 0 keeps every texture in its own file",
+            cxxopts::value<unsigned>()->default_value("0"))
+        ("incremental",
+            "Keep the output of the previous conversion and only convert again the GeoCells whose CDB files changed",
+            cxxopts::value<bool>()->default_value("false"))
+        ("optimize-meshes",
+            "Reorder the triangles and vertices of the glTF meshes for the GPU vertex cache, overdraw and vertex fetch",
+            cxxopts::value<bool>()->default_value("false"))
+        ("deduplicate-content",
+            "Write the model glTFs and textures with the same bytes once to the Content directory of the output, named after their hash. Not supported by 3tz output",
+            cxxopts::value<bool>()->default_value("false"))
+        ("quantize-attributes",
+            "Store the glTF positions, normals, texture coordinates and indices in smaller integer types with KHR_mesh_quantization",
+            cxxopts::value<bool>()->default_value("false"))
+        ("meshopt-compression",
+            "Compress the glTF vertex attributes and triangle indices with EXT_meshopt_compression",
+            cxxopts::value<bool>()->default_value("false"))
+        ("draco",
+            "Compress the glTF triangle meshes with KHR_draco_mesh_compression",
+            cxxopts::value<bool>()->default_value("false"))
+        ("draco-position-bits",
+            "Quantization bits of the positions compressed with Draco",
+            cxxopts::value<int>()->default_value("14"))
+        ("draco-normal-bits",
+            "Quantization bits of the normals compressed with Draco",
+            cxxopts::value<int>()->default_value("10"))
+        ("draco-uv-bits",
+            "Quantization bits of the texture coordinates compressed with Draco",
+            cxxopts::value<int>()->default_value("12"))
+        ("texture-compression",
+            "Write the imagery and model textures as KTX2 with mipmaps using KHR_texture_basisu. Accept none, etc1s or uastc",
+            cxxopts::value<std::string>()->default_value("none"))
+        ("manifest",
+            "Manifest file caching the CDB directory listing. It is created on the first run and reused by later runs as long as the CDB directories are unchanged",
+            cxxopts::value<std::string>())
+        ("stats",
+            "Print the wall and CPU time of each conversion phase per GeoCell and dataset, with the tiles, bytes read and written and the peak memory. Accept none or json",
+            cxxopts::value<std::string>()->default_value("none"))
+        ("trace",
+            "Chrome trace file recording the tile jobs and conversion phases of every thread, opened by chrome://tracing or Perfetto",
+            cxxopts::value<std::string>())
+        ("progress",
+            "Print the GeoCells and tiles converted, the bytes written and the estimated time left every given number of seconds. 0 prints nothing",
+            cxxopts::value<double>()->default_value("0"))
+        ("bbox",
+            "Only convert the GeoCells and tiles intersecting this box in degrees, given as west,south,east,north",
+            cxxopts::value<std::string>())
+        ("geocells",
+            "Only convert these GeoCells, e.g. N32W118,N32W119",
+            cxxopts::value<std::string>())
+        ("datasets",
+            "Only convert these datasets, e.g. Elevation,GTModels. Accept Elevation, RoadNetwork, RailRoadNetwork, PowerlineNetwork, HydrographyNetwork, GTModels and GSModels",
+            cxxopts::value<std::string>())
+        ("min-lod",
+            "Only convert the tiles of this level and deeper ones, from -10",
+            cxxopts::value<int>()->default_value("-10"))
+        ("max-lod",
+            "Only convert the tiles of this level and coarser ones, up to 23. No deeper level is generated from the elevation and imagery",
+            cxxopts::value<int>()->default_value("23"))
+        ("shard-geocells",
+            "Only convert these GeoCells, e.g. N32W118,N32W119, and write a shard manifest instead of the combined tilesets. Run \"CDBConverter merge\" once every shard is converted",
+            cxxopts::value<std::string>())
+        ("shard-index",
+            "Index of the shard converted out of --shard-count, from 0",
+            cxxopts::value<size_t>()->default_value("0"))
+        ("shard-count",
+            "Spread the GeoCells over this many shards by hashing their names, and only convert the one of --shard-index. 0 converts every GeoCell",
+            cxxopts::value<size_t>()->default_value("0"))
         ("h, help", "Print usage");
     // clang-format on
 
@@ -51,7 +256,39 @@ int main(int argc, char **argv)
             bool elevationLOD = result["elevation-lod"].as<bool>();
             float elevationDecimateError = result["elevation-decimate-error"].as<float>();
             float elevationThresholdIndices = result["elevation-threshold-indices"].as<float>();
+            bool vectorLOD = result["vector-lod"].as<bool>();
+            bool implicitTiling = result["implicit-tiling"].as<bool>();
+            unsigned externalTilesetLevels = result["external-tileset-levels"].as<unsigned>();
+            size_t threadCount = result["threads"].as<size_t>();
+            size_t GTModelCacheMemory = result["gtmodel-cache-memory"].as<size_t>();
+            size_t elevationCacheMemory = result["elevation-cache-memory"].as<size_t>();
+            size_t imageryEncodingMemory = result["imagery-encoding-memory"].as<size_t>();
+            size_t GDALCacheMemory = result["gdal-cache-memory"].as<size_t>();
+            size_t GDALThreadCount = result["gdal-threads"].as<size_t>();
+            size_t GDALDatasetPoolSize = result["gdal-dataset-pool-size"].as<size_t>();
+            size_t readAheadDepth = result["read-ahead"].as<size_t>();
+            size_t maxMemory = result["max-memory"].as<size_t>();
+            size_t outputThreadCount = result["output-threads"].as<size_t>();
+            size_t outputQueueMemory = result["output-queue-memory"].as<size_t>();
+            std::string outputFormat = result["output-format"].as<std::string>();
+            size_t GTModelBakeInstances = result["gtmodel-bake-instances"].as<size_t>();
+            size_t GTModelBakeTriangles = result["gtmodel-bake-triangles"].as<size_t>();
+            unsigned textureAtlasSize = result["texture-atlas-size"].as<unsigned>();
+            bool incremental = result["incremental"].as<bool>();
+            bool optimizeMeshes = result["optimize-meshes"].as<bool>();
+            bool deduplicateContent = result["deduplicate-content"].as<bool>();
+            bool quantizeAttributes = result["quantize-attributes"].as<bool>();
+            bool meshoptCompression = result["meshopt-compression"].as<bool>();
+            bool dracoCompression = result["draco"].as<bool>();
+            int dracoPositionBits = result["draco-position-bits"].as<int>();
+            int dracoNormalBits = result["draco-normal-bits"].as<int>();
+            int dracoUVBits = result["draco-uv-bits"].as<int>();
+            std::string textureCompression = result["texture-compression"].as<std::string>();
             std::vector<std::string> combinedDatasets = result["combine"].as<std::vector<std::string>>();
+            std::string stats = result["stats"].as<std::string>();
+            if (stats != "none" && stats != "json") {
+                throw std::invalid_argument("Stats must be none or json");
+            }
 
             CDBTo3DTiles::GlobalInitializer initializer;
             CDBTo3DTiles::Converter converter(CDBPath, outputPath);
@@ -59,11 +296,80 @@ int main(int argc, char **argv)
             converter.setElevationLODOnly(elevationLOD);
             converter.setElevationDecimateError(elevationDecimateError);
             converter.setElevationThresholdIndices(elevationThresholdIndices);
+            converter.setVectorLOD(vectorLOD);
+            converter.setImplicitTiling(implicitTiling);
+            converter.setExternalTilesetLevels(externalTilesetLevels);
+            converter.setThreadCount(threadCount);
+            converter.setGTModelCacheMemory(GTModelCacheMemory * 1024 * 1024);
+            converter.setElevationGridCacheMemory(elevationCacheMemory * 1024 * 1024);
+            converter.setImageryEncodingMemory(imageryEncodingMemory * 1024 * 1024);
+            converter.setGDALCacheMemory(GDALCacheMemory * 1024 * 1024);
+            converter.setGDALThreadCount(GDALThreadCount);
+            converter.setGDALDatasetPoolSize(GDALDatasetPoolSize);
+            converter.setReadAheadDepth(readAheadDepth);
+            converter.setMaxMemory(maxMemory * 1024 * 1024);
+            converter.setOutputThreadCount(outputThreadCount);
+            converter.setOutputQueueMemory(outputQueueMemory * 1024 * 1024);
+            converter.setOutputFormat(outputFormat);
+            converter.setGTModelBaking(GTModelBakeInstances, GTModelBakeTriangles);
+            converter.setTextureAtlasSize(textureAtlasSize);
+            converter.setIncremental(incremental);
+            converter.setOptimizeMeshes(optimizeMeshes);
+            converter.setDeduplicateContent(deduplicateContent);
+            converter.setQuantizeVertexAttributes(quantizeAttributes);
+            converter.setMeshoptCompression(meshoptCompression);
+            converter.setDracoCompression(dracoCompression);
+            converter.setDracoQuantizationBits(dracoPositionBits, dracoNormalBits, dracoUVBits);
+            converter.setTextureCompression(textureCompression);
+            converter.setCollectStats(stats == "json");
+            if (result.count("trace")) {
+                converter.setTracePath(result["trace"].as<std::string>());
+            }
+
+            double progressInterval = result["progress"].as<double>();
+            if (progressInterval > 0.0) {
+                converter.setProgressCallback(printProgress, progressInterval);
+            }
+
+            if (result.count("manifest")) {
+                converter.setManifestPath(result["manifest"].as<std::string>());
+            }
+
+            if (result.count("bbox")) {
+                auto bbox = CDBTo3DTiles::splitString(result["bbox"].as<std::string>(), ",");
+                if (bbox.size() != 4) {
+                    throw std::invalid_argument("Bounding box must be given as west,south,east,north");
+                }
+
+                converter.setBoundingBox(
+                    std::stod(bbox[0]), std::stod(bbox[1]), std::stod(bbox[2]), std::stod(bbox[3]));
+            }
+
+            if (result.count("geocells")) {
+                converter.setGeoCells(CDBTo3DTiles::splitString(result["geocells"].as<std::string>(), ","));
+            }
+
+            if (result.count("datasets")) {
+                converter.setDatasets(CDBTo3DTiles::splitString(result["datasets"].as<std::string>(), ","));
+            }
+
+            converter.setLevelRange(result["min-lod"].as<int>(), result["max-lod"].as<int>());
+
+            if (result.count("shard-geocells")) {
+                converter.setShardGeoCells(
+                    CDBTo3DTiles::splitString(result["shard-geocells"].as<std::string>(), ","));
+            }
+
+            converter.setShard(result["shard-index"].as<size_t>(), result["shard-count"].as<size_t>());
+
             for (const auto &combined : combinedDatasets) {
                 converter.combineDataset(CDBTo3DTiles::splitString(combined, ","));
             }
 
             converter.convert();
+            if (stats == "json") {
+                converter.writeStats(std::cout);
+            }
         } else {
             std::cout << options.help();
             return 0;
@@ -3,6 +3,7 @@
 #include "Cartographic.h"
 #include "glm/glm.hpp"
 #include <optional>
+#include <vector>
 
 namespace Core {
 class Ellipsoid
@@ -22,6 +23,17 @@ public:
 
     glm::dvec3 cartographicToCartesian(const Cartographic &cartographic) const;
 
+    // the positions are appended to cartesians
+    void cartographicToCartesian(const std::vector<Cartographic> &cartographics,
+                                 std::vector<glm::dvec3> &cartesians) const;
+
+    // heights are row major, with one row per latitude and one column per longitude. The positions are
+    // appended to cartesians
+    void cartographicGridToCartesian(const std::vector<double> &longitudes,
+                                     const std::vector<double> &latitudes,
+                                     const std::vector<double> &heights,
+                                     std::vector<glm::dvec3> &cartesians) const;
+
     std::optional<Cartographic> cartesianToCartographic(const glm::dvec3 &cartesian) const;
 
     std::optional<glm::dvec3> scaleToGeodeticSurface(const glm::dvec3 &cartesian) const;
@@ -35,6 +47,8 @@ public:
     bool operator!=(const Ellipsoid &rhs) const { return this->m_radii != rhs.m_radii; };
 
 private:
+    glm::dvec3 surfaceNormalToCartesian(const glm::dvec3 &normal, double height) const;
+
     glm::dvec3 m_radii;
     glm::dvec3 m_radiiSquared;
     glm::dvec3 m_oneOverRadii;
@@ -13,7 +13,7 @@ public:
     EllipsoidTangentPlane(const glm::dmat4 &eastNorthUpToFixedFrame,
                           const Ellipsoid &ellipsoid = Ellipsoid::WGS84);
 
-    glm::dvec2 projectPointToNearestOnPlane(const glm::dvec3 &cartesian);
+    glm::dvec2 projectPointToNearestOnPlane(const glm::dvec3 &cartesian) const;
 
 private:
     Ellipsoid m_ellipsoid;
@@ -33,6 +33,9 @@ public:
 
     bool contains(const Cartographic &cartographic) const;
 
+    // rectangles that only share an edge don't intersect
+    bool intersects(const GlobeRectangle &other) const;
+
     GlobeRectangle computeUnion(const GlobeRectangle &other) const;
 
 private:
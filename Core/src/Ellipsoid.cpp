@@ -34,12 +34,45 @@ glm::dvec3 Ellipsoid::geodeticSurfaceNormal(const Cartographic &cartographic) co
 
 glm::dvec3 Ellipsoid::cartographicToCartesian(const Cartographic &cartographic) const
 {
-    glm::dvec3 n = geodeticSurfaceNormal(cartographic);
-    glm::dvec3 k = m_radiiSquared * n;
-    double gamma = sqrt(glm::dot(n, k));
-    k /= gamma;
-    n *= cartographic.height;
-    return k + n;
+    return surfaceNormalToCartesian(geodeticSurfaceNormal(cartographic), cartographic.height);
+}
+
+void Ellipsoid::cartographicToCartesian(const std::vector<Cartographic> &cartographics,
+                                        std::vector<glm::dvec3> &cartesians) const
+{
+    cartesians.reserve(cartesians.size() + cartographics.size());
+    for (const auto &cartographic : cartographics) {
+        glm::dvec3 normal = geodeticSurfaceNormal(cartographic);
+        cartesians.emplace_back(surfaceNormalToCartesian(normal, cartographic.height));
+    }
+}
+
+void Ellipsoid::cartographicGridToCartesian(const std::vector<double> &longitudes,
+                                            const std::vector<double> &latitudes,
+                                            const std::vector<double> &heights,
+                                            std::vector<glm::dvec3> &cartesians) const
+{
+    // every row shares the sine and cosine of its latitude and every column the ones of its longitude
+    size_t width = longitudes.size();
+    std::vector<double> cosLongitudes;
+    std::vector<double> sinLongitudes;
+    cosLongitudes.reserve(width);
+    sinLongitudes.reserve(width);
+    for (double longitude : longitudes) {
+        cosLongitudes.emplace_back(glm::cos(longitude));
+        sinLongitudes.emplace_back(glm::sin(longitude));
+    }
+
+    cartesians.reserve(cartesians.size() + width * latitudes.size());
+    for (size_t y = 0; y < latitudes.size(); ++y) {
+        double cosLatitude = glm::cos(latitudes[y]);
+        double sinLatitude = glm::sin(latitudes[y]);
+        for (size_t x = 0; x < width; ++x) {
+            glm::dvec3 normal = glm::normalize(
+                glm::dvec3(cosLatitude * cosLongitudes[x], cosLatitude * sinLongitudes[x], sinLatitude));
+            cartesians.emplace_back(surfaceNormalToCartesian(normal, heights[y * width + x]));
+        }
+    }
 }
 
 std::optional<Cartographic> Ellipsoid::cartesianToCartographic(const glm::dvec3 &cartesian) const
@@ -142,6 +175,14 @@ std::optional<glm::dvec3> Ellipsoid::scaleToGeodeticSurface(const glm::dvec3 &ca
     return glm::dvec3(positionX * xMultiplier, positionY * yMultiplier, positionZ * zMultiplier);
 }
 
+glm::dvec3 Ellipsoid::surfaceNormalToCartesian(const glm::dvec3 &normal, double height) const
+{
+    glm::dvec3 k = m_radiiSquared * normal;
+    double gamma = sqrt(glm::dot(normal, k));
+    k /= gamma;
+    return k + normal * height;
+}
+
 double Ellipsoid::getMaximumRadius() const
 {
     return glm::max(m_radii.x, glm::max(m_radii.y, m_radii.z));
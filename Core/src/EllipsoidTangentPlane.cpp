@@ -17,7 +17,7 @@ EllipsoidTangentPlane::EllipsoidTangentPlane(const glm::dmat4 &eastNorthUpToFixe
     , m_plane(eastNorthUpToFixedFrame[3], eastNorthUpToFixedFrame[2])
 {}
 
-glm::dvec2 EllipsoidTangentPlane::projectPointToNearestOnPlane(const glm::dvec3 &cartesian)
+glm::dvec2 EllipsoidTangentPlane::projectPointToNearestOnPlane(const glm::dvec3 &cartesian) const
 {
     Ray ray(cartesian, m_plane.getNormal());
 
@@ -59,6 +59,18 @@ bool GlobeRectangle::contains(const Cartographic &cartographic) const
             && latitude >= m_south && latitude <= m_north);
 }
 
+bool GlobeRectangle::intersects(const GlobeRectangle &other) const
+{
+    if (m_south >= other.m_north || other.m_south >= m_north) {
+        return false;
+    }
+
+    // measure the other rectangle eastward from the west of this one, so that rectangles crossing the
+    // antimeridian are compared the same way
+    double otherWest = Math::mod(other.m_west - m_west, Math::TWO_PI);
+    return otherWest < computeWidth() || otherWest + other.computeWidth() > Math::TWO_PI;
+}
+
 GlobeRectangle GlobeRectangle::computeUnion(const GlobeRectangle &other) const
 {
     double rectangleEast = m_east;
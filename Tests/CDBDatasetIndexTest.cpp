@@ -0,0 +1,42 @@
+#include "CDBDatasetIndex.h"
+#include "Config.h"
+#include "catch2/catch.hpp"
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test dataset index lists every tile of the dataset", "[CDBDatasetIndex]")
+{
+    std::filesystem::path CDBPath = dataPath / "CombineTilesets";
+    std::filesystem::path elevationPath = "Tiles/N32/W119/001_Elevation";
+    CDBDatasetIndex index = CDBDatasetIndex::createFromDirectory(CDBPath, elevationPath);
+    REQUIRE(index.getFiles().size() == 16);
+
+    SECTION("Test indexed files exist")
+    {
+        for (const auto &file : index.getFiles()) {
+            REQUIRE(std::filesystem::exists(CDBPath / file.relativePath));
+            REQUIRE(std::filesystem::file_size(CDBPath / file.relativePath) == file.size);
+            REQUIRE(index.isFileExist(file.relativePath));
+        }
+
+        REQUIRE(index.isUpToDate(CDBPath));
+    }
+
+    SECTION("Test tiles are looked up by their path relative to the CDB")
+    {
+        REQUIRE(index.isFileExist(elevationPath / "L02/U3/N32W119_D001_S001_T001_L02_U3_R2.tif"));
+        REQUIRE(index.isFileExist(elevationPath / "LC/U0/N32W119_D001_S001_T001_LC10_U0_R0.tif"));
+        REQUIRE_FALSE(index.isFileExist(elevationPath / "L02/U3/N32W119_D001_S001_T001_L02_U3_R4.tif"));
+        REQUIRE_FALSE(index.isFileExist(elevationPath / "L02/U2/N32W119_D001_S001_T001_L02_U3_R2.tif"));
+    }
+}
+
+TEST_CASE("Test dataset index of missing dataset is empty", "[CDBDatasetIndex]")
+{
+    CDBDatasetIndex index = CDBDatasetIndex::createFromDirectory(dataPath / "CombineTilesets",
+                                                                 "Tiles/N32/W119/100_GSFeature");
+    REQUIRE(index.getFiles().empty());
+    REQUIRE(index.isUpToDate(dataPath / "CombineTilesets"));
+    REQUIRE_FALSE(
+        index.isFileExist("Tiles/N32/W119/100_GSFeature/L00/U0/N32W119_D100_S001_T001_L00_U0_R0.dbf"));
+}
@@ -1,10 +1,12 @@
 #include "CDBElevation.h"
 #include "CDBTo3DTiles.h"
 #include "Config.h"
+#include "Ellipsoid.h"
 #include "TileFormatIO.h"
 #include "catch2/catch.hpp"
 #include "nlohmann/json.hpp"
 #include "tiny_gltf.h"
+#include <algorithm>
 #include <fstream>
 
 using namespace CDBTo3DTiles;
@@ -109,8 +111,9 @@ TEST_CASE("Test create elevation from file", "[CDBElevation]")
         // so total of vertices are 17x17 vertices
         const auto &mesh = elevation->getUniformGridMesh();
         REQUIRE(mesh.indices.size() == 16 * 16 * 6);
-        REQUIRE(mesh.positions.size() == 289);
+        REQUIRE(mesh.positions.empty());
         REQUIRE(mesh.positionRTCs.size() == 289);
+        REQUIRE(mesh.getVertexCount() == 289);
         REQUIRE(mesh.UVs.size() == 289);
         REQUIRE(mesh.normals.size() == 0);
 
@@ -153,6 +156,164 @@ TEST_CASE("Test create elevation from file", "[CDBElevation]")
     }
 }
 
+TEST_CASE("Test sample heights from elevation grid", "[CDBElevation]")
+{
+    std::string tileName = "N34W119_D001_S001_T001_LC06_U0_R0";
+    auto tile = CDBTile::createFromFile(tileName);
+    REQUIRE(tile != std::nullopt);
+
+    auto grid = CDBElevationGrid::createFromFile(dataPath / "Elevation" / (tileName + ".tif"), *tile);
+    REQUIRE(grid != std::nullopt);
+    REQUIRE(grid->getWidth() == 16);
+    REQUIRE(grid->getHeight() == 16);
+    REQUIRE(grid->getHeightCount() == 16 * 16);
+
+    // the Float32 raster keeps its samples as floats
+    REQUIRE(std::holds_alternative<std::vector<float>>(grid->getHeights()));
+    REQUIRE(grid->getHeightsByteLength() == 16 * 16 * sizeof(float));
+
+    auto rectangle = tile->getBoundRegion().getRectangle();
+    double epsilon = rectangle.computeWidth() / 64.0;
+    const auto &heights = std::get<std::vector<float>>(grid->getHeights());
+
+    SECTION("Sample the corners of the grid")
+    {
+        Core::Cartographic northWest(rectangle.getWest() + epsilon, rectangle.getNorth() - epsilon);
+        Core::Cartographic southEast(rectangle.getEast() - epsilon, rectangle.getSouth() + epsilon);
+        REQUIRE(grid->sampleHeight(northWest) == Approx(heights.front()));
+        REQUIRE(grid->sampleHeight(southEast) == Approx(heights.back()));
+    }
+
+    SECTION("Sample outside of the grid")
+    {
+        Core::Cartographic west(rectangle.getWest() - epsilon, rectangle.getNorth() - epsilon);
+        REQUIRE(grid->sampleHeight(west) == 0.0);
+    }
+
+    SECTION("Clamp only the selected points")
+    {
+        std::vector<Core::Cartographic> points{
+            Core::Cartographic(rectangle.getWest() + epsilon, rectangle.getNorth() - epsilon, 1000.0),
+            Core::Cartographic(rectangle.getEast() - epsilon, rectangle.getSouth() + epsilon, 1000.0)};
+        grid->clampPoints(points, {1});
+        REQUIRE(points[0].height == 1000.0);
+        REQUIRE(points[1].height == Approx(heights.back()));
+    }
+
+    SECTION("Create elevation from the grid")
+    {
+        auto elevation = CDBElevation::createFromGrid(*grid);
+        auto elevationFromFile = CDBElevation::createFromFile(dataPath / "Elevation" / (tileName + ".tif"));
+        REQUIRE(elevation != std::nullopt);
+        REQUIRE(elevationFromFile != std::nullopt);
+        REQUIRE(elevation->getUniformGridMesh().positionRTCs
+                == elevationFromFile->getUniformGridMesh().positionRTCs);
+    }
+}
+
+TEST_CASE("Test elevation grid with integer heights", "[CDBElevation]")
+{
+    // the same heights stored as Int16 and as Float64 give the same mesh and samples
+    glm::dvec2 pixelSize(0.5 / 16.0, -0.5 / 16.0);
+    std::vector<int16_t> integerHeights;
+    std::vector<double> doubleHeights;
+    for (size_t i = 0; i < 16 * 16; ++i) {
+        auto height = static_cast<int16_t>(100 + (i * 37) % 250);
+        integerHeights.emplace_back(height);
+        doubleHeights.emplace_back(static_cast<double>(height));
+    }
+
+    CDBTile tile(CDBGeoCell(32, -118), CDBDataset::Elevation, 1, 1, 1, 0, 0);
+    CDBElevationGrid integerGrid(integerHeights, 16, 16, pixelSize, tile);
+    CDBElevationGrid doubleGrid(doubleHeights, 16, 16, pixelSize, tile);
+    REQUIRE(integerGrid.getHeightsByteLength() == 16 * 16 * sizeof(int16_t));
+    REQUIRE(integerGrid.getHeightAt(17) == doubleHeights[17]);
+
+    auto rectangle = tile.getBoundRegion().getRectangle();
+    Core::Cartographic point(rectangle.getWest() + rectangle.computeWidth() * 0.3,
+                             rectangle.getSouth() + rectangle.computeHeight() * 0.6);
+    REQUIRE(integerGrid.sampleHeight(point) == doubleGrid.sampleHeight(point));
+
+    auto integerElevation = CDBElevation::createFromGrid(integerGrid);
+    auto doubleElevation = CDBElevation::createFromGrid(doubleGrid);
+    REQUIRE(integerElevation != std::nullopt);
+    REQUIRE(doubleElevation != std::nullopt);
+    REQUIRE(integerElevation->getUniformGridMesh().positionRTCs
+            == doubleElevation->getUniformGridMesh().positionRTCs);
+}
+
+TEST_CASE("Test elevation grid cache", "[CDBElevation]")
+{
+    auto elevationFile = dataPath / "Elevation" / "N34W119_D001_S001_T001_LC06_U0_R0.tif";
+    auto tile = CDBTile::createFromFile(elevationFile.stem().string());
+    auto otherTile = CDBTile::createFromFile("N34W119_D001_S001_T002_LC06_U0_R0");
+    REQUIRE(tile != std::nullopt);
+    REQUIRE(otherTile != std::nullopt);
+
+    SECTION("Grid is decoded once")
+    {
+        CDBElevationGridCache cache;
+        auto grid = cache.locateGrid(*tile, elevationFile);
+        auto cachedGrid = cache.locateGrid(*tile, elevationFile);
+        REQUIRE(grid != nullptr);
+        REQUIRE(grid == cachedGrid);
+
+        auto statistics = cache.getStatistics();
+        REQUIRE(statistics.misses == 1);
+        REQUIRE(statistics.hits == 1);
+        REQUIRE(statistics.bytes == 16 * 16 * sizeof(float));
+
+        auto elevation = CDBElevation::createFromFile(elevationFile, &cache);
+        REQUIRE(elevation != std::nullopt);
+        REQUIRE(cache.getStatistics().hits == 2);
+    }
+
+    SECTION("Least recently used grid is evicted past the memory budget")
+    {
+        CDBElevationGridCache cache(1);
+        auto grid = cache.locateGrid(*tile, elevationFile);
+        REQUIRE(grid != nullptr);
+        REQUIRE(cache.getStatistics().evictions == 0);
+
+        auto otherGrid = cache.locateGrid(*otherTile, elevationFile);
+        REQUIRE(otherGrid != nullptr);
+
+        auto statistics = cache.getStatistics();
+        REQUIRE(statistics.evictions == 1);
+        REQUIRE(statistics.bytes == 16 * 16 * sizeof(float));
+
+        // the evicted grid stays valid for its owner and is decoded again when asked
+        REQUIRE(grid->getHeightCount() == 16 * 16);
+        REQUIRE(cache.locateGrid(*tile, elevationFile) != grid);
+        REQUIRE(cache.getStatistics().misses == 3);
+    }
+
+    SECTION("Shrinking unlimited cache drops the least recently used grids")
+    {
+        CDBElevationGridCache cache;
+        auto grid = cache.locateGrid(*tile, elevationFile);
+        auto otherGrid = cache.locateGrid(*otherTile, elevationFile);
+        REQUIRE(otherGrid != nullptr);
+
+        cache.shrink();
+        auto statistics = cache.getStatistics();
+        REQUIRE(statistics.evictions == 1);
+        REQUIRE(statistics.bytes == 16 * 16 * sizeof(float));
+        REQUIRE(grid->getHeightCount() == 16 * 16);
+        REQUIRE(cache.locateGrid(*otherTile, elevationFile) == otherGrid);
+        REQUIRE(cache.locateGrid(*tile, elevationFile) != grid);
+    }
+
+    SECTION("Invalid elevation is cached as empty")
+    {
+        CDBElevationGridCache cache;
+        auto invalidFile = dataPath / "Elevation" / "N34W119_D001_S001_T001_L06_U0_R0.tif";
+        REQUIRE(cache.locateGrid(*tile, invalidFile) == nullptr);
+        REQUIRE(cache.locateGrid(*tile, invalidFile) == nullptr);
+        REQUIRE(cache.getStatistics().misses == 1);
+    }
+}
+
 TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 {
     // 16x16 mesh
@@ -171,8 +332,13 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
             REQUIRE(NW->getGridHeight() == 8);
 
             const auto &mesh = NW->getUniformGridMesh();
+
+            // positions rebuilt from the RTC offsets still agree with the parent grid
+            glm::dvec3 position = mesh.getPosition(0);
+            glm::dvec3 parentPosition = elevation->getUniformGridMesh().getPosition(0);
+            REQUIRE(glm::distance(position, parentPosition) < 0.01);
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -196,7 +362,7 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 
             const auto &mesh = NW->getUniformGridMesh();
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -217,7 +383,7 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 
             const auto &mesh = NE->getUniformGridMesh();
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -242,7 +408,7 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 
             const auto &mesh = NE->getUniformGridMesh();
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -263,7 +429,7 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 
             const auto &mesh = SW->getUniformGridMesh();
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -288,7 +454,7 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 
             const auto &mesh = SW->getUniformGridMesh();
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -309,7 +475,7 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 
             const auto &mesh = SE->getUniformGridMesh();
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -333,7 +499,7 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
 
             const auto &mesh = SE->getUniformGridMesh();
             REQUIRE(mesh.indices.size() == 8 * 8 * 6);
-            REQUIRE(mesh.positions.size() == 81);
+            REQUIRE(mesh.positions.empty());
             REQUIRE(mesh.positionRTCs.size() == 81);
             REQUIRE(mesh.UVs.size() == 81);
 
@@ -343,6 +509,282 @@ TEST_CASE("Test create sub region of an elevation", "[CDBElevation]")
     }
 }
 
+TEST_CASE("Test create nested sub regions of an elevation", "[CDBElevation]")
+{
+    // 16x16 mesh
+    auto elevation = CDBElevation::createFromFile(dataPath / "Elevation"
+                                                  / "N34W119_D001_S001_T001_LC06_U0_R0.tif");
+    REQUIRE(elevation != std::nullopt);
+
+    // the south east region of the north east region covers the 4x4 cells from (12, 4) of the grid
+    auto NE = elevation->createNorthEastSubRegion(false);
+    REQUIRE(NE != std::nullopt);
+    auto NESE = NE->createSouthEastSubRegion(false);
+    REQUIRE(NESE != std::nullopt);
+    REQUIRE(NESE->getGridWidth() == 4);
+    REQUIRE(NESE->getGridHeight() == 4);
+
+    const auto &gridMesh = elevation->getUniformGridMesh();
+    const auto &mesh = NESE->getUniformGridMesh();
+    REQUIRE(mesh.indices.size() == 4 * 4 * 6);
+    REQUIRE(mesh.positionRTCs.size() == 25);
+    checkUVTheSameAsOldElevation(mesh, gridMesh, 16, glm::uvec2(12, 4), glm::uvec2(16, 8));
+    for (uint32_t y = 0; y < 5; ++y) {
+        for (uint32_t x = 0; x < 5; ++x) {
+            glm::dvec3 position = mesh.getPosition(y * 5 + x);
+            glm::dvec3 gridPosition = gridMesh.getPosition((y + 4) * 17 + x + 12);
+            REQUIRE(glm::distance(position, gridPosition) < 0.01);
+        }
+    }
+
+    // reindexed UVs of a nested region still cover the whole region
+    auto reindexed = NE->createSouthEastSubRegion(true);
+    REQUIRE(reindexed != std::nullopt);
+    checkUVReindexForSubRegion(reindexed->getUniformGridMesh(), 4, 4);
+}
+
+TEST_CASE("Test simplify elevation on its grid", "[CDBElevation]")
+{
+    // 16x16 mesh
+    auto elevation = CDBElevation::createFromFile(dataPath / "Elevation"
+                                                  / "N34W119_D001_S001_T001_LC06_U0_R0.tif");
+    REQUIRE(elevation != std::nullopt);
+    const auto &gridMesh = elevation->getUniformGridMesh();
+
+    SECTION("No error keeps every triangle of the grid")
+    {
+        auto simplified = elevation->createSimplifiedMesh(0, 0.0f);
+        REQUIRE(simplified.indices.size() == gridMesh.indices.size());
+        REQUIRE(simplified.positionRTCs.size() == gridMesh.positionRTCs.size());
+        REQUIRE(simplified.UVs.size() == gridMesh.UVs.size());
+    }
+
+    SECTION("Error larger than the mesh keeps only the corners")
+    {
+        auto simplified = elevation->createSimplifiedMesh(0, 2.0f);
+        REQUIRE(simplified.indices.size() == 6);
+        REQUIRE(simplified.positionRTCs.size() == 4);
+        REQUIRE(simplified.UVs.size() == 4);
+    }
+
+    SECTION("Target index count is kept even when the error allows fewer triangles")
+    {
+        size_t targetIndexCount = gridMesh.indices.size() / 2;
+        auto simplified = elevation->createSimplifiedMesh(targetIndexCount, 2.0f);
+        REQUIRE(simplified.indices.size() >= targetIndexCount);
+        REQUIRE(simplified.indices.size() <= gridMesh.indices.size());
+        REQUIRE(simplified.positionRTCs.size() <= gridMesh.positionRTCs.size());
+    }
+
+    SECTION("Sub regions are simplified from the error pyramid of the grid")
+    {
+        auto NE = elevation->createNorthEastSubRegion(false);
+        REQUIRE(NE != std::nullopt);
+        auto NESE = NE->createSouthEastSubRegion(false);
+        REQUIRE(NESE != std::nullopt);
+
+        auto simplified = NESE->createSimplifiedMesh(0, 0.0f);
+        REQUIRE(simplified.indices.size() == 4 * 4 * 6);
+        REQUIRE(simplified.positionRTCs.size() == 25);
+
+        simplified = NESE->createSimplifiedMesh(0, 2.0f);
+        REQUIRE(simplified.indices.size() == 6);
+        REQUIRE(simplified.positionRTCs.size() == 4);
+
+        // the corners of the region are kept
+        const auto &regionMesh = NESE->getUniformGridMesh();
+        for (size_t i = 0; i < simplified.positionRTCs.size(); ++i) {
+            glm::dvec3 position = simplified.getPosition(i);
+            bool isCorner = false;
+            for (size_t corner : {0u, 4u, 20u, 24u}) {
+                isCorner = isCorner || glm::distance(position, regionMesh.getPosition(corner)) < 0.01;
+            }
+
+            REQUIRE(isCorner);
+        }
+    }
+}
+
+TEST_CASE("Test generate elevation normals on its grid", "[CDBElevation]")
+{
+    const auto &ellipsoid = Core::Ellipsoid::WGS84;
+
+    SECTION("Normals of a flat grid are the normals of the ellipsoid")
+    {
+        CDBTile tile(CDBGeoCell(32, -118), CDBDataset::Elevation, 1, 1, 0, 0, 0);
+        glm::dvec2 pixelSize(1.0 / 16.0, -1.0 / 16.0);
+        CDBElevationGrid grid(std::vector<double>(16 * 16, 100.0), 16, 16, pixelSize, tile);
+        auto elevation = CDBElevation::createFromGrid(grid);
+        REQUIRE(elevation != std::nullopt);
+
+        auto simplified = elevation->createSimplifiedMesh(0, 0.0f, true);
+        REQUIRE(simplified.normals.size() == simplified.positionRTCs.size());
+        for (size_t i = 0; i < simplified.normals.size(); ++i) {
+            glm::dvec3 up = ellipsoid.geodeticSurfaceNormal(simplified.getPosition(i));
+            REQUIRE(glm::dot(glm::dvec3(simplified.normals[i]), up) == Approx(1.0).epsilon(1e-4));
+        }
+    }
+
+    SECTION("Simplified meshes and sub regions gather the normals of the grid")
+    {
+        auto elevation = CDBElevation::createFromFile(dataPath / "Elevation"
+                                                      / "N34W119_D001_S001_T001_LC06_U0_R0.tif");
+        REQUIRE(elevation != std::nullopt);
+        auto gridNormals = elevation->createUniformGridNormals();
+        REQUIRE(gridNormals.size() == 289);
+        for (const auto &normal : gridNormals) {
+            REQUIRE(glm::length(normal) == Approx(1.0f));
+        }
+
+        // without simplification, the vertices are in the order of the grid
+        auto simplified = elevation->createSimplifiedMesh(0, 0.0f, true);
+        REQUIRE(simplified.normals.size() == 289);
+        REQUIRE(elevation->createSimplifiedMesh(0, 0.0f).normals.empty());
+
+        auto NE = elevation->createNorthEastSubRegion(false);
+        REQUIRE(NE != std::nullopt);
+        auto regionNormals = NE->createUniformGridNormals();
+        REQUIRE(regionNormals.size() == 81);
+        REQUIRE(regionNormals[0] == gridNormals[8]);
+        REQUIRE(regionNormals[9] == gridNormals[25]);
+        REQUIRE(regionNormals[80] == gridNormals[16 * 17 + 16]);
+
+        auto corners = NE->createSimplifiedMesh(0, 2.0f, true);
+        REQUIRE(corners.normals.size() == 4);
+        for (const auto &normal : corners.normals) {
+            REQUIRE(std::find(regionNormals.begin(), regionNormals.end(), normal) != regionNormals.end());
+        }
+    }
+}
+
+TEST_CASE("Test neighbor elevations share their borders", "[CDBElevation]")
+{
+    // two tiles next to each other, whose heights differ on both sides of the border they share
+    glm::dvec2 pixelSize(0.5 / 16.0, -0.5 / 16.0);
+    std::vector<double> westHeights;
+    std::vector<double> eastHeights;
+    for (size_t i = 0; i < 16 * 16; ++i) {
+        westHeights.emplace_back(100.0 + 50.0 * glm::sin(0.7 * static_cast<double>(i)));
+        eastHeights.emplace_back(200.0 + 80.0 * glm::cos(1.3 * static_cast<double>(i)));
+    }
+
+    CDBTile westTile(CDBGeoCell(32, -118), CDBDataset::Elevation, 1, 1, 1, 0, 0);
+    CDBTile eastTile(CDBGeoCell(32, -118), CDBDataset::Elevation, 1, 1, 1, 0, 1);
+    auto west = CDBElevation::createFromGrid(CDBElevationGrid(westHeights, 16, 16, pixelSize, westTile));
+    auto east = CDBElevation::createFromGrid(CDBElevationGrid(eastHeights, 16, 16, pixelSize, eastTile));
+    REQUIRE(west != std::nullopt);
+    REQUIRE(east != std::nullopt);
+
+    // the vertices of a border from north to south
+    auto getBorder = [](const Mesh &mesh, float u) {
+        std::vector<glm::dvec3> border;
+        for (size_t i = 0; i < mesh.UVs.size(); ++i) {
+            if (mesh.UVs[i].x == u) {
+                border.emplace_back(mesh.getPosition(i));
+            }
+        }
+
+        std::sort(border.begin(), border.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.z > rhs.z;
+        });
+        return border;
+    };
+
+    float eastU = west->getUniformGridMesh().UVs[16].x;
+    CDBElevationEdgeCache edgeCache;
+
+    SECTION("Vertices of a coarse border are moved on the border of the neighbor")
+    {
+        auto westMesh = west->createSimplifiedMesh(0, 2.0f, false, &edgeCache);
+        auto eastMesh = east->createSimplifiedMesh(0, 0.0f, false, &edgeCache);
+        auto westBorder = getBorder(westMesh, eastU);
+        auto eastBorder = getBorder(eastMesh, 0.0f);
+        REQUIRE(westBorder.size() == 2);
+        REQUIRE(eastBorder.size() == 17);
+        REQUIRE(glm::distance(eastBorder.front(), westBorder.front()) < 0.01);
+        REQUIRE(glm::distance(eastBorder.back(), westBorder.back()) < 0.01);
+        glm::dvec3 direction = glm::normalize(westBorder.back() - westBorder.front());
+        for (const auto &position : eastBorder) {
+            glm::dvec3 offset = position - westBorder.front();
+            REQUIRE(glm::length(offset - glm::dot(offset, direction) * direction) < 0.01);
+        }
+    }
+
+    SECTION("Vertices of a fine border are kept by the neighbor")
+    {
+        auto westMesh = west->createSimplifiedMesh(0, 0.0f, false, &edgeCache);
+        auto eastMesh = east->createSimplifiedMesh(0, 2.0f, false, &edgeCache);
+        auto westBorder = getBorder(westMesh, eastU);
+        auto eastBorder = getBorder(eastMesh, 0.0f);
+        REQUIRE(westBorder.size() == 17);
+        REQUIRE(eastBorder.size() == 17);
+        for (size_t i = 0; i < westBorder.size(); ++i) {
+            REQUIRE(glm::distance(eastBorder[i], westBorder[i]) < 0.01);
+        }
+
+        // the rest of the tile is still simplified
+        REQUIRE(eastMesh.positionRTCs.size() < east->getUniformGridMesh().positionRTCs.size());
+    }
+
+    SECTION("Borders of grids of different sizes match whichever tile is simplified first")
+    {
+        std::vector<double> coarseHeights(eastHeights.begin(), eastHeights.begin() + 8 * 8);
+        glm::dvec2 coarsePixelSize(0.5 / 8.0, -0.5 / 8.0);
+
+        // every vertex of a border is on the segments of the other border
+        auto isOnBorder = [](const glm::dvec3 &position, const std::vector<glm::dvec3> &border) {
+            for (size_t i = 1; i < border.size(); ++i) {
+                glm::dvec3 segment = border[i] - border[i - 1];
+                double t = glm::dot(position - border[i - 1], segment) / glm::dot(segment, segment);
+                t = glm::clamp(t, 0.0, 1.0);
+                if (glm::distance(position, border[i - 1] + t * segment) < 0.01) {
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        for (bool isFineFirst : {true, false}) {
+            // the simplified meshes are kept by the elevations, so each order starts from new ones
+            auto fineWest = CDBElevation::createFromGrid(
+                CDBElevationGrid(westHeights, 16, 16, pixelSize, westTile));
+            auto coarseEast = CDBElevation::createFromGrid(
+                CDBElevationGrid(coarseHeights, 8, 8, coarsePixelSize, eastTile));
+            REQUIRE(fineWest != std::nullopt);
+            REQUIRE(coarseEast != std::nullopt);
+
+            CDBElevationEdgeCache mixedEdgeCache;
+            Mesh westMesh;
+            Mesh eastMesh;
+            if (isFineFirst) {
+                westMesh = fineWest->createSimplifiedMesh(0, 0.0f, false, &mixedEdgeCache);
+                eastMesh = coarseEast->createSimplifiedMesh(0, 2.0f, false, &mixedEdgeCache);
+            } else {
+                eastMesh = coarseEast->createSimplifiedMesh(0, 2.0f, false, &mixedEdgeCache);
+                westMesh = fineWest->createSimplifiedMesh(0, 0.0f, false, &mixedEdgeCache);
+            }
+
+            // the vertices of the fine border are inserted in the coarse one when it is simplified last
+            auto westBorder = getBorder(westMesh, eastU);
+            auto eastBorder = getBorder(eastMesh, 0.0f);
+            REQUIRE(westBorder.size() == 17);
+            REQUIRE(eastBorder.size() >= 2);
+            if (isFineFirst) {
+                REQUIRE(eastBorder.size() == 17);
+            }
+
+            for (const auto &position : westBorder) {
+                REQUIRE(isOnBorder(position, eastBorder));
+            }
+
+            for (const auto &position : eastBorder) {
+                REQUIRE(isOnBorder(position, westBorder));
+            }
+        }
+    }
+}
+
 TEST_CASE("Test conversion when elevation has more LOD than imagery", "[CDBElevationConversion]")
 {
     SECTION("Imagery has only negative LOD")
@@ -500,9 +942,7 @@ TEST_CASE("Test conversion using elevation LOD only", "[CDBElevationConversion]"
     std::filesystem::remove_all(output);
 }
 
-TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simplified mesh if simplified "
-          "mesh is empty",
-          "[CDBElevationConversion]")
+TEST_CASE("Test that elevation conversion writes the simplified mesh", "[CDBElevationConversion]")
 {
     float decimateError = 0.5f;
     float thresholdIndices = 0.02f;
@@ -511,7 +951,7 @@ TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simp
     std::filesystem::path output = "ImageryMoreLODPositiveElevation";
     std::filesystem::path elevationOutputDir = output / "Tiles" / "N32" / "W118" / "Elevation" / "1_1";
 
-    // confirm that the elevation at LC09 is empty after decimation
+    // the elevation at LC09 is decimated down to the two triangles between its corners
     std::filesystem::path LC09Path = input / "Tiles" / "N32" / "W118" / "001_Elevation" / "LC" / "U0"
                                      / "N32W118_D001_S001_T001_LC09_U0_R0.tif";
     auto elevation = CDBElevation::createFromFile(LC09Path);
@@ -519,10 +959,10 @@ TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simp
     size_t targetIndices = static_cast<size_t>(
         thresholdIndices * static_cast<float>(elevation->getUniformGridMesh().indices.size()));
     auto simplied = elevation->createSimplifiedMesh(targetIndices, decimateError);
-    REQUIRE(simplied.indices.size() == 0);
-    REQUIRE(simplied.positionRTCs.size() == 0);
+    REQUIRE(simplied.indices.size() == 6);
+    REQUIRE(simplied.positionRTCs.size() == 4);
     REQUIRE(simplied.normals.size() == 0);
-    REQUIRE(simplied.UVs.size() == 0);
+    REQUIRE(simplied.UVs.size() == 4);
 
     // convert the CDB
     Converter converter(input, output);
@@ -531,7 +971,7 @@ TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simp
     converter.setElevationLODOnly(true);
     converter.convert();
 
-    // check that LC09 is using uniform grid
+    // check that LC09 is using the simplified mesh
     std::ifstream fs(elevationOutputDir / "N32W118_D001_S001_T001_LC09_U0_R0.b3dm", std::ios::binary);
     B3dmHeader b3dm;
     fs.read(reinterpret_cast<char *>(&b3dm), sizeof(b3dm));
@@ -567,18 +1007,17 @@ TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simp
     REQUIRE(gltfPrimitive.attributes.at("TEXCOORD_0") == 2);
 
     // check accessors
-    const auto &uniformElevation = elevation->getUniformGridMesh();
     const auto &indicesAccessor = model.accessors[static_cast<size_t>(gltfPrimitive.indices)];
-    REQUIRE(indicesAccessor.count == uniformElevation.indices.size());
+    REQUIRE(indicesAccessor.count == simplied.indices.size());
     REQUIRE(indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
 
     const auto &positionAccessor = model.accessors[static_cast<size_t>(gltfPrimitive.attributes.at("POSITION"))];
-    REQUIRE(positionAccessor.count == uniformElevation.positionRTCs.size());
+    REQUIRE(positionAccessor.count == simplied.positionRTCs.size());
     REQUIRE(positionAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
     REQUIRE(positionAccessor.type == TINYGLTF_TYPE_VEC3);
 
     const auto &texCoordAccessor = model.accessors[static_cast<size_t>(gltfPrimitive.attributes.at("TEXCOORD_0"))];
-    REQUIRE(texCoordAccessor.count == uniformElevation.UVs.size());
+    REQUIRE(texCoordAccessor.count == simplied.UVs.size());
     REQUIRE(texCoordAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
     REQUIRE(texCoordAccessor.type == TINYGLTF_TYPE_VEC2);
 
@@ -591,7 +1030,7 @@ TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simp
          i += sizeof(unsigned int)) {
         unsigned gltfIndex = 0;
         std::memcpy(&gltfIndex, &gltfBufferData[i], sizeof(unsigned int));
-        REQUIRE(gltfIndex == uniformElevation.indices[index]);
+        REQUIRE(gltfIndex == simplied.indices[index]);
         ++index;
     }
 
@@ -600,9 +1039,9 @@ TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simp
     for (size_t i = positionBufferView.byteOffset; i < positionBufferView.byteLength; i += sizeof(glm::vec3)) {
         glm::vec3 gltfPosition;
         std::memcpy(&gltfPosition, &gltfBufferData[i], sizeof(glm::vec3));
-        REQUIRE(gltfPosition.x == Approx(uniformElevation.positionRTCs[index].x));
-        REQUIRE(gltfPosition.y == Approx(uniformElevation.positionRTCs[index].y));
-        REQUIRE(gltfPosition.z == Approx(uniformElevation.positionRTCs[index].z));
+        REQUIRE(gltfPosition.x == Approx(simplied.positionRTCs[index].x));
+        REQUIRE(gltfPosition.y == Approx(simplied.positionRTCs[index].y));
+        REQUIRE(gltfPosition.z == Approx(simplied.positionRTCs[index].z));
         ++index;
     }
 
@@ -611,8 +1050,8 @@ TEST_CASE("Test that elevation conversion uses uniform grid mesh instead of simp
     for (size_t i = texCoordBufferView.byteOffset; i < texCoordBufferView.byteLength; i += sizeof(glm::vec2)) {
         glm::vec2 gltfTexCoord;
         std::memcpy(&gltfTexCoord, &gltfBufferData[i], sizeof(glm::vec2));
-        REQUIRE(gltfTexCoord.x == Approx(uniformElevation.UVs[index].x));
-        REQUIRE(gltfTexCoord.y == Approx(uniformElevation.UVs[index].y));
+        REQUIRE(gltfTexCoord.x == Approx(simplied.UVs[index].x));
+        REQUIRE(gltfTexCoord.y == Approx(simplied.UVs[index].y));
         ++index;
     }
 
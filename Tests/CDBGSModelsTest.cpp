@@ -140,30 +140,77 @@ TEST_CASE("Test GSModel will close zip archive when destruct", "[CDBGSModels]")
     std::filesystem::path GSModelZip = CDBPath / (modelTile.getRelativePath().string() + ".zip");
     REQUIRE(std::filesystem::exists(GSModelZip));
 
-    osgDB::ReaderWriter *rw = osgDB::Registry::instance()->getReaderWriterForExtension("zip");
-    REQUIRE(rw != nullptr);
-
     // set relative path for GSModel
     osg::ref_ptr<osgDB::Options> options = new osgDB::Options();
     options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
     options->getDatabasePathList().push_front(GSModelZip.parent_path());
 
     // read GSModel geometry
-    osgDB::ReaderWriter::ReadResult GSModelRead = rw->openArchive(GSModelZip, osgDB::Archive::READ);
-    REQUIRE(GSModelRead.validArchive());
+    auto GSModelArchive = CDBGSModelArchive::open(GSModelZip);
+    REQUIRE(GSModelArchive != nullptr);
+    REQUIRE(GSModelArchive->archive->getEntryNames().size() > 0);
 
-    osg::ref_ptr<osgDB::Archive> archive = GSModelRead.takeArchive();
+    // the archive is unmapped once its last owner is destroyed
+    std::weak_ptr<const CDBGSModelArchive> archive = GSModelArchive;
+    {
+        auto models = CDBGSModels(std::move(modelsAttributes), modelTile, std::move(GSModelArchive), options);
+        REQUIRE(models.getModel3D().getMeshes().size() > 0);
+        REQUIRE(archive.expired() == false);
+    }
 
-    // The function getFileNames will return true if archive is opened
-    std::vector<std::string> fileNames;
-    REQUIRE(archive->getFileNames(fileNames) == true);
+    REQUIRE(archive.expired() == true);
+}
 
-    {
-        auto models = CDBGSModels(std::move(modelsAttributes), modelTile, archive, options);
+TEST_CASE("Test reading GSModels in parallel from shared archives", "[CDBGSModels]")
+{
+    std::filesystem::path CDBPath = dataPath / "GSModelsWithGSModelTexture";
+    std::filesystem::path input = CDBPath / "Tiles" / "N32" / "W118" / "100_GSFeature" / "L00" / "U0"
+                                  / "N32W118_D100_S001_T001_L00_U0_R0.dbf";
+    auto GSFeatureTile = CDBTile::createFromFile(input.filename().string());
+    REQUIRE(GSFeatureTile != std::nullopt);
+
+    auto readModels = [&](CDBGSModelArchiveCache *archives, ThreadPool *threadPool) {
+        GDALDatasetUniquePtr attributesDataset = GDALDatasetUniquePtr(
+            (GDALDataset *) GDALOpenEx(input.c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
+        REQUIRE(attributesDataset != nullptr);
+
+        CDBModelsAttributes modelsAttributes(std::move(attributesDataset), *GSFeatureTile, CDBPath);
+        auto models = CDBGSModels::createFromModelsAttributes(std::move(modelsAttributes),
+                                                              CDBPath,
+                                                              archives,
+                                                              threadPool);
+        REQUIRE(models != std::nullopt);
+        return std::move(*models);
+    };
+
+    CDBGSModelArchiveCache archives;
+    ThreadPool threadPool(4);
+    auto sequential = readModels(nullptr, nullptr);
+    auto parallel = readModels(&archives, &threadPool);
+    auto cached = readModels(&archives, &threadPool);
+
+    // models are combined in the order of the instances whichever thread reads them
+    for (const auto *models : {&parallel, &cached}) {
+        const auto &model3D = models->getModel3D();
+        REQUIRE(model3D.getMeshes().size() == sequential.getModel3D().getMeshes().size());
+        REQUIRE(model3D.getTextures().size() == sequential.getModel3D().getTextures().size());
+        for (size_t i = 0; i < model3D.getMeshes().size(); ++i) {
+            REQUIRE(model3D.getMeshes()[i].positions == sequential.getModel3D().getMeshes()[i].positions);
+            REQUIRE(model3D.getMeshes()[i].batchIDs == sequential.getModel3D().getMeshes()[i].batchIDs);
+        }
+
+        for (const auto &image : model3D.getImages()) {
+            REQUIRE(image != nullptr);
+        }
     }
 
-    // This function will return false if archive is closed;
-    REQUIRE(archive->getFileNames(fileNames) == false);
+    // the archives are opened once and stay open while a model uses them
+    CDBTile modelTile(GSFeatureTile->getGeoCell(), CDBDataset::GSModelGeometry, 1, 1, 0, 0, 0);
+    std::filesystem::path GSModelZip = CDBPath / (modelTile.getRelativePath().string() + ".zip");
+    auto archive = archives.open(GSModelZip);
+    REQUIRE(archive != nullptr);
+    REQUIRE(archive == archives.open(GSModelZip));
+    REQUIRE(archives.open(CDBPath / "missing.zip") == nullptr);
 }
 
 TEST_CASE("Test converting GSModel to tileset.json", "[CDBGSModels]")
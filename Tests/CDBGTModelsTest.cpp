@@ -1,10 +1,18 @@
+#include "CDB.h"
 #include "CDBModels.h"
 #include "CDBTo3DTiles.h"
 #include "Config.h"
+#include "TestHelpers.h"
+#include "TileFormatIO.h"
 #include "catch2/catch.hpp"
 #include "nlohmann/json.hpp"
 #include "ogrsf_frmts.h"
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <limits>
+#include <regex>
 
 using namespace CDBTo3DTiles;
 
@@ -35,6 +43,46 @@ static void checkGTTilesetDirectoryStructure(const std::filesystem::path &tilese
     REQUIRE(testJson == verifiedJson);
 }
 
+static std::vector<std::string> readCMPTGltfURIs(const std::filesystem::path &cmptPath)
+{
+    auto cmpt = readBinaryFile(cmptPath);
+    REQUIRE(cmpt.size() >= sizeof(CmptHeader));
+    CmptHeader cmptHeader;
+    std::memcpy(&cmptHeader, cmpt.data(), sizeof(cmptHeader));
+
+    // the glTF of an i3dm follows its feature and batch tables, padded with spaces
+    std::vector<std::string> GltfURIs;
+    size_t offset = sizeof(CmptHeader);
+    for (uint32_t i = 0; i < cmptHeader.titleLength; ++i) {
+        REQUIRE(offset + sizeof(I3dmHeader) <= cmpt.size());
+        I3dmHeader header;
+        std::memcpy(&header, cmpt.data() + offset, sizeof(header));
+        if (std::string(header.magic, sizeof(header.magic)) == "i3dm") {
+            size_t GltfOffset = offset + sizeof(I3dmHeader) + header.featureTableJsonByteLength
+                                + header.featureTableBinByteLength + header.batchTableJsonByteLength
+                                + header.batchTableBinByteLength;
+            std::string GltfURI(cmpt.data() + GltfOffset, cmpt.data() + offset + header.byteLength);
+            GltfURI.erase(GltfURI.find_last_not_of(' ') + 1);
+            GltfURIs.emplace_back(GltfURI);
+        }
+
+        offset += header.byteLength;
+    }
+
+    return GltfURIs;
+}
+
+static nlohmann::json readGlbJson(const std::filesystem::path &glbPath)
+{
+    // the JSON chunk follows the 12 bytes header and the 8 bytes chunk header
+    auto glb = readBinaryFile(glbPath);
+    REQUIRE(glb.size() >= 20);
+    uint32_t JSONByteLength;
+    std::memcpy(&JSONByteLength, glb.data() + 12, sizeof(JSONByteLength));
+    REQUIRE(20 + JSONByteLength <= glb.size());
+    return nlohmann::json::parse(glb.begin() + 20, glb.begin() + 20 + JSONByteLength);
+}
+
 TEST_CASE("Test locating GTModel in CDB database", "[CDBGTModelCache]")
 {
     SECTION("Successfully find model")
@@ -62,6 +110,92 @@ TEST_CASE("Test locating GTModel in CDB database", "[CDBGTModelCache]")
     }
 }
 
+TEST_CASE("Test GTModel cache loads a model once when shared between threads", "[CDBGTModelCache]")
+{
+    std::filesystem::path input = dataPath / "GTModels";
+    CDBGTModelCache GTModelCache(input);
+    ThreadPool threadPool(4);
+
+    std::vector<std::shared_ptr<const CDBModel3DResult>> model3DResults(16);
+    {
+        TaskGroup tasks(threadPool);
+        GTModelCache.prefetchModel3D("AL015", "coronado_bridge", 0, tasks);
+        for (size_t i = 0; i < model3DResults.size(); ++i) {
+            tasks.run([&, i]() {
+                std::string modelKey;
+                model3DResults[i] = GTModelCache.locateModel3D("AL015", "coronado_bridge", 0, modelKey);
+            });
+        }
+
+        tasks.wait();
+    }
+
+    REQUIRE(model3DResults.front() != nullptr);
+    REQUIRE(model3DResults.front()->getMeshes().size() == 3);
+    for (const auto &model3DResult : model3DResults) {
+        REQUIRE(model3DResult == model3DResults.front());
+    }
+}
+
+TEST_CASE("Test GTModel cache evicts least recently used models over its memory budget", "[CDBGTModelCache]")
+{
+    std::filesystem::path input = dataPath / "GTModels";
+    std::string modelKey;
+
+    SECTION("Test unlimited cache keeps every model")
+    {
+        CDBGTModelCache GTModelCache(input);
+        auto model3DResult = GTModelCache.locateModel3D("AL015", "coronado_bridge", 0, modelKey);
+        REQUIRE(GTModelCache.locateModel3D("AL015", "coronado_bridge", 0, modelKey) == model3DResult);
+        REQUIRE(GTModelCache.locateModel3D("122", "coronado_bridge", 0, modelKey) == nullptr);
+
+        auto statistics = GTModelCache.getStatistics();
+        REQUIRE(statistics.hits == 1);
+        REQUIRE(statistics.misses == 2);
+        REQUIRE(statistics.evictions == 0);
+        REQUIRE(statistics.bytes > 0);
+    }
+
+    SECTION("Test model over the budget is evicted once another model is loaded")
+    {
+        CDBGTModelCache GTModelCache(input, nullptr, 1);
+        auto model3DResult = GTModelCache.locateModel3D("AL015", "coronado_bridge", 0, modelKey);
+        REQUIRE(model3DResult != nullptr);
+        REQUIRE(GTModelCache.getStatistics().evictions == 0);
+
+        REQUIRE(GTModelCache.locateModel3D("122", "coronado_bridge", 0, modelKey) == nullptr);
+        auto statistics = GTModelCache.getStatistics();
+        REQUIRE(statistics.evictions == 1);
+        REQUIRE(statistics.bytes == 0);
+
+        // the evicted model is still valid for its holders and is loaded again on the next request
+        REQUIRE(model3DResult->getMeshes().size() == 3);
+        auto reloadedModel3DResult = GTModelCache.locateModel3D("AL015", "coronado_bridge", 0, modelKey);
+        REQUIRE(reloadedModel3DResult != nullptr);
+        REQUIRE(reloadedModel3DResult != model3DResult);
+        REQUIRE(GTModelCache.getStatistics().misses == 3);
+    }
+
+    SECTION("Test shrinking unlimited cache drops the least recently used models")
+    {
+        CDBGTModelCache GTModelCache(input);
+        auto model3DResult = GTModelCache.locateModel3D("AL015", "coronado_bridge", 0, modelKey);
+        REQUIRE(model3DResult != nullptr);
+        REQUIRE(GTModelCache.locateModel3D("122", "coronado_bridge", 0, modelKey) == nullptr);
+
+        GTModelCache.shrink();
+        auto statistics = GTModelCache.getStatistics();
+        REQUIRE(statistics.evictions == 1);
+        REQUIRE(statistics.bytes == 0);
+        REQUIRE(model3DResult->getMeshes().size() == 3);
+
+        // the missing model was used last, so it is still cached
+        REQUIRE(GTModelCache.locateModel3D("122", "coronado_bridge", 0, modelKey) == nullptr);
+        REQUIRE(GTModelCache.getStatistics().hits == 1);
+        REQUIRE(GTModelCache.locateModel3D("AL015", "coronado_bridge", 0, modelKey) != model3DResult);
+    }
+}
+
 TEST_CASE("Test locating GTModel with metadata in CDB database", "[CDBGTModels]")
 {
     std::filesystem::path CDBPath = dataPath / "GTModels";
@@ -133,6 +267,54 @@ TEST_CASE("Test locating GTModel with metadata in CDB database", "[CDBGTModels]"
     REQUIRE(scale.z == Approx(1.0));
 }
 
+TEST_CASE("Test listing the GTFeature tiles of a GeoCell before reading them", "[CDBGTModels]")
+{
+    CDB cdb(dataPath / "GTModels");
+    auto tileFiles = cdb.getTileFiles(CDBGeoCell(32, -118), CDBDataset::GTFeature);
+
+    // only the point features are listed, ten negative levels and the positive levels of both classes
+    REQUIRE(tileFiles.size() == 23);
+    auto findTileFile = [&](const std::string &filename) {
+        return std::find_if(tileFiles.begin(), tileFiles.end(), [&](const CDBTileFile &tileFile) {
+            return tileFile.path.filename() == filename;
+        });
+    };
+
+    auto bridge = findTileFile("N32W118_D101_S001_T001_L00_U0_R0.dbf");
+    auto parent = findTileFile("N32W118_D101_S002_T001_L00_U0_R0.dbf");
+    auto child = findTileFile("N32W118_D101_S002_T001_L01_U1_R1.dbf");
+    REQUIRE(bridge != tileFiles.end());
+    REQUIRE(child != tileFiles.end());
+    REQUIRE(parent < child);
+    REQUIRE(bridge->isLeaf);
+    REQUIRE(!parent->isLeaf);
+    REQUIRE(child->isLeaf);
+    REQUIRE(findTileFile("N32W118_D101_S001_T002_L00_U0_R0.dbf") == tileFiles.end());
+
+    auto models = cdb.readGTModelTile(*bridge);
+    REQUIRE(models);
+    REQUIRE(models->getModelsAttributes().getInstancesAttributes().getInstancesCount() == 1);
+}
+
+TEST_CASE("Test GTFeature tiles read ahead are processed in order", "[CDBGTModels]")
+{
+    CDB cdb(dataPath / "GTModels");
+    CDBGeoCell geoCell(32, -118);
+    std::vector<std::string> sequentialTiles;
+    cdb.forEachGTModelTile(geoCell, [&](CDBGTModels models) {
+        sequentialTiles.emplace_back(models.getModelsAttributes().getTile().getFilename());
+    });
+    REQUIRE(!sequentialTiles.empty());
+
+    ThreadPool threadPool(4);
+    cdb.setReadAheadDepth(3);
+    std::vector<std::string> readAheadTiles;
+    cdb.forEachGTModelTile(geoCell, threadPool, [&](CDBGTModels models) {
+        readAheadTiles.emplace_back(models.getModelsAttributes().getTile().getFilename());
+    });
+    REQUIRE(readAheadTiles == sequentialTiles);
+}
+
 TEST_CASE("Test CDBGTModels conversion to tileset.json", "[CDBGTModels]")
 {
     std::filesystem::path CDBPath = dataPath / "GTModels";
@@ -158,3 +340,112 @@ TEST_CASE("Test CDBGTModels conversion to tileset.json", "[CDBGTModels]")
 
     std::filesystem::remove_all(output);
 }
+
+TEST_CASE("Test deciding which GTModels are baked into their tile", "[CDBGTModels]")
+{
+    CDBGTModelBaking baking;
+    REQUIRE(!baking.shouldBake(1, 10));
+
+    baking.maxInstances = 2;
+    baking.maxTriangles = 100;
+    REQUIRE(baking.shouldBake(1, 100));
+    REQUIRE(baking.shouldBake(2, 50));
+    REQUIRE(!baking.shouldBake(2, 51));
+    REQUIRE(!baking.shouldBake(3, 1));
+    REQUIRE(!baking.shouldBake(0, 1));
+
+    baking.maxTriangles = 0;
+    REQUIRE(baking.shouldBake(2, 1000000));
+}
+
+TEST_CASE("Test CDBGTModels conversion with baked GTModels", "[CDBGTModels]")
+{
+    std::filesystem::path CDBPath = dataPath / "GTModels";
+    std::filesystem::path output = "GTModels";
+    Converter converter(CDBPath, output);
+    converter.setGTModelBaking(std::numeric_limits<size_t>::max(), 0);
+    converter.convert();
+
+    // every model is baked, so the tiles are B3DMs and no instanced glTF is written
+    std::filesystem::path treeOutputPath = output / "Tiles" / "N32" / "W118" / "GTModels" / "2_1";
+    REQUIRE(std::filesystem::exists(treeOutputPath / "Gltf" / "Textures"));
+    size_t B3DMCount = 0;
+    for (std::filesystem::directory_entry entry : std::filesystem::directory_iterator(treeOutputPath)) {
+        REQUIRE(entry.path().extension() != ".cmpt");
+        if (entry.path().extension() == ".b3dm") {
+            ++B3DMCount;
+        }
+    }
+
+    REQUIRE(B3DMCount == 1);
+    for (std::filesystem::directory_entry entry :
+         std::filesystem::directory_iterator(treeOutputPath / "Gltf")) {
+        REQUIRE(entry.path().extension() != ".glb");
+    }
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test CDBGTModels conversion with deduplicated content", "[CDBGTModels]")
+{
+    // the tree tile is copied to a second GeoCell, so the tiles of both GeoCells instance the same models
+    std::filesystem::path CDBPath = "GTModelsCDB";
+    std::filesystem::path output = "GTModels";
+    std::filesystem::remove_all(CDBPath);
+    std::filesystem::copy(dataPath / "GTModels", CDBPath, std::filesystem::copy_options::recursive);
+    std::filesystem::path tilesPath = std::filesystem::path("101_GTFeature") / "L00" / "U0";
+    std::filesystem::path treeTiles = CDBPath / "Tiles" / "N32" / "W118" / tilesPath;
+    std::filesystem::path copiedTreeTiles = CDBPath / "Tiles" / "N32" / "W119" / tilesPath;
+    std::filesystem::create_directories(copiedTreeTiles);
+    for (std::filesystem::directory_entry entry : std::filesystem::directory_iterator(treeTiles)) {
+        std::string filename = entry.path().filename().string();
+        if (filename.find("_D101_S002_") != std::string::npos) {
+            filename.replace(0, std::string("N32W118").size(), "N32W119");
+            std::filesystem::copy_file(entry.path(), copiedTreeTiles / filename);
+        }
+    }
+
+    Converter converter(CDBPath, output);
+    converter.setDeduplicateContent(true);
+    converter.convert();
+
+    // both tiles reference the same glb of the content store, relative to their own tileset
+    std::regex contentFilename("[0-9a-f]{16}_[0-9]+\\.glb");
+    std::vector<std::filesystem::path> glbPaths;
+    for (const std::string &geoCell : {"N32W118", "N32W119"}) {
+        std::filesystem::path tilesetPath = output / "Tiles" / "N32" / geoCell.substr(3) / "GTModels" / "2_1";
+        std::filesystem::path cmptPath = tilesetPath / (geoCell + "_D101_S002_T001_L00_U0_R0.cmpt");
+        REQUIRE(std::filesystem::exists(cmptPath));
+        for (std::filesystem::directory_entry entry :
+             std::filesystem::directory_iterator(tilesetPath / "Gltf")) {
+            REQUIRE(entry.path().extension() != ".glb");
+        }
+
+        auto GltfURIs = readCMPTGltfURIs(cmptPath);
+        REQUIRE(!GltfURIs.empty());
+        for (const auto &GltfURI : GltfURIs) {
+            auto glbPath = (tilesetPath / GltfURI).lexically_normal();
+            REQUIRE(glbPath.parent_path() == output / "Content");
+            REQUIRE(std::regex_match(glbPath.filename().string(), contentFilename));
+            REQUIRE(std::filesystem::exists(glbPath));
+            glbPaths.emplace_back(glbPath);
+        }
+    }
+
+    std::sort(glbPaths.begin(), glbPaths.end());
+    REQUIRE(std::adjacent_find(glbPaths.begin(), glbPaths.end()) != glbPaths.end());
+
+    // the textures of a stored glb are stored next to it
+    for (const auto &glbPath : glbPaths) {
+        auto gltfJson = readGlbJson(glbPath);
+        REQUIRE(gltfJson.contains("images"));
+        for (const auto &image : gltfJson["images"]) {
+            std::filesystem::path textureURI = image.at("uri").get<std::string>();
+            REQUIRE(textureURI.parent_path().empty());
+            REQUIRE(std::filesystem::exists(glbPath.parent_path() / textureURI));
+        }
+    }
+
+    std::filesystem::remove_all(output);
+    std::filesystem::remove_all(CDBPath);
+}
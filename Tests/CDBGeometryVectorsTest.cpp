@@ -2,6 +2,7 @@
 #include "CDBTo3DTiles.h"
 #include "Config.h"
 #include "catch2/catch.hpp"
+#include "ogrsf_frmts.h"
 #include <filesystem>
 
 using namespace CDBTo3DTiles;
@@ -24,14 +25,20 @@ TEST_CASE("Test create CDBGeometryVector", "[CDBGeometryVectors]")
         REQUIRE(mesh.normals.size() == 0);
         REQUIRE(mesh.UVs.size() == 0);
 
+        // the lines are counted before they are converted, so the mesh is allocated once
+        REQUIRE(mesh.positions.capacity() == mesh.positions.size());
+        REQUIRE(mesh.indices.capacity() == mesh.indices.size());
+
         // check instance attributes share the same class attribute
         auto attribsInstances = vector->getInstancesAttributes();
         size_t instancesCount = attribsInstances.getInstancesCount();
         REQUIRE(instancesCount == 8);
 
+        // repeated strings are interned, so every instance refers to the same pooled CNAM
         const auto &CNAMs = attribsInstances.getCNAMs();
-        for (const auto &CNAM : CNAMs) {
-            REQUIRE(CNAM == "AP030000-AP030-000U31R31-0");
+        for (size_t i = 0; i < instancesCount; ++i) {
+            REQUIRE(CNAMs[i] == "AP030000-AP030-000U31R31-0");
+            REQUIRE(CNAMs.getHandle(i) == CNAMs.getHandle(0));
         }
 
         const auto &stringAttribs = attribsInstances.getStringAttribs();
@@ -39,6 +46,7 @@ TEST_CASE("Test create CDBGeometryVector", "[CDBGeometryVectors]")
         const auto &doubleAttribs = attribsInstances.getDoubleAttribs();
         for (size_t i = 0; i < instancesCount; ++i) {
             REQUIRE(stringAttribs.at("AHGT")[i] == "F");
+            REQUIRE(stringAttribs.at("FACC").getHandle(i) == stringAttribs.at("FACC").getHandle(0));
             REQUIRE(stringAttribs.at("FACC")[i] == "AP030");
             REQUIRE(stringAttribs.at("MODT")[i] == "T");
 
@@ -113,6 +121,7 @@ TEST_CASE("Test create CDBGeometryVector", "[CDBGeometryVectors]")
         REQUIRE(mesh.positionRTCs.size() > 0);
         REQUIRE(mesh.normals.size() == 0);
         REQUIRE(mesh.UVs.size() == 0);
+        REQUIRE(mesh.positions.capacity() == mesh.positions.size());
 
         // check instance attributes share the same class attribute
         auto attribsInstances = vector->getInstancesAttributes();
@@ -158,3 +167,211 @@ TEST_CASE("Test create CDBGeometryVector", "[CDBGeometryVectors]")
     }
 }
 
+
+TEST_CASE("Test adding the features of a layer through its columns", "[CDBGeometryVectors]")
+{
+    std::filesystem::path vectorFile = dataPath / "RoadNetwork" / "Tiles" / "N32" / "W118" / "201_RoadNetwork"
+                                       / "LC" / "U0" / "N32W118_D201_S002_T003_LC05_U0_R0.dbf";
+    GDALDatasetUniquePtr dataset = GDALDatasetUniquePtr(
+        (GDALDataset *) GDALOpenEx(vectorFile.c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
+    REQUIRE(dataset != nullptr);
+
+    OGRLayer *layer = dataset->GetLayer(0);
+    auto features = readLayerFeatures(*layer);
+    REQUIRE(features.size() == 8);
+
+    CDBInstancesAttributes byFeature;
+    CDBInstancesAttributes byColumns;
+    auto columns = byColumns.createLayerColumns(*layer->GetLayerDefn(), features.size());
+    for (const auto &feature : features) {
+        byFeature.addInstanceFeature(*feature);
+        byColumns.addInstanceFeature(*feature, columns);
+    }
+
+    REQUIRE(byColumns.getInstancesCount() == 8);
+    REQUIRE(byColumns.getIntegerAttribs() == byFeature.getIntegerAttribs());
+    REQUIRE(byColumns.getDoubleAttribs() == byFeature.getDoubleAttribs());
+    REQUIRE(byColumns.getStringAttribs().size() == byFeature.getStringAttribs().size());
+    for (const auto &column : byColumns.getStringAttribs()) {
+        const auto &expected = byFeature.getStringAttribs().at(column.first);
+        REQUIRE(column.second.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(column.second[i] == expected[i]);
+        }
+    }
+
+    for (size_t i = 0; i < byFeature.getInstancesCount(); ++i) {
+        REQUIRE(byColumns.getCNAMs()[i] == byFeature.getCNAMs()[i]);
+    }
+
+    // no column is created for a layer without features
+    CDBInstancesAttributes empty;
+    empty.createLayerColumns(*layer->GetLayerDefn(), 0);
+    REQUIRE(empty.getIntegerAttribs().empty());
+    REQUIRE(empty.getStringAttribs().empty());
+}
+
+TEST_CASE("Test triangulating polygons in parallel", "[CDBGeometryVectors]")
+{
+    std::filesystem::path CDBPath = dataPath / "HydrographyNetwork";
+    std::filesystem::path vectorFile = CDBPath / "Tiles" / "N32" / "W118" / "204_HydrographyNetwork" / "LC"
+                                       / "U0" / "N32W118_D204_S002_T005_LC06_U0_R0.dbf";
+
+    auto sequentialVector = CDBGeometryVectors::createFromFile(vectorFile, CDBPath);
+    REQUIRE(sequentialVector != std::nullopt);
+
+    // the triangles are concatenated in feature order, so the mesh doesn't depend on the threads
+    ThreadPool threadPool(4);
+    auto parallelVector = CDBGeometryVectors::createFromFile(vectorFile, CDBPath, &threadPool);
+    REQUIRE(parallelVector != std::nullopt);
+
+    const auto &sequentialMesh = sequentialVector->getMesh();
+    const auto &parallelMesh = parallelVector->getMesh();
+    REQUIRE(parallelMesh.indices.size() > 0);
+    REQUIRE(parallelMesh.positions == sequentialMesh.positions);
+    REQUIRE(parallelMesh.positionRTCs == sequentialMesh.positionRTCs);
+    REQUIRE(parallelMesh.indices == sequentialMesh.indices);
+    REQUIRE(parallelMesh.batchIDs == sequentialMesh.batchIDs);
+}
+
+TEST_CASE("Test simplifying vector meshes", "[CDBGeometryVectors]")
+{
+    SECTION("Test simplifying line strips")
+    {
+        Mesh mesh;
+        mesh.primitiveType = PrimitiveType::Lines;
+        mesh.aabb = AABB();
+        mesh.positions = {{0.0, 0.0, 0.0},
+                          {10.0, 0.1, 0.0},
+                          {20.0, 1.5, 0.0},
+                          {30.0, 0.1, 0.0},
+                          {40.0, 0.0, 0.0},
+                          {100.0, 0.0, 0.0},
+                          {100.5, 0.0, 0.0}};
+        mesh.batchIDs = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f};
+        mesh.indices = {0, 1, 1, 2, 2, 3, 3, 4, 5, 6};
+        for (const auto &position : mesh.positions) {
+            mesh.aabb->merge(position);
+            mesh.positionRTCs.emplace_back(position);
+        }
+
+        // the strip of the second feature is smaller than the error
+        Mesh simplified = simplifyMesh(mesh, 1.0);
+        REQUIRE(simplified.primitiveType == PrimitiveType::Lines);
+        REQUIRE(simplified.positions
+                == std::vector<glm::dvec3>{{0.0, 0.0, 0.0}, {20.0, 1.5, 0.0}, {40.0, 0.0, 0.0}});
+        REQUIRE(simplified.indices == std::vector<uint32_t>{0, 1, 1, 2});
+        REQUIRE(simplified.batchIDs == std::vector<float>{0.0f, 0.0f, 0.0f});
+        REQUIRE(simplified.positionRTCs.size() == 3);
+        REQUIRE(simplified.aabb->min == glm::dvec3(0.0, 0.0, 0.0));
+        REQUIRE(simplified.aabb->max == glm::dvec3(40.0, 1.5, 0.0));
+
+        Mesh unchanged = simplifyMesh(mesh, 0.0);
+        REQUIRE(unchanged.positions == mesh.positions);
+        REQUIRE(unchanged.indices == mesh.indices);
+    }
+
+    SECTION("Test dropping the polygons smaller than the error")
+    {
+        Mesh mesh;
+        mesh.aabb = AABB();
+        mesh.positions = {{0.0, 0.0, 0.0},
+                          {100.0, 0.0, 0.0},
+                          {0.0, 100.0, 0.0},
+                          {200.0, 200.0, 0.0},
+                          {200.5, 200.0, 0.0},
+                          {200.0, 200.5, 0.0}};
+        mesh.batchIDs = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+        mesh.indices = {0, 1, 2, 3, 4, 5};
+        for (const auto &position : mesh.positions) {
+            mesh.aabb->merge(position);
+        }
+
+        for (const auto &position : mesh.positions) {
+            mesh.positionRTCs.emplace_back(position - mesh.aabb->center());
+        }
+
+        Mesh simplified = simplifyMesh(mesh, 1.0);
+        REQUIRE(simplified.indices == std::vector<uint32_t>{0, 1, 2});
+        REQUIRE(simplified.positions
+                == std::vector<glm::dvec3>{{0.0, 0.0, 0.0}, {100.0, 0.0, 0.0}, {0.0, 100.0, 0.0}});
+        REQUIRE(simplified.batchIDs == std::vector<float>{0.0f, 0.0f, 0.0f});
+    }
+
+    SECTION("Test simplifying the lines of a road network")
+    {
+        std::filesystem::path CDBPath = dataPath / "RoadNetwork";
+        std::filesystem::path vectorFile = CDBPath / "Tiles" / "N32" / "W118" / "201_RoadNetwork" / "LC"
+                                           / "U0" / "N32W118_D201_S002_T003_LC05_U0_R0.dbf";
+        auto vector = CDBGeometryVectors::createFromFile(vectorFile, CDBPath);
+        REQUIRE(vector != std::nullopt);
+
+        // the roads are single segments, only the one shorter than 4km is dropped
+        const auto &mesh = vector->getMesh();
+        REQUIRE(mesh.indices.size() == 16);
+        Mesh simplified = simplifyMesh(mesh, 4000.0);
+        REQUIRE(simplified.indices.size() == 14);
+        REQUIRE(simplified.positions.size() == 14);
+        REQUIRE(simplified.batchIDs.size() == 14);
+    }
+}
+
+TEST_CASE("Test appending instances attributes", "[CDBGeometryVectors]")
+{
+    CDBInstancesAttributes attributes;
+    attributes.getCNAMs().emplace_back("first");
+    attributes.getIntegerAttribs()["LPN"] = {5};
+    attributes.getOrCreateStringAttribs("FACC").emplace_back("AP030");
+
+    CDBInstancesAttributes otherAttributes;
+    otherAttributes.getCNAMs().emplace_back("second");
+    otherAttributes.getCNAMs().emplace_back("third");
+    otherAttributes.getDoubleAttribs()["WGP"] = {1.5, 2.5};
+    otherAttributes.getOrCreateStringAttribs("FACC").emplace_back("AQ040");
+    otherAttributes.getOrCreateStringAttribs("FACC").emplace_back("AQ040");
+
+    // the attributes missing on either side are filled with default values
+    attributes.appendInstances(otherAttributes);
+    REQUIRE(attributes.getInstancesCount() == 3);
+    REQUIRE(attributes.getCNAMs()[2] == "third");
+    REQUIRE(attributes.getIntegerAttribs().at("LPN") == std::vector<int>{5, 0, 0});
+    REQUIRE(attributes.getDoubleAttribs().at("WGP") == std::vector<double>{0.0, 1.5, 2.5});
+
+    const auto &FACC = attributes.getStringAttribs().at("FACC");
+    REQUIRE(FACC.size() == 3);
+    REQUIRE(FACC[0] == "AP030");
+    REQUIRE(FACC[1] == "AQ040");
+    REQUIRE(FACC.getStringPool() == attributes.getStringPool());
+}
+
+TEST_CASE("Test reading class-level attributes through the cache", "[CDBGeometryVectors]")
+{
+    std::filesystem::path CDBPath = dataPath / "HydrographyNetwork";
+    std::filesystem::path vectorFile = CDBPath / "Tiles" / "N32" / "W118" / "204_HydrographyNetwork" / "LC"
+                                       / "U0" / "N32W118_D204_S002_T005_LC06_U0_R0.dbf";
+    auto tile = CDBTile::createFromFile(vectorFile.stem().string());
+    REQUIRE(tile != std::nullopt);
+
+    // the class-level file is parsed once and shared by every tile asking for it
+    CDBClassesAttributesCache cache;
+    auto classesAttributes = cache.get(*tile, CDBPath);
+    REQUIRE(classesAttributes != nullptr);
+    REQUIRE(classesAttributes->getCNAMs().count("SA010000-SA010-000U30R24-0") == 1);
+    REQUIRE(cache.get(*tile, CDBPath) == classesAttributes);
+
+    auto vector = CDBGeometryVectors::createFromFile(vectorFile, CDBPath, nullptr, &cache);
+    REQUIRE(vector != std::nullopt);
+    auto uncachedVector = CDBGeometryVectors::createFromFile(vectorFile, CDBPath);
+    REQUIRE(uncachedVector != std::nullopt);
+
+    const auto &attributes = vector->getInstancesAttributes();
+    const auto &uncachedAttributes = uncachedVector->getInstancesAttributes();
+    REQUIRE(attributes.getIntegerAttribs() == uncachedAttributes.getIntegerAttribs());
+    REQUIRE(attributes.getDoubleAttribs() == uncachedAttributes.getDoubleAttribs());
+    REQUIRE(attributes.getStringAttribs().at("FACC").front() == "SA010");
+
+    // tiles without class-level file aren't cached as attributes
+    auto roadTile = CDBTile::createFromFile("N32W118_D201_S002_T003_LC05_U0_R0");
+    REQUIRE(roadTile != std::nullopt);
+    REQUIRE(cache.get(*roadTile, CDBPath) == nullptr);
+}
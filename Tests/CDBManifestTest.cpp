@@ -0,0 +1,110 @@
+#include "CDB.h"
+#include "CDBManifest.h"
+#include "Config.h"
+#include "catch2/catch.hpp"
+#include <chrono>
+#include <memory>
+
+using namespace CDBTo3DTiles;
+
+static void checkSameIndex(const CDBDatasetIndex &index, const CDBDatasetIndex &other)
+{
+    REQUIRE(index.getDirectories().size() == other.getDirectories().size());
+    for (size_t i = 0; i < index.getDirectories().size(); ++i) {
+        REQUIRE(index.getDirectories()[i].relativePath == other.getDirectories()[i].relativePath);
+        REQUIRE(index.getDirectories()[i].lastWriteTime == other.getDirectories()[i].lastWriteTime);
+    }
+
+    REQUIRE(index.getFiles().size() == other.getFiles().size());
+    for (size_t i = 0; i < index.getFiles().size(); ++i) {
+        REQUIRE(index.getFiles()[i].relativePath == other.getFiles()[i].relativePath);
+        REQUIRE(index.getFiles()[i].size == other.getFiles()[i].size);
+        REQUIRE(index.getFiles()[i].lastWriteTime == other.getFiles()[i].lastWriteTime);
+    }
+}
+
+TEST_CASE("Test manifest reuses directory listing of previous run", "[CDBManifest]")
+{
+    std::filesystem::path input = "CDBManifest";
+    std::filesystem::path manifestPath = "CDBManifest.bin";
+    std::filesystem::path elevationPath = "Tiles/N32/W119/001_Elevation";
+    std::filesystem::remove_all(input);
+    std::filesystem::create_directories(input / "Tiles/N32");
+    std::filesystem::copy(dataPath / "CombineTilesets/Tiles/N32/W119",
+                          input / "Tiles/N32/W119",
+                          std::filesystem::copy_options::recursive);
+
+    CDBManifest manifest(input);
+    REQUIRE_FALSE(manifest.read(manifestPath));
+    auto index = manifest.getIndex(elevationPath, 3);
+    REQUIRE(index->getFiles().size() == 16);
+    REQUIRE(manifest.getIndex(elevationPath, 3) == index);
+    REQUIRE(manifest.isModified());
+    manifest.write(manifestPath);
+
+    SECTION("Test unchanged CDB is read from manifest")
+    {
+        CDBManifest cachedManifest(input);
+        REQUIRE(cachedManifest.read(manifestPath));
+        checkSameIndex(*cachedManifest.getIndex(elevationPath, 3), *index);
+        REQUIRE_FALSE(cachedManifest.isModified());
+    }
+
+    SECTION("Test new tile invalidates manifest")
+    {
+        auto tilePath = input / elevationPath / "L02/U3/N32W119_D001_S001_T001_L02_U3_R4.tif";
+        std::filesystem::copy_file(input / elevationPath / "L02/U3/N32W119_D001_S001_T001_L02_U3_R3.tif",
+                                   tilePath);
+
+        // make sure the change is visible even on file systems with coarse timestamps
+        auto UREFPath = tilePath.parent_path();
+        std::filesystem::last_write_time(UREFPath,
+                                         std::filesystem::last_write_time(UREFPath) + std::chrono::hours(1));
+
+        CDBManifest cachedManifest(input);
+        REQUIRE(cachedManifest.read(manifestPath));
+        auto updatedIndex = cachedManifest.getIndex(elevationPath, 3);
+        REQUIRE(updatedIndex->getFiles().size() == 17);
+        REQUIRE(updatedIndex->isFileExist(std::filesystem::relative(tilePath, input)));
+        REQUIRE(cachedManifest.isModified());
+    }
+
+    SECTION("Test tile rewritten in place is found by the GeoCell fingerprint")
+    {
+        // rewriting a file touches neither its directory nor the directories above it, so only the
+        // directories are compared and the index is reused until the fingerprint stats the files
+        auto tileRelativePath = elevationPath / "L02/U3/N32W119_D001_S001_T001_L02_U3_R3.tif";
+        auto tilePath = input / tileRelativePath;
+        auto UREFTime = std::filesystem::last_write_time(tilePath.parent_path());
+        std::filesystem::resize_file(tilePath, std::filesystem::file_size(tilePath) + 16);
+        std::filesystem::last_write_time(tilePath,
+                                         std::filesystem::last_write_time(tilePath) + std::chrono::hours(1));
+        std::filesystem::last_write_time(tilePath.parent_path(), UREFTime);
+
+        auto cachedManifest = std::make_shared<CDBManifest>(input);
+        REQUIRE(cachedManifest->read(manifestPath));
+        checkSameIndex(*cachedManifest->getIndex(elevationPath, 3), *index);
+        REQUIRE_FALSE(cachedManifest->isModified());
+
+        CDB cdb(input, cachedManifest);
+        cdb.getGeoCellFingerprint(CDBGeoCell(32, -119));
+        auto updatedIndex = cachedManifest->getIndex(elevationPath, 3);
+        REQUIRE(updatedIndex->getFiles().size() == 16);
+        REQUIRE(cachedManifest->isModified());
+        for (const auto &file : updatedIndex->getFiles()) {
+            REQUIRE(file.size == std::filesystem::file_size(input / file.relativePath));
+        }
+    }
+
+    SECTION("Test corrupted manifest is ignored")
+    {
+        std::filesystem::resize_file(manifestPath, std::filesystem::file_size(manifestPath) / 2);
+
+        CDBManifest cachedManifest(input);
+        REQUIRE_FALSE(cachedManifest.read(manifestPath));
+        checkSameIndex(*cachedManifest.getIndex(elevationPath, 3), *index);
+    }
+
+    std::filesystem::remove_all(input);
+    std::filesystem::remove(manifestPath);
+}
@@ -3,6 +3,7 @@
 #include "Utility.h"
 #include "catch2/catch.hpp"
 #include "glm/glm.hpp"
+#include <type_traits>
 
 using namespace CDBTo3DTiles;
 using namespace Core;
@@ -701,3 +702,24 @@ TEST_CASE("Test retrieving GeoCell and Dataset from tile name", "[CDBTile]")
     CDBTile tile(geoCell, CDBDataset::Elevation, 1, 1, 0, 0, 0);
     REQUIRE(CDBTile::retrieveGeoCellDatasetFromTileName(tile) == "N32W118_D001_S001_T001");
 }
+
+TEST_CASE("Test CDBTile key", "[CDBTile]")
+{
+    static_assert(std::is_trivially_copyable_v<CDBTileKey>, "tile keys are copied into caches");
+
+    CDBGeoCell geoCell(32, -118);
+    CDBTile tile(geoCell, CDBDataset::Elevation, 1, 2, 3, 4, 5);
+    REQUIRE(tile.getFilename() == tile.getRelativePath().filename().string());
+    REQUIRE(tile.getFilename() == "N32W118_D001_S001_T002_L03_U4_R5");
+
+    // the key carries everything needed to recreate the tile
+    CDBTile keyTile(tile.getKey());
+    REQUIRE(keyTile == tile);
+    REQUIRE(keyTile.getRelativePath() == tile.getRelativePath());
+    REQUIRE(std::hash<CDBTileKey>()(keyTile.getKey()) == std::hash<CDBTileKey>()(tile.getKey()));
+    REQUIRE(std::hash<CDBTile>()(keyTile) == std::hash<CDBTileKey>()(tile.getKey()));
+
+    CDBTile otherTile(geoCell, CDBDataset::Elevation, 1, 2, 3, 4, 6);
+    REQUIRE(!(otherTile.getKey() == tile.getKey()));
+    REQUIRE(std::hash<CDBTileKey>()(otherTile.getKey()) != std::hash<CDBTileKey>()(tile.getKey()));
+}
@@ -140,3 +140,68 @@ TEST_CASE("Test get fit tile", "[CDBTileset]")
         REQUIRE(fitTile == nullptr);
     }
 }
+
+TEST_CASE("Test looking up tiles", "[CDBTileset]")
+{
+    CDBGeoCell geoCell(32, -118);
+    CDBTileset tileset;
+    CDBTile tile(geoCell, CDBDataset::Elevation, 1, 1, 3, 5, 2);
+    REQUIRE(tileset.insertTile(tile) != nullptr);
+
+    SECTION("Look up the inserted tile and its ancestors")
+    {
+        REQUIRE(tileset.getTile(-10, 0, 0) == tileset.getRoot());
+        REQUIRE(tileset.getTile(-1, 0, 0) != nullptr);
+        REQUIRE(*tileset.getTile(1, 1, 0) == CDBTile(geoCell, CDBDataset::Elevation, 1, 1, 1, 1, 0));
+        REQUIRE(*tileset.getTile(3, 5, 2) == tile);
+        REQUIRE(tileset.getTile(3, 5, 3) == nullptr);
+        REQUIRE(tileset.getTile(4, 10, 4) == nullptr);
+    }
+
+    SECTION("Insert a sibling below the existing ancestors")
+    {
+        const CDBTile *parent = tileset.getTile(2, 2, 1);
+        CDBTile sibling(geoCell, CDBDataset::Elevation, 1, 1, 3, 4, 3);
+        sibling.setCustomContentURI("sibling.b3dm");
+        CDBTile *inserted = tileset.insertTile(sibling);
+        REQUIRE(inserted == tileset.getTile(3, 4, 3));
+        REQUIRE(*inserted->getCustomContentURI() == "sibling.b3dm");
+        REQUIRE(parent->getChildren()[1] == inserted);
+        REQUIRE(parent->getChildren()[2] == tileset.getTile(3, 5, 2));
+
+        // inserting a tile again only updates its content
+        sibling.setCustomContentURI("updated.b3dm");
+        REQUIRE(tileset.insertTile(sibling) == inserted);
+        REQUIRE(*inserted->getCustomContentURI() == "updated.b3dm");
+    }
+
+    SECTION("Tiles keep their address when the tileset is moved")
+    {
+        const CDBTile *root = tileset.getRoot();
+        CDBTileset movedTileset = std::move(tileset);
+        REQUIRE(movedTileset.getRoot() == root);
+        REQUIRE(*movedTileset.getTile(3, 5, 2) == tile);
+    }
+}
+
+TEST_CASE("Test get fit tile on the edge between children", "[CDBTileset]")
+{
+    CDBGeoCell geoCell(32, -118);
+    CDBTileset tileset;
+    CDBTile east(geoCell, CDBDataset::Elevation, 1, 1, 1, 0, 1);
+    REQUIRE(tileset.insertTile(east) != nullptr);
+
+    // the point on the west edge of the only child belongs to it
+    Cartographic westEdge = east.getBoundRegion().getRectangle().computeCenter();
+    westEdge.longitude = east.getBoundRegion().getRectangle().getWest();
+    const CDBTile *fitTile = tileset.getFitTile(westEdge);
+    REQUIRE(fitTile != nullptr);
+    REQUIRE(*fitTile == east);
+
+    // the south west child is preferred when both children hold the point
+    CDBTile west(geoCell, CDBDataset::Elevation, 1, 1, 1, 0, 0);
+    REQUIRE(tileset.insertTile(west) != nullptr);
+    fitTile = tileset.getFitTile(westEdge);
+    REQUIRE(fitTile != nullptr);
+    REQUIRE(*fitTile == west);
+}
@@ -1,3 +1,4 @@
+#include "CDB.h"
 #include "CDBGeoCell.h"
 #include "CDBTile.h"
 #include "CDBTo3DTiles.h"
@@ -5,6 +6,7 @@
 #include "catch2/catch.hpp"
 #include "glm/glm.hpp"
 #include "nlohmann/json.hpp"
+#include <chrono>
 #include <fstream>
 
 using namespace CDBTo3DTiles;
@@ -407,3 +409,290 @@ TEST_CASE("Test combine multiple sets of tilesets", "[CombineTilesets]")
 
     std::filesystem::remove_all(output);
 }
+
+TEST_CASE("Test converter combines the same tilesets when converting in parallel", "[CombineTilesets]")
+{
+    std::filesystem::path input = dataPath / "CombineTilesets";
+    std::filesystem::path sequentialOutput = "CombineTilesetsSequential";
+    std::filesystem::path parallelOutput = "CombineTilesetsParallel";
+
+    Converter sequentialConverter(input, sequentialOutput);
+    sequentialConverter.combineDataset({"Elevation_1_1", "RoadNetwork_2_3", "GTModels_1_1"});
+    sequentialConverter.convert();
+
+    Converter parallelConverter(input, parallelOutput);
+    parallelConverter.combineDataset({"Elevation_1_1", "RoadNetwork_2_3", "GTModels_1_1"});
+    parallelConverter.setThreadCount(4);
+    parallelConverter.convert();
+
+    std::vector<std::string> tilesetNames = {"Elevation_1_1.json",
+                                             "GTModels_1_1.json",
+                                             "GTModels_2_1.json",
+                                             "RoadNetwork_2_3.json",
+                                             "tileset.json"};
+    for (const auto &tilesetName : tilesetNames) {
+        REQUIRE(std::filesystem::exists(sequentialOutput / tilesetName));
+        REQUIRE(std::filesystem::exists(parallelOutput / tilesetName));
+
+        std::ifstream sequentialFs(sequentialOutput / tilesetName);
+        std::ifstream parallelFs(parallelOutput / tilesetName);
+        REQUIRE(nlohmann::json::parse(sequentialFs) == nlohmann::json::parse(parallelFs));
+    }
+
+    std::filesystem::remove_all(sequentialOutput);
+    std::filesystem::remove_all(parallelOutput);
+}
+
+static void setLastWriteTime(const std::filesystem::path &path, std::filesystem::file_time_type time)
+{
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        std::filesystem::last_write_time(entry.path(), time);
+    }
+}
+
+static bool isLastWriteTime(const std::filesystem::path &path, std::filesystem::file_time_type time)
+{
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        if (entry.is_regular_file() && std::filesystem::last_write_time(entry.path()) != time) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+TEST_CASE("Test incremental conversion only converts GeoCells whose sources changed", "[CombineTilesets]")
+{
+    std::filesystem::path input = "CombineTilesetsIncrementalInput";
+    std::filesystem::path output = "CombineTilesetsIncremental";
+    std::filesystem::path fullOutput = "CombineTilesetsFull";
+    std::filesystem::remove_all(input);
+    std::filesystem::copy(dataPath / "CombineTilesets", input, std::filesystem::copy_options::recursive);
+
+    {
+        Converter converter(input, output);
+        converter.setIncremental(true);
+        converter.convert();
+    }
+
+    // mark the previous output as old, so that rewritten files can be told apart
+    auto previousTime = std::filesystem::last_write_time(output) - std::chrono::hours(24);
+    setLastWriteTime(output, previousTime);
+
+    SECTION("Test unchanged CDB keeps every GeoCell")
+    {
+        Converter converter(input, output);
+        converter.setIncremental(true);
+        converter.convert();
+
+        REQUIRE(isLastWriteTime(output / "Tiles", previousTime));
+        REQUIRE(std::filesystem::exists(output / "Elevation_1_1.json"));
+        REQUIRE(std::filesystem::exists(output / "GTModels_1_1.json"));
+    }
+
+    SECTION("Test changed tile converts its GeoCell again")
+    {
+        auto elevationTile = input / "Tiles/N32/W119/001_Elevation/L00/U0"
+                             / "N32W119_D001_S001_T001_L00_U0_R0.tif";
+        auto elevationTime = std::filesystem::last_write_time(elevationTile) + std::chrono::hours(1);
+        std::filesystem::last_write_time(elevationTile, elevationTime);
+
+        Converter converter(input, output);
+        converter.setIncremental(true);
+        converter.convert();
+
+        REQUIRE(isLastWriteTime(output / "Tiles/N32/W118", previousTime));
+        REQUIRE_FALSE(isLastWriteTime(output / "Tiles/N32/W119", previousTime));
+
+        Converter fullConverter(input, fullOutput);
+        fullConverter.convert();
+
+        std::vector<std::string> tilesetNames = {"Elevation_1_1.json",
+                                                 "GTModels_1_1.json",
+                                                 "GTModels_2_1.json",
+                                                 "RoadNetwork_2_3.json"};
+        for (const auto &tilesetName : tilesetNames) {
+            std::ifstream fullFs(fullOutput / tilesetName);
+            std::ifstream incrementalFs(output / tilesetName);
+            REQUIRE(nlohmann::json::parse(fullFs) == nlohmann::json::parse(incrementalFs));
+        }
+    }
+
+    SECTION("Test changed options convert everything again")
+    {
+        Converter converter(input, output);
+        converter.setIncremental(true);
+        converter.setGenerateElevationNormal(true);
+        converter.convert();
+
+        REQUIRE_FALSE(isLastWriteTime(output / "Tiles/N32/W118", previousTime));
+        REQUIRE_FALSE(isLastWriteTime(output / "Tiles/N32/W119", previousTime));
+    }
+
+    std::filesystem::remove_all(input);
+    std::filesystem::remove_all(output);
+    std::filesystem::remove_all(fullOutput);
+}
+
+TEST_CASE("Test sharded conversion merges into the same tilesets", "[CombineTilesets]")
+{
+    std::filesystem::path input = dataPath / "CombineTilesets";
+    std::filesystem::path output = "CombineTilesetsSharded";
+    std::filesystem::path fullOutput = "CombineTilesetsUnsharded";
+    std::vector<std::string> combinedDatasets = {"Elevation_1_1", "RoadNetwork_2_3", "GTModels_1_1"};
+
+    Converter fullConverter(input, fullOutput);
+    fullConverter.combineDataset(combinedDatasets);
+    fullConverter.convert();
+
+    std::vector<std::string> tilesetNames = {"Elevation_1_1.json",
+                                             "GTModels_1_1.json",
+                                             "GTModels_2_1.json",
+                                             "RoadNetwork_2_3.json",
+                                             "tileset.json"};
+
+    SECTION("Test hash shards")
+    {
+        for (size_t i = 0; i < 2; ++i) {
+            Converter converter(input, output);
+            converter.setShard(i, 2);
+            converter.convert();
+            auto shardManifest = "Shard_" + std::to_string(i) + "_of_2.json";
+            REQUIRE(std::filesystem::exists(output / "Shards" / shardManifest));
+        }
+
+        REQUIRE_FALSE(std::filesystem::exists(output / "tileset.json"));
+
+        Converter merger("", output);
+        merger.combineDataset(combinedDatasets);
+        merger.merge();
+        for (const auto &tilesetName : tilesetNames) {
+            std::ifstream fullFs(fullOutput / tilesetName);
+            std::ifstream mergedFs(output / tilesetName);
+            REQUIRE(nlohmann::json::parse(fullFs) == nlohmann::json::parse(mergedFs));
+        }
+    }
+
+    SECTION("Test GeoCell list shards")
+    {
+        for (const auto &geoCell : {"N32W118", "N32W119"}) {
+            Converter converter(input, output);
+            converter.setShardGeoCells({geoCell});
+            converter.convert();
+        }
+
+        Converter merger("", output);
+        merger.combineDataset(combinedDatasets);
+        merger.merge();
+        for (const auto &tilesetName : tilesetNames) {
+            std::ifstream fullFs(fullOutput / tilesetName);
+            std::ifstream mergedFs(output / tilesetName);
+            REQUIRE(nlohmann::json::parse(fullFs) == nlohmann::json::parse(mergedFs));
+        }
+    }
+
+    SECTION("Test missing shard is reported")
+    {
+        Converter converter(input, output);
+        converter.setShard(1, 2);
+        converter.convert();
+
+        Converter merger("", output);
+        REQUIRE_THROWS_AS(merger.merge(), std::runtime_error);
+    }
+
+    SECTION("Test unknown GeoCell is reported")
+    {
+        Converter converter(input, output);
+        converter.setShardGeoCells({"N10E010"});
+        REQUIRE_THROWS_AS(converter.convert(), std::invalid_argument);
+    }
+
+    SECTION("Test invalid shard index")
+    {
+        Converter converter(input, output);
+        REQUIRE_THROWS_AS(converter.setShard(2, 2), std::invalid_argument);
+    }
+
+    std::filesystem::remove_all(output);
+    std::filesystem::remove_all(fullOutput);
+}
+
+TEST_CASE("Test area of interest and level range skip the tiles outside of them", "[CombineTilesets]")
+{
+    std::filesystem::path input = dataPath / "CombineTilesets";
+    CDB cdb(input);
+    cdb.setAreaOfInterest(Core::GlobeRectangle(glm::radians(-117.9),
+                                               glm::radians(32.1),
+                                               glm::radians(-117.6),
+                                               glm::radians(32.4)));
+
+    std::vector<std::filesystem::path> geoCells;
+    cdb.forEachGeoCell([&](CDBGeoCell geoCell) { geoCells.emplace_back(geoCell.getRelativePath()); });
+    REQUIRE(geoCells == std::vector<std::filesystem::path>{CDBGeoCell(32, -118).getRelativePath()});
+
+    REQUIRE(cdb.isTileFileSelected("N32W118_D101_S002_T001_L00_U0_R0.dbf"));
+    REQUIRE(cdb.isTileFileSelected("N32W118_D101_S001_T001_LC09_U0_R0.dbf"));
+    REQUIRE(!cdb.isTileFileSelected("N32W118_D101_S002_T001_L01_U1_R1.dbf"));
+    REQUIRE(cdb.isTileFileSelected("N32W118_D101_S002_T001_L01_U0_R0.dbf"));
+    REQUIRE(cdb.isTileFileSelected("Unnamed.dbf"));
+
+    cdb.setLevelRange(-9, 0);
+    REQUIRE(cdb.isTileFileSelected("N32W118_D101_S002_T001_L00_U0_R0.dbf"));
+    REQUIRE(!cdb.isTileFileSelected("N32W118_D101_S002_T001_L01_U0_R0.dbf"));
+    REQUIRE(!cdb.isTileFileSelected("N32W118_D101_S001_T001_LC10_U0_R0.dbf"));
+    REQUIRE(!cdb.isElevationExist(CDBTile(CDBGeoCell(32, -119), CDBDataset::Elevation, 1, 1, 1, 1, 1)));
+}
+
+TEST_CASE("Test converter only converts the selected GeoCells and datasets", "[CombineTilesets]")
+{
+    std::filesystem::path input = dataPath / "CombineTilesets";
+    std::filesystem::path output = "CombineTilesetsFiltered";
+    Converter converter(input, output);
+
+    SECTION("Test bounding box")
+    {
+        converter.setBoundingBox(-118.9, 32.1, -118.1, 32.9);
+        converter.convert();
+        REQUIRE(std::filesystem::exists(output / "Tiles" / "N32" / "W119"));
+        REQUIRE(!std::filesystem::exists(output / "Tiles" / "N32" / "W118"));
+    }
+
+    SECTION("Test GeoCell list")
+    {
+        converter.setGeoCells({"N32W118"});
+        converter.convert();
+        REQUIRE(std::filesystem::exists(output / "Tiles" / "N32" / "W118"));
+        REQUIRE(!std::filesystem::exists(output / "Tiles" / "N32" / "W119"));
+    }
+
+    SECTION("Test datasets")
+    {
+        converter.setDatasets({"Elevation"});
+        converter.convert();
+        REQUIRE(std::filesystem::exists(output / "Elevation_1_1.json"));
+        REQUIRE(!std::filesystem::exists(output / "GTModels_1_1.json"));
+        REQUIRE(!std::filesystem::exists(output / "RoadNetwork_2_3.json"));
+    }
+
+    SECTION("Test level range")
+    {
+        converter.setLevelRange(-9, 1);
+        converter.convert();
+        std::filesystem::path elevationDir = output / "Tiles" / "N32" / "W119" / "Elevation" / "1_1";
+        REQUIRE(std::filesystem::exists(elevationDir / "N32W119_D001_S001_T001_L01_U1_R1.b3dm"));
+        REQUIRE(!std::filesystem::exists(elevationDir / "N32W119_D001_S001_T001_L02_U3_R3.b3dm"));
+        REQUIRE(!std::filesystem::exists(elevationDir / "N32W119_D001_S001_T001_LC10_U0_R0.b3dm"));
+    }
+
+    SECTION("Test invalid filters")
+    {
+        REQUIRE_THROWS_AS(converter.setDatasets({"Imagery"}), std::invalid_argument);
+        REQUIRE_THROWS_AS(converter.setBoundingBox(-118.0, 33.0, -117.0, 32.0), std::invalid_argument);
+        REQUIRE_THROWS_AS(converter.setBoundingBox(-181.0, 32.0, -117.0, 33.0), std::invalid_argument);
+        REQUIRE_THROWS_AS(converter.setLevelRange(2, 1), std::invalid_argument);
+        REQUIRE_THROWS_AS(converter.setLevelRange(-11, 1), std::invalid_argument);
+    }
+
+    std::filesystem::remove_all(output);
+}
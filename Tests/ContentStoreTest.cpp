@@ -0,0 +1,53 @@
+#include "ContentStore.h"
+#include "TestHelpers.h"
+#include "catch2/catch.hpp"
+#include <string>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test computing xxHash hashes", "[ContentStore]")
+{
+    REQUIRE(computeXXH64(nullptr, 0) == 0xef46db3751d8e999ull);
+
+    auto bytes = toBytes("abc");
+    REQUIRE(computeXXH64(bytes.data(), bytes.size()) == 0x44bc2cf5ad770999ull);
+
+    // longer than a stripe of 32 bytes, with a tail of 8, 4 and single bytes
+    bytes = toBytes("Nobody inspects the spammish repetition");
+    REQUIRE(computeXXH64(bytes.data(), bytes.size()) == 0xfbcea83c8a378bf1ull);
+
+    bytes.clear();
+    for (unsigned char i = 0; i < 100; ++i) {
+        bytes.emplace_back(i);
+    }
+
+    REQUIRE(computeXXH64(bytes.data(), bytes.size()) == 0x6ac1e58032166597ull);
+}
+
+TEST_CASE("Test content store writes each content once", "[ContentStore]")
+{
+    std::filesystem::path output = "ContentStore";
+    std::filesystem::remove_all(output);
+
+    DirectoryOutputSink sink;
+    ContentStore store(sink, output / "Content");
+    REQUIRE(std::filesystem::is_directory(output / "Content"));
+
+    bool isWritten;
+    auto path = store.store(toBytes("glb"), ".glb", isWritten);
+    REQUIRE(isWritten);
+    REQUIRE(path.parent_path() == output / "Content");
+    REQUIRE(path.extension() == ".glb");
+    REQUIRE(readFile(path) == "glb");
+
+    auto samePath = store.store(toBytes("glb"), ".glb", isWritten);
+    REQUIRE(!isWritten);
+    REQUIRE(samePath == path);
+
+    auto otherPath = store.store(toBytes("png"), ".png", isWritten);
+    REQUIRE(isWritten);
+    REQUIRE(otherPath != path);
+    REQUIRE(readFile(otherPath) == "png");
+
+    std::filesystem::remove_all(output);
+}
@@ -0,0 +1,115 @@
+#include "ConversionProgress.h"
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test progress counts the tiles of every dataset", "[ConversionProgress]")
+{
+    SECTION("Tiles are counted per dataset and in total")
+    {
+        ConversionProgressTracker tracker([](const ConversionProgress &) {}, std::chrono::milliseconds(1000));
+        tracker.setTotalGeoCells(2);
+        tracker.addTotalTiles(CDBDataset::Elevation, 4);
+        tracker.addTotalTiles(CDBDataset::RoadNetwork, 6);
+        tracker.addTileDone(CDBDataset::Elevation);
+        tracker.addTileDone(CDBDataset::RoadNetwork);
+        tracker.addTileDone(CDBDataset::RoadNetwork);
+        tracker.addGeoCellDone();
+        tracker.addBytesWritten(100);
+        tracker.addBytesWritten(20);
+
+        auto progress = tracker.getProgress();
+        REQUIRE(progress.tilesDone == 3);
+        REQUIRE(progress.tilesTotal == 10);
+        REQUIRE(progress.geoCellsDone == 1);
+        REQUIRE(progress.geoCellsTotal == 2);
+        REQUIRE(progress.bytesWritten == 120);
+        REQUIRE(progress.datasets.size() == 2);
+        REQUIRE(progress.datasets[0].name == "001_Elevation");
+        REQUIRE(progress.datasets[0].tilesDone == 1);
+        REQUIRE(progress.datasets[0].tilesTotal == 4);
+        REQUIRE(progress.datasets[1].name == "201_RoadNetwork");
+        REQUIRE(progress.datasets[1].tilesDone == 2);
+        REQUIRE(progress.datasets[1].tilesTotal == 6);
+        REQUIRE(progress.remainingSeconds);
+        REQUIRE(*progress.remainingSeconds >= 0.0);
+    }
+
+    SECTION("Time left is unknown until a tile is done")
+    {
+        ConversionProgressTracker tracker([](const ConversionProgress &) {}, std::chrono::milliseconds(1000));
+        tracker.addTotalTiles(CDBDataset::GTFeature, 5);
+        REQUIRE(!tracker.getProgress().remainingSeconds);
+    }
+
+    SECTION("Removed tiles are not left to convert")
+    {
+        ConversionProgressTracker tracker([](const ConversionProgress &) {}, std::chrono::milliseconds(1000));
+        tracker.addTotalTiles(CDBDataset::GSFeature, 5);
+        tracker.removeTotalTiles(CDBDataset::GSFeature, 3);
+        tracker.addTileDone(CDBDataset::GSFeature);
+        tracker.addTileDone(CDBDataset::GSFeature);
+
+        auto progress = tracker.getProgress();
+        REQUIRE(progress.tilesDone == 2);
+        REQUIRE(progress.tilesTotal == 2);
+        REQUIRE(*progress.remainingSeconds == Approx(0.0));
+
+        tracker.removeTotalTiles(CDBDataset::GSFeature, 10);
+        REQUIRE(tracker.getProgress().tilesTotal == 0);
+    }
+}
+
+TEST_CASE("Test progress is reported until it is stopped", "[ConversionProgress]")
+{
+    std::atomic<int> reports{0};
+    uint64_t lastTilesDone = 0;
+    ConversionProgressTracker tracker(
+        [&](const ConversionProgress &progress) {
+            lastTilesDone = progress.tilesDone;
+            ++reports;
+        },
+        std::chrono::milliseconds(1));
+
+    tracker.addTotalTiles(CDBDataset::Elevation, 1);
+    tracker.start();
+    while (reports == 0) {
+        std::this_thread::yield();
+    }
+
+    tracker.addTileDone(CDBDataset::Elevation);
+    tracker.stop();
+
+    // the last report comes after the reporter is stopped, so it has every tile
+    int stoppedReports = reports;
+    REQUIRE(lastTilesDone == 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(reports == stoppedReports);
+}
+
+TEST_CASE("Test progress reports are cancelled when their scope is left", "[ConversionProgress]")
+{
+    std::atomic<int> reports{0};
+    ConversionProgressTracker tracker([&](const ConversionProgress &) { ++reports; },
+                                      std::chrono::milliseconds(1));
+
+    auto convert = [&]() {
+        ScopedProgressCancel progressCancel(&tracker);
+        tracker.start();
+        while (reports == 0) {
+            std::this_thread::yield();
+        }
+
+        throw std::runtime_error("conversion failed");
+    };
+
+    REQUIRE_THROWS_AS(convert(), std::runtime_error);
+
+    // no last report is made for a cancelled conversion
+    int cancelledReports = reports;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(reports == cancelledReports);
+}
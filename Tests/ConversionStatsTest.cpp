@@ -0,0 +1,79 @@
+#include "ConversionStats.h"
+#include "catch2/catch.hpp"
+#include "nlohmann/json.hpp"
+#include <sstream>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test phase timer records a phase of a dataset", "[ConversionStats]")
+{
+    CDBGeoCell geoCell(32, -118);
+
+    SECTION("Timer records its scope")
+    {
+        ConversionStats stats;
+        {
+            ScopedPhaseTimer timer(&stats, geoCell, CDBDataset::Elevation, ConversionPhase::Decode);
+        }
+
+        auto dataset = stats.getDataset(geoCell, CDBDataset::Elevation);
+        const auto &phase = dataset.phases[static_cast<size_t>(ConversionPhase::Decode)];
+        REQUIRE(phase.count == 1);
+        REQUIRE(phase.wallSeconds >= 0.0);
+        REQUIRE(phase.CPUSeconds >= 0.0);
+        REQUIRE(dataset.phases[static_cast<size_t>(ConversionPhase::TileWrite)].count == 0);
+    }
+
+    SECTION("Stopped timer records once")
+    {
+        ConversionStats stats;
+        CDBTile tile(geoCell, CDBDataset::GTFeature, 1, 1, 0, 0, 0);
+        {
+            ScopedPhaseTimer timer(&stats, tile, ConversionPhase::GltfBuild);
+            timer.stop();
+            timer.stop();
+        }
+
+        auto dataset = stats.getDataset(geoCell, CDBDataset::GTFeature);
+        REQUIRE(dataset.phases[static_cast<size_t>(ConversionPhase::GltfBuild)].count == 1);
+    }
+
+    SECTION("Timer without stats does nothing")
+    {
+        ScopedPhaseTimer timer(nullptr, geoCell, CDBDataset::Elevation, ConversionPhase::Decode);
+        timer.stop();
+    }
+}
+
+TEST_CASE("Test stats report tiles and bytes per GeoCell and dataset", "[ConversionStats]")
+{
+    CDBGeoCell geoCell(32, -118);
+    ConversionStats stats;
+    stats.addTile(geoCell, CDBDataset::Elevation, 100);
+    stats.addTile(geoCell, CDBDataset::Elevation, 50);
+    stats.addBytesIn(geoCell, CDBDataset::Elevation, 1000);
+    stats.addBytesOut(geoCell, CDBDataset::Elevation, 10);
+    stats.addTile(geoCell, CDBDataset::RoadNetwork, 20);
+    stats.addDatasetTime(geoCell, CDBDataset::Elevation, 2.0);
+    stats.addGeoCellTime(geoCell, 3.0);
+
+    auto elevation = stats.getDataset(geoCell, CDBDataset::Elevation);
+    REQUIRE(elevation.tiles == 2);
+    REQUIRE(elevation.bytesIn == 1000);
+    REQUIRE(elevation.bytesOut == 160);
+    REQUIRE(elevation.wallSeconds == Approx(2.0));
+
+    std::stringstream ss;
+    stats.writeJson(ss);
+    auto json = nlohmann::json::parse(ss.str());
+    REQUIRE(json["tiles"] == 3);
+    REQUIRE(json["bytesIn"] == 1000);
+    REQUIRE(json["bytesOut"] == 180);
+    REQUIRE(json.contains("peakResidentBytes"));
+
+    const auto &geoCellJson = json["geoCells"]["N32W118"];
+    REQUIRE(geoCellJson["wallSeconds"].get<double>() == Approx(3.0));
+    REQUIRE(geoCellJson["datasets"]["001_Elevation"]["tiles"] == 2);
+    REQUIRE(geoCellJson["datasets"]["001_Elevation"]["tilesPerSecond"].get<double>() == Approx(1.0));
+    REQUIRE(geoCellJson["datasets"]["201_RoadNetwork"]["bytesOut"] == 20);
+}
@@ -0,0 +1,96 @@
+#include "ConversionStats.h"
+#include "ConversionTrace.h"
+#include "catch2/catch.hpp"
+#include "nlohmann/json.hpp"
+#include <sstream>
+#include <thread>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test trace records events of every thread", "[ConversionTrace]")
+{
+    CDBGeoCell geoCell(32, -118);
+    CDBTile tile(geoCell, CDBDataset::Elevation, 1, 1, 0, 0, 0);
+
+    SECTION("Scoped events are written as complete events")
+    {
+        ConversionTrace trace;
+        {
+            ScopedTraceEvent mainEvent(&trace, "elevationTile", tile);
+        }
+
+        std::thread worker([&]() {
+            ScopedTraceEvent workerEvent(&trace, "dataset", geoCell, CDBDataset::RoadNetwork);
+        });
+        worker.join();
+
+        REQUIRE(trace.getEventCount() == 2);
+
+        std::stringstream ss;
+        trace.writeJson(ss);
+        auto json = nlohmann::json::parse(ss.str());
+        const auto &events = json["traceEvents"];
+
+        std::vector<nlohmann::json> completeEvents;
+        for (const auto &event : events) {
+            if (event["ph"] == "X") {
+                completeEvents.emplace_back(event);
+            }
+        }
+
+        REQUIRE(completeEvents.size() == 2);
+        REQUIRE(completeEvents[0]["name"] == "elevationTile");
+        REQUIRE(completeEvents[0]["cat"] == "job");
+        REQUIRE(completeEvents[0]["args"]["geoCell"] == "N32W118");
+        REQUIRE(completeEvents[0]["args"]["dataset"] == "001_Elevation");
+        REQUIRE(completeEvents[0]["args"]["tile"] == tile.getFilename());
+        REQUIRE(completeEvents[0]["dur"].get<double>() >= 0.0);
+        REQUIRE(completeEvents[1]["name"] == "dataset");
+        REQUIRE(!completeEvents[1]["args"].contains("tile"));
+        REQUIRE(completeEvents[0]["tid"] != completeEvents[1]["tid"]);
+    }
+
+    SECTION("Full buffer keeps the newest events")
+    {
+        ConversionTrace trace(2);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 3; ++i) {
+            auto begin = start + std::chrono::microseconds(i);
+            trace.addEvent("phase", "test", geoCell, CDBDataset::Elevation, begin, begin);
+        }
+
+        REQUIRE(trace.getEventCount() == 2);
+
+        std::stringstream ss;
+        trace.writeJson(ss);
+        auto json = nlohmann::json::parse(ss.str());
+        std::vector<double> timestamps;
+        for (const auto &event : json["traceEvents"]) {
+            if (event["ph"] == "X") {
+                timestamps.emplace_back(event["ts"].get<double>());
+            }
+        }
+
+        REQUIRE(timestamps.size() == 2);
+        REQUIRE(timestamps[1] - timestamps[0] == Approx(1.0));
+    }
+
+    SECTION("Phases of stats are traced")
+    {
+        auto trace = std::make_shared<ConversionTrace>();
+        ConversionStats stats(trace);
+        {
+            ScopedPhaseTimer timer(&stats, tile, ConversionPhase::GltfBuild);
+        }
+
+        REQUIRE(trace->getEventCount() == 1);
+        auto dataset = stats.getDataset(geoCell, CDBDataset::Elevation);
+        REQUIRE(dataset.phases[static_cast<size_t>(ConversionPhase::GltfBuild)].count == 1);
+    }
+
+    SECTION("Events without trace do nothing")
+    {
+        ScopedTraceEvent event(nullptr, "elevationTile", tile);
+        event.stop();
+    }
+}
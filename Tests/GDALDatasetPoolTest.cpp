@@ -0,0 +1,110 @@
+#include "GDALDatasetPool.h"
+#include "Config.h"
+#include "catch2/catch.hpp"
+#include "cpl_conv.h"
+#include <string>
+
+using namespace CDBTo3DTiles;
+
+static const std::filesystem::path elevationPath = dataPath / "ElevationMoreLODPositiveImagery" / "Tiles" / "N32"
+                                                   / "W118" / "001_Elevation";
+
+TEST_CASE("Test reusing released datasets", "[GDALDatasetPool]")
+{
+    auto firstTile = elevationPath / "L02" / "U3" / "N32W118_D001_S001_T001_L02_U3_R2.tif";
+    auto secondTile = elevationPath / "L02" / "U3" / "N32W118_D001_S001_T001_L02_U3_R3.tif";
+    GDALDatasetPool pool(1);
+
+    GDALDataset *firstDataset = nullptr;
+    {
+        auto dataset = pool.openRaster(firstTile);
+        REQUIRE(dataset != nullptr);
+        firstDataset = dataset.get();
+
+        // a file read by two threads at once gets a handle for each
+        auto concurrentDataset = pool.openRaster(firstTile);
+        REQUIRE(concurrentDataset != nullptr);
+        REQUIRE(concurrentDataset.get() != firstDataset);
+    }
+
+    // only one of the two handles stays open
+    auto statistics = pool.getStatistics();
+    REQUIRE(statistics.hits == 0);
+    REQUIRE(statistics.misses == 2);
+    REQUIRE(statistics.evictions == 1);
+
+    {
+        auto dataset = pool.openRaster(firstTile);
+        REQUIRE(dataset != nullptr);
+        REQUIRE(dataset->GetRasterXSize() > 0);
+    }
+
+    {
+        auto dataset = pool.openRaster(secondTile);
+        REQUIRE(dataset != nullptr);
+    }
+
+    statistics = pool.getStatistics();
+    REQUIRE(statistics.hits == 1);
+    REQUIRE(statistics.misses == 3);
+    REQUIRE(statistics.evictions == 2);
+}
+
+TEST_CASE("Test opening datasets without a pool", "[GDALDatasetPool]")
+{
+    auto tile = elevationPath / "L00" / "U0" / "N32W118_D001_S001_T001_L00_U0_R0.tif";
+    REQUIRE(openRasterDataset(tile, nullptr) != nullptr);
+    REQUIRE(openRasterDataset(elevationPath / "missing.tif", nullptr) == nullptr);
+
+    GDALDatasetPool pool;
+    REQUIRE(openRasterDataset(tile, &pool) != nullptr);
+    REQUIRE(openRasterDataset(tile, &pool) != nullptr);
+    REQUIRE(openRasterDataset(elevationPath / "missing.tif", &pool) == nullptr);
+
+    // nothing is kept open with a capacity of 0
+    auto statistics = pool.getStatistics();
+    REQUIRE(statistics.hits == 0);
+    REQUIRE(statistics.misses == 3);
+    REQUIRE(statistics.evictions == 0);
+}
+
+TEST_CASE("Test GDAL settings are restored when they leave their scope", "[GDALDatasetPool]")
+{
+    GIntBig cacheMemory = GDALGetCacheMax64();
+    CPLSetConfigOption("GDAL_NUM_THREADS", nullptr);
+
+    SECTION("Settings are restored")
+    {
+        {
+            ScopedGDALSettings settings(cacheMemory + 1024 * 1024, 4);
+            REQUIRE(GDALGetCacheMax64() == cacheMemory + 1024 * 1024);
+            REQUIRE(std::string(CPLGetConfigOption("GDAL_NUM_THREADS", "")) == "4");
+        }
+
+        REQUIRE(GDALGetCacheMax64() == cacheMemory);
+        REQUIRE(CPLGetConfigOption("GDAL_NUM_THREADS", nullptr) == nullptr);
+    }
+
+    SECTION("Settings are restored to the previous thread count")
+    {
+        CPLSetConfigOption("GDAL_NUM_THREADS", "2");
+        {
+            ScopedGDALSettings settings(0, 4);
+            REQUIRE(std::string(CPLGetConfigOption("GDAL_NUM_THREADS", "")) == "4");
+        }
+
+        REQUIRE(std::string(CPLGetConfigOption("GDAL_NUM_THREADS", "")) == "2");
+        CPLSetConfigOption("GDAL_NUM_THREADS", nullptr);
+    }
+
+    SECTION("Settings of 0 are left alone")
+    {
+        {
+            ScopedGDALSettings settings(0, 0);
+            REQUIRE(GDALGetCacheMax64() == cacheMemory);
+            REQUIRE(CPLGetConfigOption("GDAL_NUM_THREADS", nullptr) == nullptr);
+        }
+
+        REQUIRE(GDALGetCacheMax64() == cacheMemory);
+    }
+}
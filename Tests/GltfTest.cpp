@@ -1,5 +1,9 @@
 #include "Gltf.h"
 #include "catch2/catch.hpp"
+#include "draco/compression/decode.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <sstream>
 
 using namespace CDBTo3DTiles;
 
@@ -18,6 +22,30 @@ static Mesh createTriangleMesh()
     return mesh;
 }
 
+static std::vector<std::vector<double>> getTrianglePositions(const Mesh &mesh)
+{
+    // every triangle starts from its smallest vertex, so triangles compare regardless of their first vertex
+    std::vector<std::vector<double>> triangles;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        std::vector<std::vector<double>> vertices;
+        for (size_t j = 0; j < 3; ++j) {
+            const auto &position = mesh.positions[mesh.indices[i + j]];
+            vertices.push_back({position.x, position.y, position.z});
+        }
+
+        std::rotate(vertices.begin(), std::min_element(vertices.begin(), vertices.end()), vertices.end());
+        std::vector<double> triangle;
+        for (const auto &vertex : vertices) {
+            triangle.insert(triangle.end(), vertex.begin(), vertex.end());
+        }
+
+        triangles.emplace_back(triangle);
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
 static double calculateMaterialRoughness(const Material &material)
 {
     glm::vec3 specularColor = material.specular;
@@ -171,6 +199,28 @@ TEST_CASE("Test creating Gltf with one mesh", "[Gltf]")
         REQUIRE(modelImage.uri == "textureURI");
     }
 
+    SECTION("Test with KTX2 texture")
+    {
+        Mesh triangleMesh = createTriangleMesh();
+
+        Material material;
+        material.texture = 0;
+
+        Texture texture;
+        texture.uri = "Textures/texture.ktx2";
+
+        tinygltf::Model model = createGltf(triangleMesh, &material, &texture);
+        REQUIRE(model.extensionsRequired == std::vector<std::string>{"KHR_texture_basisu"});
+
+        const auto &modelTexture = model.textures.front();
+        REQUIRE(modelTexture.source == -1);
+        REQUIRE(modelTexture.extensions.at("KHR_texture_basisu").Get("source").Get<int>() == 0);
+
+        const auto &modelImage = model.images.front();
+        REQUIRE(modelImage.uri == "Textures/texture.ktx2");
+        REQUIRE(modelImage.mimeType == "image/ktx2");
+    }
+
     SECTION("Test unlit material")
     {
         Mesh triangleMesh = createTriangleMesh();
@@ -318,3 +368,235 @@ TEST_CASE("Test converting multiple meshes to gltf", "[Gltf]")
     const auto &modelImage = modelImages.front();
     REQUIRE(modelImage.uri == "textureURI");
 }
+
+TEST_CASE("Test referencing mesh data with buffer segments", "[Gltf]")
+{
+    Mesh triangleMesh = createTriangleMesh();
+    triangleMesh.indices = {0, 1, 2};
+    triangleMesh.UVs = {glm::vec2(0.0f), glm::vec2(0.5f), glm::vec2(1.0f)};
+
+    std::vector<GltfBufferSegment> bufferSegments;
+    tinygltf::Model model = createGltf(triangleMesh, nullptr, nullptr, &bufferSegments);
+    tinygltf::Model copiedModel = createGltf(triangleMesh, nullptr, nullptr);
+
+    SECTION("Segments point to the mesh data in the same order as the buffer views")
+    {
+        REQUIRE(model.buffers.size() == 1);
+        REQUIRE(model.buffers.front().data.empty());
+        REQUIRE(bufferSegments.size() == 4);
+        REQUIRE(bufferSegments[0].data == triangleMesh.indices.data());
+        REQUIRE(bufferSegments[1].data == triangleMesh.positionRTCs.data());
+        REQUIRE(bufferSegments[2].data == triangleMesh.normals.data());
+        REQUIRE(bufferSegments[3].data == triangleMesh.UVs.data());
+
+        REQUIRE(model.bufferViews.size() == copiedModel.bufferViews.size());
+        for (size_t i = 0; i < model.bufferViews.size(); ++i) {
+            REQUIRE(model.bufferViews[i].byteOffset == copiedModel.bufferViews[i].byteOffset);
+            REQUIRE(model.bufferViews[i].byteLength == bufferSegments[i].byteLength);
+        }
+    }
+
+    SECTION("Glb written from segments matches the copied buffer")
+    {
+        std::string glbJson = createGlbJson(&model, bufferSegments);
+        std::stringstream ss;
+        writeToGlb(glbJson, bufferSegments, ss);
+
+        std::string glb = ss.str();
+        REQUIRE(glb.size() == computeGlbByteLength(glbJson, bufferSegments));
+        REQUIRE(glb.size() % 4 == 0);
+
+        tinygltf::TinyGLTF loader;
+        tinygltf::Model loadedModel;
+        std::string error;
+        std::string warning;
+        REQUIRE(loader.LoadBinaryFromMemory(&loadedModel,
+                                            &error,
+                                            &warning,
+                                            reinterpret_cast<const unsigned char *>(glb.data()),
+                                            static_cast<unsigned>(glb.size())));
+        REQUIRE(loadedModel.buffers.size() == 1);
+        REQUIRE(loadedModel.buffers.front().data == copiedModel.buffers.front().data);
+        REQUIRE(loadedModel.accessors.size() == copiedModel.accessors.size());
+        REQUIRE(loadedModel.meshes.size() == 1);
+    }
+}
+
+TEST_CASE("Test optimizing mesh for rendering", "[Gltf]")
+{
+    // a quad and a vertex that no triangle uses
+    Mesh mesh;
+    mesh.aabb = AABB();
+    mesh.positions = {glm::dvec3(0.0, 0.0, 0.0),
+                      glm::dvec3(1.0, 0.0, 0.0),
+                      glm::dvec3(5.0, 5.0, 5.0),
+                      glm::dvec3(1.0, 1.0, 0.0),
+                      glm::dvec3(0.0, 1.0, 0.0)};
+    for (const auto &position : mesh.positions) {
+        mesh.aabb->merge(position);
+        mesh.positionRTCs.emplace_back(static_cast<glm::vec3>(position));
+        mesh.UVs.emplace_back(static_cast<float>(position.x), static_cast<float>(position.y));
+        mesh.batchIDs.emplace_back(static_cast<float>(position.x + 2.0 * position.y));
+    }
+
+    mesh.indices = {0, 1, 3, 0, 3, 4};
+    auto triangles = getTrianglePositions(mesh);
+
+    optimizeMeshForRendering(mesh);
+    REQUIRE(mesh.indices.size() == 6);
+    REQUIRE(mesh.positions.size() == 4);
+    REQUIRE(mesh.positionRTCs.size() == 4);
+    REQUIRE(mesh.UVs.size() == 4);
+    REQUIRE(mesh.batchIDs.size() == 4);
+    REQUIRE(getTrianglePositions(mesh) == triangles);
+
+    // the attributes of a vertex are moved together
+    for (size_t i = 0; i < mesh.positions.size(); ++i) {
+        REQUIRE(mesh.positions[i] != glm::dvec3(5.0, 5.0, 5.0));
+        REQUIRE(glm::dvec3(mesh.positionRTCs[i]) == mesh.positions[i]);
+        REQUIRE(mesh.UVs[i] == glm::vec2(mesh.positions[i]));
+        REQUIRE(mesh.batchIDs[i] == Approx(mesh.positions[i].x + 2.0 * mesh.positions[i].y));
+    }
+}
+
+TEST_CASE("Test quantizing and compressing mesh attributes", "[Gltf]")
+{
+    Mesh triangleMesh = createTriangleMesh();
+    triangleMesh.indices = {0, 1, 2};
+    triangleMesh.UVs = {glm::vec2(0.0f), glm::vec2(0.5f), glm::vec2(1.0f)};
+
+    GltfEncoding encoding;
+    encoding.quantizeAttributes = true;
+
+    SECTION("Quantized attributes use integer types")
+    {
+        tinygltf::Model model = createGltf(triangleMesh, nullptr, nullptr, nullptr, encoding);
+        REQUIRE(model.extensionsRequired == std::vector<std::string>{"KHR_mesh_quantization"});
+
+        const auto &primitive = model.meshes.front().primitives.front();
+        const auto &indices = model.accessors[static_cast<size_t>(primitive.indices)];
+        REQUIRE(indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+
+        const auto &positions = model.accessors[static_cast<size_t>(primitive.attributes.at("POSITION"))];
+        REQUIRE(positions.componentType == TINYGLTF_COMPONENT_TYPE_SHORT);
+        REQUIRE(model.bufferViews[static_cast<size_t>(positions.bufferView)].byteStride == 8);
+        REQUIRE(positions.maxValues[0] == 32767.0);
+        REQUIRE(positions.minValues[0] == -32767.0);
+
+        const auto &normals = model.accessors[static_cast<size_t>(primitive.attributes.at("NORMAL"))];
+        REQUIRE(normals.componentType == TINYGLTF_COMPONENT_TYPE_BYTE);
+        REQUIRE(normals.normalized);
+
+        const auto &UVs = model.accessors[static_cast<size_t>(primitive.attributes.at("TEXCOORD_0"))];
+        REQUIRE(UVs.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+        REQUIRE(UVs.normalized);
+
+        // the mesh node scales the positions back
+        const auto &meshNode = model.nodes[1];
+        REQUIRE(meshNode.scale.size() == 3);
+        REQUIRE(meshNode.scale[0] == Approx(0.5 / 32767.0));
+        REQUIRE(meshNode.scale[0] == meshNode.scale[1]);
+        REQUIRE(meshNode.scale[0] == meshNode.scale[2]);
+
+        // every buffer view stays aligned on 4 bytes
+        for (const auto &bufferView : model.bufferViews) {
+            REQUIRE(bufferView.byteOffset % 4 == 0);
+        }
+    }
+
+    SECTION("UVs outside of the texture stay float")
+    {
+        triangleMesh.UVs.back() = glm::vec2(2.0f);
+        tinygltf::Model model = createGltf(triangleMesh, nullptr, nullptr, nullptr, encoding);
+        const auto &primitive = model.meshes.front().primitives.front();
+        const auto &UVs = model.accessors[static_cast<size_t>(primitive.attributes.at("TEXCOORD_0"))];
+        REQUIRE(UVs.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+        REQUIRE(!UVs.normalized);
+    }
+
+    SECTION("Compressed buffer views are decoded from a fallback buffer")
+    {
+        encoding.meshoptCompression = true;
+        std::vector<GltfBufferSegment> bufferSegments;
+        tinygltf::Model model = createGltf(triangleMesh, nullptr, nullptr, &bufferSegments, encoding);
+        REQUIRE(bufferSegments.size() == 4);
+        for (const auto &segment : bufferSegments) {
+            REQUIRE(segment.meshoptCompression);
+            REQUIRE(segment.storage);
+            REQUIRE(segment.byteLength % 4 == 0);
+        }
+
+        REQUIRE(bufferSegments[0].meshoptCompression->mode == "TRIANGLES");
+        REQUIRE(bufferSegments[0].meshoptCompression->byteStride == 2);
+        REQUIRE(bufferSegments[1].meshoptCompression->mode == "ATTRIBUTES");
+        REQUIRE(bufferSegments[1].meshoptCompression->byteStride == 8);
+        REQUIRE(bufferSegments[1].meshoptCompression->byteLength == 24);
+
+        auto gltfJson = nlohmann::json::parse(createGlbJson(&model, bufferSegments));
+        REQUIRE(gltfJson["buffers"].size() == 2);
+        REQUIRE(gltfJson["buffers"][1]["extensions"]["EXT_meshopt_compression"]["fallback"] == true);
+        REQUIRE(gltfJson["extensionsRequired"].size() == 2);
+
+        const auto &positions = gltfJson["bufferViews"][1];
+        REQUIRE(positions["buffer"] == 1);
+        REQUIRE(positions["byteLength"] == 24);
+        REQUIRE(positions["byteStride"] == 8);
+
+        const auto &extension = positions["extensions"]["EXT_meshopt_compression"];
+        REQUIRE(extension["buffer"] == 0);
+        REQUIRE(extension["count"] == 3);
+        REQUIRE(extension["byteLength"] == model.bufferViews[1].byteLength);
+    }
+}
+
+TEST_CASE("Test compressing mesh with Draco", "[Gltf]")
+{
+    Mesh triangleMesh = createTriangleMesh();
+    triangleMesh.indices = {0, 1, 2};
+    triangleMesh.UVs = {glm::vec2(0.0f), glm::vec2(0.5f), glm::vec2(1.0f)};
+    triangleMesh.batchIDs = {0.0f, 1.0f, 2.0f};
+
+    GltfEncoding encoding;
+    encoding.dracoCompression = true;
+    std::vector<GltfBufferSegment> bufferSegments;
+    tinygltf::Model model = createGltf(triangleMesh, nullptr, nullptr, &bufferSegments, encoding);
+    REQUIRE(model.extensionsRequired == std::vector<std::string>{"KHR_draco_mesh_compression"});
+
+    // the accessors only describe the decoded data
+    const auto &primitive = model.meshes.front().primitives.front();
+    REQUIRE(primitive.attributes.size() == 4);
+    REQUIRE(model.accessors.size() == 5);
+    for (const auto &accessor : model.accessors) {
+        REQUIRE(accessor.bufferView == -1);
+    }
+
+    const auto &indices = model.accessors[static_cast<size_t>(primitive.indices)];
+    REQUIRE(indices.count == 3);
+    REQUIRE(indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+
+    const auto &dracoExtension = primitive.extensions.at("KHR_draco_mesh_compression");
+    REQUIRE(dracoExtension.Get("bufferView").Get<int>() == 0);
+    REQUIRE(dracoExtension.Get("attributes").Keys().size() == 4);
+
+    // the only buffer view holds the Draco mesh
+    REQUIRE(model.bufferViews.size() == 1);
+    REQUIRE(bufferSegments.size() == 1);
+    REQUIRE(bufferSegments.front().storage);
+
+    draco::DecoderBuffer decoderBuffer;
+    const auto *encoded = static_cast<const char *>(bufferSegments.front().data);
+    decoderBuffer.Init(encoded, model.bufferViews.front().byteLength);
+    draco::Decoder decoder;
+    auto decoded = decoder.DecodeMeshFromBuffer(&decoderBuffer);
+    REQUIRE(decoded.ok());
+
+    auto dracoMesh = std::move(decoded).value();
+    REQUIRE(dracoMesh->num_faces() == 1);
+    REQUIRE(dracoMesh->num_points() == 3);
+    REQUIRE(dracoMesh->num_attributes() == 4);
+
+    int batchIDAttribute = dracoExtension.Get("attributes").Get("_BATCHID").Get<int>();
+    const auto *batchIDs = dracoMesh->GetAttributeByUniqueId(static_cast<uint32_t>(batchIDAttribute));
+    REQUIRE(batchIDs != nullptr);
+    REQUIRE(batchIDs->attribute_type() == draco::GeometryAttribute::GENERIC);
+}
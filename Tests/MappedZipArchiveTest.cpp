@@ -0,0 +1,154 @@
+#include "MappedZipArchive.h"
+#include "Config.h"
+#include "catch2/catch.hpp"
+#include <fstream>
+#include <istream>
+#include <iterator>
+
+using namespace CDBTo3DTiles;
+
+static void writeUint16(std::ostream &stream, uint16_t value)
+{
+    stream.put(static_cast<char>(value & 0xff));
+    stream.put(static_cast<char>(value >> 8));
+}
+
+static void writeUint32(std::ostream &stream, uint32_t value)
+{
+    writeUint16(stream, static_cast<uint16_t>(value & 0xffff));
+    writeUint16(stream, static_cast<uint16_t>(value >> 16));
+}
+
+// writes a zip with a single stored entry. The reader doesn't check the CRC, so it is left to 0
+static void writeStoredZip(const std::filesystem::path &zipPath,
+                           const std::string &name,
+                           const std::string &data)
+{
+    auto nameSize = static_cast<uint16_t>(name.size());
+    auto dataSize = static_cast<uint32_t>(data.size());
+    std::ofstream stream(zipPath, std::ios::binary);
+    writeUint32(stream, 0x04034b50);
+    writeUint16(stream, 10);
+    writeUint16(stream, 0);
+    writeUint16(stream, 0);
+    writeUint32(stream, 0);
+    writeUint32(stream, 0);
+    writeUint32(stream, dataSize);
+    writeUint32(stream, dataSize);
+    writeUint16(stream, nameSize);
+    writeUint16(stream, 0);
+    stream << name << data;
+
+    auto centralDirectoryOffset = static_cast<uint32_t>(stream.tellp());
+    writeUint32(stream, 0x02014b50);
+    writeUint16(stream, 10);
+    writeUint16(stream, 10);
+    writeUint16(stream, 0);
+    writeUint16(stream, 0);
+    writeUint32(stream, 0);
+    writeUint32(stream, 0);
+    writeUint32(stream, dataSize);
+    writeUint32(stream, dataSize);
+    writeUint16(stream, nameSize);
+    writeUint16(stream, 0);
+    writeUint16(stream, 0);
+    writeUint16(stream, 0);
+    writeUint16(stream, 0);
+    writeUint32(stream, 0);
+    writeUint32(stream, 0);
+    stream << name;
+
+    auto centralDirectorySize = static_cast<uint32_t>(stream.tellp()) - centralDirectoryOffset;
+    writeUint32(stream, 0x06054b50);
+    writeUint16(stream, 0);
+    writeUint16(stream, 0);
+    writeUint16(stream, 1);
+    writeUint16(stream, 1);
+    writeUint32(stream, centralDirectorySize);
+    writeUint32(stream, centralDirectoryOffset);
+    writeUint16(stream, 0);
+}
+
+TEST_CASE("Test reading deflated entries of a mapped zip archive", "[MappedZipArchive]")
+{
+    std::filesystem::path zipPath = dataPath / "GSModelsWithGSModelTexture" / "Tiles" / "N32" / "W118"
+                                    / "301_GSModelTexture" / "L00" / "U0"
+                                    / "N32W118_D301_S001_T001_L00_U0_R0.zip";
+    auto archive = MappedZipArchive::open(zipPath);
+    REQUIRE(archive != nullptr);
+
+    std::string roof = "N32W118_D301_S001_T001_L00_U0_R0_roof_tiled1.rgb";
+    std::string salmon = "N32W118_D301_S001_T001_L00_U0_R0_salmon_3_story_0_scale.rgb";
+    REQUIRE(archive->getEntryNames() == std::vector<std::string>{roof, salmon});
+    REQUIRE(archive->hasEntry(roof));
+    REQUIRE(!archive->hasEntry("/" + roof));
+
+    // the inflated SGI images start with their magic number
+    std::vector<char> buffer;
+    REQUIRE(archive->readEntry("missing.rgb", buffer) == std::nullopt);
+    auto data = archive->readEntry(salmon, buffer);
+    REQUIRE(data != std::nullopt);
+    REQUIRE(data->size() == 49664);
+    REQUIRE(data->data() == buffer.data());
+    REQUIRE(static_cast<unsigned char>((*data)[0]) == 0x01);
+    REQUIRE(static_cast<unsigned char>((*data)[1]) == 0xda);
+
+    auto otherData = archive->readEntry(roof, buffer);
+    REQUIRE(otherData != std::nullopt);
+    REQUIRE(otherData->size() == 197120);
+}
+
+TEST_CASE("Test reading stored entries of a mapped zip archive", "[MappedZipArchive]")
+{
+    std::filesystem::path zipPath = "StoredEntry.zip";
+    writeStoredZip(zipPath, "models/model.txt", "stored model");
+
+    {
+        auto archive = MappedZipArchive::open(zipPath);
+        REQUIRE(archive != nullptr);
+        REQUIRE(archive->getEntryNames() == std::vector<std::string>{"models/model.txt"});
+
+        // stored entries are read from the mapping without copying them
+        std::vector<char> buffer;
+        auto data = archive->readEntry("models/model.txt", buffer);
+        REQUIRE(data == std::string_view("stored model"));
+        REQUIRE(buffer.empty());
+
+        MemoryStreamBuffer streamBuffer(*data);
+        std::istream stream(&streamBuffer);
+        stream.seekg(0, std::ios::end);
+        REQUIRE(stream.tellg() == 12);
+        stream.seekg(7);
+        std::string word;
+        stream >> word;
+        REQUIRE(word == "model");
+    }
+
+    std::filesystem::remove(zipPath);
+}
+
+TEST_CASE("Test opening files that are not zip archives", "[MappedZipArchive]")
+{
+    REQUIRE(MappedZipArchive::open("missing.zip") == nullptr);
+    REQUIRE(MappedZipArchive::open(dataPath / "GSModelsWithGSModelTexture" / "Tiles" / "N32" / "W118"
+                                   / "100_GSFeature" / "L00" / "U0" / "N32W118_D100_S001_T001_L00_U0_R0.dbf")
+            == nullptr);
+}
+
+TEST_CASE("Test reading a zip archive from memory", "[MappedZipArchive]")
+{
+    std::filesystem::path zipPath = "BufferedEntry.zip";
+    writeStoredZip(zipPath, "model.txt", "buffered model");
+    std::ifstream stream(zipPath, std::ios::binary);
+    std::vector<char> zip((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    stream.close();
+    std::filesystem::remove(zipPath);
+
+    auto archive = MappedZipArchive::open(std::move(zip));
+    REQUIRE(archive != nullptr);
+    std::vector<char> buffer;
+    REQUIRE(archive->readEntry("model.txt", buffer) == std::string_view("buffered model"));
+
+    REQUIRE(MappedZipArchive::open(std::vector<char>()) == nullptr);
+    REQUIRE(MappedZipArchive::open(std::vector<char>{'n', 'o', 't', ' ', 'z', 'i', 'p'}) == nullptr);
+}
@@ -0,0 +1,122 @@
+#include "MemoryBudget.h"
+#include "ThreadPool.h"
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test memory budget admits GeoCells under the budget", "[MemoryBudget]")
+{
+    std::atomic<uint64_t> residentBytes{100};
+    MemoryBudget budget(1000, [&residentBytes]() { return residentBytes.load(); });
+    REQUIRE(budget.getMaxBytes() == 1000);
+
+    SECTION("GeoCells are admitted while the memory is under the budget")
+    {
+        REQUIRE(!budget.isExceeded());
+        REQUIRE(budget.tryAcquireGeoCell());
+        REQUIRE(budget.tryAcquireGeoCell());
+        REQUIRE(budget.getGeoCellsInFlight() == 2);
+
+        budget.releaseGeoCell();
+        budget.releaseGeoCell();
+        REQUIRE(budget.getGeoCellsInFlight() == 0);
+    }
+
+    SECTION("GeoCells wait for the ones in flight past the budget")
+    {
+        REQUIRE(budget.tryAcquireGeoCell());
+        residentBytes = 2000;
+        REQUIRE(budget.isExceeded());
+        REQUIRE(!budget.tryAcquireGeoCell());
+
+        budget.releaseGeoCell();
+        REQUIRE(budget.getGeoCellsInFlight() == 0);
+    }
+
+    SECTION("One GeoCell is always admitted")
+    {
+        residentBytes = 2000;
+        REQUIRE(budget.tryAcquireGeoCell());
+        REQUIRE(budget.getGeoCellsInFlight() == 1);
+        budget.releaseGeoCell();
+    }
+
+    SECTION("Waiting GeoCell runs the pending tasks until the memory falls")
+    {
+        ThreadPool pool(1);
+        TaskGroup group(pool);
+        REQUIRE(budget.tryAcquireGeoCell());
+        residentBytes = 2000;
+        group.run([&]() {
+            residentBytes = 100;
+            budget.releaseGeoCell();
+        });
+
+        budget.acquireGeoCell(pool);
+        REQUIRE(budget.getGeoCellsInFlight() == 1);
+        budget.releaseGeoCell();
+        group.wait();
+    }
+}
+
+TEST_CASE("Test memory budget shrinks the caches once per growth past the budget", "[MemoryBudget]")
+{
+    std::atomic<uint64_t> residentBytes{100};
+    size_t residentBytesReads = 0;
+    auto getResidentBytes = [&]() {
+        ++residentBytesReads;
+        return residentBytes.load();
+    };
+
+    SECTION("Caches are shrunk again only once the memory grows by a tenth of the budget")
+    {
+        MemoryBudget budget(1000, getResidentBytes, std::chrono::milliseconds(0));
+        REQUIRE(!budget.shouldShrinkCaches());
+
+        residentBytes = 1500;
+        REQUIRE(budget.shouldShrinkCaches());
+        REQUIRE(!budget.shouldShrinkCaches());
+
+        residentBytes = 1599;
+        REQUIRE(!budget.shouldShrinkCaches());
+
+        residentBytes = 1600;
+        REQUIRE(budget.shouldShrinkCaches());
+
+        // falling under the budget resets the memory reached at the last shrink
+        residentBytes = 900;
+        REQUIRE(!budget.shouldShrinkCaches());
+        residentBytes = 1100;
+        REQUIRE(budget.shouldShrinkCaches());
+    }
+
+    SECTION("Resident memory is read once per check interval")
+    {
+        MemoryBudget budget(1000, getResidentBytes, std::chrono::hours(1));
+        residentBytes = 1500;
+        REQUIRE(budget.shouldShrinkCaches());
+
+        residentBytes = 5000;
+        REQUIRE(!budget.shouldShrinkCaches());
+        REQUIRE(residentBytesReads == 1);
+    }
+}
+
+TEST_CASE("Test scoped GeoCell release", "[MemoryBudget]")
+{
+    MemoryBudget budget(1000, []() { return uint64_t(0); });
+    REQUIRE(budget.tryAcquireGeoCell());
+
+    try {
+        ScopedGeoCellRelease release(&budget);
+        throw std::runtime_error("GeoCell failed");
+    } catch (const std::runtime_error &) {
+    }
+
+    REQUIRE(budget.getGeoCellsInFlight() == 0);
+
+    ScopedGeoCellRelease noBudget(nullptr);
+}
@@ -0,0 +1,33 @@
+#include "ObjectStorageOutputSink.h"
+#include "catch2/catch.hpp"
+#include "cpl_vsi.h"
+#include <string>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test uploading files through a GDAL virtual file system", "[ObjectStorageOutputSink]")
+{
+    // the in-memory file system of GDAL stands in for a bucket
+    std::filesystem::path prefix = "/vsimem/ObjectStorage";
+    {
+        ObjectStorageOutputSink sink(2, 0);
+        sink.createDirectories(prefix / "Tiles");
+        for (size_t i = 0; i < 10; ++i) {
+            std::string tile = "b3dm" + std::to_string(i);
+            sink.write(prefix / "Tiles" / (std::to_string(i) + ".b3dm"),
+                       std::vector<unsigned char>(tile.begin(), tile.end()));
+        }
+
+        sink.flush();
+    }
+
+    for (size_t i = 0; i < 10; ++i) {
+        auto path = (prefix / "Tiles" / (std::to_string(i) + ".b3dm")).string();
+        vsi_l_offset byteLength = 0;
+        GByte *bytes = VSIGetMemFileBuffer(path.c_str(), &byteLength, FALSE);
+        REQUIRE(bytes != nullptr);
+        REQUIRE(std::string(bytes, bytes + byteLength) == "b3dm" + std::to_string(i));
+    }
+
+    VSIRmdirRecursive(prefix.string().c_str());
+}
@@ -0,0 +1,90 @@
+#include "OutputSink.h"
+#include "MappedZipArchive.h"
+#include "TestHelpers.h"
+#include "catch2/catch.hpp"
+#include <stdexcept>
+#include <string>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test output buffer keeps what is written", "[OutputSink]")
+{
+    OutputBuffer buffer;
+    buffer << "tile";
+    buffer.put('s');
+    REQUIRE(buffer.getByteLength() == 5);
+    REQUIRE(buffer.release() == toBytes("tiles"));
+}
+
+TEST_CASE("Test output sinks write every file handed over", "[OutputSink]")
+{
+    std::filesystem::path output = "OutputSink";
+    std::filesystem::create_directories(output);
+
+    SECTION("Directory sink writes on the calling thread")
+    {
+        DirectoryOutputSink sink;
+        sink.write(output / "tile.b3dm", toBytes("b3dm"));
+        REQUIRE(readFile(output / "tile.b3dm") == "b3dm");
+    }
+
+    SECTION("Batched sink writes the queued files once flushed")
+    {
+        BatchedDirectoryOutputSink sink(2, 64);
+        for (size_t i = 0; i < 200; ++i) {
+            sink.write(output / (std::to_string(i) + ".b3dm"), toBytes(std::string(i % 40, 'a')));
+        }
+
+        sink.flush();
+        for (size_t i = 0; i < 200; ++i) {
+            REQUIRE(readFile(output / (std::to_string(i) + ".b3dm")) == std::string(i % 40, 'a'));
+        }
+    }
+
+    SECTION("Batched sink queues a file larger than the queue")
+    {
+        BatchedDirectoryOutputSink sink(1, 4);
+        sink.write(output / "large.b3dm", toBytes("larger than the queue"));
+        sink.flush();
+        REQUIRE(readFile(output / "large.b3dm") == "larger than the queue");
+    }
+
+    SECTION("Batched sink writes the queued files when destroyed")
+    {
+        {
+            BatchedDirectoryOutputSink sink(1, 0);
+            sink.write(output / "last.b3dm", toBytes("last"));
+        }
+
+        REQUIRE(readFile(output / "last.b3dm") == "last");
+    }
+
+    SECTION("Batched sink reports the files it cannot write")
+    {
+        BatchedDirectoryOutputSink sink(1, 0);
+        sink.write(output / "Missing" / "tile.b3dm", toBytes("b3dm"));
+        REQUIRE_THROWS_AS(sink.flush(), std::runtime_error);
+    }
+
+    SECTION("Archive sink appends the files below an open archive")
+    {
+        {
+            ArchiveOutputSink sink;
+            sink.openArchive(output / "GeoCell", output / "GeoCell.3tz");
+            sink.createDirectories(output / "GeoCell" / "Elevation");
+            sink.write(output / "GeoCell" / "Elevation" / "tileset.json", toBytes("{}"));
+            sink.write(output / "tileset.json", toBytes("combined"));
+            sink.closeArchive(output / "GeoCell");
+        }
+
+        REQUIRE(!std::filesystem::exists(output / "GeoCell"));
+        REQUIRE(readFile(output / "tileset.json") == "combined");
+
+        auto archive = MappedZipArchive::open(output / "GeoCell.3tz");
+        REQUIRE(archive != nullptr);
+        std::vector<char> buffer;
+        REQUIRE(archive->readEntry("Elevation/tileset.json", buffer) == std::string_view("{}"));
+    }
+
+    std::filesystem::remove_all(output);
+}
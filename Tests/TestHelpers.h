@@ -0,0 +1,23 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+inline std::string readFile(const std::filesystem::path &path)
+{
+    std::ifstream fs(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+}
+
+inline std::vector<char> readBinaryFile(const std::filesystem::path &path)
+{
+    std::ifstream fs(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+}
+
+inline std::vector<unsigned char> toBytes(const std::string &text)
+{
+    return std::vector<unsigned char>(text.begin(), text.end());
+}
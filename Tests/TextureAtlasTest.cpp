@@ -0,0 +1,111 @@
+#include "TextureAtlas.h"
+#include "catch2/catch.hpp"
+
+using namespace CDBTo3DTiles;
+
+static osg::ref_ptr<osg::Image> createImage(int width, int height, unsigned char red)
+{
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(width, height, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char *texel = image->data(static_cast<unsigned>(x), static_cast<unsigned>(y));
+            texel[0] = red;
+            texel[1] = static_cast<unsigned char>(y);
+            texel[2] = 0;
+        }
+    }
+
+    return image;
+}
+
+static Mesh createTriangle(int material, float maxUV, double offset)
+{
+    Mesh mesh;
+    mesh.material = material;
+    mesh.positions = {
+        glm::dvec3(offset, 0.0, 0.0), glm::dvec3(offset + 1.0, 0.0, 0.0), glm::dvec3(offset, 1.0, 0.0)};
+    mesh.UVs = {glm::vec2(0.0f), glm::vec2(maxUV, 0.0f), glm::vec2(0.0f, maxUV)};
+    mesh.indices = {0, 1, 2};
+    mesh.aabb = AABB();
+    for (const auto &position : mesh.positions) {
+        mesh.aabb->merge(position);
+    }
+
+    for (const auto &position : mesh.positions) {
+        mesh.positionRTCs.emplace_back(position - mesh.aabb->center());
+    }
+
+    return mesh;
+}
+
+TEST_CASE("Test packing model textures into atlases", "[TextureAtlas]")
+{
+    std::vector<osg::ref_ptr<osg::Image>> images{createImage(8, 4, 10), createImage(4, 4, 20)};
+    std::vector<Texture> textures(2);
+    textures[0].uri = "first.png";
+    textures[1].uri = "second.png";
+    std::vector<Material> materials(2);
+    materials[0].texture = 0;
+    materials[1].texture = 1;
+
+    SECTION("Test textures inside their UVs share an atlas")
+    {
+        std::vector<Mesh> meshes{createTriangle(0, 1.0f, 0.0), createTriangle(1, 1.0f, 2.0)};
+        auto atlas = createTextureAtlases(meshes, materials, textures, images, "Tile_atlas", 2048);
+        REQUIRE(atlas.textures.size() == 1);
+        REQUIRE(atlas.textures[0].uri == "Tile_atlas_0.png");
+        REQUIRE(atlas.images.size() == 1);
+        REQUIRE(atlas.images[0]->getPixelFormat() == static_cast<GLenum>(GL_RGBA));
+
+        // the materials only differed by their textures, so both meshes are merged
+        REQUIRE(atlas.materials.size() == 1);
+        REQUIRE(atlas.materials[0].texture == 0);
+        REQUIRE(atlas.meshes.size() == 1);
+
+        const auto &mesh = atlas.meshes[0];
+        REQUIRE(mesh.material == 0);
+        REQUIRE(mesh.getVertexCount() == 6);
+        REQUIRE(mesh.indices == std::vector<uint32_t>{0, 1, 2, 3, 4, 5});
+        REQUIRE(mesh.aabb->min == glm::dvec3(0.0));
+        REQUIRE(mesh.aabb->max == glm::dvec3(3.0, 1.0, 0.0));
+        for (size_t i = 0; i < mesh.getVertexCount(); ++i) {
+            glm::dvec3 position = mesh.aabb->center() + glm::dvec3(mesh.positionRTCs[i]);
+            REQUIRE(position == mesh.positions[i]);
+        }
+
+        // every texel sampled through the remapped UVs comes from the original texture
+        auto pixels = convertToRGBA(*atlas.images[0]);
+        size_t atlasWidth = static_cast<size_t>(atlas.images[0]->s());
+        size_t atlasHeight = static_cast<size_t>(atlas.images[0]->t());
+        for (size_t i = 0; i < mesh.UVs.size(); ++i) {
+            auto texelX = std::min(static_cast<size_t>(mesh.UVs[i].x * static_cast<float>(atlasWidth)),
+                                   atlasWidth - 1);
+            auto texelY = std::min(static_cast<size_t>(mesh.UVs[i].y * static_cast<float>(atlasHeight)),
+                                   atlasHeight - 1);
+            unsigned char red = pixels[(texelY * atlasWidth + texelX) * 4];
+            REQUIRE(red == (i < 3 ? 10 : 20));
+        }
+    }
+
+    SECTION("Test repeated textures keep their own file")
+    {
+        std::vector<Mesh> meshes{createTriangle(0, 1.0f, 0.0), createTriangle(1, 2.0f, 2.0)};
+        auto atlas = createTextureAtlases(meshes, materials, textures, images, "Tile_atlas", 2048);
+        REQUIRE(atlas.textures.size() == 2);
+        REQUIRE(atlas.textures[0].uri == "first.png");
+        REQUIRE(atlas.textures[1].uri == "second.png");
+        REQUIRE(atlas.materials.size() == 2);
+        REQUIRE(atlas.meshes.size() == 2);
+        REQUIRE(atlas.meshes[1].UVs[1] == glm::vec2(2.0f, 0.0f));
+    }
+
+    SECTION("Test textures larger than the atlas keep their own file")
+    {
+        std::vector<Mesh> meshes{createTriangle(0, 1.0f, 0.0), createTriangle(1, 1.0f, 2.0)};
+        auto atlas = createTextureAtlases(meshes, materials, textures, images, "Tile_atlas", 8);
+        REQUIRE(atlas.textures.size() == 2);
+        REQUIRE(atlas.meshes.size() == 2);
+        REQUIRE(atlas.meshes[0].UVs == meshes[0].UVs);
+    }
+}
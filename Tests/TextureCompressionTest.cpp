@@ -0,0 +1,58 @@
+#include "TextureCompression.h"
+#include "catch2/catch.hpp"
+#include <cstring>
+#include <stdexcept>
+
+using namespace CDBTo3DTiles;
+
+static uint32_t readKTX2HeaderField(const std::vector<unsigned char> &KTX2, size_t offset)
+{
+    uint32_t field;
+    std::memcpy(&field, KTX2.data() + offset, sizeof(field));
+    return field;
+}
+
+TEST_CASE("Test parsing texture compression", "[TextureCompression]")
+{
+    REQUIRE(parseTextureCompression("none") == TextureCompression::None);
+    REQUIRE(parseTextureCompression("etc1s") == TextureCompression::ETC1S);
+    REQUIRE(parseTextureCompression("uastc") == TextureCompression::UASTC);
+    REQUIRE(parseTextureCompression("jpeg") == std::nullopt);
+
+    auto compressions = {TextureCompression::None, TextureCompression::ETC1S, TextureCompression::UASTC};
+    for (auto compression : compressions) {
+        REQUIRE(parseTextureCompression(textureCompressionToString(compression)) == compression);
+    }
+}
+
+TEST_CASE("Test encoding KTX2 texture", "[TextureCompression]")
+{
+    static const unsigned char KTX2_IDENTIFIER[]
+        = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    unsigned width = 16;
+    unsigned height = 8;
+    std::vector<unsigned char> pixels;
+    for (unsigned y = 0; y < height; ++y) {
+        for (unsigned x = 0; x < width; ++x) {
+            auto red = static_cast<unsigned char>(x * 16);
+            auto green = static_cast<unsigned char>(y * 32);
+            pixels.insert(pixels.end(), {red, green, 0, 255});
+        }
+    }
+
+    for (auto compression : {TextureCompression::ETC1S, TextureCompression::UASTC}) {
+        auto KTX2 = encodeKTX2(pixels, width, height, compression);
+        REQUIRE(KTX2.size() > sizeof(KTX2_IDENTIFIER) + 36);
+        REQUIRE(std::memcmp(KTX2.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0);
+        REQUIRE(readKTX2HeaderField(KTX2, 20) == width);
+        REQUIRE(readKTX2HeaderField(KTX2, 24) == height);
+
+        // the mipmap chain goes down to 1x1
+        REQUIRE(readKTX2HeaderField(KTX2, 40) == 5);
+    }
+
+    REQUIRE_THROWS_AS(encodeKTX2(pixels, width, height, TextureCompression::None), std::invalid_argument);
+    REQUIRE_THROWS_AS(encodeKTX2(pixels, width + 1, height, TextureCompression::ETC1S),
+                      std::invalid_argument);
+}
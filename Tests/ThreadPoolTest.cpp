@@ -0,0 +1,66 @@
+#include "ThreadPool.h"
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <stdexcept>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test task group runs all the tasks", "[ThreadPool]")
+{
+    SECTION("Sequential pool runs tasks in order")
+    {
+        ThreadPool pool(1);
+        REQUIRE(pool.isSequential());
+
+        std::vector<int> order;
+        TaskGroup group(pool);
+        for (int i = 0; i < 10; ++i) {
+            group.run([&order, i]() { order.emplace_back(i); });
+        }
+        group.wait();
+
+        REQUIRE(order == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+    }
+
+    SECTION("Parallel pool runs nested task groups")
+    {
+        ThreadPool pool(4);
+        REQUIRE(pool.getThreadCount() == 4);
+
+        std::atomic<int> total{0};
+        TaskGroup group(pool);
+        for (int i = 0; i < 16; ++i) {
+            group.run([&pool, &total]() {
+                TaskGroup nested(pool);
+                for (int j = 0; j < 16; ++j) {
+                    nested.run([&total]() { ++total; });
+                }
+                nested.wait();
+            });
+        }
+        group.wait();
+
+        REQUIRE(total == 256);
+    }
+}
+
+TEST_CASE("Test task group rethrows the task exception", "[ThreadPool]")
+{
+    for (size_t threadCount : {1, 4}) {
+        ThreadPool pool(threadCount);
+        std::atomic<int> total{0};
+        TaskGroup group(pool);
+        for (int i = 0; i < 8; ++i) {
+            group.run([&total, i]() {
+                if (i == 3) {
+                    throw std::runtime_error("Task failed");
+                }
+
+                ++total;
+            });
+        }
+
+        REQUIRE_THROWS_WITH(group.wait(), "Task failed");
+        REQUIRE(total == 7);
+    }
+}
@@ -0,0 +1,427 @@
+#include "TileFormatIO.h"
+#include "TestHelpers.h"
+#include "catch2/catch.hpp"
+#include "nlohmann/json.hpp"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+
+using namespace CDBTo3DTiles;
+
+TEST_CASE("Test writing CMPT with measured inner tiles", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    std::vector<size_t> tileByteLengths{8, 16};
+    {
+        TileOutputFile cmptFile(output / "tile.cmpt");
+        writeToCMPT(tileByteLengths, cmptFile.getStream(), [&](std::ostream &fs, size_t tileIdx) {
+            std::string tile(tileByteLengths[tileIdx], static_cast<char>('a' + tileIdx));
+            fs.write(tile.data(), static_cast<std::streamsize>(tile.size()));
+        });
+    }
+
+    auto cmpt = readBinaryFile(output / "tile.cmpt");
+    REQUIRE(cmpt.size() == sizeof(CmptHeader) + 24);
+
+    CmptHeader header;
+    std::memcpy(&header, cmpt.data(), sizeof(header));
+    REQUIRE(std::string(header.magic, 4) == "cmpt");
+    REQUIRE(header.version == 1);
+    REQUIRE(header.byteLength == cmpt.size());
+    REQUIRE(header.titleLength == 2);
+    REQUIRE(cmpt[sizeof(CmptHeader)] == 'a');
+    REQUIRE(cmpt[sizeof(CmptHeader) + 8] == 'b');
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test writing B3DM from buffer segments", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    Mesh mesh;
+    mesh.aabb = AABB();
+    mesh.positions = {glm::dvec3(-0.5, 0.0, 0.0), glm::dvec3(0.0, 0.5, 0.0), glm::dvec3(0.5, 0.0, 0.0)};
+    for (const auto &position : mesh.positions) {
+        mesh.aabb->merge(position);
+        mesh.positionRTCs.emplace_back(static_cast<glm::vec3>(position));
+    }
+
+    std::vector<GltfBufferSegment> bufferSegments;
+    tinygltf::Model gltf = createGltf(mesh, nullptr, nullptr, &bufferSegments);
+    {
+        TileOutputFile b3dmFile(output / "tile.b3dm");
+        writeToB3DM(&gltf, bufferSegments, nullptr, b3dmFile.getStream());
+    }
+
+    auto b3dm = readBinaryFile(output / "tile.b3dm");
+    B3dmHeader header;
+    std::memcpy(&header, b3dm.data(), sizeof(header));
+    REQUIRE(std::string(header.magic, 4) == "b3dm");
+    REQUIRE(header.byteLength == b3dm.size());
+    REQUIRE(header.byteLength % 8 == 0);
+    REQUIRE(header.batchTableJsonByteLength == 0);
+    REQUIRE(header.batchTableBinByteLength == 0);
+
+    // the glb follows the tables and has to be readable on its own
+    size_t glbOffset = sizeof(B3dmHeader) + header.featureTableJsonByteLength;
+    REQUIRE(glbOffset % 8 == 0);
+
+    tinygltf::TinyGLTF loader;
+    tinygltf::Model loadedGltf;
+    std::string error;
+    std::string warning;
+    REQUIRE(loader.LoadBinaryFromMemory(&loadedGltf,
+                                        &error,
+                                        &warning,
+                                        reinterpret_cast<const unsigned char *>(b3dm.data() + glbOffset),
+                                        static_cast<unsigned>(b3dm.size() - glbOffset)));
+    REQUIRE(loadedGltf.buffers.front().data.size() == mesh.positionRTCs.size() * sizeof(glm::vec3));
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test writing B3DM batch table columns", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    std::vector<std::string> CNAMs{"class \"A\"", "class\\B", "class\nC"};
+    CDBInstancesAttributes instancesAttribs;
+    auto &MODLs = instancesAttribs.getOrCreateStringAttribs("MODL");
+    for (size_t i = 0; i < CNAMs.size(); ++i) {
+        instancesAttribs.getCNAMs().emplace_back(CNAMs[i]);
+        MODLs.emplace_back(i == 1 ? "b" : "a");
+    }
+
+    instancesAttribs.getIntegerAttribs()["AHGT"] = {1, 2, 3};
+    instancesAttribs.getDoubleAttribs()["BBH"] = {1.5, 2.5, 3.5};
+
+    Mesh mesh;
+    mesh.aabb = AABB();
+    mesh.positions = {glm::dvec3(-0.5, 0.0, 0.0), glm::dvec3(0.0, 0.5, 0.0), glm::dvec3(0.5, 0.0, 0.0)};
+    for (const auto &position : mesh.positions) {
+        mesh.aabb->merge(position);
+        mesh.positionRTCs.emplace_back(static_cast<glm::vec3>(position));
+    }
+
+    std::vector<GltfBufferSegment> bufferSegments;
+    tinygltf::Model gltf = createGltf(mesh, nullptr, nullptr, &bufferSegments);
+    {
+        TileOutputFile b3dmFile(output / "tile.b3dm");
+        writeToB3DM(&gltf, bufferSegments, &instancesAttribs, b3dmFile.getStream());
+    }
+
+    auto b3dm = readBinaryFile(output / "tile.b3dm");
+    B3dmHeader header;
+    std::memcpy(&header, b3dm.data(), sizeof(header));
+    REQUIRE(header.batchTableJsonByteLength % 8 == 0);
+    REQUIRE(header.batchTableBinByteLength == 16 + 3 * sizeof(double));
+
+    size_t batchTableOffset = sizeof(B3dmHeader) + header.featureTableJsonByteLength
+                              + header.featureTableBinByteLength;
+    auto batchTableJson = nlohmann::json::parse(b3dm.data() + batchTableOffset,
+                                                b3dm.data() + batchTableOffset
+                                                    + header.batchTableJsonByteLength);
+    REQUIRE(batchTableJson["CNAM"] == nlohmann::json(CNAMs));
+    REQUIRE(batchTableJson["MODL"] == nlohmann::json({"a", "b", "a"}));
+    REQUIRE(batchTableJson["AHGT"]["byteOffset"] == 0);
+    REQUIRE(batchTableJson["AHGT"]["componentType"] == "INT");
+    REQUIRE(batchTableJson["BBH"]["byteOffset"] == 16);
+    REQUIRE(batchTableJson["BBH"]["componentType"] == "DOUBLE");
+
+    double BBH;
+    std::memcpy(&BBH,
+                b3dm.data() + batchTableOffset + header.batchTableJsonByteLength + 16 + sizeof(double),
+                sizeof(BBH));
+    REQUIRE(BBH == 2.5);
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test measuring B3DM before writing it into CMPT", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    CDBInstancesAttributes instancesAttribs;
+    for (const auto &CNAM : {"first", "second", "third"}) {
+        instancesAttribs.getCNAMs().emplace_back(CNAM);
+    }
+
+    instancesAttribs.getIntegerAttribs()["AHGT"] = {1, 2, 3};
+    auto extractedAttribs = instancesAttribs.extractInstances({2, 0});
+    REQUIRE(extractedAttribs.getInstancesCount() == 2);
+    REQUIRE(extractedAttribs.getCNAMs()[0] == "third");
+    REQUIRE(extractedAttribs.getIntegerAttribs().at("AHGT") == std::vector<int>{3, 1});
+
+    auto retainedAttribs = instancesAttribs;
+    retainedAttribs.retainInstances({0, 2});
+    REQUIRE(retainedAttribs.getInstancesCount() == 2);
+    REQUIRE(retainedAttribs.getCNAMs()[1] == "third");
+    REQUIRE(retainedAttribs.getIntegerAttribs().at("AHGT") == std::vector<int>{1, 3});
+
+    Mesh mesh;
+    mesh.aabb = AABB();
+    mesh.positions = {glm::dvec3(-0.5, 0.0, 0.0), glm::dvec3(0.0, 0.5, 0.0), glm::dvec3(0.5, 0.0, 0.0)};
+    mesh.batchIDs = {0.0f, 1.0f, 1.0f};
+    for (const auto &position : mesh.positions) {
+        mesh.aabb->merge(position);
+        mesh.positionRTCs.emplace_back(static_cast<glm::vec3>(position));
+    }
+
+    std::vector<GltfBufferSegment> bufferSegments;
+    tinygltf::Model gltf = createGltf(mesh, nullptr, nullptr, &bufferSegments);
+    B3DM b3dm = createB3DM(&gltf, bufferSegments, &extractedAttribs);
+    std::vector<size_t> tileByteLengths{b3dm.getByteLength()};
+    {
+        TileOutputFile cmptFile(output / "tile.cmpt");
+        writeToCMPT(tileByteLengths, cmptFile.getStream(), [&](std::ostream &fs, size_t) {
+            REQUIRE(writeToB3DM(b3dm, fs) == b3dm.getByteLength());
+        });
+    }
+
+    auto cmpt = readBinaryFile(output / "tile.cmpt");
+    REQUIRE(cmpt.size() == sizeof(CmptHeader) + b3dm.getByteLength());
+
+    B3dmHeader header;
+    std::memcpy(&header, cmpt.data() + sizeof(CmptHeader), sizeof(header));
+    REQUIRE(std::string(header.magic, 4) == "b3dm");
+    REQUIRE(header.byteLength == b3dm.getByteLength());
+    REQUIRE(header.byteLength % 8 == 0);
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test writing implicit tileset with subtree availability", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    CDBGeoCell geoCell(32, -118);
+    std::vector<std::tuple<int, int, int, std::string>> tiles{{-1, 0, 0, "negative.b3dm"},
+                                                              {0, 0, 0, "level0.b3dm"},
+                                                              {1, 1, 0, "level1.b3dm"},
+                                                              {2, 3, 1, "level2.b3dm"}};
+
+    CDBTileset tileset;
+    for (const auto &[level, UREF, RREF, contentURI] : tiles) {
+        CDBTile tile(geoCell, CDBDataset::GSModelGeometry, 1, 1, level, UREF, RREF);
+        tile.setCustomContentURI(contentURI);
+        REQUIRE(tileset.insertTile(tile) != nullptr);
+        std::ofstream(output / contentURI) << contentURI;
+    }
+
+    {
+        std::ofstream fs(output / "tileset.json");
+        writeToImplicitTilesetJson(tileset, false, output, fs);
+    }
+
+    // the negative levels stay explicit above the implicit root
+    std::ifstream tilesetFile(output / "tileset.json");
+    nlohmann::json tilesetJson = nlohmann::json::parse(tilesetFile);
+    REQUIRE(tilesetJson["asset"]["version"] == "1.1");
+    REQUIRE(tilesetJson["root"]["refine"] == "ADD");
+    nlohmann::json *tileJson = &tilesetJson["root"];
+    for (int level = -10; level < 0; ++level) {
+        REQUIRE((*tileJson)["geometricError"] == computeGeometricError(tileset, level));
+        REQUIRE((*tileJson)["children"].size() == 1);
+        if (level == -1) {
+            REQUIRE((*tileJson)["content"]["uri"] == "negative.b3dm");
+        }
+
+        tileJson = &(*tileJson)["children"][0];
+    }
+
+    REQUIRE((*tileJson)["content"]["uri"] == "{level}_{x}_{y}.b3dm");
+    REQUIRE((*tileJson)["implicitTiling"]["subdivisionScheme"] == "QUADTREE");
+    REQUIRE((*tileJson)["implicitTiling"]["subtreeLevels"] == 3);
+    REQUIRE((*tileJson)["implicitTiling"]["availableLevels"] == 3);
+    REQUIRE((*tileJson)["implicitTiling"]["subtrees"]["uri"] == "subtrees/{level}.{x}.{y}.subtree");
+
+    // x follows RREF and y follows UREF
+    REQUIRE(std::filesystem::exists(output / "negative.b3dm"));
+    REQUIRE(std::filesystem::exists(output / "0_0_0.b3dm"));
+    REQUIRE(std::filesystem::exists(output / "1_0_1.b3dm"));
+    REQUIRE(std::filesystem::exists(output / "2_1_3.b3dm"));
+    REQUIRE(!std::filesystem::exists(output / "level2.b3dm"));
+
+    auto subtree = readBinaryFile(output / "subtrees" / "0.0.0.subtree");
+    SubtreeHeader header;
+    std::memcpy(&header, subtree.data(), sizeof(header));
+    REQUIRE(std::string(header.magic, 4) == "subt");
+    REQUIRE(header.version == 1);
+    REQUIRE(header.jsonByteLength % 8 == 0);
+    REQUIRE(header.binaryByteLength == 16);
+    REQUIRE(subtree.size() == sizeof(header) + header.jsonByteLength + header.binaryByteLength);
+
+    std::string json(subtree.data() + sizeof(header), header.jsonByteLength);
+    nlohmann::json subtreeJson = nlohmann::json::parse(json);
+    REQUIRE(subtreeJson["tileAvailability"]["bitstream"] == 0);
+    REQUIRE(subtreeJson["tileAvailability"]["availableCount"] == 3);
+    REQUIRE(subtreeJson["contentAvailability"][0]["bitstream"] == 1);
+    REQUIRE(subtreeJson["childSubtreeAvailability"]["constant"] == 0);
+    REQUIRE(subtreeJson["bufferViews"][1]["byteOffset"] == 8);
+
+    // the tiles are at bits 0, 1 + 2 and 5 + 11 in Morton order
+    const char *binary = subtree.data() + sizeof(header) + header.jsonByteLength;
+    REQUIRE(binary[0] == 0x09);
+    REQUIRE(binary[1] == 0x00);
+    REQUIRE(binary[2] == 0x01);
+    REQUIRE(binary[8] == 0x09);
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test writing implicit tileset with mixed content formats", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    CDBGeoCell geoCell(32, -118);
+    CDBTileset tileset;
+    CDBTile root(geoCell, CDBDataset::GSModelGeometry, 1, 1, 0, 0, 0);
+    root.setCustomContentURI("root.b3dm");
+    REQUIRE(tileset.insertTile(root) != nullptr);
+    CDBTile child(geoCell, CDBDataset::GSModelGeometry, 1, 1, 1, 0, 1);
+    child.setCustomContentURI("child.cmpt");
+    REQUIRE(tileset.insertTile(child) != nullptr);
+
+    {
+        std::ofstream fs(output / "tileset.json");
+        writeToImplicitTilesetJson(tileset, true, output, fs);
+    }
+
+    // a content template can't name both formats, so the tileset stays explicit
+    std::ifstream tilesetFile(output / "tileset.json");
+    nlohmann::json tilesetJson = nlohmann::json::parse(tilesetFile);
+    REQUIRE(tilesetJson["asset"]["version"] == "1.0");
+    REQUIRE(!std::filesystem::exists(output / "subtrees"));
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test streaming tileset JSON as nlohmann::json dumps it", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    // reading the streamed JSON back and dumping it again gives the same text
+    auto checkDumpedJson = [](const std::filesystem::path &path) {
+        std::string streamed = readFile(path);
+        nlohmann::json json = nlohmann::json::parse(streamed);
+        REQUIRE(streamed == json.dump() + "\n");
+        return json;
+    };
+
+    SECTION("Tileset")
+    {
+        CDBGeoCell geoCell(32, -118);
+        CDBTileset tileset;
+        CDBTile leaf(geoCell, CDBDataset::GSModelGeometry, 1, 1, 2, 3, 1);
+        leaf.setCustomContentURI("leaf \"quoted\".b3dm");
+        REQUIRE(tileset.insertTile(leaf) != nullptr);
+        CDBTile sibling(geoCell, CDBDataset::GSModelGeometry, 1, 1, 1, 0, 1);
+        sibling.setCustomContentURI("sibling.b3dm");
+        REQUIRE(tileset.insertTile(sibling) != nullptr);
+
+        {
+            std::ofstream fs(output / "tileset.json");
+            writeToTilesetJson(tileset, true, fs);
+        }
+
+        auto tilesetJson = checkDumpedJson(output / "tileset.json");
+        REQUIRE(tilesetJson["root"]["refine"] == "REPLACE");
+        REQUIRE(tilesetJson["geometricError"] == 300000.0);
+
+        // levels -10 to 0 are single tiles, level 1 holds both children
+        nlohmann::json *tileJson = &tilesetJson["root"];
+        for (int level = -10; level < 1; ++level) {
+            REQUIRE((*tileJson)["children"].size() == 1);
+            tileJson = &(*tileJson)["children"][0];
+        }
+
+        REQUIRE((*tileJson)["children"].size() == 2);
+        REQUIRE((*tileJson)["children"][0]["content"]["uri"] == "sibling.b3dm");
+        REQUIRE((*tileJson)["children"][0]["geometricError"] == 0.0);
+        REQUIRE((*tileJson)["children"][1]["children"][0]["content"]["uri"] == "leaf \"quoted\".b3dm");
+    }
+
+    SECTION("Combined tilesets")
+    {
+        std::vector<std::filesystem::path> tilesetJsonPaths{"N32W118/Elevation.json",
+                                                            "N33W118/Elevation.json"};
+        std::vector<Core::BoundingRegion> regions{
+            Core::BoundingRegion(Core::GlobeRectangle(-2.059, 0.558, -2.042, 0.576), -12.5, 1024.25),
+            Core::BoundingRegion(Core::GlobeRectangle(-2.059, 0.576, -2.042, 0.593), 0.0, 1e-7)};
+        {
+            std::ofstream fs(output / "tileset.json");
+            combineTilesetJson(tilesetJsonPaths, regions, fs);
+        }
+
+        auto tilesetJson = checkDumpedJson(output / "tileset.json");
+        REQUIRE(tilesetJson["root"]["children"].size() == 2);
+        REQUIRE(tilesetJson["root"]["children"][1]["content"]["uri"] == "N33W118/Elevation.json");
+        REQUIRE(tilesetJson["root"]["boundingVolume"]["region"][3] == 0.593);
+        REQUIRE(tilesetJson["root"]["boundingVolume"]["region"][4] == -12.5);
+    }
+
+    std::filesystem::remove_all(output);
+}
+
+TEST_CASE("Test geometric error of tileset levels", "[TileFormatIO]")
+{
+    // the error of the root is halved at every level, including past the deepest CDB level
+    CDBTileset tileset;
+    REQUIRE(computeGeometricError(tileset, -10) == 300000.0f);
+    REQUIRE(computeGeometricError(tileset, -9) == 150000.0f);
+    REQUIRE(computeGeometricError(tileset, 23) == std::ldexp(300000.0f, -33));
+    REQUIRE(computeGeometricError(tileset, 24) == std::ldexp(300000.0f, -34));
+
+    CDBTileset positiveTileset(2, 0, 0);
+    REQUIRE(computeGeometricError(positiveTileset, 2) == 300000.0f);
+    REQUIRE(computeGeometricError(positiveTileset, 5) == 37500.0f);
+    REQUIRE(computeGeometricError(positiveTileset, 1) == 600000.0f);
+}
+
+TEST_CASE("Test cutting tileset into external tilesets", "[TileFormatIO]")
+{
+    std::filesystem::path output = "TileFormatIO";
+    std::filesystem::create_directories(output);
+
+    CDBGeoCell geoCell(32, -118);
+    CDBTileset tileset(0, 0, 0);
+    CDBTile leaf(geoCell, CDBDataset::GSModelGeometry, 1, 1, 3, 7, 2);
+    leaf.setCustomContentURI("leaf.b3dm");
+    REQUIRE(tileset.insertTile(leaf) != nullptr);
+
+    {
+        std::ofstream fs(output / "tileset.json");
+        writeToTilesetJson(tileset, false, 2, output, fs);
+    }
+
+    // the level 2 tile is only referenced by the root tileset
+    std::ifstream tilesetFile(output / "tileset.json");
+    nlohmann::json tilesetJson = nlohmann::json::parse(tilesetFile);
+    REQUIRE(tilesetJson["root"]["refine"] == "ADD");
+    const auto &externalJson = tilesetJson["root"]["children"][0]["children"][0];
+    REQUIRE(externalJson.find("children") == externalJson.end());
+    REQUIRE(externalJson["geometricError"] == 75000.0);
+
+    std::string externalTilesetURI = externalJson["content"]["uri"];
+    REQUIRE(externalTilesetURI == "N32W118_D300_S001_T001_L02_U3_R1.json");
+
+    std::ifstream externalTilesetFile(output / externalTilesetURI);
+    nlohmann::json externalTilesetJson = nlohmann::json::parse(externalTilesetFile);
+    REQUIRE(externalTilesetJson["geometricError"] == 75000.0);
+    REQUIRE(externalTilesetJson["root"]["refine"] == "ADD");
+    REQUIRE(externalTilesetJson["root"]["boundingVolume"] == externalJson["boundingVolume"]);
+    REQUIRE(externalTilesetJson["root"]["children"][0]["content"]["uri"] == "leaf.b3dm");
+    REQUIRE(externalTilesetJson["root"]["children"][0]["geometricError"] == 0.0);
+
+    std::filesystem::remove_all(output);
+}
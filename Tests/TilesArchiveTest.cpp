@@ -0,0 +1,77 @@
+#include "TilesArchive.h"
+#include "MappedZipArchive.h"
+#include "TestHelpers.h"
+#include "catch2/catch.hpp"
+#include <cstring>
+
+using namespace CDBTo3DTiles;
+
+static uint64_t readUint64(const char *data)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+
+    return value;
+}
+
+TEST_CASE("Test computing MD5 hashes", "[TilesArchive]")
+{
+    auto hash = computeMD5("The quick brown fox jumps over the lazy dog");
+    std::array<unsigned char, 16> expected = {0x9e, 0x10, 0x7d, 0x9d, 0x37, 0x2b, 0xb6, 0x82,
+                                              0x6b, 0xd8, 0x1d, 0x35, 0x42, 0xa4, 0x19, 0xd6};
+    REQUIRE(hash == expected);
+
+    // the padding of a message of 56 bytes takes a block of its own
+    hash = computeMD5(std::string(56, 'a'));
+    expected = {0x3b, 0x0c, 0x8a, 0xc7, 0x03, 0xf8, 0x28, 0xb0,
+                0x4c, 0x6c, 0x19, 0x70, 0x06, 0xd1, 0x72, 0x18};
+    REQUIRE(hash == expected);
+}
+
+TEST_CASE("Test writing a 3D Tiles archive", "[TilesArchive]")
+{
+    std::filesystem::path archivePath = "TilesArchive.3tz";
+    {
+        TilesArchiveWriter writer(archivePath);
+        writer.addEntry("tileset.json", toBytes("{}"));
+        writer.addEntry("Gltf/model.glb", toBytes("glb"));
+        writer.close();
+    }
+
+    auto archive = MappedZipArchive::open(archivePath);
+    REQUIRE(archive != nullptr);
+    REQUIRE(archive->getEntryNames()
+            == std::vector<std::string>{"tileset.json", "Gltf/model.glb", TILES_ARCHIVE_INDEX_NAME});
+
+    std::vector<char> buffer;
+    REQUIRE(archive->readEntry("tileset.json", buffer) == std::string_view("{}"));
+    REQUIRE(archive->readEntry("Gltf/model.glb", buffer) == std::string_view("glb"));
+
+    SECTION("Index points to the local header of each entry, sorted by hash")
+    {
+        auto index = archive->readEntry(TILES_ARCHIVE_INDEX_NAME, buffer);
+        REQUIRE(index);
+        REQUIRE(index->size() == 48);
+
+        // the first entry starts the archive, the second one follows its 30 bytes header, name and data
+        for (const auto &name : {std::string("tileset.json"), std::string("Gltf/model.glb")}) {
+            auto hash = computeMD5(name);
+            bool isFound = false;
+            for (size_t i = 0; i < index->size(); i += 24) {
+                if (std::memcmp(index->data() + i, hash.data(), hash.size()) == 0) {
+                    REQUIRE(readUint64(index->data() + i + 16) == (name == "tileset.json" ? 0 : 30 + 12 + 2));
+                    isFound = true;
+                }
+            }
+
+            REQUIRE(isFound);
+        }
+
+        REQUIRE(readUint64(index->data()) <= readUint64(index->data() + 24));
+    }
+
+    archive.reset();
+    std::filesystem::remove(archivePath);
+}
@@ -0,0 +1,86 @@
+#include "VirtualFileSystem.h"
+#include "catch2/catch.hpp"
+#include "cpl_vsi.h"
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+using namespace CDBTo3DTiles;
+
+static void writeMemoryFile(const std::string &path, const std::string &data)
+{
+    VSILFILE *file = VSIFOpenL(path.c_str(), "wb");
+    REQUIRE(file != nullptr);
+    REQUIRE(VSIFWriteL(data.data(), 1, data.size(), file) == data.size());
+    VSIFCloseL(file);
+}
+
+TEST_CASE("Test detecting GDAL virtual file system paths", "[VirtualFileSystem]")
+{
+    REQUIRE(isVirtualFileSystemPath("/vsis3/bucket/prefix"));
+    REQUIRE(isVirtualFileSystemPath("/vsimem/prefix"));
+    REQUIRE(isVirtualFileSystemPath("/vsizip//data/CDB.zip/CDB"));
+    REQUIRE(!isVirtualFileSystemPath("Output/vsis3"));
+    REQUIRE(!isVirtualFileSystemPath("/tmp/Output"));
+}
+
+TEST_CASE("Test listing and reading a GDAL virtual file system", "[VirtualFileSystem]")
+{
+    // the in-memory file system of GDAL stands in for a bucket
+    std::string prefix = "/vsimem/VirtualCDB";
+    VSIMkdirRecursive((prefix + "/Tiles/N32").c_str(), 0755);
+    writeMemoryFile(prefix + "/Tiles/N32/tile.dbf", "attributes");
+
+    auto directoryStatus = getFileStatus(prefix + "/Tiles");
+    REQUIRE(directoryStatus);
+    REQUIRE(directoryStatus->isDirectory);
+
+    auto fileStatus = getFileStatus(prefix + "/Tiles/N32/tile.dbf");
+    REQUIRE(fileStatus);
+    REQUIRE(!fileStatus->isDirectory);
+    REQUIRE(fileStatus->size == 10);
+    REQUIRE(!getFileStatus(prefix + "/Tiles/N33"));
+
+    auto entries = listDirectory(prefix + "/Tiles");
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].name == "N32");
+    REQUIRE(entries[0].status.isDirectory);
+
+    entries = listDirectory(prefix + "/Tiles/N32");
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].name == "tile.dbf");
+    REQUIRE(entries[0].status.size == 10);
+    REQUIRE(listDirectory(prefix + "/Tiles/N33").empty());
+
+    auto data = readFile(prefix + "/Tiles/N32/tile.dbf");
+    REQUIRE(data);
+    REQUIRE(std::string(data->begin(), data->end()) == "attributes");
+    REQUIRE(!readFile(prefix + "/Tiles/N32/missing.dbf"));
+
+    VSIRmdirRecursive(prefix.c_str());
+}
+
+TEST_CASE("Test listing a local directory", "[VirtualFileSystem]")
+{
+    std::filesystem::path directory = "LocalCDB";
+    std::filesystem::create_directories(directory / "Tiles");
+    std::ofstream(directory / "Metadata.xml") << "metadata";
+
+    auto entries = listDirectory(directory);
+    std::sort(entries.begin(), entries.end(), [](const DirectoryEntry &lhs, const DirectoryEntry &rhs) {
+        return lhs.name < rhs.name;
+    });
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].name == "Metadata.xml");
+    REQUIRE(!entries[0].status.isDirectory);
+    REQUIRE(entries[0].status.size == 8);
+    REQUIRE(entries[1].name == "Tiles");
+    REQUIRE(entries[1].status.isDirectory);
+
+    auto data = readFile(directory / "Metadata.xml");
+    REQUIRE(data);
+    REQUIRE(std::string(data->begin(), data->end()) == "metadata");
+
+    std::filesystem::remove_all(directory);
+    REQUIRE(!getFileStatus(directory));
+}